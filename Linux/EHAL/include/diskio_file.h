@@ -0,0 +1,176 @@
+/**-------------------------------------------------------------------------
+@file	diskio_file.h
+
+@brief	File backed DiskIO for Linux hosts
+
+Disk image in a regular file or a block device, accessed with pread/pwrite or
+mmap.  Sector size and access latency are configurable.  Faults can be injected
+to test the storage stack : bit errors on read, write failures and power loss
+at a given sector write.
+
+Usage :
+
+	FILEDISKIO_CFG cfg = {
+		"fat.img",		// Image file
+		16 * 1024 * 1024,	// Create 16MB image if smaller
+		512,			// Sector size
+		false,			// pread/pwrite
+		0, 0,			// No added latency
+	};
+	FileDiskIO disk;
+
+	disk.Init(cfg);
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __DISKIO_FILE_H__
+#define __DISKIO_FILE_H__
+
+#include <stdint.h>
+
+#include "diskio.h"
+
+/** @addtogroup Storage
+  * @{
+  */
+
+/// File disk configuration
+typedef struct __FileDiskIO_Config {
+	const char *pPathName;		//!< Image file or block device path
+	uint64_t	Size;			//!< Disk size in bytes, image file is extended to this size
+								//!< 0 to use current file size
+	uint32_t	SectSize;		//!< Sector size in bytes, 0 for DISKIO_SECT_SIZE
+	bool		bMmap;			//!< true - access through mmap, false - pread/pwrite
+	uint32_t	usRdLatency;	//!< Added latency per read command in usec
+	uint32_t	usWrLatency;	//!< Added latency per write command in usec
+} FILEDISKIO_CFG;
+
+/// Fault injection settings
+typedef struct __FileDiskIO_Fault {
+	uint32_t	Seed;			//!< Random seed
+	uint32_t	BitErrRate;		//!< Probability in ppm for a sector read to have one bit flipped
+	uint32_t	WrFailRate;		//!< Probability in ppm for a sector write to fail, nothing written
+	uint32_t	PowerLossWrite;	//!< Power is lost during this sector write count, 0 disabled.
+								//!< Only first half of the sector is written, all accesses
+								//!< fail after until PowerRestore()
+} FILEDISKIO_FAULT;
+
+#ifdef __cplusplus
+
+/// @brief	File backed disk
+class FileDiskIO : public DiskIO {
+public:
+	FileDiskIO();
+	virtual ~FileDiskIO();
+
+	/**
+	 * @brief	Open disk image.
+	 *
+	 * @param	Cfg			: Configuration data
+	 * @param	pCacheBlk	: Pointer to static cache block (optional)
+	 * @param	NbCacheBlk	: Number of cache sector
+	 *
+	 * @return
+	 * 			- true 	: Success
+	 * 			- false	: Failed
+	 */
+	bool Init(const FILEDISKIO_CFG &Cfg, DISKIO_CACHE_DESC * const pCacheBlk = NULL, int NbCacheBlk = 0);
+
+	/**
+	 * @brief	Sync and close disk image.
+	 */
+	void Close();
+
+	virtual uint64_t GetSize(void) { return vSize; }
+	virtual int GetSectSize(void) { return vSectSize; }
+	virtual bool SectRead(uint32_t SectNo, uint8_t *pBuff);
+	virtual bool SectWrite(uint32_t SectNo, uint8_t *pData);
+	virtual int SectReadMulti(uint32_t SectNo, uint8_t *pBuff, int NbSect);
+	virtual int SectWriteMulti(uint32_t SectNo, uint8_t *pData, int NbSect);
+
+	/**
+	 * @brief	Erase whole disk, filled with 0
+	 */
+	virtual void Erase();
+
+	/**
+	 * @brief	Set fault injection.
+	 *
+	 * Write counter used for power loss is restarted.
+	 *
+	 * @param	Fault	: Fault settings, all 0 to disable
+	 */
+	void SetFault(const FILEDISKIO_FAULT &Fault);
+
+	/**
+	 * @brief	Check if simulated power loss occurred
+	 *
+	 * @return	true - Power lost, device not accessible
+	 */
+	bool PowerLost() { return vbPowerLost; }
+
+	/**
+	 * @brief	Restore power after simulated power loss.
+	 *
+	 * Sector cache content is lost as well.
+	 */
+	void PowerRestore();
+
+	uint32_t ReadCmdCount() { return vRdCmdCnt; }		//!< Number of read commands
+	uint32_t WriteCmdCount() { return vWrCmdCnt; }		//!< Number of write commands
+	uint32_t WriteSectCount() { return vWrSectCnt; }	//!< Number of sectors written
+
+private:
+	bool RawRead(uint64_t Offset, uint8_t *pBuff, uint32_t Len);
+	bool RawWrite(uint64_t Offset, uint8_t *pData, uint32_t Len);
+	uint32_t Random();
+
+	int vFd;					//!< File descriptor
+	uint8_t *vpMap;				//!< Mapped image, NULL if not mmap
+	uint64_t vSize;				//!< Disk size in bytes
+	uint32_t vSectSize;			//!< Sector size in bytes
+	uint32_t vRdLatency;		//!< Read latency in usec
+	uint32_t vWrLatency;		//!< Write latency in usec
+	FILEDISKIO_FAULT vFault;	//!< Fault injection settings
+	uint32_t vRandState;		//!< Fault random generator state
+	bool vbPowerLost;			//!< Simulated power loss occurred
+	uint32_t vRdCmdCnt;
+	uint32_t vWrCmdCnt;
+	uint32_t vWrSectCnt;
+};
+
+extern "C" {
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} End of group Storage */
+
+#endif	// __DISKIO_FILE_H__
@@ -0,0 +1,258 @@
+/**-------------------------------------------------------------------------
+@file	norflash_sim.h
+
+@brief	SPI NOR flash simulator for Linux hosts
+
+Emulates the SPI NOR command set used by FlashDiskIO so the flash stack can run
+unchanged on a host.  Erase semantics are enforced : programming only clears
+bits, erase sets a whole sector or block back to 0xFF.  Programming a 1 over a
+0 is counted as an error.  Power can be cut in the middle of a chosen program
+or erase operation, leaving it partially done.
+
+Supported commands : READID, READSTATUS, WRENABLE, WRDISABLE, READ, FAST_READ,
+DUAL_READ, DUAL_IO_READ, QUAD_READ, QUAD_IO_READ, READ_SFDP, WRITE, QUAD_WRITE,
+SECTOR_ERASE (4KB), BLOCK_ERASE_32, BLOCK_ERASE (64KB), BULK_ERASE, EN4B, EX4B,
+ERASE_SUSPEND, ERASE_RESUME.  An SFDP image can be supplied to emulate a given
+part, dual and quad read dummy clocks are then taken from it.  Without one,
+they are those of the W25Q series.
+
+With a timing configuration, the simulator keeps a virtual clock advanced by
+bus transfers at the configured SPI rate and by Delay().  Program and erase
+then stay busy for their set time.  Commands sent while busy are ignored and
+counted, as are transfers using the wrong number of data lines.  While an
+erase is suspended, pages outside of the block being erased can be programmed.  The line
+count is set by SetLines, normally from the FlashDiskIO pSetLinesCB callback.
+
+Usage :
+
+	NORFLASHSIM_CFG simcfg = {
+		8 * 1024 * 1024,	// 8MB
+		256,				// Program page size
+		3,					// Address size at power up
+		1,					// Random seed
+		NULL, 0,			// No SFDP
+		0,					// 64KB block erase
+		NULL				// Operations complete instantly
+	};
+	NorFlashSim g_NorSim;
+	FlashDiskIO g_Flash;
+
+	g_NorSim.Init(simcfg);
+	g_Flash.Init(s_FlashDiskCfg, &g_NorSim);
+
+	g_NorSim.PowerCut(100);	// Power lost during the 100th program or erase
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __NORFLASH_SIM_H__
+#define __NORFLASH_SIM_H__
+
+#include <stdint.h>
+
+#include "device_intrf.h"
+
+/** @addtogroup Storage
+  * @{
+  */
+
+#define NORFLASHSIM_SECT_SIZE		0x1000		//!< Smallest erase unit, erase counts are per sector
+#define NORFLASHSIM_CMD_MAX			8			//!< Max command + address length
+
+/// Timing model, all operation times are fixed
+typedef struct __NorFlashSim_Timing {
+	uint32_t ClkRate;		//!< SPI clock in Hz
+	uint32_t CsTime;		//!< Chip select overhead per transfer in nsec
+	uint32_t ProgTime;		//!< Page program time in usec
+	uint32_t SectEraseTime;	//!< 4KB erase time in usec
+	uint32_t Blk32EraseTime;//!< 32KB erase time in usec
+	uint32_t BlkEraseTime;	//!< Block erase time in usec
+	uint32_t ChipEraseTime;	//!< Chip erase time in msec
+	uint32_t SuspendTime;	//!< Erase suspend latency in usec
+	uint32_t ResumeTime;	//!< Erase progress needed after resume before next suspend in usec
+} NORFLASHSIM_TIMING;
+
+typedef struct __NorFlashSim_Cfg {
+	uint32_t TotalSize;		//!< Flash size in bytes, multiple of 64KB
+	uint32_t PageSize;		//!< Program page size in bytes, program wraps within page
+	int AddrSize;			//!< Address size in bytes at power up
+	uint32_t Seed;			//!< Random seed for partial operation on power cut
+	const uint8_t *pSfdp;	//!< SFDP image returned by READ_SFDP, NULL if not supported
+	uint32_t SfdpLen;		//!< SFDP image size in bytes
+	uint32_t BlkSize;		//!< Block erase (0xD8) size, 0 - 64KB
+	const NORFLASHSIM_TIMING *pTiming;	//!< Timing model, NULL - operations complete instantly
+} NORFLASHSIM_CFG;
+
+/// @brief	SPI NOR flash simulator
+class NorFlashSim : public DeviceIntrf {
+public:
+	NorFlashSim();
+	virtual ~NorFlashSim();
+
+	/**
+	 * @brief	Initialize simulator, flash content is erased
+	 *
+	 * @param	Cfg	: Simulator configuration
+	 *
+	 * @return	true - Success
+	 */
+	bool Init(const NORFLASHSIM_CFG &Cfg);
+
+	operator DEVINTRF * const () { return &vDevIntrf; }
+	DEVINTRF_TYPE Type() { return DEVINTRF_TYPE_SPI; }
+	int Rate(int DataRate) { return DataRate; }
+	int Rate(void) { return 0; }
+	void Disable(void) {}
+	void Enable(void) {}
+	void Reset(void) {}
+
+	int Rx(int DevAddr, uint8_t *pBuff, int BuffLen);
+	int Tx(int DevAddr, uint8_t *pData, int DataLen);
+	int Read(int DevAddr, uint8_t *pAdCmd, int AdCmdLen, uint8_t *pBuff, int BuffLen);
+	int Write(int DevAddr, uint8_t *pAdCmd, int AdCmdLen, uint8_t *pData, int DataLen);
+	bool StartRx(int DevAddr);
+	int RxData(uint8_t *pBuff, int BuffLen);
+	void StopRx(void);
+	bool StartTx(int DevAddr);
+	int TxData(uint8_t *pData, int DataLen);
+	void StopTx(void);
+
+	/**
+	 * @brief	Schedule a power cut.
+	 *
+	 * The NbOp-th program or erase from now is interrupted part way.  The
+	 * flash then ignores all commands until PowerRestore.
+	 *
+	 * @param	NbOp	: Operation count, 0 to cancel
+	 */
+	void PowerCut(uint32_t NbOp) { vCutCnt = NbOp; }
+	bool PowerLost() { return vbPowerLost; }
+	void PowerRestore();
+
+	/**
+	 * @brief	Get erase count of the 4KB sector containing an address
+	 *
+	 * @param	Addr	: Flash address
+	 *
+	 * @return	Erase count
+	 */
+	uint32_t EraseCount(uint32_t Addr) { return Addr < vSize ? vpEraseCnt[Addr / NORFLASHSIM_SECT_SIZE] : 0; }
+
+	uint8_t *Mem() { return vpMem; }				//!< Flash content
+	uint64_t ProgByteCount() { return vProgBytes; }	//!< Bytes programmed
+	uint32_t ProgOpCount() { return vProgOps; }		//!< Page program commands
+	uint32_t EraseOpCount() { return vEraseOps; }	//!< Erase commands
+	uint32_t ProgErrorCount() { return vProgErr; }	//!< Bytes programmed without prior erase
+	int AddrSize() { return vAddrSize; }			//!< Current address mode
+
+	/**
+	 * @brief	Set number of data lines used by the following transfers
+	 *
+	 * @param	NbLines	: 1, 2 or 4
+	 */
+	void SetLines(int NbLines) { vLines = NbLines; }
+
+	/**
+	 * @brief	Advance virtual clock, ex. time spent by the host between accesses
+	 *
+	 * @param	usDelay	: Time in usec
+	 */
+	void Delay(uint32_t usDelay) { vTime += (uint64_t)usDelay * 1000000; }
+
+	uint64_t Time() { return vTime / 1000; }		//!< Virtual time in nsec
+	bool Busy() { return vTime < vBusyEnd; }		//!< Program or erase in progress
+	uint32_t StatusReadCount() { return vStatusCnt; }	//!< Status reads
+	uint32_t BusyErrorCount() { return vBusyErr; }	//!< Commands ignored while busy
+	uint32_t LineErrorCount() { return vLineErr; }	//!< Transfers with wrong line count
+	uint32_t SuspendCount() { return vSuspendCnt; }	//!< Erase suspended
+	uint32_t CmdCount(uint8_t Cmd) { return vCmdCnt[Cmd]; }	//!< Commands sent with opcode Cmd
+
+private:
+	void Program();
+	void EraseRange(uint32_t Addr, uint32_t Len);
+	void Clock(int NbBytes);
+	void SetBusy(uint32_t usTime, bool bErase);
+	bool Accepted();
+	int AddrLines(uint8_t Cmd);
+	int DataLines(uint8_t Cmd);
+	int DummyBytes(uint8_t Cmd);
+	bool CutNow();
+	uint32_t Random();
+
+	DEVINTRF vDevIntrf;
+	uint8_t *vpMem;
+	uint32_t *vpEraseCnt;
+	uint32_t vSize;
+	uint32_t vPageSize;
+	uint32_t vBlkSize;			//!< Block erase size
+	int vAddrSize;				//!< Current address size
+	int vAddrSizeDef;			//!< Power up address size
+	const uint8_t *vpSfdp;
+	uint32_t vSfdpLen;
+	uint8_t vCmd[NORFLASHSIM_CMD_MAX];
+	int vCmdLen;
+	uint32_t vAddr;				//!< Current read address
+	uint8_t *vpPage;			//!< Page program data
+	uint32_t vPageLen;
+	bool vbWel;					//!< Write enable latch
+	bool vbPowerLost;
+	uint32_t vCutCnt;
+	uint32_t vRandState;
+	uint64_t vProgBytes;
+	uint32_t vProgOps;
+	uint32_t vEraseOps;
+	uint32_t vProgErr;
+	const NORFLASHSIM_TIMING *vpTiming;
+	uint64_t vTime;				//!< Virtual time in psec
+	uint64_t vBusyEnd;			//!< End of program or erase in psec
+	uint64_t vRemain;			//!< Remaining erase time while suspended
+	uint64_t vResumeEnd;		//!< Earliest time a suspend takes effect
+	bool vbEraseOp;				//!< Busy operation is an erase
+	uint32_t vEraseAddr;		//!< Last block erase started
+	uint32_t vEraseLen;
+	bool vbSuspended;
+	int vLines;					//!< Current number of data lines
+	bool vbLineErr;				//!< Current transfer used wrong lines
+	uint32_t vStatusCnt;
+	uint32_t vBusyErr;
+	uint32_t vLineErr;
+	uint32_t vSuspendCnt;
+	uint32_t vCmdCnt[256];		//!< Commands sent per opcode
+	uint8_t vDummyClk[4];		//!< Dual and quad read dummy clocks
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} End of group Storage */
+
+#endif	// __NORFLASH_SIM_H__
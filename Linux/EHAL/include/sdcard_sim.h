@@ -0,0 +1,252 @@
+/**-------------------------------------------------------------------------
+@file	sdcard_sim.h
+
+@brief	SD card SPI mode simulator for Linux hosts
+
+Emulates an SDHC card on the SPI bus so the SD drivers, the C++ SDCard class
+and the C SDxxx functions, can run unchanged on a host.  The card is seen
+byte per byte as on the wire : commands are decoded from the MOSI stream and
+responses, data tokens and busy are returned on MISO.  Every byte clocked,
+transmitted or received, consumes one byte of card output, as on a full duplex
+bus.  The C DEVINTRF interface is filled, the simulator can be passed to either
+driver.
+
+Supported commands : CMD0, CMD1, CMD8, CMD9, CMD10, CMD12, CMD13, CMD16,
+CMD17, CMD18, CMD24, CMD25, CMD55, CMD58, CMD59, ACMD23, ACMD41.  Blocks are
+512 bytes, addressed by block number.  Command CRC is checked for CMD0 and
+CMD8, and for all commands and write data once enabled with CMD59.  Read data
+always carries a valid CRC16.
+
+With a timing configuration, the simulator keeps a virtual clock advanced by
+bus transfers at the configured SPI rate and by Delay().  Read data is returned
+after the access time, single block reads and the first block of CMD18 pay the
+full access time, the following blocks of CMD18 a shorter one.  Written blocks
+keep the card busy for their program time, shorter for the blocks of CMD25 and
+shorter still for the blocks pre-erased with ACMD23.  Each written block also
+adds to a garbage collection debt, heavier for single block writes, and the
+block that reaches GcDebt is stalled by GcTime.  Random latency spikes can
+be added on top with Spikes().  Protocol errors, such as a
+command or a token sent while the card is busy, are counted.
+
+Usage :
+
+	static const SDCARDSIM_TIMING s_SimTiming = {
+		25000000,			// 25MHz SPI clock
+		1000,				// 1us per transfer
+		500, 100,			// Read access time, single and multi block
+		1500, 400, 250,		// Program time, single, multi and pre-erased block
+		500,				// Busy after stop token
+		256, 50000,			// 50ms garbage collection every 256 debt units
+	};
+
+	static const SDCARDSIM_CFG s_SimCfg = {
+		64 * 1024 * 1024 / 512,	// 64MB
+		&s_SimTiming
+	};
+
+	SdCardSim g_SdSim;
+	SDCard g_SdCard;
+
+	g_SdSim.Init(s_SimCfg);
+	g_SdCard.Init(&g_SdSim, s_CacheMem, sizeof(s_CacheMem));
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __SDCARD_SIM_H__
+#define __SDCARD_SIM_H__
+
+#include <stdint.h>
+
+#include "device_intrf.h"
+
+/** @addtogroup Storage
+  * @{
+  */
+
+#define SDCARDSIM_BLK_SIZE			512			//!< Block size in bytes
+#define SDCARDSIM_INIT_POLLS		2			//!< ACMD41 or CMD1 returning idle before ready
+#define SDCARDSIM_RESP_MAX			24			//!< Max response bytes queued, CSD/CID block included
+
+/// Garbage collection debt of each written block
+#define SDCARDSIM_GC_SINGLE			8			//!< CMD24 block, partial program unit
+#define SDCARDSIM_GC_MULTI			2			//!< CMD25 block
+#define SDCARDSIM_GC_PREERASED		1			//!< CMD25 block pre-erased with ACMD23
+
+/// Timing model, all operation times are fixed
+typedef struct __SdCardSim_Timing {
+	uint32_t ClkRate;		//!< SPI clock in Hz
+	uint32_t CsTime;		//!< Overhead per transfer in nsec
+	uint32_t ReadTime;		//!< Read access time of CMD17 and first CMD18 block in usec
+	uint32_t ReadMultiTime;	//!< Read access time of following CMD18 blocks in usec
+	uint32_t ProgTime;		//!< Program time of a CMD24 block in usec
+	uint32_t ProgMultiTime;	//!< Program time of a CMD25 block in usec
+	uint32_t ProgPreErasedTime;	//!< Program time of a CMD25 block pre-erased by ACMD23 in usec
+	uint32_t StopTime;		//!< Busy after CMD25 stop token in usec
+	uint32_t GcDebt;		//!< Debt units between garbage collection stalls, 0 - none
+	uint32_t GcTime;		//!< Garbage collection stall in usec
+} SDCARDSIM_TIMING;
+
+typedef struct __SdCardSim_Cfg {
+	uint32_t NbBlk;			//!< Card size in blocks, multiple of 1024
+	const SDCARDSIM_TIMING *pTiming;	//!< Timing model, NULL - operations complete instantly
+} SDCARDSIM_CFG;
+
+/// @brief	SD card SPI mode simulator
+class SdCardSim : public DeviceIntrf {
+public:
+	SdCardSim();
+	virtual ~SdCardSim();
+
+	/**
+	 * @brief	Initialize simulator, card content is cleared and card is
+	 * 			powered up in native mode
+	 *
+	 * @param	Cfg	: Simulator configuration
+	 *
+	 * @return	true - Success
+	 */
+	bool Init(const SDCARDSIM_CFG &Cfg);
+
+	operator DEVINTRF * const () { return &vDevIntrf; }
+	DEVINTRF_TYPE Type() { return DEVINTRF_TYPE_SPI; }
+	int Rate(int DataRate) { vRate = DataRate; return DataRate; }
+	int Rate(void) { return vRate; }
+	void Disable(void) {}
+	void Enable(void) {}
+	void Reset(void) {}
+
+	bool StartRx(int DevAddr);
+	int RxData(uint8_t *pBuff, int BuffLen);
+	void StopRx(void);
+	bool StartTx(int DevAddr);
+	int TxData(uint8_t *pData, int DataLen);
+	void StopTx(void);
+
+	uint8_t *Mem() { return vpMem; }				//!< Card content
+	uint32_t NbBlk() { return vNbBlk; }				//!< Card size in blocks
+
+	/**
+	 * @brief	Advance virtual clock, ex. time spent by the host between accesses
+	 *
+	 * @param	usDelay	: Time in usec
+	 */
+	void Delay(uint32_t usDelay) { vTime += (uint64_t)usDelay * 1000000; }
+
+	uint64_t Time() { return vTime / 1000; }		//!< Virtual time in nsec
+	bool Busy() { return vTime < vBusyEnd; }		//!< Program in progress
+	uint32_t CmdCount() { return vCmdCnt; }			//!< Commands received
+	uint32_t TransferCount() { return vXferCnt; }	//!< Bus transfers
+	uint64_t ByteCount() { return vByteCnt; }		//!< Bytes clocked
+	uint32_t ReadBlkCount() { return vRdBlkCnt; }	//!< Blocks sent
+	uint32_t WriteBlkCount() { return vWrBlkCnt; }	//!< Blocks programmed
+	uint32_t PreErasedCount() { return vPreErasedCnt; }	//!< Blocks programmed pre-erased
+	uint32_t GcCount() { return vGcCnt; }			//!< Garbage collection stalls
+	uint32_t CrcErrorCount() { return vCrcErr; }	//!< Command or data CRC errors
+	uint32_t ProtoErrorCount() { return vProtoErr; }	//!< Protocol errors
+	uint64_t MaxBusy() { return vMaxBusy / 1000; }	//!< Longest busy period in nsec
+
+	/**
+	 * @brief	Inject random latency spikes, with a timing model only
+	 *
+	 * Each block read or programmed has a 1 in Rate chance to be delayed by a
+	 * random time up to usMax, on top of its access or program time.
+	 *
+	 * @param	Rate	: 1 in Rate blocks delayed, 0 - no spike
+	 * @param	usMax	: Longest spike in usec
+	 * @param	Seed	: Random seed
+	 */
+	void Spikes(uint32_t Rate, uint32_t usMax, uint32_t Seed) {
+		vSpikeRate = Rate; vSpikeMax = usMax; vRandState = Seed ? Seed : 1;
+	}
+	uint32_t SpikeCount() { return vSpikeCnt; }		//!< Blocks delayed by a spike
+
+private:
+	uint8_t Clock();
+	void Receive(uint8_t Data);
+	void Command();
+	void Respond(uint8_t R1);
+	void QueueResp(uint8_t Data);
+	void QueueBlock(const uint8_t *pData, int Len, uint32_t usTime);
+	void Program();
+	uint32_t Spike();
+	uint32_t Random();
+	uint64_t Psec(uint32_t usTime) { return vpTiming ? (uint64_t)usTime * 1000000 : 0; }
+
+	DEVINTRF vDevIntrf;
+	int vRate;
+	uint8_t *vpMem;
+	uint32_t vNbBlk;
+	const SDCARDSIM_TIMING *vpTiming;
+	uint64_t vTime;				//!< Virtual time in psec
+	uint64_t vBusyEnd;			//!< End of program in psec
+	uint64_t vMaxBusy;			//!< Longest busy period in psec
+	bool vbIdle;				//!< Card in idle state, not initialized
+	bool vbAppCmd;				//!< Next command is an application command
+	bool vbCrcOn;				//!< CRC checked, set by CMD59
+	int vInitPolls;				//!< ACMD41 received
+	uint8_t vCmd[6];			//!< Command being received
+	int vCmdLen;
+	uint8_t vResp[SDCARDSIM_RESP_MAX];	//!< Response bytes, sent before data
+	int vRespLen;
+	int vRespIdx;
+	uint8_t vBlk[SDCARDSIM_BLK_SIZE + 3];	//!< Data token, data and CRC being sent or received
+	int vBlkLen;
+	int vBlkIdx;
+	uint64_t vBlkReady;			//!< Time data token is sent, in psec
+	bool vbReading;				//!< CMD18 in progress
+	int vWrState;				//!< Write data reception state
+	bool vbMultiWr;				//!< CMD25 in progress
+	uint32_t vAddr;				//!< Next block to read or write
+	uint32_t vPreErase;			//!< Blocks pre-erased by ACMD23 left
+	uint32_t vGcDebt;
+	uint32_t vCmdCnt;
+	uint32_t vXferCnt;
+	uint64_t vByteCnt;
+	uint32_t vRdBlkCnt;
+	uint32_t vWrBlkCnt;
+	uint32_t vPreErasedCnt;
+	uint32_t vGcCnt;
+	uint32_t vCrcErr;
+	uint32_t vProtoErr;
+	uint32_t vSpikeRate;
+	uint32_t vSpikeMax;
+	uint32_t vSpikeCnt;
+	uint32_t vRandState;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} End of group Storage */
+
+#endif	// __SDCARD_SIM_H__
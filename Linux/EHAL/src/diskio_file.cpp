@@ -0,0 +1,339 @@
+/**-------------------------------------------------------------------------
+@file	diskio_file.cpp
+
+@brief	File backed DiskIO for Linux hosts
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+
+#include "diskio_file.h"
+
+FileDiskIO::FileDiskIO() : DiskIO()
+{
+	vFd = -1;
+	vpMap = NULL;
+	vSize = 0;
+	vSectSize = DISKIO_SECT_SIZE;
+	vRdLatency = 0;
+	vWrLatency = 0;
+	memset(&vFault, 0, sizeof(vFault));
+	vRandState = 1;
+	vbPowerLost = false;
+	vRdCmdCnt = 0;
+	vWrCmdCnt = 0;
+	vWrSectCnt = 0;
+}
+
+FileDiskIO::~FileDiskIO()
+{
+	Close();
+}
+
+bool FileDiskIO::Init(const FILEDISKIO_CFG &Cfg, DISKIO_CACHE_DESC * const pCacheBlk, int NbCacheBlk)
+{
+	struct stat st;
+
+	if (Cfg.pPathName == NULL)
+		return false;
+
+	Close();
+
+	vFd = open(Cfg.pPathName, O_RDWR | O_CREAT, 0644);
+	if (vFd < 0)
+		return false;
+
+	if (fstat(vFd, &st) < 0)
+	{
+		Close();
+		return false;
+	}
+
+	vSectSize = Cfg.SectSize > 0 ? Cfg.SectSize : DISKIO_SECT_SIZE;
+	vRdLatency = Cfg.usRdLatency;
+	vWrLatency = Cfg.usWrLatency;
+
+	if (S_ISBLK(st.st_mode))
+	{
+		uint64_t sz = 0;
+
+		if (ioctl(vFd, BLKGETSIZE64, &sz) < 0)
+		{
+			Close();
+			return false;
+		}
+		vSize = Cfg.Size > 0 && Cfg.Size < sz ? Cfg.Size : sz;
+	}
+	else
+	{
+		if (Cfg.Size > (uint64_t)st.st_size)
+		{
+			// Extend image file
+			if (ftruncate(vFd, Cfg.Size) < 0)
+			{
+				Close();
+				return false;
+			}
+			st.st_size = Cfg.Size;
+		}
+		vSize = Cfg.Size > 0 ? Cfg.Size : st.st_size;
+	}
+
+	// Whole sectors only
+	vSize -= vSize % vSectSize;
+
+	if (vSize == 0)
+	{
+		Close();
+		return false;
+	}
+
+	if (Cfg.bMmap)
+	{
+		void *p = mmap(NULL, vSize, PROT_READ | PROT_WRITE, MAP_SHARED, vFd, 0);
+
+		if (p == MAP_FAILED)
+		{
+			Close();
+			return false;
+		}
+		vpMap = (uint8_t*)p;
+	}
+
+	if (pCacheBlk && NbCacheBlk > 0)
+	{
+		SetCache(pCacheBlk, NbCacheBlk);
+	}
+
+	return true;
+}
+
+void FileDiskIO::Close()
+{
+	if (vpMap)
+	{
+		msync(vpMap, vSize, MS_SYNC);
+		munmap(vpMap, vSize);
+		vpMap = NULL;
+	}
+
+	if (vFd >= 0)
+	{
+		fsync(vFd);
+		close(vFd);
+		vFd = -1;
+	}
+}
+
+bool FileDiskIO::RawRead(uint64_t Offset, uint8_t *pBuff, uint32_t Len)
+{
+	if (Offset + Len > vSize)
+		return false;
+
+	if (vpMap)
+	{
+		memcpy(pBuff, vpMap + Offset, Len);
+
+		return true;
+	}
+
+	while (Len > 0)
+	{
+		ssize_t l = pread(vFd, pBuff, Len, Offset);
+		if (l <= 0)
+			return false;
+		pBuff += l;
+		Offset += l;
+		Len -= l;
+	}
+
+	return true;
+}
+
+bool FileDiskIO::RawWrite(uint64_t Offset, uint8_t *pData, uint32_t Len)
+{
+	if (Offset + Len > vSize)
+		return false;
+
+	if (vpMap)
+	{
+		memcpy(vpMap + Offset, pData, Len);
+
+		return true;
+	}
+
+	while (Len > 0)
+	{
+		ssize_t l = pwrite(vFd, pData, Len, Offset);
+		if (l <= 0)
+			return false;
+		pData += l;
+		Offset += l;
+		Len -= l;
+	}
+
+	return true;
+}
+
+// xorshift32, independent of application rand()
+uint32_t FileDiskIO::Random()
+{
+	vRandState ^= vRandState << 13;
+	vRandState ^= vRandState >> 17;
+	vRandState ^= vRandState << 5;
+
+	return vRandState;
+}
+
+void FileDiskIO::SetFault(const FILEDISKIO_FAULT &Fault)
+{
+	vFault = Fault;
+	vRandState = Fault.Seed ? Fault.Seed : 1;
+	vWrSectCnt = 0;
+}
+
+void FileDiskIO::PowerRestore()
+{
+	vbPowerLost = false;
+	vFault.PowerLossWrite = 0;
+
+	// Volatile content is gone
+	Reset();
+}
+
+bool FileDiskIO::SectRead(uint32_t SectNo, uint8_t *pBuff)
+{
+	return SectReadMulti(SectNo, pBuff, 1) == 1;
+}
+
+bool FileDiskIO::SectWrite(uint32_t SectNo, uint8_t *pData)
+{
+	return SectWriteMulti(SectNo, pData, 1) == 1;
+}
+
+int FileDiskIO::SectReadMulti(uint32_t SectNo, uint8_t *pBuff, int NbSect)
+{
+	if (vFd < 0 || vbPowerLost || NbSect <= 0)
+		return 0;
+
+	vRdCmdCnt++;
+
+	if (vRdLatency > 0)
+	{
+		usleep(vRdLatency);
+	}
+
+	if (RawRead((uint64_t)SectNo * vSectSize, pBuff, NbSect * vSectSize) == false)
+		return 0;
+
+	if (vFault.BitErrRate > 0)
+	{
+		for (int i = 0; i < NbSect; i++)
+		{
+			if (Random() % 1000000 < vFault.BitErrRate)
+			{
+				uint32_t bit = Random() % (vSectSize * 8);
+
+				pBuff[i * vSectSize + (bit >> 3)] ^= 1 << (bit & 7);
+			}
+		}
+	}
+
+	return NbSect;
+}
+
+int FileDiskIO::SectWriteMulti(uint32_t SectNo, uint8_t *pData, int NbSect)
+{
+	if (vFd < 0 || vbPowerLost || NbSect <= 0)
+		return 0;
+
+	vWrCmdCnt++;
+
+	if (vWrLatency > 0)
+	{
+		usleep(vWrLatency);
+	}
+
+	// Number of sectors written before a fault
+	int cnt = 0;
+	bool torn = false;
+
+	while (cnt < NbSect)
+	{
+		if (vFault.PowerLossWrite > 0 && vWrSectCnt + 1 >= vFault.PowerLossWrite)
+		{
+			torn = true;
+			break;
+		}
+		if (vFault.WrFailRate > 0 && Random() % 1000000 < vFault.WrFailRate)
+		{
+			break;
+		}
+		vWrSectCnt++;
+		cnt++;
+	}
+
+	if (cnt > 0 && RawWrite((uint64_t)SectNo * vSectSize, pData, cnt * vSectSize) == false)
+		return 0;
+
+	if (torn)
+	{
+		// Power lost in the middle of the sector
+		RawWrite((uint64_t)(SectNo + cnt) * vSectSize, pData + cnt * vSectSize, vSectSize / 2);
+		vWrSectCnt++;
+		vbPowerLost = true;
+	}
+
+	return cnt;
+}
+
+void FileDiskIO::Erase()
+{
+	uint8_t d[DISKIO_SECT_SIZE];
+	uint64_t off = 0;
+
+	memset(d, 0, sizeof(d));
+
+	while (off < vSize)
+	{
+		uint32_t l = vSize - off < sizeof(d) ? vSize - off : sizeof(d);
+
+		if (RawWrite(off, d, l) == false)
+			break;
+		off += l;
+	}
+
+	Reset();
+}
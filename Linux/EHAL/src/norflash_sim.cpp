@@ -0,0 +1,662 @@
+/**-------------------------------------------------------------------------
+@file	norflash_sim.cpp
+
+@brief	SPI NOR flash simulator for Linux hosts
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "diskio_flash.h"
+#include "norflash_sim.h"
+
+NorFlashSim::NorFlashSim()
+{
+	memset(&vDevIntrf, 0, sizeof(vDevIntrf));
+	vDevIntrf.Type = DEVINTRF_TYPE_SPI;
+	vpMem = NULL;
+	vpEraseCnt = NULL;
+	vpPage = NULL;
+	vSize = 0;
+	vPageSize = 0;
+	vBlkSize = 0x10000;
+	vAddrSize = 3;
+	vAddrSizeDef = 3;
+	vpSfdp = NULL;
+	vSfdpLen = 0;
+	vCmdLen = 0;
+	vAddr = 0;
+	vPageLen = 0;
+	vbWel = false;
+	vbPowerLost = false;
+	vCutCnt = 0;
+	vRandState = 1;
+	vProgBytes = 0;
+	vProgOps = 0;
+	vEraseOps = 0;
+	vProgErr = 0;
+	vpTiming = NULL;
+	vTime = 0;
+	vBusyEnd = 0;
+	vRemain = 0;
+	vResumeEnd = 0;
+	vbEraseOp = false;
+	vEraseAddr = 0;
+	vEraseLen = 0;
+	vbSuspended = false;
+	vLines = 1;
+	vbLineErr = false;
+	vStatusCnt = 0;
+	vBusyErr = 0;
+	vLineErr = 0;
+	vSuspendCnt = 0;
+}
+
+NorFlashSim::~NorFlashSim()
+{
+	delete[] vpMem;
+	delete[] vpEraseCnt;
+	delete[] vpPage;
+}
+
+bool NorFlashSim::Init(const NORFLASHSIM_CFG &Cfg)
+{
+	if (Cfg.TotalSize < 0x10000 || (Cfg.TotalSize & 0xFFFF) || Cfg.PageSize == 0 ||
+		Cfg.AddrSize < 3 || Cfg.AddrSize > 4 ||
+		(Cfg.BlkSize & (Cfg.BlkSize - 1)) || Cfg.BlkSize > Cfg.TotalSize ||
+		(Cfg.pTiming && Cfg.pTiming->ClkRate == 0))
+		return false;
+
+	delete[] vpMem;
+	delete[] vpEraseCnt;
+	delete[] vpPage;
+
+	vSize = Cfg.TotalSize;
+	vPageSize = Cfg.PageSize;
+	vBlkSize = Cfg.BlkSize < NORFLASHSIM_SECT_SIZE ? 0x10000 : Cfg.BlkSize;
+	vAddrSize = Cfg.AddrSize;
+	vAddrSizeDef = Cfg.AddrSize;
+	vpSfdp = Cfg.pSfdp;
+	vSfdpLen = Cfg.pSfdp ? Cfg.SfdpLen : 0;
+	vRandState = Cfg.Seed ? Cfg.Seed : 1;
+	vpTiming = Cfg.pTiming;
+
+	vpMem = new uint8_t[vSize];
+	vpEraseCnt = new uint32_t[vSize / NORFLASHSIM_SECT_SIZE];
+	vpPage = new uint8_t[vPageSize];
+
+	memset(vpMem, 0xff, vSize);
+	memset(vpEraseCnt, 0, vSize / NORFLASHSIM_SECT_SIZE * sizeof(uint32_t));
+
+	vCmdLen = 0;
+	vbWel = false;
+	vbPowerLost = false;
+	vCutCnt = 0;
+	vProgBytes = 0;
+	vProgOps = 0;
+	vEraseOps = 0;
+	vProgErr = 0;
+	vTime = 0;
+	vBusyEnd = 0;
+	vbSuspended = false;
+	vLines = 1;
+	vStatusCnt = 0;
+	vBusyErr = 0;
+	vLineErr = 0;
+	vSuspendCnt = 0;
+	memset(vCmdCnt, 0, sizeof(vCmdCnt));
+
+	// Dual and quad read dummy clocks of the part described by the SFDP image,
+	// W25Q clocks otherwise
+	vDummyClk[0] = 8;	// DUAL_READ
+	vDummyClk[1] = 4;	// DUAL_IO_READ
+	vDummyClk[2] = 8;	// QUAD_READ
+	vDummyClk[3] = 6;	// QUAD_IO_READ
+
+	uint32_t ptp = vSfdpLen >= 16 ? vpSfdp[12] | (vpSfdp[13] << 8) | (vpSfdp[14] << 16) : 0;
+
+	if (ptp > 0 && ptp + 16 <= vSfdpLen)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			// BFPT DWORD 3 : 1-4-4 and 1-1-4, DWORD 4 : 1-1-2 and 1-2-2
+			const uint8_t *p = &vpSfdp[ptp + 8 + i * 2];
+			int idx = -1;
+
+			switch (p[1])
+			{
+				case FLASH_CMD_DUAL_READ:
+					idx = 0;
+					break;
+				case FLASH_CMD_DUAL_IO_READ:
+					idx = 1;
+					break;
+				case FLASH_CMD_QUAD_READ:
+					idx = 2;
+					break;
+				case FLASH_CMD_QUAD_IO_READ:
+					idx = 3;
+					break;
+			}
+			if (idx >= 0)
+				vDummyClk[idx] = (p[0] & 0x1F) + (p[0] >> 5);
+		}
+	}
+
+	return true;
+}
+
+void NorFlashSim::PowerRestore()
+{
+	vbPowerLost = false;
+	vbWel = false;
+	vCmdLen = 0;
+	vCutCnt = 0;
+	vAddrSize = vAddrSizeDef;
+	vBusyEnd = vTime;
+	vbSuspended = false;
+}
+
+// Address/dummy lines of read and program opcodes
+int NorFlashSim::AddrLines(uint8_t Cmd)
+{
+	switch (Cmd)
+	{
+		case FLASH_CMD_DUAL_IO_READ:
+			return 2;
+		case FLASH_CMD_QUAD_IO_READ:
+			return 4;
+	}
+
+	return 1;
+}
+
+int NorFlashSim::DataLines(uint8_t Cmd)
+{
+	switch (Cmd)
+	{
+		case FLASH_CMD_DUAL_READ:
+		case FLASH_CMD_DUAL_IO_READ:
+			return 2;
+		case FLASH_CMD_QUAD_READ:
+		case FLASH_CMD_QUAD_IO_READ:
+		case FLASH_CMD_QUAD_WRITE:
+			return 4;
+	}
+
+	return 1;
+}
+
+// Dummy bytes after address, dummy clocks including mode bits
+int NorFlashSim::DummyBytes(uint8_t Cmd)
+{
+	switch (Cmd)
+	{
+		case FLASH_CMD_READ:
+			return 0;
+		case FLASH_CMD_DUAL_READ:
+			return vDummyClk[0] / 8;
+		case FLASH_CMD_DUAL_IO_READ:
+			return vDummyClk[1] * 2 / 8;
+		case FLASH_CMD_QUAD_READ:
+			return vDummyClk[2] / 8;
+		case FLASH_CMD_QUAD_IO_READ:
+			return vDummyClk[3] * 4 / 8;
+	}
+
+	return 1;			// 8 clocks on 1 line
+}
+
+// Advance virtual clock by a transfer on the current lines
+void NorFlashSim::Clock(int NbBytes)
+{
+	if (vpTiming == NULL)
+		return;
+
+	vTime += (uint64_t)NbBytes * 8 / vLines * (1000000000000ULL / vpTiming->ClkRate);
+}
+
+void NorFlashSim::SetBusy(uint32_t usTime, bool bErase)
+{
+	if (vpTiming == NULL)
+		return;
+
+	vBusyEnd = vTime + (uint64_t)usTime * 1000000;
+	vResumeEnd = vTime + (uint64_t)vpTiming->ResumeTime * 1000000;
+	vbEraseOp = bErase;
+}
+
+// Only status read and suspend are accepted while busy.  While an erase is
+// suspended, program is only accepted outside of the block being erased and
+// no other erase is accepted
+bool NorFlashSim::Accepted()
+{
+	switch (vCmd[0])
+	{
+		case FLASH_CMD_READSTATUS:
+		case FLASH_CMD_ERASE_SUSPEND:
+			return true;
+		case FLASH_CMD_WRITE:
+		case FLASH_CMD_QUAD_WRITE:
+			if (vbSuspended && vAddr >= vEraseAddr && vAddr < vEraseAddr + vEraseLen)
+			{
+				vBusyErr++;
+				return false;
+			}
+			break;
+		case FLASH_CMD_SECTOR_ERASE:
+		case FLASH_CMD_BLOCK_ERASE_32:
+		case FLASH_CMD_BLOCK_ERASE:
+		case FLASH_CMD_BULK_ERASE:
+		case FLASH_CMD_BULK_ERASE_ALT:
+			if (vbSuspended)
+			{
+				vBusyErr++;
+				return false;
+			}
+			break;
+	}
+
+	if (Busy())
+	{
+		vBusyErr++;
+		return false;
+	}
+
+	return true;
+}
+
+// xorshift32
+uint32_t NorFlashSim::Random()
+{
+	vRandState ^= vRandState << 13;
+	vRandState ^= vRandState >> 17;
+	vRandState ^= vRandState << 5;
+
+	return vRandState;
+}
+
+bool NorFlashSim::CutNow()
+{
+	if (vCutCnt == 0)
+		return false;
+
+	vCutCnt--;
+	if (vCutCnt > 0)
+		return false;
+
+	vbPowerLost = true;
+
+	return true;
+}
+
+bool NorFlashSim::StartRx(int DevAddr)
+{
+	(void)DevAddr;
+
+	vCmdLen = 0;
+	vbLineErr = false;
+	if (vpTiming)
+		vTime += (uint64_t)vpTiming->CsTime * 1000;
+
+	return true;
+}
+
+bool NorFlashSim::StartTx(int DevAddr)
+{
+	(void)DevAddr;
+
+	vCmdLen = 0;
+	vbLineErr = false;
+	if (vpTiming)
+		vTime += (uint64_t)vpTiming->CsTime * 1000;
+
+	return true;
+}
+
+int NorFlashSim::TxData(uint8_t *pData, int DataLen)
+{
+	if (vbPowerLost)
+		return 0;
+
+	Clock(DataLen);
+
+	for (int i = 0; i < DataLen; i++)
+	{
+		bool prog = vCmdLen > vAddrSize &&
+					(vCmd[0] == FLASH_CMD_WRITE || vCmd[0] == FLASH_CMD_QUAD_WRITE);
+
+		// Opcode on single line, then address, dummy and data lines of the opcode
+		if (vLines != (vCmdLen == 0 ? 1 : prog ? DataLines(vCmd[0]) : AddrLines(vCmd[0])))
+			vbLineErr = true;
+
+		if (prog)
+		{
+			// Page program data, wraps within the page
+			vpPage[(vAddr + vPageLen) % vPageSize] &= pData[i];
+			vPageLen++;
+			continue;
+		}
+
+		if (vCmdLen < NORFLASHSIM_CMD_MAX)
+			vCmd[vCmdLen++] = pData[i];
+
+		// SFDP is always addressed with 3 bytes
+		int alen = vCmd[0] == FLASH_CMD_READ_SFDP ? 3 : vAddrSize;
+
+		if (vCmdLen == alen + 1)
+		{
+			vAddr = 0;
+			for (int j = 1; j <= alen; j++)
+				vAddr = (vAddr << 8) | vCmd[j];
+			if (vCmd[0] != FLASH_CMD_READ_SFDP)
+				vAddr %= vSize;
+
+			if (vCmd[0] == FLASH_CMD_WRITE || vCmd[0] == FLASH_CMD_QUAD_WRITE)
+			{
+				memset(vpPage, 0xff, vPageSize);
+				vPageLen = 0;
+			}
+		}
+	}
+
+	return DataLen;
+}
+
+int NorFlashSim::RxData(uint8_t *pBuff, int BuffLen)
+{
+	if (vbPowerLost || vCmdLen < 1)
+	{
+		// Bus reads low, status polling does not hang
+		memset(pBuff, 0, BuffLen);
+		return 0;
+	}
+
+	Clock(BuffLen);
+
+	if (vbLineErr || vLines != DataLines(vCmd[0]))
+	{
+		vLineErr++;
+		memset(pBuff, 0xff, BuffLen);
+		return BuffLen;
+	}
+
+	if (Accepted() == false)
+	{
+		memset(pBuff, 0xff, BuffLen);
+		return BuffLen;
+	}
+
+	switch (vCmd[0])
+	{
+		case FLASH_CMD_READSTATUS:
+			vStatusCnt++;
+			memset(pBuff, (vbWel ? 2 : 0) | (Busy() ? FLASH_STATUS_WIP : 0), BuffLen);
+			break;
+		case FLASH_CMD_READID:
+			for (int i = 0; i < BuffLen; i++)
+				pBuff[i] = i == 0 ? 0xC2 : i == 1 ? 0x20 : 0x18;
+			break;
+		case FLASH_CMD_READ:
+		case FLASH_CMD_FAST_READ:
+		case FLASH_CMD_DUAL_READ:
+		case FLASH_CMD_DUAL_IO_READ:
+		case FLASH_CMD_QUAD_READ:
+		case FLASH_CMD_QUAD_IO_READ:
+			// Exact number of dummy bytes needed
+			if (vCmdLen != vAddrSize + 1 + DummyBytes(vCmd[0]))
+			{
+				memset(pBuff, 0xff, BuffLen);
+				break;
+			}
+			for (int i = 0; i < BuffLen; i++)
+			{
+				pBuff[i] = vpMem[vAddr];
+				vAddr = (vAddr + 1) % vSize;
+			}
+			break;
+		case FLASH_CMD_READ_SFDP:
+			for (int i = 0; i < BuffLen; i++)
+			{
+				pBuff[i] = vCmdLen == 5 && vAddr < vSfdpLen ? vpSfdp[vAddr] : 0xff;
+				vAddr++;
+			}
+			break;
+		default:
+			memset(pBuff, 0xff, BuffLen);
+	}
+
+	return BuffLen;
+}
+
+void NorFlashSim::StopRx(void)
+{
+	if (vCmdLen > 0)
+		vCmdCnt[vCmd[0]]++;
+	vCmdLen = 0;
+}
+
+void NorFlashSim::StopTx(void)
+{
+	if (vCmdLen > 0)
+		vCmdCnt[vCmd[0]]++;
+
+	if (vbPowerLost || vCmdLen < 1)
+	{
+		vCmdLen = 0;
+		return;
+	}
+
+	if (vbLineErr)
+	{
+		vLineErr++;
+		vCmdLen = 0;
+		return;
+	}
+
+	if (Accepted() == false)
+	{
+		vCmdLen = 0;
+		return;
+	}
+
+	switch (vCmd[0])
+	{
+		case FLASH_CMD_WRENABLE:
+			vbWel = true;
+			break;
+		case FLASH_CMD_WRDISABLE:
+			vbWel = false;
+			break;
+		case FLASH_CMD_EN4B:
+			vAddrSize = 4;
+			break;
+		case FLASH_CMD_EX4B:
+			vAddrSize = vAddrSizeDef;
+			break;
+		case FLASH_CMD_WRITE:
+		case FLASH_CMD_QUAD_WRITE:
+			if (vbWel && vCmdLen > vAddrSize)
+			{
+				Program();
+				SetBusy(vpTiming ? vpTiming->ProgTime : 0, false);
+			}
+			vbWel = false;
+			break;
+		case FLASH_CMD_SECTOR_ERASE:
+		case FLASH_CMD_BLOCK_ERASE_32:
+		case FLASH_CMD_BLOCK_ERASE:
+			if (vbWel && vCmdLen > vAddrSize)
+			{
+				uint32_t sz = vCmd[0] == FLASH_CMD_SECTOR_ERASE ? 0x1000 :
+							  vCmd[0] == FLASH_CMD_BLOCK_ERASE_32 ? 0x8000 : vBlkSize;
+
+				vEraseAddr = vAddr & ~(sz - 1);
+				vEraseLen = sz;
+				EraseRange(vEraseAddr, sz);
+				if (vpTiming)
+					SetBusy(vCmd[0] == FLASH_CMD_SECTOR_ERASE ? vpTiming->SectEraseTime :
+							vCmd[0] == FLASH_CMD_BLOCK_ERASE_32 ? vpTiming->Blk32EraseTime :
+							vpTiming->BlkEraseTime, true);
+			}
+			vbWel = false;
+			break;
+		case FLASH_CMD_BULK_ERASE:
+		case FLASH_CMD_BULK_ERASE_ALT:
+			if (vbWel)
+			{
+				EraseRange(0, vSize);
+				if (vpTiming)
+					SetBusy(vpTiming->ChipEraseTime * 1000, false);
+			}
+			vbWel = false;
+			break;
+		case FLASH_CMD_ERASE_SUSPEND:
+			// Takes effect once the erase made enough progress since start or
+			// last resume
+			if (vpTiming && Busy() && vbEraseOp && vbSuspended == false)
+			{
+				uint64_t t = vTime > vResumeEnd ? vTime : vResumeEnd;
+
+				if (t < vBusyEnd)
+				{
+					vRemain = vBusyEnd - t;
+					vBusyEnd = t + (uint64_t)vpTiming->SuspendTime * 1000000;
+					vbSuspended = true;
+					vSuspendCnt++;
+				}
+			}
+			break;
+		case FLASH_CMD_ERASE_RESUME:
+			if (vbSuspended)
+			{
+				vBusyEnd = vTime + vRemain;
+				vResumeEnd = vTime + (uint64_t)vpTiming->ResumeTime * 1000000;
+				vbEraseOp = true;
+				vbSuspended = false;
+			}
+			break;
+	}
+
+	vCmdLen = 0;
+}
+
+void NorFlashSim::Program()
+{
+	uint32_t base = vAddr - (vAddr % vPageSize);
+	uint32_t len = vPageLen < vPageSize ? vPageLen : vPageSize;
+	uint32_t start = vPageLen < vPageSize ? vAddr % vPageSize : 0;
+
+	vProgOps++;
+
+	if (CutNow())
+	{
+		// Only part of the bytes made it, last one partially
+		len = Random() % (len + 1);
+		if (len < vPageSize)
+		{
+			uint32_t off = (start + len) % vPageSize;
+			vpMem[base + off] &= vpPage[off] | Random();
+		}
+	}
+
+	for (uint32_t i = 0; i < len; i++)
+	{
+		uint32_t off = (start + i) % vPageSize;
+		uint8_t *p = &vpMem[base + off];
+
+		if ((*p & vpPage[off]) != vpPage[off])
+			vProgErr++;
+
+		*p &= vpPage[off];
+	}
+
+	vProgBytes += len;
+}
+
+void NorFlashSim::EraseRange(uint32_t Addr, uint32_t Len)
+{
+	vEraseOps++;
+
+	for (uint32_t i = Addr / NORFLASHSIM_SECT_SIZE; i < (Addr + Len) / NORFLASHSIM_SECT_SIZE; i++)
+	{
+		vpEraseCnt[i]++;
+	}
+
+	if (CutNow())
+	{
+		// Interrupted erase leaves a mix of erased and old bytes
+		for (uint32_t i = 0; i < Len; i++)
+		{
+			if (Random() & 1)
+				vpMem[Addr + i] = 0xff;
+		}
+	}
+	else
+	{
+		memset(&vpMem[Addr], 0xff, Len);
+	}
+}
+
+int NorFlashSim::Rx(int DevAddr, uint8_t *pBuff, int BuffLen)
+{
+	StartRx(DevAddr);
+	int l = RxData(pBuff, BuffLen);
+	StopRx();
+
+	return l;
+}
+
+int NorFlashSim::Tx(int DevAddr, uint8_t *pData, int DataLen)
+{
+	StartTx(DevAddr);
+	int l = TxData(pData, DataLen);
+	StopTx();
+
+	return l;
+}
+
+int NorFlashSim::Read(int DevAddr, uint8_t *pAdCmd, int AdCmdLen, uint8_t *pBuff, int BuffLen)
+{
+	StartRx(DevAddr);
+	TxData(pAdCmd, AdCmdLen);
+	int l = RxData(pBuff, BuffLen);
+	StopRx();
+
+	return l;
+}
+
+int NorFlashSim::Write(int DevAddr, uint8_t *pAdCmd, int AdCmdLen, uint8_t *pData, int DataLen)
+{
+	StartTx(DevAddr);
+	TxData(pAdCmd, AdCmdLen);
+	int l = TxData(pData, DataLen);
+	StopTx();
+
+	return l;
+}
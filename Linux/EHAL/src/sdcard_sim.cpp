@@ -0,0 +1,686 @@
+/**-------------------------------------------------------------------------
+@file	sdcard_sim.cpp
+
+@brief	SD card SPI mode simulator for Linux hosts
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "sdcard_sim.h"
+
+/// Write data reception state
+typedef enum {
+	SDCARDSIM_WR_NONE,
+	SDCARDSIM_WR_TOKEN,			//!< Waiting for start or stop token
+	SDCARDSIM_WR_DATA			//!< Receiving data and CRC
+} SDCARDSIM_WR;
+
+// Card side CRCs, computed bit by bit independently from crc.c
+static uint8_t SdSimCrc7(const uint8_t *pData, int Len)
+{
+	uint8_t crc = 0;
+
+	for (int i = 0; i < Len; i++)
+	{
+		for (int b = 7; b >= 0; b--)
+		{
+			int f = ((crc >> 6) ^ (pData[i] >> b)) & 1;
+
+			crc = (crc << 1) & 0x7f;
+			if (f)
+				crc ^= 0x09;
+		}
+	}
+
+	return crc;
+}
+
+static uint16_t SdSimCrc16(const uint8_t *pData, int Len)
+{
+	uint16_t crc = 0;
+
+	for (int i = 0; i < Len; i++)
+	{
+		crc ^= (uint16_t)pData[i] << 8;
+		for (int b = 0; b < 8; b++)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+
+	return crc;
+}
+
+// C interface, for the C SD functions
+static void SdSimDisable(DEVINTRF * const pDev)
+{
+	(void)pDev;
+}
+
+static void SdSimEnable(DEVINTRF * const pDev)
+{
+	(void)pDev;
+}
+
+static int SdSimGetRate(DEVINTRF * const pDev)
+{
+	return ((SdCardSim*)pDev->pDevData)->Rate();
+}
+
+static int SdSimSetRate(DEVINTRF * const pDev, int Rate)
+{
+	return ((SdCardSim*)pDev->pDevData)->Rate(Rate);
+}
+
+static bool SdSimStartRx(DEVINTRF * const pDev, int DevAddr)
+{
+	return ((SdCardSim*)pDev->pDevData)->StartRx(DevAddr);
+}
+
+static int SdSimRxData(DEVINTRF * const pDev, uint8_t *pBuff, int BuffLen)
+{
+	return ((SdCardSim*)pDev->pDevData)->RxData(pBuff, BuffLen);
+}
+
+static void SdSimStopRx(DEVINTRF * const pDev)
+{
+	((SdCardSim*)pDev->pDevData)->StopRx();
+}
+
+static bool SdSimStartTx(DEVINTRF * const pDev, int DevAddr)
+{
+	return ((SdCardSim*)pDev->pDevData)->StartTx(DevAddr);
+}
+
+static int SdSimTxData(DEVINTRF * const pDev, uint8_t *pData, int DataLen)
+{
+	return ((SdCardSim*)pDev->pDevData)->TxData(pData, DataLen);
+}
+
+static void SdSimStopTx(DEVINTRF * const pDev)
+{
+	((SdCardSim*)pDev->pDevData)->StopTx();
+}
+
+static void SdSimReset(DEVINTRF * const pDev)
+{
+	(void)pDev;
+}
+
+static void SdSimPowerOff(DEVINTRF * const pDev)
+{
+	(void)pDev;
+}
+
+SdCardSim::SdCardSim()
+{
+	memset(&vDevIntrf, 0, sizeof(vDevIntrf));
+	vDevIntrf.pDevData = this;
+	vDevIntrf.Type = DEVINTRF_TYPE_SPI;
+	vDevIntrf.Disable = SdSimDisable;
+	vDevIntrf.Enable = SdSimEnable;
+	vDevIntrf.GetRate = SdSimGetRate;
+	vDevIntrf.SetRate = SdSimSetRate;
+	vDevIntrf.StartRx = SdSimStartRx;
+	vDevIntrf.RxData = SdSimRxData;
+	vDevIntrf.StopRx = SdSimStopRx;
+	vDevIntrf.StartTx = SdSimStartTx;
+	vDevIntrf.TxData = SdSimTxData;
+	vDevIntrf.StopTx = SdSimStopTx;
+	vDevIntrf.Reset = SdSimReset;
+	vDevIntrf.PowerOff = SdSimPowerOff;
+	vRate = 0;
+	vpMem = NULL;
+	vNbBlk = 0;
+	vpTiming = NULL;
+	vTime = 0;
+	vBusyEnd = 0;
+	vMaxBusy = 0;
+	vbIdle = true;
+	vbAppCmd = false;
+	vbCrcOn = false;
+	vInitPolls = 0;
+	vCmdLen = 0;
+	vRespLen = 0;
+	vRespIdx = 0;
+	vBlkLen = 0;
+	vBlkIdx = 0;
+	vBlkReady = 0;
+	vbReading = false;
+	vWrState = SDCARDSIM_WR_NONE;
+	vbMultiWr = false;
+	vAddr = 0;
+	vPreErase = 0;
+	vGcDebt = 0;
+	vCmdCnt = 0;
+	vXferCnt = 0;
+	vByteCnt = 0;
+	vRdBlkCnt = 0;
+	vWrBlkCnt = 0;
+	vPreErasedCnt = 0;
+	vGcCnt = 0;
+	vCrcErr = 0;
+	vProtoErr = 0;
+	vSpikeRate = 0;
+	vSpikeMax = 0;
+	vSpikeCnt = 0;
+	vRandState = 1;
+}
+
+SdCardSim::~SdCardSim()
+{
+	delete[] vpMem;
+}
+
+bool SdCardSim::Init(const SDCARDSIM_CFG &Cfg)
+{
+	if (Cfg.NbBlk < 1024 || (Cfg.NbBlk & 0x3FF) || Cfg.NbBlk > 0x400000 ||
+		(Cfg.pTiming && Cfg.pTiming->ClkRate == 0))
+		return false;
+
+	delete[] vpMem;
+
+	vNbBlk = Cfg.NbBlk;
+	vpTiming = Cfg.pTiming;
+	vpMem = new uint8_t[(size_t)vNbBlk * SDCARDSIM_BLK_SIZE];
+
+	memset(vpMem, 0, (size_t)vNbBlk * SDCARDSIM_BLK_SIZE);
+
+	vTime = 0;
+	vBusyEnd = 0;
+	vMaxBusy = 0;
+	vbIdle = true;
+	vbAppCmd = false;
+	vbCrcOn = false;
+	vInitPolls = 0;
+	vCmdLen = 0;
+	vRespLen = 0;
+	vRespIdx = 0;
+	vBlkLen = 0;
+	vBlkIdx = 0;
+	vbReading = false;
+	vWrState = SDCARDSIM_WR_NONE;
+	vbMultiWr = false;
+	vPreErase = 0;
+	vGcDebt = 0;
+	vCmdCnt = 0;
+	vXferCnt = 0;
+	vByteCnt = 0;
+	vRdBlkCnt = 0;
+	vWrBlkCnt = 0;
+	vPreErasedCnt = 0;
+	vGcCnt = 0;
+	vCrcErr = 0;
+	vProtoErr = 0;
+	vSpikeCnt = 0;
+
+	return true;
+}
+
+// xorshift32
+uint32_t SdCardSim::Random()
+{
+	vRandState ^= vRandState << 13;
+	vRandState ^= vRandState >> 17;
+	vRandState ^= vRandState << 5;
+
+	return vRandState;
+}
+
+// Extra delay of a block in usec
+uint32_t SdCardSim::Spike()
+{
+	if (vpTiming == NULL || vSpikeRate == 0 || Random() % vSpikeRate != 0)
+		return 0;
+
+	vSpikeCnt++;
+
+	return Random() % (vSpikeMax + 1);
+}
+
+bool SdCardSim::StartRx(int DevAddr)
+{
+	(void)DevAddr;
+
+	vXferCnt++;
+	if (vpTiming)
+		vTime += (uint64_t)vpTiming->CsTime * 1000;
+
+	return true;
+}
+
+bool SdCardSim::StartTx(int DevAddr)
+{
+	(void)DevAddr;
+
+	vXferCnt++;
+	if (vpTiming)
+		vTime += (uint64_t)vpTiming->CsTime * 1000;
+
+	return true;
+}
+
+void SdCardSim::StopRx(void)
+{
+}
+
+void SdCardSim::StopTx(void)
+{
+}
+
+// Host sends 0xff while receiving
+int SdCardSim::RxData(uint8_t *pBuff, int BuffLen)
+{
+	for (int i = 0; i < BuffLen; i++)
+	{
+		pBuff[i] = Clock();
+		Receive(0xff);
+	}
+
+	return BuffLen;
+}
+
+// Card output clocked while transmitting is lost
+int SdCardSim::TxData(uint8_t *pData, int DataLen)
+{
+	for (int i = 0; i < DataLen; i++)
+	{
+		Clock();
+		Receive(pData[i]);
+	}
+
+	return DataLen;
+}
+
+/**
+ * Clock one byte on the bus
+ *
+ * @return	Card output : response, data once the access time elapsed, 0 while
+ * 			busy, 0xff otherwise
+ */
+uint8_t SdCardSim::Clock()
+{
+	vByteCnt++;
+	if (vpTiming)
+		vTime += 8 * (1000000000000ULL / vpTiming->ClkRate);
+
+	if (vRespIdx < vRespLen)
+	{
+		return vResp[vRespIdx++];
+	}
+
+	if (vBlkIdx < vBlkLen)
+	{
+		if (vTime < vBlkReady)
+			return 0xff;
+
+		uint8_t d = vBlk[vBlkIdx++];
+
+		if (vBlkIdx >= vBlkLen && vbReading)
+		{
+			// Next block of CMD18, ends at end of card
+			if (vAddr < vNbBlk)
+			{
+				QueueBlock(vpMem + (size_t)vAddr * SDCARDSIM_BLK_SIZE, SDCARDSIM_BLK_SIZE,
+						   vpTiming ? vpTiming->ReadMultiTime + Spike() : 0);
+				vAddr++;
+				vRdBlkCnt++;
+			}
+			else
+			{
+				vbReading = false;
+			}
+		}
+
+		return d;
+	}
+
+	return vTime < vBusyEnd ? 0 : 0xff;
+}
+
+void SdCardSim::Receive(uint8_t Data)
+{
+	if (vWrState == SDCARDSIM_WR_DATA)
+	{
+		vBlk[vBlkIdx++] = Data;
+		if (vBlkIdx >= SDCARDSIM_BLK_SIZE + 2)
+		{
+			vBlkIdx = 0;
+			Program();
+		}
+		return;
+	}
+
+	if (vCmdLen > 0 || (Data & 0xc0) == 0x40)
+	{
+		vCmd[vCmdLen++] = Data;
+		if (vCmdLen >= 6)
+		{
+			Command();
+			vCmdLen = 0;
+		}
+		return;
+	}
+
+	if (vWrState != SDCARDSIM_WR_TOKEN || Data == 0xff)
+		return;
+
+	if (Busy())
+	{
+		// Token must wait for end of previous block
+		vProtoErr++;
+		return;
+	}
+
+	if (Data == (vbMultiWr ? 0xfc : 0xfe))
+	{
+		vWrState = SDCARDSIM_WR_DATA;
+		vBlkIdx = 0;
+		vBlkLen = 0;
+	}
+	else if (Data == 0xfd && vbMultiWr)
+	{
+		// Stop transmission, one byte then busy
+		vbMultiWr = false;
+		vWrState = SDCARDSIM_WR_NONE;
+		vPreErase = 0;
+		vRespLen = vRespIdx = 0;
+		QueueResp(0xff);
+		vBusyEnd = vTime + Psec(vpTiming ? vpTiming->StopTime : 0);
+	}
+	else
+	{
+		vProtoErr++;
+	}
+}
+
+void SdCardSim::QueueResp(uint8_t Data)
+{
+	if (vRespLen < SDCARDSIM_RESP_MAX)
+		vResp[vRespLen++] = Data;
+}
+
+// R1 after one byte of command response time
+void SdCardSim::Respond(uint8_t R1)
+{
+	vRespLen = vRespIdx = 0;
+	QueueResp(0xff);
+	QueueResp(R1 | (vbIdle ? 1 : 0));
+}
+
+// Data token, data and CRC sent once the access time elapsed
+void SdCardSim::QueueBlock(const uint8_t *pData, int Len, uint32_t usTime)
+{
+	uint16_t crc = SdSimCrc16(pData, Len);
+
+	vBlk[0] = 0xfe;
+	memcpy(&vBlk[1], pData, Len);
+	vBlk[Len + 1] = crc >> 8;
+	vBlk[Len + 2] = crc & 0xff;
+	vBlkLen = Len + 3;
+	vBlkIdx = 0;
+	vBlkReady = vTime + Psec(usTime);
+}
+
+void SdCardSim::Command()
+{
+	uint8_t cmd = vCmd[0] & 0x3f;
+	uint32_t arg = ((uint32_t)vCmd[1] << 24) | ((uint32_t)vCmd[2] << 16) | ((uint32_t)vCmd[3] << 8) | vCmd[4];
+	bool app = vbAppCmd;
+
+	vCmdCnt++;
+	vbAppCmd = false;
+
+	if (Busy())
+	{
+		// Command not seen while busy
+		vProtoErr++;
+		return;
+	}
+
+	if (vbMultiWr || (vbReading && cmd != 12))
+	{
+		// CMD25 not terminated by stop token or CMD18 not by CMD12
+		vProtoErr++;
+	}
+	vbMultiWr = false;
+	vWrState = SDCARDSIM_WR_NONE;
+
+	if ((vbCrcOn || cmd == 0 || cmd == 8) && ((SdSimCrc7(vCmd, 5) << 1) | 1) != vCmd[5])
+	{
+		vCrcErr++;
+		Respond(0x08);
+		return;
+	}
+
+	if (app && (cmd == 41 || cmd == 23))
+	{
+		if (cmd == 41)
+		{
+			if (++vInitPolls > SDCARDSIM_INIT_POLLS)
+				vbIdle = false;
+		}
+		else
+		{
+			// SET_WR_BLK_ERASE_COUNT, applies to the next CMD25
+			vPreErase = arg & 0x7fffff;
+		}
+		Respond(0);
+		return;
+	}
+
+	if (vbIdle && cmd != 0 && cmd != 1 && cmd != 8 && cmd != 55 && cmd != 58 && cmd != 59)
+	{
+		Respond(0x04);
+		return;
+	}
+
+	switch (cmd)
+	{
+		case 0:
+			vbIdle = true;
+			vInitPolls = 0;
+			vbCrcOn = false;
+			vbReading = false;
+			vBlkLen = 0;
+			vPreErase = 0;
+			Respond(0);
+			break;
+		case 1:
+			if (++vInitPolls > SDCARDSIM_INIT_POLLS)
+				vbIdle = false;
+			Respond(0);
+			break;
+		case 8:
+			// R7, voltage accepted and check pattern echoed
+			Respond(0);
+			QueueResp(0);
+			QueueResp(0);
+			QueueResp((arg >> 8) & 0xf);
+			QueueResp(arg & 0xff);
+			break;
+		case 9:
+			{
+				// CSD version 2.0
+				uint8_t csd[16] = { 0x40, 0x0e, 0x00, 0x32, 0x5b, 0x59, 0x00, 0, 0, 0, 0x7f, 0x80, 0x0a, 0x40, 0x00, 0 };
+				uint32_t csize = vNbBlk / 1024 - 1;
+
+				csd[7] = (csize >> 16) & 0x3f;
+				csd[8] = (csize >> 8) & 0xff;
+				csd[9] = csize & 0xff;
+				csd[15] = (SdSimCrc7(csd, 15) << 1) | 1;
+				Respond(0);
+				QueueBlock(csd, 16, 0);
+			}
+			break;
+		case 10:
+			{
+				uint8_t cid[16] = { 0x49, 'I', 'S', 'S', 'D', 'S', 'I', 'M', 0x10, 0, 0, 0, 1, 0x01, 0xa9, 0 };
+
+				cid[15] = (SdSimCrc7(cid, 15) << 1) | 1;
+				Respond(0);
+				QueueBlock(cid, 16, 0);
+			}
+			break;
+		case 12:
+			{
+				// Stuff byte is whatever the card was sending
+				uint8_t stuff = vBlkIdx < vBlkLen && vTime >= vBlkReady ? vBlk[vBlkIdx] : 0xff;
+
+				if (vbReading == false)
+				{
+					Respond(0x04);
+					break;
+				}
+				vbReading = false;
+				vBlkLen = 0;
+				vRespLen = vRespIdx = 0;
+				QueueResp(stuff);
+				QueueResp(0xff);
+				QueueResp(0);
+			}
+			break;
+		case 13:
+			// R2
+			Respond(0);
+			QueueResp(0);
+			break;
+		case 16:
+			Respond(arg == SDCARDSIM_BLK_SIZE ? 0 : 0x40);
+			break;
+		case 17:
+		case 18:
+			if (arg >= vNbBlk)
+			{
+				Respond(0x40);
+				break;
+			}
+			Respond(0);
+			QueueBlock(vpMem + (size_t)arg * SDCARDSIM_BLK_SIZE, SDCARDSIM_BLK_SIZE,
+					   vpTiming ? vpTiming->ReadTime + Spike() : 0);
+			vAddr = arg + 1;
+			vbReading = cmd == 18;
+			vRdBlkCnt++;
+			break;
+		case 24:
+		case 25:
+			if (arg >= vNbBlk)
+			{
+				Respond(0x40);
+				break;
+			}
+			Respond(0);
+			vAddr = arg;
+			vbMultiWr = cmd == 25;
+			vWrState = SDCARDSIM_WR_TOKEN;
+			break;
+		case 55:
+			vbAppCmd = true;
+			Respond(0);
+			break;
+		case 58:
+			// R3, OCR with power up done and CCS once initialized
+			Respond(0);
+			QueueResp(vbIdle ? 0x00 : 0xc0);
+			QueueResp(0xff);
+			QueueResp(0x80);
+			QueueResp(0x00);
+			break;
+		case 59:
+			vbCrcOn = arg & 1;
+			Respond(0);
+			break;
+		default:
+			Respond(0x04);
+	}
+}
+
+// Block received, data response then busy for the program time
+void SdCardSim::Program()
+{
+	uint16_t crc = ((uint16_t)vBlk[SDCARDSIM_BLK_SIZE] << 8) | vBlk[SDCARDSIM_BLK_SIZE + 1];
+
+	vWrState = vbMultiWr ? SDCARDSIM_WR_TOKEN : SDCARDSIM_WR_NONE;
+	vRespLen = vRespIdx = 0;
+
+	if (vbCrcOn && SdSimCrc16(vBlk, SDCARDSIM_BLK_SIZE) != crc)
+	{
+		vCrcErr++;
+		QueueResp(0x0b);
+		return;
+	}
+
+	if (vAddr >= vNbBlk)
+	{
+		QueueResp(0x0d);
+		return;
+	}
+
+	memcpy(vpMem + (size_t)vAddr * SDCARDSIM_BLK_SIZE, vBlk, SDCARDSIM_BLK_SIZE);
+	vAddr++;
+	vWrBlkCnt++;
+	QueueResp(0x05);
+
+	if (vpTiming == NULL)
+		return;
+
+	uint32_t t = vpTiming->ProgTime;
+	uint32_t debt = SDCARDSIM_GC_SINGLE;
+
+	if (vbMultiWr && vPreErase > 0)
+	{
+		t = vpTiming->ProgPreErasedTime;
+		debt = SDCARDSIM_GC_PREERASED;
+		vPreErase--;
+		vPreErasedCnt++;
+	}
+	else if (vbMultiWr)
+	{
+		t = vpTiming->ProgMultiTime;
+		debt = SDCARDSIM_GC_MULTI;
+	}
+
+	if (vpTiming->GcDebt > 0)
+	{
+		vGcDebt += debt;
+		if (vGcDebt >= vpTiming->GcDebt)
+		{
+			vGcDebt -= vpTiming->GcDebt;
+			t += vpTiming->GcTime;
+			vGcCnt++;
+		}
+	}
+
+	t += Spike();
+
+	// Busy starts after the data response byte
+	uint64_t busy = 8 * (1000000000000ULL / vpTiming->ClkRate) + Psec(t);
+
+	vBusyEnd = vTime + busy;
+	if (busy > vMaxBusy)
+		vMaxBusy = busy;
+}
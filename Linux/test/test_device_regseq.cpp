@@ -0,0 +1,216 @@
+/**-------------------------------------------------------------------------
+@file	test_device_regseq.cpp
+
+@brief	Register sequence executor test
+
+Runs register sequences on a mock interface and checks write merging in single,
+burst and pair modes, update, read, poll with timeout, and timer driven runs.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <string.h>
+
+#include "device_regseq.h"
+#include "test_intrf.h"
+#include "test_timer.h"
+#include "test_util.h"
+
+#define REG_STATUS			0x10
+#define REG_STATUS_BUSY		(1<<0)
+#define REG_CTRL			0x11
+#define REG_CTRL_RESET		(1<<7)
+
+// Reset takes a number of status reads to complete
+class SeqIntrf : public TestIntrf {
+public:
+	SeqIntrf() : BusyReads(0) {}
+
+	int BusyReads;			//!< Status reads before busy clears, -1 - never
+
+protected:
+	void OnRead(uint8_t RegAddr) {
+		if (RegAddr == REG_STATUS && BusyReads >= 0 && --BusyReads < 0)
+		{
+			Reg[REG_STATUS] &= ~REG_STATUS_BUSY;
+		}
+	}
+	void OnWrite(uint8_t RegAddr) {
+		if (RegAddr == REG_CTRL && (Reg[REG_CTRL] & REG_CTRL_RESET))
+		{
+			Reg[REG_CTRL] = 0;
+			Reg[REG_STATUS] |= REG_STATUS_BUSY;
+		}
+	}
+};
+
+class TestDev : public Device {
+public:
+	TestDev(DeviceIntrf *pIntrf) { Interface(pIntrf); vDevAddr = 0x20; vbValid = true; }
+	bool Enable() { return true; }
+	void Disable() {}
+	void Reset() {}
+};
+
+static const DEVREGSEQ s_Seq[] = {
+	DEVREGSEQ_WRITE(0x20, 1),		// Burst
+	DEVREGSEQ_WRITE(0x21, 2),
+	DEVREGSEQ_WRITE(0x22, 3),
+	DEVREGSEQ_WRITE(0x40, 4),		// Pair with previous
+	DEVREGSEQ_UPDATE(0x30, 0x0F, 0x05),
+	DEVREGSEQ_READ(0x50, 4, 2),
+	DEVREGSEQ_END()
+};
+
+static void CheckSeqResult(SeqIntrf &Intrf, uint8_t *pRdBuff)
+{
+	TEST_CHECK(Intrf.Reg[0x20] == 1 && Intrf.Reg[0x21] == 2 && Intrf.Reg[0x22] == 3);
+	TEST_CHECK(Intrf.Reg[0x40] == 4);
+	TEST_CHECK(Intrf.Reg[0x30] == 0xA5);
+	TEST_CHECK(memcmp(&pRdBuff[2], &Intrf.Reg[0x50], 4) == 0);
+}
+
+static int RunMode(DEVREGSEQ_WRMODE Mode)
+{
+	SeqIntrf intrf;
+	TestDev dev(&intrf);
+	DevRegSeq seq;
+	DEVREGSEQ_CFG cfg = { 1, Mode, 0xFF, 0, 0 };
+	uint8_t buf[8];
+
+	intrf.bPairWrite = Mode == DEVREGSEQ_WRMODE_PAIR;
+	intrf.Reg[0x30] = 0xAA;
+	for (int i = 0; i < 4; i++)
+	{
+		intrf.Reg[0x50 + i] = 0x60 + i;
+	}
+
+	TEST_CHECK(seq.Init(cfg, &dev));
+	TEST_CHECK(seq.Run(s_Seq, buf));
+	CheckSeqResult(intrf, buf);
+
+	return intrf.NbXfer();
+}
+
+static void TestMerge()
+{
+	// 4 writes, update is a read and a write, 1 read
+	TEST_CHECK(RunMode(DEVREGSEQ_WRMODE_SINGLE) == 7);
+	TEST_CHECK(RunMode(DEVREGSEQ_WRMODE_BURST) == 5);
+	TEST_CHECK(RunMode(DEVREGSEQ_WRMODE_PAIR) == 4);
+}
+
+static const DEVREGSEQ s_ResetSeq[] = {
+	DEVREGSEQ_WRITE(REG_CTRL, REG_CTRL_RESET),
+	DEVREGSEQ_POLL(REG_STATUS, REG_STATUS_BUSY, 0, 10000),
+	DEVREGSEQ_DELAY(5000),
+	DEVREGSEQ_WRITE(0x20, 0x55),
+	DEVREGSEQ_END()
+};
+
+static void TestPoll()
+{
+	SeqIntrf intrf;
+	TestDev dev(&intrf);
+	DevRegSeq seq;
+	DEVREGSEQ_CFG cfg = { 1, DEVREGSEQ_WRMODE_BURST, 0xFF, 1000, 0 };
+
+	TEST_CHECK(seq.Init(cfg, &dev));
+
+	intrf.BusyReads = 3;
+	TEST_CHECK(seq.Run(s_ResetSeq));
+	TEST_CHECK(intrf.Reg[0x20] == 0x55);
+
+	// Timeout after 10 ms of 1 ms polls, next operation not executed
+	intrf.BusyReads = -1;
+	intrf.Reg[0x20] = 0;
+	intrf.ClearCount();
+	TEST_CHECK(seq.Run(s_ResetSeq) == false);
+	TEST_CHECK(intrf.Reg[0x20] == 0);
+	TEST_CHECK(intrf.NbRead == 11);
+	TEST_CHECK(seq.Busy() == false);
+}
+
+static int s_DoneCnt;
+static bool s_bDoneSuccess;
+
+static void SeqDone(DevRegSeq * const pSeq, bool bSuccess, void * const pCtx)
+{
+	(void)pSeq;
+	s_DoneCnt++;
+	s_bDoneSuccess = bSuccess;
+	*(uint64_t*)pCtx = 0;
+}
+
+static void TestTimerRun()
+{
+	SeqIntrf intrf;
+	TestDev dev(&intrf);
+	TestTimer timer;
+	DevRegSeq seq;
+	DEVREGSEQ_CFG cfg = { 1, DEVREGSEQ_WRMODE_BURST, 0xFF, 1000, 2 };
+	uint64_t ctx = 1;
+
+	TEST_CHECK(seq.Init(cfg, &dev));
+
+	// Busy seen by 4 polls 1 ms apart, then 5 ms delay, done 9 ms after start
+	intrf.BusyReads = 3;
+	s_DoneCnt = 0;
+	TEST_CHECK(seq.Start(s_ResetSeq, NULL, &timer, SeqDone, &ctx));
+	TEST_CHECK(seq.Busy() && timer.TriggerPending(2));
+	timer.Advance(8500);
+	TEST_CHECK(s_DoneCnt == 0 && intrf.Reg[0x20] == 0);
+	timer.Advance(1000);
+	TEST_CHECK(s_DoneCnt == 1 && s_bDoneSuccess && ctx == 0);
+	TEST_CHECK(intrf.Reg[0x20] == 0x55);
+	TEST_CHECK(seq.Busy() == false && timer.TriggerPending(2) == false);
+
+	// Poll timeout reported through the callback
+	intrf.BusyReads = -1;
+	TEST_CHECK(seq.Start(s_ResetSeq, NULL, &timer, SeqDone, &ctx));
+	timer.Advance(20000);
+	TEST_CHECK(s_DoneCnt == 2 && s_bDoneSuccess == false);
+
+	// Abort stops the sequence without callback
+	TEST_CHECK(seq.Start(s_ResetSeq, NULL, &timer, SeqDone, &ctx));
+	seq.Abort();
+	TEST_CHECK(timer.TriggerPending(2) == false);
+	timer.Advance(20000);
+	TEST_CHECK(s_DoneCnt == 2 && seq.Busy() == false);
+}
+
+int main()
+{
+	TestMerge();
+	TestPoll();
+	TestTimerRun();
+
+	printf("device_regseq : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
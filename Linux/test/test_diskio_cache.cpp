@@ -0,0 +1,846 @@
+/**-------------------------------------------------------------------------
+@file	test_diskio_cache.cpp
+
+@brief	DiskIO sector cache benchmark
+
+Replays FAT16 style access traces (directory scans, small data reads, FAT chain
+lookups, file rewrites) through the DiskIO sector cache and through reference
+models of fully associative LRU, CLOCK-Pro and the former round robin cache.
+Reports overall and metadata hit rates and the lookup cost per cache size, and
+checks the set associative LRU cache is within a few points of LRU and
+CLOCK-Pro on metadata.  Also checks sector pinning, counts device commands
+with and without the stream buffer (read ahead and write back coalescing),
+and checks data coherency with Flush writing in increasing sector order.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "diskio.h"
+#include "test_util.h"
+
+// FAT16 layout : FAT at 8, root directory at 264 (32 sectors), data at 296, 4 sectors per cluster
+#define FAT_SECT		8
+#define ROOT_SECT		264
+#define DATA_SECT		296
+#define DISK_NBSECT		65536
+
+#define STRM_NBSECT		8			// Stream buffer size
+#define STRM_DISK_NBSECT	4096		// Disk area used by the stream buffer tests
+
+// Max metadata hit rate loss of the set associative cache vs the references, in percent
+#define META_HIT_TOL	3.0
+
+// RAM disk counting physical accesses
+class RamDisk : public DiskIO {
+public:
+	RamDisk() : NbRead(0), NbWrite(0), NbMetaRead(0), NbReadCmd(0), NbWriteCmd(0) {
+		vpMem = (uint8_t*)calloc(DISK_NBSECT, DISKIO_SECT_SIZE);
+	}
+	virtual ~RamDisk() { free(vpMem); }
+
+	uint64_t GetSize() { return (uint64_t)DISK_NBSECT * DISKIO_SECT_SIZE; }
+
+	bool SectRead(uint32_t SectNo, uint8_t *pBuff) {
+		NbRead++;
+		NbReadCmd++;
+		if (SectNo < DATA_SECT)
+			NbMetaRead++;
+		memcpy(pBuff, vpMem + (uint64_t)SectNo * DISKIO_SECT_SIZE, DISKIO_SECT_SIZE);
+		return true;
+	}
+	bool SectWrite(uint32_t SectNo, uint8_t *pData) {
+		NbWrite++;
+		NbWriteCmd++;
+		WriteLog.push_back(SectNo);
+		memcpy(vpMem + (uint64_t)SectNo * DISKIO_SECT_SIZE, pData, DISKIO_SECT_SIZE);
+		return true;
+	}
+	// One device command per call, as a multiple block transfer
+	int SectReadMulti(uint32_t SectNo, uint8_t *pBuff, int NbSect) {
+		NbRead += NbSect;
+		NbReadCmd++;
+		memcpy(pBuff, vpMem + (uint64_t)SectNo * DISKIO_SECT_SIZE, NbSect * DISKIO_SECT_SIZE);
+		return NbSect;
+	}
+	int SectWriteMulti(uint32_t SectNo, uint8_t *pData, int NbSect) {
+		NbWrite += NbSect;
+		NbWriteCmd++;
+		WriteLog.push_back(SectNo);
+		memcpy(vpMem + (uint64_t)SectNo * DISKIO_SECT_SIZE, pData, NbSect * DISKIO_SECT_SIZE);
+		return NbSect;
+	}
+
+	uint8_t *Mem() { return vpMem; }
+
+	long NbRead;
+	long NbWrite;
+	long NbMetaRead;
+	long NbReadCmd;
+	long NbWriteCmd;
+	std::vector<uint32_t> WriteLog;		//!< First sector of each write command
+
+private:
+	uint8_t *vpMem;
+};
+
+typedef struct {
+	uint64_t Offset;
+	uint32_t Len;
+	bool bWrite;
+} ACCESS;
+
+static void GenTrace(std::vector<ACCESS> &Trace, bool bWrite)
+{
+	srand(31);
+	for (int f = 0; f < 60; f++)
+	{
+		// Directory lookup, scan root entries until found
+		int ent = rand() % 256;
+
+		for (int e = 0; e <= ent; e++)
+		{
+			Trace.push_back({ (uint64_t)ROOT_SECT * DISKIO_SECT_SIZE + e * 32, 32, false });
+		}
+
+		uint32_t clus = 2 + (rand() % 4000);
+		int nclus = 4 + rand() % 60;
+		bool wr = bWrite && (f % 3 == 0);
+
+		for (int c = 0; c < nclus; c++, clus++)
+		{
+			// Data in 64 bytes chunks, typical small application buffer
+			for (int o = 0; o < 4 * DISKIO_SECT_SIZE; o += 64)
+			{
+				Trace.push_back({ (uint64_t)(DATA_SECT + (clus - 2) * 4) * DISKIO_SECT_SIZE + o, 64, wr });
+			}
+			// Follow cluster chain
+			Trace.push_back({ (uint64_t)FAT_SECT * DISKIO_SECT_SIZE + clus * 2, 2, false });
+			if (wr)
+			{
+				Trace.push_back({ (uint64_t)FAT_SECT * DISKIO_SECT_SIZE + clus * 2, 2, true });
+			}
+		}
+		if (wr)
+		{
+			Trace.push_back({ (uint64_t)ROOT_SECT * DISKIO_SECT_SIZE + ent * 32, 32, true });
+		}
+	}
+}
+
+// Reference fully associative LRU
+class LruModel {
+public:
+	LruModel(int Size) : vSize(Size) {}
+
+	bool Access(uint32_t Sect) {
+		auto it = vMap.find(Sect);
+
+		if (it != vMap.end())
+		{
+			vList.splice(vList.begin(), vList, it->second);
+			return true;
+		}
+		if ((int)vList.size() >= vSize)
+		{
+			vMap.erase(vList.back());
+			vList.pop_back();
+		}
+		vList.push_front(Sect);
+		vMap[Sect] = vList.begin();
+		return false;
+	}
+
+private:
+	int vSize;
+	std::list<uint32_t> vList;
+	std::unordered_map<uint32_t, std::list<uint32_t>::iterator> vMap;
+};
+
+// Cache before the set associative LRU : linear lookup, round robin eviction
+class RoundRobinModel {
+public:
+	RoundRobinModel(int Size) : vSect(Size, (uint32_t)-1), vNext(0) {}
+
+	bool Access(uint32_t Sect) {
+		for (size_t i = 0; i < vSect.size(); i++)
+		{
+			if (vSect[i] == Sect)
+				return true;
+		}
+		vSect[vNext] = Sect;
+		vNext = (vNext + 1) % vSect.size();
+		return false;
+	}
+
+private:
+	std::vector<uint32_t> vSect;
+	size_t vNext;
+};
+
+// Reference CLOCK-Pro (Jiang, Chen, Zhang, USENIX 2005).  Hot and cold resident pages
+// and non resident cold pages in their test period share one clock with three hands.
+// The cold resident target adapts to hits on non resident pages.
+class ClockProModel {
+public:
+	ClockProModel(int Size) : vSize(Size), vColdTarget(1), vNbHot(0), vNbCold(0), vNbNonRes(0) {
+		vHandHot = vHandCold = vHandTest = vList.end();
+	}
+
+	bool Access(uint32_t Sect) {
+		auto it = vMap.find(Sect);
+
+		if (it != vMap.end() && it->second->bRes)
+		{
+			it->second->bRef = true;
+			return true;
+		}
+
+		if (vNbHot + vNbCold >= vSize)
+		{
+			// Hands may drop the non resident entry of this page
+			RunHandCold();
+			it = vMap.find(Sect);
+		}
+
+		if (it != vMap.end())
+		{
+			// Reused within its test period, cold pages need more room
+			vColdTarget = std::min(vColdTarget + 1, vSize);
+			Remove(it->second);
+			vNbNonRes--;
+			Insert({ Sect, true, true, false, false });
+			vNbHot++;
+			if (vNbHot > vSize - vColdTarget)
+			{
+				RunHandHot();
+			}
+		}
+		else
+		{
+			Insert({ Sect, false, true, false, true });
+			vNbCold++;
+		}
+
+		while (vNbNonRes > vSize)
+		{
+			RunHandTest();
+		}
+
+		return false;
+	}
+
+private:
+	typedef struct {
+		uint32_t Sect;
+		bool bHot;
+		bool bRes;
+		bool bRef;
+		bool bTest;
+	} PAGE;
+	typedef std::list<PAGE>::iterator PAGEIT;
+
+	PAGEIT Next(PAGEIT It) { return ++It == vList.end() ? vList.begin() : It; }
+
+	// New and promoted pages go to the head, right behind the hot hand
+	void Insert(const PAGE &Page) {
+		PAGEIT it = vList.insert(vHandHot, Page);
+
+		vMap[Page.Sect] = it;
+		if (vList.size() == 1)
+		{
+			vHandHot = vHandCold = vHandTest = it;
+		}
+	}
+
+	void Remove(PAGEIT It) {
+		PAGEIT nx = Next(It);
+
+		vHandHot = vHandHot == It ? nx : vHandHot;
+		vHandCold = vHandCold == It ? nx : vHandCold;
+		vHandTest = vHandTest == It ? nx : vHandTest;
+		vMap.erase(It->Sect);
+		vList.erase(It);
+		if (vList.empty())
+		{
+			vHandHot = vHandCold = vHandTest = vList.end();
+		}
+	}
+
+	void MoveToHead(PAGEIT It) {
+		PAGE p = *It;
+
+		Remove(It);
+		Insert(p);
+	}
+
+	// Terminate test period of a cold page, drop it if not resident
+	bool EndTest(PAGEIT It) {
+		It->bTest = false;
+		vColdTarget = std::max(vColdTarget - 1, 1);
+		if (It->bRes == false)
+		{
+			Remove(It);
+			vNbNonRes--;
+			return true;
+		}
+		return false;
+	}
+
+	// Evict one cold resident page
+	void RunHandCold() {
+		while (1)
+		{
+			PAGEIT p = vHandCold;
+
+			vHandCold = Next(vHandCold);
+			if (p->bHot || p->bRes == false)
+			{
+				continue;
+			}
+			if (p->bRef)
+			{
+				p->bRef = false;
+				if (p->bTest)
+				{
+					// Accessed during its test period, promote
+					p->bHot = true;
+					p->bTest = false;
+					vNbHot++;
+					vNbCold--;
+					MoveToHead(p);
+					if (vNbHot > vSize - vColdTarget)
+					{
+						RunHandHot();
+					}
+				}
+				else
+				{
+					p->bTest = true;
+					MoveToHead(p);
+				}
+				continue;
+			}
+			p->bRes = false;
+			vNbCold--;
+			if (p->bTest)
+			{
+				vNbNonRes++;
+			}
+			else
+			{
+				Remove(p);
+			}
+			return;
+		}
+	}
+
+	// Demote one hot page, ending test periods on the way
+	void RunHandHot() {
+		while (1)
+		{
+			PAGEIT p = vHandHot;
+
+			vHandHot = Next(vHandHot);
+			if (p->bHot)
+			{
+				if (p->bRef)
+				{
+					p->bRef = false;
+					continue;
+				}
+				p->bHot = false;
+				vNbHot--;
+				vNbCold++;
+				return;
+			}
+			if (p->bTest)
+			{
+				EndTest(p);
+			}
+		}
+	}
+
+	// Drop one non resident page
+	void RunHandTest() {
+		while (1)
+		{
+			PAGEIT p = vHandTest;
+
+			vHandTest = Next(vHandTest);
+			if (p->bHot == false && p->bTest && EndTest(p))
+			{
+				return;
+			}
+		}
+	}
+
+	int vSize;
+	int vColdTarget;
+	int vNbHot;
+	int vNbCold;
+	int vNbNonRes;
+	std::list<PAGE> vList;
+	std::unordered_map<uint32_t, PAGEIT> vMap;
+	PAGEIT vHandHot;
+	PAGEIT vHandCold;
+	PAGEIT vHandTest;
+};
+
+typedef struct {
+	double Hit;
+	double MetaHit;
+} HITRATE;
+
+template <class T> static HITRATE RunModel(const std::vector<ACCESS> &Trace, int Size)
+{
+	T model(Size);
+	long miss = 0, meta = 0, metamiss = 0;
+
+	for (auto &a : Trace)
+	{
+		uint32_t sect = a.Offset / DISKIO_SECT_SIZE;
+		bool hit = model.Access(sect);
+
+		miss += !hit;
+		if (sect < DATA_SECT)
+		{
+			meta++;
+			metamiss += !hit;
+		}
+	}
+
+	return { 100.0 * (Trace.size() - miss) / Trace.size(), 100.0 * (meta - metamiss) / meta };
+}
+
+static HITRATE RunDiskIO(const std::vector<ACCESS> &Trace, int Size, int NbWays, bool bPin, long *pNbWrite = NULL)
+{
+	RamDisk disk;
+	std::vector<uint8_t> mem(Size * DISKIO_SECT_SIZE);
+	std::vector<DISKIO_CACHE_DESC> desc(Size);
+	uint8_t buf[64];
+	long meta = 0;
+
+	for (int i = 0; i < Size; i++)
+	{
+		desc[i].pSectData = &mem[i * DISKIO_SECT_SIZE];
+	}
+	disk.SetCache(desc.data(), Size, NbWays);
+	if (bPin)
+	{
+		// As FatFS does
+		disk.PinCacheSect(FAT_SECT, true);
+		disk.PinCacheSect(ROOT_SECT, true);
+		disk.NbRead = disk.NbMetaRead = 0;
+	}
+
+	for (auto &a : Trace)
+	{
+		if (a.bWrite)
+		{
+			disk.Write(a.Offset, buf, a.Len);
+		}
+		else
+		{
+			disk.Read(a.Offset, buf, a.Len);
+		}
+		if (a.Offset < (uint64_t)DATA_SECT * DISKIO_SECT_SIZE)
+		{
+			meta++;
+		}
+	}
+	disk.Flush();
+
+	if (pNbWrite)
+	{
+		*pNbWrite = disk.NbWrite;
+	}
+
+	return { 100.0 * (Trace.size() - disk.NbRead) / Trace.size(), 100.0 * (meta - disk.NbMetaRead) / meta };
+}
+
+// Cost of a cache hit, all sectors cached
+static double LookupCost(int Size, int NbWays)
+{
+	RamDisk disk;
+	std::vector<uint8_t> mem(Size * DISKIO_SECT_SIZE);
+	std::vector<DISKIO_CACHE_DESC> desc(Size);
+	long cnt = 0;
+
+	for (int i = 0; i < Size; i++)
+	{
+		desc[i].pSectData = &mem[i * DISKIO_SECT_SIZE];
+	}
+	disk.SetCache(desc.data(), Size, NbWays);
+
+	auto t0 = std::chrono::steady_clock::now();
+
+	for (int r = 0; r < 20000; r++)
+	{
+		for (int s = 0; s < Size; s++, cnt++)
+		{
+			int i = disk.GetCacheSect(s);
+
+			if (i >= 0)
+			{
+				desc[i].UseCnt--;
+			}
+		}
+	}
+
+	auto t1 = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>(t1 - t0).count() / cnt;
+}
+
+static void TestHitRate()
+{
+	for (int rw = 0; rw < 2; rw++)
+	{
+		std::vector<ACCESS> trace;
+
+		GenTrace(trace, rw);
+		printf("%s trace, %zu accesses, hit %% / metadata hit %%\n", rw ? "Read/write" : "Read only", trace.size());
+		printf("cache : 4 ways       4 ways+pin    full LRU      ref LRU       CLOCK-Pro     round robin\n");
+
+		for (int n : { 4, 8, 16, 32 })
+		{
+			HITRATE sa = RunDiskIO(trace, n, DISKIO_CACHE_WAYS_DEF, false);
+			HITRATE pin = RunDiskIO(trace, n, DISKIO_CACHE_WAYS_DEF, true);
+			HITRATE full = RunDiskIO(trace, n, 0, false);
+			HITRATE lru = RunModel<LruModel>(trace, n);
+			HITRATE cp = RunModel<ClockProModel>(trace, n);
+			HITRATE rr = RunModel<RoundRobinModel>(trace, n);
+
+			printf("%5d : %5.1f / %5.1f  %5.1f / %5.1f  %5.1f / %5.1f  %5.1f / %5.1f  %5.1f / %5.1f  %5.1f / %5.1f\n", n,
+				   sa.Hit, sa.MetaHit, pin.Hit, pin.MetaHit, full.Hit, full.MetaHit,
+				   lru.Hit, lru.MetaHit, cp.Hit, cp.MetaHit, rr.Hit, rr.MetaHit);
+
+			// Fully associative DiskIO is exactly LRU
+			TEST_CHECK(full.Hit == lru.Hit && full.MetaHit == lru.MetaHit);
+
+			double best = std::max(sa.MetaHit, pin.MetaHit);
+
+			TEST_CHECK(best >= lru.MetaHit - META_HIT_TOL);
+			TEST_CHECK(best >= cp.MetaHit - META_HIT_TOL);
+			TEST_CHECK(best >= rr.MetaHit);
+		}
+	}
+}
+
+static void TestLookupCost()
+{
+	printf("Lookup cost of a hit, ns\ncache : 4 ways  full\n");
+	for (int n : { 8, 16, 32, 64 })
+	{
+		printf("%5d : %6.1f  %5.1f\n", n, LookupCost(n, DISKIO_CACHE_WAYS_DEF), LookupCost(n, 0));
+	}
+}
+
+static void TestPin()
+{
+	RamDisk disk;
+	uint8_t mem[8 * DISKIO_SECT_SIZE];
+	DISKIO_CACHE_DESC desc[8];
+	uint8_t buf[DISKIO_SECT_SIZE];
+
+	for (int i = 0; i < 8; i++)
+	{
+		desc[i].pSectData = &mem[i * DISKIO_SECT_SIZE];
+	}
+
+	// 2 sets of 4, up to 3 pinned per set
+	disk.SetCache(desc, 8, 4);
+	TEST_CHECK(disk.PinCacheSect(0, true));
+	TEST_CHECK(disk.PinCacheSect(2, true));
+	TEST_CHECK(disk.PinCacheSect(4, true));
+	TEST_CHECK(disk.PinCacheSect(6, true) == false);
+
+	// Pinned sectors survive streaming through their set
+	for (uint32_t s = 100; s < 200; s++)
+	{
+		disk.Read(s, 0, buf, 16);
+	}
+	disk.NbRead = 0;
+	disk.Read(0, 0, buf, 16);
+	disk.Read(2, 0, buf, 16);
+	disk.Read(4, 0, buf, 16);
+	TEST_CHECK(disk.NbRead == 0);
+
+	// Unpinned sector is evicted again
+	TEST_CHECK(disk.PinCacheSect(2, false));
+	for (uint32_t s = 100; s < 200; s++)
+	{
+		disk.Read(s, 0, buf, 16);
+	}
+	disk.NbRead = 0;
+	disk.Read(2, 0, buf, 16);
+	TEST_CHECK(disk.NbRead == 1);
+
+	// Pinning fails with a single sector per set, it would block the set
+	disk.SetCache(desc, 8, 1);
+	TEST_CHECK(disk.PinCacheSect(0, true) == false);
+	disk.SetCache(desc, 1);
+	TEST_CHECK(disk.PinCacheSect(0, true) == false);
+}
+
+static uint32_t Random()
+{
+	static uint32_t s = 33;
+
+	s = s * 1103515245 + 12345;
+
+	return s >> 8;
+}
+
+typedef struct {
+	long SeqRead;
+	long SeqWrite;
+	long MixRead;
+	long MixWrite;
+} CMDCOUNT;
+
+// Device commands of sequential and mixed 64 bytes accesses, data checked
+// against a reference image
+static CMDCOUNT RunStream(bool bStream)
+{
+	RamDisk disk;
+	std::vector<uint8_t> mem(16 * DISKIO_SECT_SIZE), strm(STRM_NBSECT * DISKIO_SECT_SIZE);
+	std::vector<uint8_t> ref(STRM_DISK_NBSECT * DISKIO_SECT_SIZE);
+	DISKIO_CACHE_DESC desc[16];
+	uint8_t buf[64];
+	CMDCOUNT c;
+	long rc, wc;
+	int bad = 0;
+
+	for (size_t i = 0; i < ref.size(); i++)
+	{
+		ref[i] = Random();
+	}
+	memcpy(disk.Mem(), ref.data(), ref.size());
+
+	for (int i = 0; i < 16; i++)
+	{
+		desc[i].pSectData = &mem[i * DISKIO_SECT_SIZE];
+	}
+	disk.SetCache(desc, 16);
+	if (bStream)
+	{
+		disk.SetStreamBuffer(strm.data(), STRM_NBSECT);
+	}
+
+	// Sequential read, 512KB
+	rc = disk.NbReadCmd;
+	for (uint64_t off = 1000 * DISKIO_SECT_SIZE; off < 2024 * DISKIO_SECT_SIZE; off += 64)
+	{
+		bad += disk.Read(off, buf, 64) != 64 || memcmp(buf, &ref[off], 64) != 0;
+	}
+	c.SeqRead = disk.NbReadCmd - rc;
+
+	// Sequential write, 256KB
+	wc = disk.NbWriteCmd;
+	for (uint64_t off = 3000 * DISKIO_SECT_SIZE; off < 3512 * DISKIO_SECT_SIZE; off += 64)
+	{
+		for (int i = 0; i < 64; i++)
+		{
+			buf[i] = Random();
+		}
+		bad += disk.Write(off, buf, 64) != 64;
+		memcpy(&ref[off], buf, 64);
+	}
+	disk.Flush();
+	c.SeqWrite = disk.NbWriteCmd - wc;
+
+	// File read with FAT and directory updates in between
+	uint64_t rd = 2100 * DISKIO_SECT_SIZE;
+
+	rc = disk.NbReadCmd;
+	wc = disk.NbWriteCmd;
+	for (int n = 0; n < 8192; n++)
+	{
+		if (n % 8 == 7)
+		{
+			uint64_t off = (uint64_t)(FAT_SECT + Random() % 8) * DISKIO_SECT_SIZE + Random() % 480;
+			int len = 2 + Random() % 31;
+
+			for (int i = 0; i < len; i++)
+			{
+				buf[i] = Random();
+			}
+			bad += disk.Write(off, buf, len) != len;
+			memcpy(&ref[off], buf, len);
+		}
+		else
+		{
+			bad += disk.Read(rd, buf, 64) != 64 || memcmp(buf, &ref[rd], 64) != 0;
+			rd += 64;
+		}
+	}
+	disk.Flush();
+	c.MixRead = disk.NbReadCmd - rc;
+	c.MixWrite = disk.NbWriteCmd - wc;
+
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(memcmp(disk.Mem(), ref.data(), ref.size()) == 0);
+
+	return c;
+}
+
+static void TestStream()
+{
+	CMDCOUNT a = RunStream(false);
+	CMDCOUNT b = RunStream(true);
+
+	printf("Device commands, 64 bytes accesses, 16 cache sectors\n");
+	printf("stream buffer : seq read 512KB  seq write 256KB  mixed read / write\n");
+	printf("none          : %14ld  %15ld  %6ld / %ld\n", a.SeqRead, a.SeqWrite, a.MixRead, a.MixWrite);
+	printf("%2d sectors    : %14ld  %15ld  %6ld / %ld\n", STRM_NBSECT, b.SeqRead, b.SeqWrite, b.MixRead, b.MixWrite);
+
+	// Read ahead and write back coalescing
+	TEST_CHECK(b.SeqRead * 4 < a.SeqRead);
+	TEST_CHECK(b.SeqWrite * 4 < a.SeqWrite);
+	TEST_CHECK(b.MixRead * 2 < a.MixRead);
+	TEST_CHECK(b.MixWrite <= a.MixWrite);
+}
+
+// Flush writes in increasing sector order and the stream buffer never returns
+// data older than the cache or the device
+static void TestFlushOrder()
+{
+	RamDisk disk;
+	uint8_t mem[16 * DISKIO_SECT_SIZE], strm[STRM_NBSECT * DISKIO_SECT_SIZE];
+	std::vector<uint8_t> ref(STRM_DISK_NBSECT * DISKIO_SECT_SIZE);
+	DISKIO_CACHE_DESC desc[16];
+	uint8_t buf[4 * DISKIO_SECT_SIZE];
+	int bad = 0;
+
+	for (size_t i = 0; i < ref.size(); i++)
+	{
+		ref[i] = Random();
+	}
+	memcpy(disk.Mem(), ref.data(), ref.size());
+
+	for (int i = 0; i < 16; i++)
+	{
+		desc[i].pSectData = &mem[i * DISKIO_SECT_SIZE];
+	}
+
+	for (int strmsz = 0; strmsz <= STRM_NBSECT; strmsz += STRM_NBSECT)
+	{
+		disk.SetCache(desc, 16);
+		disk.SetStreamBuffer(strm, strmsz);
+
+		// Dirty runs written in decreasing order
+		static const uint32_t s_Sect[] = { 100, 47, 46, 45, 44, 43, 42, 41, 40, 23, 22, 21, 20, 9 };
+
+		for (uint32_t sect : s_Sect)
+		{
+			uint64_t off = (uint64_t)sect * DISKIO_SECT_SIZE + 100;
+
+			memset(buf, sect, 16);
+			disk.Write(off, buf, 16);
+			memcpy(&ref[off], buf, 16);
+		}
+		disk.WriteLog.clear();
+		disk.Flush();
+
+		bool sorted = true;
+
+		for (size_t i = 1; i < disk.WriteLog.size(); i++)
+		{
+			sorted = sorted && disk.WriteLog[i] > disk.WriteLog[i - 1];
+		}
+		TEST_CHECK(sorted);
+		TEST_CHECK(disk.WriteLog.size() == (strmsz ? 4 : sizeof(s_Sect) / sizeof(uint32_t)));
+
+		// Sector read ahead, then modified through the cache and flushed
+		for (uint32_t s = 500; s < 504; s++)
+		{
+			bad += disk.Read(s, 0, buf, 64) != 64 || memcmp(buf, &ref[s * DISKIO_SECT_SIZE], 64) != 0;
+		}
+		memset(buf, 0xA5, 64);
+		disk.Write(506, 0, buf, 64);
+		memcpy(&ref[506 * DISKIO_SECT_SIZE], buf, 64);
+		disk.Flush();
+
+		// Evict it without sequential access, then read it back
+		for (uint32_t s = 510; s < 600; s += 4)
+		{
+			disk.Read(s, 0, buf, 16);
+		}
+		bad += disk.Read(506, 0, buf, 64) != 64 || memcmp(buf, &ref[506 * DISKIO_SECT_SIZE], 64) != 0;
+
+		// Direct read sees dirty cache sectors
+		memset(buf, 0x3C, 64);
+		disk.Write(801, 0, buf, 64);
+		memcpy(&ref[801 * DISKIO_SECT_SIZE], buf, 64);
+		bad += disk.Read((uint64_t)800 * DISKIO_SECT_SIZE, buf, sizeof(buf)) != sizeof(buf) ||
+			   memcmp(buf, &ref[800 * DISKIO_SECT_SIZE], sizeof(buf)) != 0;
+
+		// Direct write over read ahead sectors
+		for (uint32_t s = 900; s < 904; s++)
+		{
+			disk.Read(s, 0, buf, 16);
+		}
+		for (size_t i = 0; i < sizeof(buf); i++)
+		{
+			buf[i] = Random();
+		}
+		disk.Write((uint64_t)905 * DISKIO_SECT_SIZE, buf, sizeof(buf));
+		memcpy(&ref[905 * DISKIO_SECT_SIZE], buf, sizeof(buf));
+		for (uint32_t s = 904; s < 910; s++)
+		{
+			bad += disk.Read(s, 0, buf, DISKIO_SECT_SIZE) != DISKIO_SECT_SIZE ||
+				   memcmp(buf, &ref[s * DISKIO_SECT_SIZE], DISKIO_SECT_SIZE) != 0;
+		}
+
+		disk.Flush();
+	}
+
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(memcmp(disk.Mem(), ref.data(), ref.size()) == 0);
+}
+
+int main()
+{
+	TestHitRate();
+	TestLookupCost();
+	TestPin();
+	TestStream();
+	TestFlushOrder();
+
+	printf("diskio_cache : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,245 @@
+/**-------------------------------------------------------------------------
+@file	test_diskio_file.cpp
+
+@brief	File backed DiskIO test
+
+Mounts a fragmented FAT32 image with FatFS through FileDiskIO, in pread/pwrite
+and mmap modes, and checks the injected faults : power loss tearing a sector
+in a multi sector write, bit errors on read and write failures.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+
+#include "diskio_file.h"
+#include "fatfs.h"
+#include "test_util.h"
+
+#define IMG_FAT			"build/test_diskio_file_fat.img"
+#define IMG_FAULT		"build/test_diskio_file_fault.img"
+
+#define FAT_NBSECT		140000
+#define FAT_RSVD		32
+#define FAT_SPC			2
+#define FAT_SIZE		((FAT_NBSECT / FAT_SPC + 2) * 4 / 512 + 1)
+#define FAT_DATA		(FAT_RSVD + FAT_SIZE)
+#define FILE_SIZE		20000
+
+static uint8_t s_Img[FAT_NBSECT * 512];
+
+// FAT32 image, 1 FAT, root directory in cluster 2, HELLO.TXT on every other
+// cluster from 3 to get a fragmented chain
+static bool MakeImage(const char *pPath, const uint8_t *pData, uint32_t Len)
+{
+	uint8_t *b = s_Img;
+	uint32_t tot = FAT_NBSECT;
+	uint32_t fatsz = FAT_SIZE;
+	uint32_t rootclus = 2;
+
+	memset(s_Img, 0, sizeof(s_Img));
+
+	b[0] = 0xEB; b[1] = 0x58; b[2] = 0x90;
+	memcpy(&b[3], "MSDOS5.0", 8);
+	b[11] = 0; b[12] = 2;
+	b[13] = FAT_SPC;
+	b[14] = FAT_RSVD;
+	b[16] = 1;
+	b[21] = 0xF8;
+	memcpy(&b[32], &tot, 4);
+	memcpy(&b[36], &fatsz, 4);
+	memcpy(&b[44], &rootclus, 4);
+	b[510] = 0x55; b[511] = 0xAA;
+
+	uint32_t *fat = (uint32_t*)&s_Img[FAT_RSVD * 512];
+	uint32_t nclus = (Len + FAT_SPC * 512 - 1) / (FAT_SPC * 512);
+
+	fat[0] = 0x0FFFFFF8;
+	fat[1] = 0x0FFFFFFF;
+	fat[2] = 0x0FFFFFFF;
+
+	uint8_t *root = &s_Img[FAT_DATA * 512];
+
+	memcpy(root, "HELLO   TXT", 11);
+	root[11] = 0x20;
+	root[26] = 3;
+	memcpy(&root[28], &Len, 4);
+
+	uint32_t c = 3;
+
+	for (uint32_t i = 0; i < nclus; i++, c += 2)
+	{
+		uint32_t l = Len - i * FAT_SPC * 512;
+
+		fat[c] = i == nclus - 1 ? 0x0FFFFFFF : c + 2;
+		memcpy(&s_Img[(FAT_DATA + (c - 2) * FAT_SPC) * 512], &pData[i * FAT_SPC * 512],
+			   l > FAT_SPC * 512 ? FAT_SPC * 512 : l);
+	}
+
+	FILE *fp = fopen(pPath, "wb");
+
+	if (fp == NULL)
+	{
+		return false;
+	}
+
+	bool res = fwrite(s_Img, 1, sizeof(s_Img), fp) == sizeof(s_Img);
+
+	fclose(fp);
+
+	return res;
+}
+
+static void TestFatMount()
+{
+	static uint8_t data[FILE_SIZE], rd[FILE_SIZE];
+
+	for (int i = 0; i < FILE_SIZE; i++)
+	{
+		data[i] = i * 7 + (i >> 8);
+	}
+	TEST_CHECK(MakeImage(IMG_FAT, data, FILE_SIZE));
+
+	for (int m = 0; m < 2; m++)
+	{
+		FILEDISKIO_CFG cfg = { IMG_FAT, 0, 512, m == 1, 0, 0 };
+		static DISKIO_CACHE_DESC cache[8];
+		static uint8_t cmem[8][512];
+		FileDiskIO disk;
+		FatFS fs;
+
+		for (int i = 0; i < 8; i++)
+		{
+			cache[i].pSectData = cmem[i];
+		}
+
+		TEST_CHECK(disk.Init(cfg, cache, 8));
+		TEST_CHECK(disk.GetSize() == (uint64_t)FAT_NBSECT * 512);
+		TEST_CHECK(fs.Init(&disk));
+
+		int fd = fs.Open("/HELLO.TXT", O_RDONLY, 0);
+		int tot = 0, l;
+
+		TEST_CHECK(fd >= 0);
+		memset(rd, 0, sizeof(rd));
+		while (tot < FILE_SIZE && (l = fs.Read(fd, rd + tot, 3000)) > 0)
+		{
+			tot += l;
+		}
+		fs.Close(fd);
+
+		printf("%s : read %d bytes, %u read commands\n", m ? "mmap" : "pread", tot, disk.ReadCmdCount());
+		TEST_CHECK(tot == FILE_SIZE);
+		TEST_CHECK(memcmp(rd, data, FILE_SIZE) == 0);
+		TEST_CHECK(disk.WriteCmdCount() == 0);
+
+		disk.Close();
+	}
+}
+
+static void TestFault()
+{
+	FILEDISKIO_CFG cfg = { IMG_FAULT, 64 * 512, 512, false, 0, 0 };
+	FileDiskIO disk;
+	uint8_t buf[8 * 512];
+	uint8_t ref[512];
+
+	TEST_CHECK(disk.Init(cfg));
+	disk.Erase();
+
+	// Power lost at 5th sector write, first 4 written and 5th torn in the middle
+	FILEDISKIO_FAULT pl = { 1, 0, 0, 5 };
+
+	disk.SetFault(pl);
+	memset(buf, 0xA5, sizeof(buf));
+	TEST_CHECK(disk.SectWriteMulti(0, buf, 8) == 4);
+	TEST_CHECK(disk.PowerLost());
+	TEST_CHECK(disk.SectRead(0, buf) == false);
+
+	disk.PowerRestore();
+	TEST_CHECK(disk.PowerLost() == false);
+	TEST_CHECK(disk.SectRead(3, buf));
+	TEST_CHECK(buf[0] == 0xA5 && buf[511] == 0xA5);
+	TEST_CHECK(disk.SectRead(4, buf));
+	TEST_CHECK(buf[0] == 0xA5 && buf[255] == 0xA5 && buf[256] == 0 && buf[511] == 0);
+	TEST_CHECK(disk.SectRead(5, buf));
+	TEST_CHECK(buf[0] == 0);
+
+	// 1 read in 8 gets a bit flipped
+	FILEDISKIO_FAULT ber = { 7, 1000000 / 8, 0, 0 };
+	int err = 0;
+
+	disk.SetFault(ber);
+	memset(ref, 0xA5, sizeof(ref));
+	for (int i = 0; i < 1000; i++)
+	{
+		disk.SectRead(0, buf);
+		err += memcmp(buf, ref, 512) != 0;
+	}
+	printf("bit errors : %d of 1000 reads at 12.5%%\n", err);
+	TEST_CHECK(err > 90 && err < 160);
+
+	// 1 write in 10 fails
+	FILEDISKIO_FAULT wf = { 9, 0, 100000, 0 };
+	int ok = 0;
+
+	disk.SetFault(wf);
+	for (int i = 0; i < 1000; i++)
+	{
+		ok += disk.SectWrite(i % 64, ref);
+	}
+	printf("write failures : %d of 1000 writes at 10%%\n", 1000 - ok);
+	TEST_CHECK(ok > 870 && ok < 930);
+
+	// No fault
+	FILEDISKIO_FAULT none = { 0, 0, 0, 0 };
+
+	disk.SetFault(none);
+	for (int i = 0; i < 64; i++)
+	{
+		TEST_CHECK(disk.SectWrite(i, ref));
+		TEST_CHECK(disk.SectRead(i, buf) && memcmp(buf, ref, 512) == 0);
+	}
+
+	disk.Close();
+}
+
+int main()
+{
+	TestFatMount();
+	TestFault();
+
+	remove(IMG_FAT);
+	remove(IMG_FAULT);
+
+	printf("diskio_file : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
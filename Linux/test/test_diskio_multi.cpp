@@ -0,0 +1,248 @@
+/**-------------------------------------------------------------------------
+@file	test_diskio_multi.cpp
+
+@brief	Multi-sector transfer test of FlashDiskIO and SDCard
+
+Transfers 64KB in requests of 512 bytes to 64KB through FlashDiskIO on the
+timed SPI flash simulator and through SDCard on the SD SPI simulator, with
+SectReadMulti/SectWriteMulti and with the DiskIO default that loops over
+single sectors.  Checks the data and the number of device commands per
+request, and reports the throughput for each request size.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "diskio_flash.h"
+#include "norflash_sim.h"
+#include "sdcard.h"
+#include "sdcard_sim.h"
+#include "test_util.h"
+
+#define XFER_SIZE		(64 * 1024)		// Transferred per request size
+#define FLASH_SIZE		(2 * 1024 * 1024)
+
+static const NORFLASHSIM_TIMING s_FlashTiming = {
+	80000000,	// 80 MHz SPI
+	100,		// Chip select and driver overhead per transfer
+	650,		// Page program
+	45000,		// 4KB erase
+	120000,		// 32KB erase
+	150000,		// 64KB erase
+	40000,		// Chip erase, ms
+	20,			// Erase suspend latency
+	100,		// Erase progress between suspends
+};
+
+static const SDCARDSIM_TIMING s_SdTiming = {
+	25000000, 1000,			// 25MHz SPI, 1us per transfer
+	500, 100,				// Read access, first and following stream blocks
+	1500, 400, 250,			// Program single, stream and pre-erased stream blocks
+	500,					// Busy after stream stop
+	0, 0,					// No garbage collection stall
+};
+
+static const SDCARDSIM_CFG s_SdCfg = { 64 * 1024 * 1024 / 512, &s_SdTiming };
+
+static uint8_t s_Src[XFER_SIZE];
+static uint8_t s_Dst[XFER_SIZE];
+
+typedef struct {
+	double WrMBs;
+	double RdMBs;
+	double WrCmd;			// Device commands per request
+	double RdCmd;
+} XFERRESULT;
+
+static uint32_t Random()
+{
+	static uint32_t s = 32;
+
+	s = s * 1103515245 + 12345;
+
+	return s >> 8;
+}
+
+static bool Wait(int DevNo, DeviceIntrf * const pInterf)
+{
+	(void)DevNo;
+
+	((NorFlashSim*)pInterf)->Delay(20);
+
+	return true;
+}
+
+// Write then read XFER_SIZE at Base in requests of NbSect sectors.  bMulti false
+// runs the DiskIO default loop over SectRead/SectWrite.
+template <class T> static XFERRESULT Run(T &Dev, uint64_t (*pTime)(T&), uint32_t (*pCmd)(T&),
+										 uint32_t Base, int NbSect, bool bMulti)
+{
+	int nbreq = XFER_SIZE / 512 / NbSect;
+	XFERRESULT res;
+	int bad = 0;
+
+	for (int i = 0; i < XFER_SIZE; i++)
+	{
+		s_Src[i] = Random();
+	}
+
+	uint64_t t = pTime(Dev);
+	uint32_t c = pCmd(Dev);
+
+	for (int s = 0; s < XFER_SIZE / 512; s += NbSect)
+	{
+		int n = bMulti ? Dev.SectWriteMulti(Base + s, &s_Src[s * 512], NbSect) :
+						 Dev.DiskIO::SectWriteMulti(Base + s, &s_Src[s * 512], NbSect);
+
+		bad += n != NbSect;
+	}
+	res.WrMBs = XFER_SIZE / ((pTime(Dev) - t) / 1e9) / 1e6;
+	res.WrCmd = (double)(pCmd(Dev) - c) / nbreq;
+
+	memset(s_Dst, 0, sizeof(s_Dst));
+	t = pTime(Dev);
+	c = pCmd(Dev);
+	for (int s = 0; s < XFER_SIZE / 512; s += NbSect)
+	{
+		int n = bMulti ? Dev.SectReadMulti(Base + s, &s_Dst[s * 512], NbSect) :
+						 Dev.DiskIO::SectReadMulti(Base + s, &s_Dst[s * 512], NbSect);
+
+		bad += n != NbSect;
+	}
+	res.RdMBs = XFER_SIZE / ((pTime(Dev) - t) / 1e9) / 1e6;
+	res.RdCmd = (double)(pCmd(Dev) - c) / nbreq;
+
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(memcmp(s_Dst, s_Src, XFER_SIZE) == 0);
+
+	return res;
+}
+
+static NorFlashSim s_FlashSim;
+static SdCardSim s_SdSim;
+
+static uint64_t FlashTime(FlashDiskIO &Dev) { (void)Dev; return s_FlashSim.Time(); }
+static uint64_t SdTime(SDCard &Dev) { (void)Dev; return s_SdSim.Time(); }
+
+// Read and page program commands
+static uint32_t FlashCmd(FlashDiskIO &Dev)
+{
+	(void)Dev;
+
+	return s_FlashSim.CmdCount(FLASH_CMD_READ) + s_FlashSim.CmdCount(FLASH_CMD_WRITE);
+}
+
+static uint32_t SdCmd(SDCard &Dev) { (void)Dev; return s_SdSim.CmdCount(); }
+
+static void TestFlash()
+{
+	NORFLASHSIM_CFG simcfg = { FLASH_SIZE, 256, 3, 1, NULL, 0, 0, &s_FlashTiming };
+	FlashDiskIO flash;
+	FLASHDISKIO_CFG cfg;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.TotalSize = FLASH_SIZE;
+	cfg.EraseSize = 4096;
+	cfg.WriteSize = 256;
+	cfg.AddrSize = 3;
+	cfg.pWaitCB = Wait;
+
+	TEST_CHECK(s_FlashSim.Init(simcfg));
+	TEST_CHECK(flash.Init(cfg, &s_FlashSim));
+
+	printf("SPI flash %u MHz   : write MB/s cmd/req          read MB/s cmd/req\n", s_FlashTiming.ClkRate / 1000000);
+
+	// Each run writes its own erased area
+	uint32_t base = 0;
+
+	for (int n = 1; n <= 128; n <<= 1)
+	{
+		XFERRESULT s = Run(flash, FlashTime, FlashCmd, base, n, false);
+		XFERRESULT m = Run(flash, FlashTime, FlashCmd, base + XFER_SIZE / 512, n, true);
+
+		base += 2 * XFER_SIZE / 512;
+
+		printf("%6d B : single %5.2f %6.1f  multi %5.2f %6.1f | single %5.2f %5.1f  multi %5.2f %4.1f\n",
+			   n * 512, s.WrMBs, s.WrCmd, m.WrMBs, m.WrCmd, s.RdMBs, s.RdCmd, m.RdMBs, m.RdCmd);
+
+		// Whole run in one read command, one program per page either way
+		TEST_CHECK(s.RdCmd == n && m.RdCmd == 1);
+		TEST_CHECK(s.WrCmd == 2 * n && m.WrCmd == 2 * n);
+		if (n >= 8)
+		{
+			TEST_CHECK(m.RdMBs > s.RdMBs);
+		}
+	}
+
+	TEST_CHECK(s_FlashSim.ProgErrorCount() == 0 && s_FlashSim.BusyErrorCount() == 0);
+}
+
+static void TestSd()
+{
+	SDCard sd;
+
+	TEST_CHECK(s_SdSim.Init(s_SdCfg));
+	TEST_CHECK(sd.Init(&s_SdSim, (uint8_t*)NULL, 0));
+
+	printf("SD card %u MHz     : write MB/s cmd/req          read MB/s cmd/req\n", s_SdTiming.ClkRate / 1000000);
+
+	uint32_t base = 1000;
+
+	for (int n = 1; n <= 128; n <<= 1)
+	{
+		XFERRESULT s = Run(sd, SdTime, SdCmd, base, n, false);
+		XFERRESULT m = Run(sd, SdTime, SdCmd, base + XFER_SIZE / 512, n, true);
+
+		base += 2 * XFER_SIZE / 512;
+
+		printf("%6d B : single %5.2f %6.1f  multi %5.2f %6.1f | single %5.2f %5.1f  multi %5.2f %4.1f\n",
+			   n * 512, s.WrMBs, s.WrCmd, m.WrMBs, m.WrCmd, s.RdMBs, s.RdCmd, m.RdMBs, m.RdCmd);
+
+		// CMD17/CMD24 per block, CMD18 + CMD12 and ACMD23 + CMD25 per stream
+		TEST_CHECK(s.RdCmd == n && s.WrCmd == n);
+		if (n > 1)
+		{
+			TEST_CHECK(m.RdCmd == 2 && m.WrCmd == 3);
+			TEST_CHECK(m.RdMBs > s.RdMBs && m.WrMBs > s.WrMBs);
+		}
+	}
+
+	TEST_CHECK(s_SdSim.ProtoErrorCount() == 0 && s_SdSim.CrcErrorCount() == 0);
+}
+
+int main()
+{
+	TestFlash();
+	TestSd();
+
+	printf("diskio_multi : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
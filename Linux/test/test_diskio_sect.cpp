@@ -0,0 +1,331 @@
+/**-------------------------------------------------------------------------
+@file	test_diskio_sect.cpp
+
+@brief	DiskIO logical sector size test
+
+Runs DiskIO on a RAM disk with 512, 2048 and 4096 bytes sectors, with and
+without sector cache.  Random byte offset reads and writes crossing sector
+boundaries are checked against a reference image.  Without cache, sectors
+larger than DISKIO_SECT_SIZE only allow whole sector access, partial access
+returns -1.  Then reports the read and write throughput of 64 bytes
+sequential accesses on the timed SPI flash simulator for each sector size.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "diskio.h"
+#include "diskio_flash.h"
+#include "norflash_sim.h"
+#include "test_util.h"
+
+#define DISK_SIZE		(1024 * 1024)
+#define CACHE_MEM		4096		// Cache memory, same for all sector sizes
+#define NBOPS			3000
+#define XFER_SIZE		(64 * 1024)	// Throughput measurement range
+#define XFER_CHUNK		64			// Application buffer
+
+static const int s_SectSize[] = { 512, 2048, 4096 };
+
+// RAM disk with a configurable sector size
+class RamDisk : public DiskIO {
+public:
+	RamDisk(int SectSize) : NbRead(0), NbWrite(0), vSectSize(SectSize) { vpMem = (uint8_t*)calloc(1, DISK_SIZE); }
+	virtual ~RamDisk() { free(vpMem); }
+
+	int GetSectSize(void) { return vSectSize; }
+	uint64_t GetSize() { return DISK_SIZE; }
+
+	bool SectRead(uint32_t SectNo, uint8_t *pBuff) {
+		NbRead++;
+		memcpy(pBuff, vpMem + (uint64_t)SectNo * vSectSize, vSectSize);
+		return true;
+	}
+	bool SectWrite(uint32_t SectNo, uint8_t *pData) {
+		NbWrite++;
+		memcpy(vpMem + (uint64_t)SectNo * vSectSize, pData, vSectSize);
+		return true;
+	}
+
+	uint8_t *Mem() { return vpMem; }
+
+	long NbRead;
+	long NbWrite;
+
+private:
+	int vSectSize;
+	uint8_t *vpMem;
+};
+
+static uint32_t Random()
+{
+	static uint32_t s = 34;
+
+	s = s * 1103515245 + 12345;
+
+	return s >> 8;
+}
+
+// Bytes transferred by DiskIO without cache.  Sectors larger than
+// DISKIO_SECT_SIZE are only accessed whole, it stops at the first partial one.
+static uint32_t NoCacheLen(uint32_t SectSize, uint64_t Offset, uint32_t Len)
+{
+	if (SectSize <= DISKIO_SECT_SIZE)
+	{
+		return Len;
+	}
+
+	return Offset % SectSize ? 0 : Len / SectSize * SectSize;
+}
+
+static void TestRandom(int SectSize, bool bCache)
+{
+	RamDisk disk(SectSize);
+	int nbcache = CACHE_MEM / SectSize * 2;
+	std::vector<uint8_t> ref(DISK_SIZE), cmem(nbcache * SectSize), strm(4 * SectSize);
+	std::vector<uint8_t> buf(3 * SectSize);
+	std::vector<DISKIO_CACHE_DESC> desc(nbcache);
+	int bad = 0, badlen = 0;
+
+	for (int i = 0; i < DISK_SIZE; i++)
+	{
+		ref[i] = Random();
+	}
+	memcpy(disk.Mem(), ref.data(), DISK_SIZE);
+
+	if (bCache)
+	{
+		for (int i = 0; i < nbcache; i++)
+		{
+			desc[i].pSectData = &cmem[i * SectSize];
+		}
+		disk.SetCache(desc.data(), nbcache);
+		disk.SetStreamBuffer(strm.data(), 4);
+	}
+
+	for (int n = 0; n < NBOPS; n++)
+	{
+		uint32_t len = 1 + Random() % (3 * SectSize);
+		uint64_t off;
+
+		switch (Random() % 3)
+		{
+			case 0:
+				// Ends just past a sector boundary
+				off = (Random() % (DISK_SIZE / SectSize - 4) + 1) * SectSize - Random() % 64;
+				break;
+			case 1:
+				// Sector aligned
+				off = (Random() % (DISK_SIZE / SectSize - 4)) * SectSize;
+				break;
+			default:
+				off = Random() % (DISK_SIZE - len);
+				break;
+		}
+
+		uint32_t expect = bCache ? len : NoCacheLen(SectSize, off, len);
+		int l;
+
+		if (Random() & 1)
+		{
+			for (uint32_t i = 0; i < len; i++)
+			{
+				buf[i] = Random();
+			}
+			l = disk.Write(off, buf.data(), len);
+			memcpy(&ref[off], buf.data(), l > 0 ? l : 0);
+		}
+		else
+		{
+			l = disk.Read(off, buf.data(), len);
+			bad += l > 0 && memcmp(buf.data(), &ref[off], l) != 0;
+		}
+		badlen += l != (int)expect;
+
+		if (n % 500 == 499)
+		{
+			disk.Flush();
+		}
+	}
+	disk.Flush();
+
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(badlen == 0);
+	TEST_CHECK(memcmp(disk.Mem(), ref.data(), DISK_SIZE) == 0);
+
+	// Partial sector access
+	int sect = 3;
+	int rl = disk.Read(sect, 100, buf.data(), 10);
+	int wl = disk.Write(sect, 100, buf.data(), 10);
+
+	if (bCache || SectSize <= DISKIO_SECT_SIZE)
+	{
+		TEST_CHECK(rl == 10 && wl == 10);
+	}
+	else
+	{
+		TEST_CHECK(rl == -1 && wl == -1);
+	}
+
+	// Whole sector access never needs a cache
+	memset(buf.data(), 0x5A, SectSize);
+	TEST_CHECK(disk.Write(sect, 0, buf.data(), SectSize) == SectSize);
+	memset(buf.data(), 0, SectSize);
+	TEST_CHECK(disk.Read(sect, 0, buf.data(), SectSize) == SectSize);
+	TEST_CHECK(buf[0] == 0x5A && buf[SectSize - 1] == 0x5A);
+
+	printf("%4d B sectors, %-8s : %d ops, %ld sector reads, %ld sector writes\n",
+		   SectSize, bCache ? "cache" : "no cache", NBOPS, disk.NbRead, disk.NbWrite);
+}
+
+static const NORFLASHSIM_TIMING s_Timing = {
+	80000000,	// 80 MHz SPI
+	100,		// Chip select and driver overhead per transfer
+	650,		// Page program
+	45000,		// 4KB erase
+	120000,		// 32KB erase
+	150000,		// 64KB erase
+	40000,		// Chip erase, ms
+	20,			// Erase suspend latency
+	100,		// Erase progress between suspends
+};
+
+static void TestFlash(int SectSize, bool bCache)
+{
+	NORFLASHSIM_CFG simcfg = { DISK_SIZE, 256, 3, 1, NULL, 0, 0, &s_Timing };
+	NorFlashSim sim;
+	FlashDiskIO flash;
+	FLASHDISKIO_CFG cfg;
+	int nbcache = CACHE_MEM / SectSize;
+	std::vector<uint8_t> cmem(CACHE_MEM), data(XFER_SIZE), rd(XFER_SIZE);
+	std::vector<DISKIO_CACHE_DESC> desc(nbcache);
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.TotalSize = DISK_SIZE;
+	cfg.EraseSize = 4096;
+	cfg.WriteSize = 256;
+	cfg.AddrSize = 3;
+	cfg.SectSize = SectSize;
+
+	TEST_CHECK(sim.Init(simcfg));
+	TEST_CHECK(flash.Init(cfg, &sim));
+	TEST_CHECK(flash.GetSectSize() == SectSize);
+
+	if (bCache)
+	{
+		for (int i = 0; i < nbcache; i++)
+		{
+			desc[i].pSectData = &cmem[i * SectSize];
+		}
+		flash.SetCache(desc.data(), nbcache);
+	}
+
+	for (int i = 0; i < XFER_SIZE; i++)
+	{
+		data[i] = Random();
+	}
+
+	// Sequential writes to erased flash
+	uint64_t t0 = sim.Time();
+	uint32_t wlen = 0;
+
+	for (int i = 0; i < XFER_SIZE; i += XFER_CHUNK)
+	{
+		int l = flash.Write((uint64_t)i, &data[i], XFER_CHUNK);
+
+		wlen += l > 0 ? l : 0;
+	}
+	flash.Flush();
+
+	uint64_t tw = sim.Time() - t0;
+
+	// Sequential reads, cache invalidated
+	flash.Reset();
+
+	uint32_t cmd = sim.CmdCount(FLASH_CMD_READ);
+	uint32_t rlen = 0;
+
+	t0 = sim.Time();
+	for (int i = 0; i < XFER_SIZE; i += XFER_CHUNK)
+	{
+		int l = flash.Read((uint64_t)i, &rd[i], XFER_CHUNK);
+
+		rlen += l > 0 ? l : 0;
+	}
+
+	uint64_t tr = sim.Time() - t0;
+
+	cmd = sim.CmdCount(FLASH_CMD_READ) - cmd;
+
+	TEST_CHECK(sim.ProgErrorCount() == 0);
+	if (bCache || SectSize <= DISKIO_SECT_SIZE)
+	{
+		TEST_CHECK(wlen == XFER_SIZE && rlen == XFER_SIZE);
+		TEST_CHECK(memcmp(sim.Mem(), data.data(), XFER_SIZE) == 0);
+		TEST_CHECK(memcmp(rd.data(), data.data(), XFER_SIZE) == 0);
+		if (bCache)
+		{
+			// One read command per sector
+			TEST_CHECK(cmd == (uint32_t)(XFER_SIZE / SectSize));
+		}
+		printf("%4d B sectors, %-8s : read %6.2f MB/s %4u commands, write %5.2f MB/s %4u programs\n",
+			   SectSize, bCache ? "cache" : "no cache", XFER_SIZE / (tr / 1e9) / 1e6, cmd,
+			   XFER_SIZE / (tw / 1e9) / 1e6, sim.ProgOpCount());
+	}
+	else
+	{
+		// Partial sector access rejected without cache
+		TEST_CHECK(wlen == 0 && rlen == 0 && sim.ProgOpCount() == 0);
+		printf("%4d B sectors, %-8s : %d B accesses rejected\n", SectSize, "no cache", XFER_CHUNK);
+	}
+}
+
+int main()
+{
+	for (int sz : s_SectSize)
+	{
+		TestRandom(sz, true);
+		TestRandom(sz, false);
+	}
+
+	printf("%d B sequential accesses over %d KB, SPI flash %u MHz\n", XFER_CHUNK, XFER_SIZE / 1024,
+		   s_Timing.ClkRate / 1000000);
+	for (int sz : s_SectSize)
+	{
+		TestFlash(sz, true);
+		TestFlash(sz, false);
+	}
+
+	printf("diskio_sect : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,235 @@
+/**-------------------------------------------------------------------------
+@file	test_fatfs.h
+
+@brief	FatFS test helpers
+
+Disk images for the FatFS tests are formatted with the fatimg tool, mounted
+through FileDiskIO and checked with fatimg check once unmounted.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __TEST_FATFS_H__
+#define __TEST_FATFS_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include "diskio_file.h"
+#include "fatfs.h"
+
+#define TEST_FATIMG			"build/fatimg"
+#define TEST_FATFS_NBCACHE	16
+
+/// FAT image mounted through FileDiskIO
+class TestFatDisk {
+public:
+	TestFatDisk() {
+		for (int i = 0; i < TEST_FATFS_NBCACHE; i++)
+		{
+			vCache[i].pSectData = vCacheMem[i];
+		}
+	}
+
+	/**
+	 * @brief	Format an empty image with fatimg build
+	 *
+	 * @param	pImg	: Image path
+	 * @param	pOpt	: fatimg build options, ex. "-t 32 -s 64M"
+	 *
+	 * @return	true - Success
+	 */
+	static bool Format(const char *pImg, const char *pOpt) {
+		char cmd[512];
+
+		snprintf(cmd, sizeof(cmd), "mkdir -p %s.src && " TEST_FATIMG " build %s -d 0 %s.src %s > /dev/null",
+				 pImg, pOpt, pImg, pImg);
+
+		fflush(stdout);
+
+		return system(cmd) == 0;
+	}
+
+	/**
+	 * @brief	Check image with fatimg check
+	 *
+	 * A clean image without options is also checked with fsck.fat -n when it
+	 * is installed and the image has no partition table.
+	 *
+	 * @param	pImg	: Image path
+	 * @param	pOpt	: fatimg check options, ex. "-r"
+	 *
+	 * @return	fatimg exit code, 0 - no error
+	 */
+	static int Check(const char *pImg, const char *pOpt = "") {
+		char cmd[512];
+
+		snprintf(cmd, sizeof(cmd), TEST_FATIMG " check %s %s", pOpt, pImg);
+
+		fflush(stdout);
+
+		int res = system(cmd);
+
+		res = WIFEXITED(res) ? WEXITSTATUS(res) : -1;
+		if (res == 0 && pOpt[0] == 0)
+		{
+			res = Fsck(pImg);
+		}
+
+		return res;
+	}
+
+	/**
+	 * @brief	Cross check with fsck.fat -n, read only
+	 *
+	 * @param	pImg	: Image path
+	 *
+	 * @return	fsck.fat exit code, 0 - no error, fsck.fat not installed or
+	 * 			partitioned image
+	 */
+	static int Fsck(const char *pImg) {
+		static int fsck = -1;
+		char cmd[512];
+		uint8_t b[512];
+		FILE *fp;
+
+		if (fsck < 0)
+		{
+			fsck = system("command -v fsck.fat > /dev/null 2>&1") == 0;
+			printf("fsck.fat %s\n", fsck ? "cross check" : "not installed, skipped");
+		}
+
+		// Volume boot sector starts with a jump, a partition table does not
+		fp = fopen(pImg, "rb");
+		if (fsck == 0 || fp == NULL || fread(b, 1, 512, fp) != 512 || (b[0] != 0xEB && b[0] != 0xE9))
+		{
+			if (fp)
+			{
+				fclose(fp);
+			}
+			return 0;
+		}
+		fclose(fp);
+
+		snprintf(cmd, sizeof(cmd), "fsck.fat -n %s > /dev/null", pImg);
+
+		fflush(stdout);
+
+		int res = system(cmd);
+
+		res = WIFEXITED(res) ? WEXITSTATUS(res) : -1;
+		if (res != 0)
+		{
+			printf("%s : fsck.fat -n exit code %d\n", pImg, res);
+		}
+
+		return res;
+	}
+
+	/**
+	 * @brief	Copy an image into memory, ex. a simulated card
+	 *
+	 * @param	pImg	: Image path
+	 * @param	pMem	: Destination
+	 * @param	Size	: Image size in bytes
+	 *
+	 * @return	true - Success
+	 */
+	static bool Load(const char *pImg, uint8_t *pMem, size_t Size) {
+		FILE *fp = fopen(pImg, "rb");
+
+		if (fp == NULL)
+		{
+			return false;
+		}
+
+		bool res = fread(pMem, 1, Size, fp) == Size;
+
+		fclose(fp);
+
+		return res;
+	}
+
+	/// Write memory back to the image, for Check
+	static bool Save(const char *pImg, const uint8_t *pMem, size_t Size) {
+		FILE *fp = fopen(pImg, "wb");
+
+		if (fp == NULL)
+		{
+			return false;
+		}
+
+		bool res = fwrite(pMem, 1, Size, fp) == Size;
+
+		fclose(fp);
+
+		return res;
+	}
+
+	static void Remove(const char *pImg) {
+		char cmd[512];
+
+		snprintf(cmd, sizeof(cmd), "rm -rf %s %s.src", pImg, pImg);
+		if (system(cmd) != 0)
+		{
+			printf("%s not removed\n", pImg);
+		}
+	}
+
+	bool Open(const char *pImg) {
+		FILEDISKIO_CFG cfg = { pImg, 0, 512, false, 0, 0 };
+
+		return Disk.Init(cfg, vCache, TEST_FATFS_NBCACHE);
+	}
+
+	void Close() {
+		Disk.Flush();
+		Disk.Close();
+	}
+
+	FileDiskIO Disk;
+
+private:
+	DISKIO_CACHE_DESC vCache[TEST_FATFS_NBCACHE];
+	uint8_t vCacheMem[TEST_FATFS_NBCACHE][512];
+};
+
+/// Test file content, depends on file id and position
+static inline void TestFatFill(uint8_t *p, uint32_t Id, uint32_t Pos, uint32_t Len)
+{
+	for (uint32_t i = 0; i < Len; i++)
+	{
+		uint32_t x = Pos + i;
+
+		p[i] = (uint8_t)(x * 131 + (x >> 9) + Id * 17);
+	}
+}
+
+#endif	// __TEST_FATFS_H__
@@ -0,0 +1,315 @@
+/**-------------------------------------------------------------------------
+@file	test_fatfs_dir.cpp
+
+@brief	FatFS directory scan and name cache test
+
+Runs random creates, removes, lookups and directory creates and removes with
+mixed case names against a model, with several directory cache sizes on
+FAT16 and FAT32.  Counts the read commands of opens of a few names in a large
+directory of 10, 1000 and 10000 entries, which the name cache serves without
+a scan.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "test_fatfs.h"
+#include "test_util.h"
+
+#define IMG				"build/test_fatfs_dir.img"
+#define NBOPS			3000
+
+// Model : lower case path, true for a directory
+typedef std::map<std::string, bool> DIRMAP;
+
+static const char * const s_DirNames[] = {
+	"/A", "/Bee dir", "/A/Deep", "/Bee dir/x y"
+};
+
+static uint32_t s_Rand = 43;
+
+static uint32_t Random()
+{
+	s_Rand = s_Rand * 1103515245 + 12345;
+
+	return s_Rand >> 8;
+}
+
+static std::string Lower(const std::string &s)
+{
+	std::string l = s;
+
+	for (auto &c : l)
+	{
+		c = tolower(c);
+	}
+
+	return l;
+}
+
+// Same name, random case
+static std::string MixCase(const std::string &s)
+{
+	std::string l = s;
+
+	for (auto &c : l)
+	{
+		c = Random() & 1 ? toupper(c) : tolower(c);
+	}
+
+	return l;
+}
+
+// Upper and lower case 8.3 names, long names sharing a short name basis
+static std::string FileName(int Idx)
+{
+	char s[64];
+
+	switch (Idx % 3)
+	{
+		case 0:
+			snprintf(s, sizeof(s), "F%d.TXT", Idx);
+			break;
+		case 1:
+			snprintf(s, sizeof(s), "Long file name %d.data", Idx);
+			break;
+		default:
+			snprintf(s, sizeof(s), "longf%d.dat", Idx);
+			break;
+	}
+
+	return s;
+}
+
+static bool HasChild(const DIRMAP &Model, const std::string &Dir)
+{
+	std::string pre = Dir + "/";
+	auto it = Model.lower_bound(pre);
+
+	return it != Model.end() && it->first.compare(0, pre.size(), pre) == 0;
+}
+
+static void TestRandom(const char *pOpt, int DirCacheSize)
+{
+	TestFatDisk disk;
+	FatFS fs;
+	DIRMAP model;
+	std::vector<FATFS_DIRCACHE> cache(DirCacheSize);
+	FATFS_CFG cfg;
+	int bad = 0;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.pDirCache = cache.data();
+	cfg.DirCacheSize = DirCacheSize;
+
+	TEST_CHECK(TestFatDisk::Format(IMG, pOpt));
+	TEST_CHECK(disk.Open(IMG));
+	TEST_CHECK(fs.Init(&disk.Disk, cfg));
+
+	for (int n = 0; n < NBOPS; n++)
+	{
+		int d = Random() % 5;
+		std::string dir = d == 0 ? "" : s_DirNames[d - 1];
+		std::string path = dir + "/" + FileName(Random() % 60);
+		std::string key = Lower(path);
+		bool parent = d == 0 || model.count(Lower(dir)) > 0;
+		auto it = model.find(key);
+		bool exists = it != model.end();
+		DIR de;
+
+		switch (Random() % 6)
+		{
+			case 0:
+			case 1:
+			{
+				int fd = fs.Open(MixCase(path).c_str(), O_RDWR | O_CREAT | O_EXCL, 0);
+
+				bad += (fd >= 0) != (parent && !exists);
+				if (fd >= 0)
+				{
+					fs.Close(fd);
+					model[key] = false;
+				}
+				break;
+			}
+			case 2:
+				bad += fs.Remove(MixCase(path).c_str()) != exists;
+				if (exists)
+				{
+					model.erase(it);
+				}
+				break;
+			case 3:
+			{
+				// Directory, created or removed depending on its state
+				if (d == 0)
+				{
+					break;
+				}
+
+				std::string k = Lower(dir);
+
+				if (model.count(k))
+				{
+					bool empty = !HasChild(model, k);
+
+					bad += fs.Remove(MixCase(dir).c_str()) != empty;
+					if (empty)
+					{
+						model.erase(k);
+					}
+				}
+				else
+				{
+					std::string pk = Lower(dir.substr(0, dir.rfind('/')));
+					bool pexists = pk.empty() || model.count(pk) > 0;
+
+					bad += fs.MkDir(MixCase(dir).c_str()) != pexists;
+					if (pexists)
+					{
+						model[k] = true;
+					}
+				}
+				break;
+			}
+			default:
+				bad += fs.Find(MixCase(path).c_str(), &de) != exists;
+				break;
+		}
+	}
+	TEST_CHECK(bad == 0);
+	disk.Close();
+
+	// Remount, everything in the model found, nothing else
+	TEST_CHECK(disk.Open(IMG));
+	TEST_CHECK(fs.Init(&disk.Disk, cfg));
+	bad = 0;
+	for (auto &e : model)
+	{
+		DIR de;
+
+		bad += fs.Find(MixCase(e.first).c_str(), &de) == false;
+	}
+	for (int i = 0; i < 60; i++)
+	{
+		std::string path = "/" + FileName(i);
+		DIR de;
+
+		bad += fs.Find(path.c_str(), &de) != (model.count(Lower(path)) > 0);
+	}
+	TEST_CHECK(bad == 0);
+	printf("%s, %d cache entries : %zu names\n", pOpt, DirCacheSize, model.size());
+	disk.Close();
+
+	TEST_CHECK(TestFatDisk::Check(IMG) == 0);
+	TestFatDisk::Remove(IMG);
+}
+
+// Read commands per open in a directory of Cnt entries, random and hot names
+static void TestBigDir(int Cnt)
+{
+	TestFatDisk disk;
+	FatFS fs;
+	char s[64];
+
+	TEST_CHECK(TestFatDisk::Format(IMG, "-t 32 -c 4k -s 512M"));
+	TEST_CHECK(disk.Open(IMG));
+	TEST_CHECK(fs.Init(&disk.Disk));
+	TEST_CHECK(fs.MkDir("/big"));
+
+	for (int i = 0; i < Cnt; i++)
+	{
+		snprintf(s, sizeof(s), "/big/Sensor record %05d.csv", i);
+
+		int fd = fs.Open(s, O_RDWR | O_CREAT | O_EXCL, 0);
+
+		TEST_CHECK(fd >= 0);
+		fs.Close(fd);
+	}
+
+	uint32_t rdcnt = disk.Disk.ReadCmdCount();
+
+	for (int n = 0; n < 200; n++)
+	{
+		snprintf(s, sizeof(s), "/big/sensor RECORD %05u.csv", Random() % Cnt);
+
+		int fd = fs.Open(s, O_RDONLY, 0);
+
+		TEST_CHECK(fd >= 0);
+		fs.Close(fd);
+	}
+
+	double rdrand = (disk.Disk.ReadCmdCount() - rdcnt) / 200.0;
+
+	rdcnt = disk.Disk.ReadCmdCount();
+	for (int n = 0; n < 200; n++)
+	{
+		snprintf(s, sizeof(s), "/big/Sensor record %05d.csv", (n % 8) * Cnt / 8);
+
+		int fd = fs.Open(s, O_RDONLY, 0);
+
+		TEST_CHECK(fd >= 0);
+		fs.Close(fd);
+	}
+
+	double rdhot = (disk.Disk.ReadCmdCount() - rdcnt) / 200.0;
+
+	printf("%5d entries : %.1f reads per random open, %.1f per hot open\n", Cnt, rdrand, rdhot);
+
+	// A small directory fits the cache either way
+	TEST_CHECK(Cnt < 1000 || rdhot * 10 < rdrand);
+	disk.Close();
+
+	TEST_CHECK(TestFatDisk::Check(IMG) == 0);
+	TestFatDisk::Remove(IMG);
+}
+
+int main()
+{
+	static const int cachesize[] = { 1, 3, 6, 64 };
+
+	for (auto n : cachesize)
+	{
+		TestRandom("-t 16 -c 2k -s 32M", n);
+		TestRandom("-t 32 -c 512 -s 64M", n);
+	}
+	TestBigDir(10);
+	TestBigDir(1000);
+	TestBigDir(10000);
+
+	printf("fatfs_dir : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
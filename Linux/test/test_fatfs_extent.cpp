@@ -0,0 +1,254 @@
+/**-------------------------------------------------------------------------
+@file	test_fatfs_extent.cpp
+
+@brief	FatFS cluster extent cache test
+
+Fragments files on a FAT32 image with interleaved appends, then runs random
+seeks, reads, writes and truncates with two handles on the same file against
+a reference copy.  Counts the read commands per seek and the bytes per read
+command of sequential reads on a contiguous file.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <vector>
+
+#include "test_fatfs.h"
+#include "test_util.h"
+
+#define IMG				"build/test_fatfs_extent.img"
+#define NBFILE			2
+#define CONT_SIZE		(2 * 1024 * 1024)
+
+static uint32_t s_Rand = 42;
+
+static uint32_t Random()
+{
+	s_Rand = s_Rand * 1103515245 + 12345;
+
+	return s_Rand >> 8;
+}
+
+static bool Compare(FatFS &Fs, int Fd, const std::vector<uint8_t> &Ref, uint32_t Pos, uint32_t Len)
+{
+	uint8_t d[4096];
+
+	if (Fs.Seek(Fd, Pos) != (int)(Pos > Ref.size() ? Ref.size() : Pos))
+	{
+		return false;
+	}
+
+	uint32_t l = Pos >= Ref.size() ? 0 : Ref.size() - Pos;
+
+	l = l < Len ? l : Len;
+
+	return Fs.Read(Fd, d, Len) == (int)l && memcmp(d, &Ref[Pos], l) == 0;
+}
+
+// Files built with interleaved appends, one fragment per cluster or less
+static void TestFragmented(TestFatDisk &Disk, FatFS &Fs)
+{
+	std::vector<uint8_t> ref[NBFILE];
+	int fd[NBFILE];
+	uint8_t d[4096];
+
+	for (int i = 0; i < NBFILE; i++)
+	{
+		char s[32];
+
+		snprintf(s, sizeof(s), "/FRAG%d.BIN", i);
+		fd[i] = Fs.Open(s, O_RDWR | O_CREAT, 0);
+		TEST_CHECK(fd[i] >= 0);
+	}
+	for (int r = 0; r < 300; r++)
+	{
+		for (int i = 0; i < NBFILE; i++)
+		{
+			uint32_t l = 1 + Random() % 1500;
+			uint32_t pos = ref[i].size();
+
+			TestFatFill(d, i, pos, l);
+			TEST_CHECK(Fs.Write(fd[i], d, l) == (int)l);
+			ref[i].insert(ref[i].end(), d, d + l);
+		}
+	}
+	for (int i = 1; i < NBFILE; i++)
+	{
+		Fs.Close(fd[i]);
+	}
+
+	// Second handle keeps its own extents, it is reopened to see the size
+	// changed by writes and truncates of the first
+	Fs.Sync(fd[0]);
+
+	int fd2 = Fs.Open("/FRAG0.BIN", O_RDONLY, 0);
+	std::vector<uint8_t> &f = ref[0];
+	int bad = 0;
+
+	TEST_CHECK(fd2 >= 0);
+	for (int n = 0; n < 3000; n++)
+	{
+		uint32_t pos = Random() % (f.size() + 1000);
+		uint32_t len = 1 + Random() % sizeof(d);
+		int op = Random() % 20;
+
+		if (op == 0)
+		{
+			// Write inside or across end of file
+			pos = pos > f.size() ? f.size() : pos;
+			TestFatFill(d, n, pos, len);
+			if (Fs.Seek(fd[0], pos) != (int)pos || Fs.Write(fd[0], d, len) != (int)len)
+			{
+				bad++;
+			}
+			if (f.size() < pos + len)
+			{
+				f.resize(pos + len);
+			}
+			memcpy(&f[pos], d, len);
+			Fs.Sync(fd[0]);
+			Fs.Close(fd2);
+			fd2 = Fs.Open("/FRAG0.BIN", O_RDONLY, 0);
+		}
+		else if (op == 1 && f.size() > 100000)
+		{
+			uint32_t sz = f.size() - Random() % 20000;
+
+			if (Fs.Truncate(fd[0], sz) != 0)
+			{
+				bad++;
+			}
+			f.resize(sz);
+			Fs.Close(fd2);
+			fd2 = Fs.Open("/FRAG0.BIN", O_RDONLY, 0);
+		}
+		else if (Compare(Fs, op & 1 ? fd[0] : fd2, f, pos, len) == false)
+		{
+			bad++;
+		}
+	}
+	TEST_CHECK(bad == 0);
+
+	// Seek clamps to file size, also the largest offset
+	TEST_CHECK(Fs.Seek(fd2, 0xFFFFFFFF) == (int)f.size());
+	TEST_CHECK(Fs.Read(fd2, d, 1) == 0);
+
+	// Seek cost stays bounded once the table is full of seek points
+	uint32_t rdcnt = Disk.Disk.ReadCmdCount();
+
+	for (int n = 0; n < 1000; n++)
+	{
+		TEST_CHECK(Compare(Fs, fd2, f, Random() % f.size(), 512));
+	}
+	double rdseek = (Disk.Disk.ReadCmdCount() - rdcnt) / 1000.0;
+
+	printf("fragmented : %zu bytes, %.1f reads per seek\n", f.size(), rdseek);
+	TEST_CHECK(rdseek < 8.0);
+
+	Fs.Close(fd2);
+	Fs.Close(fd[0]);
+
+	for (int i = 0; i < NBFILE; i++)
+	{
+		char s[32];
+
+		snprintf(s, sizeof(s), "/FRAG%d.BIN", i);
+
+		int h = Fs.Open(s, O_RDONLY, 0);
+
+		TEST_CHECK(h >= 0 && Compare(Fs, h, ref[i], 0, 0) && Fs.Seek(h, 0xFFFFFFFF) == (int)ref[i].size());
+		for (uint32_t p = 0; p < ref[i].size(); p += sizeof(d))
+		{
+			TEST_CHECK(Compare(Fs, h, ref[i], p, sizeof(d)));
+		}
+		Fs.Close(h);
+	}
+}
+
+// Contiguous file, the whole chain fits one extent
+static void TestContiguous(TestFatDisk &Disk, FatFS &Fs)
+{
+	std::vector<uint8_t> ref(CONT_SIZE);
+	static uint8_t d[65536];
+	int fd = Fs.Open("/CONT.BIN", O_RDWR | O_CREAT, 0);
+
+	TEST_CHECK(fd >= 0);
+	TestFatFill(ref.data(), 99, 0, CONT_SIZE);
+	TEST_CHECK(Fs.Write(fd, ref.data(), CONT_SIZE) == CONT_SIZE);
+	Fs.Close(fd);
+
+	fd = Fs.Open("/CONT.BIN", O_RDONLY, 0);
+	TEST_CHECK(fd >= 0);
+
+	uint32_t rdcnt = Disk.Disk.ReadCmdCount();
+
+	for (int n = 0; n < 1000; n++)
+	{
+		TEST_CHECK(Compare(Fs, fd, ref, Random() % CONT_SIZE, 512));
+	}
+
+	double rdseek = (Disk.Disk.ReadCmdCount() - rdcnt) / 1000.0;
+
+	rdcnt = Disk.Disk.ReadCmdCount();
+	Fs.Seek(fd, 0);
+	for (uint32_t p = 0; p < CONT_SIZE; p += sizeof(d))
+	{
+		TEST_CHECK(Fs.Read(fd, d, sizeof(d)) == sizeof(d) && memcmp(d, &ref[p], sizeof(d)) == 0);
+	}
+
+	uint32_t kbrd = CONT_SIZE / 1024 / (Disk.Disk.ReadCmdCount() - rdcnt);
+
+	printf("contiguous : %.1f reads per seek, %u KB per read command\n", rdseek, kbrd);
+	TEST_CHECK(rdseek < 3.0);
+	TEST_CHECK(kbrd >= 32);
+	Fs.Close(fd);
+}
+
+int main()
+{
+	TestFatDisk disk;
+	FatFS fs;
+
+	TEST_CHECK(TestFatDisk::Format(IMG, "-t 32 -c 512 -s 64M"));
+	TEST_CHECK(disk.Open(IMG));
+	TEST_CHECK(fs.Init(&disk.Disk));
+
+	TestContiguous(disk, fs);
+	TestFragmented(disk, fs);
+	disk.Close();
+
+	TEST_CHECK(TestFatDisk::Check(IMG) == 0);
+	TestFatDisk::Remove(IMG);
+
+	printf("fatfs_extent : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,325 @@
+/**-------------------------------------------------------------------------
+@file	test_fatfs_handle.cpp
+
+@brief	FatFS file handle table and per handle buffer test
+
+Keeps 40 files open in a handle table of 96 with buffered sectors and runs
+random interleaved writes, reads, seeks and truncates against a model, with
+close and reopen and second handles on the same file.  Checks stale handles
+and the table size limit, and counts device commands of small appends with
+and without buffers.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <vector>
+
+#include "test_fatfs.h"
+#include "test_util.h"
+
+#define IMG				"build/test_fatfs_handle.img"
+#define NBFD			96
+#define NBFILE			40
+#define NBOPS			30000
+#define NBAPPEND_FILE	32
+#define APPEND_SIZE		(2 * 1024 * 1024)
+
+static FATFS_FD s_FdTbl[NBFD];
+static uint8_t s_FdBuff[NBFD * 4 * 512];
+
+static uint32_t s_Rand = 46;
+
+static uint32_t Random()
+{
+	s_Rand = s_Rand * 1103515245 + 12345;
+
+	return s_Rand >> 8;
+}
+
+static FATFS_CFG Config(int NbSect)
+{
+	FATFS_CFG cfg;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.pFdTbl = s_FdTbl;
+	cfg.FdTblSize = NBFD;
+	cfg.pFdBuff = NbSect > 0 ? s_FdBuff : NULL;
+	cfg.FdBuffSize = NbSect * 512 * NBFD;
+
+	return cfg;
+}
+
+static void Name(char *s, int Idx)
+{
+	sprintf(s, "/File number %02d.dat", Idx);
+}
+
+static void TestRandom(const char *pOpt, int NbSect)
+{
+	TestFatDisk disk;
+	FatFS fs;
+	std::vector<uint8_t> ref[NBFILE];
+	int fd[NBFILE];
+	uint8_t d[3000], rd[3000];
+	char s[64];
+	int bad = 0;
+
+	TEST_CHECK(TestFatDisk::Format(IMG, pOpt));
+	TEST_CHECK(disk.Open(IMG));
+	TEST_CHECK(fs.Init(&disk.Disk, Config(NbSect)));
+
+	for (int i = 0; i < NBFILE; i++)
+	{
+		Name(s, i);
+		fd[i] = fs.Open(s, O_RDWR | O_CREAT, 0);
+		TEST_CHECK(fd[i] >= 0);
+	}
+
+	for (int n = 0; n < NBOPS; n++)
+	{
+		int f = Random() % NBFILE;
+		std::vector<uint8_t> &r = ref[f];
+		uint32_t pos = Random() % (r.size() + 1);
+		uint32_t len = 1 + Random() % (n & 7 ? 64 : sizeof(d));
+		int op = Random() % 16;
+
+		if (op < 7)
+		{
+			// Write, mostly appends
+			pos = op < 4 ? r.size() : pos;
+			TestFatFill(d, n, pos, len);
+			bad += fs.Seek(fd[f], pos) != (int)pos || fs.Write(fd[f], d, len) != (int)len;
+			if (r.size() < pos + len)
+			{
+				r.resize(pos + len);
+			}
+			memcpy(&r[pos], d, len);
+		}
+		else if (op < 13)
+		{
+			uint32_t l = r.size() - pos < len ? r.size() - pos : len;
+
+			bad += fs.Seek(fd[f], pos) != (int)pos || fs.Read(fd[f], rd, len) != (int)l ||
+				   (l > 0 && memcmp(rd, &r[pos], l) != 0);
+		}
+		else if (op == 13)
+		{
+			uint32_t sz = pos > r.size() / 2 ? pos : r.size();
+
+			bad += fs.Truncate(fd[f], sz) != 0;
+			r.resize(sz);
+		}
+		else if (op == 14)
+		{
+			// Close and reopen, the handle must not be valid anymore
+			int old = fd[f];
+
+			fs.Close(fd[f]);
+			Name(s, f);
+			fd[f] = fs.Open(s, O_RDWR, 0);
+			bad += fd[f] < 0 || fs.Read(old, rd, 1) >= 0;
+		}
+		else
+		{
+			// Second writable handle on the same file, no sync, unbuffered
+			// while both are open.  Appends and reads interleaved on both.
+			Name(s, f);
+
+			int h = fs.Open(s, O_RDWR, 0);
+
+			bad += h < 0;
+			for (int k = 0; k < 6 && h >= 0; k++)
+			{
+				int g = k & 1 ? fd[f] : h;
+
+				len = 1 + Random() % sizeof(d);
+				if (Random() & 1)
+				{
+					pos = r.size();
+					TestFatFill(d, n + k, pos, len);
+					bad += fs.Seek(g, 0xFFFFFFFF) != (int)pos || fs.Write(g, d, len) != (int)len;
+					r.insert(r.end(), d, d + len);
+				}
+				else
+				{
+					pos = Random() % (r.size() + 1);
+
+					uint32_t l = r.size() - pos < len ? r.size() - pos : len;
+
+					bad += fs.Seek(g, pos) != (int)pos || fs.Read(g, rd, len) != (int)l ||
+						   (l > 0 && memcmp(rd, &r[pos], l) != 0);
+				}
+			}
+
+			// Either one closed first, the size written back by the other
+			// must include all appends
+			if (Random() & 1)
+			{
+				fs.Close(fd[f]);
+				fd[f] = h;
+			}
+			else
+			{
+				fs.Close(h);
+			}
+		}
+	}
+	TEST_CHECK(bad == 0);
+
+	for (int i = 0; i < NBFILE; i++)
+	{
+		fs.Close(fd[i]);
+	}
+	disk.Close();
+
+	// Remount and read back
+	TEST_CHECK(disk.Open(IMG));
+	TEST_CHECK(fs.Init(&disk.Disk, Config(NbSect)));
+	bad = 0;
+	for (int i = 0; i < NBFILE; i++)
+	{
+		std::vector<uint8_t> b(ref[i].size() + 1);
+
+		Name(s, i);
+
+		int h = fs.Open(s, O_RDONLY, 0);
+
+		bad += h < 0 || fs.Read(h, b.data(), b.size()) != (int)ref[i].size() ||
+			   memcmp(b.data(), ref[i].data(), ref[i].size()) != 0;
+		fs.Close(h);
+	}
+	TEST_CHECK(bad == 0);
+	printf("%s, %d sectors per handle : %d ops on %d files\n", pOpt, NbSect, NBOPS, NBFILE);
+	disk.Close();
+
+	TEST_CHECK(TestFatDisk::Check(IMG) == 0);
+	TestFatDisk::Remove(IMG);
+}
+
+// Handles up to the table size, no more
+static void TestTable()
+{
+	TestFatDisk disk;
+	FatFS fs;
+	int fd[NBFD];
+	char s[64];
+
+	TEST_CHECK(TestFatDisk::Format(IMG, "-t 16 -c 2k -s 32M"));
+	TEST_CHECK(disk.Open(IMG));
+	TEST_CHECK(fs.Init(&disk.Disk, Config(1)));
+
+	for (int i = 0; i < NBFD; i++)
+	{
+		Name(s, i);
+		fd[i] = fs.Open(s, O_RDWR | O_CREAT, 0);
+		TEST_CHECK(fd[i] >= 0);
+	}
+	TEST_CHECK(fs.Open("/ONEMORE.TXT", O_RDWR | O_CREAT, 0) < 0);
+	TEST_CHECK(fs.Close(fd[10]) == 0);
+	TEST_CHECK(fs.Close(fd[10]) < 0);
+
+	int h = fs.Open("/ONEMORE.TXT", O_RDWR | O_CREAT, 0);
+
+	TEST_CHECK(h >= 0 && h != fd[10]);
+	TEST_CHECK(fs.Write(fd[10], (uint8_t*)s, 1) < 0);
+	fs.Close(h);
+	for (int i = 0; i < NBFD; i++)
+	{
+		fs.Close(fd[i]);
+	}
+	disk.Close();
+
+	TEST_CHECK(TestFatDisk::Check(IMG) == 0);
+	TestFatDisk::Remove(IMG);
+}
+
+// 32 bytes records appended round robin to 32 files
+static uint32_t TestAppend(int NbSect)
+{
+	TestFatDisk disk;
+	FatFS fs;
+	int fd[NBAPPEND_FILE];
+	uint8_t d[32];
+	char s[64];
+
+	TEST_CHECK(TestFatDisk::Format(IMG, "-t 32 -c 4k -s 300M"));
+	TEST_CHECK(disk.Open(IMG));
+	TEST_CHECK(fs.Init(&disk.Disk, Config(NbSect)));
+
+	for (int i = 0; i < NBAPPEND_FILE; i++)
+	{
+		Name(s, i);
+		fd[i] = fs.Open(s, O_RDWR | O_CREAT, 0);
+		TEST_CHECK(fd[i] >= 0);
+	}
+
+	uint32_t wrcnt = disk.Disk.WriteCmdCount();
+
+	for (uint32_t p = 0; p < APPEND_SIZE / NBAPPEND_FILE; p += sizeof(d))
+	{
+		for (int i = 0; i < NBAPPEND_FILE; i++)
+		{
+			TestFatFill(d, i, p, sizeof(d));
+			TEST_CHECK(fs.Write(fd[i], d, sizeof(d)) == sizeof(d));
+		}
+	}
+	for (int i = 0; i < NBAPPEND_FILE; i++)
+	{
+		fs.Close(fd[i]);
+	}
+	disk.Disk.Flush();
+	wrcnt = disk.Disk.WriteCmdCount() - wrcnt;
+	printf("%d sectors per handle : %u write commands for %d bytes appends\n", NbSect, wrcnt, (int)sizeof(d));
+	disk.Close();
+
+	TEST_CHECK(TestFatDisk::Check(IMG) == 0);
+	TestFatDisk::Remove(IMG);
+
+	return wrcnt;
+}
+
+int main()
+{
+	TestRandom("-t 16 -c 2k -s 32M", 0);
+	TestRandom("-t 16 -c 2k -s 32M", 4);
+	TestRandom("-t 32 -c 512 -s 64M", 1);
+	TestRandom("-t 32 -c 4k -s 300M", 4);
+	TestTable();
+
+	uint32_t nobuf = TestAppend(0);
+	uint32_t buf = TestAppend(4);
+
+	TEST_CHECK(buf * 50 < nobuf);
+
+	printf("fatfs_handle : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,424 @@
+/**-------------------------------------------------------------------------
+@file	test_fatfs_log.cpp
+
+@brief	FatFS preallocation and streaming logger test
+
+Reserves clusters with Allocate, writes file data straight to the disk at the
+locations given by Map and sets the size with SetSize.  Runs FatFSLog
+sessions and power cuts while logging, every record appended before the
+last Sync must be read back in order.  Then logs on the SD card simulator
+with latency spikes and reports the longest record append and the sustained
+throughput against plain Write and Sync.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <vector>
+
+#include "test_fatfs.h"
+#include "fatfs_log.h"
+#include "sdcard.h"
+#include "sdcard_sim.h"
+#include "test_util.h"
+
+#define IMG				"build/test_fatfs_log.img"
+#define ALLOC_SIZE		(1024 * 1024)
+#define LOG_SIZE		(16 * 1024 * 1024)
+#define NBSESSION		40
+#define SD_IMG			"build/test_fatfs_log_sd.img"
+#define SD_NBBLK		(64 * 1024 * 1024 / 512)
+#define SD_NBREC		40000
+#define SD_SPIKE_RATE	200			// 1 in 200 blocks delayed
+#define SD_SPIKE_MAX	20000		// by up to 20ms
+
+static uint8_t s_LogBuff[8 * 512];
+
+static const FATFSLOG_CFG s_LogCfg = {
+	"/log.bin",
+	LOG_SIZE,
+	16,
+	s_LogBuff,
+	sizeof(s_LogBuff)
+};
+
+static const FATFSLOG_CFG s_SdLogCfg = {
+	"/sdlog.bin",
+	4 * 1024 * 1024,
+	64,
+	s_LogBuff,
+	sizeof(s_LogBuff)
+};
+
+static const SDCARDSIM_TIMING s_SdTiming = {
+	25000000, 1000,			// 25MHz SPI, 1us per transfer
+	500, 100,				// Read access, first and following stream blocks
+	1500, 400, 250,			// Program single, stream and pre-erased stream blocks
+	500,					// Busy after stream stop
+	256, 40000,				// 40ms garbage collection stall
+};
+
+static uint32_t s_Rand = 45;
+
+static uint32_t Random()
+{
+	s_Rand = s_Rand * 1103515245 + 12345;
+
+	return s_Rand >> 8;
+}
+
+// Record of sequence number Seq, its length depends on Seq
+static int MakeRec(uint32_t Seq, uint8_t *p)
+{
+	int l = 4 + (Seq * 2654435761u >> 24) % 200;
+
+	memcpy(p, &Seq, 4);
+	TestFatFill(p + 4, Seq, 0, l - 4);
+
+	return l;
+}
+
+static void TestAllocate(TestFatDisk &Disk, FatFS &Fs)
+{
+	uint32_t clus = Fs.GetClusterSize();
+	uint32_t freecnt = Fs.GetFreeCount();
+	std::vector<uint8_t> d(ALLOC_SIZE);
+	uint64_t off;
+	int fd = Fs.Open("/PREALLOC.BIN", O_RDWR | O_CREAT, 0);
+
+	TEST_CHECK(fd >= 0);
+	TEST_CHECK(Fs.Allocate(fd, ALLOC_SIZE) == 0);
+	TEST_CHECK(Fs.GetFreeCount() == freecnt - ALLOC_SIZE / clus);
+
+	// One run on an empty disk, size unchanged
+	TEST_CHECK(Fs.Map(fd, 0, off) == ALLOC_SIZE);
+	TEST_CHECK(Fs.Seek(fd, 0xFFFFFFFF) == 0);
+	TEST_CHECK(Fs.Map(fd, ALLOC_SIZE, off) == 0);
+
+	// Data written straight to the disk then made visible by SetSize
+	TestFatFill(d.data(), 45, 0, ALLOC_SIZE);
+	TEST_CHECK(Fs.Map(fd, 0, off) == ALLOC_SIZE);
+	TEST_CHECK(Disk.Disk.Write(off, d.data(), ALLOC_SIZE / 2) == ALLOC_SIZE / 2);
+	TEST_CHECK(Fs.SetSize(fd, ALLOC_SIZE / 2) == 0);
+	TEST_CHECK(Fs.SetSize(fd, ALLOC_SIZE + 1) < 0);
+
+	// Write into the reservation does not give back the rest of it
+	TEST_CHECK(Fs.Seek(fd, ALLOC_SIZE / 2) == ALLOC_SIZE / 2);
+	TEST_CHECK(Fs.Write(fd, &d[ALLOC_SIZE / 2], 1000) == 1000);
+	TEST_CHECK(Fs.GetFreeCount() == freecnt - ALLOC_SIZE / clus);
+	Fs.Close(fd);
+
+	// A file in the way, the reservation continues in another run
+	int fd2 = Fs.Open("/BLOCK.BIN", O_RDWR | O_CREAT, 0);
+
+	TEST_CHECK(fd2 >= 0 && Fs.Write(fd2, d.data(), clus) == (int)clus);
+	Fs.Close(fd2);
+
+	fd = Fs.Open("/PREALLOC.BIN", O_RDWR, 0);
+	TEST_CHECK(fd >= 0 && Fs.Allocate(fd, 2 * ALLOC_SIZE) == 0);
+	TEST_CHECK(Fs.Map(fd, ALLOC_SIZE, off) == ALLOC_SIZE);
+	TEST_CHECK(Disk.Disk.Write(off, d.data(), ALLOC_SIZE) == ALLOC_SIZE);
+	TEST_CHECK(Fs.SetSize(fd, 2 * ALLOC_SIZE) == 0);
+	Fs.Close(fd);
+
+	fd = Fs.Open("/PREALLOC.BIN", O_RDONLY, 0);
+
+	std::vector<uint8_t> rd(2 * ALLOC_SIZE);
+
+	TEST_CHECK(fd >= 0 && Fs.Read(fd, rd.data(), rd.size()) == (int)rd.size());
+	TEST_CHECK(memcmp(rd.data(), d.data(), ALLOC_SIZE / 2 + 1000) == 0);
+	TEST_CHECK(memcmp(&rd[ALLOC_SIZE], d.data(), ALLOC_SIZE) == 0);
+	Fs.Close(fd);
+
+	// Truncate gives back the clusters
+	TEST_CHECK(Fs.Remove("/PREALLOC.BIN"));
+	TEST_CHECK(Fs.Remove("/BLOCK.BIN"));
+	TEST_CHECK(Fs.GetFreeCount() == freecnt);
+}
+
+// Read all records, they must be consecutive from 0
+static int ReadLog(FatFS &Fs, const FATFSLOG_CFG &Cfg = s_LogCfg)
+{
+	FatFSLog log;
+	uint8_t d[512], ref[512];
+	uint32_t pos = 0;
+	int n = 0, l;
+
+	if (log.Init(Cfg, &Fs) == false)
+	{
+		return -1;
+	}
+	while ((l = log.Read(pos, d, sizeof(d))) >= 0)
+	{
+		if (l != MakeRec(n, ref) || memcmp(d, ref, l) != 0)
+		{
+			printf("record %d bad\n", n);
+			log.Close();
+			return -1;
+		}
+		n++;
+	}
+	log.Close();
+
+	return n;
+}
+
+static void TestLog(TestFatDisk &Disk, FatFS &Fs)
+{
+	uint8_t d[512];
+	uint32_t seq = 0;
+	uint32_t rdcnt = Disk.Disk.ReadCmdCount();
+
+	// Three clean sessions
+	for (int s = 0; s < 3; s++)
+	{
+		FatFSLog log;
+
+		TEST_CHECK(log.Init(s_LogCfg, &Fs));
+		for (int i = 0; i < 3000; i++, seq++)
+		{
+			TEST_CHECK(log.Append(d, MakeRec(seq, d)));
+		}
+		TEST_CHECK(log.Close());
+	}
+	printf("log : %u records, %u read commands\n", seq, Disk.Disk.ReadCmdCount() - rdcnt);
+	TEST_CHECK(ReadLog(Fs) == (int)seq);
+
+	// Power cut while logging, records up to the last Sync are kept
+	int cuts = 0, extra = 0;
+
+	for (int s = 0; s < NBSESSION; s++)
+	{
+		FatFSLog log;
+		FILEDISKIO_FAULT fault = { 0, 0, 0, 1 + Random() % 600 };
+		uint32_t synced = seq;
+
+		TEST_CHECK(log.Init(s_LogCfg, &Fs));
+		Disk.Disk.SetFault(fault);
+		for (int i = 0; i < 2000 && Disk.Disk.PowerLost() == false; i++, seq++)
+		{
+			bool res = log.Append(d, MakeRec(seq, d));
+
+			TEST_CHECK(res || Disk.Disk.PowerLost());
+			if (i % 100 == 99 && log.Sync() && Disk.Disk.PowerLost() == false)
+			{
+				synced = seq + 1;
+			}
+		}
+
+		if (Disk.Disk.PowerLost())
+		{
+			cuts++;
+			Disk.Disk.PowerRestore();
+			TEST_CHECK(Fs.Init(&Disk.Disk));
+		}
+		else
+		{
+			fault.PowerLossWrite = 0;
+			Disk.Disk.SetFault(fault);
+			TEST_CHECK(log.Close());
+			synced = seq;
+		}
+
+		int n = ReadLog(Fs);
+
+		if (n < (int)synced)
+		{
+			printf("session %d : %d records read, %u synced\n", s, n, synced);
+			TEST_CHECK(n >= (int)synced);
+			break;
+		}
+		extra += n - synced;
+		seq = n;
+	}
+	printf("power cuts : %d of %d sessions, %d records past the last sync recovered\n",
+		   cuts, NBSESSION, extra);
+	TEST_CHECK(cuts > NBSESSION / 4 && cuts < NBSESSION);
+}
+
+typedef struct {
+	double MaxUs;			// Longest record append
+	double AvgUs;
+	double KBs;				// Sustained throughput, records back to back
+} LOGRESULT;
+
+// SD_NBREC records appended back to back with FatFSLog, or with Write and a
+// Sync every 32KB as the size is committed every 64 sectors by the logger
+static LOGRESULT RunSd(SdCardSim &Sim, FatFS &Fs, bool bLog)
+{
+	FatFSLog log;
+	LOGRESULT res;
+	uint8_t d[512];
+	uint64_t maxt = 0, bytes = 0, synced = 0;
+	int fd = -1;
+	int bad = 0;
+
+	if (bLog)
+	{
+		TEST_CHECK(log.Init(s_SdLogCfg, &Fs));
+	}
+	else
+	{
+		fd = Fs.Open("/sdplain.bin", O_RDWR | O_CREAT, 0);
+		TEST_CHECK(fd >= 0);
+	}
+
+	uint64_t t0 = Sim.Time();
+
+	for (int n = 0; n < SD_NBREC; n++)
+	{
+		int l = MakeRec(n, d);
+		uint64_t t = Sim.Time();
+
+		if (bLog)
+		{
+			bad += log.Append(d, l) == false;
+		}
+		else
+		{
+			bad += Fs.Write(fd, d, l) != l;
+			if (bytes + l - synced >= 32768)
+			{
+				bad += Fs.Sync(fd) != 0;
+				synced = bytes + l;
+			}
+		}
+		t = Sim.Time() - t;
+		maxt = t > maxt ? t : maxt;
+		bytes += l;
+	}
+
+	uint64_t t = Sim.Time() - t0;
+
+	if (bLog)
+	{
+		TEST_CHECK(log.Close());
+	}
+	else
+	{
+		Fs.Close(fd);
+	}
+
+	res.MaxUs = maxt / 1e3;
+	res.AvgUs = t / 1e3 / SD_NBREC;
+	res.KBs = bytes / (t / 1e9) / 1024;
+
+	TEST_CHECK(bad == 0);
+
+	return res;
+}
+
+// Plain file holds the records back to back
+static bool CheckPlain(FatFS &Fs)
+{
+	uint8_t d[512], ref[512];
+	int fd = Fs.Open("/sdplain.bin", O_RDONLY, 0);
+	bool res = fd >= 0;
+
+	for (int n = 0; n < SD_NBREC && res; n++)
+	{
+		int l = MakeRec(n, ref);
+
+		res = Fs.Read(fd, d, l) == l && memcmp(d, ref, l) == 0;
+	}
+	Fs.Close(fd);
+
+	return res;
+}
+
+// Logger on the SD card simulator with garbage collection stalls and random
+// latency spikes
+static void TestLogSd()
+{
+	static const SDCARDSIM_CFG simcfg = { SD_NBBLK, &s_SdTiming };
+	static DISKIO_CACHE_DESC cache[TEST_FATFS_NBCACHE];
+	static uint8_t cachemem[TEST_FATFS_NBCACHE][512];
+	SdCardSim sim;
+	SDCard sd;
+	FatFS fs;
+
+	TEST_CHECK(TestFatDisk::Format(SD_IMG, "-t 16 -c 4k -s 64M"));
+	TEST_CHECK(sim.Init(simcfg));
+	TEST_CHECK(TestFatDisk::Load(SD_IMG, sim.Mem(), SD_NBBLK * 512));
+	sim.Spikes(SD_SPIKE_RATE, SD_SPIKE_MAX, 45);
+
+	for (int i = 0; i < TEST_FATFS_NBCACHE; i++)
+	{
+		cache[i].pSectData = cachemem[i];
+	}
+	TEST_CHECK(sd.Init(&sim, cache, TEST_FATFS_NBCACHE));
+	TEST_CHECK(fs.Init(&sd));
+
+	LOGRESULT w = RunSd(sim, fs, false);
+	LOGRESULT l = RunSd(sim, fs, true);
+
+	printf("SD %u MHz, %d records, 1 in %d blocks delayed up to %d ms, %u ms GC stalls\n",
+		   s_SdTiming.ClkRate / 1000000, SD_NBREC, SD_SPIKE_RATE, SD_SPIKE_MAX / 1000, s_SdTiming.GcTime / 1000);
+	printf("Write + Sync : max %6.2f ms, avg %5.1f us, %6.0f KB/s\n", w.MaxUs / 1e3, w.AvgUs, w.KBs);
+	printf("FatFSLog     : max %6.2f ms, avg %5.1f us, %6.0f KB/s\n", l.MaxUs / 1e3, l.AvgUs, l.KBs);
+	printf("%u spikes, %u GC stalls\n", sim.SpikeCount(), sim.GcCount());
+
+	TEST_CHECK(ReadLog(fs, s_SdLogCfg) == SD_NBREC);
+	TEST_CHECK(CheckPlain(fs));
+	TEST_CHECK(sim.SpikeCount() > 0 && sim.GcCount() > 0);
+	TEST_CHECK(sim.ProtoErrorCount() == 0 && sim.CrcErrorCount() == 0);
+
+	// One buffer write and one commit, each hit by at most a stall and a spike
+	TEST_CHECK(l.MaxUs < 2 * (s_SdTiming.GcTime + SD_SPIKE_MAX));
+	TEST_CHECK(l.KBs > 2 * w.KBs);
+
+	sd.Flush();
+	TEST_CHECK(TestFatDisk::Save(SD_IMG, sim.Mem(), SD_NBBLK * 512));
+	TEST_CHECK(TestFatDisk::Check(SD_IMG) == 0);
+	TestFatDisk::Remove(SD_IMG);
+}
+
+int main()
+{
+	TestFatDisk disk;
+	FatFS fs;
+
+	TEST_CHECK(TestFatDisk::Format(IMG, "-t 32 -c 4k -s 300M"));
+	TEST_CHECK(disk.Open(IMG));
+	TEST_CHECK(fs.Init(&disk.Disk));
+
+	TestAllocate(disk, fs);
+	TestLog(disk, fs);
+	disk.Close();
+
+	TEST_CHECK(TestFatDisk::Check(IMG) == 0);
+	TestFatDisk::Remove(IMG);
+
+	TestLogSd();
+
+	printf("fatfs_log : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
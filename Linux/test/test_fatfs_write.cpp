@@ -0,0 +1,480 @@
+/**-------------------------------------------------------------------------
+@file	test_fatfs_write.cpp
+
+@brief	FatFS write test
+
+Creates, appends, overwrites, truncates and removes files and directories on
+FAT16 and FAT32 images, with short, lower case and long names.  Contents are
+checked against a reference after a remount and the images are validated with
+fatimg check, and fsck.fat when installed.  Measures the sustained append rate
+of a 16MB file on the SD card simulator.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "test_fatfs.h"
+#include "sdcard.h"
+#include "sdcard_sim.h"
+#include "test_util.h"
+
+#define RATE_IMG		"build/test_fatfs_rate.img"
+#define RATE_NBBLK		(64 * 1024 * 1024 / 512)
+#define RATE_SIZE		(16 * 1024 * 1024)
+#define RATE_WINDOW		(1024 * 1024)
+
+typedef std::map<std::string, std::vector<uint8_t>> FILEMAP;
+
+static const SDCARDSIM_TIMING s_SdTiming = {
+	25000000, 1000,			// 25MHz SPI, 1us per transfer
+	500, 100,				// Read access, first and following stream blocks
+	1500, 400, 250,			// Program single, stream and pre-erased stream blocks
+	500,					// Busy after stream stop
+	256, 50000,				// Garbage collection
+};
+
+static uint32_t s_Rand = 41;
+
+static uint32_t Random()
+{
+	s_Rand = s_Rand * 1103515245 + 12345;
+
+	return s_Rand >> 8;
+}
+
+static bool WriteAt(FatFS &Fs, FILEMAP &Ref, const std::string &Name, uint32_t Pos, uint32_t Len)
+{
+	std::vector<uint8_t> &f = Ref[Name];
+	std::vector<uint8_t> d(Len);
+	int fd = Fs.Open(Name.c_str(), O_RDWR | O_CREAT, 0);
+
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	TestFatFill(d.data(), Name.size() + Len, Pos, Len);
+	Pos = Pos > f.size() ? f.size() : Pos;
+
+	bool res = Fs.Seek(fd, Pos) == (int)Pos && Fs.Write(fd, d.data(), Len) == (int)Len;
+
+	Fs.Close(fd);
+
+	if (f.size() < Pos + Len)
+	{
+		f.resize(Pos + Len);
+	}
+	memcpy(&f[Pos], d.data(), Len);
+
+	return res;
+}
+
+static bool Verify(FatFS &Fs, FILEMAP &Ref)
+{
+	for (auto &e : Ref)
+	{
+		int fd = Fs.Open(e.first.c_str(), O_RDONLY, 0);
+
+		if (fd < 0)
+		{
+			printf("%s not found\n", e.first.c_str());
+			return false;
+		}
+
+		std::vector<uint8_t> d(e.second.size() + 100);
+		int l = Fs.Read(fd, d.data(), d.size());
+
+		Fs.Close(fd);
+		if (l != (int)e.second.size() || memcmp(d.data(), e.second.data(), l) != 0)
+		{
+			printf("%s : %d bytes read, %zu expected\n", e.first.c_str(), l, e.second.size());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void TestVolume(const char *pImg, const char *pOpt)
+{
+	TestFatDisk disk;
+	FatFS fs;
+	FILEMAP ref;
+
+	printf("%s\n", pOpt);
+	TEST_CHECK(TestFatDisk::Format(pImg, pOpt));
+	TEST_CHECK(disk.Open(pImg));
+	TEST_CHECK(fs.Init(&disk.Disk));
+
+	std::vector<std::string> names;
+
+	// 8.3, lower case, long names and long names sharing a short name basis
+	for (int i = 0; i < 12; i++)
+	{
+		char s[64];
+
+		snprintf(s, sizeof(s), "/FILE%d.BIN", i);
+		names.push_back(s);
+		snprintf(s, sizeof(s), "/data%d.txt", i);
+		names.push_back(s);
+		snprintf(s, sizeof(s), "/Long file name number %d.data", i);
+		names.push_back(s);
+	}
+	TEST_CHECK(fs.MkDir("/sub"));
+	TEST_CHECK(fs.MkDir("/sub/deeper dir"));
+	TEST_CHECK(fs.MkDir("/sub") == false);
+	for (int i = 0; i < 6; i++)
+	{
+		char s[64];
+
+		snprintf(s, sizeof(s), "/sub/deeper dir/log %d.csv", i);
+		names.push_back(s);
+	}
+
+	// Directories grow with the entries, they do not shrink
+	for (auto &n : names)
+	{
+		int fd = fs.Open(n.c_str(), O_RDWR | O_CREAT | O_EXCL, 0);
+
+		TEST_CHECK(fd >= 0);
+		fs.Close(fd);
+		ref[n].clear();
+	}
+
+	uint32_t freecnt = fs.GetFreeCount();
+
+	// Interleaved appends fragment the files
+	for (int r = 0; r < 4; r++)
+	{
+		for (auto &n : names)
+		{
+			TEST_CHECK(WriteAt(fs, ref, n, 0xFFFFFFFF, 1 + Random() % 3000));
+		}
+	}
+
+	// Overwrite inside and across end of file
+	for (auto &n : names)
+	{
+		uint32_t sz = ref[n].size();
+
+		TEST_CHECK(WriteAt(fs, ref, n, Random() % sz, 1 + Random() % 2000));
+	}
+
+	// Existing file with O_EXCL
+	TEST_CHECK(fs.Open(names[0].c_str(), O_RDWR | O_CREAT | O_EXCL, 0) < 0);
+
+	// Truncate, O_TRUNC and remove
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		std::string &n = names[i];
+
+		if (i % 3 == 0)
+		{
+			TEST_CHECK(fs.Remove(n.c_str()));
+			ref.erase(n);
+		}
+		else if (i % 3 == 1)
+		{
+			int fd = fs.Open(n.c_str(), O_RDWR, 0);
+			uint32_t sz = ref[n].size() / 3;
+
+			TEST_CHECK(fd >= 0 && fs.Truncate(fd, sz) == 0);
+			fs.Close(fd);
+			ref[n].resize(sz);
+		}
+		else if (i % 5 == 2)
+		{
+			int fd = fs.Open(n.c_str(), O_RDWR | O_TRUNC, 0);
+
+			TEST_CHECK(fd >= 0);
+			fs.Close(fd);
+			ref[n].clear();
+		}
+	}
+
+	// Directory not empty
+	TEST_CHECK(fs.Remove("/sub/deeper dir") == false);
+	TEST_CHECK(fs.Remove("/FILE0.BIN") == false);
+	TEST_CHECK(Verify(fs, ref));
+	disk.Close();
+
+	// Remount
+	TEST_CHECK(disk.Open(pImg));
+	TEST_CHECK(fs.Init(&disk.Disk));
+	TEST_CHECK(Verify(fs, ref));
+
+	// Removing all files gives their clusters back
+	for (auto &e : ref)
+	{
+		TEST_CHECK(fs.Remove(e.first.c_str()));
+	}
+	TEST_CHECK(fs.GetFreeCount() == freecnt);
+	TEST_CHECK(fs.Remove("/sub/deeper dir"));
+	TEST_CHECK(fs.Remove("/sub"));
+	TEST_CHECK(fs.GetFreeCount() > freecnt);
+	disk.Close();
+
+	TEST_CHECK(TestFatDisk::Check(pImg) == 0);
+	TestFatDisk::Remove(pImg);
+}
+
+// Fill disk, remove every other file and fill again
+static void TestFull(const char *pImg)
+{
+	TestFatDisk disk;
+	FatFS fs;
+	FILEMAP ref;
+	int nfile = 0;
+
+	TEST_CHECK(TestFatDisk::Format(pImg, "-t 16 -c 512 -s 4M"));
+	TEST_CHECK(disk.Open(pImg));
+	TEST_CHECK(fs.Init(&disk.Disk));
+
+	for (int i = 0; fs.GetFreeCount() > 0 && i < 400; i++)
+	{
+		char s[32];
+
+		snprintf(s, sizeof(s), "/F%03d", i);
+		if (WriteAt(fs, ref, s, 0, 20000) == false)
+		{
+			// Partly written up to disk full
+			int fd = fs.Open(s, O_RDONLY, 0);
+			uint32_t l = fd >= 0 ? fs.Read(fd, ref[s].data(), 20000) : 0;
+
+			fs.Close(fd);
+			ref[s].resize(l);
+			break;
+		}
+		nfile++;
+	}
+	printf("disk full after %d files\n", nfile);
+	TEST_CHECK(fs.GetFreeCount() == 0);
+
+	for (int i = 0; i < nfile; i += 2)
+	{
+		char s[32];
+
+		snprintf(s, sizeof(s), "/F%03d", i);
+		TEST_CHECK(fs.Remove(s));
+		ref.erase(s);
+	}
+	for (int i = 0; i < nfile / 2; i++)
+	{
+		char s[32];
+
+		snprintf(s, sizeof(s), "/G%03d", i);
+		TEST_CHECK(WriteAt(fs, ref, s, 0, 19000));
+	}
+	TEST_CHECK(Verify(fs, ref));
+	disk.Close();
+
+	TEST_CHECK(TestFatDisk::Check(pImg) == 0);
+	TestFatDisk::Remove(pImg);
+}
+
+// Two writable handles on one file, appends of one seen by the other without
+// sync, and none writing back a stale size on close
+static void TestTwoWriters(const char *pImg)
+{
+	TestFatDisk disk;
+	FatFS fs;
+	FILEMAP ref;
+	std::vector<uint8_t> &f = ref["/TWO.BIN"];
+	std::vector<uint8_t> d(8000);
+	int fd[2];
+
+	TEST_CHECK(TestFatDisk::Format(pImg, "-t 16 -c 512 -s 8M"));
+	TEST_CHECK(disk.Open(pImg));
+	TEST_CHECK(fs.Init(&disk.Disk));
+
+	// Second handle opened while the first one has appended without sync
+	fd[0] = fs.Open("/TWO.BIN", O_RDWR | O_CREAT, 0);
+	TestFatFill(d.data(), 2, 0, 4000);
+	TEST_CHECK(fs.Write(fd[0], d.data(), 4000) == 4000);
+	f.assign(d.begin(), d.begin() + 4000);
+	fd[1] = fs.Open("/TWO.BIN", O_RDWR, 0);
+	TEST_CHECK(fd[0] >= 0 && fd[1] >= 0);
+	TEST_CHECK(fs.Seek(fd[1], 0xFFFFFFFF) == 4000);
+
+	for (int i = 0; i < 200; i++)
+	{
+		int h = Random() & 1;
+		uint32_t len = 1 + Random() % 3000;
+
+		if (i == 100)
+		{
+			// Close and reopen one, the other keeps going
+			TEST_CHECK(fs.Close(fd[h]) == 0);
+			fd[h] = fs.Open("/TWO.BIN", O_RDWR, 0);
+			TEST_CHECK(fd[h] >= 0);
+		}
+
+		switch (Random() % 3)
+		{
+			case 0:		// Append
+				TestFatFill(d.data(), 2, f.size(), len);
+				TEST_CHECK(fs.Seek(fd[h], 0xFFFFFFFF) == (int)f.size());
+				TEST_CHECK(fs.Write(fd[h], d.data(), len) == (int)len);
+				f.insert(f.end(), d.begin(), d.begin() + len);
+				break;
+			case 1:		// Overwrite inside or across end of file
+			{
+				uint32_t pos = Random() % f.size();
+
+				TestFatFill(d.data(), 3, pos, len);
+				TEST_CHECK(fs.Seek(fd[h], pos) == (int)pos);
+				TEST_CHECK(fs.Write(fd[h], d.data(), len) == (int)len);
+				if (f.size() < pos + len)
+				{
+					f.resize(pos + len);
+				}
+				memcpy(&f[pos], d.data(), len);
+				break;
+			}
+			default:	// Read back to end of file
+			{
+				uint32_t pos = Random() % f.size();
+				uint32_t l = f.size() - pos;
+
+				l = l > d.size() ? d.size() : l;
+				TEST_CHECK(fs.Seek(fd[h], pos) == (int)pos);
+				TEST_CHECK(fs.Read(fd[h], d.data(), d.size()) == (int)l);
+				TEST_CHECK(memcmp(d.data(), &f[pos], l) == 0);
+			}
+		}
+	}
+
+	TEST_CHECK(fs.Close(fd[0]) == 0);
+	TEST_CHECK(fs.Close(fd[1]) == 0);
+	printf("two writers : %zu bytes\n", f.size());
+	TEST_CHECK(Verify(fs, ref));
+	disk.Close();
+
+	TEST_CHECK(TestFatDisk::Check(pImg) == 0);
+	TestFatDisk::Remove(pImg);
+}
+
+// Appends of random sizes to one open file on the SD card simulator, rate
+// over each window must hold as the file and its cluster chain grow
+static void TestAppendRate()
+{
+	static const SDCARDSIM_CFG simcfg = { RATE_NBBLK, &s_SdTiming };
+	static DISKIO_CACHE_DESC cache[TEST_FATFS_NBCACHE];
+	static uint8_t cachemem[TEST_FATFS_NBCACHE][512];
+	static uint8_t d[4096];
+	std::vector<double> rate;
+	SdCardSim sim;
+	SDCard sd;
+	FatFS fs;
+	int bad = 0;
+
+	TEST_CHECK(TestFatDisk::Format(RATE_IMG, "-t 32 -c 512 -s 64M"));
+	TEST_CHECK(sim.Init(simcfg));
+	TEST_CHECK(TestFatDisk::Load(RATE_IMG, sim.Mem(), RATE_NBBLK * 512));
+	for (int i = 0; i < TEST_FATFS_NBCACHE; i++)
+	{
+		cache[i].pSectData = cachemem[i];
+	}
+	TEST_CHECK(sd.Init(&sim, cache, TEST_FATFS_NBCACHE));
+	TEST_CHECK(fs.Init(&sd));
+
+	int fd = fs.Open("/APPEND.BIN", O_RDWR | O_CREAT, 0);
+	uint32_t pos = 0;
+	uint64_t t = sim.Time();
+
+	TEST_CHECK(fd >= 0);
+	while (pos < RATE_SIZE)
+	{
+		uint32_t len = 1 + Random() % sizeof(d);
+
+		len = pos + len > RATE_SIZE ? RATE_SIZE - pos : len;
+		TestFatFill(d, 41, pos, len);
+		bad += fs.Write(fd, d, len) != (int)len;
+
+		// Window boundary crossed
+		if ((pos + len) / RATE_WINDOW != pos / RATE_WINDOW)
+		{
+			rate.push_back(RATE_WINDOW / ((sim.Time() - t) / 1e3));
+			t = sim.Time();
+		}
+		pos += len;
+	}
+	fs.Close(fd);
+	sd.Flush();
+
+	double rmin = rate[0], rmax = rate[0];
+
+	for (auto r : rate)
+	{
+		rmin = r < rmin ? r : rmin;
+		rmax = r > rmax ? r : rmax;
+	}
+	printf("append %u MB : %.2f MB/s first, %.2f last, %.2f to %.2f per MB\n",
+		   RATE_SIZE >> 20, rate.front(), rate.back(), rmin, rmax);
+
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(rate.size() == RATE_SIZE / RATE_WINDOW);
+	TEST_CHECK(rmin > rmax * 0.7);
+	TEST_CHECK(sim.ProtoErrorCount() == 0 && sim.CrcErrorCount() == 0);
+
+	// Content read back
+	fd = fs.Open("/APPEND.BIN", O_RDONLY, 0);
+	TEST_CHECK(fd >= 0);
+	for (pos = 0; pos < RATE_SIZE; pos += sizeof(d))
+	{
+		uint8_t ref[sizeof(d)];
+
+		TestFatFill(ref, 41, pos, sizeof(d));
+		bad += fs.Read(fd, d, sizeof(d)) != (int)sizeof(d) || memcmp(d, ref, sizeof(d)) != 0;
+	}
+	fs.Close(fd);
+	TEST_CHECK(bad == 0);
+
+	TEST_CHECK(TestFatDisk::Save(RATE_IMG, sim.Mem(), RATE_NBBLK * 512));
+	TEST_CHECK(TestFatDisk::Check(RATE_IMG) == 0);
+	TestFatDisk::Remove(RATE_IMG);
+}
+
+int main()
+{
+	TestVolume("build/test_fatfs_write16.img", "-t 16 -c 2k -s 32M");
+	TestVolume("build/test_fatfs_write32.img", "-t 32 -c 512 -s 64M -p");
+	TestFull("build/test_fatfs_full.img");
+	TestTwoWriters("build/test_fatfs_two.img");
+	TestAppendRate();
+
+	printf("fatfs_write : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,288 @@
+/**-------------------------------------------------------------------------
+@file	test_fatfs_xfer.cpp
+
+@brief	FatFS whole run and direct transfer test
+
+Writes files with request sizes from 512 bytes to 1MB on 512 byte and 4KB
+clusters and counts the device commands, writes at unaligned offsets against
+a reference copy and runs a write past disk full, which must give back the
+clusters allocated beyond the written data.  Reports the write and read
+throughput of each request size on the SD card simulator.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <vector>
+
+#include "test_fatfs.h"
+#include "sdcard.h"
+#include "sdcard_sim.h"
+#include "test_util.h"
+
+#define IMG				"build/test_fatfs_xfer.img"
+#define FILE_SIZE		(8 * 1024 * 1024)
+#define SD_IMG			"build/test_fatfs_xfer_sd.img"
+#define SD_NBBLK		(64 * 1024 * 1024 / 512)
+
+static uint8_t s_Data[FILE_SIZE];
+static uint8_t s_Rd[FILE_SIZE];
+
+static const SDCARDSIM_TIMING s_SdTiming = {
+	25000000, 1000,			// 25MHz SPI, 1us per transfer
+	500, 100,				// Read access, first and following stream blocks
+	1500, 400, 250,			// Program single, stream and pre-erased stream blocks
+	500,					// Busy after stream stop
+	256, 50000,				// Garbage collection
+};
+
+static uint32_t s_Rand = 44;
+
+static uint32_t Random()
+{
+	s_Rand = s_Rand * 1103515245 + 12345;
+
+	return s_Rand >> 8;
+}
+
+static bool ReadBack(FatFS &Fs, const char *pName, const uint8_t *pRef, uint32_t Len)
+{
+	int fd = Fs.Open(pName, O_RDONLY, 0);
+
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	int l = Fs.Read(fd, s_Rd, Len + 1);
+
+	Fs.Close(fd);
+
+	return l == (int)Len && memcmp(s_Rd, pRef, Len) == 0;
+}
+
+// Sequential write with ReqSize requests, device commands counted
+static void TestSeq(TestFatDisk &Disk, FatFS &Fs, uint32_t ClusSize, uint32_t ReqSize)
+{
+	int fd = Fs.Open("/SEQ.BIN", O_RDWR | O_CREAT | O_TRUNC, 0);
+	uint32_t rdcnt = Disk.Disk.ReadCmdCount();
+	uint32_t wrcnt = Disk.Disk.WriteCmdCount();
+
+	TEST_CHECK(fd >= 0);
+	for (uint32_t p = 0; p < FILE_SIZE; p += ReqSize)
+	{
+		TEST_CHECK(Fs.Write(fd, &s_Data[p], ReqSize) == (int)ReqSize);
+	}
+	Fs.Close(fd);
+	Disk.Disk.Flush();
+
+	rdcnt = Disk.Disk.ReadCmdCount() - rdcnt;
+	wrcnt = Disk.Disk.WriteCmdCount() - wrcnt;
+
+	printf("cluster %4u, request %7u : %6u write, %4u read commands\n", ClusSize, ReqSize, wrcnt, rdcnt);
+
+	// Large requests go to the device in whole runs, only FAT sectors are read
+	if (ReqSize >= 65536)
+	{
+		uint32_t fatsect = FILE_SIZE / ClusSize * 4 / 512;
+
+		TEST_CHECK(wrcnt * 16384 < FILE_SIZE);
+		TEST_CHECK(rdcnt <= 2 * fatsect + 8);
+	}
+	TEST_CHECK(ReadBack(Fs, "/SEQ.BIN", s_Data, FILE_SIZE));
+	TEST_CHECK(Fs.Remove("/SEQ.BIN"));
+}
+
+// Random offsets and lengths, partial head and tail sectors
+static void TestUnaligned(FatFS &Fs)
+{
+	std::vector<uint8_t> ref;
+	int fd = Fs.Open("/UNALIGN.BIN", O_RDWR | O_CREAT, 0);
+
+	TEST_CHECK(fd >= 0);
+	for (int n = 0; n < 300; n++)
+	{
+		uint32_t pos = Random() % (ref.size() + 1);
+		uint32_t len = 1 + Random() % (n & 1 ? 70000 : 1500);
+
+		TEST_CHECK(Fs.Seek(fd, pos) == (int)pos);
+		TEST_CHECK(Fs.Write(fd, &s_Data[n * 1000], len) == (int)len);
+		if (ref.size() < pos + len)
+		{
+			ref.resize(pos + len);
+		}
+		memcpy(&ref[pos], &s_Data[n * 1000], len);
+	}
+	Fs.Close(fd);
+	TEST_CHECK(ReadBack(Fs, "/UNALIGN.BIN", ref.data(), ref.size()));
+	TEST_CHECK(Fs.Remove("/UNALIGN.BIN"));
+}
+
+// A write larger than the free space stops at disk full, clusters allocated
+// past the written data are released
+static void TestFull(FatFS &Fs, uint32_t ClusSize)
+{
+	uint32_t freecnt = Fs.GetFreeCount();
+	uint32_t len = (freecnt - 10) * ClusSize;
+	std::vector<uint8_t> d(len);
+	int fd = Fs.Open("/FILL.BIN", O_RDWR | O_CREAT, 0);
+
+	TEST_CHECK(fd >= 0 && Fs.Write(fd, d.data(), len) == (int)len);
+	Fs.Close(fd);
+	TEST_CHECK(Fs.GetFreeCount() == 10);
+
+	fd = Fs.Open("/OVER.BIN", O_RDWR | O_CREAT, 0);
+	TEST_CHECK(fd >= 0);
+	TEST_CHECK(Fs.Write(fd, s_Data, 100 + 3 * ClusSize) == (int)(100 + 3 * ClusSize));
+
+	int l = Fs.Write(fd, &s_Data[100 + 3 * ClusSize], 20 * ClusSize);
+
+	TEST_CHECK(l >= 0 && l <= (int)(7 * ClusSize));
+	Fs.Close(fd);
+
+	uint32_t size = 100 + 3 * ClusSize + (l > 0 ? l : 0);
+
+	TEST_CHECK(ReadBack(Fs, "/OVER.BIN", s_Data, size));
+	TEST_CHECK(Fs.GetFreeCount() == 10 - (size + ClusSize - 1) / ClusSize);
+	TEST_CHECK(Fs.Remove("/OVER.BIN"));
+	TEST_CHECK(Fs.Remove("/FILL.BIN"));
+	TEST_CHECK(Fs.GetFreeCount() == freecnt);
+}
+
+static void TestVolume(const char *pOpt, uint32_t ClusSize)
+{
+	static const uint32_t reqsize[] = { 512, 4096, 65536, 1024 * 1024 };
+	TestFatDisk disk;
+	FatFS fs;
+
+	TEST_CHECK(TestFatDisk::Format(IMG, pOpt));
+	TEST_CHECK(disk.Open(IMG));
+	TEST_CHECK(fs.Init(&disk.Disk));
+
+	for (auto r : reqsize)
+	{
+		TestSeq(disk, fs, ClusSize, r);
+	}
+	TestUnaligned(fs);
+	TestFull(fs, ClusSize);
+	disk.Close();
+
+	TEST_CHECK(TestFatDisk::Check(IMG) == 0);
+	TestFatDisk::Remove(IMG);
+}
+
+// Sequential write then read back with ReqSize requests on the SD card
+// simulator, throughput from the simulated time
+static void TestSdRate(SdCardSim &Sim, SDCard &Sd, FatFS &Fs, uint32_t ReqSize, double *pWrMBs, double *pRdMBs)
+{
+	int fd = Fs.Open("/RATE.BIN", O_RDWR | O_CREAT | O_TRUNC, 0);
+	int bad = 0;
+
+	TEST_CHECK(fd >= 0);
+
+	uint64_t t = Sim.Time();
+
+	for (uint32_t p = 0; p < FILE_SIZE; p += ReqSize)
+	{
+		bad += Fs.Write(fd, &s_Data[p], ReqSize) != (int)ReqSize;
+	}
+	Fs.Close(fd);
+	Sd.Flush();
+
+	double wr = FILE_SIZE / ((Sim.Time() - t) / 1e3);
+
+	fd = Fs.Open("/RATE.BIN", O_RDONLY, 0);
+	TEST_CHECK(fd >= 0);
+	t = Sim.Time();
+	for (uint32_t p = 0; p < FILE_SIZE; p += ReqSize)
+	{
+		bad += Fs.Read(fd, &s_Rd[p], ReqSize) != (int)ReqSize;
+	}
+
+	double rd = FILE_SIZE / ((Sim.Time() - t) / 1e3);
+
+	Fs.Close(fd);
+
+	printf("SD request %7u : write %5.2f MB/s, read %5.2f MB/s\n", ReqSize, wr, rd);
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(memcmp(s_Rd, s_Data, FILE_SIZE) == 0);
+	TEST_CHECK(Fs.Remove("/RATE.BIN"));
+
+	*pWrMBs = wr;
+	*pRdMBs = rd;
+}
+
+static void TestSd()
+{
+	static const uint32_t reqsize[] = { 512, 4096, 65536, 1024 * 1024 };
+	static const SDCARDSIM_CFG simcfg = { SD_NBBLK, &s_SdTiming };
+	static DISKIO_CACHE_DESC cache[TEST_FATFS_NBCACHE];
+	static uint8_t cachemem[TEST_FATFS_NBCACHE][512];
+	double wr[4], rd[4];
+	SdCardSim sim;
+	SDCard sd;
+	FatFS fs;
+
+	TEST_CHECK(TestFatDisk::Format(SD_IMG, "-t 16 -c 4k -s 64M"));
+	TEST_CHECK(sim.Init(simcfg));
+	TEST_CHECK(TestFatDisk::Load(SD_IMG, sim.Mem(), SD_NBBLK * 512));
+	for (int i = 0; i < TEST_FATFS_NBCACHE; i++)
+	{
+		cache[i].pSectData = cachemem[i];
+	}
+	TEST_CHECK(sd.Init(&sim, cache, TEST_FATFS_NBCACHE));
+	TEST_CHECK(fs.Init(&sd));
+
+	for (int i = 0; i < 4; i++)
+	{
+		TestSdRate(sim, sd, fs, reqsize[i], &wr[i], &rd[i]);
+	}
+	TEST_CHECK(sim.ProtoErrorCount() == 0 && sim.CrcErrorCount() == 0);
+
+	// Whole runs go out as streams, far fewer commands and busy waits
+	TEST_CHECK(wr[3] > 2 * wr[0] && rd[3] > 2 * rd[0]);
+
+	TEST_CHECK(TestFatDisk::Save(SD_IMG, sim.Mem(), SD_NBBLK * 512));
+	TEST_CHECK(TestFatDisk::Check(SD_IMG) == 0);
+	TestFatDisk::Remove(SD_IMG);
+}
+
+int main()
+{
+	TestFatFill(s_Data, 44, 0, FILE_SIZE);
+
+	TestVolume("-t 32 -c 512 -s 64M", 512);
+	TestVolume("-t 32 -c 4k -s 300M", 4096);
+	TestSd();
+
+	printf("fatfs_xfer : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
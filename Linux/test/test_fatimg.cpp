@@ -0,0 +1,291 @@
+/**-------------------------------------------------------------------------
+@file	test_fatimg.cpp
+
+@brief	fatimg builder and checker test on golden images
+
+The golden images in golden/ are built from golden/tree with fixed options,
+time stamp and volume id.  The test rebuilds them and compares byte by byte,
+checks them with fatimg check, reads every file back with FatFS, and has
+fatimg check find and repair a damaged FAT and cross-linked chains.
+
+After an intended change of the image layout, the golden images are made
+again with :
+
+	fatimg build <options below> golden/tree fat16.img
+	gzip -9n fat16.img
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <string>
+#include <vector>
+
+#include "test_fatfs.h"
+#include "test_util.h"
+
+#define GOLDEN_TREE		"golden/tree"
+
+typedef struct {
+	const char *pGolden;	// Golden image, gzip'd
+	const char *pOpt;		// fatimg build options used to make it
+	const char *pImg;		// Unpacked golden image
+	const char *pRebuilt;	// Image rebuilt from the tree
+} GOLDEN;
+
+static const GOLDEN s_Golden[] = {
+	{ "golden/fat16.img.gz", "-t 16 -c 512 -s 4M -l GOLDEN16 -d 1760832000 -i 1a2b3c4d",
+	  "build/test_fatimg16.img", "build/test_fatimg16_rebuilt.img" },
+	{ "golden/fat32.img.gz", "-t 32 -c 512 -s 40M -p -l GOLDEN32 -d 1760832000 -i 4d3c2b1a",
+	  "build/test_fatimg32.img", "build/test_fatimg32_rebuilt.img" },
+};
+
+static const char * const s_Files[] = {
+	"/README.TXT",
+	"/Long file name.txt",
+	"/lower.txt",
+	"/logs/empty.bin",
+	"/logs/sensor.csv",
+	"/Sensor data/2026/October/19.csv",
+};
+
+static bool Shell(const char *pFmt, const char *p1, const char *p2 = "", const char *p3 = "")
+{
+	char cmd[512];
+
+	snprintf(cmd, sizeof(cmd), pFmt, p1, p2, p3);
+	fflush(stdout);
+
+	return system(cmd) == 0;
+}
+
+static bool ReadHost(const char *pPath, std::vector<uint8_t> &Data)
+{
+	FILE *fp = fopen(pPath, "rb");
+
+	if (fp == NULL)
+	{
+		return false;
+	}
+
+	uint8_t b[4096];
+	size_t l;
+
+	Data.clear();
+	while ((l = fread(b, 1, sizeof(b), fp)) > 0)
+	{
+		Data.insert(Data.end(), b, b + l);
+	}
+	fclose(fp);
+
+	return true;
+}
+
+// Every file of the tree read back through FatFS
+static bool CompareTree(const char *pImg)
+{
+	TestFatDisk disk;
+	FatFS fs;
+	bool res = disk.Open(pImg) && fs.Init(&disk.Disk);
+
+	for (auto f : s_Files)
+	{
+		std::vector<uint8_t> ref, d;
+		std::string host = std::string(GOLDEN_TREE) + f;
+		int fd = fs.Open(f, O_RDONLY, 0);
+
+		if (fd < 0 || ReadHost(host.c_str(), ref) == false)
+		{
+			printf("%s not found\n", f);
+			res = false;
+			continue;
+		}
+
+		d.resize(ref.size() + 1);
+		if (fs.Read(fd, d.data(), d.size()) != (int)ref.size() ||
+			(ref.size() > 0 && memcmp(d.data(), ref.data(), ref.size()) != 0))
+		{
+			printf("%s differs\n", f);
+			res = false;
+		}
+		fs.Close(fd);
+	}
+	disk.Close();
+
+	return res;
+}
+
+// Cut the chain of a file in the first FAT copy only : file size past its
+// chain, lost clusters and FAT copies differing.  Repaired by check -r.
+static void TestRepair(const char *pImg)
+{
+	TestFatDisk disk;
+	FatFS fs;
+	DIR de;
+	FATFS_BSBPB bs;
+
+	TEST_CHECK(disk.Open(pImg) && fs.Init(&disk.Disk));
+	TEST_CHECK(fs.Find("/logs/sensor.csv", &de));
+	disk.Close();
+
+	FILE *fp = fopen(pImg, "r+b");
+	uint16_t eoc = 0xFFFF;
+
+	TEST_CHECK(fp != NULL);
+	TEST_CHECK(fread(&bs, sizeof(bs), 1, fp) == 1);
+	fseek(fp, bs.RsvdSecCnt * bs.BytsPerSec + de.d_dirent.FirstClus * 2, SEEK_SET);
+	TEST_CHECK(fwrite(&eoc, sizeof(eoc), 1, fp) == 1);
+	fclose(fp);
+
+	TEST_CHECK(TestFatDisk::Check(pImg) == 4);
+	TEST_CHECK(TestFatDisk::Check(pImg, "-r") == 1);
+	TEST_CHECK(TestFatDisk::Check(pImg) == 0);
+
+	// Size set to what is left of the chain
+	TEST_CHECK(disk.Open(pImg) && fs.Init(&disk.Disk));
+	TEST_CHECK(fs.Find("/logs/sensor.csv", &de));
+	TEST_CHECK(de.d_dirent.d_size == fs.GetClusterSize());
+	disk.Close();
+}
+
+// Image bytes patched in place
+static bool WriteHost(const char *pPath, const std::vector<uint8_t> &Data)
+{
+	FILE *fp = fopen(pPath, "wb");
+
+	if (fp == NULL)
+	{
+		return false;
+	}
+
+	bool res = fwrite(Data.data(), 1, Data.size(), fp) == Data.size();
+
+	fclose(fp);
+
+	return res;
+}
+
+// Golden FAT16 image : /Sensor data/2026/October/19.csv in cluster 9 is
+// scanned before /logs/sensor.csv in clusters 10 to 21.  Either sensor.csv
+// links to cluster 9 from its 6th cluster, two chains sharing a cluster, or
+// its entry starts at cluster 9.  Both reported and repaired by check -r.
+static void TestCrossLink(const char *pImg, bool bStart)
+{
+	static const char sensor[11] = { 'S', 'E', 'N', 'S', 'O', 'R', ' ', ' ', 'C', 'S', 'V' };
+	std::vector<uint8_t> img, ref, d;
+	TestFatDisk disk;
+	FatFS fs;
+	DIR de;
+	FATFS_BSBPB bs;
+
+	TEST_CHECK(Shell("gzip -dc %s > %s", s_Golden[0].pGolden, pImg));
+	TEST_CHECK(ReadHost(pImg, img) && img.size() > sizeof(bs));
+	memcpy(&bs, img.data(), sizeof(bs));
+
+	if (bStart)
+	{
+		// Directory entry, after the FATs and the root directory
+		size_t off = (bs.RsvdSecCnt + bs.NumFATs * bs.FATSz16) * bs.BytsPerSec;
+
+		while (off + 32 <= img.size() && memcmp(&img[off], sensor, 11) != 0)
+		{
+			off += 32;
+		}
+		TEST_CHECK(off + 32 <= img.size());
+		img[off + 26] = 9;
+		img[off + 27] = 0;
+	}
+	else
+	{
+		// Both FAT copies, cluster 15 links to 9
+		for (int i = 0; i < bs.NumFATs; i++)
+		{
+			size_t off = (bs.RsvdSecCnt + i * bs.FATSz16) * bs.BytsPerSec + 15 * 2;
+
+			img[off] = 9;
+			img[off + 1] = 0;
+		}
+	}
+	TEST_CHECK(WriteHost(pImg, img));
+
+	TEST_CHECK(Shell(TEST_FATIMG " check %s | grep -q '%s'", pImg,
+					 bStart ? "start cluster 9 cross-linked" : "cross-linked with .* at cluster 9"));
+	TEST_CHECK(TestFatDisk::Check(pImg) == 4);
+	TEST_CHECK(TestFatDisk::Check(pImg, "-r") == 1);
+	TEST_CHECK(TestFatDisk::Check(pImg) == 0);
+
+	// Cluster 9 left to 19.csv, sensor.csv cut before it or emptied
+	TEST_CHECK(disk.Open(pImg) && fs.Init(&disk.Disk));
+	TEST_CHECK(fs.Find("/logs/sensor.csv", &de));
+	TEST_CHECK(de.d_dirent.d_size == (bStart ? 0 : 6 * fs.GetClusterSize()));
+
+	int fd = fs.Open("/Sensor data/2026/October/19.csv", O_RDONLY, 0);
+
+	TEST_CHECK(fd >= 0 && ReadHost(GOLDEN_TREE "/Sensor data/2026/October/19.csv", ref));
+	d.resize(ref.size() + 1);
+	TEST_CHECK(fs.Read(fd, d.data(), d.size()) == (int)ref.size());
+	TEST_CHECK(memcmp(d.data(), ref.data(), ref.size()) == 0);
+	fs.Close(fd);
+	disk.Close();
+
+	Shell("rm -f %s", pImg);
+}
+
+int main()
+{
+	for (auto &g : s_Golden)
+	{
+		std::vector<uint8_t> golden, rebuilt;
+
+		printf("%s\n", g.pGolden);
+		TEST_CHECK(Shell("gzip -dc %s > %s", g.pGolden, g.pImg));
+		TEST_CHECK(TestFatDisk::Check(g.pImg) == 0);
+		TEST_CHECK(CompareTree(g.pImg));
+
+		// Same tree and options give the same image
+		TEST_CHECK(Shell(TEST_FATIMG " build %s %s %s > /dev/null", g.pOpt, GOLDEN_TREE, g.pRebuilt));
+		TEST_CHECK(ReadHost(g.pImg, golden) && ReadHost(g.pRebuilt, rebuilt));
+		TEST_CHECK(golden.size() > 0 && golden == rebuilt);
+		Shell("rm -f %s", g.pRebuilt);
+	}
+
+	TestRepair(s_Golden[0].pImg);
+	TestCrossLink("build/test_fatimg_xlink.img", false);
+	TestCrossLink("build/test_fatimg_xlink.img", true);
+
+	for (auto &g : s_Golden)
+	{
+		Shell("rm -f %s", g.pImg);
+	}
+
+	printf("fatimg : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,349 @@
+/**-------------------------------------------------------------------------
+@file	test_flash_erase.cpp
+
+@brief	Write latency test of FlashDiskIO during erase
+
+Programs pages while a 4KB sector erase is in progress on the timed SPI
+flash simulator, with the W25Q128JV SFDP table with and without erase
+suspend.  With suspend the worst case write latency must stay below the
+erase time.  Then runs FlashEraseMgr from idle time under a steady page
+stream, and checks that ProgramStart lets the host prepare the next page
+while the device programs the current one.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "norflash_sim.h"
+#include "diskio_flash.h"
+#include "flash_erase.h"
+#include "test_sfdp.h"
+#include "test_util.h"
+
+#define ERASE_BLK		16			// Block erased by the foreground test
+#define WAIT_US			250			// Wait callback delay
+#define PAGE_PERIOD		1000		// Time between page writes in usec
+#define MGR_START		64			// Blocks managed by FlashEraseMgr
+#define MGR_NBBLK		32
+#define MGR_KEEP		24			// Blocks holding data, older ones released
+#define MGR_NBPAGE		3000
+#define PIPE_NBPAGE		64
+#define PIPE_WORK		400			// Host time to prepare a page in usec
+
+static const NORFLASHSIM_TIMING s_Timing = {
+	80000000,	// 80 MHz SPI
+	100,		// Chip select and driver overhead per transfer
+	650,		// Page program
+	45000,		// 4KB erase
+	120000,		// 32KB erase
+	150000,		// 64KB erase
+	40000,		// Chip erase, ms
+	20,			// Erase suspend latency
+	100,		// Erase progress between suspends
+};
+
+static uint32_t Random()
+{
+	static uint32_t s = 40;
+
+	s = s * 1103515245 + 12345;
+
+	return s >> 8;
+}
+
+// Time passes while the driver waits
+static bool Wait(int DevNo, DeviceIntrf * const pInterf)
+{
+	(void)DevNo;
+
+	((NorFlashSim*)pInterf)->Delay(WAIT_US);
+
+	return true;
+}
+
+static bool Setup(NorFlashSim &Sim, FlashDiskIO &Flash, uint8_t *pImg, bool bSuspend)
+{
+	TEST_SFDP_PART part = s_TestSfdpParts[TEST_SFDP_W25Q128JV];
+	const TEST_SFDP_PART *p = &part;
+
+	if (bSuspend == false)
+	{
+		// DWORD12 bit 31, erase suspend not supported
+		part.Bfpt[11] |= 0x80000000;
+	}
+
+	uint32_t len = TestSfdpImage(pImg, &p, 1);
+	NORFLASHSIM_CFG simcfg = { part.TotalSize, part.PageSize, 3, 1, pImg, len, part.BlkSize, &s_Timing };
+	FLASHDISKIO_CFG cfg;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.EraseSize = 0x1000;
+	cfg.pWaitCB = Wait;
+
+	return Sim.Init(simcfg) && Flash.Init(cfg, &Sim);
+}
+
+static bool IsErased(NorFlashSim &Sim, uint32_t BlkNo)
+{
+	const uint8_t *p = Sim.Mem() + BlkNo * 0x1000;
+
+	for (int i = 0; i < 0x1000; i++)
+	{
+		if (p[i] != 0xFF)
+			return false;
+	}
+
+	return true;
+}
+
+// One page every PAGE_PERIOD into the blocks following the one being erased
+static void TestSuspend(bool bSuspend)
+{
+	uint8_t img[TEST_SFDP_IMG_MAX];
+	NorFlashSim sim;
+	FlashDiskIO flash;
+	uint8_t page[256], rd[1];
+	uint64_t maxw = 0, sumw = 0;
+	int nw = 0, bad = 0;
+
+	TEST_CHECK(Setup(sim, flash, img, bSuspend));
+
+	// Stale data in the block to erase
+	memset(sim.Mem() + ERASE_BLK * 0x1000, 0, 0x1000);
+
+	uint32_t addr = (ERASE_BLK + 1) * 0x1000;
+	uint64_t t0 = sim.Time();
+
+	TEST_CHECK(flash.EraseStart(ERASE_BLK));
+
+	while (flash.IsBusy() && nw < 200)
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			page[i] = Random();
+		}
+
+		uint64_t t = sim.Time();
+		int l = flash.ProgramData(addr, page, 256);
+
+		t = sim.Time() - t;
+		sumw += t;
+		maxw = t > maxw ? t : maxw;
+		bad += l != 256 || memcmp(sim.Mem() + addr, page, 256) != 0;
+		addr += 256;
+		nw++;
+		sim.Delay(PAGE_PERIOD);
+	}
+
+	// Waits for the erase if still going
+	flash.ReadData(ERASE_BLK * 0x1000, rd, 1);
+
+	uint64_t te = sim.Time() - t0;
+
+	printf("%-10s : %3d pages written during erase, write avg %7.1f us max %7.1f us, erase done in %.1f ms, %u suspends\n",
+		   bSuspend ? "suspend" : "no suspend", nw, sumw / 1e3 / nw, maxw / 1e3, te / 1e6, sim.SuspendCount());
+
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(IsErased(sim, ERASE_BLK));
+	TEST_CHECK(sim.ProgErrorCount() == 0 && sim.BusyErrorCount() == 0);
+	if (bSuspend)
+	{
+		TEST_CHECK(nw > 1 && sim.SuspendCount() >= (uint32_t)nw);
+		TEST_CHECK(maxw < s_Timing.SectEraseTime * 1000ULL);
+	}
+	else
+	{
+		// First write waits for the erase
+		TEST_CHECK(nw == 1 && sim.SuspendCount() == 0);
+		TEST_CHECK(maxw > s_Timing.SectEraseTime * 1000ULL / 2);
+	}
+}
+
+static void Idle(NorFlashSim &Sim, FlashEraseMgr &Mgr, uint32_t usTime)
+{
+	// Run from a 1 ms timer
+	for (uint32_t t = 0; t < usTime; t += 1000)
+	{
+		Sim.Delay(1000);
+		Mgr.Run();
+	}
+}
+
+// Ring of blocks written one page every 4 ms, erased in the background
+static void TestEraseMgr()
+{
+	uint8_t img[TEST_SFDP_IMG_MAX];
+	NorFlashSim sim;
+	FlashDiskIO flash;
+	FlashEraseMgr mgr;
+	uint8_t mem[FLASHERASE_MEMSIZE(MGR_NBBLK)];
+	FLASHERASE_CFG ecfg = { MGR_START, MGR_NBBLK, 2, 0, 0, mem, sizeof(mem) };
+	int ring[MGR_NBBLK], head = 0, cnt = 0;
+	int blk = -1, pg = 16;
+	uint8_t page[256];
+	uint64_t maxw = 0, sumw = 0;
+	int bad = 0, notclean = 0;
+
+	TEST_CHECK(Setup(sim, flash, img, true));
+	TEST_CHECK(mgr.Init(ecfg, &flash));
+
+	memset(sim.Mem() + MGR_START * 0x1000, 0, MGR_NBBLK * 0x1000);
+	for (int i = 0; i < MGR_NBBLK; i++)
+	{
+		mgr.Release(MGR_START + i);
+	}
+	Idle(sim, mgr, 200000);
+	TEST_CHECK(mgr.GetNbErased() == 2);
+
+	for (int n = 0; n < MGR_NBPAGE; n++)
+	{
+		Idle(sim, mgr, 4000);
+
+		for (int i = 0; i < 256; i++)
+		{
+			page[i] = Random();
+		}
+
+		uint64_t t = sim.Time();
+
+		if (pg >= 16)
+		{
+			blk = mgr.Acquire();
+			if (blk < 0)
+			{
+				bad++;
+				break;
+			}
+			notclean += IsErased(sim, blk) == false;
+			if (cnt >= MGR_KEEP)
+			{
+				mgr.Release(ring[head]);
+				head = (head + 1) % MGR_NBBLK;
+				cnt--;
+			}
+			ring[(head + cnt) % MGR_NBBLK] = blk;
+			cnt++;
+			pg = 0;
+		}
+
+		uint32_t addr = blk * 0x1000 + pg * 256;
+
+		bad += flash.ProgramData(addr, page, 256) != 256;
+		pg++;
+
+		t = sim.Time() - t;
+		sumw += t;
+		maxw = t > maxw ? t : maxw;
+		bad += memcmp(sim.Mem() + addr, page, 256) != 0;
+	}
+
+	printf("erase mgr  : %d pages at 64 KB/s, write avg %7.1f us max %7.1f us, %u waits, %u suspends\n",
+		   MGR_NBPAGE, sumw / 1e3 / MGR_NBPAGE, maxw / 1e3, mgr.GetWaitCount(), sim.SuspendCount());
+
+	TEST_CHECK(bad == 0 && notclean == 0);
+	TEST_CHECK(mgr.GetWaitCount() == 0);
+	TEST_CHECK(sim.SuspendCount() > 0);
+	TEST_CHECK(maxw < s_Timing.SectEraseTime * 1000ULL);
+	TEST_CHECK(sim.ProgErrorCount() == 0 && sim.BusyErrorCount() == 0);
+}
+
+// Host time spent in the driver per page, ProgramData vs ProgramStart
+static void TestPipeline()
+{
+	uint8_t img[TEST_SFDP_IMG_MAX];
+	NorFlashSim sim;
+	FlashDiskIO flash;
+	uint8_t data[PIPE_NBPAGE * 256];
+	uint64_t blocked[2] = { 0, 0 }, total[2] = { 0, 0 };
+	uint8_t rd[1];
+
+	TEST_CHECK(Setup(sim, flash, img, true));
+
+	for (int m = 0; m < 2; m++)
+	{
+		uint32_t base = (ERASE_BLK + 8 + m * 8) * 0x1000;
+		uint64_t t0 = sim.Time();
+
+		for (int i = 0; i < PIPE_NBPAGE * 256; i++)
+		{
+			data[i] = Random();
+		}
+
+		for (int n = 0; n < PIPE_NBPAGE; n++)
+		{
+			uint32_t addr = base + n * 256;
+
+			sim.Delay(PIPE_WORK);
+
+			uint64_t t = sim.Time();
+
+			if (m == 0)
+			{
+				flash.ProgramData(addr, &data[n * 256], 256);
+				blocked[m] += sim.Time() - t;
+			}
+			else
+			{
+				// Other work while the device is busy
+				while (flash.ProgramStart(addr, &data[n * 256], 256) == 0)
+				{
+					blocked[m] += sim.Time() - t;
+					sim.Delay(10);
+					t = sim.Time();
+				}
+				blocked[m] += sim.Time() - t;
+			}
+		}
+		flash.ReadData(base, rd, 1);
+		total[m] = sim.Time() - t0;
+
+		TEST_CHECK(memcmp(sim.Mem() + base, data, sizeof(data)) == 0);
+	}
+
+	printf("pipeline   : host blocked per page %6.1f us ProgramData, %6.1f us ProgramStart, %.2f / %.2f MB/s\n",
+		   blocked[0] / 1e3 / PIPE_NBPAGE, blocked[1] / 1e3 / PIPE_NBPAGE,
+		   sizeof(data) / (total[0] / 1e9) / 1e6, sizeof(data) / (total[1] / 1e9) / 1e6);
+
+	TEST_CHECK(blocked[1] < blocked[0]);
+	TEST_CHECK(blocked[1] / PIPE_NBPAGE < s_Timing.ProgTime * 1000ULL / 10);
+	TEST_CHECK(sim.ProgErrorCount() == 0 && sim.BusyErrorCount() == 0);
+}
+
+int main()
+{
+	TestSuspend(false);
+	TestSuspend(true);
+	TestEraseMgr();
+	TestPipeline();
+
+	printf("flash_erase : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,276 @@
+/**-------------------------------------------------------------------------
+@file	test_flash_ftl.cpp
+
+@brief	Flash translation layer test
+
+Runs FlashFtl on a simulated 1MB SPI NOR flash.  Checks that rewriting a sector
+through the raw FlashDiskIO corrupts it while the FTL does not, measures write
+amplification and erase count spread of a hot/cold workload with and without
+static wear levelling, remounts, and cuts power at random points of single and
+multi sector writes and garbage collection.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "norflash_sim.h"
+#include "diskio_flash.h"
+#include "diskio_ftl.h"
+#include "test_util.h"
+
+#define FLASH_SIZE		(1024 * 1024)
+#define FLASH_BLKSIZE	4096
+#define FLASH_NBBLK		(FLASH_SIZE / FLASH_BLKSIZE)
+#define SECT_SIZE		512
+
+#define HOTCOLD_WRITES	30000		// Sector writes of the hot/cold workload
+#define POWERCUT_TRIALS	300
+
+static FLASHDISKIO_CFG s_FlashCfg = { 0, FLASH_SIZE, FLASH_BLKSIZE, 256, 3, NULL, NULL, SECT_SIZE };
+static const NORFLASHSIM_CFG s_SimCfg = { FLASH_SIZE, 256, 3, 1 };
+static uint32_t s_FtlMem[FLASHFTL_MEMSIZE(FLASH_NBBLK, 8) / 4];
+static uint32_t s_Rand = 12345;
+
+static uint32_t Random()
+{
+	s_Rand ^= s_Rand << 13;
+	s_Rand ^= s_Rand >> 17;
+	s_Rand ^= s_Rand << 5;
+
+	return s_Rand;
+}
+
+// Sector content tagged with sector number and version
+static void Fill(uint8_t *p, uint32_t SectNo, uint32_t Ver)
+{
+	for (int i = 0; i < SECT_SIZE; i += 8)
+	{
+		memcpy(p + i, &SectNo, 4);
+		memcpy(p + i + 4, &Ver, 4);
+	}
+}
+
+static int Verify(FlashFtl &Ftl, std::vector<uint32_t> &Ver)
+{
+	uint8_t buf[SECT_SIZE], rd[SECT_SIZE];
+	int bad = 0;
+
+	for (uint32_t s = 0; s < Ver.size(); s++)
+	{
+		Fill(buf, s, Ver[s]);
+		bad += Ftl.SectRead(s, rd) == false || memcmp(rd, buf, SECT_SIZE) != 0;
+	}
+
+	return bad;
+}
+
+static void TestRawRewrite()
+{
+	NorFlashSim sim;
+	FlashDiskIO flash;
+	uint8_t buf[SECT_SIZE], rd[SECT_SIZE];
+
+	TEST_CHECK(sim.Init(s_SimCfg));
+	TEST_CHECK(flash.Init(s_FlashCfg, &sim));
+
+	// Programming without erase only clears bits
+	Fill(buf, 5, 1);
+	flash.SectWrite(5, buf);
+	Fill(buf, 5, 2);
+	flash.SectWrite(5, buf);
+	flash.SectRead(5, rd);
+	TEST_CHECK(memcmp(rd, buf, SECT_SIZE) != 0);
+	TEST_CHECK(sim.ProgErrorCount() > 0);
+}
+
+// 90% of writes on 5% of the sectors
+static uint32_t HotCold(int WearThreshold)
+{
+	NorFlashSim sim;
+	FlashDiskIO flash;
+	FlashFtl ftl;
+	FLASHFTL_CFG cfg = { 0, FLASH_NBBLK, 8, (uint32_t)WearThreshold, s_FtlMem, sizeof(s_FtlMem) };
+	uint8_t buf[SECT_SIZE];
+
+	sim.Init(s_SimCfg);
+	flash.Init(s_FlashCfg, &sim);
+	TEST_CHECK(ftl.Init(cfg, &flash));
+
+	uint32_t n = ftl.GetSize() / SECT_SIZE;
+	std::vector<uint32_t> ver(n, 1);
+
+	for (uint32_t s = 0; s < n; s++)
+	{
+		Fill(buf, s, 1);
+		ftl.SectWrite(s, buf);
+	}
+	for (int i = 0; i < HOTCOLD_WRITES; i++)
+	{
+		uint32_t s = (Random() % 10) < 9 ? Random() % (n / 20) : Random() % n;
+
+		Fill(buf, s, ++ver[s]);
+		TEST_CHECK(ftl.SectWrite(s, buf));
+	}
+
+	TEST_CHECK(Verify(ftl, ver) == 0);
+	TEST_CHECK(sim.ProgErrorCount() == 0);
+
+	uint32_t emin = 0xFFFFFFFF, emax = 0;
+
+	for (int b = 0; b < FLASH_NBBLK; b++)
+	{
+		uint32_t c = sim.EraseCount(b * FLASH_BLKSIZE);
+
+		emin = c < emin ? c : emin;
+		emax = c > emax ? c : emax;
+	}
+
+	double wa = (double)ftl.PageWriteCount() / ftl.HostWriteCount();
+
+	printf("%s : %u sectors, write amplification %.2f, erase count %u to %u\n",
+		   WearThreshold < 0 ? "dynamic wear levelling" : "static wear levelling",
+		   n, wa, emin, emax);
+	TEST_CHECK(wa < 8.0);
+
+	// Remount rebuilds the same mapping
+	FlashFtl ftl2;
+
+	TEST_CHECK(ftl2.Init(cfg, &flash));
+	TEST_CHECK(Verify(ftl2, ver) == 0);
+
+	return emax - emin;
+}
+
+static void TestPowerCut()
+{
+	NorFlashSim sim;
+	FlashDiskIO flash;
+	FlashFtl ftl;
+	FLASHFTL_CFG cfg = { 0, 64, 4, 16, s_FtlMem, sizeof(s_FtlMem) };
+	uint8_t buf[SECT_SIZE], rd[SECT_SIZE];
+	uint8_t mb[8 * SECT_SIZE];
+	int corrupt = 0, committed = 0;
+
+	sim.Init(s_SimCfg);
+	flash.Init(s_FlashCfg, &sim);
+	TEST_CHECK(ftl.Init(cfg, &flash));
+
+	uint32_t n = ftl.GetSize() / SECT_SIZE;
+	std::vector<uint32_t> ver(n, 0);
+
+	for (int t = 0; t < POWERCUT_TRIALS; t++)
+	{
+		uint32_t s = 0, cnt = 1;
+
+		// Write until power is lost during the n th program or erase
+		sim.PowerCut(1 + Random() % 400);
+		while (sim.PowerLost() == false)
+		{
+			s = Random() % n;
+			cnt = (Random() % 4 == 0) ? 1 + Random() % 8 : 1;
+			if (s + cnt > n)
+			{
+				cnt = n - s;
+			}
+			for (uint32_t k = 0; k < cnt; k++)
+			{
+				Fill(mb + k * SECT_SIZE, s + k, ver[s + k] + 1);
+			}
+
+			int w = ftl.SectWriteMulti(s, mb, cnt);
+
+			if (sim.PowerLost())
+			{
+				break;
+			}
+			TEST_CHECK(w == (int)cnt);
+			for (uint32_t k = 0; k < cnt; k++)
+			{
+				ver[s + k]++;
+			}
+			if (Random() % 50 == 0)
+			{
+				ftl.Collect();
+			}
+		}
+
+		sim.PowerRestore();
+		TEST_CHECK(ftl.Init(cfg, &flash));
+
+		// Sectors being written hold either the old or the new data
+		for (uint32_t x = 0; x < n; x++)
+		{
+			bool inflight = x >= s && x < s + cnt;
+
+			ftl.SectRead(x, rd);
+			Fill(buf, x, ver[x]);
+			if (ver[x] == 0)
+			{
+				memset(buf, 0xFF, SECT_SIZE);
+			}
+			if (memcmp(rd, buf, SECT_SIZE) == 0)
+			{
+				continue;
+			}
+			Fill(buf, x, ver[x] + 1);
+			if (inflight && memcmp(rd, buf, SECT_SIZE) == 0)
+			{
+				ver[x]++;
+				committed++;
+				continue;
+			}
+			corrupt++;
+		}
+	}
+
+	printf("power cuts : %d, corrupted sectors %d, interrupted sectors committed %d\n",
+		   POWERCUT_TRIALS, corrupt, committed);
+	TEST_CHECK(corrupt == 0);
+	TEST_CHECK(sim.ProgErrorCount() == 0);
+}
+
+int main()
+{
+	TestRawRewrite();
+
+	uint32_t dyn = HotCold(-1);
+	uint32_t stat = HotCold(16);
+
+	// Static wear levelling bounds the spread close to its threshold
+	TEST_CHECK(stat <= 24);
+	TEST_CHECK(stat < dyn);
+
+	TestPowerCut();
+
+	printf("flash_ftl : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,323 @@
+/**-------------------------------------------------------------------------
+@file	test_flash_log.cpp
+
+@brief	Flash circular log test
+
+Runs FlashLog on a simulated SPI NOR flash filled with garbage.  Checks append
+and read back, wrap around with retention of the newest records, remount,
+seek, trim, erase failure and random power cuts while appending.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "norflash_sim.h"
+#include "flash_log.h"
+#include "test_util.h"
+
+#define FLASH_SIZE		(1024 * 1024)
+#define NBSEG			16
+#define POWERCUT_ITER	1000
+
+static uint32_t s_LogMem[FLASHLOG_MEMSIZE(NBSEG, 256) / 4];
+static const FLASHLOG_CFG s_LogCfg = { 8, NBSEG, s_LogMem, sizeof(s_LogMem) };
+
+static NorFlashSim s_Sim;
+static FlashDiskIO s_Flash;
+
+static int RecLen(uint32_t t)
+{
+	return (t * 2654435761u >> 24) % 120 + 1;
+}
+
+static void RecData(uint32_t t, uint8_t *p)
+{
+	int l = RecLen(t);
+
+	for (int i = 0; i < l; i++)
+	{
+		p[i] = (t * 31 + i * 7) ^ (t >> 8);
+	}
+}
+
+static bool Append(FlashLog &Log, uint32_t t)
+{
+	uint8_t d[256];
+
+	RecData(t, d);
+
+	return Log.Append(t, d, RecLen(t));
+}
+
+// Read whole log, records must have consecutive times and correct data.
+// Returns number of records, -1 on error
+static int Verify(FlashLog &Log, uint32_t &First, uint32_t &Last)
+{
+	FLASHLOG_POS pos;
+	uint8_t buf[256], ref[256];
+	uint32_t t, prev = 0;
+	int n = 0, len;
+
+	Log.First(pos);
+	while ((len = Log.Read(pos, &t, buf, sizeof(buf))) >= 0)
+	{
+		RecData(t, ref);
+		if (len != RecLen(t) || memcmp(buf, ref, len) != 0 || (n > 0 && t != prev + 1))
+		{
+			return -1;
+		}
+		if (n == 0)
+		{
+			First = t;
+		}
+		prev = t;
+		n++;
+	}
+	Last = prev;
+
+	return n;
+}
+
+static bool Setup(NorFlashSim &Sim, FlashDiskIO &Flash, const NORFLASHSIM_TIMING *pTiming)
+{
+	NORFLASHSIM_CFG scfg = { FLASH_SIZE, 256, 3, 7, NULL, 0, 0, pTiming };
+	FLASHDISKIO_CFG fcfg;
+
+	memset(&fcfg, 0, sizeof(fcfg));
+	fcfg.TotalSize = FLASH_SIZE;
+	fcfg.EraseSize = 4096;
+	fcfg.WriteSize = 256;
+	fcfg.AddrSize = 3;
+
+	if (Sim.Init(scfg) == false)
+	{
+		return false;
+	}
+
+	// Garbage in the area, as an unformatted flash
+	srand(39);
+	for (int i = 0; i < FLASH_SIZE; i++)
+	{
+		Sim.Mem()[i] = rand();
+	}
+
+	return Flash.Init(fcfg, &Sim);
+}
+
+static void TestLog()
+{
+	FlashLog log;
+	uint32_t first = 0, last = 0;
+	uint32_t t = 1;
+	int n;
+
+	TEST_CHECK(Setup(s_Sim, s_Flash, NULL));
+	TEST_CHECK(log.Init(s_LogCfg, &s_Flash));
+	TEST_CHECK(Verify(log, first, last) == 0);
+
+	for (; t <= 300; t++)
+	{
+		TEST_CHECK(Append(log, t));
+	}
+	n = Verify(log, first, last);
+	printf("append : %d records in %u segments\n", n, log.GetNbSegUsed());
+	TEST_CHECK(n == 300 && first == 1 && last == 300);
+
+	// Wrap several times, newest records kept
+	for (; t <= 5000; t++)
+	{
+		TEST_CHECK(Append(log, t));
+	}
+	n = Verify(log, first, last);
+	printf("wrap : %d records kept, %u to %u\n", n, first, last);
+	TEST_CHECK(n > 0 && last == 5000 && log.GetNbSegUsed() == NBSEG);
+
+	// Remount finds the same records and appends after them
+	FlashLog log2;
+	uint32_t f2 = 0, l2 = 0;
+
+	TEST_CHECK(log2.Init(s_LogCfg, &s_Flash));
+	TEST_CHECK(Verify(log2, f2, l2) == n && f2 == first && l2 == last);
+	for (; t <= 5100; t++)
+	{
+		TEST_CHECK(Append(log2, t));
+	}
+	n = Verify(log2, first, last);
+	TEST_CHECK(n > 0 && last == 5100);
+
+	// Seek to first record at or after a time
+	int bad = 0;
+
+	for (int i = 0; i < 500; i++)
+	{
+		uint32_t q = first - 50 + rand() % (last - first + 100);
+		uint32_t expect = q < first ? first : q;
+		FLASHLOG_POS pos;
+		uint8_t buf[256];
+		uint32_t rt;
+		bool found = log2.Seek(pos, q);
+
+		if (expect > last)
+		{
+			bad += found;
+		}
+		else if (found == false || log2.Read(pos, &rt, buf, sizeof(buf)) < 0 || rt != expect)
+		{
+			bad++;
+		}
+	}
+	TEST_CHECK(bad == 0);
+
+	// Truncated read still returns the full length
+	FLASHLOG_POS pos;
+	uint8_t b[4];
+	uint32_t rt;
+
+	TEST_CHECK(log2.Seek(pos, last - 10));
+	TEST_CHECK(log2.Read(pos, &rt, b, sizeof(b)) == RecLen(last - 10) && rt == last - 10);
+
+	// Trim persists after remount
+	uint32_t cut = first + (last - first) / 2;
+	int nt = log2.Trim(cut);
+	uint32_t f3 = 0, l3 = 0, f4 = 0, l4 = 0;
+	int n3 = Verify(log2, f3, l3);
+	FlashLog log3;
+
+	printf("trim : %d segments dropped, first %u, cut %u\n", nt, f3, cut);
+	TEST_CHECK(nt > 0 && f3 <= cut && l3 == last);
+	TEST_CHECK(log3.Init(s_LogCfg, &s_Flash));
+	TEST_CHECK(Verify(log3, f4, l4) == n3 && f4 == f3);
+
+	// Append starting a segment erased ahead by Prepare
+	TEST_CHECK(log3.Prepare());
+	for (int i = 0; i < 200; i++)
+	{
+		TEST_CHECK(Append(log3, ++l4));
+	}
+	TEST_CHECK(Verify(log3, f4, l3) > 0 && l3 == l4);
+}
+
+// Record being appended at power loss is either complete or absent, all
+// acknowledged records are kept
+static void TestPowerCut()
+{
+	uint32_t first = 0, last = 0, ack = 0;
+	int cuts = 0, inflight = 0;
+
+	{
+		FlashLog lg;
+
+		TEST_CHECK(lg.Init(s_LogCfg, &s_Flash));
+		Verify(lg, first, ack);
+	}
+
+	for (int iter = 0; iter < POWERCUT_ITER; iter++)
+	{
+		FlashLog lg;
+
+		if (lg.Init(s_LogCfg, &s_Flash) == false)
+		{
+			TEST_CHECK(false);
+			break;
+		}
+
+		int nr = Verify(lg, first, last);
+
+		if (nr <= 0 || (last != ack && last != ack + 1))
+		{
+			TEST_CHECK(false);
+			break;
+		}
+		if (last == ack + 1)
+		{
+			inflight++;
+			ack++;
+		}
+		if (iter % 7 == 0)
+		{
+			lg.Trim(first + rand() % 50);
+		}
+		if (iter % 11 == 0)
+		{
+			lg.Prepare();
+		}
+
+		uint32_t t = ack + 1;
+
+		s_Sim.PowerCut(1 + rand() % 40);
+		while (s_Sim.PowerLost() == false && t - ack <= 1)
+		{
+			if (Append(lg, t) && s_Sim.PowerLost() == false)
+			{
+				ack = t;
+			}
+			t++;
+		}
+		cuts += s_Sim.PowerLost();
+		s_Sim.PowerRestore();
+		s_Sim.PowerCut(0);
+	}
+
+	printf("power cuts : %d, interrupted records recovered %d\n", cuts, inflight);
+	TEST_CHECK(cuts > POWERCUT_ITER / 2);
+	TEST_CHECK(s_Sim.ProgErrorCount() == 0);
+}
+
+// Flash staying busy past the erase timeout fails the append starting a
+// segment.  Delays are not simulated, the timed erase never completes.
+static void TestEraseFail()
+{
+	static const NORFLASHSIM_TIMING timing = { 80000000, 100, 650, 45000, 120000, 150000, 40000, 20, 100 };
+	NorFlashSim sim;
+	FlashDiskIO flash;
+	FlashLog lg;
+	uint32_t first = 0, last = 0;
+
+	TEST_CHECK(Setup(sim, flash, &timing));
+	TEST_CHECK(lg.Init(s_LogCfg, &flash));
+	TEST_CHECK(Append(lg, 1) == false);
+	TEST_CHECK(lg.Prepare() == false);
+	TEST_CHECK(Append(lg, 1) == false);
+	TEST_CHECK(lg.GetNbSegUsed() == 0);
+	TEST_CHECK(Verify(lg, first, last) == 0);
+	TEST_CHECK(sim.ProgErrorCount() == 0);
+}
+
+int main()
+{
+	TestLog();
+	TestPowerCut();
+	TestEraseFail();
+
+	printf("flash_log : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
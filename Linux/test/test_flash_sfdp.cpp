@@ -0,0 +1,224 @@
+/**-------------------------------------------------------------------------
+@file	test_flash_sfdp.cpp
+
+@brief	SFDP discovery test of FlashDiskIO
+
+Runs FlashDiskIO::Init with an all zero configuration against NorFlashSim
+loaded with the SFDP image of several real parts, wired for 1, 2 and 4 data
+lines.  Checks the size, page size, chosen erase type, read mode and address
+mode, then programs, reads back and erases the top of the accessible range.
+Also checks the configuration overrides, a part without SFDP, and that the
+latest revision of the Basic Flash Parameter Table is used.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "norflash_sim.h"
+#include "diskio_flash.h"
+#include "test_sfdp.h"
+#include "test_util.h"
+
+// Parameters FlashDiskIO must pick for each part
+typedef struct {
+	uint64_t Size;			//!< Accessible size
+	uint32_t EraseSize;
+	uint8_t EraseCmd;
+	int AddrSize;
+	uint8_t ReadCmd[3];		//!< Read opcode with 1, 2 and 4 data lines
+} SFDPEXPECT;
+
+static const SFDPEXPECT s_Expect[TEST_SFDP_NBPART] = {
+	{ 16 * 1024 * 1024, 0x1000, 0x20, 3, { 0x0B, 0xBB, 0xEB } },
+	{ 16 * 1024 * 1024, 0x1000, 0x20, 3, { 0x0B, 0xBB, 0xEB } },
+	{ 8 * 1024 * 1024, 0x1000, 0x20, 3, { 0x0B, 0xBB, 0xEB } },
+	{ 64 * 1024 * 1024, 0x1000, 0x20, 4, { 0x0B, 0xBB, 0xEB } },
+	{ 16 * 1024 * 1024, 0x40000, 0xD8, 3, { 0x0B, 0xBB, 0xEB } },	// Bank register, lower 16MB
+};
+
+static bool SetLines(int DevNo, DeviceIntrf * const pInterf, int NbLines)
+{
+	(void)DevNo;
+
+	((NorFlashSim*)pInterf)->SetLines(NbLines);
+
+	return true;
+}
+
+static void TestPart(int Part, int NbLines)
+{
+	const TEST_SFDP_PART *p = &s_TestSfdpParts[Part];
+	const SFDPEXPECT *e = &s_Expect[Part];
+	uint8_t img[TEST_SFDP_IMG_MAX];
+	uint32_t len = TestSfdpImage(img, &p, 1);
+	NORFLASHSIM_CFG simcfg = { p->TotalSize, p->PageSize, 3, 1, img, len, p->BlkSize, NULL };
+	FLASHDISKIO_CFG cfg;
+	NorFlashSim sim;
+	FlashDiskIO flash;
+	uint8_t wr[512], rd[512];
+	int li = NbLines == 4 ? 2 : NbLines - 1;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.NbDataLines = NbLines;
+	cfg.pSetLinesCB = SetLines;
+
+	TEST_CHECK(sim.Init(simcfg));
+	TEST_CHECK(flash.Init(cfg, &sim));
+	TEST_CHECK(flash.GetSfdp() != NULL);
+	TEST_CHECK(flash.GetSize() == e->Size);
+	TEST_CHECK(flash.GetMinEraseSize() == e->EraseSize);
+	TEST_CHECK(flash.GetMinWriteSize() == p->PageSize);
+	TEST_CHECK(sim.AddrSize() == e->AddrSize);
+
+	// Last sector of the accessible range, 4 bytes address past 16MB
+	uint32_t sect = flash.GetSize() / 512 - 1;
+
+	for (int i = 0; i < 512; i++)
+	{
+		wr[i] = (uint8_t)(i * 13 + Part);
+	}
+	TEST_CHECK(flash.SectWrite(sect, wr));
+	TEST_CHECK(flash.SectRead(sect, rd) && memcmp(rd, wr, 512) == 0);
+	TEST_CHECK(memcmp(sim.Mem() + (uint64_t)sect * 512, wr, 512) == 0);
+	TEST_CHECK(sim.CmdCount(e->ReadCmd[li]) > 0);
+
+	TEST_CHECK(flash.EraseBlock(sect * 512 / e->EraseSize, 1));
+	TEST_CHECK(sim.CmdCount(e->EraseCmd) == 1 && sim.EraseOpCount() == 1);
+	TEST_CHECK(sim.Mem()[(uint64_t)sect * 512] == 0xFF && sim.Mem()[(uint64_t)sect * 512 - e->EraseSize + 512] == 0xFF);
+	TEST_CHECK(flash.SectRead(sect, rd) && rd[0] == 0xFF && rd[511] == 0xFF);
+	TEST_CHECK(sim.ProgErrorCount() == 0 && sim.LineErrorCount() == 0);
+
+	const FLASH_SFDP *s = flash.GetSfdp();
+
+	printf("%-12s %d lines : %3d MB, erase %3u KB 0x%02X, page %u, %d bytes address, read 0x%02X %d dummy clocks\n",
+		   p->pName, NbLines, (int)(flash.GetSize() >> 20), flash.GetMinEraseSize() >> 10, e->EraseCmd,
+		   flash.GetMinWriteSize(), sim.AddrSize(), e->ReadCmd[li],
+		   s->Read[NbLines == 1 ? FLASH_READMODE_1_1_1 : NbLines == 2 ? FLASH_READMODE_1_2_2 : FLASH_READMODE_1_4_4].DummyClk);
+}
+
+// Configuration values take precedence over SFDP
+static void TestOverride()
+{
+	const TEST_SFDP_PART *p = &s_TestSfdpParts[TEST_SFDP_W25Q128JV];
+	uint8_t img[TEST_SFDP_IMG_MAX];
+	uint32_t len = TestSfdpImage(img, &p, 1);
+	NORFLASHSIM_CFG simcfg = { p->TotalSize, p->PageSize, 3, 1, img, len, 0, NULL };
+	FLASHDISKIO_CFG cfg;
+	NorFlashSim sim;
+	FlashDiskIO flash;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.EraseSize = 0x8000;
+	cfg.TotalSize = 4 * 1024 * 1024;
+
+	TEST_CHECK(sim.Init(simcfg));
+	TEST_CHECK(flash.Init(cfg, &sim));
+	TEST_CHECK(flash.GetSize() == 4 * 1024 * 1024 && flash.GetMinEraseSize() == 0x8000);
+	TEST_CHECK(flash.EraseBlock(1, 1) && sim.CmdCount(FLASH_CMD_BLOCK_ERASE_32) == 1);
+	TEST_CHECK(sim.CmdCount(FLASH_CMD_FAST_READ) == 0);
+
+	uint8_t rd[512];
+
+	TEST_CHECK(flash.SectRead(0, rd) && sim.CmdCount(FLASH_CMD_FAST_READ) == 1);
+}
+
+// Without SFDP the configuration is used as is
+static void TestNoSfdp()
+{
+	NORFLASHSIM_CFG simcfg = { 4 * 1024 * 1024, 256, 3, 1, NULL, 0, 0, NULL };
+	FLASHDISKIO_CFG cfg;
+	NorFlashSim sim;
+	FlashDiskIO flash;
+	uint8_t wr[512], rd[512];
+
+	memset(&cfg, 0, sizeof(cfg));
+	TEST_CHECK(sim.Init(simcfg));
+	TEST_CHECK(flash.Init(cfg, &sim) == false);
+
+	cfg.TotalSize = 4 * 1024 * 1024;
+	cfg.EraseSize = 0x10000;
+	cfg.WriteSize = 256;
+	cfg.AddrSize = 3;
+	TEST_CHECK(flash.Init(cfg, &sim));
+	TEST_CHECK(flash.GetSfdp() == NULL && flash.GetMinEraseSize() == 0x10000);
+
+	memset(wr, 0x5A, sizeof(wr));
+	TEST_CHECK(flash.SectWrite(3, wr) && flash.SectRead(3, rd) && memcmp(rd, wr, 512) == 0);
+	TEST_CHECK(sim.CmdCount(FLASH_CMD_READ) == 1);
+	TEST_CHECK(flash.EraseBlock(0, 1) && sim.CmdCount(FLASH_CMD_BLOCK_ERASE) == 1);
+}
+
+// Latest minor revision of the basic table is used, whatever its order
+static void TestRevision()
+{
+	TEST_SFDP_PART old = s_TestSfdpParts[TEST_SFDP_W25Q128JV];
+
+	old.Minor = 5;
+	old.Bfpt[1] = 0x03FFFFFF;	// 64Mbits
+
+	const TEST_SFDP_PART *tbl[2][2] = {
+		{ &s_TestSfdpParts[TEST_SFDP_W25Q128JV], &old },
+		{ &old, &s_TestSfdpParts[TEST_SFDP_W25Q128JV] },
+	};
+
+	for (int i = 0; i < 2; i++)
+	{
+		uint8_t img[TEST_SFDP_IMG_MAX];
+		uint32_t len = TestSfdpImage(img, tbl[i], 2);
+		NORFLASHSIM_CFG simcfg = { 16 * 1024 * 1024, 256, 3, 1, img, len, 0, NULL };
+		FLASHDISKIO_CFG cfg;
+		NorFlashSim sim;
+		FlashDiskIO flash;
+
+		memset(&cfg, 0, sizeof(cfg));
+		TEST_CHECK(sim.Init(simcfg));
+		TEST_CHECK(flash.Init(cfg, &sim));
+		TEST_CHECK(flash.GetSize() == 16 * 1024 * 1024);
+	}
+}
+
+int main()
+{
+	for (int p = 0; p < TEST_SFDP_NBPART; p++)
+	{
+		for (int l = 1; l <= 4; l <<= 1)
+		{
+			TestPart(p, l);
+		}
+	}
+
+	TestOverride();
+	TestNoSfdp();
+	TestRevision();
+
+	printf("flash_sfdp : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
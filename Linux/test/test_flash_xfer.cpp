@@ -0,0 +1,284 @@
+/**-------------------------------------------------------------------------
+@file	test_flash_xfer.cpp
+
+@brief	Read mode and quad program throughput test of FlashDiskIO
+
+Reads 1MB and programs 256KB through FlashDiskIO on the timed SPI flash
+simulator, with the W25Q128JV SFDP table, in each read mode the driver can
+pick : READ at 50 MHz without SFDP, FAST_READ 1-1-1, dual 1-1-2 and 1-2-2,
+quad 1-1-4 and 1-4-4, and single line against quad page program.  The fast
+read bits of BFPT DWORD1 are cleared to force the 1-1-x modes.  Reports
+the throughput and checks the data, the opcodes used and that every
+transfer ran on the right number of lines.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "norflash_sim.h"
+#include "diskio_flash.h"
+#include "test_sfdp.h"
+#include "test_util.h"
+
+#define WAIT_US			20				// Wait callback delay
+#define READ_SIZE		0x100000
+#define PROG_BASE		0x200000
+#define PROG_SIZE		0x40000
+
+#define DW1_1_1_2		(1 << 16)		// BFPT DWORD1 fast read support
+#define DW1_1_2_2		(1 << 20)
+#define DW1_1_4_4		(1 << 21)
+#define DW1_1_1_4		(1 << 22)
+
+static const NORFLASHSIM_TIMING s_Timing = {
+	80000000,	// 80 MHz SPI
+	100,		// Chip select and driver overhead per transfer
+	650,		// Page program
+	45000,		// 4KB erase
+	120000,		// 32KB erase
+	150000,		// 64KB erase
+	40000,		// Chip erase, ms
+	20,			// Erase suspend latency
+	100,		// Erase progress between suspends
+};
+
+typedef struct {
+	const char *pName;
+	bool bSfdp;
+	int NbLines;
+	uint32_t NoMode;		//!< DWORD1 fast read bits cleared
+	uint8_t ReadCmd;		//!< Expected opcode
+	uint32_t ClkRate;		//!< SPI clock, READ is limited to about 50 MHz
+} READMODE;
+
+static const READMODE s_Modes[] = {
+	{ "READ (no SFDP)", false, 1, 0, FLASH_CMD_READ, 50000000 },
+	{ "FAST_READ 1-1-1", true, 1, 0, FLASH_CMD_FAST_READ, 80000000 },
+	{ "dual 1-1-2", true, 2, DW1_1_2_2 | DW1_1_4_4 | DW1_1_1_4, FLASH_CMD_DUAL_READ, 80000000 },
+	{ "dual 1-2-2", true, 2, 0, FLASH_CMD_DUAL_IO_READ, 80000000 },
+	{ "quad 1-1-4", true, 4, DW1_1_4_4, FLASH_CMD_QUAD_READ, 80000000 },
+	{ "quad 1-4-4", true, 4, 0, FLASH_CMD_QUAD_IO_READ, 80000000 },
+};
+
+#define NBMODE		(int)(sizeof(s_Modes) / sizeof(READMODE))
+
+static uint8_t s_Buff[READ_SIZE];
+
+static uint32_t Random()
+{
+	static uint32_t s = 38;
+
+	s = s * 1103515245 + 12345;
+
+	return s >> 8;
+}
+
+static bool Wait(int DevNo, DeviceIntrf * const pInterf)
+{
+	(void)DevNo;
+
+	((NorFlashSim*)pInterf)->Delay(WAIT_US);
+
+	return true;
+}
+
+static bool SetLines(int DevNo, DeviceIntrf * const pInterf, int NbLines)
+{
+	(void)DevNo;
+
+	((NorFlashSim*)pInterf)->SetLines(NbLines);
+
+	return true;
+}
+
+static bool Setup(NorFlashSim &Sim, FlashDiskIO &Flash, uint8_t *pImg, NORFLASHSIM_TIMING &Timing,
+				  const READMODE &Mode, bool bQuadProg)
+{
+	TEST_SFDP_PART part = s_TestSfdpParts[TEST_SFDP_W25Q128JV];
+	const TEST_SFDP_PART *p = &part;
+
+	part.Bfpt[0] &= ~Mode.NoMode;
+
+	uint32_t len = TestSfdpImage(pImg, &p, 1);
+	NORFLASHSIM_CFG simcfg = { part.TotalSize, part.PageSize, 3, 1, Mode.bSfdp ? pImg : NULL,
+							   Mode.bSfdp ? len : 0, part.BlkSize, &Timing };
+	FLASHDISKIO_CFG cfg;
+
+	memset(&cfg, 0, sizeof(cfg));
+	if (Mode.bSfdp == false)
+	{
+		cfg.TotalSize = part.TotalSize;
+		cfg.EraseSize = 0x1000;
+		cfg.WriteSize = part.PageSize;
+		cfg.AddrSize = 3;
+	}
+	cfg.pWaitCB = Wait;
+	cfg.NbDataLines = Mode.NbLines;
+	cfg.pSetLinesCB = Mode.NbLines > 1 ? SetLines : NULL;
+	cfg.QuadProgCmd = bQuadProg ? FLASH_CMD_QUAD_WRITE : 0;
+	Timing = s_Timing;
+	Timing.ClkRate = Mode.ClkRate;
+
+	if (Sim.Init(simcfg) == false)
+	{
+		return false;
+	}
+
+	// Content preloaded untimed
+	for (int i = 0; i < READ_SIZE; i++)
+	{
+		Sim.Mem()[i] = Random();
+	}
+
+	return Flash.Init(cfg, &Sim);
+}
+
+// 1MB in 4KB reads then 2000 random 512 bytes sectors, returns sequential MB/s
+static double TestRead(const READMODE &Mode)
+{
+	uint8_t img[TEST_SFDP_IMG_MAX];
+	NORFLASHSIM_TIMING timing;
+	NorFlashSim sim;
+	FlashDiskIO flash;
+	int bad = 0;
+
+	TEST_CHECK(Setup(sim, flash, img, timing, Mode, false));
+
+	uint64_t t0 = sim.Time();
+
+	for (int s = 0; s < READ_SIZE / 512; s += 8)
+	{
+		bad += flash.SectReadMulti(s, s_Buff + s * 512, 8) != 8;
+	}
+
+	uint64_t tseq = sim.Time() - t0;
+
+	bad += memcmp(s_Buff, sim.Mem(), READ_SIZE) != 0;
+
+	t0 = sim.Time();
+	for (int i = 0; i < 2000; i++)
+	{
+		uint32_t sect = Random() % (READ_SIZE / 512);
+
+		bad += flash.SectRead(sect, s_Buff) == false || memcmp(s_Buff, sim.Mem() + sect * 512, 512) != 0;
+	}
+
+	uint64_t trand = sim.Time() - t0;
+	double mbs = READ_SIZE / (tseq / 1e9) / 1e6;
+
+	printf("%-16s : seq 4KB %6.2f MB/s, random 512B %6.2f MB/s, opcode 0x%02X at %u MHz\n", Mode.pName, mbs,
+		   2000 * 512 / (trand / 1e9) / 1e6, Mode.ReadCmd, Mode.ClkRate / 1000000);
+
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(sim.CmdCount(Mode.ReadCmd) == READ_SIZE / 4096 + 2000);
+	TEST_CHECK(sim.LineErrorCount() == 0 && sim.BusyErrorCount() == 0);
+
+	return mbs;
+}
+
+// 256KB in page programs on erased flash, returns MB/s
+static double TestProgram(bool bQuad, uint64_t &BusTime)
+{
+	uint8_t img[TEST_SFDP_IMG_MAX];
+	NORFLASHSIM_TIMING timing;
+	NorFlashSim sim;
+	FlashDiskIO flash;
+	uint8_t rd[1];
+	int bad = 0;
+
+	TEST_CHECK(Setup(sim, flash, img, timing, s_Modes[NBMODE - 1], bQuad));
+
+	for (int i = 0; i < PROG_SIZE; i++)
+	{
+		s_Buff[i] = Random();
+	}
+
+	uint64_t t0 = sim.Time();
+
+	for (int a = 0; a < PROG_SIZE; a += 256)
+	{
+		uint64_t t = sim.Time();
+
+		bad += flash.ProgramStart(PROG_BASE + a, s_Buff + a, 256) != 256;
+		BusTime += sim.Time() - t;
+
+		// Next page ready once this one is done
+		while (flash.IsBusy())
+		{
+			sim.Delay(WAIT_US);
+		}
+	}
+	flash.ReadData(PROG_BASE, rd, 1);
+
+	uint64_t t = sim.Time() - t0;
+	double mbs = PROG_SIZE / (t / 1e9) / 1e6;
+	uint8_t cmd = bQuad ? FLASH_CMD_QUAD_WRITE : FLASH_CMD_WRITE;
+
+	printf("%-16s : %6.2f MB/s, %5.1f us per page command, opcode 0x%02X\n", bQuad ? "quad program" : "page program",
+		   mbs, BusTime / 1e3 / (PROG_SIZE / 256), cmd);
+
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(memcmp(sim.Mem() + PROG_BASE, s_Buff, PROG_SIZE) == 0);
+	TEST_CHECK(sim.CmdCount(cmd) == PROG_SIZE / 256 && sim.ProgOpCount() == PROG_SIZE / 256);
+	TEST_CHECK(sim.ProgErrorCount() == 0 && sim.LineErrorCount() == 0 && sim.BusyErrorCount() == 0);
+
+	return mbs;
+}
+
+int main()
+{
+	double mbs[NBMODE];
+
+	printf("Read 1MB, W25Q128JV\n");
+	for (int i = 0; i < NBMODE; i++)
+	{
+		mbs[i] = TestRead(s_Modes[i]);
+	}
+
+	// Data phase on 2 and 4 lines
+	TEST_CHECK(mbs[1] > mbs[0]);
+	TEST_CHECK(mbs[2] > 1.5 * mbs[1] && mbs[3] > mbs[2]);
+	TEST_CHECK(mbs[4] > 1.5 * mbs[3] && mbs[5] > mbs[4]);
+	TEST_CHECK(mbs[5] > 3 * mbs[1]);
+
+	uint64_t bus[2] = { 0, 0 };
+
+	printf("Program 256KB, page program %u us\n", s_Timing.ProgTime);
+	double single = TestProgram(false, bus[0]);
+	double quad = TestProgram(true, bus[1]);
+
+	// Page program time dominates, quad only shortens the transfer
+	TEST_CHECK(quad >= single);
+	TEST_CHECK(bus[1] * 2 < bus[0]);
+
+	printf("flash_xfer : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
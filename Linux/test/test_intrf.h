@@ -0,0 +1,128 @@
+/**-------------------------------------------------------------------------
+@file	test_intrf.h
+
+@brief	Mock register interface for host tests
+
+Register file behind a mock I2C interface.  Transfers are counted, the test can
+hook register reads and writes to emulate device behavior such as self
+clearing bits.  In pair mode, write data is a list of register/data pairs as
+sent to devices that do not auto increment the address on write.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __TEST_INTRF_H__
+#define __TEST_INTRF_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include "device_intrf.h"
+
+class TestIntrf : public DeviceIntrf {
+public:
+	TestIntrf() : NbRead(0), NbWrite(0), bPairWrite(false) {
+		memset(Reg, 0, sizeof(Reg));
+		memset(&vDevIntrf, 0, sizeof(vDevIntrf));
+	}
+	virtual ~TestIntrf() {}
+
+	operator DEVINTRF * const () { return &vDevIntrf; }
+	DEVINTRF_TYPE Type() { return DEVINTRF_TYPE_I2C; }
+	int Rate(int DataRate) { return DataRate; }
+	int Rate() { return 0; }
+	void Disable() {}
+	void Enable() {}
+	bool StartRx(int DevAddr) { (void)DevAddr; return true; }
+	int RxData(uint8_t *pBuff, int BuffLen) { (void)pBuff; (void)BuffLen; return 0; }
+	void StopRx() {}
+	bool StartTx(int DevAddr) { (void)DevAddr; return true; }
+	int TxData(uint8_t *pData, int DataLen) { (void)pData; (void)DataLen; return 0; }
+	void StopTx() {}
+
+	int Read(int DevAddr, uint8_t *pAdCmd, int AdCmdLen, uint8_t *pBuff, int BuffLen) {
+		(void)DevAddr; (void)AdCmdLen;
+		NbRead++;
+		for (int i = 0; i < BuffLen; i++)
+		{
+			uint8_t r = *pAdCmd + i;
+
+			pBuff[i] = Reg[r];
+			OnRead(r);
+		}
+		return BuffLen;
+	}
+
+	int Write(int DevAddr, uint8_t *pAdCmd, int AdCmdLen, uint8_t *pData, int DataLen) {
+		(void)DevAddr;
+		NbWrite++;
+		if (AdCmdLen > 1)
+		{
+			// Data appended to the address
+			for (int i = 1; i < AdCmdLen; i++)
+			{
+				SetReg(pAdCmd[0] + i - 1, pAdCmd[i]);
+			}
+			return AdCmdLen;
+		}
+		if (bPairWrite)
+		{
+			SetReg(*pAdCmd, pData[0]);
+			for (int i = 1; i + 1 < DataLen; i += 2)
+			{
+				SetReg(pData[i], pData[i + 1]);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < DataLen; i++)
+			{
+				SetReg(*pAdCmd + i, pData[i]);
+			}
+		}
+		return DataLen;
+	}
+
+	int NbXfer() { return NbRead + NbWrite; }
+	void ClearCount() { NbRead = NbWrite = 0; }
+
+	uint8_t Reg[256];
+	int NbRead;				//!< Read transfers
+	int NbWrite;			//!< Write transfers
+	bool bPairWrite;		//!< Write data is register/data pairs
+
+protected:
+	virtual void OnRead(uint8_t RegAddr) { (void)RegAddr; }		//!< Called after a register is read
+	virtual void OnWrite(uint8_t RegAddr) { (void)RegAddr; }	//!< Called after a register is written
+
+private:
+	void SetReg(uint8_t RegAddr, uint8_t Val) { Reg[RegAddr] = Val; OnWrite(RegAddr); }
+
+	DEVINTRF vDevIntrf;
+};
+
+#endif	// __TEST_INTRF_H__
@@ -0,0 +1,237 @@
+/**-------------------------------------------------------------------------
+@file	test_reg_shadow.cpp
+
+@brief	Register shadow test
+
+Checks the Device register shadow on a generic register file, then counts bus
+transfers of the BME280 and MPU9250 init sequences through a mock interface
+against the counts before the shadow was added.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <string.h>
+#include <new>
+
+#include "device.h"
+#include "sensors/tph_bme280.h"
+#include "sensors/agm_mpu9250.h"
+#include "test_intrf.h"
+#include "test_util.h"
+
+// Transfers counted before the register shadow
+#define BME280_INIT_XFER_ORG		12
+#define BME280_SAMPLING_XFER_ORG	20
+#define MPU9250_INIT_XFER_ORG		32
+
+// Registers set by a reset write
+class ResetIntrf : public TestIntrf {
+protected:
+	void OnWrite(uint8_t RegAddr) {
+		if (RegAddr == BME280_REG_RESET ||
+			(RegAddr == MPU9250_AG_PWR_MGMT_1 && (Reg[RegAddr] & MPU9250_AG_PWR_MGMT_1_H_RESET)))
+		{
+			Reg[MPU9250_AG_PWR_MGMT_1] = 1;
+		}
+	}
+};
+
+// Registers 0x10-0x1F, 0x14 read only, 0x18 volatile
+static const uint8_t s_TestWrMap[2] = { 0xEF, 0xFF };
+static const uint8_t s_TestVolMap[2] = { 0x00, 0x01 };
+static const DEVREGSHADOW_CFG s_TestShadowCfg = {
+	0x10, 16, true, s_TestWrMap, s_TestVolMap
+};
+
+class TestDev : public Device {
+public:
+	bool Init(TestIntrf *pIntrf) {
+		Interface(pIntrf);
+		return RegShadowInit(&s_TestShadowCfg, vShadowMem);
+	}
+	bool Enable() { return true; }
+	void Disable() {}
+	void Reset() { RegShadowInvalidate(); }
+
+private:
+	uint8_t vShadowMem[DEVREGSHADOW_MEMSIZE(16)];
+};
+
+static void TestShadow()
+{
+	TestIntrf intrf;
+	TestDev dev;
+	uint8_t reg;
+
+	for (int i = 0; i < 16; i++)
+	{
+		intrf.Reg[0x10 + i] = i;
+	}
+	TEST_CHECK(dev.Init(&intrf));
+
+	// First read goes to the device, next ones come from RAM
+	reg = 0x12;
+	TEST_CHECK(dev.Read8(&reg, 1) == 2);
+	reg = 0x12;
+	TEST_CHECK(dev.Read8(&reg, 1) == 2);
+	TEST_CHECK(intrf.NbRead == 1);
+
+	// Volatile register is always read
+	reg = 0x18;
+	dev.Read8(&reg, 1);
+	intrf.Reg[0x18] = 0x55;
+	reg = 0x18;
+	TEST_CHECK(dev.Read8(&reg, 1) == 0x55);
+	TEST_CHECK(intrf.NbRead == 3);
+
+	// Writing the value held is skipped, read only register is rejected
+	reg = 0x12;
+	TEST_CHECK(dev.Write8(&reg, 1, 2));
+	TEST_CHECK(intrf.NbWrite == 0);
+	reg = 0x12;
+	TEST_CHECK(dev.Write8(&reg, 1, 0x22));
+	TEST_CHECK(intrf.NbWrite == 1 && intrf.Reg[0x12] == 0x22);
+	reg = 0x14;
+	TEST_CHECK(dev.Write8(&reg, 1, 0x44) == false);
+	TEST_CHECK(intrf.NbWrite == 1 && intrf.Reg[0x14] == 4);
+
+	// Deferred updates of consecutive registers are flushed in one burst
+	TEST_CHECK(dev.RegShadowSync());
+	intrf.ClearCount();
+	for (uint8_t r = 0x1A; r < 0x1D; r++)
+	{
+		reg = r;
+		TEST_CHECK(dev.Update8(&reg, 1, 0xF0, 0xA0, true));
+	}
+	reg = 0x1A;
+	TEST_CHECK(dev.Update8(&reg, 1, 0x0F, 0x0A, true));
+	TEST_CHECK(intrf.NbXfer() == 0);
+	TEST_CHECK(intrf.Reg[0x1A] == 0x0A);
+	TEST_CHECK(dev.RegShadowFlush());
+	TEST_CHECK(intrf.NbWrite == 1 && intrf.NbRead == 0);
+	TEST_CHECK(intrf.Reg[0x1A] == 0xAA && intrf.Reg[0x1B] == 0xAB && intrf.Reg[0x1C] == 0xAC);
+	TEST_CHECK(dev.RegShadowFlush());
+	TEST_CHECK(intrf.NbWrite == 1);
+
+	// Reset invalidates, values are reloaded from the device
+	intrf.Reg[0x12] = 0x77;
+	dev.Reset();
+	reg = 0x12;
+	TEST_CHECK(dev.Read8(&reg, 1) == 0x77);
+
+	// Sync reloads with burst reads around the volatile register
+	intrf.NbRead = 0;
+	TEST_CHECK(dev.RegShadowSync());
+	TEST_CHECK(intrf.NbRead == 2);
+}
+
+static void TestBme280()
+{
+	ResetIntrf intrf;
+	// Not constructed by the test, no virtual destructor to call
+	static char mem[sizeof(TphBme280)];
+	TphBme280 &dev = *new (mem) TphBme280;
+	HUMISENSOR_CFG hcfg;
+	PRESSSENSOR_CFG pcfg;
+	TEMPSENSOR_CFG tcfg;
+
+	intrf.Reg[BME280_REG_ID] = BME280_ID;
+
+	memset(&hcfg, 0, sizeof(hcfg));
+	hcfg.DevAddr = BME280_I2C_DEV_ADDR0;
+	hcfg.HumOvrs = 1;
+	memset(&pcfg, 0, sizeof(pcfg));
+	pcfg.DevAddr = BME280_I2C_DEV_ADDR0;
+	pcfg.PresOvrs = 1;
+	memset(&tcfg, 0, sizeof(tcfg));
+	tcfg.DevAddr = BME280_I2C_DEV_ADDR0;
+	tcfg.OpMode = SENSOR_OPMODE_CONTINUOUS;
+	tcfg.Freq = 1000;
+	tcfg.TempOvrs = 1;
+	tcfg.FilterCoeff = 2;
+
+	TEST_CHECK(dev.Init(hcfg, &intrf, NULL));
+	TEST_CHECK(dev.Init(pcfg, &intrf, NULL));
+	TEST_CHECK(dev.Init(tcfg, &intrf, NULL));
+
+	int init = intrf.NbXfer();
+
+	intrf.ClearCount();
+	for (int i = 0; i < 10; i++)
+	{
+		dev.StartSampling();
+	}
+
+	int samp = intrf.NbXfer();
+
+	printf("BME280 init : %d transfers, was %d\n", init, BME280_INIT_XFER_ORG);
+	printf("BME280 10 x StartSampling : %d transfers, was %d\n", samp, BME280_SAMPLING_XFER_ORG);
+	TEST_CHECK(init < BME280_INIT_XFER_ORG);
+	TEST_CHECK(samp < BME280_SAMPLING_XFER_ORG);
+	TEST_CHECK((intrf.Reg[BME280_REG_CTRL_MEAS] & BME280_REG_CTRL_MEAS_MODE_MASK) != 0);
+}
+
+static void TestMpu9250()
+{
+	ResetIntrf intrf;
+	static char mem[sizeof(AgmMpu9250)];
+	AgmMpu9250 &dev = *new (mem) AgmMpu9250;
+	ACCELSENSOR_CFG acfg;
+	GYROSENSOR_CFG gcfg;
+
+	intrf.Reg[MPU9250_AG_WHO_AM_I] = MPU9250_AG_WHO_AM_I_ID;
+
+	memset(&acfg, 0, sizeof(acfg));
+	acfg.Freq = 50000;
+	acfg.Scale = 2;
+	acfg.LPFreq = 100;
+	memset(&gcfg, 0, sizeof(gcfg));
+	gcfg.Freq = 50000;
+	gcfg.Sensitivity = 500;
+	gcfg.LPFreq = 100;
+
+	TEST_CHECK(dev.Init(acfg, &intrf, NULL));
+	TEST_CHECK(dev.Init(gcfg, &intrf, NULL));
+	dev.Enable();
+
+	int init = intrf.NbXfer();
+
+	printf("MPU9250 accel, gyro init and enable : %d transfers, was %d\n", init, MPU9250_INIT_XFER_ORG);
+	TEST_CHECK(init < MPU9250_INIT_XFER_ORG);
+}
+
+int main()
+{
+	TestShadow();
+	TestBme280();
+	TestMpu9250();
+
+	printf("reg_shadow : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,184 @@
+/**-------------------------------------------------------------------------
+@file	test_sdcard.cpp
+
+@brief	SD card multi-block transfer test
+
+Writes and reads blocks on the SD SPI simulator with single block commands
+and multi-block streams of 8 to 128 blocks, through the C++ and the C SD
+drivers.  Checks the data, the ACMD23 pre-erase of multi-block writes, the
+absence of protocol and CRC errors, and the throughput gained by streams on
+the simulated card timing.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sdcard.h"
+#include "sdcard_sim.h"
+#include "test_util.h"
+
+#define NBBLK			2048
+#define START_BLK		1000
+
+static const SDCARDSIM_TIMING s_Timing = {
+	25000000, 1000,			// 25MHz SPI, 1us per transfer
+	500, 100,				// Read access, first and following stream blocks
+	1500, 400, 250,			// Program single, stream and pre-erased stream blocks
+	500,					// Busy after stream stop
+	256, 50000,				// 50ms garbage collection stall
+};
+
+static const SDCARDSIM_CFG s_SimCfg = { 64 * 1024 * 1024 / 512, &s_Timing };
+
+static uint8_t s_Src[NBBLK * 512];
+static uint8_t s_Dst[NBBLK * 512];
+
+typedef struct {
+	double WrUs;			// Write time per block
+	double RdUs;			// Read time per block
+	uint32_t PreErased;		// Blocks written pre-erased
+} SDRESULT;
+
+static int Write(SDCard *pSd, SDDEV *pDev, uint32_t Addr, uint8_t *p, int NbBlk)
+{
+	if (pSd)
+	{
+		return NbBlk == 1 ? (pSd->SectWrite(Addr, p) ? 1 : 0) : pSd->SectWriteMulti(Addr, p, NbBlk);
+	}
+
+	return NbBlk == 1 ? (SDWriteSingleBlock(pDev, Addr, p, 512) == 512 ? 1 : 0) :
+						SDWriteMultiBlock(pDev, Addr, p, NbBlk);
+}
+
+static int Read(SDCard *pSd, SDDEV *pDev, uint32_t Addr, uint8_t *p, int NbBlk)
+{
+	if (pSd)
+	{
+		return NbBlk == 1 ? (pSd->SectRead(Addr, p) ? 1 : 0) : pSd->SectReadMulti(Addr, p, NbBlk);
+	}
+
+	return NbBlk == 1 ? (SDReadSingleBlock(pDev, Addr, p, 512) == 512 ? 1 : 0) :
+						SDReadMultiBlock(pDev, Addr, p, NbBlk);
+}
+
+// NBBLK blocks written then read by requests of NbBlk blocks
+static SDRESULT Run(bool bCDrv, int NbBlk)
+{
+	SdCardSim sim;
+	SDCard sd;
+	SDDEV cdev;
+	SDRESULT res;
+	int bad = 0;
+
+	memset(&res, 0, sizeof(res));
+	TEST_CHECK(sim.Init(s_SimCfg));
+	if (bCDrv)
+	{
+		SDCFG cfg = { 0, sim };
+
+		TEST_CHECK(SDInit(&cdev, &cfg));
+	}
+	else
+	{
+		TEST_CHECK(sd.Init(&sim, (uint8_t*)NULL, 0));
+	}
+
+	SDCard *psd = bCDrv ? NULL : &sd;
+	uint64_t t = sim.Time();
+
+	for (int b = 0; b < NBBLK; b += NbBlk)
+	{
+		bad += Write(psd, &cdev, START_BLK + b, &s_Src[b * 512], NbBlk) != NbBlk;
+	}
+	res.WrUs = (sim.Time() - t) / 1e3 / NBBLK;
+	res.PreErased = sim.PreErasedCount();
+	bad += memcmp(sim.Mem() + START_BLK * 512, s_Src, sizeof(s_Src)) != 0;
+
+	memset(s_Dst, 0, sizeof(s_Dst));
+	t = sim.Time();
+	for (int b = 0; b < NBBLK; b += NbBlk)
+	{
+		bad += Read(psd, &cdev, START_BLK + b, &s_Dst[b * 512], NbBlk) != NbBlk;
+	}
+	res.RdUs = (sim.Time() - t) / 1e3 / NBBLK;
+	bad += memcmp(s_Dst, s_Src, sizeof(s_Src)) != 0;
+
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(sim.ProtoErrorCount() == 0 && sim.CrcErrorCount() == 0);
+
+	printf("%s %3d blocks : write %6.1f us/blk, read %5.1f us/blk, %u pre-erased\n",
+		   bCDrv ? "C  " : "C++", NbBlk, res.WrUs, res.RdUs, res.PreErased);
+
+	return res;
+}
+
+int main()
+{
+	static const int nbblk[] = { 1, 8, 32, 128 };
+	SDRESULT res[2][4];
+
+	for (int i = 0; i < (int)sizeof(s_Src); i++)
+	{
+		s_Src[i] = (uint8_t)(i * 131 + (i >> 9) * 7);
+	}
+
+	for (int d = 0; d < 2; d++)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			res[d][i] = Run(d == 1, nbblk[i]);
+		}
+	}
+
+	for (int d = 0; d < 2; d++)
+	{
+		// Streams are pre-erased with ACMD23, single block writes are not
+		TEST_CHECK(res[d][0].PreErased == 0);
+		for (int i = 1; i < 4; i++)
+		{
+			TEST_CHECK(res[d][i].PreErased == NBBLK);
+		}
+
+		// Streams of 32 blocks write 4 times and read twice as fast as single blocks
+		TEST_CHECK(res[d][2].WrUs * 4 < res[d][0].WrUs);
+		TEST_CHECK(res[d][2].RdUs * 2 < res[d][0].RdUs);
+	}
+
+	// Both drivers run the same stream protocol
+	for (int i = 1; i < 4; i++)
+	{
+		TEST_CHECK(res[1][i].WrUs < res[0][i].WrUs * 1.02 && res[0][i].WrUs < res[1][i].WrUs * 1.02);
+		TEST_CHECK(res[1][i].RdUs < res[0][i].RdUs * 1.02 && res[0][i].RdUs < res[1][i].RdUs * 1.02);
+	}
+
+	printf("sdcard : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,369 @@
+/**-------------------------------------------------------------------------
+@file	test_sdcard_async.cpp
+
+@brief	SD card non-blocking request queue test
+
+Writes and reads a file sized run of blocks on the SD SPI simulator with
+latency spikes, once through the blocking SDCard stream calls and once
+through the SDCardAsync queue, while the main loop does a fixed amount of
+work per iteration.  Checks the data and that the queue keeps the longest
+main loop gap to a single protocol phase instead of a whole spike, at a
+similar throughput.  A random mix of reads and writes, including requests
+past the card end and writes submitted from the completion callback, is
+then checked against a shadow copy of the card for queues of 1 to 7 entries,
+with CRC on and off.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "sdcard.h"
+#include "sdcard_async.h"
+#include "sdcard_sim.h"
+#include "test_util.h"
+
+#define NBBLK			2048
+#define START_BLK		1000
+#define REQ_BLK			8		// Blocks per request
+#define LOOP_US			20		// Main loop work per iteration
+
+static const SDCARDSIM_TIMING s_Timing = {
+	25000000, 1000,			// 25MHz SPI, 1us per transfer
+	500, 100,				// Read access, first and following stream blocks
+	1500, 400, 250,			// Program single, stream and pre-erased stream blocks
+	500,					// Busy after stream stop
+	256, 50000,				// 50ms garbage collection stall
+};
+
+static const SDCARDSIM_CFG s_SimCfg = { 64 * 1024 * 1024 / 512, &s_Timing };
+
+static uint8_t s_Src[NBBLK * 512];
+static uint8_t s_Dst[NBBLK * 512];
+static SDCARDASYNC_REQ s_ReqMem[16];
+static uint32_t s_Seed = 50;
+
+static uint32_t Random()
+{
+	s_Seed = s_Seed * 1103515245 + 12345;
+
+	return s_Seed >> 8;
+}
+
+static int s_DoneBlk;
+static int s_Failed;
+
+static void Done(SDCARDASYNC_REQ * const pReq, int Result)
+{
+	s_Failed += Result != pReq->NbBlk;
+	s_DoneBlk += Result;
+}
+
+// Longest time between main loop iterations
+typedef struct {
+	uint64_t Last;
+	uint64_t Max;
+	uint32_t Count;
+} LOOPGAP;
+
+static void Loop(SdCardSim &Sim, LOOPGAP &Gap)
+{
+	uint64_t t = Sim.Time();
+
+	if (Gap.Count++ > 0 && t - Gap.Last > Gap.Max)
+	{
+		Gap.Max = t - Gap.Last;
+	}
+	Gap.Last = t;
+	Sim.Delay(LOOP_US);
+}
+
+typedef struct {
+	double KBs[2];			// Throughput, read and write
+	double GapMs[2];		// Longest main loop gap, read and write
+} LATRESULT;
+
+static LATRESULT Latency(bool bAsync)
+{
+	SdCardSim sim;
+	SDCard sd;
+	SDCardAsync sdasync;
+	SDCARDASYNC_CFG cfg = { s_ReqMem, sizeof(s_ReqMem) / sizeof(SDCARDASYNC_REQ) };
+	LATRESULT res;
+	int bad = 0;
+
+	TEST_CHECK(sim.Init(s_SimCfg));
+	sim.Spikes(64, 200000, 12345);
+	TEST_CHECK(sd.Init(&sim, (uint8_t*)NULL, 0));
+	if (bAsync)
+	{
+		TEST_CHECK(sdasync.Init(cfg, &sd));
+	}
+
+	memset(s_Dst, 0, sizeof(s_Dst));
+	for (int w = 1; w >= 0; w--)
+	{
+		LOOPGAP gap = { 0, 0, 0 };
+		uint64_t t = sim.Time();
+		uint8_t *p = w ? s_Src : s_Dst;
+
+		if (bAsync)
+		{
+			int sub = 0;
+
+			s_DoneBlk = 0;
+			s_Failed = 0;
+			while (s_DoneBlk < NBBLK && s_Failed == 0)
+			{
+				Loop(sim, gap);
+				if (sub < NBBLK)
+				{
+					SDCARDASYNC_REQ req = {
+						w ? SDCARDASYNC_OP_WRITE : SDCARDASYNC_OP_READ, (uint32_t)(START_BLK + sub),
+						&p[sub * 512], REQ_BLK, Done, NULL
+					};
+
+					if (sdasync.Submit(req))
+					{
+						sub += REQ_BLK;
+					}
+				}
+				sdasync.Process();
+			}
+
+			// Ends the write stream
+			while (sdasync.Process())
+			{
+				Loop(sim, gap);
+			}
+			bad += s_Failed;
+		}
+		else
+		{
+			for (int b = 0; b < NBBLK; b += REQ_BLK)
+			{
+				Loop(sim, gap);
+				bad += (w ? sd.SectWriteMulti(START_BLK + b, &p[b * 512], REQ_BLK) :
+							sd.SectReadMulti(START_BLK + b, &p[b * 512], REQ_BLK)) != REQ_BLK;
+			}
+			Loop(sim, gap);
+		}
+		res.KBs[w] = NBBLK * 0.5 * 1e9 / (sim.Time() - t);
+		res.GapMs[w] = gap.Max / 1e6;
+	}
+	bad += memcmp(sim.Mem() + START_BLK * 512, s_Src, sizeof(s_Src)) != 0;
+	bad += memcmp(s_Dst, s_Src, sizeof(s_Src)) != 0;
+
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(sim.ProtoErrorCount() == 0 && sim.CrcErrorCount() == 0);
+	TEST_CHECK(sim.SpikeCount() > 0);
+
+	printf("%s : write %6.1f KB/s, max loop gap %7.2f ms, read %6.1f KB/s, max loop gap %7.2f ms, %u spikes\n",
+		   bAsync ? "async   " : "blocking", res.KBs[1], res.GapMs[1], res.KBs[0], res.GapMs[0], sim.SpikeCount());
+
+	return res;
+}
+
+// Random request mix checked against a shadow copy of the card
+
+#define MIX_NBBLK		1024
+
+static const SDCARDSIM_TIMING s_MixTiming = { 25000000, 1000, 500, 100, 1500, 400, 250, 500, 64, 5000 };
+static const SDCARDSIM_CFG s_MixCfg = { MIX_NBBLK, &s_MixTiming };
+
+typedef struct {
+	std::vector<uint8_t> Data;
+	std::vector<uint8_t> Expected;	// Read data expected, empty for writes
+	bool bFail;						// Request past the card end, must fail
+} MIXCTX;
+
+static std::vector<uint8_t> s_Shadow(MIX_NBBLK * 512);
+static SDCardAsync *s_pMixAsync;
+static int s_MixChain;
+static int s_MixOk;
+static int s_MixFailed;
+static int s_MixBad;
+
+static void MixDone(SDCARDASYNC_REQ * const pReq, int Result)
+{
+	MIXCTX *ctx = (MIXCTX*)pReq->pCtx;
+
+	if (ctx->bFail)
+	{
+		s_MixBad += Result == pReq->NbBlk;
+		s_MixFailed++;
+	}
+	else
+	{
+		s_MixBad += Result != pReq->NbBlk ||
+					(ctx->Expected.size() > 0 && memcmp(ctx->Data.data(), ctx->Expected.data(), ctx->Expected.size()));
+		s_MixOk++;
+	}
+	delete ctx;
+
+	// Continue some writes from the callback
+	if (s_MixChain > 0 && pReq->Op == SDCARDASYNC_OP_WRITE && pReq->Addr + pReq->NbBlk + 4 <= MIX_NBBLK &&
+		(Random() & 3) == 0)
+	{
+		MIXCTX *next = new MIXCTX;
+
+		next->bFail = false;
+		next->Data.resize(4 * 512);
+		for (auto &d : next->Data)
+		{
+			d = Random();
+		}
+
+		SDCARDASYNC_REQ req = { SDCARDASYNC_OP_WRITE, pReq->Addr + pReq->NbBlk, next->Data.data(), 4, MixDone, next };
+
+		if (s_pMixAsync->Submit(req))
+		{
+			memcpy(&s_Shadow[req.Addr * 512], next->Data.data(), 4 * 512);
+			s_MixChain--;
+		}
+		else
+		{
+			delete next;
+		}
+	}
+}
+
+static void Mix(int Seed)
+{
+	SdCardSim sim;
+	SDCard sd;
+	SDCardAsync sdasync;
+	SDCARDASYNC_REQ mem[7];
+	SDCARDASYNC_CFG cfg = { mem, 1 + Seed % 7 };
+	uint32_t last = 0;
+	int lastop = 0;
+
+	s_pMixAsync = &sdasync;
+	s_MixChain = 50;
+	memset(s_Shadow.data(), 0, s_Shadow.size());
+
+	TEST_CHECK(sim.Init(s_MixCfg));
+	sim.Spikes(8, 3000, Seed);
+	TEST_CHECK(sd.Init(&sim, (uint8_t*)NULL, 0));
+	if (Seed & 1)
+	{
+		TEST_CHECK(sd.Crc(false));
+	}
+	TEST_CHECK(sdasync.Init(cfg, &sd));
+
+	for (int i = 0; i < 3000; i++)
+	{
+		if (Random() % 3 == 0)
+		{
+			int op = Random() & 1;
+			int n = 1 + Random() % 12;
+			uint32_t addr = (Random() & 1) && op == lastop ? last : Random() % (MIX_NBBLK + 6);
+			bool fail = addr + n > MIX_NBBLK;
+
+			// Failed writes may program part of their blocks, the shadow can't follow
+			if (fail && op == SDCARDASYNC_OP_WRITE)
+			{
+				continue;
+			}
+
+			MIXCTX *ctx = new MIXCTX;
+
+			ctx->bFail = fail;
+			ctx->Data.resize(n * 512);
+			if (op == SDCARDASYNC_OP_WRITE)
+			{
+				for (auto &d : ctx->Data)
+				{
+					d = Random();
+				}
+			}
+			else if (fail == false)
+			{
+				ctx->Expected.assign(&s_Shadow[addr * 512], &s_Shadow[(addr + n) * 512]);
+			}
+
+			SDCARDASYNC_REQ req = { op, addr, ctx->Data.data(), n, MixDone, ctx };
+
+			if (sdasync.Submit(req))
+			{
+				if (op == SDCARDASYNC_OP_WRITE)
+				{
+					memcpy(&s_Shadow[addr * 512], ctx->Data.data(), n * 512);
+				}
+				last = addr + n;
+				lastop = op;
+			}
+			else
+			{
+				delete ctx;
+			}
+		}
+		sdasync.Process();
+		sim.Delay(Random() % 50);
+	}
+
+	while (sdasync.Process())
+	{
+		sim.Delay(10);
+	}
+
+	TEST_CHECK(memcmp(sim.Mem(), s_Shadow.data(), s_Shadow.size()) == 0);
+	TEST_CHECK(sim.ProtoErrorCount() == 0 && sim.CrcErrorCount() == 0);
+}
+
+int main()
+{
+	for (int i = 0; i < (int)sizeof(s_Src); i++)
+	{
+		s_Src[i] = Random();
+	}
+
+	LATRESULT blk = Latency(false);
+	LATRESULT async = Latency(true);
+
+	for (int w = 0; w < 2; w++)
+	{
+		// Spikes of up to 200ms stall the blocking calls, the queue returns
+		// after one protocol phase
+		TEST_CHECK(async.GapMs[w] < 1 && async.GapMs[w] * 20 < blk.GapMs[w]);
+		TEST_CHECK(async.KBs[w] > blk.KBs[w] * 0.8);
+	}
+
+	for (int seed = 1; seed <= 14; seed++)
+	{
+		Mix(seed);
+	}
+	printf("random mix : %d requests done, %d failed as expected, %d bad\n", s_MixOk, s_MixFailed, s_MixBad);
+	TEST_CHECK(s_MixBad == 0 && s_MixFailed > 0);
+
+	printf("sdcard_async : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,299 @@
+/**-------------------------------------------------------------------------
+@file	test_sdcard_poll.cpp
+
+@brief	SD card CRC and token polling test
+
+Checks crc16_ccitt against a bitwise reference, then runs single block and
+32 block transfers through the C++ and the C SD drivers, with CRC on and off
+with CMD59.  Bus transfers per block are checked against the windowed data
+token and busy polling budget.  Driver CPU time per block, simulator time
+taken out, is printed for reference only, as it depends on the host and the
+sanitizers.  A sweep of transfer overhead and card access time exercises the
+token found at every position of the polling window.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+
+#include "crc.h"
+#include "sdcard.h"
+#include "sdcard_sim.h"
+#include "test_util.h"
+
+#define NBBLK			512
+#define START_BLK		1000
+
+static const SDCARDSIM_TIMING s_Timing = {
+	25000000, 1000,			// 25MHz SPI, 1us per transfer
+	500, 100,				// Read access, first and following stream blocks
+	1500, 400, 250,			// Program single, stream and pre-erased stream blocks
+	500,					// Busy after stream stop
+	0, 0,					// No garbage collection
+};
+
+static const SDCARDSIM_CFG s_SimCfg = { 64 * 1024 * 1024 / 512, &s_Timing };
+
+static uint8_t s_Src[NBBLK * 512];
+static uint8_t s_Dst[NBBLK * 512];
+static uint32_t s_Seed = 49;
+
+static uint32_t Random()
+{
+	s_Seed = s_Seed * 1103515245 + 12345;
+
+	return s_Seed >> 8;
+}
+
+// Host time spent in the simulator, taken out of the driver time
+static uint64_t s_SimNs;
+
+class TimedSim : public SdCardSim {
+public:
+	bool StartRx(int DevAddr) {
+		auto t = std::chrono::steady_clock::now();
+		bool r = SdCardSim::StartRx(DevAddr);
+		s_SimNs += Elapsed(t);
+		return r;
+	}
+	bool StartTx(int DevAddr) {
+		auto t = std::chrono::steady_clock::now();
+		bool r = SdCardSim::StartTx(DevAddr);
+		s_SimNs += Elapsed(t);
+		return r;
+	}
+	int RxData(uint8_t *pBuff, int BuffLen) {
+		auto t = std::chrono::steady_clock::now();
+		int r = SdCardSim::RxData(pBuff, BuffLen);
+		s_SimNs += Elapsed(t);
+		return r;
+	}
+	int TxData(uint8_t *pData, int DataLen) {
+		auto t = std::chrono::steady_clock::now();
+		int r = SdCardSim::TxData(pData, DataLen);
+		s_SimNs += Elapsed(t);
+		return r;
+	}
+	static uint64_t Elapsed(std::chrono::steady_clock::time_point t) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t).count();
+	}
+};
+
+static uint16_t Crc16Ref(uint8_t *p, int Len, uint16_t Crc)
+{
+	for (int i = 0; i < Len; i++)
+	{
+		Crc ^= p[i] << 8;
+		for (int b = 0; b < 8; b++)
+		{
+			Crc = Crc & 0x8000 ? (Crc << 1) ^ 0x1021 : Crc << 1;
+		}
+	}
+
+	return Crc;
+}
+
+static int Write(SDCard *pSd, SDDEV *pDev, uint32_t Addr, uint8_t *p, int NbBlk)
+{
+	if (pSd)
+	{
+		return NbBlk == 1 ? (pSd->SectWrite(Addr, p) ? 1 : 0) : pSd->SectWriteMulti(Addr, p, NbBlk);
+	}
+
+	return NbBlk == 1 ? (SDWriteSingleBlock(pDev, Addr, p, 512) == 512 ? 1 : 0) :
+						SDWriteMultiBlock(pDev, Addr, p, NbBlk);
+}
+
+static int Read(SDCard *pSd, SDDEV *pDev, uint32_t Addr, uint8_t *p, int NbBlk)
+{
+	if (pSd)
+	{
+		return NbBlk == 1 ? (pSd->SectRead(Addr, p) ? 1 : 0) : pSd->SectReadMulti(Addr, p, NbBlk);
+	}
+
+	return NbBlk == 1 ? (SDReadSingleBlock(pDev, Addr, p, 512) == 512 ? 1 : 0) :
+						SDReadMultiBlock(pDev, Addr, p, NbBlk);
+}
+
+static bool InitCard(SdCardSim &Sim, const SDCARDSIM_CFG &Cfg, bool bCDrv, bool bCrc, SDCard &Sd, SDDEV &CDev)
+{
+	if (Sim.Init(Cfg) == false)
+	{
+		return false;
+	}
+
+	if (bCDrv)
+	{
+		SDCFG cfg = { 0, Sim, !bCrc };
+
+		return SDInit(&CDev, &cfg);
+	}
+
+	if (Sd.Init(&Sim, (uint8_t*)NULL, 0) == false)
+	{
+		return false;
+	}
+
+	return bCrc || Sd.Crc(false);
+}
+
+// Bus transfers per block of NBBLK blocks written then read by requests of
+// NbBlk blocks, checked against Budget
+static void Run(bool bCDrv, bool bCrc, int NbBlk, const double Budget[2])
+{
+	TimedSim sim;
+	SDCard sd;
+	SDDEV cdev;
+	int bad = 0;
+	double xfer[2], ns[2];
+
+	TEST_CHECK(InitCard(sim, s_SimCfg, bCDrv, bCrc, sd, cdev));
+
+	SDCard *psd = bCDrv ? NULL : &sd;
+
+	memset(s_Dst, 0, sizeof(s_Dst));
+	for (int w = 1; w >= 0; w--)
+	{
+		uint32_t x = sim.TransferCount();
+		uint64_t s = s_SimNs;
+		auto t = std::chrono::steady_clock::now();
+
+		for (int b = 0; b < NBBLK; b += NbBlk)
+		{
+			bad += w ? Write(psd, &cdev, START_BLK + b, &s_Src[b * 512], NbBlk) != NbBlk :
+					   Read(psd, &cdev, START_BLK + b, &s_Dst[b * 512], NbBlk) != NbBlk;
+		}
+		ns[w] = (double)(TimedSim::Elapsed(t) - (s_SimNs - s)) / NBBLK;
+		xfer[w] = (double)(sim.TransferCount() - x) / NBBLK;
+	}
+	bad += memcmp(sim.Mem() + START_BLK * 512, s_Src, sizeof(s_Src)) != 0;
+	bad += memcmp(s_Dst, s_Src, sizeof(s_Src)) != 0;
+
+	TEST_CHECK(bad == 0);
+	TEST_CHECK(sim.ProtoErrorCount() == 0 && sim.CrcErrorCount() == 0);
+	TEST_CHECK(xfer[1] < Budget[1] && xfer[0] < Budget[0]);
+
+	printf("%s %3d blocks CRC %-3s : write %5.1f xfers/blk %6.0f ns/blk, read %5.1f xfers/blk %6.0f ns/blk\n",
+		   bCDrv ? "C  " : "C++", NbBlk, bCrc ? "on" : "off", xfer[1], ns[1], xfer[0], ns[0]);
+}
+
+// Transfer overhead and access time sweep, moves the data token and the end of
+// busy across the polling window
+static void Sweep()
+{
+	int runs = 0, bad = 0;
+
+	for (uint32_t cs = 0; cs < 2000; cs += 137)
+	{
+		for (uint32_t rt = 0; rt < 40; rt += 7)
+		{
+			for (int d = 0; d < 2; d++)
+			{
+				SDCARDSIM_TIMING tm = { 25000000, cs, rt, rt / 3, 10, 5, 3, 2, 0, 0 };
+				SDCARDSIM_CFG cfg = { 1024, &tm };
+				SdCardSim sim;
+				SDCard sd;
+				SDDEV cdev;
+				SDCard *psd = d ? NULL : &sd;
+				int n = 0;
+
+				runs++;
+				if (InitCard(sim, cfg, d == 1, true, sd, cdev) == false)
+				{
+					bad++;
+					continue;
+				}
+
+				memcpy(sim.Mem() + 100 * 512, s_Src, 64 * 512);
+				memset(s_Dst, 0, 64 * 512);
+				for (int b = 0; b < 64; b += 8)
+				{
+					n += Read(psd, &cdev, 100 + b, &s_Dst[b * 512], 8);
+				}
+				for (int b = 0; b < 8; b++)
+				{
+					n += Read(psd, &cdev, 100 + b, &s_Dst[b * 512], 1);
+				}
+				n += Write(psd, &cdev, 300, s_Src, 16);
+				n += Write(psd, &cdev, 400, s_Src, 1);
+
+				if (n != 64 + 8 + 16 + 1 || memcmp(s_Dst, s_Src, 64 * 512) ||
+					memcmp(sim.Mem() + 300 * 512, s_Src, 16 * 512) || memcmp(sim.Mem() + 400 * 512, s_Src, 512) ||
+					sim.ProtoErrorCount() || sim.CrcErrorCount())
+				{
+					printf("Sweep failed : overhead %u ns, access %u us, %s driver\n", cs, rt, d ? "C" : "C++");
+					bad++;
+				}
+			}
+		}
+	}
+
+	printf("Sweep : %d runs, %d failed\n", runs, bad);
+	TEST_CHECK(bad == 0);
+}
+
+int main()
+{
+	// Transfers per block budget, read and write.  Byte by byte polling of the
+	// data token and busy takes several times more
+	static const double single[2] = { 100, 300 };
+	static const double multi[2] = { 25, 60 };
+	int crcbad = 0;
+
+	for (int i = 0; i < (int)sizeof(s_Src); i++)
+	{
+		s_Src[i] = Random();
+	}
+
+	for (int i = 0; i < 20000; i++)
+	{
+		int off = Random() % 100;
+		int len = Random() % 600;
+		uint16_t seed = Random();
+
+		crcbad += crc16_ccitt(&s_Src[off], len, seed) != Crc16Ref(&s_Src[off], len, seed);
+	}
+	TEST_CHECK(crcbad == 0);
+
+	for (int d = 0; d < 2; d++)
+	{
+		for (int c = 1; c >= 0; c--)
+		{
+			Run(d == 1, c == 1, 1, single);
+			Run(d == 1, c == 1, 32, multi);
+		}
+	}
+
+	Sweep();
+
+	printf("sdcard_poll : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,311 @@
+/**-------------------------------------------------------------------------
+@file	test_sensor_calib.cpp
+
+@brief	Sensor calibration engine test
+
+Fits accelerometer six position, gyroscope bias with temperature coefficient
+and magnetometer ellipsoid calibrations on simulated data, checks the gyro
+sensor compensates its bias with its last temperature and Imu::Calibrate
+updates the bias while keeping the temperature coefficient.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "imu/imu.h"
+#include "sensors/sensor_calib.h"
+#include "test_util.h"
+
+// Gaussian noise
+static double Noise()
+{
+	double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+	double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+	return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static void RandDir(double Dir[3])
+{
+	double l;
+
+	do {
+		Dir[0] = Noise();
+		Dir[1] = Noise();
+		Dir[2] = Noise();
+		l = sqrt(Dir[0] * Dir[0] + Dir[1] * Dir[1] + Dir[2] * Dir[2]);
+	} while (l < 1e-3);
+
+	for (int i = 0; i < 3; i++)
+	{
+		Dir[i] /= l;
+	}
+}
+
+static void Correct(const SENSOR_CALIB &Calib, const double In[3], double Out[3])
+{
+	for (int i = 0; i < 3; i++)
+	{
+		Out[i] = Calib.Offset[i];
+		for (int j = 0; j < 3; j++)
+		{
+			Out[i] += Calib.Gain[i][j] * In[j];
+		}
+	}
+}
+
+static void TestAccel()
+{
+	const double a[3][3] = { { 1.02, 0.01, -0.02 }, { 0.015, 0.97, 0.005 }, { -0.01, 0.02, 1.05 } };
+	const double b[3] = { 0.03, -0.05, 0.02 };
+	AccelCalib calib(200);
+	SENSOR_CALIB c;
+	uint32_t pos = 0;
+
+	for (int p = 0; p < 6; p++)
+	{
+		for (int n = 0; n < 300; n++)
+		{
+			ACCELSENSOR_DATA d;
+
+			for (int i = 0; i < 3; i++)
+			{
+				d.Val[i] = b[i] + a[i][p / 2] * ((p & 1) ? -1 : 1) + Noise() * 0.005;
+			}
+			pos = calib.AddSample(d);
+		}
+	}
+	TEST_CHECK(pos == ACCELCALIB_POS_ALL);
+	TEST_CHECK(calib.Fit(c));
+
+	double maxerr = 0;
+
+	for (int n = 0; n < 100; n++)
+	{
+		double g[3], m[3], o[3];
+
+		RandDir(g);
+		for (int i = 0; i < 3; i++)
+		{
+			m[i] = b[i] + a[i][0] * g[0] + a[i][1] * g[1] + a[i][2] * g[2];
+		}
+		Correct(c, m, o);
+		for (int i = 0; i < 3; i++)
+		{
+			maxerr = fmax(maxerr, fabs(o[i] - g[i]));
+		}
+	}
+	TEST_CHECK(maxerr < 0.005);
+}
+
+static void TestMag()
+{
+	const double s[3][3] = { { 1.1, 0.05, 0.02 }, { 0.05, 0.9, -0.03 }, { 0.02, -0.03, 1.0 } };
+	const double h[3] = { 120, -80, 40 };
+	const double f = 480;
+	MagCalib calib;
+	SENSOR_CALIB c;
+
+	for (int n = 0; n < 2000; n++)
+	{
+		MAGSENSOR_DATA d;
+		double u[3];
+
+		RandDir(u);
+		for (int i = 0; i < 3; i++)
+		{
+			d.Val[i] = h[i] + f * (s[i][0] * u[0] + s[i][1] * u[1] + s[i][2] * u[2]) + Noise() * 2;
+		}
+		calib.AddSample(d);
+	}
+	TEST_CHECK(calib.Fit(c));
+	TEST_CHECK(calib.Residual() < 0.02);
+
+	// Corrected field strength is constant in all directions
+	double mn = 1e9, mx = 0;
+
+	for (int n = 0; n < 500; n++)
+	{
+		double u[3], m[3], o[3];
+
+		RandDir(u);
+		for (int i = 0; i < 3; i++)
+		{
+			m[i] = h[i] + f * (s[i][0] * u[0] + s[i][1] * u[1] + s[i][2] * u[2]);
+		}
+		Correct(c, m, o);
+
+		double l = sqrt(o[0] * o[0] + o[1] * o[1] + o[2] * o[2]);
+
+		mn = fmin(mn, l);
+		mx = fmax(mx, l);
+	}
+	TEST_CHECK((mx - mn) / mx < 0.02);
+}
+
+// Gyro with bias drifting with temperature, 1 dps per LSB
+class TestGyro : public GyroSensor {
+public:
+	TestGyro() : vTime(0), vRate(0), vDieTemp(25) {
+		vData.Scale = 0x7FFF;
+		vData.Range = 0x7FFF;
+		vSampPeriod = 1000000;
+	}
+	bool Init(const GYROSENSOR_CFG &Cfg, DeviceIntrf * const pIntrf, Timer * const pTimer) {
+		(void)Cfg; (void)pIntrf; (void)pTimer;
+		return true;
+	}
+	bool Enable() { return true; }
+	void Disable() {}
+	void Reset() {}
+	bool StartSampling() { return true; }
+
+	bool UpdateData() {
+		vTime += 1000;
+		for (int i = 0; i < 3; i++)
+		{
+			vData.Val[i] = lround(Bias(i, vDieTemp) + vRate + Noise() * 0.5);
+		}
+		vData.Timestamp = vTime;
+		Temperature(vDieTemp);
+
+		return true;
+	}
+
+	// Uncalibrated bias of axis in dps
+	static double Bias(int Axis, double Temp) {
+		const double b[3] = { 5, -12, 3 };
+		const double k[3] = { 0.2, -0.1, 0.05 };
+
+		return b[Axis] + k[Axis] * (Temp - 25);
+	}
+
+	uint64_t vTime;
+	double vRate;
+	float vDieTemp;
+};
+
+class TestImu : public Imu {
+public:
+	bool Enable() { return true; }
+	void Disable() {}
+	void Reset() {}
+	bool UpdateData() { return true; }
+	void IntHandler() {}
+	void SetAxisAlignmentMatrix(int8_t * const pMatrix) { (void)pMatrix; }
+	bool Compass(bool bEn) { (void)bEn; return true; }
+	bool Pedometer(bool bEn) { (void)bEn; return true; }
+	bool Quaternion(bool bEn, int NbAxis) { (void)bEn; (void)NbAxis; return true; }
+	bool Tap(bool bEn) { (void)bEn; return true; }
+};
+
+// Max abs calibrated rate of the still gyro at a temperature
+static float StillRate(TestGyro &Gyro, float Temp)
+{
+	GYROSENSOR_DATA d;
+	float mx = 0;
+
+	Gyro.vDieTemp = Temp;
+	Gyro.vRate = 0;
+	for (int n = 0; n < 64; n++)
+	{
+		Gyro.UpdateData();
+		Gyro.Read(d);
+		for (int i = 0; i < 3; i++)
+		{
+			mx += fabsf(d.Val[i]) / (64 * 3);
+		}
+	}
+
+	return mx;
+}
+
+static void TestGyroTemp()
+{
+	TestGyro gyro;
+	GyroCalib calib;
+	GYROSENSOR_DATA d;
+
+	// Temperature ramp from 20 to 40 C
+	for (int n = 0; n < 2000; n++)
+	{
+		gyro.vDieTemp = 20 + n * 0.01;
+		gyro.UpdateData();
+		gyro.Read(d);
+		TEST_CHECK(calib.AddSample(d, gyro.Temperature()));
+	}
+	TEST_CHECK(calib.Fit());
+	TEST_CHECK(fabsf(calib.TempCoef()[0] - 0.2f) < 0.01);
+	TEST_CHECK(fabsf(calib.TempCoef()[1] + 0.1f) < 0.01);
+
+	calib.Apply(gyro);
+
+	// Bias is compensated at temperatures away from the collection
+	TEST_CHECK(StillRate(gyro, 25) < 0.6);
+	TEST_CHECK(StillRate(gyro, 60) < 0.6);
+	TEST_CHECK(StillRate(gyro, -10) < 0.6);
+
+	// Imu::Calibrate at a new temperature updates the bias, keeps coefficient
+	TestImu imu;
+	IMU_CFG cfg = { NULL };
+	const float k[3] = { 0.2, -0.1, 0.05 };
+	SENSOR_CALIB c;
+
+	imu.Init(cfg, NULL, &gyro, NULL);
+	SensorCalibIdentity(&c);
+	gyro.SetCalibration(c, k, 0);	// Wrong bias, right coefficient
+	gyro.vDieTemp = 45;
+	TEST_CHECK(imu.Calibrate());
+	TEST_CHECK(gyro.TempCoef()[0] == k[0] && gyro.TempCoef()[2] == k[2]);
+	TEST_CHECK(fabsf(gyro.TempRef() - 45) < 0.01);
+	TEST_CHECK(StillRate(gyro, 45) < 0.6);
+	TEST_CHECK(StillRate(gyro, 10) < 0.6);
+
+	// Moving device fails and leaves the calibration unchanged
+	c = gyro.Calibration();
+	gyro.vRate = 100;
+	TEST_CHECK(imu.Calibrate() == false);
+	TEST_CHECK(gyro.Calibration().Offset[1] == c.Offset[1]);
+	TEST_CHECK(gyro.TempCoef()[1] == k[1]);
+	TEST_CHECK(StillRate(gyro, 30) < 0.6);
+}
+
+int main()
+{
+	srand(27);
+
+	TestAccel();
+	TestMag();
+	TestGyroTemp();
+
+	printf("sensor_calib : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
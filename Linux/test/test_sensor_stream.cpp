@@ -0,0 +1,285 @@
+/**-------------------------------------------------------------------------
+@file	test_sensor_stream.cpp
+
+@brief	Sensor stream record and replay test
+
+Records accel, gyro, mag, quaternion and temperature frames, replays them and
+checks the replayed data is bit exact, the TPH data ready callback is only
+called for TPH frames, and paced playback stays on time across the 32 bits
+usec timer wrap.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "sensors/sensor_stream.h"
+#include "test_util.h"
+#include "test_timer.h"
+
+#define NB_FRAME		200
+
+typedef struct {
+	std::vector<uint8_t> Data;
+	size_t RdIdx;
+} STREAM;
+
+static int StreamWrite(void * const pCtx, uint8_t * const pData, int Len)
+{
+	STREAM *s = (STREAM*)pCtx;
+
+	s->Data.insert(s->Data.end(), pData, pData + Len);
+
+	return Len;
+}
+
+static int StreamRead(void * const pCtx, uint8_t * const pBuff, int Len)
+{
+	STREAM *s = (STREAM*)pCtx;
+	int n = (int)std::min((size_t)Len, s->Data.size() - s->RdIdx);
+
+	memcpy(pBuff, &s->Data[s->RdIdx], n);
+	s->RdIdx += n;
+
+	return n;
+}
+
+// Temperature source, values set by the test
+class TestTemp : public TempSensor {
+public:
+	bool Init(const TEMPSENSOR_CFG &Cfg, DeviceIntrf * const pIntrf, Timer * const pTimer) {
+		(void)Cfg; (void)pIntrf; (void)pTimer;
+		return true;
+	}
+	bool Enable() { return true; }
+	void Disable() {}
+	void Reset() {}
+	bool StartSampling() { return true; }
+	bool UpdateData() { return true; }
+
+	void Set(uint64_t Timestamp, int32_t Temp) { vData.Timestamp = Timestamp; vData.Temperature = Temp; }
+};
+
+typedef struct {
+	uint64_t Time;
+	int16_t Accel[3];
+	int16_t Gyro[3];
+	int16_t Mag[3];
+	float Quat[4];
+	bool bTemp;
+	int32_t Temp;
+} FRAME;
+
+static int s_TphRdyCnt = 0;
+
+static void TphDataRdy(TphSensor * const pSensor, TPHSENSOR_DATA *pData)
+{
+	(void)pSensor; (void)pData;
+	s_TphRdyCnt++;
+}
+
+static void MakeFrames(std::vector<FRAME> &Frames)
+{
+	uint64_t t = 1000;
+
+	srand(26);
+	for (int i = 0; i < NB_FRAME; i++)
+	{
+		FRAME f;
+
+		// Irregular periods, one gap too long for a 32 bits delta
+		t += i == NB_FRAME / 2 ? 3000000000ULL : 2500 + (i % 3);
+		f.Time = t;
+		for (int k = 0; k < 3; k++)
+		{
+			f.Accel[k] = (int16_t)rand();
+			f.Gyro[k] = (int16_t)rand();
+			f.Mag[k] = (int16_t)rand();
+		}
+		for (int k = 0; k < 4; k++)
+		{
+			f.Quat[k] = (float)rand() / RAND_MAX;
+		}
+		// Temperatures beyond the 16 bits of the TPH view
+		f.bTemp = (i % 4) != 3;
+		f.Temp = (i & 1) ? 4000000 + i * 12345 : -70000 - i;
+		Frames.push_back(f);
+	}
+}
+
+static void Record(std::vector<FRAME> &Frames, STREAM &Strm)
+{
+	SensorRecorder rec;
+	uint8_t buff[100];
+	SENSREC_CFG cfg = { StreamWrite, &Strm, buff, sizeof(buff) };
+	TestTemp temp;
+
+	TEST_CHECK(rec.Init(cfg));
+
+	for (auto &f : Frames)
+	{
+		TEST_CHECK(rec.Record(SENSSTRM_REC_ACCEL, f.Time, f.Accel, sizeof(f.Accel)));
+		TEST_CHECK(rec.Record(SENSSTRM_REC_GYRO, f.Time, f.Gyro, sizeof(f.Gyro)));
+		TEST_CHECK(rec.Record(SENSSTRM_REC_MAG, f.Time, f.Mag, sizeof(f.Mag)));
+		TEST_CHECK(rec.Record(SENSSTRM_REC_QUAT, f.Time, f.Quat, sizeof(f.Quat)));
+		if (f.bTemp)
+		{
+			temp.Set(f.Time, f.Temp);
+			TEST_CHECK(rec.Record(temp));
+		}
+	}
+	rec.Flush();
+}
+
+static void TestRoundTrip()
+{
+	std::vector<FRAME> frames;
+	STREAM strm = { {}, 0 };
+
+	MakeFrames(frames);
+	Record(frames, strm);
+
+	ReplaySensor rs;
+	SENSREPLAY_CFG cfg = { StreamRead, &strm, 0 };
+	TPHSENSOR_CFG tphcfg;
+
+	memset(&tphcfg, 0, sizeof(tphcfg));
+	tphcfg.DataRdyCB = TphDataRdy;
+
+	TEST_CHECK(rs.Init(cfg));
+	TEST_CHECK(rs.Init(tphcfg));
+
+	int tphfrm = 0;
+
+	for (auto &f : frames)
+	{
+		ACCELSENSOR_RAWDATA accel;
+		GYROSENSOR_RAWDATA gyro;
+		MAGSENSOR_RAWDATA mag;
+		IMU_QUAT quat;
+		TEMPSENSOR_DATA temp;
+		int rdy = s_TphRdyCnt;
+
+		TEST_CHECK(rs.UpdateData());
+
+		rs.Read(accel);
+		rs.Read(gyro);
+		rs.Read(mag);
+		rs.Read(quat);
+		rs.Read(temp);
+
+		TEST_CHECK(accel.Timestamp == f.Time);
+		TEST_CHECK(memcmp(accel.Val, f.Accel, sizeof(f.Accel)) == 0);
+		TEST_CHECK(gyro.Timestamp == f.Time);
+		TEST_CHECK(memcmp(gyro.Val, f.Gyro, sizeof(f.Gyro)) == 0);
+		TEST_CHECK(mag.Timestamp == f.Time);
+		TEST_CHECK(memcmp(mag.Val, f.Mag, sizeof(f.Mag)) == 0);
+		TEST_CHECK(quat.Timestamp == f.Time);
+		TEST_CHECK(memcmp(quat.Q, f.Quat, sizeof(f.Quat)) == 0);
+
+		if (f.bTemp)
+		{
+			tphfrm++;
+			TEST_CHECK(temp.Timestamp == f.Time);
+			TEST_CHECK(temp.Temperature == f.Temp);
+			TEST_CHECK(rs.ReadTemperature() == (float)((float)f.Temp / 100.0));
+			TEST_CHECK(s_TphRdyCnt == rdy + 1);
+		}
+		else
+		{
+			TEST_CHECK(s_TphRdyCnt == rdy);
+		}
+	}
+
+	TEST_CHECK(rs.UpdateData() == false);
+	TEST_CHECK(rs.EndOfStream());
+	TEST_CHECK(s_TphRdyCnt == tphfrm);
+}
+
+// 3 hours of accel samples, one per minute, replayed while the timer usec
+// count wraps 30 minutes into playback
+static void TestPacedWrap(uint32_t Speed)
+{
+	const uint64_t period = 60000000ULL;
+	const int nbsmpl = 180;
+	const uint64_t t0 = 5000000000ULL;
+	STREAM strm = { {}, 0 };
+	SensorRecorder rec;
+	SENSREC_CFG reccfg = { StreamWrite, &strm, NULL, 0 };
+
+	TEST_CHECK(rec.Init(reccfg));
+	for (int i = 0; i < nbsmpl; i++)
+	{
+		int16_t val[3] = { (int16_t)i, 0, 0 };
+
+		rec.Record(SENSSTRM_REC_ACCEL, t0 + i * period, val, sizeof(val));
+	}
+
+	TestTimer timer(0x100000000ULL - 30ULL * 60000000ULL);
+	ReplaySensor rs;
+	SENSREPLAY_CFG cfg = { StreamRead, &strm, Speed };
+
+	TEST_CHECK(rs.Init(cfg, &timer));
+
+	uint64_t elapsed = 0;
+	int late = 0;
+
+	while (rs.EndOfStream() == false && elapsed < 4ULL * 3600000000ULL)
+	{
+		ACCELSENSOR_RAWDATA accel;
+
+		rs.UpdateData();
+		rs.Read(accel);
+
+		uint64_t idx = std::min(elapsed * Speed / period, (uint64_t)nbsmpl - 1);
+
+		if (accel.Timestamp != t0 + idx * period || accel.Val[0] != (int16_t)idx)
+		{
+			late++;
+		}
+
+		timer.Advance(10000000);
+		elapsed += 10000000;
+	}
+
+	TEST_CHECK(late == 0);
+	TEST_CHECK(rs.EndOfStream());
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestPacedWrap(1);
+	TestPacedWrap(4);
+
+	printf("sensor_stream : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,147 @@
+/**-------------------------------------------------------------------------
+@file	test_sensor_timestamp.cpp
+
+@brief	Sample time stamp estimator test
+
+Simulates a FIFO sensor whose clock is off nominal, polled at irregular
+intervals, with the host timer crossing the 32 bits usec wrap.  Checks the
+estimated period and time stamps against the true sampling times.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "sensors/sensor_timestamp.h"
+#include "test_timer.h"
+#include "test_util.h"
+
+// Start 30 sec before the 32 bits usec timer wrap
+#define TIMER_START		(0x100000000ULL - 30000000ULL)
+#define SIM_TIME		60000000.0
+
+static double Uniform(double Min, double Max)
+{
+	return Min + (Max - Min) * rand() / RAND_MAX;
+}
+
+/**
+ * @param	DriftPpm	: Sensor clock deviation in ppm
+ * @param	Nominal		: Nominal sample period in usec
+ * @param	PollUs		: Mean FIFO poll interval in usec
+ * @param	PollJit		: Poll interval jitter in usec
+ */
+static void Sim(double DriftPpm, double Nominal, double PollUs, double PollJit)
+{
+	TestTimer timer(TIMER_START);
+	SensorTimeEst est;
+	std::vector<double> truth;
+	double period = Nominal * (1 + DriftPpm * 1e-6);
+	double tsmpl = 0, tread = 0;
+	double se = 0, maxerr = 0, sen = 0;
+	uint64_t last = 0;
+	int n = 0;
+	bool mono = true;
+
+	TEST_CHECK(est.Init((uint64_t)(Nominal * 1000), 50000, 16));
+
+	while (tread < SIM_TIME)
+	{
+		tread += PollUs + Uniform(-PollJit, PollJit);
+
+		// Samples produced before the FIFO count is read
+		while (tsmpl + period < tread)
+		{
+			tsmpl += period;
+			truth.push_back(tsmpl);
+		}
+
+		// Timer read after the FIFO count
+		uint64_t rd = (uint64_t)(tread + Uniform(5, 100));
+
+		timer.Advance(rd + TIMER_START - timer.TickCount());
+
+		uint32_t idx = est.SampleCount();
+		int nb = truth.size() - idx;
+
+		est.Update(&timer, nb);
+
+		for (int i = 0; i < nb; i++)
+		{
+			uint64_t ts = est.SampleTime(idx + i);
+
+			if (ts <= last)
+			{
+				mono = false;
+			}
+			last = ts;
+
+			if (tread > 2000000)
+			{
+				// After convergence
+				double e = (double)(int64_t)(ts - TIMER_START) - truth[idx + i];
+
+				// Naive : read time minus nominal periods
+				double en = rd - (nb - 1 - i) * Nominal - truth[idx + i];
+
+				se += e * e;
+				sen += en * en;
+				maxerr = fmax(maxerr, fabs(e));
+				n++;
+			}
+		}
+	}
+
+	double rms = sqrt(se / n);
+	double rmsnaive = sqrt(sen / n);
+
+	printf("drift %+6.0f ppm, poll %6.0f us : period %.3f us (true %.3f), rms err %6.1f us, max %6.1f us, naive rms %6.1f us\n",
+		   DriftPpm, PollUs, est.Period(), period, rms, maxerr, rmsnaive);
+
+	TEST_CHECK(mono);
+	TEST_CHECK(fabs(est.Period() - period) < period * 0.005);
+	TEST_CHECK(rms < Nominal * 0.25);
+	TEST_CHECK(rms < rmsnaive * 0.5);
+	TEST_CHECK(maxerr < Nominal);
+}
+
+int main()
+{
+	srand(30);
+
+	Sim(20000, 1000, 20000, 5000);
+	Sim(-30000, 1000, 20000, 5000);
+	Sim(10000, 1000, 100000, 30000);
+	Sim(25000, 5000, 50000, 10000);
+
+	printf("sensor_timestamp : %s\n", TEST_RESULT() ? "FAILED" : "passed");
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,180 @@
+/**-------------------------------------------------------------------------
+@file	test_sfdp.h
+
+@brief	SFDP images of SPI NOR parts for the flash tests
+
+Basic Flash Parameter Tables (JESD216) of a few common SPI NOR parts, from
+their datasheet parameters with times rounded to the table encoding, and a
+builder of the SFDP image read by the NorFlashSim READ_SFDP command.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __TEST_SFDP_H__
+#define __TEST_SFDP_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#define TEST_SFDP_TBL_OFF		0x30	//!< First parameter table
+#define TEST_SFDP_TBL_SIZE		0x40	//!< Room per parameter table
+#define TEST_SFDP_IMG_MAX		(TEST_SFDP_TBL_OFF + 2 * TEST_SFDP_TBL_SIZE)
+
+typedef struct {
+	const char *pName;
+	uint8_t Minor;			//!< JESD216 minor revision, 0 - JESD216, 6 - JESD216B
+	int NbDw;				//!< Number of BFPT DWORDs
+	uint32_t TotalSize;		//!< Density in bytes
+	uint32_t PageSize;		//!< Program page size in bytes
+	uint32_t BlkSize;		//!< 0xD8 erase size in bytes
+	uint32_t Bfpt[16];		//!< Basic Flash Parameter Table
+} TEST_SFDP_PART;
+
+enum {
+	TEST_SFDP_W25Q128FV,
+	TEST_SFDP_W25Q128JV,
+	TEST_SFDP_MX25R6435F,
+	TEST_SFDP_MX66L51235F,
+	TEST_SFDP_S25FL512S,
+	TEST_SFDP_NBPART
+};
+
+static const TEST_SFDP_PART s_TestSfdpParts[TEST_SFDP_NBPART] = {
+	{
+		// JESD216, 9 DWORDs, no page size nor timings
+		"W25Q128FV", 0, 9, 16 * 1024 * 1024, 256, 0x10000, {
+			0xFFF120E1,		// 4KB erase 0x20, 1-1-2, 1-2-2, 1-4-4, 1-1-4, 3 bytes address
+			0x07FFFFFF,		// 128Mbits
+			0x6B08EB44,		// 1-4-4 0xEB 4 + 2 mode clocks, 1-1-4 0x6B 8 clocks
+			0xBB803B08,		// 1-1-2 0x3B 8 clocks, 1-2-2 0xBB 0 + 4 mode clocks
+			0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF,
+			0x520F200C,		// Erase 4KB 0x20, 32KB 0x52
+			0x0000D810,		// Erase 64KB 0xD8
+		}
+	},
+	{
+		// JESD216B, erase suspend 0x75, resume 0x7A
+		"W25Q128JV", 6, 16, 16 * 1024 * 1024, 256, 0x10000, {
+			0xFFF120E1, 0x07FFFFFF, 0x6B08EB44, 0xBB803B08,
+			0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, 0x520F200C, 0x0000D810,
+			0x00A53A22,		// Erase times 48ms, 128ms, 160ms
+			0x49002A81,		// 256 bytes page, program 704us, chip erase 40s
+			0x33100000,		// Suspend latency 20us
+			0x757A757A,		// Suspend 0x75, resume 0x7A
+			0xFFFFFFFF, 0xFFFFFFFF,
+			0x00FFFFFF,		// No 4 bytes address mode
+		}
+	},
+	{
+		"MX25R6435F", 6, 16, 8 * 1024 * 1024, 256, 0x10000, {
+			0xFFF120E1,
+			0x03FFFFFF,		// 64Mbits
+			0x6B08EB44,
+			0xBB043B08,		// 1-2-2 0xBB 4 + 0 mode clocks
+			0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, 0x520F200C, 0x0000D810,
+			0x00E16222,		// Erase times 48ms, 208ms, 400ms
+			0x4C002D81,		// 256 bytes page, program 896us, chip erase 52s
+			0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF,
+			0x00FFFFFF,
+		}
+	},
+	{
+		"MX66L51235F", 6, 16, 64 * 1024 * 1024, 256, 0x10000, {
+			0xFFF320E1,		// 3 or 4 bytes address
+			0x1FFFFFFF,		// 512Mbits
+			0x6B08EB44, 0xBB043B08,
+			0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, 0x520F200C, 0x0000D810,
+			0x00C549D2,		// Erase times 30ms, 160ms, 288ms
+			0x62002581,		// 256 bytes page, program 384us, chip erase 192s
+			0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF,
+			0x01FFFFFF,		// 4 bytes address with 0xB7
+		}
+	},
+	{
+		// Uniform 256KB sectors
+		"S25FL512S", 6, 16, 64 * 1024 * 1024, 512, 0x40000, {
+			0xFFF3FFE3,		// No 4KB erase, 3 or 4 bytes address
+			0x1FFFFFFF,
+			0x6B08EB42,		// 1-4-4 0xEB 2 + 2 mode clocks
+			0xBB803B08,
+			0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF,
+			0x0000D812,		// Erase 256KB 0xD8
+			0x00000000,
+			0x00000442,		// Erase time 640ms
+			0x59002591,		// 512 bytes page, program 384us, chip erase 104s
+			0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF,
+			0x04FFFFFF,		// 4 bytes address with bank register
+		}
+	},
+};
+
+/**
+ * @brief	Build SFDP image with one Basic Flash Parameter Table per part
+ *
+ * @param	pImg	: Image buffer of TEST_SFDP_IMG_MAX bytes
+ * @param	ppPart	: Parts, 1 or 2
+ * @param	NbPart	: Number of parts
+ *
+ * @return	Image size
+ */
+static inline uint32_t TestSfdpImage(uint8_t *pImg, const TEST_SFDP_PART * const *ppPart, int NbPart)
+{
+	memset(pImg, 0xff, TEST_SFDP_IMG_MAX);
+	memcpy(pImg, "SFDP", 4);
+	pImg[4] = ppPart[0]->Minor;
+	pImg[5] = 1;
+	pImg[6] = NbPart - 1;
+
+	for (int i = 0; i < NbPart; i++)
+	{
+		uint8_t *ph = &pImg[8 + i * 8];
+		uint32_t ptp = TEST_SFDP_TBL_OFF + i * TEST_SFDP_TBL_SIZE;
+
+		ph[0] = 0;
+		ph[1] = ppPart[i]->Minor;
+		ph[2] = 1;
+		ph[3] = ppPart[i]->NbDw;
+		ph[4] = ptp & 0xFF;
+		ph[5] = (ptp >> 8) & 0xFF;
+		ph[6] = (ptp >> 16) & 0xFF;
+		ph[7] = 0xFF;
+
+		for (int j = 0; j < ppPart[i]->NbDw; j++)
+		{
+			uint32_t v = ppPart[i]->Bfpt[j];
+
+			pImg[ptp + j * 4] = v & 0xFF;
+			pImg[ptp + j * 4 + 1] = (v >> 8) & 0xFF;
+			pImg[ptp + j * 4 + 2] = (v >> 16) & 0xFF;
+			pImg[ptp + j * 4 + 3] = v >> 24;
+		}
+	}
+
+	return TEST_SFDP_TBL_OFF + NbPart * TEST_SFDP_TBL_SIZE;
+}
+
+#endif	// __TEST_SFDP_H__
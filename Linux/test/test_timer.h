@@ -0,0 +1,135 @@
+/**-------------------------------------------------------------------------
+@file	test_timer.h
+
+@brief	Manually advanced timer for host tests
+
+Timer with a tick count set by the test, 1 tick per usec.  The count can start
+anywhere, ex. close to the 32 bits usec wrap.  Trigger handlers are called from
+Advance when their time is reached.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __TEST_TIMER_H__
+#define __TEST_TIMER_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include "coredev/timer.h"
+
+#define TESTTIMER_TRIG_MAX		4
+
+class TestTimer : public Timer {
+public:
+	TestTimer(uint64_t Tick = 0) {
+		vTick = Tick;
+		vnsPeriod = 1000;
+		vFreq = 1000000;
+		memset(vTrig, 0, sizeof(vTrig));
+	}
+
+	bool Init(const TIMER_CFG &Cfg) { (void)Cfg; return true; }
+	bool Enable() { return true; }
+	void Disable() {}
+	void Reset() { vTick = 0; }
+	uint64_t TickCount() { return vTick; }
+	uint32_t Frequency(uint32_t Freq) { (void)Freq; return vFreq; }
+	int MaxTimerTrigger() { return TESTTIMER_TRIG_MAX; }
+
+	uint64_t EnableTimerTrigger(int TrigNo, uint64_t nsPeriod, TIMER_TRIG_TYPE Type,
+								TIMER_TRIGCB const Handler = NULL, void * const pContext = NULL) {
+		if (TrigNo < 0 || TrigNo >= TESTTIMER_TRIG_MAX || nsPeriod < 1000)
+			return 0;
+		vTrig[TrigNo].bEn = true;
+		vTrig[TrigNo].Type = Type;
+		vTrig[TrigNo].Period = nsPeriod / 1000;
+		vTrig[TrigNo].Expire = vTick + vTrig[TrigNo].Period;
+		vTrig[TrigNo].Handler = Handler;
+		vTrig[TrigNo].pCtx = pContext;
+		return vTrig[TrigNo].Period * 1000;
+	}
+
+	void DisableTimerTrigger(int TrigNo) {
+		if (TrigNo >= 0 && TrigNo < TESTTIMER_TRIG_MAX)
+			vTrig[TrigNo].bEn = false;
+	}
+
+	int FindAvailTimerTrigger(void) {
+		for (int i = 0; i < TESTTIMER_TRIG_MAX; i++)
+			if (vTrig[i].bEn == false)
+				return i;
+		return -1;
+	}
+
+	bool TriggerPending(int TrigNo) { return vTrig[TrigNo].bEn; }
+
+	/**
+	 * @brief	Advance time in usec, calling triggers expiring on the way in order
+	 */
+	void Advance(uint64_t usTime) {
+		uint64_t end = vTick + usTime;
+
+		while (1)
+		{
+			int t = -1;
+
+			for (int i = 0; i < TESTTIMER_TRIG_MAX; i++)
+			{
+				if (vTrig[i].bEn && vTrig[i].Expire <= end && (t < 0 || vTrig[i].Expire < vTrig[t].Expire))
+					t = i;
+			}
+			if (t < 0)
+				break;
+
+			vTick = vTrig[t].Expire;
+			if (vTrig[t].Type == TIMER_TRIG_TYPE_CONTINUOUS)
+				vTrig[t].Expire += vTrig[t].Period;
+			else
+				vTrig[t].bEn = false;
+			if (vTrig[t].Handler)
+				vTrig[t].Handler(this, t, vTrig[t].pCtx);
+		}
+
+		vTick = end;
+	}
+
+private:
+	typedef struct {
+		bool bEn;
+		TIMER_TRIG_TYPE Type;
+		uint64_t Period;		//!< usec
+		uint64_t Expire;		//!< Tick count of next expiration
+		TIMER_TRIGCB Handler;
+		void *pCtx;
+	} TRIG;
+
+	uint64_t vTick;
+	TRIG vTrig[TESTTIMER_TRIG_MAX];
+};
+
+#endif	// __TEST_TIMER_H__
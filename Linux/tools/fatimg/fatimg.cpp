@@ -0,0 +1,298 @@
+/**-------------------------------------------------------------------------
+@file	fatimg.cpp
+
+@brief	Host FAT image builder and checker
+
+Builds FAT16/FAT32 disk images from a directory tree and checks images
+produced by the target, using the FatFS on disk structures.
+
+The image builder is in fatimg_build.cpp, the checker in fatimg_check.cpp.
+
+Exit code, as fsck : 0 - no error, 1 - errors repaired, 4 - errors left,
+8 - operational error.
+
+Build :
+
+	g++ -std=c++17 -O2 -I../../../include -I../../../include/sys fatimg.cpp fatimg_build.cpp \
+		fatimg_check.cpp -o fatimg
+
+Usage :
+
+	fatimg build [-t 16|32] [-c clussize] [-s imgsize] [-f freesize] [-a align]
+				 [-A filealign] [-e rootent] [-p] [-l label] [-d time] [-i volid]
+				 <source dir> <image>
+
+	fatimg check [-r] [-v] <image>
+
+Sizes take a k, M or G suffix.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "fatimg.h"
+
+const uint8_t g_FatImgLfnOff[FATIMG_LFN_CHARS] = {
+	1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30
+};
+
+bool ReadAt(int Fd, uint64_t Off, void *pBuff, size_t Len)
+{
+	return pread(Fd, pBuff, Len, Off) == (ssize_t)Len;
+}
+
+bool WriteAt(int Fd, uint64_t Off, const void *pBuff, size_t Len)
+{
+	return pwrite(Fd, pBuff, Len, Off) == (ssize_t)Len;
+}
+
+bool ParseSize(const char *pStr, uint64_t &Size)
+{
+	char *end;
+
+	Size = strtoull(pStr, &end, 0);
+	switch (toupper(*end))
+	{
+		case 'G':
+			Size <<= 10;
+			// fall through
+		case 'M':
+			Size <<= 10;
+			// fall through
+		case 'K':
+			Size <<= 10;
+			end++;
+			break;
+	}
+
+	return end != pStr && *end == 0;
+}
+
+bool IsPow2(uint64_t Val)
+{
+	return Val != 0 && (Val & (Val - 1)) == 0;
+}
+
+uint8_t ShortNameChksum(const uint8_t *pName)
+{
+	uint8_t sum = 0;
+
+	for (int i = 0; i < 11; i++)
+	{
+		sum = ((sum & 1) << 7) + (sum >> 1) + pName[i];
+	}
+
+	return sum;
+}
+
+void FormatShortName(const FATFS_SHORTNAME &Ent, std::string &Name)
+{
+	Name.clear();
+	for (int i = 0; i < 8 && Ent.Name[i] != ' '; i++)
+	{
+		Name += (Ent.NTRes & FATIMG_NTRES_LOWBASE) ? tolower(Ent.Name[i]) : Ent.Name[i];
+	}
+	if (Ent.Name[8] != ' ')
+	{
+		Name += '.';
+		for (int i = 8; i < 11 && Ent.Name[i] != ' '; i++)
+		{
+			Name += (Ent.NTRes & FATIMG_NTRES_LOWEXT) ? tolower(Ent.Name[i]) : Ent.Name[i];
+		}
+	}
+	if (Name.size() > 0 && (uint8_t)Name[0] == 0x05)
+		Name[0] = (char)0xE5;
+}
+
+bool IsShortChar(char c)
+{
+	return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || strchr("$%'-_@~`!(){}^#&", c) != NULL;
+}
+
+static void Usage()
+{
+	fprintf(stderr,
+		"usage : fatimg build [options] <source dir> <image>\n"
+		"    -t 16|32      FAT type, default by cluster count\n"
+		"    -c size       cluster size, default 4k\n"
+		"    -s size       image size, default fit to content\n"
+		"    -f size       free space when fit to content\n"
+		"    -a size       data area and partition alignment, default cluster size, 1M with -p\n"
+		"    -A size       align start of files from this size up\n"
+		"    -e count      FAT16 root directory entries, default 512\n"
+		"    -p            write MBR with one partition\n"
+		"    -l label      volume label\n"
+		"    -d time       time stamp of all entries, seconds since 1970\n"
+		"    -i volid      volume serial number\n"
+		"        fatimg check [-r] [-v] <image>\n"
+		"    -r            repair\n"
+		"    -v            list files\n");
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		Usage();
+		return EXIT_FAILED;
+	}
+
+	int c;
+
+	optind = 2;
+
+	if (strcmp(argv[1], "check") == 0)
+	{
+		bool repair = false, verbose = false;
+
+		while ((c = getopt(argc, argv, "rv")) != -1)
+		{
+			if (c == 'r')
+				repair = true;
+			else if (c == 'v')
+				verbose = true;
+			else
+			{
+				Usage();
+				return EXIT_FAILED;
+			}
+		}
+		if (optind + 1 != argc)
+		{
+			Usage();
+			return EXIT_FAILED;
+		}
+
+		return FatImgCheck(argv[optind], repair, verbose);
+	}
+
+	if (strcmp(argv[1], "build") != 0)
+	{
+		Usage();
+		return EXIT_FAILED;
+	}
+
+	FATIMG_OPT opt;
+	uint64_t v;
+	bool align = false;
+
+	memset(&opt, 0, sizeof(opt));
+	opt.ClusSize = 4096;
+	opt.RootEnt = FATFS_ROOTENTCNT_FAT16;
+
+	while ((c = getopt(argc, argv, "t:c:s:f:a:A:e:pl:d:i:")) != -1)
+	{
+		bool ok = true;
+
+		switch (c)
+		{
+			case 't':
+				opt.FatType = atoi(optarg);
+				ok = opt.FatType == 16 || opt.FatType == 32;
+				break;
+			case 'c':
+				ok = ParseSize(optarg, v) && IsPow2(v) && v >= FATIMG_SECT_SIZE && v <= 32768;
+				opt.ClusSize = v;
+				break;
+			case 's':
+				ok = ParseSize(optarg, v) && v > 0 && v / FATIMG_SECT_SIZE <= 0xFFFFFFFF;
+				opt.ImgSize = v;
+				break;
+			case 'f':
+				ok = ParseSize(optarg, opt.FreeSize);
+				break;
+			case 'a':
+				ok = ParseSize(optarg, v) && IsPow2(v) && v <= 0x80000000;
+				opt.Align = v;
+				align = true;
+				break;
+			case 'A':
+				ok = ParseSize(optarg, v) && IsPow2(v) && v <= 0x80000000;
+				opt.FileAlign = v;
+				break;
+			case 'e':
+				opt.RootEnt = atoi(optarg);
+				ok = opt.RootEnt > 0 && opt.RootEnt <= 0xFFF0;
+				break;
+			case 'p':
+				opt.bMbr = true;
+				break;
+			case 'l':
+				ok = strlen(optarg) <= 11;
+				memset(opt.Label, ' ', 11);
+				for (int i = 0; optarg[i] && i < 11; i++)
+				{
+					opt.Label[i] = toupper((uint8_t)optarg[i]);
+					ok = ok && (IsShortChar(opt.Label[i]) || opt.Label[i] == ' ');
+				}
+				break;
+			case 'd':
+				opt.bTime = true;
+				opt.Time = strtoll(optarg, NULL, 0);
+				break;
+			case 'i':
+				opt.bVolId = true;
+				opt.VolId = strtoul(optarg, NULL, 16);
+				break;
+			default:
+				ok = false;
+		}
+		if (ok == false)
+		{
+			if (c != '?')
+				fprintf(stderr, "invalid option -%c %s\n", c, optarg ? optarg : "");
+			Usage();
+			return EXIT_FAILED;
+		}
+	}
+	if (optind + 2 != argc)
+	{
+		Usage();
+		return EXIT_FAILED;
+	}
+
+	if (align == false)
+		opt.Align = opt.bMbr ? FATIMG_PART_ALIGN : opt.ClusSize;
+
+	// File boundaries are cluster boundaries from the data area start
+	if (opt.FileAlign > 0)
+	{
+		opt.FileAlign = std::max(opt.FileAlign, opt.ClusSize);
+		opt.Align = std::max(opt.Align, opt.FileAlign);
+	}
+	opt.Align = std::max<uint32_t>(opt.Align, FATIMG_SECT_SIZE);
+	opt.RootEnt = (opt.RootEnt + 15) & ~15U;
+
+	return FatImgBuild(argv[optind], argv[optind + 1], opt);
+}
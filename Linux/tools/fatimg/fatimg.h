@@ -0,0 +1,115 @@
+/**-------------------------------------------------------------------------
+@file	fatimg.h
+
+@brief	Definitions shared by the fatimg image builder and checker
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __FATIMG_H__
+#define __FATIMG_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <string>
+
+#include "fatfs.h"
+
+#define FATIMG_SECT_SIZE		512
+#define FATIMG_LFN_CHARS		13			// Characters per long name entry
+#define FATIMG_NTRES_LOWBASE	0x08		// NTRes : short name base in lower case
+#define FATIMG_NTRES_LOWEXT		0x10		// NTRes : short name extension in lower case
+#define FATIMG_FAT16_MIN		4085		// Min clusters of FAT16
+#define FATIMG_FAT32_MIN		65525		// Min clusters of FAT32
+#define FATIMG_FAT32_MAX		0x0FFFFFF5
+#define FATIMG_EOC				0x0FFFFFFF
+#define FATIMG_BAD				0x0FFFFFF7
+#define FATIMG_RSVD				0x0FFFFFF0	// Reserved values up to FATIMG_BAD
+#define FATIMG_PART_ALIGN		(1024 * 1024)	// Default partition alignment with MBR
+
+#define EXIT_OK					0
+#define EXIT_FIXED				1
+#define EXIT_ERRORS				4
+#define EXIT_FAILED				8
+
+static_assert(sizeof(FATFS_BSBPB) == FATIMG_SECT_SIZE, "FATFS_BSBPB size");
+static_assert(sizeof(FATFS_FSINFO) == FATIMG_SECT_SIZE, "FATFS_FSINFO size");
+static_assert(sizeof(FATFS_DIR) == 32, "FATFS_DIR size");
+static_assert(sizeof(MBR) == FATIMG_SECT_SIZE, "MBR size");
+
+/// Build options
+typedef struct {
+	int FatType;			// 0 - by cluster count
+	uint32_t ClusSize;
+	uint64_t ImgSize;		// 0 - fit to content
+	uint64_t FreeSize;		// Free space left when fit to content
+	uint32_t Align;			// Data area alignment in bytes
+	uint32_t FileAlign;		// Start of files from this size aligned, 0 - none
+	uint32_t RootEnt;
+	bool bMbr;
+	char Label[12];
+	bool bTime;				// Fixed time stamp
+	time_t Time;
+	bool bVolId;
+	uint32_t VolId;
+} FATIMG_OPT;
+
+// UTF-16 character offsets in a long name entry
+extern const uint8_t g_FatImgLfnOff[FATIMG_LFN_CHARS];
+
+bool ReadAt(int Fd, uint64_t Off, void *pBuff, size_t Len);
+bool WriteAt(int Fd, uint64_t Off, const void *pBuff, size_t Len);
+bool ParseSize(const char *pStr, uint64_t &Size);
+bool IsPow2(uint64_t Val);
+bool IsShortChar(char c);
+uint8_t ShortNameChksum(const uint8_t *pName);
+void FormatShortName(const FATFS_SHORTNAME &Ent, std::string &Name);
+
+/**
+ * @brief	Build image from a directory tree
+ *
+ * @param	pSrc	: Source directory
+ * @param	pImg	: Image file to create
+ * @param	Opt		: Build options
+ *
+ * @return	Exit code, EXIT_OK or EXIT_FAILED
+ */
+int FatImgBuild(const char *pSrc, const char *pImg, FATIMG_OPT &Opt);
+
+/**
+ * @brief	Check image, repair it with bRepair
+ *
+ * @param	pImg		: Image file
+ * @param	bRepair		: Repair faults in place
+ * @param	bVerbose	: List files
+ *
+ * @return	Exit code, EXIT_OK, EXIT_FIXED, EXIT_ERRORS or EXIT_FAILED
+ */
+int FatImgCheck(const char *pImg, bool bRepair, bool bVerbose);
+
+#endif	// __FATIMG_H__
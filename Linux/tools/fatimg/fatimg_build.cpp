@@ -0,0 +1,922 @@
+/**-------------------------------------------------------------------------
+@file	fatimg_build.cpp
+
+@brief	FAT image builder of the fatimg tool
+
+build : each file and directory is written in one run of consecutive
+clusters.  Directories come first, right after the root, files follow in tree
+order.  The data area, and the partition when an MBR is written, start on an
+alignment boundary such as the flash erase block of the card.  Files from
+the file alignment size up start on a boundary as well.  Entries are sorted by
+name and timestamps can be fixed, the same tree always gives the same image.
+Times are stored in UTC.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "fatimg.h"
+
+namespace fs = std::filesystem;
+
+typedef struct {
+	int FatType;			// 16 or 32
+	uint32_t SecPerClus;
+	uint32_t PartStart;		// Sectors before the volume, MBR included
+	uint32_t RsvdSect;		// Reserved sectors, alignment padding included
+	uint32_t FatSect;		// Sectors per FAT copy
+	uint32_t RootEnt;		// FAT16 root directory entries
+	uint32_t NbClus;		// Number of data clusters
+	uint32_t TotSect;		// Volume sectors
+	uint32_t DataSect;		// Data area start, from volume start
+} FATIMG_GEOM;
+
+typedef struct __FatImg_Node {
+	std::string Name;		// UTF-8 host name
+	std::string Path;		// Host path
+	bool bDir;
+	uint32_t Size;
+	time_t MTime;
+	uint8_t Attr;
+	uint8_t Short[11];
+	uint8_t NTRes;
+	std::vector<uint16_t> Lfn;	// UTF-16 long name, empty if short name only
+	uint32_t FirstClus;
+	uint32_t NbClus;
+	uint32_t NbEnt;			// Directory entries, dot entries included
+	std::vector<__FatImg_Node> Child;
+} FATIMG_NODE;
+
+/**
+ * Build short name, same rules as FatFS : names valid as 8.3 in one case per
+ * part are stored as short name only, case kept in NTRes.  Other names get a
+ * basis name to be completed by a numeric tail.
+ *
+ * @return	true - Name fits in short name
+ */
+static bool MakeShortName(const std::string &Name, uint8_t *pShort, uint8_t &NTRes)
+{
+	int len = Name.size();
+	int dot = -1;
+	bool fits = true;
+	int lower[2] = { 0, 0 }, upper[2] = { 0, 0 };
+
+	memset(pShort, ' ', 11);
+	NTRes = 0;
+
+	for (int i = len - 1; i > 0; i--)
+	{
+		if (Name[i] == '.')
+		{
+			dot = i;
+			break;
+		}
+	}
+
+	int baselen = dot >= 0 ? dot : len;
+	int extlen = dot >= 0 ? len - baselen - 1 : 0;
+
+	if (baselen < 1 || baselen > 8 || extlen > 3 || (dot >= 0 && extlen == 0))
+		fits = false;
+
+	for (int i = 0, n = 0, part = 0; i < len; i++)
+	{
+		char c = Name[i];
+
+		if (i == dot)
+		{
+			part = 1;
+			n = 8;
+			continue;
+		}
+		if (c == ' ' || c == '.')
+		{
+			fits = false;
+			continue;
+		}
+		if (islower((uint8_t)c))
+			lower[part]++;
+		else if (isupper((uint8_t)c))
+			upper[part]++;
+
+		c = toupper((uint8_t)c);
+		if (IsShortChar(c) == false)
+		{
+			c = '_';
+			fits = false;
+		}
+		if ((part == 0 && n < 8) || (part == 1 && n < 11))
+			pShort[n++] = c;
+	}
+
+	if (pShort[0] == ' ')
+		pShort[0] = '_';
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (lower[i] > 0 && upper[i] > 0)
+			fits = false;
+	}
+	if (lower[0] > 0)
+		NTRes |= FATIMG_NTRES_LOWBASE;
+	if (lower[1] > 0)
+		NTRes |= FATIMG_NTRES_LOWEXT;
+
+	return fits;
+}
+
+/**
+ * Replace end of short name basis with numeric tail ~N, as FatFS does
+ */
+static void SetShortNameTail(uint8_t *pShort, const uint8_t *pBasis, int N, uint32_t Hash)
+{
+	char tail[16];
+	int baselen = 8;
+
+	memcpy(pShort, pBasis, 11);
+
+	while (baselen > 0 && pBasis[baselen - 1] == ' ')
+		baselen--;
+
+	if (N <= 4)
+	{
+		snprintf(tail, sizeof(tail), "~%d", N);
+	}
+	else
+	{
+		snprintf(tail, sizeof(tail), "%04X~%d", (unsigned)(Hash & 0xFFFF), N - 4);
+		baselen = std::min(baselen, 2);
+	}
+
+	int l = strlen(tail);
+	int pos = std::min(baselen, 8 - l);
+
+	memcpy(pShort + pos, tail, l);
+	for (int i = pos + l; i < 8; i++)
+		pShort[i] = ' ';
+}
+
+/**
+ * Convert UTF-8 host name to UTF-16 long name
+ *
+ * @return	false - Invalid encoding or character not allowed in long names
+ */
+static bool MakeLongName(const std::string &Name, std::vector<uint16_t> &Lfn)
+{
+	const uint8_t *p = (const uint8_t*)Name.c_str();
+
+	Lfn.clear();
+	while (*p)
+	{
+		uint32_t c = *p++;
+		int n = 0;
+
+		if (c >= 0xF0 && c < 0xF5)
+		{
+			c &= 7;
+			n = 3;
+		}
+		else if (c >= 0xE0)
+		{
+			c &= 0xF;
+			n = 2;
+		}
+		else if (c >= 0xC2)
+		{
+			c &= 0x1F;
+			n = 1;
+		}
+		else if (c >= 0x80)
+		{
+			return false;
+		}
+
+		for (; n > 0; n--, p++)
+		{
+			if ((*p & 0xC0) != 0x80)
+				return false;
+			c = (c << 6) | (*p & 0x3F);
+		}
+
+		if (c < 0x20 || strchr("\"*/:<>?\\|\x7F", c) != NULL || (c >= 0xD800 && c < 0xE000) ||
+			c > 0x10FFFF)
+			return false;
+
+		if (c >= 0x10000)
+		{
+			c -= 0x10000;
+			Lfn.push_back(0xD800 | (c >> 10));
+			Lfn.push_back(0xDC00 | (c & 0x3FF));
+		}
+		else
+		{
+			Lfn.push_back(c);
+		}
+	}
+
+	return Lfn.size() > 0 && Lfn.size() <= FATFS_LFN_MAX && Lfn.back() != '.' && Lfn.back() != ' ';
+}
+
+static uint32_t DosTime(time_t Time)
+{
+	struct tm tm;
+
+	gmtime_r(&Time, &tm);
+
+	if (tm.tm_year < 80)
+		return FATFS_TIME_DEF;
+	if (tm.tm_year > 207)
+		tm.tm_year = 207;
+
+	return ((tm.tm_year - 80) << 25) | ((tm.tm_mon + 1) << 21) | (tm.tm_mday << 16) |
+		   (tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2);
+}
+
+/**
+ * Read host tree.  Children are sorted by name, symbolic links to files are
+ * followed, other non regular files skipped.
+ */
+static bool ScanTree(FATIMG_NODE &Dir, const FATIMG_OPT &Opt)
+{
+	std::error_code ec;
+	std::vector<std::string> names;
+
+	for (auto &e : fs::directory_iterator(Dir.Path, ec))
+	{
+		names.push_back(e.path().filename().string());
+	}
+	if (ec)
+	{
+		fprintf(stderr, "%s: %s\n", Dir.Path.c_str(), ec.message().c_str());
+		return false;
+	}
+
+	std::sort(names.begin(), names.end());
+
+	for (auto &name : names)
+	{
+		FATIMG_NODE n;
+		struct stat st;
+
+		n.Name = name;
+		n.Path = Dir.Path + "/" + name;
+
+		if (lstat(n.Path.c_str(), &st) != 0)
+		{
+			fprintf(stderr, "%s: %s\n", n.Path.c_str(), strerror(errno));
+			return false;
+		}
+
+		bool link = S_ISLNK(st.st_mode);
+
+		if (link && (stat(n.Path.c_str(), &st) != 0 || S_ISDIR(st.st_mode)))
+		{
+			fprintf(stderr, "%s: broken link or link to directory, skipped\n", n.Path.c_str());
+			continue;
+		}
+		if (S_ISDIR(st.st_mode) == false && S_ISREG(st.st_mode) == false)
+		{
+			fprintf(stderr, "%s: not a regular file, skipped\n", n.Path.c_str());
+			continue;
+		}
+		if (S_ISREG(st.st_mode) && (uint64_t)st.st_size > 0xFFFFFFFFULL)
+		{
+			fprintf(stderr, "%s: larger than 4GB\n", n.Path.c_str());
+			return false;
+		}
+
+		n.bDir = S_ISDIR(st.st_mode);
+		n.Size = n.bDir ? 0 : st.st_size;
+		n.MTime = Opt.bTime ? Opt.Time : st.st_mtime;
+		n.Attr = n.bDir ? FATFS_DIRATTR_DIRECTORY : FATFS_DIRATTR_ARCHIVE;
+		if ((st.st_mode & S_IWUSR) == 0)
+			n.Attr |= FATFS_DIRATTR_READ_ONLY;
+		n.FirstClus = 0;
+		n.NbClus = 0;
+		n.NbEnt = 0;
+
+		if (n.bDir && ScanTree(n, Opt) == false)
+			return false;
+
+		Dir.Child.push_back(std::move(n));
+	}
+
+	return true;
+}
+
+/**
+ * Assign short names and long names of directory entries, count entries
+ */
+static bool NameEntries(FATIMG_NODE &Dir, bool bRoot, const FATIMG_OPT &Opt)
+{
+	std::set<std::string> shorts;
+	std::set<std::vector<uint16_t>> longs;
+
+	Dir.NbEnt = bRoot ? (Opt.Label[0] ? 1 : 0) : 2;
+
+	for (auto &n : Dir.Child)
+	{
+		std::vector<uint16_t> lfn;
+
+		if (MakeLongName(n.Name, lfn) == false)
+		{
+			fprintf(stderr, "%s: not a valid FAT name\n", n.Path.c_str());
+			return false;
+		}
+
+		// Names are not case sensitive
+		for (auto &c : lfn)
+			c = c < 0x80 ? toupper(c) : c;
+		if (longs.insert(lfn).second == false)
+		{
+			fprintf(stderr, "%s: name differs from another one only by case\n", n.Path.c_str());
+			return false;
+		}
+		MakeLongName(n.Name, lfn);
+
+		bool fits = MakeShortName(n.Name, n.Short, n.NTRes);
+
+		if (fits == false || shorts.count(std::string((char*)n.Short, 11)))
+		{
+			uint8_t basis[11];
+			uint32_t hash = 0;
+			int i;
+
+			memcpy(basis, n.Short, 11);
+			for (char c : n.Name)
+				hash = hash * 31 + (uint8_t)c;
+
+			for (i = 1; i <= 999999; i++)
+			{
+				SetShortNameTail(n.Short, basis, i, hash);
+				if (shorts.count(std::string((char*)n.Short, 11)) == 0)
+					break;
+			}
+			if (i > 999999)
+			{
+				fprintf(stderr, "%s: no short name left\n", n.Path.c_str());
+				return false;
+			}
+
+			n.NTRes = 0;
+			n.Lfn = lfn;
+		}
+
+		shorts.insert(std::string((char*)n.Short, 11));
+		Dir.NbEnt += 1 + (n.Lfn.size() + FATIMG_LFN_CHARS - 1) / FATIMG_LFN_CHARS;
+
+		if (n.bDir && NameEntries(n, false, Opt) == false)
+			return false;
+	}
+
+	if (Dir.NbEnt > FATFS_DIRENT_MAX)
+	{
+		fprintf(stderr, "%s: too many entries\n", Dir.Path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Assign clusters.  Subdirectories first, breadth first, then files in tree
+ * order.  Each one gets consecutive clusters.
+ *
+ * @return	Next free cluster
+ */
+static uint32_t Layout(FATIMG_NODE &Root, const FATIMG_GEOM &Geom, const FATIMG_OPT &Opt)
+{
+	uint32_t clusbytes = Geom.SecPerClus * FATIMG_SECT_SIZE;
+	uint32_t next = 2;
+	std::vector<FATIMG_NODE*> dirs;
+
+	if (Geom.FatType == 32)
+	{
+		Root.FirstClus = next;
+		Root.NbClus = std::max(1U, (Root.NbEnt * 32 + clusbytes - 1) / clusbytes);
+		next += Root.NbClus;
+	}
+
+	dirs.push_back(&Root);
+	for (size_t i = 0; i < dirs.size(); i++)
+	{
+		for (auto &n : dirs[i]->Child)
+		{
+			if (n.bDir)
+			{
+				n.FirstClus = next;
+				n.NbClus = std::max(1U, (n.NbEnt * 32 + clusbytes - 1) / clusbytes);
+				next += n.NbClus;
+				dirs.push_back(&n);
+			}
+		}
+	}
+
+	// Files, depth first
+	std::vector<FATIMG_NODE*> stack;
+
+	stack.push_back(&Root);
+	while (stack.size() > 0)
+	{
+		FATIMG_NODE *d = stack.back();
+
+		stack.pop_back();
+		for (auto &n : d->Child)
+		{
+			if (n.bDir || n.Size == 0)
+				continue;
+
+			if (Opt.FileAlign > 0 && n.Size >= Opt.FileAlign)
+			{
+				uint32_t a = Opt.FileAlign / clusbytes;
+
+				next = 2 + (next - 2 + a - 1) / a * a;
+			}
+			n.FirstClus = next;
+			n.NbClus = (n.Size + clusbytes - 1) / clusbytes;
+			next += n.NbClus;
+		}
+		for (auto it = d->Child.rbegin(); it != d->Child.rend(); it++)
+		{
+			if (it->bDir)
+				stack.push_back(&*it);
+		}
+	}
+
+	return next;
+}
+
+/**
+ * Volume layout for NbClus clusters.  Reserved sectors are padded so that the
+ * data area starts on an Align boundary from the start of the image.
+ */
+static void SetGeom(FATIMG_GEOM &Geom, uint32_t NbClus, uint32_t Align)
+{
+	uint32_t esize = Geom.FatType == 32 ? 4 : 2;
+	uint32_t alignsect = std::max(1U, Align / FATIMG_SECT_SIZE);
+	uint32_t rootsect = Geom.FatType == 32 ? 0 : Geom.RootEnt * 32 / FATIMG_SECT_SIZE;
+
+	Geom.NbClus = NbClus;
+	Geom.RsvdSect = Geom.FatType == 32 ? FATFS_RSVDSECCNT_FAT32 : FATFS_RSVDSECCNT_FAT16;
+	Geom.FatSect = ((uint64_t)(NbClus + 2) * esize + FATIMG_SECT_SIZE - 1) / FATIMG_SECT_SIZE;
+	Geom.DataSect = Geom.RsvdSect + FATFS_NBFAT * Geom.FatSect + rootsect;
+
+	uint32_t pad = (alignsect - (Geom.PartStart + Geom.DataSect) % alignsect) % alignsect;
+
+	Geom.RsvdSect += pad;
+	Geom.DataSect += pad;
+	Geom.TotSect = Geom.DataSect + NbClus * Geom.SecPerClus;
+}
+
+/**
+ * Largest number of clusters fitting in AvailSect volume sectors
+ */
+static uint32_t FitClusters(FATIMG_GEOM &Geom, uint64_t AvailSect, uint32_t Align)
+{
+	uint32_t lo = 0, hi = std::min<uint64_t>(AvailSect / Geom.SecPerClus, FATIMG_FAT32_MAX);
+
+	while (lo < hi)
+	{
+		uint32_t mid = lo + (hi - lo + 1) / 2;
+
+		SetGeom(Geom, mid, Align);
+		if (Geom.TotSect <= AvailSect)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	SetGeom(Geom, lo, Align);
+
+	return lo;
+}
+
+static bool CheckType(const FATIMG_GEOM &Geom)
+{
+	if (Geom.FatType == 16)
+		return Geom.NbClus >= FATIMG_FAT16_MIN && Geom.NbClus < FATIMG_FAT32_MIN;
+
+	return Geom.NbClus >= FATIMG_FAT32_MIN && Geom.NbClus <= FATIMG_FAT32_MAX;
+}
+
+static void WriteEntry(std::vector<FATFS_DIR> &Ents, const FATIMG_NODE &N, uint32_t Time)
+{
+	int nlfn = (N.Lfn.size() + FATIMG_LFN_CHARS - 1) / FATIMG_LFN_CHARS;
+	uint8_t chksum = ShortNameChksum(N.Short);
+	FATFS_DIR d;
+
+	// Long name entries in reverse order, then short entry
+	for (int ord = nlfn; ord > 0; ord--)
+	{
+		uint8_t *p = (uint8_t*)&d;
+		size_t off = (ord - 1) * FATIMG_LFN_CHARS;
+
+		memset(&d, 0, sizeof(d));
+		d.LongName.Ord = ord | (ord == nlfn ? FATFS_DIRENT_LASTLONG : 0);
+		d.LongName.Attr = FATFS_DIRATTR_LONG_NAME;
+		d.LongName.Chksum = chksum;
+		for (size_t i = 0; i < FATIMG_LFN_CHARS; i++)
+		{
+			uint16_t c = off + i < N.Lfn.size() ? N.Lfn[off + i] : off + i == N.Lfn.size() ? 0 : 0xFFFF;
+
+			p[g_FatImgLfnOff[i]] = c & 0xFF;
+			p[g_FatImgLfnOff[i] + 1] = c >> 8;
+		}
+		Ents.push_back(d);
+	}
+
+	memset(&d, 0, sizeof(d));
+	memcpy(d.ShortName.Name, N.Short, 11);
+	d.ShortName.Attr = N.Attr;
+	d.ShortName.NTRes = N.NTRes;
+	d.ShortName.CrtTime = Time & 0xFFFF;
+	d.ShortName.CrtDate = Time >> 16;
+	d.ShortName.WrtTime = Time & 0xFFFF;
+	d.ShortName.WrtDate = Time >> 16;
+	d.ShortName.lstAccDate = Time >> 16;
+	d.ShortName.FstClusHI = N.FirstClus >> 16;
+	d.ShortName.FstClusLO = N.FirstClus & 0xFFFF;
+	d.ShortName.FileSize = N.bDir ? 0 : N.Size;
+	Ents.push_back(d);
+}
+
+static void DotEntry(std::vector<FATFS_DIR> &Ents, const char *pName, uint32_t Clus, uint32_t Time)
+{
+	FATFS_DIR d;
+
+	memset(&d, 0, sizeof(d));
+	memcpy(d.ShortName.Name, pName, 11);
+	d.ShortName.Attr = FATFS_DIRATTR_DIRECTORY;
+	d.ShortName.CrtTime = Time & 0xFFFF;
+	d.ShortName.CrtDate = Time >> 16;
+	d.ShortName.WrtTime = Time & 0xFFFF;
+	d.ShortName.WrtDate = Time >> 16;
+	d.ShortName.lstAccDate = Time >> 16;
+	d.ShortName.FstClusHI = Clus >> 16;
+	d.ShortName.FstClusLO = Clus & 0xFFFF;
+	Ents.push_back(d);
+}
+
+static void SetChain(std::vector<uint32_t> &Fat, uint32_t First, uint32_t NbClus)
+{
+	for (uint32_t i = 0; i < NbClus; i++)
+	{
+		Fat[First + i] = i + 1 < NbClus ? First + i + 1 : FATIMG_EOC;
+	}
+}
+
+/**
+ * Write directory tree.  Directory entries in Ents of parent, data written
+ * to clusters.
+ */
+static bool WriteTree(int Fd, const FATIMG_NODE &Dir, uint32_t ParentClus, bool bRoot,
+					  const FATIMG_GEOM &Geom, const FATIMG_OPT &Opt, std::vector<uint32_t> &Fat,
+					  std::vector<uint8_t> &Buff)
+{
+	uint64_t clusbytes = Geom.SecPerClus * FATIMG_SECT_SIZE;
+	uint64_t dataoff = (uint64_t)(Geom.PartStart + Geom.DataSect) * FATIMG_SECT_SIZE;
+	std::vector<FATFS_DIR> ents;
+
+	if (bRoot)
+	{
+		if (Opt.Label[0])
+		{
+			FATFS_DIR d;
+			uint32_t t = DosTime(Opt.bTime ? Opt.Time : time(NULL));
+
+			memset(&d, 0, sizeof(d));
+			memcpy(d.ShortName.Name, Opt.Label, 11);
+			d.ShortName.Attr = FATFS_DIRATTR_VOLUME_ID;
+			d.ShortName.WrtTime = t & 0xFFFF;
+			d.ShortName.WrtDate = t >> 16;
+			ents.push_back(d);
+		}
+	}
+	else
+	{
+		uint32_t t = DosTime(Dir.MTime);
+
+		DotEntry(ents, ".          ", Dir.FirstClus, t);
+		DotEntry(ents, "..         ", ParentClus, t);
+	}
+
+	for (auto &n : Dir.Child)
+	{
+		WriteEntry(ents, n, DosTime(n.MTime));
+
+		if (n.NbClus > 0)
+			SetChain(Fat, n.FirstClus, n.NbClus);
+
+		if (n.bDir)
+		{
+			// '..' of root children is 0, FAT32 included
+			if (WriteTree(Fd, n, bRoot ? 0 : Dir.FirstClus, false, Geom, Opt, Fat, Buff) == false)
+				return false;
+		}
+		else if (n.Size > 0)
+		{
+			int f = open(n.Path.c_str(), O_RDONLY);
+			uint64_t off = dataoff + (uint64_t)(n.FirstClus - 2) * clusbytes;
+			uint32_t rem = n.Size;
+
+			if (f < 0)
+			{
+				fprintf(stderr, "%s: %s\n", n.Path.c_str(), strerror(errno));
+				return false;
+			}
+			while (rem > 0)
+			{
+				ssize_t l = read(f, Buff.data(), std::min<size_t>(rem, Buff.size()));
+
+				if (l <= 0 || WriteAt(Fd, off, Buff.data(), l) == false)
+				{
+					fprintf(stderr, "%s: read error or file changed\n", n.Path.c_str());
+					close(f);
+					return false;
+				}
+				off += l;
+				rem -= l;
+			}
+			close(f);
+		}
+	}
+
+	uint64_t off;
+
+	if (bRoot && Geom.FatType == 16)
+	{
+		if (ents.size() > Geom.RootEnt)
+		{
+			fprintf(stderr, "root directory full\n");
+			return false;
+		}
+		off = (uint64_t)(Geom.PartStart + Geom.RsvdSect + FATFS_NBFAT * Geom.FatSect) * FATIMG_SECT_SIZE;
+	}
+	else
+	{
+		if (bRoot)
+			SetChain(Fat, Dir.FirstClus, Dir.NbClus);
+		off = dataoff + (uint64_t)(Dir.FirstClus - 2) * clusbytes;
+	}
+
+	return ents.size() == 0 || WriteAt(Fd, off, ents.data(), ents.size() * sizeof(FATFS_DIR));
+}
+
+int FatImgBuild(const char *pSrc, const char *pImg, FATIMG_OPT &Opt)
+{
+	FATIMG_NODE root;
+
+	root.Path = pSrc;
+	root.bDir = true;
+	root.FirstClus = 0;
+	root.NbClus = 0;
+
+	if (fs::is_directory(pSrc) == false)
+	{
+		fprintf(stderr, "%s: not a directory\n", pSrc);
+		return EXIT_FAILED;
+	}
+	if (ScanTree(root, Opt) == false || NameEntries(root, true, Opt) == false)
+		return EXIT_FAILED;
+
+	FATIMG_GEOM geom;
+	uint32_t clusbytes = Opt.ClusSize;
+
+	memset(&geom, 0, sizeof(geom));
+	geom.SecPerClus = clusbytes / FATIMG_SECT_SIZE;
+	geom.PartStart = Opt.bMbr ? std::max(1U, Opt.Align / FATIMG_SECT_SIZE) : 0;
+	geom.RootEnt = std::max(Opt.RootEnt, (root.NbEnt + 15) & ~15U);
+
+	if (geom.RootEnt > 0xFFF0)
+	{
+		fprintf(stderr, "root directory too large for FAT16\n");
+		return EXIT_FAILED;
+	}
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		// Content size depends on FAT type only through the root directory
+		geom.FatType = Opt.FatType ? Opt.FatType : pass == 0 ? 16 : 32;
+
+		uint64_t need = Layout(root, geom, Opt) - 2 + (Opt.FreeSize + clusbytes - 1) / clusbytes;
+
+		if (Opt.ImgSize > 0)
+		{
+			uint64_t avail = Opt.ImgSize / FATIMG_SECT_SIZE;
+
+			if (avail <= geom.PartStart || FitClusters(geom, avail - geom.PartStart, Opt.Align) < need)
+			{
+				if (Opt.FatType == 0 && pass == 0)
+					continue;
+				fprintf(stderr, "content does not fit in image size\n");
+				return EXIT_FAILED;
+			}
+		}
+		else
+		{
+			uint32_t min = geom.FatType == 32 ? FATIMG_FAT32_MIN : FATIMG_FAT16_MIN;
+
+			SetGeom(geom, std::min<uint64_t>(std::max<uint64_t>(need, min), FATIMG_FAT32_MAX), Opt.Align);
+		}
+
+		if (CheckType(geom) == false)
+		{
+			if (Opt.FatType == 0 && pass == 0)
+				continue;
+			fprintf(stderr, "%u clusters of %u bytes not valid for FAT%d, change cluster size\n",
+					geom.NbClus, clusbytes, geom.FatType);
+			return EXIT_FAILED;
+		}
+
+		break;
+	}
+
+	if (Opt.ImgSize == 0)
+		Opt.ImgSize = (uint64_t)(geom.PartStart + geom.TotSect) * FATIMG_SECT_SIZE;
+
+	int fd = open(pImg, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0)
+	{
+		fprintf(stderr, "%s: %s\n", pImg, strerror(errno));
+		return EXIT_FAILED;
+	}
+
+	bool res = ftruncate(fd, Opt.ImgSize) == 0;
+	uint32_t t = DosTime(Opt.bTime ? Opt.Time : time(NULL));
+	uint32_t volid = Opt.bVolId ? Opt.VolId : (t >> 16) + (t << 16);
+	std::vector<uint32_t> fat(geom.NbClus + 2, 0);
+	std::vector<uint8_t> buff(1024 * 1024);
+	uint8_t sect[FATIMG_SECT_SIZE];
+
+	fat[0] = 0x0FFFFF00 | FATFS_MEDIA_FIXED;
+	fat[1] = FATIMG_EOC;
+
+	res = res && WriteTree(fd, root, 0, true, geom, Opt, fat, buff);
+
+	if (Opt.bMbr)
+	{
+		MBR *mbr = (MBR*)sect;
+
+		memset(sect, 0, sizeof(sect));
+		mbr->Part[0].CHSStart[0] = 0xFE;
+		mbr->Part[0].CHSStart[1] = 0xFF;
+		mbr->Part[0].CHSStart[2] = 0xFF;
+		mbr->Part[0].Type = geom.FatType == 32 ? 0x0C : 0x0E;
+		mbr->Part[0].CHSEnd[0] = 0xFE;
+		mbr->Part[0].CHSEnd[1] = 0xFF;
+		mbr->Part[0].CHSEnd[2] = 0xFF;
+		mbr->Part[0].LBAStart = geom.PartStart;
+		mbr->Part[0].LBASize = geom.TotSect;
+		mbr->Sig = 0xAA55;
+		res = res && WriteAt(fd, 0, sect, sizeof(sect));
+	}
+
+	FATFS_BSBPB *bs = (FATFS_BSBPB*)sect;
+	uint64_t voloff = (uint64_t)geom.PartStart * FATIMG_SECT_SIZE;
+
+	memset(sect, 0, sizeof(sect));
+	bs->JmpBoot[0] = 0xEB;
+	bs->JmpBoot[1] = geom.FatType == 32 ? 0x58 : 0x3C;
+	bs->JmpBoot[2] = 0x90;
+	memcpy(bs->OEMName, "MSWIN4.1", 8);
+	bs->BytsPerSec = FATIMG_SECT_SIZE;
+	bs->SecPerClus = geom.SecPerClus;
+	bs->RsvdSecCnt = geom.RsvdSect;
+	bs->NumFATs = FATFS_NBFAT;
+	bs->Media = FATFS_MEDIA_FIXED;
+	bs->SecPerTrk = 63;
+	bs->NumHeads = 255;
+	bs->HiddSec = geom.PartStart;
+	if (geom.FatType == 16 && geom.TotSect < 0x10000)
+		bs->TotSec16 = geom.TotSect;
+	else
+		bs->TotSec32 = geom.TotSect;
+
+	if (geom.FatType == 32)
+	{
+		bs->BPB.Bpb32.FATSz32 = geom.FatSect;
+		bs->BPB.Bpb32.RootClus = root.FirstClus;
+		bs->BPB.Bpb32.FSInfo = 1;
+		bs->BPB.Bpb32.BkBootSec = 6;
+		bs->BPB.Bpb32.DrvNum = 0x80;
+		bs->BPB.Bpb32.BootSig = 0x29;
+		bs->BPB.Bpb32.VolID = volid;
+		memcpy(bs->BPB.Bpb32.VolLab, Opt.Label[0] ? Opt.Label : "NO NAME    ", 11);
+		memcpy(bs->BPB.Bpb32.FilSysType, "FAT32   ", 8);
+	}
+	else
+	{
+		bs->RootEntCnt = geom.RootEnt;
+		bs->FATSz16 = geom.FatSect;
+		bs->BPB.Bpb16.DrvNum = 0x80;
+		bs->BPB.Bpb16.BootSig = 0x29;
+		bs->BPB.Bpb16.VolID = volid;
+		memcpy(bs->BPB.Bpb16.VolLab, Opt.Label[0] ? Opt.Label : "NO NAME    ", 11);
+		memcpy(bs->BPB.Bpb16.FilSysType, "FAT16   ", 8);
+	}
+	bs->Signature_word[0] = 0x55;
+	bs->Signature_word[1] = 0xAA;
+
+	res = res && WriteAt(fd, voloff, sect, sizeof(sect));
+
+	uint32_t used = 0, nextfree = 0;
+
+	for (uint32_t i = 2; i < geom.NbClus + 2; i++)
+	{
+		if (fat[i] != 0)
+			used++;
+		else if (nextfree == 0)
+			nextfree = i;
+	}
+
+	if (geom.FatType == 32)
+	{
+		res = res && WriteAt(fd, voloff + 6 * FATIMG_SECT_SIZE, sect, sizeof(sect));
+
+		FATFS_FSINFO *fsi = (FATFS_FSINFO*)sect;
+
+		memset(sect, 0, sizeof(sect));
+		fsi->LeadSig = FATFS_FSINFO_LEADSIG;
+		fsi->StrucSig = FATFS_FSINFO_STRUCSIG;
+		fsi->Free_Count = geom.NbClus - used;
+		fsi->Nxt_Free = nextfree ? nextfree : FATFS_FSINFO_UNKNOWN;
+		fsi->TrailSig = 0xAA550000;
+		res = res && WriteAt(fd, voloff + FATIMG_SECT_SIZE, sect, sizeof(sect)) &&
+			  WriteAt(fd, voloff + 7 * FATIMG_SECT_SIZE, sect, sizeof(sect));
+	}
+
+	// FAT copies
+	std::vector<uint8_t> fatbuf((uint64_t)geom.FatSect * FATIMG_SECT_SIZE, 0);
+
+	for (uint32_t i = 0; i < geom.NbClus + 2; i++)
+	{
+		if (geom.FatType == 32)
+		{
+			memcpy(&fatbuf[i * 4], &fat[i], 4);
+		}
+		else
+		{
+			uint16_t v = fat[i] >= FATIMG_RSVD ? 0xFFF0 | (fat[i] & 0xF) : fat[i] & 0xFFFF;
+
+			memcpy(&fatbuf[i * 2], &v, 2);
+		}
+	}
+	for (int i = 0; i < FATFS_NBFAT; i++)
+	{
+		uint64_t off = voloff + (uint64_t)(geom.RsvdSect + i * geom.FatSect) * FATIMG_SECT_SIZE;
+
+		res = res && WriteAt(fd, off, fatbuf.data(), fatbuf.size());
+	}
+
+	if (close(fd) != 0 || res == false)
+	{
+		fprintf(stderr, "%s: write failed\n", pImg);
+		return EXIT_FAILED;
+	}
+
+	printf("%s: FAT%d, %u bytes per cluster, %u clusters, %u used, data at %llu\n", pImg,
+		   geom.FatType, clusbytes, geom.NbClus, used,
+		   (unsigned long long)(geom.PartStart + geom.DataSect) * FATIMG_SECT_SIZE);
+
+	return EXIT_OK;
+}
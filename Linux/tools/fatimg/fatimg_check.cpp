@@ -0,0 +1,890 @@
+/**-------------------------------------------------------------------------
+@file	fatimg_check.cpp
+
+@brief	FAT image checker of the fatimg tool
+
+check : validates the boot sector, FAT copies, FSInfo and the directory tree.
+Reports chains with invalid links, cross-linked chains, loops, file sizes
+not matching the chain length, lost clusters, damaged long names and stale
+free cluster counts.  With -r, faults are repaired in place : chains are
+truncated at the fault, sizes set to the chain length, lost clusters freed,
+FAT copies and FSInfo rewritten.  Cross-linked clusters stay with the first
+file found.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "fatimg.h"
+
+#define FATIMG_OWN_TAIL		0xFFFFFFFF	// Cluster past the size of a file, to be freed
+
+class FatCheck {
+public:
+	int Run(const char *pImg, bool bRepair, bool bVerbose);
+
+private:
+	bool Mount();
+	uint32_t Get(uint32_t Clus) { return vFat[Clus]; }
+	void Set(uint32_t Clus, uint32_t Val);
+	bool IsValid(uint32_t Clus) { return Clus >= 2 && Clus < vNbClus + 2; }
+	bool IsAlloc(uint32_t Val) { return Val != 0 && Val != FATIMG_BAD; }
+	uint64_t ClusOffset(uint32_t Clus) { return vDataOff + (uint64_t)(Clus - 2) * vClusBytes; }
+	void Fault(bool bFixable, const std::string &Path, const char *pFmt, ...);
+	uint32_t Claim(uint32_t First, uint32_t Id, uint32_t MaxLen, const std::string &Path,
+				   std::vector<uint32_t> *pList);
+	uint32_t MarkTail(uint32_t Clus);
+	bool CheckStart(uint32_t Clus, const std::string &Path);
+	void PutEnt(uint64_t Off, const FATFS_DIR &Ent);
+	void DeleteEnt(uint64_t Off, FATFS_DIR &Ent);
+	void ScanDir(uint32_t Id, uint32_t Clus, uint32_t ParentClus, int Depth);
+	void CheckFat();
+	void CheckFSInfo();
+	bool WriteFat();
+
+	int vFd;
+	bool vbRepair;
+	bool vbVerbose;
+	uint64_t vSize;				// Image size in bytes
+	uint64_t vVolOff;			// Volume offset in image
+	FATFS_BSBPB vBs;
+	int vFatType;
+	uint32_t vSectSize;
+	uint32_t vClusBytes;
+	uint32_t vNbClus;
+	uint32_t vFatSect;
+	uint32_t vNbFat;
+	uint32_t vActiveFat;
+	uint64_t vFatOff;			// First FAT copy offset in image
+	uint64_t vRootOff;			// FAT16 root directory offset in image
+	uint32_t vRootEnt;
+	uint64_t vDataOff;			// Cluster 2 offset in image
+	uint32_t vRootClus;
+	std::vector<uint32_t> vFat;	// Active FAT, FAT16 values mapped to FAT32 values
+	std::vector<uint32_t> vFatHi;	// Reserved upper bits of FAT32 entries
+	std::vector<uint32_t> vOwner;	// Node owning cluster, 0 - none
+	std::vector<std::string> vPath;	// Path of node Id - 1
+	bool vbFatDirty;
+	int vNbErr;
+	int vNbFixed;
+	int vNbUnfixed;
+	uint32_t vNbFile;
+	uint32_t vNbDir;
+	uint32_t vNbFrag;			// Files or directories in more than one run
+};
+
+void FatCheck::Fault(bool bFixable, const std::string &Path, const char *pFmt, ...)
+{
+	va_list args;
+
+	printf("%s: ", Path.c_str());
+	va_start(args, pFmt);
+	vprintf(pFmt, args);
+	va_end(args);
+
+	vNbErr++;
+	if (bFixable && vbRepair)
+	{
+		printf(", fixed\n");
+		vNbFixed++;
+	}
+	else
+	{
+		printf("\n");
+		if (bFixable == false)
+			vNbUnfixed++;
+	}
+}
+
+void FatCheck::Set(uint32_t Clus, uint32_t Val)
+{
+	if (vbRepair)
+	{
+		vFat[Clus] = Val;
+		vbFatDirty = true;
+	}
+}
+
+bool FatCheck::Mount()
+{
+	uint8_t sect[FATIMG_SECT_SIZE];
+	FATFS_BSBPB *bs = (FATFS_BSBPB*)sect;
+
+	vVolOff = 0;
+
+	if (ReadAt(vFd, 0, sect, sizeof(sect)) == false)
+		return false;
+
+	if ((bs->JmpBoot[0] != 0xEB || bs->JmpBoot[2] != 0x90) && bs->JmpBoot[0] != 0xE9)
+	{
+		MBR *mbr = (MBR*)sect;
+
+		if (mbr->Sig != 0xAA55 || mbr->Part[0].LBAStart == 0)
+		{
+			printf("no FAT boot sector or partition\n");
+			return false;
+		}
+		vVolOff = (uint64_t)mbr->Part[0].LBAStart * FATIMG_SECT_SIZE;
+		if (ReadAt(vFd, vVolOff, sect, sizeof(sect)) == false)
+			return false;
+	}
+
+	memcpy(&vBs, sect, sizeof(vBs));
+
+	if (((vBs.JmpBoot[0] != 0xEB || vBs.JmpBoot[2] != 0x90) && vBs.JmpBoot[0] != 0xE9) ||
+		(vBs.BytsPerSec != 512 && vBs.BytsPerSec != 1024 && vBs.BytsPerSec != 2048 &&
+		 vBs.BytsPerSec != 4096) || IsPow2(vBs.SecPerClus) == false ||
+		vBs.NumFATs == 0 || vBs.RsvdSecCnt == 0)
+	{
+		printf("invalid boot sector\n");
+		return false;
+	}
+
+	vSectSize = vBs.BytsPerSec;
+	vClusBytes = vSectSize * vBs.SecPerClus;
+	vNbFat = vBs.NumFATs;
+	vRootEnt = vBs.RootEntCnt;
+	vFatSect = vBs.FATSz16 != 0 ? vBs.FATSz16 : vBs.BPB.Bpb32.FATSz32;
+
+	uint32_t totsect = vBs.TotSec16 != 0 ? vBs.TotSec16 : vBs.TotSec32;
+	uint32_t rootsect = (vRootEnt * 32 + vSectSize - 1) / vSectSize;
+	uint32_t datasect = vBs.RsvdSecCnt + vNbFat * vFatSect + rootsect;
+
+	if (vFatSect == 0 || totsect <= datasect)
+	{
+		printf("invalid boot sector\n");
+		return false;
+	}
+
+	vNbClus = (totsect - datasect) / vBs.SecPerClus;
+	if (vNbClus < FATIMG_FAT16_MIN)
+	{
+		printf("FAT12 not supported\n");
+		return false;
+	}
+	vFatType = vNbClus < FATIMG_FAT32_MIN ? 16 : 32;
+
+	if ((uint64_t)vFatSect * vSectSize / (vFatType / 8) < vNbClus + 2)
+	{
+		printf("FAT too small for %u clusters\n", vNbClus);
+		return false;
+	}
+	if (vFatType == 32 && (vRootEnt != 0 || vBs.FATSz16 != 0))
+	{
+		printf("invalid FAT32 boot sector\n");
+		return false;
+	}
+
+	vActiveFat = 0;
+	if (vFatType == 32 && (vBs.BPB.Bpb32.ExtFlags & 0x80))
+		vActiveFat = vBs.BPB.Bpb32.ExtFlags & 0xF;
+	if (vActiveFat >= vNbFat)
+	{
+		printf("invalid active FAT\n");
+		return false;
+	}
+
+	vFatOff = vVolOff + (uint64_t)vBs.RsvdSecCnt * vSectSize;
+	vRootOff = vFatOff + (uint64_t)vNbFat * vFatSect * vSectSize;
+	vDataOff = vVolOff + (uint64_t)datasect * vSectSize;
+	vRootClus = vFatType == 32 ? vBs.BPB.Bpb32.RootClus : 0;
+
+	if (vSize < vVolOff + (uint64_t)totsect * vSectSize)
+	{
+		printf("image of %llu bytes shorter than volume\n", (unsigned long long)vSize);
+		return false;
+	}
+
+	std::vector<uint8_t> buf((uint64_t)vFatSect * vSectSize);
+
+	if (ReadAt(vFd, vFatOff + (uint64_t)vActiveFat * buf.size(), buf.data(), buf.size()) == false)
+		return false;
+
+	vFat.resize(vNbClus + 2);
+	vFatHi.resize(vNbClus + 2);
+	for (uint32_t i = 0; i < vNbClus + 2; i++)
+	{
+		if (vFatType == 32)
+		{
+			uint32_t v;
+
+			memcpy(&v, &buf[i * 4], 4);
+			vFat[i] = v & FATFS_FAT32_ENTRY_MASK;
+			vFatHi[i] = v & ~FATFS_FAT32_ENTRY_MASK;
+		}
+		else
+		{
+			uint16_t v;
+
+			memcpy(&v, &buf[i * 2], 2);
+			vFat[i] = v >= 0xFFF0 ? FATIMG_RSVD | (v & 0xF) : v;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Follow a chain, claiming clusters for node Id.  Stops at the end of chain,
+ * at an invalid link, a loop or a cluster of another chain, where the chain
+ * is cut.  Clusters past MaxLen are marked to be freed.
+ *
+ * @return	Number of clusters claimed
+ */
+uint32_t FatCheck::Claim(uint32_t First, uint32_t Id, uint32_t MaxLen, const std::string &Path,
+						 std::vector<uint32_t> *pList)
+{
+	uint32_t c = First;
+	uint32_t n = 0;
+	bool frag = false;
+
+	while (true)
+	{
+		uint32_t v = Get(c);
+
+		vOwner[c] = Id;
+		n++;
+		if (pList)
+			pList->push_back(c);
+
+		if (v >= FATFS_FAT32_EOC)
+			break;
+
+		if (n >= MaxLen)
+		{
+			Fault(true, Path, "chain longer than file size, %u clusters past end", MarkTail(v));
+			Set(c, FATIMG_EOC);
+			break;
+		}
+		if (IsValid(v) == false)
+		{
+			Fault(true, Path, "invalid FAT entry %X at cluster %u", v, c);
+			Set(c, FATIMG_EOC);
+			break;
+		}
+		if (Get(v) == 0)
+		{
+			Fault(true, Path, "chain links to free cluster %u", v);
+			Set(c, FATIMG_EOC);
+			break;
+		}
+		if (vOwner[v] == Id)
+		{
+			Fault(true, Path, "chain loops at cluster %u", v);
+			Set(c, FATIMG_EOC);
+			break;
+		}
+		if (vOwner[v] != 0 && vOwner[v] != FATIMG_OWN_TAIL)
+		{
+			Fault(true, Path, "cross-linked with %s at cluster %u", vPath[vOwner[v] - 1].c_str(), v);
+			Set(c, FATIMG_EOC);
+			break;
+		}
+
+		frag |= v != c + 1;
+		c = v;
+	}
+
+	if (frag)
+		vNbFrag++;
+
+	return n;
+}
+
+/**
+ * Mark clusters from Clus, not used by another chain, to be freed
+ *
+ * @return	Number of clusters marked
+ */
+uint32_t FatCheck::MarkTail(uint32_t Clus)
+{
+	uint32_t cnt = 0;
+
+	for (uint32_t c = Clus; IsValid(c) && vOwner[c] == 0 && IsAlloc(Get(c)); c = Get(c))
+	{
+		vOwner[c] = FATIMG_OWN_TAIL;
+		cnt++;
+	}
+
+	return cnt;
+}
+
+bool FatCheck::CheckStart(uint32_t Clus, const std::string &Path)
+{
+	if (IsValid(Clus) == false)
+	{
+		Fault(true, Path, "invalid start cluster %u", Clus);
+		return false;
+	}
+	if (IsAlloc(Get(Clus)) == false)
+	{
+		Fault(true, Path, "start cluster %u free or bad", Clus);
+		return false;
+	}
+	if (vOwner[Clus] != 0 && vOwner[Clus] != FATIMG_OWN_TAIL)
+	{
+		Fault(true, Path, "start cluster %u cross-linked with %s", Clus, vPath[vOwner[Clus] - 1].c_str());
+		return false;
+	}
+
+	return true;
+}
+
+void FatCheck::PutEnt(uint64_t Off, const FATFS_DIR &Ent)
+{
+	if (vbRepair && WriteAt(vFd, Off, &Ent, sizeof(Ent)) == false)
+		vNbUnfixed++;
+}
+
+void FatCheck::DeleteEnt(uint64_t Off, FATFS_DIR &Ent)
+{
+	Ent.ShortName.Name[0] = FATFS_DIRENT_DELETED;
+	PutEnt(Off, Ent);
+}
+
+/**
+ * Check directory entries and the chains of their files, then subdirectories
+ */
+void FatCheck::ScanDir(uint32_t Id, uint32_t Clus, uint32_t ParentClus, int Depth)
+{
+	std::string dirpath = vPath[Id - 1];
+	std::vector<uint64_t> offs;
+	std::vector<FATFS_DIR> ents;
+	bool broot = Id == 1;
+
+	if (Clus == 0)
+	{
+		ents.resize(vRootEnt);
+		if (ReadAt(vFd, vRootOff, ents.data(), vRootEnt * sizeof(FATFS_DIR)) == false)
+		{
+			Fault(false, dirpath, "read error");
+			return;
+		}
+		for (uint32_t i = 0; i < vRootEnt; i++)
+			offs.push_back(vRootOff + i * sizeof(FATFS_DIR));
+	}
+	else
+	{
+		std::vector<uint32_t> chain;
+		uint32_t nent = vClusBytes / sizeof(FATFS_DIR);
+
+		Claim(Clus, Id, 0xFFFFFFFF, dirpath, &chain);
+		ents.resize(chain.size() * nent);
+		for (size_t i = 0; i < chain.size(); i++)
+		{
+			if (ReadAt(vFd, ClusOffset(chain[i]), &ents[i * nent], vClusBytes) == false)
+			{
+				Fault(false, dirpath, "read error");
+				return;
+			}
+			for (uint32_t j = 0; j < nent; j++)
+				offs.push_back(ClusOffset(chain[i]) + j * sizeof(FATFS_DIR));
+		}
+	}
+
+	if (ents.size() > FATFS_DIRENT_MAX)
+		Fault(false, dirpath, "more than %d entries", FATFS_DIRENT_MAX);
+
+	if (broot == false && (ents.size() < 2 || memcmp(ents[0].ShortName.Name, ".          ", 11) != 0 ||
+						   memcmp(ents[1].ShortName.Name, "..         ", 11) != 0))
+	{
+		Fault(false, dirpath, "missing dot entries");
+	}
+
+	std::vector<size_t> lfnents;	// Pending long name entries
+	std::vector<uint16_t> lfn;
+	uint8_t lfnord = 0, chksum = 0;
+	std::set<std::string> shorts;
+	std::vector<std::pair<uint32_t, uint32_t>> subdirs;
+
+	for (size_t i = 0; i < ents.size(); i++)
+	{
+		FATFS_DIR &d = ents[i];
+		uint8_t c0 = d.ShortName.Name[0];
+
+		if (c0 == 0)
+			break;
+
+		if (c0 != FATFS_DIRENT_DELETED && (d.ShortName.Attr & 0x3F) == FATFS_DIRATTR_LONG_NAME)
+		{
+			uint8_t *p = (uint8_t*)&d;
+			uint8_t ord = d.LongName.Ord & ~FATFS_DIRENT_LASTLONG;
+
+			if (d.LongName.Ord & FATFS_DIRENT_LASTLONG)
+			{
+				if (lfnents.size() > 0)
+				{
+					Fault(true, dirpath, "orphan long name entries");
+					for (size_t j : lfnents)
+						DeleteEnt(offs[j], ents[j]);
+				}
+				lfnents.clear();
+				lfn.assign(ord * FATIMG_LFN_CHARS, 0);
+				lfnord = ord;
+				chksum = d.LongName.Chksum;
+			}
+			if (ord == 0 || ord > 20 || ord != lfnord || d.LongName.Chksum != chksum)
+			{
+				lfnents.push_back(i);
+				Fault(true, dirpath, "orphan long name entries");
+				for (size_t j : lfnents)
+					DeleteEnt(offs[j], ents[j]);
+				lfnents.clear();
+				lfnord = 0;
+				continue;
+			}
+			for (int j = 0; j < FATIMG_LFN_CHARS; j++)
+				lfn[(ord - 1) * FATIMG_LFN_CHARS + j] = p[g_FatImgLfnOff[j]] | (p[g_FatImgLfnOff[j] + 1] << 8);
+			lfnents.push_back(i);
+			lfnord--;
+			continue;
+		}
+
+		bool haslfn = lfnents.size() > 0 && lfnord == 0 && c0 != FATFS_DIRENT_DELETED &&
+					  ShortNameChksum(d.ShortName.Name) == chksum;
+
+		if (lfnents.size() > 0 && haslfn == false)
+		{
+			Fault(true, dirpath, "orphan long name entries");
+			for (size_t j : lfnents)
+				DeleteEnt(offs[j], ents[j]);
+		}
+
+		std::vector<size_t> entlfn;
+
+		entlfn.swap(lfnents);
+		lfnord = 0;
+
+		if (c0 == FATFS_DIRENT_DELETED)
+			continue;
+
+		if (d.ShortName.Attr & FATFS_DIRATTR_VOLUME_ID)
+		{
+			if (broot == false || (d.ShortName.Attr & FATFS_DIRATTR_DIRECTORY))
+			{
+				Fault(true, dirpath, "misplaced volume label entry");
+				DeleteEnt(offs[i], d);
+			}
+			continue;
+		}
+
+		std::string name;
+
+		if (haslfn)
+		{
+			for (uint16_t c : lfn)
+			{
+				if (c == 0)
+					break;
+				name += c < 0x80 ? (char)c : '_';
+			}
+		}
+		else
+		{
+			FormatShortName(d.ShortName, name);
+		}
+
+		std::string path = (broot ? "" : dirpath) + "/" + name;
+		uint32_t first = (vFatType == 32 ? d.ShortName.FstClusHI << 16 : 0) | d.ShortName.FstClusLO;
+		bool bdir = d.ShortName.Attr & FATFS_DIRATTR_DIRECTORY;
+		bool bdot = memcmp(d.ShortName.Name, ".          ", 11) == 0;
+		bool bdotdot = memcmp(d.ShortName.Name, "..         ", 11) == 0;
+
+		if (bdot || bdotdot)
+		{
+			size_t idx = bdot ? 0 : 1;
+
+			if (broot || i != idx || bdir == false)
+			{
+				Fault(true, path, "misplaced dot entry");
+				DeleteEnt(offs[i], d);
+			}
+			else if (first != (bdot ? Clus : ParentClus) && (bdot || ParentClus != 0 || first != vRootClus))
+			{
+				uint32_t c = bdot ? Clus : ParentClus;
+
+				Fault(true, path, "points to cluster %u instead of %u", first, c);
+				d.ShortName.FstClusHI = vFatType == 32 ? c >> 16 : 0;
+				d.ShortName.FstClusLO = c & 0xFFFF;
+				PutEnt(offs[i], d);
+			}
+			continue;
+		}
+		for (int j = 0; j < 11; j++)
+		{
+			uint8_t c = d.ShortName.Name[j];
+
+			if ((c < 0x20 && (j > 0 || c != 0x05)) || strchr("\"*+,./:;<=>?[\\]|", c) != NULL)
+			{
+				Fault(false, path, "invalid short name");
+				break;
+			}
+		}
+
+		if (shorts.insert(std::string((char*)d.ShortName.Name, 11)).second == false)
+			Fault(false, path, "duplicate short name");
+
+		vPath.push_back(path);
+
+		uint32_t id = vPath.size();
+
+		if (bdir)
+		{
+			vNbDir++;
+
+			if (d.ShortName.FileSize != 0)
+			{
+				Fault(true, path, "directory with size %u", d.ShortName.FileSize);
+				d.ShortName.FileSize = 0;
+				PutEnt(offs[i], d);
+			}
+			if (Depth >= 128 || first == 0 || CheckStart(first, path) == false)
+			{
+				if (first == 0 || Depth >= 128)
+					Fault(true, path, first == 0 ? "directory without cluster" : "too deep");
+				for (size_t j : entlfn)
+					DeleteEnt(offs[j], ents[j]);
+				DeleteEnt(offs[i], d);
+				continue;
+			}
+
+			// Claim start now, siblings checked before subdirectories
+			vOwner[first] = id;
+			subdirs.push_back(std::make_pair(id, first));
+			continue;
+		}
+
+		vNbFile++;
+
+		uint32_t size = d.ShortName.FileSize;
+		uint32_t need = size / vClusBytes + (size % vClusBytes ? 1 : 0);
+		uint32_t len = 0;
+
+		if (first == 0)
+		{
+			if (size > 0)
+			{
+				Fault(true, path, "size %u without cluster", size);
+				d.ShortName.FileSize = 0;
+				PutEnt(offs[i], d);
+			}
+		}
+		else if (size == 0 || CheckStart(first, path) == false)
+		{
+			if (size == 0)
+				Fault(true, path, "size 0 with chain of %u clusters", MarkTail(first));
+			d.ShortName.FstClusHI = 0;
+			d.ShortName.FstClusLO = 0;
+			d.ShortName.FileSize = 0;
+			PutEnt(offs[i], d);
+		}
+		else
+		{
+			len = Claim(first, id, need, path, NULL);
+
+			if (len < need)
+			{
+				Fault(true, path, "size %u larger than chain of %u clusters", size, len);
+				d.ShortName.FileSize = len * vClusBytes;
+				PutEnt(offs[i], d);
+			}
+		}
+
+		if (vbVerbose)
+			printf("%s %u %u\n", path.c_str(), first, d.ShortName.FileSize);
+	}
+
+	for (auto &s : subdirs)
+	{
+		vOwner[s.second] = 0;
+		if (vbVerbose)
+			printf("%s/ %u\n", vPath[s.first - 1].c_str(), s.second);
+		ScanDir(s.first, s.second, broot ? 0 : Clus, Depth + 1);
+	}
+}
+
+/**
+ * Free clusters past file sizes and lost clusters, compare FAT copies
+ */
+void FatCheck::CheckFat()
+{
+	uint32_t tail = 0, lost = 0, chains = 0;
+	std::vector<bool> linked(vNbClus + 2, false);
+
+	for (uint32_t c = 2; c < vNbClus + 2; c++)
+	{
+		if (vOwner[c] == FATIMG_OWN_TAIL)
+		{
+			Set(c, 0);
+			tail++;
+		}
+		else if (vOwner[c] == 0 && IsAlloc(Get(c)) && IsValid(Get(c)))
+		{
+			linked[Get(c)] = true;
+		}
+	}
+
+	for (uint32_t c = 2; c < vNbClus + 2; c++)
+	{
+		if (vOwner[c] == 0 && IsAlloc(Get(c)))
+		{
+			lost++;
+			if (linked[c] == false)
+				chains++;
+			Set(c, 0);
+		}
+	}
+
+	if (lost > 0)
+		Fault(true, "/", "%u lost clusters in %u chains", lost, std::max(chains, 1U));
+
+	if (vbVerbose && tail > 0)
+		printf("%u clusters past file sizes\n", tail);
+
+	if ((Get(0) & 0xFF) != vBs.Media)
+	{
+		Fault(true, "/", "FAT media byte %02X, boot sector %02X", Get(0) & 0xFF, vBs.Media);
+		Set(0, 0x0FFFFF00 | vBs.Media);
+	}
+
+	std::vector<uint8_t> act((uint64_t)vFatSect * vSectSize), buf(act.size());
+	uint64_t diff = 0;
+
+	if (ReadAt(vFd, vFatOff + (uint64_t)vActiveFat * act.size(), act.data(), act.size()) == false)
+		return;
+
+	for (uint32_t i = 0; i < vNbFat; i++)
+	{
+		if (i == vActiveFat || ReadAt(vFd, vFatOff + (uint64_t)i * buf.size(), buf.data(), buf.size()) == false)
+			continue;
+
+		uint32_t esize = vFatType / 8;
+
+		for (uint32_t j = 0; j < vNbClus + 2; j++)
+		{
+			if (memcmp(&act[j * esize], &buf[j * esize], esize) != 0)
+				diff++;
+		}
+	}
+
+	if (diff > 0)
+	{
+		Fault(true, "/", "%llu FAT copy entries differ", (unsigned long long)diff);
+		if (vbRepair)
+			vbFatDirty = true;
+	}
+}
+
+void FatCheck::CheckFSInfo()
+{
+	if (vFatType != 32 || vBs.BPB.Bpb32.FSInfo == 0)
+		return;
+
+	uint32_t nfree = 0, nextfree = FATFS_FSINFO_UNKNOWN;
+
+	for (uint32_t c = 2; c < vNbClus + 2; c++)
+	{
+		if (Get(c) == 0)
+		{
+			nfree++;
+			if (nextfree == FATFS_FSINFO_UNKNOWN)
+				nextfree = c;
+		}
+	}
+
+	FATFS_FSINFO fsi;
+	uint64_t off = vVolOff + (uint64_t)vBs.BPB.Bpb32.FSInfo * vSectSize;
+
+	if (ReadAt(vFd, off, &fsi, sizeof(fsi)) == false)
+		return;
+
+	bool bad = false;
+
+	if (fsi.LeadSig != FATFS_FSINFO_LEADSIG || fsi.StrucSig != FATFS_FSINFO_STRUCSIG ||
+		fsi.TrailSig != 0xAA550000)
+	{
+		Fault(true, "/", "invalid FSInfo sector");
+		memset(&fsi, 0, sizeof(fsi));
+		bad = true;
+	}
+	else
+	{
+		if (fsi.Free_Count != FATFS_FSINFO_UNKNOWN && fsi.Free_Count != nfree)
+		{
+			Fault(true, "/", "FSInfo free count %u, %u free", fsi.Free_Count, nfree);
+			bad = true;
+		}
+		if (fsi.Nxt_Free != FATFS_FSINFO_UNKNOWN && IsValid(fsi.Nxt_Free) == false)
+		{
+			Fault(true, "/", "FSInfo next free %u invalid", fsi.Nxt_Free);
+			bad = true;
+		}
+	}
+
+	if (bad && vbRepair)
+	{
+		fsi.LeadSig = FATFS_FSINFO_LEADSIG;
+		fsi.StrucSig = FATFS_FSINFO_STRUCSIG;
+		fsi.TrailSig = 0xAA550000;
+		fsi.Free_Count = nfree;
+		fsi.Nxt_Free = nextfree;
+		if (WriteAt(vFd, off, &fsi, sizeof(fsi)) == false)
+			vNbUnfixed++;
+	}
+}
+
+bool FatCheck::WriteFat()
+{
+	std::vector<uint8_t> buf((uint64_t)vFatSect * vSectSize);
+
+	if (ReadAt(vFd, vFatOff + (uint64_t)vActiveFat * buf.size(), buf.data(), buf.size()) == false)
+		return false;
+
+	for (uint32_t i = 0; i < vNbClus + 2; i++)
+	{
+		if (vFatType == 32)
+		{
+			uint32_t v = vFatHi[i] | vFat[i];
+
+			memcpy(&buf[i * 4], &v, 4);
+		}
+		else
+		{
+			uint16_t v = vFat[i] >= FATIMG_RSVD ? 0xFFF0 | (vFat[i] & 0xF) : vFat[i];
+
+			memcpy(&buf[i * 2], &v, 2);
+		}
+	}
+
+	for (uint32_t i = 0; i < vNbFat; i++)
+	{
+		if (WriteAt(vFd, vFatOff + (uint64_t)i * buf.size(), buf.data(), buf.size()) == false)
+			return false;
+	}
+
+	return true;
+}
+
+int FatCheck::Run(const char *pImg, bool bRepair, bool bVerbose)
+{
+	struct stat st;
+
+	vbRepair = bRepair;
+	vbVerbose = bVerbose;
+	vbFatDirty = false;
+	vNbErr = vNbFixed = vNbUnfixed = 0;
+	vNbFile = vNbDir = vNbFrag = 0;
+
+	vFd = open(pImg, bRepair ? O_RDWR : O_RDONLY);
+	if (vFd < 0 || fstat(vFd, &st) != 0)
+	{
+		fprintf(stderr, "%s: %s\n", pImg, strerror(errno));
+		return EXIT_FAILED;
+	}
+	vSize = st.st_size;
+
+	if (Mount() == false)
+	{
+		close(vFd);
+		return EXIT_FAILED;
+	}
+
+	vOwner.assign(vNbClus + 2, 0);
+	vPath.clear();
+	vPath.push_back("/");
+
+	if (vFatType == 32)
+	{
+		if (IsValid(vRootClus) == false || IsAlloc(Get(vRootClus)) == false)
+		{
+			Fault(false, "/", "invalid root cluster %u", vRootClus);
+			close(vFd);
+			return EXIT_ERRORS;
+		}
+	}
+
+	ScanDir(1, vRootClus, 0, 0);
+	CheckFat();
+
+	if (vbFatDirty && WriteFat() == false)
+		vNbUnfixed++;
+
+	CheckFSInfo();
+
+	if (vFatType == 32 && vBs.BPB.Bpb32.BkBootSec != 0)
+	{
+		FATFS_BSBPB bk;
+		uint64_t off = vVolOff + (uint64_t)vBs.BPB.Bpb32.BkBootSec * vSectSize;
+
+		if (ReadAt(vFd, off, &bk, sizeof(bk)) && memcmp(&bk, &vBs, sizeof(bk)) != 0)
+		{
+			Fault(true, "/", "backup boot sector differs");
+			if (vbRepair && WriteAt(vFd, off, &vBs, sizeof(vBs)) == false)
+				vNbUnfixed++;
+		}
+	}
+
+	uint32_t used = 0;
+
+	for (uint32_t c = 2; c < vNbClus + 2; c++)
+	{
+		if (Get(c) != 0)
+			used++;
+	}
+
+	if (close(vFd) != 0)
+		vNbUnfixed++;
+
+	printf("%s: FAT%d, %u bytes per cluster, %u clusters, %u files, %u directories, "
+		   "%u used, %u free, %u fragmented\n", pImg, vFatType, vClusBytes, vNbClus, vNbFile,
+		   vNbDir, used, vNbClus - used, vNbFrag);
+
+	if (vNbErr == 0)
+		return EXIT_OK;
+
+	printf("%d errors, %d fixed\n", vNbErr, vNbFixed);
+
+	return vbRepair && vNbUnfixed == 0 ? EXIT_FIXED : EXIT_ERRORS;
+}
+
+int FatImgCheck(const char *pImg, bool bRepair, bool bVerbose)
+{
+	FatCheck chk;
+
+	return chk.Run(pImg, bRepair, bVerbose);
+}
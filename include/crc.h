@@ -42,6 +42,15 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
   * @{
   */
 
+/// crc16_ccitt lookup tables : 0 - none, 1 - one table (512 bytes),
+/// 4 or 8 - slice-by-N, N bytes per step (N x 512 bytes)
+#ifndef CRC16_CCITT_SLICE
+#define CRC16_CCITT_SLICE		1
+#endif
+
+// Define CRC16_CCITT_HW when the MCU port provides crc16_ccitt using its CRC
+// hardware.  The software version is then not compiled.
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -65,6 +65,28 @@ typedef enum __Device_Event {
 	DEV_EVT_DATA_RDY
 } DEV_EVT;
 
+#pragma pack(push, 4)
+
+/// @brief	Register shadow configuration.
+///
+/// Declares a block of consecutive 8 bits registers to keep a copy in RAM.  Register
+/// properties are given as bit maps, one bit per register starting at StartAddr
+/// (bit 0 of byte 0 is StartAddr).  This is normally a static const in the driver.
+typedef struct __Device_Register_Shadow_Config {
+	uint8_t StartAddr;			//!< Address of first shadowed register
+	uint8_t NbReg;				//!< Number of consecutive registers shadowed
+	bool bBurstWrite;			//!< true - device supports address auto increment on write,
+								//!< consecutive dirty registers are flushed in one transfer
+	const uint8_t *pWrMap;		//!< Writable register bit map. NULL - all writable
+	const uint8_t *pVolMap;		//!< Volatile register bit map, registers changed by hardware
+								//!< (status, data, self clearing). NULL - none volatile
+} DEVREGSHADOW_CFG;
+
+#pragma pack(pop)
+
+/// Size in bytes of memory required by the shadow of NbReg registers
+#define DEVREGSHADOW_MEMSIZE(NbReg)		((NbReg) + 2 * (((NbReg) + 7) >> 3))
+
 #ifdef __cplusplus
 
 class Device;
@@ -171,12 +193,17 @@ public:
 	/**
 	 * @brief	Read device's 8 bits register/memory
 	 *
+	 * Value comes from the register shadow if enabled and the register is not volatile.
+	 *
 	 * @param 	pRegAddr	: Buffer containing address location to read
 	 * @param	RegAddrLen	: Address buffer size
 	 *
 	 * @return	Data read
 	 */
 	virtual uint8_t Read8(uint8_t *pRegAddr, int RegAddrLen) {
+		int idx = RegShadowIdx(pRegAddr, RegAddrLen);
+		if (idx >= 0)
+			return ShadowRead8(idx, pRegAddr, RegAddrLen);
 		uint8_t val = 0;
 		Read(pRegAddr, RegAddrLen, &val, 1);
 		return val;
@@ -213,6 +240,8 @@ public:
 	/**
 	 * @brief	Write 8 bits data to device's register/memory
 	 *
+	 * If the register is shadowed and already holds Data, nothing is sent to the device.
+	 *
 	 * @param 	pRegAddr	: Buffer containing address location to write
 	 * @param	RegAddrLen	: Address buffer size
 	 * @param	Data		: Data to be written to the device
@@ -220,6 +249,9 @@ public:
 	 * @return	true - Success
 	 */
 	virtual bool Write8(uint8_t *pRegAddr, int RegAddrLen, uint8_t Data) {
+		int idx = RegShadowIdx(pRegAddr, RegAddrLen);
+		if (idx >= 0)
+			return ShadowWrite8(idx, pRegAddr, RegAddrLen, Data);
 		return Write(pRegAddr, RegAddrLen, &Data, 1) > 0;
 	}
 
@@ -249,6 +281,55 @@ public:
 		return Write(pRegAddr, RegAddrLen, (uint8_t*)&Data, 1) > 3;
 	}
 
+	/**
+	 * @brief	Update bits of an 8 bits register.
+	 *
+	 * Read-modify-write of the register.  When the register is shadowed, the current
+	 * value comes from RAM and the write is skipped if nothing changes.
+	 *
+	 * @param	pRegAddr	: Register address
+	 * @param	RegAddrLen	: Register address length
+	 * @param	Mask		: Bits to modify
+	 * @param	Data		: New value of the bits
+	 * @param	bDeferred	: true - only update the shadow, the register is written by RegShadowFlush.
+	 * 						  Ignored if register is not shadowed or volatile
+	 *
+	 * @return	true - Success
+	 */
+	virtual bool Update8(uint8_t *pRegAddr, int RegAddrLen, uint8_t Mask, uint8_t Data, bool bDeferred = false);
+
+	/**
+	 * @brief	Write all deferred register updates to the device.
+	 *
+	 * @return	true - Success
+	 */
+	bool RegShadowFlush();
+
+	/**
+	 * @brief	Reload shadow from the device.
+	 *
+	 * Reads all non volatile shadowed registers using burst reads.  Pending deferred
+	 * updates are discarded.
+	 *
+	 * @return	true - Success
+	 */
+	bool RegShadowSync();
+
+	/**
+	 * @brief	Invalidate shadow.
+	 *
+	 * Must be called after a device reset.  Registers are reloaded on next access.
+	 * Pending deferred updates are discarded.
+	 */
+	void RegShadowInvalidate();
+
+	/**
+	 * @brief	Check if register shadow is in use
+	 *
+	 * @return	true - Device keeps a register shadow
+	 */
+	bool RegShadowEnabled() { return vpRegShadowCfg != NULL; }
+
 	/**
 	 * @brief	Return availability of the device
 	 *
@@ -304,6 +385,57 @@ protected:
 	 */
 	DeviceIntrf *Interface() { return vpIntrf; }
 
+	/**
+	 * @brief	Enable register shadow.
+	 *
+	 * Once enabled, Read8/Write8/Update8 of shadowed registers are served from RAM
+	 * when possible.  Block writes with Write update the shadow.  Read bypasses the
+	 * shadow.
+	 *
+	 * @param	pCfg	: Shadow configuration, must stay valid while in use
+	 * @param	pMem	: Shadow memory of DEVREGSHADOW_MEMSIZE(pCfg->NbReg) bytes
+	 *
+	 * @return	true - Success
+	 */
+	bool RegShadowInit(const DEVREGSHADOW_CFG * const pCfg, uint8_t * const pMem);
+
+	/**
+	 * @brief	Get shadow index of register
+	 *
+	 * @return	Index in shadow, -1 - not shadowed
+	 */
+	int RegShadowIdx(uint8_t *pRegAddr, int RegAddrLen) {
+		if (vpRegShadowCfg == NULL || RegAddrLen != 1)
+			return -1;
+		// Strip SPI read bit which Read may have left in the address
+		int idx = (int)(InterfaceType() == DEVINTRF_TYPE_SPI ? *pRegAddr & 0x7F : *pRegAddr) - vpRegShadowCfg->StartAddr;
+		return idx >= 0 && idx < vpRegShadowCfg->NbReg ? idx : -1;
+	}
+
+	/**
+	 * @brief	Force a shadowed register to be written.
+	 *
+	 * For registers whose side effect is needed even if the value is unchanged.
+	 * The register is written on next RegShadowFlush, Write8 or Update8.
+	 *
+	 * @param	pRegAddr	: Register address
+	 * @param	RegAddrLen	: Register address length
+	 */
+	void RegShadowMarkDirty(uint8_t *pRegAddr, int RegAddrLen);
+
+	/**
+	 * @brief	Update shadow with data written to consecutive registers.
+	 *
+	 * @param	pRegAddr	: Address of first register written
+	 * @param	RegAddrLen	: Register address length
+	 * @param	pData		: Data written
+	 * @param	Len			: Number of registers written
+	 */
+	void RegShadowStore(uint8_t *pRegAddr, int RegAddrLen, uint8_t *pData, int Len);
+
+	uint8_t ShadowRead8(int Idx, uint8_t *pRegAddr, int RegAddrLen);
+	bool ShadowWrite8(int Idx, uint8_t *pRegAddr, int RegAddrLen, uint8_t Data);
+
 	bool		vbValid;		//!< Device is valid ready to use (passed detection)
 	uint32_t 	vDevAddr;		//!< Device address or chip select index
 	DeviceIntrf *vpIntrf;		//!< Device's interface
@@ -311,6 +443,10 @@ protected:
 	uint64_t	vDevId;			//!< This is implementation specific data for device identifier
 	 	 	 	 	 	 	 	//!< could be value read from hardware register or serial number
 	DEVEVTCB 	vEvtHandler;	//!< Event handler callback
+	const DEVREGSHADOW_CFG *vpRegShadowCfg;	//!< Register shadow config, NULL - shadow not used
+	uint8_t		*vpRegShadow;	//!< Shadowed register values
+	uint8_t		*vpRegValid;	//!< Bit map of shadow values valid
+	uint8_t		*vpRegDirty;	//!< Bit map of deferred updates to write
 };
 
 extern "C" {
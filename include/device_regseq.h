@@ -0,0 +1,244 @@
+/**-------------------------------------------------------------------------
+@file	device_regseq.h
+
+@brief	Device register sequence executor
+
+Driver initialization and sampling are mostly fixed chains of register writes,
+read-modify-writes, reads, polls and delays.  A register sequence describes such
+a chain as a table of DEVREGSEQ entries terminated by DEVREGSEQ_END().
+
+The executor runs a sequence on a Device using its Read/Write functions, so
+driver specific address handling (register bank, SPI page, register shadow)
+still applies.  Adjacent writes are merged into a single bus transfer :
+
+	- Burst mode : writes to consecutive registers become one block write, for
+	  devices with address auto increment.
+	- Pair mode : any writes become one transfer of register/data pairs, for
+	  devices such as the Bosch BMExxx that do not auto increment on write.
+
+A sequence can run blocking or from a timer.  In timer mode, the executor
+returns at each delay or unsatisfied poll and resumes from a single shot timer
+trigger.  Completion is reported by callback.
+
+Example :
+
+	static const DEVREGSEQ s_InitSeq[] = {
+		DEVREGSEQ_WRITE(REG_PWR, PWR_RESET),
+		DEVREGSEQ_POLL(REG_PWR, PWR_RESET, 0, 100000),
+		DEVREGSEQ_WRITE(REG_CFG1, 0x12),	// Merged with next write
+		DEVREGSEQ_WRITE(REG_CFG2, 0x34),
+		DEVREGSEQ_UPDATE(REG_INT, INT_EN_MASK, INT_EN_DRDY),
+		DEVREGSEQ_READ(REG_CALIB, 16, 0),
+		DEVREGSEQ_END()
+	};
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __DEVICE_REGSEQ_H__
+#define __DEVICE_REGSEQ_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+
+#include "coredev/timer.h"
+#include "device.h"
+
+/// Max number of bytes merged in a single write transfer
+#define DEVREGSEQ_XFER_MAX			32
+
+/// Default poll interval in usec
+#define DEVREGSEQ_POLL_INTERVAL		1000
+
+/// @brief	Register sequence operations.
+typedef enum __Dev_Reg_Seq_Op {
+	DEVREGSEQ_OP_END,			//!< End of sequence
+	DEVREGSEQ_OP_WRITE,			//!< Write Val to Reg
+	DEVREGSEQ_OP_UPDATE,		//!< Read-modify-write, bits of Reg selected by Mask are set to Val
+	DEVREGSEQ_OP_READ,			//!< Read Mask number of bytes from Reg into read buffer at offset Param
+	DEVREGSEQ_OP_POLL,			//!< Poll Reg until (Reg & Mask) == Val, Param is the timeout in usec
+	DEVREGSEQ_OP_DELAY,			//!< Wait Param usec
+} DEVREGSEQ_OP;
+
+/// @brief	Write merging mode.
+typedef enum __Dev_Reg_Seq_Write_Mode {
+	DEVREGSEQ_WRMODE_SINGLE,	//!< No merging, one transfer per write
+	DEVREGSEQ_WRMODE_BURST,		//!< Writes to consecutive registers are merged in a block write
+	DEVREGSEQ_WRMODE_PAIR,		//!< Writes are merged in a transfer of register/data pairs
+} DEVREGSEQ_WRMODE;
+
+#pragma pack(push, 4)
+
+/// @brief	Register sequence entry.
+///
+/// Use the DEVREGSEQ_xxx() macros to fill sequence tables.
+typedef struct __Dev_Reg_Seq {
+	uint16_t Reg;		//!< Register address. With 2 bytes address, high byte is the bank/page
+	uint8_t Op;			//!< Operation DEVREGSEQ_OP
+	uint8_t Val;		//!< Value to write or poll for
+	uint8_t Mask;		//!< Bit mask for update & poll, byte count for read
+	uint32_t Param;		//!< Delay & poll timeout in usec, read buffer offset
+} DEVREGSEQ;
+
+#pragma pack(pop)
+
+#define DEVREGSEQ_WRITE(Reg, Val)				{ (uint16_t)(Reg), DEVREGSEQ_OP_WRITE, (uint8_t)(Val), 0xFF, 0 }
+#define DEVREGSEQ_UPDATE(Reg, Mask, Val)		{ (uint16_t)(Reg), DEVREGSEQ_OP_UPDATE, (uint8_t)(Val), (uint8_t)(Mask), 0 }
+#define DEVREGSEQ_READ(Reg, Len, Offset)		{ (uint16_t)(Reg), DEVREGSEQ_OP_READ, 0, (uint8_t)(Len), (uint32_t)(Offset) }
+#define DEVREGSEQ_POLL(Reg, Mask, Val, usTimeout)	{ (uint16_t)(Reg), DEVREGSEQ_OP_POLL, (uint8_t)(Val), (uint8_t)(Mask), (uint32_t)(usTimeout) }
+#define DEVREGSEQ_DELAY(usDelay)				{ 0, DEVREGSEQ_OP_DELAY, 0, 0, (uint32_t)(usDelay) }
+#define DEVREGSEQ_END()							{ 0, DEVREGSEQ_OP_END, 0, 0, 0 }
+
+#ifdef __cplusplus
+
+class DevRegSeq;
+
+/**
+ * @brief	Sequence completion callback
+ *
+ * @param	pSeq	: Pointer to executor
+ * @param	bSuccess: true - sequence completed, false - failed (transfer error or poll timeout)
+ * @param	pCtx	: User context passed to Start
+ */
+typedef void (*DEVREGSEQ_DONECB)(DevRegSeq * const pSeq, bool bSuccess, void * const pCtx);
+
+#pragma pack(push, 4)
+
+/// @brief	Register sequence executor configuration
+typedef struct __Dev_Reg_Seq_Config {
+	uint8_t AddrLen;			//!< Register address length 1 or 2 bytes
+	DEVREGSEQ_WRMODE WrMode;	//!< Write merging mode
+	uint8_t PairAddrMask;		//!< Pair mode : mask of register address bits sent in the transfer.
+								//!< Registers differing in other bits are not merged (ex. SPI page bit)
+	uint32_t PollInterval;		//!< Poll interval in usec, 0 - DEVREGSEQ_POLL_INTERVAL
+	int TimerTrigNo;			//!< Timer trigger to use when running from a timer
+} DEVREGSEQ_CFG;
+
+#pragma pack(pop)
+
+/// @brief	Register sequence executor.
+///
+/// A lightweight object, drivers can keep one on the stack for blocking runs or as member
+/// for timer runs.
+class DevRegSeq {
+public:
+	DevRegSeq();
+
+	/**
+	 * @brief	Initialize executor for a device
+	 *
+	 * @param	Cfg		: Executor configuration
+	 * @param	pDev	: Device on which sequences are executed
+	 *
+	 * @return	true - Success
+	 */
+	bool Init(const DEVREGSEQ_CFG &Cfg, Device * const pDev);
+
+	/**
+	 * @brief	Run a sequence blocking
+	 *
+	 * @param	pSeq	: Sequence to run
+	 * @param	pRdBuff	: Buffer receiving data of read operations. Can be NULL if none
+	 *
+	 * @return	true - Success
+	 * 			false - transfer error or poll timeout
+	 */
+	bool Run(const DEVREGSEQ *pSeq, uint8_t *pRdBuff = NULL);
+
+	/**
+	 * @brief	Start a sequence driven by timer
+	 *
+	 * Operations are executed until the first delay or unsatisfied poll.  The sequence is then
+	 * resumed from a single shot timer trigger.  The sequence table and read buffer must stay
+	 * valid until completion.
+	 *
+	 * @param	pSeq	: Sequence to run
+	 * @param	pRdBuff	: Buffer receiving data of read operations. Can be NULL if none
+	 * @param	pTimer	: Timer to use
+	 * @param	DoneCB	: Completion callback.  Can be called from Start if there is nothing to wait.
+	 * @param	pCtx	: User context passed to the callback
+	 *
+	 * @return	true - Sequence started
+	 */
+	bool Start(const DEVREGSEQ *pSeq, uint8_t *pRdBuff, Timer * const pTimer,
+			   DEVREGSEQ_DONECB DoneCB, void * const pCtx = NULL);
+
+	/**
+	 * @brief	Resume a started sequence
+	 *
+	 * Called by the timer trigger.  It can also be called from other completion events
+	 * to resume early, a pending poll is then checked again.
+	 */
+	void Resume();
+
+	/**
+	 * @brief	Abort running sequence
+	 *
+	 * Completion callback is not called
+	 */
+	void Abort();
+
+	/**
+	 * @brief	Check if a sequence is running
+	 *
+	 * @return	true - Sequence in progress
+	 */
+	bool Busy() { return vpSeq != NULL; }
+
+private:
+	int32_t Step();
+	int WriteMerged(const DEVREGSEQ *pOp);
+	void Done(bool bSuccess);
+	void SetAddr(uint8_t *pAddr, uint16_t Reg) { pAddr[0] = Reg & 0xFF; pAddr[1] = Reg >> 8; }
+
+	static void TimerHandler(Timer * const pTimer, int TrigNo, void * const pCtx);
+
+	DEVREGSEQ_CFG vCfg;			//!< Executor configuration
+	Device *vpDev;				//!< Target device
+	const DEVREGSEQ *vpSeq;		//!< Running sequence, NULL - idle
+	uint8_t *vpRdBuff;			//!< Read operations data buffer
+	int vIdx;					//!< Index of current operation
+	uint32_t vPollTime;			//!< Time spent in current poll in usec
+	Timer *vpTimer;				//!< Timer driving the sequence, NULL - blocking
+	DEVREGSEQ_DONECB vDoneCB;	//!< Completion callback
+	void *vpDoneCtx;			//!< Completion callback context
+};
+
+extern "C" {
+#endif	// __cplusplus
+
+#ifdef __cplusplus
+}
+
+#endif	// __cplusplus
+
+#endif	// __DEVICE_REGSEQ_H__
+
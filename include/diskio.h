@@ -40,10 +40,16 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
   * @{
   */
 
-#define DISKIO_SECT_SIZE		    512     //!< Disk sector size in bytes
+#define DISKIO_SECT_SIZE		    512     //!< Default disk sector size in bytes
 #define DISKIO_CACHE_SECT_MAX	    1       //!< Max number of cache sector
-#define DISKIO_CACHE_DIRTY_BIT      (1<<31) //!< This bit is set in the UseCnt if there was
-                                            //!< write to the cache
+#define DISKIO_CACHE_WAYS_DEF		4		//!< Default number of cache sectors per set
+#define DISKIO_CACHE_BYPASS_MIN		2		//!< Min number of aligned sectors transferred
+											//!< directly to device, bypassing cache
+#define DISKIO_SEQ_DETECT_CNT		2		//!< Number of consecutive sequential misses
+											//!< starting read ahead
+
+#define DISKIO_CACHE_FLAG_DIRTY		(1<<0)	//!< Cache was written, must be flushed to disk
+#define DISKIO_CACHE_FLAG_PINNED	(1<<1)	//!< Cache sector is never evicted
 
 #pragma pack(push, 1)
 typedef struct __DiskPartition {
@@ -68,9 +74,11 @@ typedef struct __MasterBootRecord {
 
 /// DiskIO cache descriptor
 typedef struct __DiskIO_Cache_Desc {
-	volatile int UseCnt;	//!< semaphore
+	volatile int UseCnt;	//!< semaphore, number of users holding this cache
 	uint32_t    SectNo;		//!< sector number of this cache
 	uint8_t		*pSectData;	//!< Pointer to sector cache memory. Must be at least 1 sector size
+	uint32_t	LastUse;	//!< Access stamp, for LRU replacement
+	uint32_t	Flags;		//!< Cache state flags DISKIO_CACHE_FLAG_...
 } DISKIO_CACHE_DESC;
 
 #pragma pack(pop)
@@ -85,6 +93,10 @@ public:
 	/**
 	 * @brief	Get the size of one sector.
 	 *
+	 * Devices using another logical sector size override this.  Cache sector
+	 * memory and stream buffer must be sized to match.  Sectors larger than
+	 * DISKIO_SECT_SIZE require a sector cache for partial sector access.
+	 *
 	 * @return	Sector size in bytes.
 	 */
 	virtual int GetSectSize(void) { return DISKIO_SECT_SIZE; }
@@ -129,6 +141,34 @@ public:
 	 */
 	virtual bool SectWrite(uint32_t SectNo, uint8_t *pData) = 0;
 
+	/**
+	 * @brief	Read consecutive sectors from physical device.
+	 *
+	 * Default implementation calls SectRead for each sector.  Devices supporting
+	 * burst transfer should override it.
+	 *
+	 * @param	SectNo	: Start sector number
+	 * @param	pBuff	: Buffer to receive sector data. Must be at least NbSect sectors
+	 * @param	NbSect	: Number of sectors to read
+	 *
+	 * @return	Number of sectors read
+	 */
+	virtual int SectReadMulti(uint32_t SectNo, uint8_t *pBuff, int NbSect);
+
+	/**
+	 * @brief	Write consecutive sectors to physical device.
+	 *
+	 * Default implementation calls SectWrite for each sector.  Devices supporting
+	 * burst transfer should override it.
+	 *
+	 * @param	SectNo	: Start sector number
+	 * @param	pData	: Sector data to write. Must be at least NbSect sectors
+	 * @param	NbSect	: Number of sectors to write
+	 *
+	 * @return	Number of sectors written
+	 */
+	virtual int SectWriteMulti(uint32_t SectNo, uint8_t *pData, int NbSect);
+
 	/**
 	 * @brief	Reset DiskIO to its default state
 	 */
@@ -137,7 +177,9 @@ public:
 	/**
 	 * Optional implementations.  The following Read/Write functions are
 	 * implemented in with sector caching. Physical SectRead/SectWrite are
-	 * called internally to flush cache as needed.
+	 * called internally to flush cache as needed.  Byte offset Read/Write
+	 * transfer runs of at least DISKIO_CACHE_BYPASS_MIN aligned sectors directly
+	 * with SectReadMulti/SectWriteMulti, cached copies are kept coherent.
 	 *
 	 */
 	virtual int Read(uint32_t SetNo, uint32_t SectOffset, uint8_t *pBuff, uint32_t Len);
@@ -150,16 +192,118 @@ public:
 	 */
 	virtual void Erase() {}
 
-	int	GetCacheSect(uint32_t SectNo, bool bLock = false);
-	void SetCache(DISKIO_CACHE_DESC * const pCacheBlk, int NbCacheBlk);
+	/**
+	 * @brief	Get cache sector
+	 *
+	 * Look up the sector in its cache set.  If not cached, the least recently used
+	 * cache sector of the set is flushed if dirty then filled with the requested sector.
+	 * The returned cache sector is held (UseCnt incremented) and must be released by
+	 * the caller by decrementing its UseCnt.
+	 *
+	 * @param	SectNo	: Sector number
+	 * @param	bLock	: true - Sector is acquired for writing, it does not trigger read ahead
+	 * @param	bFill	: false - Sector is not read from device if not cached, caller
+	 * 					  overwrites the whole sector
+	 *
+	 * @return	Cache index, -1 if no cache sector available
+	 */
+	int	GetCacheSect(uint32_t SectNo, bool bLock = false, bool bFill = true);
+
+	/**
+	 * @brief	Set sector cache memory
+	 *
+	 * Cache sectors are grouped in sets of NbWays sectors.  A sector can only be
+	 * cached in the set selected by its sector number, lookup only scans that set.
+	 *
+	 * @param	pCacheBlk	: Array of cache descriptor
+	 * @param	NbCacheBlk	: Number of cache descriptor
+	 * @param	NbWays		: Number of cache sectors per set.  0 or NbCacheBlk for
+	 * 						  fully associative cache.
+	 */
+	void SetCache(DISKIO_CACHE_DESC * const pCacheBlk, int NbCacheBlk, int NbWays = DISKIO_CACHE_WAYS_DEF);
+
+	/**
+	 * @brief	Pin sector in cache
+	 *
+	 * Pinned sectors are kept in cache, used for frequently accessed metadata such
+	 * as FAT or directory sectors.  At least one sector per set is left unpinned,
+	 * so pinning always fails on a direct mapped cache (NbWays = 1) or a single
+	 * sector cache.  The pin is then only a hint, the sector is cached as usual.
+	 *
+	 * @param	SectNo	: Sector number
+	 * @param	bPin	: true - pin, false - unpin
+	 *
+	 * @return	true - Success
+	 */
+	bool PinCacheSect(uint32_t SectNo, bool bPin);
+
+	/**
+	 * @brief	Set stream buffer for read ahead and write back coalescing
+	 *
+	 * When sequential cache misses are detected, the next sectors are prefetched into
+	 * this buffer with one SectReadMulti.  Dirty cache sectors that are contiguous on
+	 * disk are gathered in this buffer and written with one SectWriteMulti.  Requires a
+	 * sector cache.
+	 *
+	 * @param	pBuff	: Contiguous buffer of NbSect sectors, NULL to disable
+	 * @param	NbSect	: Buffer size in number of sectors
+	 */
+	void SetStreamBuffer(uint8_t * const pBuff, int NbSect);
+
+	/**
+	 * @brief	Write all dirty cache sectors to disk.
+	 *
+	 * Sectors are written in increasing sector order, contiguous ones are coalesced
+	 * when a stream buffer is set.
+	 */
 	void Flush();
 
+	/**
+	 * @brief	Read sectors from device directly to caller buffer, bypassing cache.
+	 *
+	 * Dirty cached sectors are newer than the device and are copied over the
+	 * data read.
+	 *
+	 * @param	SectNo	: Start sector number
+	 * @param	pBuff	: Buffer to receive data, NbSect sectors
+	 * @param	NbSect	: Number of sectors to read
+	 *
+	 * @return	Number of sectors read
+	 */
+	int ReadDirect(uint32_t SectNo, uint8_t *pBuff, int NbSect);
+
+	/**
+	 * @brief	Write sectors from caller buffer directly to device, bypassing cache.
+	 *
+	 * Cached copies of the sectors are updated and marked clean.
+	 *
+	 * @param	SectNo	: Start sector number
+	 * @param	pData	: Data to write, NbSect sectors
+	 * @param	NbSect	: Number of sectors to write
+	 *
+	 * @return	Number of sectors written
+	 */
+	int WriteDirect(uint32_t SectNo, uint8_t *pData, int NbSect);
+
 protected:
 
 private:
-	int vLastIdx;	    //!< Last cache sector accessed
+	int FindCacheSect(uint32_t SectNo);
+	bool FillCacheSect(DISKIO_CACHE_DESC * const pCache, uint32_t SectNo, bool bWrite);
+	bool WriteBack(int Idx);
+	void StreamInvalidate(uint32_t SectNo, int NbSect);
+
 	int vNbCache;       //!< Number of cache sector
+	int vNbWays;		//!< Number of cache sectors per set
+	int vNbSets;		//!< Number of cache sets
+	uint32_t vCacheStamp;	//!< Access counter, for LRU
 	DISKIO_CACHE_DESC *vpCacheSect;	//!< pointer to static disk cache
+	uint8_t *vpStrmBuff;	//!< Stream buffer, read ahead and write back
+	int vStrmSize;			//!< Stream buffer size in sectors
+	int vStrmCnt;			//!< Number of valid read ahead sectors in stream buffer
+	uint32_t vStrmSect;		//!< First sector in stream buffer
+	uint32_t vLastMiss;		//!< Last missed sector, for sequential detection
+	int vSeqCnt;			//!< Number of consecutive sequential misses
 };
 
 extern "C" {
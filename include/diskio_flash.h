@@ -9,8 +9,38 @@ Make sure that the Flash is configure for MSB mode
 This implementation works with most Flash devices.  There is no need to implement
 for each device, just fill the config data struct and pass it to init function
 
+Devices supporting JEDEC SFDP (JESD216) are discovered at Init.  Config fields
+left to 0 are filled from the SFDP table, non zero fields override it.  Fast
+read, erase command and timings are always taken from SFDP when available.
+
+Dual and quad reads are used when the interface has more data lines wired
+(NbDataLines) and provides pSetLinesCB to switch the number of lines between
+the command, address and data phases.  Quad page program needs QuadProgCmd.
+The quad enable bit of the device, if any, must be set by pInitCB.
+
+Programming is pipelined : the status is polled at a fraction of the typical
+operation time and a call returns as soon as the last page program is
+started.  EraseBlock waits for the erase to complete.  ProgramStart and
+EraseStart never wait, so the caller can prepare the next page or do other
+work while the device is busy, IsBusy tells when it is done.  When the device
+supports erase suspend, a read outside of the block being erased suspends
+the erase instead of waiting for it to complete.
+
 Example of defining Flash device info :
 
+-----
+Any SFDP capable device :
+
+static const FLASHDISKIO_CFG s_FlashDiskCfg = {
+    0,
+    0,							// Size, erase size, page size and
+    0,							// address size are read from SFDP
+    0,
+    0,
+    NULL,
+    NULL
+};
+
 -----
 MX25R1635F :
 
@@ -153,6 +183,15 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define FLASH_CMD_WRSR              0x01    //!< Write Register (Status 1, Configuration 1)
 #define FLASH_CMD_WRITE             0x2
 #define FLASH_CMD_READ              0x3
+#define FLASH_CMD_FAST_READ         0x0B    //!< Fast read, 8 dummy clocks
+#define FLASH_CMD_READ_SFDP         0x5A    //!< Read SFDP, 3 bytes address, 8 dummy clocks
+#define FLASH_CMD_DUAL_READ         0x3B    //!< Dual output read (1-1-2)
+#define FLASH_CMD_DUAL_IO_READ      0xBB    //!< Dual I/O read (1-2-2)
+#define FLASH_CMD_QUAD_READ         0x6B    //!< Quad output read (1-1-4)
+#define FLASH_CMD_QUAD_IO_READ      0xEB    //!< Quad I/O read (1-4-4)
+#define FLASH_CMD_QUAD_WRITE        0x32    //!< Quad page program (1-1-4)
+#define FLASH_CMD_ERASE_SUSPEND     0x75    //!< Most common erase suspend opcode
+#define FLASH_CMD_ERASE_RESUME      0x7A    //!< Most common erase resume opcode
 #define FLASH_CMD_WRDISABLE         0x4
 #define FLASH_CMD_READSTATUS        0x5
 #define FLASH_CMD_WRENABLE          0x6
@@ -166,6 +205,51 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define FLASH_STATUS_WIP            (1<<0)  // Write In Progress
 
+#define FLASH_ERASE_TIMEOUT_MULT    16          //!< Block erase timeout in multiple of typical erase time
+#define FLASH_ERASE_TIMEOUT_DEF     4000000     //!< Block erase timeout in usec when erase time unknown
+
+#define FLASH_SFDP_SIGNATURE        0x50444653  //!< 'SFDP'
+#define FLASH_SFDP_BFPT_ID          0xFF00      //!< Basic Flash Parameter Table ID
+#define FLASH_SFDP_BFPT_MAXDW       16          //!< Number of BFPT DWORDs used
+
+#define FLASH_ERASE_TYPE_MAX        4
+
+/// Read modes, number of lines used for command, address and data
+typedef enum __Flash_Read_Mode {
+    FLASH_READMODE_1_1_1,       //!< Fast read
+    FLASH_READMODE_1_1_2,       //!< Dual output
+    FLASH_READMODE_1_2_2,       //!< Dual I/O
+    FLASH_READMODE_1_1_4,       //!< Quad output
+    FLASH_READMODE_1_4_4,       //!< Quad I/O
+    FLASH_READMODE_MAX
+} FLASH_READMODE;
+
+typedef struct __Flash_Read_Cmd {
+    uint8_t Cmd;                //!< Read opcode, 0 if mode not supported
+    uint8_t DummyClk;           //!< Dummy clocks, including mode clocks
+} FLASH_READCMD;
+
+typedef struct __Flash_Erase_Type {
+    uint32_t Size;              //!< Erase size in bytes, 0 if not supported
+    uint32_t TypTime;           //!< Typical erase time in usec, 0 if unknown
+    uint8_t Cmd;                //!< Erase opcode
+} FLASH_ERASETYPE;
+
+/// Device parameters from SFDP Basic Flash Parameter Table
+typedef struct __Flash_Sfdp {
+    uint64_t TotalSize;         //!< Density in bytes
+    uint32_t PageSize;          //!< Program page size in bytes
+    int AddrSize;               //!< 3 or 4 bytes address
+    uint32_t ProgTime;          //!< Typical page program time in usec, 0 if unknown
+    uint32_t ChipEraseTime;     //!< Typical chip erase time in msec, 0 if unknown
+    uint8_t Enter4B;            //!< Methods to enter 4 bytes address mode (BFPT DWORD16 bits 31:24)
+    uint8_t EraseSuspend;       //!< Erase suspend opcode, 0 if not supported
+    uint8_t EraseResume;        //!< Erase resume opcode
+    uint32_t SuspendTime;       //!< Max erase suspend latency in usec
+    FLASH_ERASETYPE Erase[FLASH_ERASE_TYPE_MAX];
+    FLASH_READCMD Read[FLASH_READMODE_MAX];
+} FLASH_SFDP;
+
 /**
  * @brief FlashDiskIO callback function.
  *
@@ -179,16 +263,38 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 typedef bool (*FLASHDISKIOCB)(int DevNo, DeviceIntrf * const pInterf);
 
+/**
+ * @brief FlashDiskIO interface line switching callback.
+ *
+ * Called within a transfer to set the number of data lines used for the
+ * following bytes.  The opcode is always sent on a single line.  Called with
+ * 1 after the transfer completes.
+ *
+ * @param   DevNo 	: Device number or address used by the interface
+ * @param   pInterf : Interface used to access the flash
+ * @param   NbLines : Number of data lines 1, 2 or 4
+ *
+ * @return  true - Success\n
+ *          false - Failed.
+ */
+typedef bool (*FLASHDISKIOLINECB)(int DevNo, DeviceIntrf * const pInterf, int NbLines);
+
 typedef struct {
     int         DevNo;          //!< Device number or address for interface use
-    uint64_t    TotalSize;      //!< Total Flash size in bytes
-    uint32_t    EraseSize;      //!< Min erasable block size in byte
-    uint32_t    WriteSize;      //!< Writable page size in bytes
-    int         AddrSize;       //!< Address size in bytes
+    uint64_t    TotalSize;      //!< Total Flash size in bytes. 0 - from SFDP
+    uint32_t    EraseSize;      //!< Min erasable block size in byte. 0 - smallest from SFDP
+    uint32_t    WriteSize;      //!< Writable page size in bytes. 0 - from SFDP
+    int         AddrSize;       //!< Address size in bytes. 0 - from SFDP
     FLASHDISKIOCB pInitCB; 		//!< For custom initialization. Set to NULL if not used
     FLASHDISKIOCB pWaitCB;		//!< If provided, this is called when there are
     							//!< long delays, such as mass erase, to allow application
     							//!< to perform other tasks while waiting
+    uint32_t	SectSize;		//!< Logical sector size in bytes, multiple of WriteSize.
+    							//!< 0 for default DISKIO_SECT_SIZE
+    int         NbDataLines;    //!< Data lines wired for dual/quad transfers 1, 2 or 4. 0 - single
+    FLASHDISKIOLINECB pSetLinesCB;	//!< Switch interface lines, required when NbDataLines > 1
+    uint8_t     QuadProgCmd;    //!< Quad page program opcode (1-1-4) ex. FLASH_CMD_QUAD_WRITE.
+    							//!< 0 - single line program
 } FLASHDISKIO_CFG;
 
 
@@ -224,6 +330,13 @@ public:
      */
     virtual uint64_t GetSize(void) { return vTotalSize; }
 
+    /**
+     * @brief	Get logical sector size.
+     *
+     * @return	Sector size in bytes
+     */
+    virtual int GetSectSize(void) { return vSectSize; }
+
     /**
 	 * @brief	Device specific minimum erasable block size in bytes.
 	 *
@@ -249,10 +362,18 @@ public:
 	/**
 	 * @brief	Erase Flash block.
 	 *
+	 * The erase command is selected from the configured EraseSize : 4KB sector
+	 * erase, 32KB or 64KB block erase.  Returns once the last block erase is
+	 * completed, use EraseStart to erase without waiting.
+	 *
 	 * @param	BlkNo	: Starting block number to erase.
 	 * @param	NbBlk	: Number of consecutive blocks to erase
+	 *
+	 * @return
+	 * 			- true	: Success
+	 * 			- false	: Device stayed busy past the erase timeout
 	 */
-	virtual void EraseBlock(uint32_t BlkNo, int NbBlk);
+	virtual bool EraseBlock(uint32_t BlkNo, int NbBlk);
 
 	/**
      * @brief	Read one sector from physical device.
@@ -280,6 +401,121 @@ public:
      */
     virtual bool SectWrite(uint32_t SectNo, uint8_t *pData);
 
+    /**
+     * @brief	Read consecutive sectors with one continuous read command
+     *
+     * @param	SectNo	: Start sector number
+     * @param	pBuff	: Pointer to buffer to receive sector data. Must be at least
+     * 					  NbSect sectors
+     * @param	NbSect	: Number of sectors to read
+     *
+     * @return	Number of sectors read
+     */
+    virtual int SectReadMulti(uint32_t SectNo, uint8_t *pBuff, int NbSect);
+
+    /**
+     * @brief	Write consecutive sectors, programming full pages
+     *
+     * @param	SectNo	: Start sector number
+     * @param	pData	: Pointer to sector data to write. Must be at least
+     * 					  NbSect sectors
+     * @param	NbSect	: Number of sectors to write
+     *
+     * @return	Number of sectors written
+     */
+    virtual int SectWriteMulti(uint32_t SectNo, uint8_t *pData, int NbSect);
+
+    /**
+     * @brief	Read data at any flash address
+     *
+     * @param	Addr	: Flash byte address
+     * @param	pBuff	: Pointer to buffer to receive data
+     * @param	Len		: Number of bytes to read
+     *
+     * @return	Number of bytes read, 0 if the device stays busy
+     */
+    int ReadData(uint32_t Addr, uint8_t *pBuff, uint32_t Len);
+
+    /**
+     * @brief	Program data at any flash address
+     *
+     * Data is split at write page boundaries.  Programming only clears bits,
+     * the area must have been erased first.  When a block erase is in
+     * progress elsewhere and the device supports it, the erase is suspended
+     * and the data fully programmed before it is resumed.
+     *
+     * @param	Addr	: Flash byte address
+     * @param	pData	: Pointer to data to program
+     * @param	Len		: Number of bytes to program
+     *
+     * @return	Number of bytes programmed, less than Len if the device stays busy
+     */
+    int ProgramData(uint32_t Addr, uint8_t *pData, uint32_t Len);
+
+    /**
+     * @brief	Start programming a page without waiting
+     *
+     * The device status is read once.  Nothing is sent if a program or erase
+     * is still in progress.  Otherwise up to the end of the write page is
+     * programmed and the function returns immediately, allowing the caller to
+     * prepare the next page while the device is busy.
+     *
+     * @param	Addr	: Flash byte address
+     * @param	pData	: Pointer to data to program
+     * @param	Len		: Number of bytes to program
+     *
+     * @return	Number of bytes being programmed, 0 if device is busy
+     */
+    int ProgramStart(uint32_t Addr, uint8_t *pData, uint32_t Len);
+
+    /**
+     * @brief	Start erasing a block without waiting
+     *
+     * Completion is checked with IsBusy.
+     *
+     * @param	BlkNo	: Block number to erase
+     *
+     * @return
+     * 			- true	: Erase started
+     * 			- false	: Device is busy
+     */
+    bool EraseStart(uint32_t BlkNo);
+
+    /**
+     * @brief	Check if a program or erase is in progress
+     *
+     * @return	true - Device busy
+     */
+    bool IsBusy();
+
+    /**
+     * @brief	Check if the flash is being accessed
+     *
+     * A background task, ex. timer handler, interrupting a flash access must
+     * not use the device until this returns false.
+     *
+     * @return	true - An access is ongoing
+     */
+    bool InUse() { return vAccess != 0; }
+
+    /**
+     * @brief	Read and parse SFDP Basic Flash Parameter Table
+     *
+     * @param	Sfdp	: Structure to receive device parameters
+     *
+     * @return
+     * 			- true	: Success
+     * 			- false	: Device has no valid SFDP table
+     */
+    bool ReadSfdp(FLASH_SFDP &Sfdp);
+
+    /**
+     * @brief	Get device parameters found at Init
+     *
+     * @return	Pointer to SFDP parameters, NULL if device has no SFDP
+     */
+    const FLASH_SFDP *GetSfdp() { return vbSfdp ? &vSfdp : NULL; }
+
     /**
      * @brief	Read Flash ID
      *
@@ -324,13 +560,72 @@ protected:
      */
     bool WaitReady(uint32_t Timeout = 100000, uint32_t usRtyDelay = 0);
 
+    /**
+     * @brief	Switch device to 4 bytes address mode using method reported by SFDP
+     *
+     * @return
+     * 			- true	: Success
+     * 			- false	: No supported method
+     */
+    bool Enter4ByteAddr();
+
+    /**
+     * @brief	Suspend block erase in progress
+     *
+     * @return
+     * 			- true	: Erase suspended, must be resumed
+     * 			- false	: Not supported or nothing to suspend
+     */
+    bool Suspend();
+
+    /**
+     * @brief	Resume suspended block erase
+     */
+    void Resume();
+
+    /**
+     * @brief	Suspend block erase in progress for an access to another block
+     *
+     * @param	Addr	: Start address of the access
+     * @param	Len		: Length of the access in bytes
+     *
+     * @return
+     * 			- true	: Erase suspended, must be resumed
+     * 			- false	: Access can proceed only once the device is ready
+     */
+    bool SuspendFor(uint32_t Addr, uint32_t Len);
+
 private:
+    int Program(uint32_t Addr, uint8_t *pData, uint32_t Len);
+    void SendErase(uint32_t Addr);
+    void SetLines(int NbLines);
+    uint32_t PollDelay();
+    uint32_t EraseTimeout();
+
     uint32_t    vEraseSize;		//!< Min erasable block size in byte
     uint32_t    vWriteSize;		//!< Min writable size in bytes
+    uint32_t    vSectSize;		//!< Logical sector size in bytes
     uint64_t    vTotalSize;		//!< Total Flash size in bytes
     int         vAddrSize;		//!< Address size in bytes
     int         vDevNo;			//!< Device No
+    uint8_t     vReadCmd;       //!< Read opcode
+    int         vReadDummy;     //!< Dummy bytes after read address
+    uint8_t     vEraseCmd;      //!< Block erase opcode matching vEraseSize
+    uint32_t    vEraseTime;     //!< Typical block erase time in usec, 0 unknown
+    uint32_t    vChipEraseTime; //!< Typical chip erase time in msec, 0 unknown
+    uint32_t    vProgTime;      //!< Typical page program time in usec, 0 unknown
+    int         vReadAddrLines; //!< Lines used for read address and dummy
+    int         vReadDataLines; //!< Lines used for read data
+    uint8_t     vProgCmd;       //!< Page program opcode
+    int         vProgLines;     //!< Lines used for program data
+    bool        vbEraseBusy;    //!< Block erase started and not seen complete
+    bool        vbSuspended;    //!< Block erase suspended
+    uint32_t    vEraseAddr;     //!< Address of block being erased
+    volatile int vAccess;       //!< Nesting count of ongoing accesses
+    bool        vbSfdp;         //!< SFDP table found
+    FLASH_SFDP  vSfdp;          //!< Parameters from SFDP
     DeviceIntrf *vpInterf;		//!< Device interface to access Flash
+    FLASHDISKIOLINECB vpSetLinesCB;	//!< Interface line switching
     FLASHDISKIOCB vpWaitCB;		//!< User wait callback when long wait time is required. This is to allows
     							//!< user application to perform task switch or other thing while waiting.
 };
@@ -0,0 +1,294 @@
+/**-------------------------------------------------------------------------
+@file	diskio_ftl.h
+
+@brief	Flash translation layer for NOR flash disk
+
+Maps logical sectors to physical flash pages so that the FlashDiskIO can be
+used as a regular rewritable disk.  Sectors are written out of place, stale
+pages are reclaimed by garbage collection of whole erase blocks and erase
+counts are levelled across blocks.
+
+Flash layout : each erase block starts with a header holding the erase count
+followed by one tag per data page.  A tag records the logical sector and a
+write sequence number.  Data is programmed before its tag, so a power loss
+leaves either the old or the new copy of a sector.  The mapping is rebuilt at
+Init by scanning headers and tags, the newest sequence number wins.  Writing
+resumes in the block that was being written, after any page left dirty by an
+interrupted write.
+
+RAM use is one uint32_t per logical sector plus 8 bytes per erase block, see
+FLASHFTL_MEMSIZE.
+
+Usage :
+
+// Raw flash, initialized without cache
+FlashDiskIO g_Flash;
+
+// Mapping table memory
+static uint32_t s_FtlMem[FLASHFTL_MEMSIZE(256, 8) / 4];
+
+static const FLASHFTL_CFG s_FtlCfg = {
+	0,							// Start at erase block 0
+	256,						// 256 blocks of 4KB
+	4,							// Spare blocks
+	FLASHFTL_WEAR_THRESHOLD_DEF,
+	s_FtlMem,
+	sizeof(s_FtlMem)
+};
+
+FlashFtl g_FlashFtl;
+
+g_Flash.Init(s_FlashDiskCfg, &g_Spi);
+g_FlashFtl.Init(s_FtlCfg, &g_Flash, g_FlashCache, 4);
+
+// g_FlashFtl is now used as any DiskIO, ie. to mount FatFS
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __DISKIO_FTL_H__
+#define __DISKIO_FTL_H__
+
+#include <stdint.h>
+
+#include "diskio.h"
+#include "diskio_flash.h"
+
+/** @addtogroup Storage
+  * @{
+  */
+
+#define FLASHFTL_MAGIC				0x4C544649	//!< 'IFTL' block header signature
+#define FLASHFTL_BLK_OPEN			0			//!< Block header state once block is used
+#define FLASHFTL_SPARE_BLK_MIN		3			//!< Min spare blocks, garbage collection keeps that many free blocks
+#define FLASHFTL_WEAR_THRESHOLD_DEF	64			//!< Default erase count spread before static wear levelling
+
+#define FLASHFTL_SECT_UNMAPPED		0xFFFFFFFF	//!< Logical sector never written
+#define FLASHFTL_BLK_DIRTY			0xFFFF		//!< Block content unknown, must be erased before use
+
+#pragma pack(push, 4)
+
+/// Erase block header, at offset 0 of each block
+typedef struct __FlashFtl_Blk_Hdr {
+	uint32_t Magic;			//!< FLASHFTL_MAGIC
+	uint32_t EraseCnt;		//!< Number of times this block was erased
+	uint32_t Crc;			//!< crc32 of Magic and EraseCnt
+	uint32_t State;			//!< Erased state until block is used for writing.  Not part of the crc
+} FLASHFTL_BLKHDR;
+
+/// Data page tag, follows block header, one per data page
+typedef struct __FlashFtl_Tag {
+	uint32_t LSect;			//!< Logical sector number stored in the page
+	uint32_t Seq;			//!< Write sequence number
+	uint32_t Crc;			//!< crc32 of LSect and Seq
+} FLASHFTL_TAG;
+
+#pragma pack(pop)
+
+/// Erase block run time state
+typedef struct __FlashFtl_Blk_Info {
+	uint32_t EraseCnt;		//!< Erase count
+	uint16_t NbValid;		//!< Number of pages holding current sector data
+	uint16_t NbUsed;		//!< Number of data pages consumed, FLASHFTL_BLK_DIRTY if erase is needed
+} FLASHFTL_BLKINFO;
+
+/// Memory in bytes required for mapping table of NbBlk erase blocks of NbPgPerBlk pages
+#define FLASHFTL_MEMSIZE(NbBlk, NbPgPerBlk)		((NbBlk) * ((NbPgPerBlk) * 4 + sizeof(FLASHFTL_BLKINFO)))
+
+typedef struct __FlashFtl_Cfg {
+	uint32_t StartBlk;		//!< First erase block managed by the FTL
+	uint32_t NbBlk;			//!< Number of erase blocks managed. 0 for rest of the flash
+	uint32_t NbSpareBlk;	//!< Blocks not exposed as logical sectors, min FLASHFTL_SPARE_BLK_MIN.
+							//!< More spare blocks reduce garbage collection copies
+	uint32_t WearThreshold;	//!< Erase count spread triggering relocation of static data
+	void *pMem;				//!< Memory for mapping table, see FLASHFTL_MEMSIZE
+	uint32_t MemSize;		//!< Size of pMem in bytes
+} FLASHFTL_CFG;
+
+/// @brief	Flash translation layer disk
+///
+/// Logical sector size is the sector size of the underlying FlashDiskIO.  The
+/// flash erase size must be a multiple of it.
+class FlashFtl : public DiskIO {
+public:
+	FlashFtl();
+	virtual ~FlashFtl() {}
+
+	/**
+	 * @brief	Initialize FTL and rebuild the sector mapping from flash.
+	 *
+	 * Blocks without a valid header, such as a new flash, are erased on first use.
+	 *
+	 * @param	Cfg			: FTL configuration data
+	 * @param	pFlash		: Raw flash disk.  Its own cache is not used
+	 * @param	pCacheBlk	: Pointer to static cache block (optional)
+	 * @param	NbCacheBlk	: Size of cache block (Number of cache sector)
+	 *
+	 * @return
+	 * 			- true 	: Success
+	 * 			- false	: Failed
+	 */
+	bool Init(const FLASHFTL_CFG &Cfg, FlashDiskIO * const pFlash,
+			  DISKIO_CACHE_DESC * const pCacheBlk = NULL, int NbCacheBlk = 0);
+
+	/**
+	 * @brief	Get total disk size in bytes.
+	 *
+	 * @return	Logical size in bytes
+	 */
+	virtual uint64_t GetSize(void) { return (uint64_t)vNbLSect * vSectSize; }
+
+	/**
+	 * @brief	Get logical sector size.
+	 *
+	 * @return	Sector size in bytes
+	 */
+	virtual int GetSectSize(void) { return vSectSize; }
+
+	/**
+	 * @brief	Erase all blocks, erase counts are preserved.
+	 */
+	virtual void Erase();
+
+	/**
+	 * @brief	Read one logical sector.  Sector never written reads as 0xFF
+	 *
+	 * @param	SectNo	: Sector number to read
+	 * @param	pBuff	: Pointer to buffer to receive sector data. Must be at least
+	 * 					  1 sector size
+	 *
+	 * @return
+	 * 			- true	: Success
+	 * 			- false	: Failed
+	 */
+	virtual bool SectRead(uint32_t SectNo, uint8_t *pBuff);
+
+	/**
+	 * @brief	Write one logical sector to a new page
+	 *
+	 * @param	SectNo	: Sector number to write
+	 * @param	pData	: Pointer to sector data to write. Must be at least
+	 * 					  1 sector size
+	 *
+	 * @return
+	 * 			- true	: Success
+	 * 			- false	: Failed
+	 */
+	virtual bool SectWrite(uint32_t SectNo, uint8_t *pData);
+
+	/**
+	 * @brief	Read consecutive sectors, physically contiguous pages are read with
+	 * 			one command
+	 *
+	 * @param	SectNo	: Start sector number
+	 * @param	pBuff	: Pointer to buffer to receive sector data. Must be at least
+	 * 					  NbSect sectors
+	 * @param	NbSect	: Number of sectors to read
+	 *
+	 * @return	Number of sectors read
+	 */
+	virtual int SectReadMulti(uint32_t SectNo, uint8_t *pBuff, int NbSect);
+
+	/**
+	 * @brief	Write consecutive sectors, pages and tags are programmed in runs
+	 *
+	 * @param	SectNo	: Start sector number
+	 * @param	pData	: Pointer to sector data to write. Must be at least
+	 * 					  NbSect sectors
+	 * @param	NbSect	: Number of sectors to write
+	 *
+	 * @return	Number of sectors written
+	 */
+	virtual int SectWriteMulti(uint32_t SectNo, uint8_t *pData, int NbSect);
+
+	/**
+	 * @brief	Reclaim one erase block ahead of time.
+	 *
+	 * Can be called when idle to reduce write latency later on.
+	 *
+	 * @return	true - A block was reclaimed
+	 */
+	bool Collect();
+
+	/**
+	 * @brief	Get erase count of a block
+	 *
+	 * @param	BlkNo	: Block index relative to Cfg.StartBlk
+	 *
+	 * @return	Erase count
+	 */
+	uint32_t EraseCount(uint32_t BlkNo) { return BlkNo < vNbBlk ? vpBlk[BlkNo].EraseCnt : 0; }
+
+	uint32_t HostWriteCount() { return vHostWrCnt; }	//!< Sectors written by user
+	uint32_t PageWriteCount() { return vPageWrCnt; }	//!< Pages programmed, including garbage collection
+	uint32_t BlockEraseCount() { return vBlkEraseCnt; }	//!< Block erased since Init
+
+private:
+	bool Mount();
+	int AllocPage(bool bGC);
+	int OpenBlock();
+	bool EraseBlk(uint32_t BlkNo);
+	int Relocate(uint32_t BlkNo);
+	bool Reclaim(bool bStatic);
+	uint32_t PageAddr(uint32_t PgNo) { return (vStartBlk + PgNo / vNbPgPerBlk) * vEraseSize + (vNbHdrPg + PgNo % vNbPgPerBlk) * vSectSize; }
+	uint32_t TagAddr(uint32_t PgNo) { return (vStartBlk + PgNo / vNbPgPerBlk) * vEraseSize + sizeof(FLASHFTL_BLKHDR) + (PgNo % vNbPgPerBlk) * sizeof(FLASHFTL_TAG); }
+	void Map(uint32_t LSect, uint32_t PgNo);
+	bool ProgramTags(uint32_t PgNo, uint32_t LSect, int NbPg);
+	bool IsBlank(uint32_t Addr, uint32_t Len);
+
+	FlashDiskIO *vpFlash;		//!< Raw flash
+	uint32_t vSectSize;			//!< Page and logical sector size
+	uint32_t vEraseSize;		//!< Erase block size
+	uint32_t vStartBlk;			//!< First erase block used
+	uint32_t vNbBlk;			//!< Number of erase blocks used
+	uint32_t vNbHdrPg;			//!< Pages used by block header and tags
+	uint32_t vNbPgPerBlk;		//!< Data pages per block
+	uint32_t vNbLSect;			//!< Number of logical sectors
+	uint32_t vNbFree;			//!< Number of free blocks, including dirty blocks
+	uint32_t vWearThreshold;	//!< Static wear levelling threshold
+	int vActBlk;				//!< Block being written, -1 if none
+	uint32_t vSeq;				//!< Next write sequence number
+	uint32_t vMaxEraseCnt;		//!< Max block erase count
+	bool vbInGC;				//!< Garbage collection in progress
+	uint32_t *vpMap;			//!< Logical sector to physical page
+	FLASHFTL_BLKINFO *vpBlk;	//!< Block states
+	uint32_t vHostWrCnt;
+	uint32_t vPageWrCnt;
+	uint32_t vBlkEraseCnt;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} End of group Storage */
+
+#endif	// __DISKIO_FTL_H__
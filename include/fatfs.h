@@ -68,8 +68,33 @@ typedef enum {
 #define FATFS_FAT32_CLNSHUT_BITMASK	0x80000000L
 #define FATFS_FAT32_HRDERR_BITMASK	0x40000000L
 
+#define FATFS_FAT16_EOC				0xFFF8		//!< FAT16 entries from this value mark end of chain
+#define FATFS_FAT32_EOC				0x0FFFFFF8	//!< FAT32 entries from this value mark end of chain
+#define FATFS_FAT32_ENTRY_MASK		0x0FFFFFFF	//!< Upper 4 bits of FAT32 entries are reserved
+
+#define FATFS_FSINFO_LEADSIG		0x41615252
+#define FATFS_FSINFO_STRUCSIG		0x61417272
+#define FATFS_FSINFO_UNKNOWN		0xFFFFFFFF	//!< Free count or next free not known
+
+#define FATFS_LFN_MAX				255			//!< Max long file name length
+#define FATFS_DIRENT_MAX			65536		//!< Max number of entries in a directory
+
+#define FATFS_FREEMAP_SIZE			16			//!< Default free cluster map size in 32 bits words
+#define FATFS_DIRCACHE_SIZE			16			//!< Default number of directory cache entries
+#define FATFS_DIRCACHE_WAYS			4			//!< Directory cache entries per set
+#define FATFS_DIRBUF_CNT			16			//!< Directory entries read per access, 512 bytes
+#define FATFS_TIME_DEF				0x00210000	//!< Jan. 1 1980 00:00:00, DOS date and time
+
 #ifndef MAX_FILE
-#define MAX_FILE					OPEN_MAX
+#define MAX_FILE					OPEN_MAX	//!< Default number of file handles
+#endif
+
+#define FATFS_FDIDX_BITS			12			//!< File handle bits holding the table index
+#define FATFS_FDIDX_MASK			((1 << FATFS_FDIDX_BITS) - 1)
+#define FATFS_FD_MAX				(1 << FATFS_FDIDX_BITS)	//!< Max number of file handles
+
+#ifndef FATFS_EXTENT_MAX
+#define FATFS_EXTENT_MAX			16			//!< Number of cluster extents cached per open file
 #endif
 
 #define FATFS_TOTAL_SECTOR(DiskSizeBytes)					(DiskSizeBytes / FATFS_SECTOR_SIZE)
@@ -283,38 +308,159 @@ typedef struct {
 	const uint16_t *pFat1;		//!< pointer to FAT1 sector
 } FATFS_VDISK;
 
+/// Run of consecutive clusters in a file cluster chain
+typedef struct {
+	uint32_t	Idx;			//!< Index of first cluster in the file chain
+	uint32_t	Clus;			//!< First cluster number
+	uint32_t	Len;			//!< Number of clusters
+} FATFS_EXTENT;
+
+/// Directory entry data of an open file
+typedef struct {
+	uint32_t	d_size;			//!< File size
+	uint32_t	d_offset;		//!< File position
+	uint32_t	EntrySect;		//!< Sector of the short directory entry
+	uint32_t	EntryIdx;		//!< Entry index in EntrySect
+	uint32_t	FirstClus;		//!< Start data cluster, 0 if none
+	uint8_t		d_att;			//!< DA_xxx attributes
+} FATFS_FDENT;
+
 // File descriptor
 typedef struct {
-	void 		*pFs;			//!< Pointer to file system object
-	DIR 		DirEntry;		//!< File directory entry
-	uint32_t	CurClus;		//!< Current data cluster
-	uint32_t 	SectIdx;		//!< Sector index in CurClus
-	uint32_t	SectOff;		//!< Current file pos : offset in sector
+	void 		*pFs;			//!< Pointer to file system object, NULL if free
+	FATFS_FDENT	Ent;			//!< File directory entry
+	uint32_t	CurClus;		//!< Last data cluster accessed, 0 if none
+	uint32_t	ClusIdx;		//!< Index of CurClus in the cluster chain
+	FATFS_EXTENT Ext[FATFS_EXTENT_MAX];	//!< Extents in chain order. Last one ends at the
+								//!< furthest cluster walked. When full, every other one is
+								//!< dropped, the others are kept as seek points
+	int			NbExt;			//!< Number of extents in Ext
+	uint32_t	ExtStride;		//!< Record one extent every ExtStride walked
+	uint32_t	ExtSkip;		//!< Extents walked since last recorded
+	int			Flags;			//!< Open flags
 	bool 		bWritable;		//!< Writable access
+	bool		bDirty;			//!< Directory entry needs update
+	bool		bShared;		//!< File also open by another handle, not buffered
+	uint8_t		Gen;			//!< Handle generation, changed on close
+	int			NextFree;		//!< Next free handle index when free, -1 if last
+	uint8_t		*pBuff;			//!< Sector buffer, NULL if not buffered
+	uint32_t	BuffSize;		//!< Buffer size in sectors
+	uint32_t	BuffIdx;		//!< File sector index of first buffered sector
+	uint32_t	BuffSect;		//!< Disk sector of first buffered sector
+	uint32_t	BuffCnt;		//!< Number of sectors buffered, 0 if empty
+	uint32_t	DirtyStart;		//!< First modified sector in buffer
+	uint32_t	DirtyEnd;		//!< End of modified sectors in buffer, 0 if clean
 } FATFS_FD;
 
+/// Directory entry location
+typedef struct {
+	uint32_t	Clus;			//!< Directory cluster, 0 for FAT16 root directory
+	uint32_t	Idx;			//!< Entry index in cluster or in FAT16 root directory
+} FATFS_DIRPOS;
+
+/// Directory cache entry, name location in its parent directory
+typedef struct {
+	uint32_t	DirClus;		//!< Parent directory cluster
+	uint32_t	Hash;			//!< Hash of the name, case folded
+	FATFS_DIRPOS Pos;			//!< First entry, long name or short entry
+	uint32_t	NbEnt;			//!< Number of entries, long name and short, 0 if unused
+} FATFS_DIRCACHE;
+
+/// Buffered directory entries
+typedef struct {
+	FATFS_DIRPOS Start;			//!< Position of first entry in buffer
+	int			Cnt;			//!< Number of entries in buffer, 0 if empty
+	FATFS_DIR	Ent[FATFS_DIRBUF_CNT];
+} FATFS_DIRBUF;
+
+/**
+ * @brief	Date and time callback, for directory entries
+ *
+ * @return	DOS date in upper 16 bits, DOS time in lower 16 bits
+ */
+typedef uint32_t (*FATFSTIMECB)(void);
+
 #pragma pack(pop)
 
+/// Memory given to FatFS.  Null pointers select the built-in defaults
+typedef struct __FatFS_Cfg {
+	uint32_t	*pFreeMap;		//!< Free cluster map, one bit per cluster with (NbClusters + 2) bits
+	int			FreeMapSize;	//!< Size of pFreeMap in 32 bits words
+	FATFS_DIRCACHE *pDirCache;	//!< Directory cache
+	int			DirCacheSize;	//!< Number of entries in pDirCache
+	FATFS_FD	*pFdTbl;		//!< File handle table, MAX_FILE built-in handles if NULL
+	int			FdTblSize;		//!< Number of entries in pFdTbl, max FATFS_FD_MAX
+	uint8_t		*pFdBuff;		//!< Sector buffers, divided evenly between handles (optional)
+	uint32_t	FdBuffSize;		//!< Size of pFdBuff in bytes
+} FATFS_CFG;
+
 #ifdef __cplusplus
 #include <memory>
 #include "diskio.h"
 
-/// FAT filesystem base class
+/// @brief	FAT filesystem
+///
+/// FAT16 and FAT32 volumes, read and write.  Accesses go through the DiskIO
+/// sector cache.  Every FAT update is written to all FAT copies.  Free
+/// clusters are tracked in a bitmap of cluster groups, a group bit is clear
+/// when the group is known to be full.  With enough map memory there is one
+/// bit per cluster.  For FAT32 the free count and next free cluster are kept in
+/// FSInfo, the FAT is scanned at Init only if FSInfo has no valid free count.
+///
+/// Directory entries and FSInfo are updated by Close and Sync.
+///
+/// File handles come from a table given at Init, FATFS_FD_MAX max.  Handles
+/// index the table directly, free entries are kept in a list.  A handle holds
+/// the table index and a generation number, so a closed handle is not valid
+/// once the entry is reused.  Each handle can have a buffer of consecutive
+/// file sectors for small reads and writes, written back when the access moves
+/// elsewhere, on Sync and on Close.  Buffering stops while a file is open by
+/// more than one handle.
+///
+/// Allocate reserves clusters ahead of writes in one run of consecutive
+/// clusters.  Data can then be written directly to the disk at the location
+/// given by Map, bypassing FatFS, and the file size set afterward with SetSize.
+///
+/// Directories are scanned FATFS_DIRBUF_CNT entries at a time.  Names found
+/// are kept in a small set associative cache indexed by parent directory and
+/// name hash, least recently used replaced.  A
+/// cached location is only a hint, the entries there are verified again before
+/// being used, so a stale entry costs one scan.
 class FatFS {
 public:
-	FatFS() { }//memset(vOpenFiles, 0, sizeof(vOpenFiles)); }
+	FatFS();
 	virtual ~FatFS() {}
 
 	/**
 	 * @brief	Initialize FAT FS
 	 *
-	 * @param	pDiskIO : Pointer reference to Disk I/O access interface.
+	 * @param	pDiskIO 	: Pointer reference to Disk I/O access interface.
+	 * @param	pFreeMap	: Memory for free cluster map (optional).  Without it a
+	 * 						  FATFS_FREEMAP_SIZE words map is used
+	 * @param	FreeMapSize	: Size of pFreeMap in 32 bits words. pFreeMap has one bit
+	 * 						  per cluster when it holds (NbClusters + 2) bits
+	 * @param	pDirCache	: Memory for directory cache (optional).  Without it
+	 * 						  FATFS_DIRCACHE_SIZE entries are used
+	 * @param	DirCacheSize: Number of entries in pDirCache
 	 *
 	 * @return
 	 * 			- true	: Success
-	 * 			- false	: Failed
+	 * 			- false	: Failed, no FAT16/FAT32 volume found
 	 */
-	bool Init(DiskIO *pDiskIO);
+	bool Init(DiskIO *pDiskIO, uint32_t * const pFreeMap = NULL, int FreeMapSize = 0,
+			  FATFS_DIRCACHE * const pDirCache = NULL, int DirCacheSize = 0);
+
+	/**
+	 * @brief	Initialize FAT FS with memory for the caches and file handles
+	 *
+	 * @param	pDiskIO 	: Pointer reference to Disk I/O access interface.
+	 * @param	Cfg			: Memory configuration
+	 *
+	 * @return
+	 * 			- true	: Success
+	 * 			- false	: Failed, no FAT16/FAT32 volume found
+	 */
+	bool Init(DiskIO *pDiskIO, const FATFS_CFG &Cfg);
 
 	/**
 	 * @brief	Find path name.
@@ -326,11 +472,140 @@ public:
 	 * 			- true 	: Pathname found
 	 * 			- false : Not found
 	 */
-	bool Find(char * const pPathName, DIR *pDir);
-	int Open(char * const pPathName, int Flags, int Mode);
-	int Close(int fd);
+	bool Find(const char * const pPathName, DIR *pDir);
+
+	/**
+	 * @brief	Open file
+	 *
+	 * @param	pPathName	: Path name of the file
+	 * @param	Flags		: O_RDONLY, O_WRONLY or O_RDWR, combined with O_CREAT,
+	 * 						  O_EXCL, O_TRUNC, O_APPEND and O_SYNC
+	 * @param	Mode		: Not used
+	 *
+	 * @return	File handle, -1 on failure
+	 */
+	int Open(const char * const pPathName, int Flags, int Mode);
+	int Close(int Fd);
 	int Read(int Fd, uint8_t *pBuff, size_t Len);
-	int Write(int Fd, uint8_t *pBuf, size_t Len);
+	int Write(int Fd, uint8_t *pBuff, size_t Len);
+
+	/**
+	 * @brief	Set file position
+	 *
+	 * @param	Fd		: File handle
+	 * @param	Offset	: Position from start of file, limited to file size
+	 *
+	 * @return	New position, -1 on failure
+	 */
+	int Seek(int Fd, uint32_t Offset);
+
+	/**
+	 * @brief	Shorten file, freeing clusters past the new size
+	 *
+	 * @param	Fd		: File handle
+	 * @param	Size	: New size, not more than the current size
+	 *
+	 * @return	0 on success, -1 on failure
+	 */
+	int Truncate(int Fd, uint32_t Size);
+
+	/**
+	 * @brief	Reserve clusters for the file up to a size
+	 *
+	 * Clusters are added at end of the chain in one run of consecutive clusters,
+	 * following the last cluster of the file when those are free.  File size
+	 * is unchanged, writes up to Size then need no cluster allocation.
+	 * Reserved clusters stay with the file until Truncate.  Directory entry
+	 * and FAT are written to disk before returning.
+	 *
+	 * @param	Fd		: File handle
+	 * @param	Size	: Size to reserve clusters for
+	 *
+	 * @return	0 on success, -1 on failure or no free run long enough
+	 */
+	int Allocate(int Fd, uint32_t Size);
+
+	/**
+	 * @brief	Locate file data on disk, for direct disk access
+	 *
+	 * @param	Fd			: File handle
+	 * @param	Offset		: Position in file, may be past file size in clusters
+	 * 						  reserved by Allocate
+	 * @param	DiskOffset	: Receives position on disk in bytes
+	 *
+	 * @return	Number of bytes consecutive on disk from Offset, 0 if Offset is past
+	 * 			the clusters of the file
+	 */
+	uint32_t Map(int Fd, uint32_t Offset, uint64_t &DiskOffset);
+
+	/**
+	 * @brief	Set file size within the clusters of the file
+	 *
+	 * For data written directly to disk at the location given by Map.  Data
+	 * past the previous size is not cleared.  Directory entry is written to
+	 * disk before returning.
+	 *
+	 * @param	Fd		: File handle
+	 * @param	Size	: New size
+	 *
+	 * @return	0 on success, -1 on failure or Size past the clusters of the file
+	 */
+	int SetSize(int Fd, uint32_t Size);
+
+	/**
+	 * @brief	Write file directory entry, FSInfo and cached data to disk
+	 *
+	 * @param	Fd		: File handle
+	 *
+	 * @return	0 on success, -1 on failure
+	 */
+	int Sync(int Fd);
+
+	/**
+	 * @brief	Delete file or empty directory
+	 *
+	 * @param	pPathName	: Path name
+	 *
+	 * @return
+	 * 			- true 	: Success
+	 * 			- false : Not found, open, or directory not empty
+	 */
+	bool Remove(const char * const pPathName);
+
+	/**
+	 * @brief	Create directory
+	 *
+	 * @param	pPathName	: Path name, parent directory must exist
+	 *
+	 * @return
+	 * 			- true 	: Success
+	 * 			- false : Failed or already exists
+	 */
+	bool MkDir(const char * const pPathName);
+
+	/**
+	 * @brief	Get number of free clusters
+	 *
+	 * @return	Number of free clusters, FATFS_FSINFO_UNKNOWN if not known
+	 */
+	uint32_t GetFreeCount() { return vFreeCnt; }
+
+	/**
+	 * @brief	Get cluster size in bytes
+	 */
+	uint32_t GetClusterSize() { return vClusBytes; }
+
+	/**
+	 * @brief	Get disk holding the volume
+	 */
+	DiskIO *GetDiskIO() { return vDiskIO; }
+
+	/**
+	 * @brief	Set date and time source for directory entries
+	 *
+	 * @param	TimeCB	: Callback, NULL - entries dated Jan. 1 1980
+	 */
+	void SetTimeCB(FATFSTIMECB TimeCB) { vTimeCB = TimeCB; }
 
 protected:
 	/**
@@ -344,25 +619,134 @@ protected:
 	 * @return	Sector number
 	 */
 	uint32_t ClusToSect(uint32_t ClusNo);
-	int Create(FATFS_FD * const pFd);
-	bool FindFreeDirEntry();
-	bool FindFreeCluster();
+
+	/**
+	 * @brief	Create directory entry, with long name entries if needed
+	 *
+	 * @param	pPathName	: Path name, parent directory must exist
+	 * @param	Attr		: Entry attributes
+	 * @param	FirstClus	: First cluster of entry data
+	 * @param	pDir		: Receives the new entry
+	 *
+	 * @return	true - Success
+	 */
+	bool Create(const char * const pPathName, uint8_t Attr, uint32_t FirstClus, DIR *pDir);
+
+	/**
+	 * @brief	Find consecutive free entries in a directory, directory is
+	 * 			extended as needed
+	 *
+	 * @param	DirClus	: Directory start cluster, 0 - FAT16 root directory
+	 * @param	NbEnt	: Number of entries needed
+	 * @param	Pos		: Receives location of first entry
+	 *
+	 * @return	true - Success
+	 */
+	bool FindFreeDirEntry(uint32_t DirClus, int NbEnt, FATFS_DIRPOS &Pos);
+
+	/**
+	 * @brief	Find a free cluster from the free cluster map
+	 *
+	 * @param	Start	: Cluster to start searching from
+	 *
+	 * @return	Free cluster number, 0 if disk full
+	 */
+	uint32_t FindFreeCluster(uint32_t Start);
+
+	/**
+	 * @brief	Find consecutive free clusters
+	 *
+	 * @param	Start	: Cluster to start searching from
+	 * @param	NbClus	: Number of clusters needed
+	 *
+	 * @return	First cluster of the run, 0 if none found
+	 */
+	uint32_t FindFreeRun(uint32_t Start, uint32_t NbClus);
+
+	/**
+	 * @brief	Allocate a cluster and link it at end of a chain
+	 *
+	 * @param	Prev	: Last cluster of the chain, 0 to start a new chain
+	 *
+	 * @return	Cluster number, 0 if disk full
+	 */
+	uint32_t AllocCluster(uint32_t Prev);
+
+	/**
+	 * @brief	Free a cluster chain
+	 *
+	 * @param	ClusNo	: First cluster of the chain
+	 */
+	void FreeChain(uint32_t ClusNo);
+
+	uint32_t ReadFat(uint32_t ClusNo);
+	bool WriteFat(uint32_t ClusNo, uint32_t Val);
+	bool IsEoc(uint32_t Val) { return Val >= vEoc; }
 
 private:
+	FATFS_FD *GetFd(int Fd);
+	bool FlushBuff(FATFS_FD * const pFd, bool bDrop);
+	int BuffXfer(FATFS_FD * const pFd, uint8_t *pBuff, uint32_t Len, bool bWrite);
+	bool LookUp(const char *pPath, int Len, DIR *pDir, FATFS_DIRPOS *pPos, FATFS_DIRPOS *pLfnPos);
+	bool DirFind(uint32_t DirClus, const char *pName, int Len, DIR *pDir, FATFS_DIRPOS &Pos, FATFS_DIRPOS &LfnPos);
+	bool DirScan(uint32_t DirClus, FATFS_DIRPOS Start, uint32_t NbEnt, const char *pName, int Len,
+				 DIR *pDir, FATFS_DIRPOS &Pos, FATFS_DIRPOS &LfnPos);
+	bool ShortNameExists(uint32_t DirClus, const uint8_t *pName);
+	FATFS_DIR *DirGet(const FATFS_DIRPOS &Pos, FATFS_DIRBUF &Buf);
+	FATFS_DIRCACHE *DirCacheSet(uint32_t DirClus, uint32_t Hash, int &NbWays);
+	void DirCacheAdd(uint32_t DirClus, const char *pName, int Len, const FATFS_DIRPOS &LfnPos, const FATFS_DIRPOS &Pos);
+	void DirCacheRemove(uint32_t DirClus, const FATFS_DIRPOS *pPos);
+	uint64_t DirOffset(const FATFS_DIRPOS &Pos);
+	bool DirNext(FATFS_DIRPOS &Pos, bool bExtend);
+	bool ZeroCluster(uint32_t ClusNo);
+	uint32_t ScanFreeGroup(uint32_t Grp, uint32_t Start);
+	void ScanFat();
+	uint32_t FreeRun(uint32_t ClusNo, uint32_t Max);
+	bool LinkRun(uint32_t ClusNo, uint32_t NbClus);
+	uint32_t ChainRun(uint32_t ClusNo, uint32_t Max, uint32_t &Next);
+	FATFS_EXTENT *AddExtent(FATFS_FD * const pFd, uint32_t Idx, uint32_t ClusNo);
+	void InvalidateExtents(FATFS_FD * const pFd);
+	void ShareSize(FATFS_FD * const pFd);
+	uint32_t GetCluster(FATFS_FD * const pFd, uint32_t Idx, bool bAlloc, uint32_t *pRun = NULL);
+	int DataXfer(uint64_t Offset, uint8_t *pBuff, uint32_t Len, bool bWrite);
+	bool UpdateDirEnt(FATFS_FD * const pFd);
+	void UpdateFSInfo();
+	uint32_t GetTime() { return vTimeCB ? vTimeCB() : FATFS_TIME_DEF; }
+
 	FATFS_TYPE 	vType;				//!< FAT type
 	uint32_t 	vClusterSize;		//!< Cluster size inm nb of sector
+	uint32_t	vSectSize;			//!< Sector size in bytes
+	uint32_t	vClusBytes;			//!< Cluster size in bytes
 	uint32_t 	vPartStartSect;		//!< Partition start sector
 	uint32_t 	vFatSize;			//!< FAT table size
 	uint32_t 	vTotalSect;			//!< Total partition size
 	uint32_t 	vFATStartSect;		//!< FAT Table start sector
 	uint32_t 	vDataStartSect;		//!< Data start sector
 	uint32_t 	vRootDirSect;		//!< Root dir start sector
-	//DIR			vCurDir;			//!< Current directory
+	uint32_t	vRootEntCnt;		//!< FAT16 root dir number of entries
+	uint32_t	vRootClus;			//!< FAT32 root dir start cluster, 0 for FAT16
+	uint32_t	vNbClus;			//!< Number of data clusters
+	uint32_t	vEoc;				//!< End of chain value
+	int			vNbFat;				//!< Number of FAT copies
+	int			vActFat;			//!< FAT read, -1 if all copies are written
+	uint32_t	vFSInfoSect;		//!< FAT32 FSInfo sector, 0 if none
+	uint32_t	vFreeCnt;			//!< Number of free clusters
+	uint32_t	vNextFree;			//!< Next free cluster hint
+	bool		vbInfoDirty;		//!< FSInfo needs update
+	uint32_t	*vpFreeMap;			//!< Free cluster map, bit set if group may have free clusters
+	uint32_t	vFreeMapBits;		//!< Number of groups in map
+	int			vFreeGrpShift;		//!< log2 of number of clusters per group
+	uint32_t	vFreeMapDef[FATFS_FREEMAP_SIZE];	//!< Default free cluster map
+	FATFS_DIRCACHE *vpDirCache;		//!< Directory cache
+	int			vDirCacheSize;		//!< Number of directory cache entries
+	FATFS_DIRCACHE vDirCacheDef[FATFS_DIRCACHE_SIZE];	//!< Default directory cache
+	FATFSTIMECB	vTimeCB;			//!< Date and time for directory entries
 	DiskIO		*vDiskIO;
 	DISKPART 	vPartData;			//!< Partition data
-	FATFS_FD 	vOpenFiles[MAX_FILE];	//!< Keep list of open files
-	//uint8_t 	vSectData[512];		// Temp sector data
-	//uint32_t 	vSectNo;			// Absolute sector # of the current temp sector data
+	FATFS_FD	*vpFdTbl;			//!< File handle table
+	int			vFdTblSize;			//!< Number of entries in vpFdTbl
+	int			vFreeFd;			//!< First free handle index, -1 if none
+	FATFS_FD 	vFdDef[MAX_FILE];	//!< Default file handle table
 };
 
 extern "C" {
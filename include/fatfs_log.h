@@ -0,0 +1,219 @@
+/**-------------------------------------------------------------------------
+@file	fatfs_log.h
+
+@brief	Streaming record logger on a preallocated FatFS file
+
+Appends records, such as sensor samples, to a FAT file with a bounded write
+latency.  The file clusters are reserved up front with FatFS::Allocate, in one
+run of consecutive clusters.  Records are gathered in a sector buffer which is
+written directly to the disk sectors of the file, bypassing FatFS and the
+DiskIO cache.  There is no FAT update while logging, the directory entry is
+only written to update the file size every CommitInterval sectors, on Sync
+and on Close.
+
+File layout : the file is a sequence of sectors, each starting with a header
+holding the sector index in the file, the log session identifier, the number
+of bytes used and a CRC16 of them.  Records follow, each one is a 16 bits
+length followed by data.  Records do not span sectors.
+
+Power failure : sectors below the file size are never written again.  Init
+scans the sectors past the file size written after the last size update of
+the same session, and extends the file size over the valid ones.  Data is
+stored at the latest when Sync returns.  Sync closes the sector being filled,
+the rest of it is left unused.  Each Init starts a new session in a new
+sector, stale sectors of previous sessions left in the reserved clusters do
+not match it.
+
+Close releases the reserved clusters past the data, the file is then a
+regular FAT file of whole sectors.
+
+Usage :
+
+FatFS g_Fs;
+
+static uint8_t s_LogBuff[8 * 512];
+
+static const FATFSLOG_CFG s_LogCfg = {
+	"/log.bin",
+	64 * 1024 * 1024,			// Reserve 64MB
+	64,							// Update file size every 64 sectors
+	s_LogBuff,
+	sizeof(s_LogBuff)
+};
+
+FatFSLog g_Log;
+
+g_Log.Init(s_LogCfg, &g_Fs);
+
+g_Log.Append(&sample, sizeof(sample));
+...
+g_Log.Close();
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __FATFS_LOG_H__
+#define __FATFS_LOG_H__
+
+#include <stdint.h>
+
+#include "fatfs.h"
+
+/** @addtogroup Storage
+  * @{
+  */
+
+#define FATFSLOG_MAGIC				0x4C534649	//!< 'IFSL' sector header signature
+
+#pragma pack(push, 4)
+
+/// Sector header, at offset 0 of each sector of the log file
+typedef struct __FatFSLog_Sect_Hdr {
+	uint32_t Magic;			//!< FATFSLOG_MAGIC
+	uint32_t Session;		//!< Log session identifier
+	uint32_t Idx;			//!< Sector index in file
+	uint16_t Len;			//!< Bytes used in sector, header included
+	uint16_t Crc;			//!< crc16 ccitt of used bytes, with Crc set to 0
+} FATFSLOG_SECTHDR;
+
+#pragma pack(pop)
+
+typedef struct __FatFSLog_Cfg {
+	const char *pPathName;		//!< Log file path name, created if not found
+	uint32_t MaxSize;			//!< Log file size to reserve in bytes
+	uint32_t CommitInterval;	//!< Sectors written between file size updates, 0 - only by Sync and Close
+	void *pMem;					//!< Sector buffer, one or more disk sectors
+	uint32_t MemSize;			//!< Size of pMem in bytes
+} FATFSLOG_CFG;
+
+/// @brief	Streaming record logger on a preallocated FatFS file
+class FatFSLog {
+public:
+	FatFSLog();
+	virtual ~FatFSLog() {}
+
+	/**
+	 * @brief	Open log file, recover data written after the last file size
+	 * 			update and reserve clusters up to the configured size.
+	 *
+	 * @param	Cfg		: Configuration data
+	 * @param	pFs		: File system
+	 *
+	 * @return
+	 * 			- true 	: Success
+	 * 			- false	: Failed, not enough contiguous free space or existing
+	 * 					  file is not a log
+	 */
+	bool Init(const FATFSLOG_CFG &Cfg, FatFS * const pFs);
+
+	/**
+	 * @brief	Append a record.
+	 *
+	 * The record is copied to the sector buffer.  The buffer is written to disk
+	 * when full, in one request.
+	 *
+	 * @param	pData	: Record data
+	 * @param	Len		: Data length in bytes, max GetMaxRecLen
+	 *
+	 * @return
+	 * 			- true 	: Success
+	 * 			- false	: Failed, reserved space full or disk error
+	 */
+	bool Append(const void *pData, int Len);
+
+	/**
+	 * @brief	Write buffered records and update file size.
+	 *
+	 * The sector being filled is closed, next record starts a new sector.
+	 *
+	 * @return	true - Success
+	 */
+	bool Sync();
+
+	/**
+	 * @brief	Sync, release reserved clusters past the data and close the file.
+	 *
+	 * @return	true - Success
+	 */
+	bool Close();
+
+	/**
+	 * @brief	Read record and advance position to next record
+	 *
+	 * Records are read through FatFS up to the file size, ie. as of the last
+	 * Sync or file size update.  Sectors with an invalid header are skipped.
+	 *
+	 * @param	Pos		: Position in file, 0 for the first record
+	 * @param	pBuff	: Buffer to receive data, truncated to BuffLen
+	 * @param	BuffLen	: Buffer size in bytes
+	 *
+	 * @return	Record data length, -1 if no more records
+	 */
+	int Read(uint32_t &Pos, uint8_t *pBuff, int BuffLen);
+
+	int GetMaxRecLen() { return vMaxRecLen; }			//!< Largest record data length
+	uint32_t GetNbSect() { return vBuffIdx + vCur; }	//!< Sectors closed since file start
+
+private:
+	bool Mount(uint32_t MaxSize);
+	int MapRun(uint32_t Idx, uint32_t &SectNo);
+	bool IsValid(uint8_t *pSect, uint32_t Idx);
+	void StartSect();
+	void CloseSect();
+	bool WriteBuff(int NbSect);
+	bool Commit(uint32_t NbSect);
+	uint32_t Recover(uint32_t Idx);
+
+	FatFS *vpFs;				//!< File system
+	DiskIO *vpDisk;				//!< Disk holding the file system
+	int vFd;					//!< Log file handle
+	uint32_t vSectSize;			//!< Disk sector size
+	int vMaxRecLen;				//!< Max record data length
+	uint32_t vSession;			//!< Session identifier of sectors written
+	uint8_t *vpBuff;			//!< Sector buffer
+	int vNbBuff;				//!< Number of sectors in buffer
+	int vCur;					//!< Buffer sector being filled
+	uint32_t vOff;				//!< Write offset in sector being filled
+	uint32_t vBuffIdx;			//!< File sector index of the first buffer sector
+	uint32_t vCommitIdx;		//!< File size in sectors last written to directory entry
+	uint32_t vCommitIval;		//!< Sectors written between file size updates
+	uint32_t vRunIdx;			//!< File sector index of the disk run mapped
+	uint32_t vRunSect;			//!< Disk sector of vRunIdx
+	uint32_t vRunLen;			//!< Number of sectors in the run
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} End of group Storage */
+
+#endif	// __FATFS_LOG_H__
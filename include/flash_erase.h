@@ -0,0 +1,190 @@
+/**-------------------------------------------------------------------------
+@file	flash_erase.h
+
+@brief	Background erase manager for raw NOR flash
+
+Keeps a pool of erased blocks ready so that a block needed for writing is
+available without waiting for its erase.  Blocks no longer needed are
+released to the manager, which erases them in the background from a timer
+trigger or from calls to Run in idle time.  Only one erase is started per
+call and Run returns right away, it never waits for the flash.
+
+Run does nothing while a FlashDiskIO access is ongoing, so it can be called
+from an interrupt.  Reads and programs outside of the block being erased
+suspend the erase when the device supports it (SFDP erase suspend), write
+latency is then bounded by the suspend latency rather than the erase time.
+
+Block state is kept in RAM only.  At Init all blocks belong to the user, who
+releases the free ones, telling which are known to be erased.
+
+Usage :
+
+// Raw flash
+FlashDiskIO g_Flash;
+
+static uint8_t s_EraseMem[FLASHERASE_MEMSIZE(128)];
+
+static const FLASHERASE_CFG s_EraseCfg = {
+	128,						// Start at erase block 128
+	128,						// 128 blocks
+	4,							// Keep 4 blocks erased ahead
+	10,							// Run every 10 ms
+	1,							// Timer trigger 1
+	s_EraseMem,
+	sizeof(s_EraseMem)
+};
+
+FlashEraseMgr g_EraseMgr;
+
+g_Flash.Init(s_FlashDiskCfg, &g_Spi);
+g_EraseMgr.Init(s_EraseCfg, &g_Flash, &g_Timer);
+
+for (int i = 128; i < 256; i++)
+	g_EraseMgr.Release(i);
+
+int blk = g_EraseMgr.Acquire();		// Erased block to write
+...
+g_EraseMgr.Release(blk);			// Content no longer needed
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __FLASH_ERASE_H__
+#define __FLASH_ERASE_H__
+
+#include <stdint.h>
+
+#include "coredev/timer.h"
+#include "diskio_flash.h"
+
+/** @addtogroup Storage
+  * @{
+  */
+
+#define FLASHERASE_BLK_USED			0		//!< Block belongs to the user
+#define FLASHERASE_BLK_DIRTY		1		//!< Released, waiting to be erased
+#define FLASHERASE_BLK_ERASING		2		//!< Erase in progress
+#define FLASHERASE_BLK_ERASED		3		//!< Erased, ready to be acquired
+
+/// Memory in bytes required to manage NbBlk erase blocks
+#define FLASHERASE_MEMSIZE(NbBlk)	(NbBlk)
+
+typedef struct __FlashErase_Cfg {
+	uint32_t StartBlk;		//!< First erase block managed
+	uint32_t NbBlk;			//!< Number of erase blocks managed
+	uint32_t PoolSize;		//!< Number of erased blocks to keep ready, 0 - erase all released blocks
+	uint32_t Period;		//!< Timer trigger period in msec
+	int TimerTrigNo;		//!< Timer trigger to use when running from a timer
+	void *pMem;				//!< Memory for block state, see FLASHERASE_MEMSIZE
+	uint32_t MemSize;		//!< Size of pMem in bytes
+} FLASHERASE_CFG;
+
+/// @brief	Background erase manager
+///
+/// Block numbers are flash erase block numbers, as used by FlashDiskIO::EraseBlock.
+class FlashEraseMgr {
+public:
+	FlashEraseMgr();
+	virtual ~FlashEraseMgr() {}
+
+	/**
+	 * @brief	Initialize manager, all blocks belong to the user.
+	 *
+	 * @param	Cfg		: Configuration data
+	 * @param	pFlash	: Raw flash
+	 * @param	pTimer	: Timer running the background erase, NULL - user calls Run
+	 *
+	 * @return
+	 * 			- true 	: Success
+	 * 			- false	: Failed
+	 */
+	bool Init(const FLASHERASE_CFG &Cfg, FlashDiskIO * const pFlash, Timer * const pTimer = NULL);
+
+	/**
+	 * @brief	Give a block back to the manager
+	 *
+	 * @param	BlkNo	: Block number
+	 * @param	bErased	: true - block is known to be erased, ex. at startup
+	 */
+	void Release(uint32_t BlkNo, bool bErased = false);
+
+	/**
+	 * @brief	Take an erased block
+	 *
+	 * When the pool is empty, the erase in progress is waited for or a
+	 * released block is erased.
+	 *
+	 * @param	bWait	: false - do not wait for an erase, return -1 instead
+	 *
+	 * @return	Block number, -1 if none available
+	 */
+	int Acquire(bool bWait = true);
+
+	/**
+	 * @brief	Background step
+	 *
+	 * Marks the erase in progress complete once the flash is ready and starts
+	 * the next one if the pool is short of erased blocks.  Returns without
+	 * waiting.  Called by the timer trigger or from idle loop.
+	 */
+	void Run();
+
+	int GetNbErased() { return vNbErased; }		//!< Blocks ready to be acquired
+	int GetNbDirty() { return vNbDirty; }		//!< Blocks waiting to be erased
+	uint32_t GetWaitCount() { return vWaitCnt; }	//!< Acquire calls that had to wait for an erase
+
+private:
+	void Update();
+	int Find(uint8_t State, uint32_t &Cursor);
+
+	static void TimerHandler(Timer * const pTimer, int TrigNo, void * const pCtx);
+
+	FlashDiskIO *vpFlash;		//!< Raw flash
+	uint32_t vStartBlk;			//!< First block managed
+	uint32_t vNbBlk;			//!< Number of blocks managed
+	uint32_t vPoolSize;			//!< Erased blocks to keep ready
+	uint8_t *vpState;			//!< Block state, FLASHERASE_BLK_xxx
+	int vErasing;				//!< Block being erased, -1 if none
+	int vNbErased;				//!< Number of erased blocks
+	int vNbDirty;				//!< Number of blocks waiting for erase
+	uint32_t vDirtyCur;			//!< Next block checked for erase
+	uint32_t vErasedCur;		//!< Next block checked for acquire
+	uint32_t vWaitCnt;			//!< Acquire that waited
+	bool vbLock;				//!< Block state being updated
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} End of group Storage */
+
+#endif	// __FLASH_ERASE_H__
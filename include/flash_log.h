@@ -0,0 +1,275 @@
+/**-------------------------------------------------------------------------
+@file	flash_log.h
+
+@brief	Append only record store on raw NOR flash
+
+Stores timestamped records, such as sensor samples, directly in FlashDiskIO
+pages without a file system.  Appending a record costs one page program per
+flash page it touches, there is no read-modify-write and no metadata update.
+
+Flash layout : the flash range is split in segments of one erase block, used
+as a ring.  Each segment starts with a header holding a sequence number and
+the time of its first record, followed by records packed on 4 bytes.  A record
+header holds the data length, the record time and a CRC16 of both plus the
+data.  When the ring is full the oldest segment is erased for the new one.
+
+Power failure : records are programmed in order.  A record cut during
+programming fails its CRC and is skipped when reading.  Init reads the
+segment headers then scans only the newest segment to find the end of the
+log.  If anything but erased flash follows the last record, writing resumes in
+a new segment.  A record is stored once the flash completes its program, at
+the latest when Sync returns.
+
+Records can be looked up by time, segments are located by binary search of
+their first record time.  Record times must not decrease for Seek to work.
+
+Usage :
+
+// Raw flash
+FlashDiskIO g_Flash;
+
+static uint32_t s_LogMem[FLASHLOG_MEMSIZE(64, 256) / 4];
+
+static const FLASHLOG_CFG s_LogCfg = {
+	256,						// Start at erase block 256
+	64,							// 64 segments
+	s_LogMem,
+	sizeof(s_LogMem)
+};
+
+FlashLog g_Log;
+
+g_Flash.Init(s_FlashDiskCfg, &g_Spi);
+g_Log.Init(s_LogCfg, &g_Flash);
+
+g_Log.Append(time, &sample, sizeof(sample));
+
+FLASHLOG_POS pos;
+uint32_t t;
+
+g_Log.Seek(pos, starttime);
+while ((len = g_Log.Read(pos, &t, buff, sizeof(buff))) >= 0)
+{
+	...
+}
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __FLASH_LOG_H__
+#define __FLASH_LOG_H__
+
+#include <stdint.h>
+
+#include "diskio_flash.h"
+
+/** @addtogroup Storage
+  * @{
+  */
+
+#define FLASHLOG_MAGIC				0x474C4649	//!< 'IFLG' segment header signature
+#define FLASHLOG_REC_BLANK			0xFFFF		//!< Record length of erased flash
+
+#pragma pack(push, 4)
+
+/// Segment header, at offset 0 of each segment
+typedef struct __FlashLog_Seg_Hdr {
+	uint32_t Magic;			//!< FLASHLOG_MAGIC, cleared when segment is discarded
+	uint32_t Seq;			//!< Segment sequence number, starts at 1
+	uint32_t Time;			//!< Time of first record
+	uint32_t Crc;			//!< crc32 of Magic, Seq and Time
+} FLASHLOG_SEGHDR;
+
+/// Record header, followed by record data
+typedef struct __FlashLog_Rec_Hdr {
+	uint16_t Len;			//!< Data length in bytes
+	uint16_t Crc;			//!< crc16 ccitt of Len, Time and data
+	uint32_t Time;			//!< Record time
+} FLASHLOG_RECHDR;
+
+#pragma pack(pop)
+
+/// Segment run time state
+typedef struct __FlashLog_Seg_Info {
+	uint32_t Seq;			//!< Sequence number, 0 if segment is free
+	uint32_t Time;			//!< Time of first record
+} FLASHLOG_SEGINFO;
+
+/// Record position, for reading
+typedef struct __FlashLog_Pos {
+	uint32_t Seq;			//!< Segment sequence number
+	uint32_t Off;			//!< Record offset in segment
+} FLASHLOG_POS;
+
+/// Memory in bytes required for NbSeg segments on flash with PageSize write page
+#define FLASHLOG_MEMSIZE(NbSeg, PageSize)	((NbSeg) * sizeof(FLASHLOG_SEGINFO) + (PageSize))
+
+typedef struct __FlashLog_Cfg {
+	uint32_t StartBlk;		//!< First erase block used
+	uint32_t NbSeg;			//!< Number of segments (erase blocks), min 2
+	void *pMem;				//!< Memory for segment index and page buffer, see FLASHLOG_MEMSIZE
+	uint32_t MemSize;		//!< Size of pMem in bytes
+} FLASHLOG_CFG;
+
+/// @brief	Append only record store
+class FlashLog {
+public:
+	FlashLog();
+	virtual ~FlashLog() {}
+
+	/**
+	 * @brief	Initialize record store and locate the end of the log.
+	 *
+	 * @param	Cfg		: Configuration data
+	 * @param	pFlash	: Raw flash
+	 *
+	 * @return
+	 * 			- true 	: Success
+	 * 			- false	: Failed
+	 */
+	bool Init(const FLASHLOG_CFG &Cfg, FlashDiskIO * const pFlash);
+
+	/**
+	 * @brief	Append a record.
+	 *
+	 * A new segment is started when the record does not fit in the current
+	 * one, erasing the oldest segment when all are used.
+	 *
+	 * @param	Time	: Record time
+	 * @param	pData	: Record data
+	 * @param	Len		: Data length in bytes, max GetMaxRecLen
+	 *
+	 * @return
+	 * 			- true 	: Success
+	 * 			- false	: Failed
+	 */
+	bool Append(uint32_t Time, const void *pData, int Len);
+
+	/**
+	 * @brief	Wait until the last appended record is stored
+	 */
+	void Sync();
+
+	/**
+	 * @brief	Set position to oldest record
+	 *
+	 * @param	Pos	: Position to set
+	 *
+	 * @return	false - Log is empty
+	 */
+	bool First(FLASHLOG_POS &Pos);
+
+	/**
+	 * @brief	Set position to first record at or after a time
+	 *
+	 * @param	Pos		: Position to set
+	 * @param	Time	: Time to look for
+	 *
+	 * @return	false - No record at or after Time
+	 */
+	bool Seek(FLASHLOG_POS &Pos, uint32_t Time);
+
+	/**
+	 * @brief	Read record and advance position to next record
+	 *
+	 * Records failing CRC are skipped.  A position in a segment discarded
+	 * since is moved to the oldest record.
+	 *
+	 * @param	Pos		: Record position
+	 * @param	pTime	: Receives record time (optional)
+	 * @param	pBuff	: Buffer to receive data, truncated to BuffLen
+	 * @param	BuffLen	: Buffer size in bytes
+	 *
+	 * @return	Record data length, -1 if no more records
+	 */
+	int Read(FLASHLOG_POS &Pos, uint32_t *pTime, uint8_t *pBuff, int BuffLen);
+
+	/**
+	 * @brief	Discard oldest segments holding only records before a time
+	 *
+	 * @param	Time	: Records before this time may be discarded
+	 *
+	 * @return	Number of segments discarded
+	 */
+	int Trim(uint32_t Time);
+
+	/**
+	 * @brief	Erase the next segment ahead of time.
+	 *
+	 * Can be called when idle to avoid the erase delay on the append starting
+	 * a new segment.  When all segments are used the oldest one is discarded.
+	 *
+	 * @return
+	 * 			- true	: Next segment erased
+	 * 			- false	: Erase failed, retried by the next Prepare or Append
+	 */
+	bool Prepare();
+
+	/**
+	 * @brief	Erase all segments
+	 */
+	void Erase();
+
+	int GetMaxRecLen() { return vMaxRecLen; }			//!< Largest record data length
+	uint32_t GetNbSegUsed() { return vNbUsed; }		//!< Segments holding records
+	uint32_t GetSegSize() { return vSegSize; }		//!< Segment size in bytes
+
+private:
+	bool Mount();
+	bool OpenSeg(uint32_t Time);
+	void Discard(uint32_t Seg);
+	bool Locate(FLASHLOG_POS &Pos, FLASHLOG_RECHDR &Hdr);
+	uint32_t SegNo(uint32_t Seq) { return (vHead + vNbSeg - (vHeadSeq - Seq)) % vNbSeg; }
+	uint32_t SegAddr(uint32_t Seg) { return (vStartBlk + Seg) * vSegSize; }
+	uint32_t RecSize(int Len) { return (sizeof(FLASHLOG_RECHDR) + Len + 3) & ~3; }
+
+	FlashDiskIO *vpFlash;		//!< Raw flash
+	uint32_t vSegSize;			//!< Segment size, flash erase size
+	uint32_t vPageSize;			//!< Flash write page size
+	int vMaxRecLen;				//!< Max record data length
+	uint32_t vStartBlk;			//!< First erase block used
+	uint32_t vNbSeg;			//!< Number of segments
+	uint32_t vNbUsed;			//!< Segments holding records
+	uint32_t vHead;				//!< Segment being written
+	uint32_t vHeadSeq;			//!< Sequence number of segment being written
+	uint32_t vWrOff;			//!< Write offset in segment being written
+	bool vbNextErased;			//!< Segment following head erased by Prepare
+	FLASHLOG_SEGINFO *vpSeg;	//!< Segment index
+	uint8_t *vpPage;			//!< Page buffer
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} End of group Storage */
+
+#endif	// __FLASH_LOG_H__
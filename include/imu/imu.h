@@ -66,6 +66,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 typedef uint32_t	IMU_FEATURE;
 
+#define IMU_CALIB_GYRO_SAMPLES				256			//!< Still gyro samples collected by Calibrate
+
 #if 0
 /// Quaternion data
 /// The quaternion is a normalized number.  For more compact structure
@@ -168,7 +170,20 @@ public:
 	virtual bool Init(const IMU_CFG &Cfg, AccelSensor * const pAccel, GyroSensor * const pGyro, MagSensor * const pMag);
 	virtual bool UpdateData() = 0;
 	virtual void IntHandler() = 0;
-	virtual bool Calibrate() = 0;
+
+	/**
+	 * @brief	Calibrate gyro bias
+	 *
+	 * The device must be kept still.  Collects IMU_CALIB_GYRO_SAMPLES gyro samples
+	 * with GyroCalib and applies the bias to the gyro sensor, keeping its
+	 * temperature coefficient unless the temperature changed enough during
+	 * collection to fit a new one.  Accelerometer and magnetometer calibrations
+	 * need the device to be moved, use AccelCalib and MagCalib for them.
+	 *
+	 * @return	true - Success
+	 * 			false - Device moved or no gyro data, calibration is unchanged
+	 */
+	virtual bool Calibrate();
 	virtual void SetAxisAlignmentMatrix(int8_t * const pMatrix) = 0;
 	virtual bool Compass(bool bEn) = 0;
 	virtual bool Pedometer(bool bEn) = 0;
@@ -52,7 +52,6 @@ public:
 	virtual bool UpdateData();
 	virtual void IntHandler() {inv_icm20948_poll_sensor(vpIcmDevice, (void*)this, SensorEventHandler);}
 	virtual IMU_FEATURE Feature(IMU_FEATURE FeatureBit, bool bEnDis);
-	virtual bool Calibrate();
 	virtual void SetAxisAlignmentMatrix(int8_t * const pMatrix) ;
 	virtual bool Compass(bool bEn);
 	virtual bool Pedometer(bool bEn);
@@ -39,6 +39,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "imu/imu.h"
 #include "sensors/agm_mpu9250.h"
+#include "sensors/sensor_timestamp.h"
 
 /** @addtogroup IMU
   * @{
@@ -53,7 +54,6 @@ public:
 	virtual bool UpdateData();
 	virtual void IntHandler();
 	uint32_t Rate(uint32_t DataRate);
-	bool Calibrate();
 	void SetAxisAlignmentMatrix(int8_t * const pMatrix);
 	virtual bool Compass(bool bEn);
 	virtual bool Pedometer(bool bEn);
@@ -147,6 +147,8 @@ private:
 
 	AgmMpu9250 *vpMpu;
 	int vDmpFifoLen;
+	SensorTimeEst vTsEst;	//!< DMP packet time stamp estimator
+	uint32_t vFifoIdx;		//!< Index of next DMP packet to be read from FIFO
 };
 
 /** @} end group IMU */
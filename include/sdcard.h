@@ -42,6 +42,12 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define SDCARD_CACHE_MAX		2
 
+/// Bytes clocked per poll while waiting for a data token or end of busy.  The
+/// window is scanned at once, data following the token is kept.
+#ifndef SDCARD_TOKEN_WIN
+#define SDCARD_TOKEN_WIN		16
+#endif
+
 #pragma pack(push, 4)
 
 // CSD register
@@ -55,6 +61,7 @@ typedef struct {
 typedef struct {
 	int Rate;
 	DEVINTRF *pSerIntrf;
+	bool bNoCrc;			//!< true - CRC disabled with CMD59, for trusted links
 } SDCFG;
 
 typedef struct {
@@ -62,6 +69,7 @@ typedef struct {
 	int TotalSect;
 	SDCSD Csd;
 	DEVINTRF *pSerIntrf;
+	bool bCrc;				//!< Data CRC checked
 } SDDEV;
 
 #pragma pack(pop)
@@ -86,7 +94,47 @@ public:
 	int Cmd(uint8_t Cmd, uint32_t param);
 	int GetResponse(uint8_t *pBuff, int BuffLen);
 	int ReadData(uint8_t *pBuff, int BuffLen);
-	int WriteData(uint8_t *pData, int Len);
+	int WriteData(uint8_t *pData, int Len, uint8_t Token = 0xfe);
+
+	/**
+	 * @brief	Poll once for the data token, receive data once it is found
+	 *
+	 * One window of SDCARD_TOKEN_WIN bytes is clocked and scanned.  Data and CRC
+	 * are received in the same call when the token is in the window.
+	 *
+	 * @param	pBuff	: Buffer to receive data
+	 * @param	BuffLen	: Data length in bytes
+	 *
+	 * @return	Data length received\n
+	 * 			0 - token not yet sent\n
+	 * 			-1 - error token, stored in pBuff[0]\n
+	 * 			-2 - CRC error
+	 */
+	int PollData(uint8_t *pBuff, int BuffLen);
+
+	/**
+	 * @brief	Poll once for end of busy, one byte is clocked
+	 *
+	 * @return	true - card is busy
+	 */
+	bool IsBusy();
+
+	/**
+	 * @brief	Send stop transmission token ending CMD25.  Card is then busy.
+	 */
+	void StopTran();
+
+	/**
+	 * @brief	Enable or disable CRC with CMD59 (CRC_ON_OFF)
+	 *
+	 * CRC is enabled by Init.  When disabled, read data is not checked and
+	 * write data is sent with a dummy CRC, for trusted links.
+	 *
+	 * @param	bEnable	: true - CRC checked by card and driver
+	 *
+	 * @return	true - Success
+	 */
+	bool Crc(bool bEnable);
 	int GetSectSize(void);
 	uint32_t GetNbSect(void);
 	// @return size in KB
@@ -99,15 +147,48 @@ public:
 	bool SectWrite(uint32_t SectNo, uint8_t *pData) {
 		return WriteSingleBlock(SectNo, pData, vDev.SectSize) == vDev.SectSize;
 	}
+
+	/**
+	 * @brief	Read consecutive blocks with CMD18 (READ_MULTIPLE_BLOCK)
+	 *
+	 * @param	Addr	: Start block address
+	 * @param	pData	: Buffer to receive data, at least NbBlk blocks
+	 * @param	NbBlk	: Number of blocks to read
+	 *
+	 * @return	Number of blocks read
+	 */
+	int ReadMultiBlock(uint32_t Addr, uint8_t *pData, int NbBlk);
+
+	/**
+	 * @brief	Write consecutive blocks with CMD25 (WRITE_MULTIPLE_BLOCK)
+	 *
+	 * The card is first told with ACMD23 to pre-erase the blocks to be written.
+	 *
+	 * @param	Addr	: Start block address
+	 * @param	pData	: Data to write, at least NbBlk blocks
+	 * @param	NbBlk	: Number of blocks to write
+	 *
+	 * @return	Number of blocks written
+	 */
+	int WriteMultiBlock(uint32_t Addr, uint8_t *pData, int NbBlk);
+	int SectReadMulti(uint32_t SectNo, uint8_t *pBuff, int NbSect) {
+		return ReadMultiBlock(SectNo, pBuff, NbSect);
+	}
+	int SectWriteMulti(uint32_t SectNo, uint8_t *pData, int NbSect) {
+		return WriteMultiBlock(SectNo, pData, NbSect);
+	}
 	//operator SDDEV *() { return &vDev; };
 
 protected:
 private:
+	void WaitBusy();
+
 	//std::shared_ptr<SerialIntrf> vpInterf;
 	DeviceIntrf *vpInterf;
 	SDDEV vDev;
 	int NbCacheBlk;
 	DISKIO_CACHE_DESC vCacheDesc[SDCARD_CACHE_MAX];
+	bool vbCrc;				//!< Data CRC checked
 };
 
 extern "C" {
@@ -120,6 +201,32 @@ int SDReadData(SDDEV * const pDev, uint8_t *pBuff, int BuffLen);
 int SDWriteData(SDDEV * const pDev, uint8_t *pData, int DataLen);
 int SDReadSingleBlock(SDDEV * const pDev, uint32_t Addr, uint8_t *pData, int len);
 int SDWriteSingleBlock(SDDEV * const pDev, uint32_t Addr, uint8_t *pData, int len);
+
+/**
+ * @brief	Read consecutive blocks with CMD18 (READ_MULTIPLE_BLOCK)
+ *
+ * @param	pDev	: Device data
+ * @param	Addr	: Start block address
+ * @param	pData	: Buffer to receive data, at least NbBlk blocks
+ * @param	NbBlk	: Number of blocks to read
+ *
+ * @return	Number of blocks read
+ */
+int SDReadMultiBlock(SDDEV * const pDev, uint32_t Addr, uint8_t *pData, int NbBlk);
+
+/**
+ * @brief	Write consecutive blocks with CMD25 (WRITE_MULTIPLE_BLOCK)
+ *
+ * The card is first told with ACMD23 to pre-erase the blocks to be written.
+ *
+ * @param	pDev	: Device data
+ * @param	Addr	: Start block address
+ * @param	pData	: Data to write, at least NbBlk blocks
+ * @param	NbBlk	: Number of blocks to write
+ *
+ * @return	Number of blocks written
+ */
+int SDWriteMultiBlock(SDDEV * const pDev, uint32_t Addr, uint8_t *pData, int NbBlk);
 uint32_t SDGetSize(SDDEV * const pDev);
 
 #ifdef __cplusplus
@@ -0,0 +1,192 @@
+/**-------------------------------------------------------------------------
+@file	sdcard_async.h
+
+@brief	Non-blocking SD card block request queue
+
+Queues block reads and writes to an SD card and runs them as a state machine
+advanced by Process.  Each Process call runs at most one protocol phase : a
+command sequence, one poll for a data token, one block transfer or one poll
+for end of busy.  It never waits for the card, a call made while the card is
+busy or still looking up data clocks one byte or one token window and returns.
+Process is meant to be called from the main loop, a timer event or the SPI
+completion event, as long as it is not called reentrantly.  Completion is
+signaled by the request callback, called from Process.
+
+Requests of the same direction on consecutive blocks are run as one CMD18 or
+CMD25 stream.  A read stream continues into requests submitted while it runs.
+A write stream is pre-erased with ACMD23 for the blocks queued when it starts
+and ends with them, the requests submitted meanwhile start a new stream.
+
+Data is transferred straight from and to the request buffers, which must stay
+valid until completion.  The card must be initialized with SDCard::Init first
+and its synchronous functions, DiskIO cache included, must not be used while
+requests are pending.
+
+Submit and Process can be called from different contexts, ex. Submit from the
+main loop and Process from a timer interrupt, the queue has a single producer
+and a single consumer.
+
+Usage :
+
+static SDCARDASYNC_REQ s_SdReq[16];
+
+static const SDCARDASYNC_CFG s_SdAsyncCfg = {
+	s_SdReq,
+	sizeof(s_SdReq) / sizeof(SDCARDASYNC_REQ)
+};
+
+SDCard g_SdCard;
+SDCardAsync g_SdAsync;
+
+void WriteDone(SDCARDASYNC_REQ * const pReq, int Result)
+{
+	// Result : number of blocks written
+}
+
+g_SdCard.Init(&g_Spi, NULL, 0);
+g_SdAsync.Init(s_SdAsyncCfg, &g_SdCard);
+
+SDCARDASYNC_REQ req = { SDCARDASYNC_OP_WRITE, 1000, s_Buff, 8, WriteDone, NULL };
+
+g_SdAsync.Submit(req);
+
+while (1)
+{
+	g_SdAsync.Process();
+	...
+}
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __SDCARD_ASYNC_H__
+#define __SDCARD_ASYNC_H__
+
+#include <stdint.h>
+
+#include "sdcard.h"
+
+/** @addtogroup Storage
+  * @{
+  */
+
+#define SDCARDASYNC_OP_READ			0
+#define SDCARDASYNC_OP_WRITE		1
+
+/// Polls of a data token or end of busy before the request fails
+#ifndef SDCARDASYNC_POLL_MAX
+#define SDCARDASYNC_POLL_MAX		1000000
+#endif
+
+typedef struct __SDCard_Async_Req SDCARDASYNC_REQ;
+
+/**
+ * @brief	Request completion callback
+ *
+ * Called from Process.  New requests can be submitted from the callback.
+ *
+ * @param	pReq	: Copy of the completed request, only valid during the call
+ * @param	Result	: Number of blocks transfered, less than NbBlk on failure
+ */
+typedef void (*SDCARDASYNC_CB)(SDCARDASYNC_REQ * const pReq, int Result);
+
+struct __SDCard_Async_Req {
+	int Op;						//!< SDCARDASYNC_OP_READ or SDCARDASYNC_OP_WRITE
+	uint32_t Addr;				//!< Start block address
+	uint8_t *pData;				//!< Data buffer of NbBlk blocks, valid until completion
+	int NbBlk;					//!< Number of blocks
+	SDCARDASYNC_CB CompleteCB;	//!< Completion callback, NULL if not used
+	void *pCtx;					//!< Caller data
+};
+
+typedef struct __SDCard_Async_Cfg {
+	SDCARDASYNC_REQ *pReqMem;	//!< Request queue memory
+	int NbReq;					//!< Queue depth
+} SDCARDASYNC_CFG;
+
+/// @brief	Non-blocking SD card block request queue
+class SDCardAsync {
+public:
+	SDCardAsync();
+	virtual ~SDCardAsync() {}
+
+	/**
+	 * @brief	Initialize request queue
+	 *
+	 * @param	Cfg		: Configuration data
+	 * @param	pCard	: Initialized SD card
+	 *
+	 * @return	true - Success
+	 */
+	bool Init(const SDCARDASYNC_CFG &Cfg, SDCard * const pCard);
+
+	/**
+	 * @brief	Queue a block read or write request
+	 *
+	 * The request is copied, the data buffer is used as is until completion.
+	 *
+	 * @param	Req	: Request
+	 *
+	 * @return
+	 * 			- true 	: Success
+	 * 			- false	: Queue full or invalid request
+	 */
+	bool Submit(const SDCARDASYNC_REQ &Req);
+
+	/**
+	 * @brief	Advance pending requests by one protocol phase, without waiting
+	 *
+	 * @return	true - Requests pending, Process must be called again
+	 */
+	bool Process();
+
+	int GetNbPending() { return vTail - vHead; }	//!< Requests queued or in progress
+
+private:
+	void Start();
+	void NextBlock();
+	void Stop();
+	void Complete(int Result);
+	uint32_t StreamLen();
+
+	SDCard *vpCard;
+	SDCARDASYNC_REQ *vpQue;
+	int vQueSize;
+	volatile uint32_t vHead;	//!< Request in progress, advanced by Process only
+	volatile uint32_t vTail;	//!< Next free entry, advanced by Submit only
+	int vSectSize;
+	int vPhase;					//!< Protocol phase of request in progress
+	int vOp;					//!< Direction of the current stream
+	bool vbMulti;				//!< CMD18 or CMD25 stream
+	uint32_t vStreamLeft;		//!< Blocks left in stream, pre-erased blocks for write
+	int vBlkIdx;				//!< Blocks done in request in progress
+	uint32_t vPollCnt;			//!< Polls in current phase
+};
+
+/** @} End of group Storage */
+
+#endif	// __SDCARD_ASYNC_H__
@@ -91,6 +91,8 @@ typedef struct __AccelSensor_Config {
 /// Accel. sensor base class
 class AccelSensor : public Sensor {
 public:
+	AccelSensor() : vCnvScale(0), vCnvRange(0) { SensorCalibIdentity(&vCalib); }
+
 
 	/**
 	 * @brief	Sensor initialization
@@ -135,10 +137,14 @@ public:
 	virtual bool Read(ACCELSENSOR_DATA &Data) {
 		if (vData.Range == 0)
 			return false;
+		if (vData.Scale != vCnvScale || vData.Range != vCnvRange)
+		{
+			SensorCalibMerge(vCnvGain, &vCalib, vData.Scale, vData.Range);
+			vCnvScale = vData.Scale;
+			vCnvRange = vData.Range;
+		}
 		Data.Timestamp = vData.Timestamp;
-		Data.X = (float)(vData.X * vData.Scale) / (float)vData.Range;
-        Data.Y = (float)(vData.Y * vData.Scale) / (float)vData.Range;
-        Data.Z = (float)(vData.Z * vData.Scale) / (float)vData.Range;
+		SensorCalibConvert(Data.Val, vCnvGain, vCalib.Offset, vData.Val);
 		return true;
 	}
 
@@ -167,9 +173,35 @@ public:
 	virtual uint32_t LowPassFreq() { return vLPFreq; }
 	virtual uint32_t LowPassFreq(uint32_t Freq) { vLPFreq = Freq; return vLPFreq; }
 
+	/**
+	 * @brief	Set calibration correction.
+	 *
+	 * The correction is merged with the raw data conversion factor so calibrated
+	 * data costs the same to read as uncalibrated data.
+	 *
+	 * @param	Calib : Calibration gain matrix and offset in G
+	 */
+	virtual void SetCalibration(const SENSOR_CALIB &Calib) { vCalib = Calib; vCnvScale = vCnvRange = 0; }
+
+	/**
+	 * @brief	Get current calibration correction.
+	 *
+	 * @return	Calibration data
+	 */
+	virtual const SENSOR_CALIB &Calibration() { return vCalib; }
+
+	/**
+	 * @brief	Remove calibration correction.
+	 */
+	virtual void ClearCalibration() { SensorCalibIdentity(&vCalib); vCnvScale = vCnvRange = 0; }
+
 protected:
 
 	ACCELSENSOR_RAWDATA vData;		//!< Current sensor data updated with UpdateData()
+	SENSOR_CALIB vCalib;			//!< Calibration correction
+	float vCnvGain[3][3];			//!< Calibration gain merged with raw data conversion factor
+	uint16_t vCnvScale;				//!< Scale used to compute vCnvGain
+	uint16_t vCnvRange;				//!< Range used to compute vCnvGain
 
 private:
 	ACCELINTCB vIntHandler;
@@ -349,6 +349,10 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define MPU9250_AG_WHO_AM_I_ID			0x71
 
+// Registers kept in register shadow, MPU9250_AG_SMPLRT_DIV to MPU9250_AG_PWR_MGMT_2
+#define MPU9250_AG_SHADOW_START			MPU9250_AG_SMPLRT_DIV
+#define MPU9250_AG_SHADOW_NBREG			(MPU9250_AG_PWR_MGMT_2 - MPU9250_AG_SMPLRT_DIV + 1)
+
 #define MPU9250_AG_XA_OFFSET_H			0x77
 #define MPU9250_AG_XA_OFFSET_L			0x78
 #define MPU9250_AG_YA_OFFSET_H			0x7A
@@ -518,6 +522,7 @@ private:
 	int16_t vMagSenAdj[3];
 	bool vbSensorEnabled[3];
 	int vTemperature;
+	uint8_t vRegShadow[DEVREGSHADOW_MEMSIZE(MPU9250_AG_SHADOW_NBREG)];
 };
 
 #endif // __cplusplus
@@ -36,6 +36,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define __GYRO_SENSOR_H__
 
 #include <stdint.h>
+#include <string.h>
 
 #include "coredev/iopincfg.h"
 #include "sensors/sensor.h"
@@ -86,6 +87,12 @@ typedef struct __GyroSensor_Config {
 
 class GyroSensor : public Sensor {
 public:
+	GyroSensor() : vCnvScale(0), vCnvRange(0), vTemp(0), vTempRef(0) {
+		SensorCalibIdentity(&vCalib);
+		memset(vTempCoef, 0, sizeof(vTempCoef));
+		UpdateOffset();
+	}
+
 
 	/**
 	 * @brief	Sensor initialization
@@ -116,10 +123,16 @@ public:
 	 * @return	True - Success.
 	 */
 	virtual bool Read(GYROSENSOR_DATA &Data) {
-        Data.Timestamp = vData.Timestamp;
-        Data.X = (float)(vData.X * vData.Scale) / (float)vData.Range;
-        Data.Y = (float)(vData.Y * vData.Scale) / (float)vData.Range;
-        Data.Z = (float)(vData.Z * vData.Scale) / (float)vData.Range;
+		if (vData.Range == 0)
+			return false;
+		if (vData.Scale != vCnvScale || vData.Range != vCnvRange)
+		{
+			SensorCalibMerge(vCnvGain, &vCalib, vData.Scale, vData.Range);
+			vCnvScale = vData.Scale;
+			vCnvRange = vData.Range;
+		}
+		Data.Timestamp = vData.Timestamp;
+		SensorCalibConvert(Data.Val, vCnvGain, vCnvOffset, vData.Val);
 		return true;
 	}
 
@@ -142,11 +155,100 @@ public:
 	 */
 	virtual uint32_t Sensitivity(uint32_t Value) { vSensitivity = Value; return vSensitivity; }
 
+	/**
+	 * @brief	Set calibration correction.
+	 *
+	 * The correction is merged with the raw data conversion factor so calibrated
+	 * data costs the same to read as uncalibrated data.
+	 *
+	 * @param	Calib : Calibration gain matrix and offset in degree/sec
+	 */
+	virtual void SetCalibration(const SENSOR_CALIB &Calib) { vCalib = Calib; vCnvScale = vCnvRange = 0; UpdateOffset(); }
+
+	/**
+	 * @brief	Set calibration correction with temperature compensation.
+	 *
+	 * The offset applied is Calib.Offset - TempCoef * (T - TempRef), where T is the
+	 * last sensor temperature.  It is recomputed only when the temperature is
+	 * updated, reading data costs the same as without compensation.
+	 *
+	 * @param	Calib	: Calibration gain matrix and offset in degree/sec at TempRef
+	 * @param	TempCoef: Bias temperature coefficient X, Y, Z in degree/sec per degree C
+	 * @param	TempRef	: Reference temperature of Calib in degree C
+	 */
+	virtual void SetCalibration(const SENSOR_CALIB &Calib, const float TempCoef[3], float TempRef) {
+		memcpy(vTempCoef, TempCoef, sizeof(vTempCoef));
+		vTempRef = TempRef;
+		SetCalibration(Calib);
+	}
+
+	/**
+	 * @brief	Get current calibration correction.
+	 *
+	 * @return	Calibration data
+	 */
+	virtual const SENSOR_CALIB &Calibration() { return vCalib; }
+
+	/**
+	 * @brief	Remove calibration correction.
+	 */
+	virtual void ClearCalibration() {
+		SensorCalibIdentity(&vCalib);
+		memset(vTempCoef, 0, sizeof(vTempCoef));
+		vCnvScale = vCnvRange = 0;
+		UpdateOffset();
+	}
+
+	/**
+	 * @brief	Get temperature coefficient of the calibration
+	 *
+	 * @return	Pointer to coefficients X, Y, Z in degree/sec per degree C
+	 */
+	virtual const float *TempCoef() { return vTempCoef; }
+
+	/**
+	 * @brief	Get reference temperature of the calibration in degree C
+	 */
+	virtual float TempRef() { return vTempRef; }
+
+	/**
+	 * @brief	Update sensor temperature used for the calibration.
+	 *
+	 * Called by the device implementation when it reads its die temperature, or
+	 * by the application when the temperature comes from another sensor.
+	 *
+	 * @param	Temp : Sensor temperature in degree C
+	 */
+	virtual void Temperature(float Temp) { vTemp = Temp; UpdateOffset(); }
+
+	/**
+	 * @brief	Get last sensor temperature in degree C
+	 */
+	virtual float Temperature() { return vTemp; }
+
 protected:
 
+	/**
+	 * @brief	Compute calibration offset at the current temperature
+	 */
+	void UpdateOffset() {
+		for (int i = 0; i < 3; i++)
+		{
+			vCnvOffset[i] = vCalib.Offset[i] - vTempCoef[i] * (vTemp - vTempRef);
+		}
+	}
+
 	uint32_t vSensitivity;	    //!< Sensitivity level per degree per second
     uint16_t vRange;            //!< ADC range of the sensor, contains max value for conversion factor
 	GYROSENSOR_RAWDATA vData;	//!< Current sensor data updated with UpdateData()
+	SENSOR_CALIB vCalib;			//!< Calibration correction
+	float vCnvGain[3][3];			//!< Calibration gain merged with raw data conversion factor
+	uint16_t vCnvScale;				//!< Scale used to compute vCnvGain
+	uint16_t vCnvRange;				//!< Range used to compute vCnvGain
+	float vCnvOffset[3];			//!< Calibration offset at current temperature
+	float vTempCoef[3];				//!< Offset temperature coefficient
+	float vTemp;					//!< Last sensor temperature in degree C
+	float vTempRef;					//!< Reference temperature of vCalib
 };
 
 #endif // __cplusplus
@@ -86,6 +86,8 @@ typedef struct __MagSensor_Config {
 
 class MagSensor : public Sensor {
 public:
+	MagSensor() : vCnvScale(0), vCnvRange(0) { SensorCalibIdentity(&vCalib); }
+
 	/**
 	 * @brief	Sensor initialization
 	 *
@@ -115,18 +117,50 @@ public:
 	 * @return	True - Success.
 	 */
     virtual bool Read(MAGSENSOR_DATA &Data) {
-        Data.Timestamp = vData.Timestamp;
-        Data.X = (float)(vData.X * vData.Scale) / (float)vData.Range;
-        Data.Y = (float)(vData.Y * vData.Scale) / (float)vData.Range;
-        Data.Z = (float)(vData.Z * vData.Scale) / (float)vData.Range;
-        return true;
-    }
+		if (vData.Range == 0)
+			return false;
+		if (vData.Scale != vCnvScale || vData.Range != vCnvRange)
+		{
+			SensorCalibMerge(vCnvGain, &vCalib, vData.Scale, vData.Range);
+			vCnvScale = vData.Scale;
+			vCnvRange = vData.Range;
+		}
+		Data.Timestamp = vData.Timestamp;
+		SensorCalibConvert(Data.Val, vCnvGain, vCalib.Offset, vData.Val);
+		return true;
+	}
+
+	/**
+	 * @brief	Set calibration correction.
+	 *
+	 * The correction is merged with the raw data conversion factor so calibrated
+	 * data costs the same to read as uncalibrated data.
+	 *
+	 * @param	Calib : Calibration gain matrix and offset in sensor unit
+	 */
+	virtual void SetCalibration(const SENSOR_CALIB &Calib) { vCalib = Calib; vCnvScale = vCnvRange = 0; }
+
+	/**
+	 * @brief	Get current calibration correction.
+	 *
+	 * @return	Calibration data
+	 */
+	virtual const SENSOR_CALIB &Calibration() { return vCalib; }
+
+	/**
+	 * @brief	Remove calibration correction.
+	 */
+	virtual void ClearCalibration() { SensorCalibIdentity(&vCalib); vCnvScale = vCnvRange = 0; }
 
 protected:
 	int32_t vScale;			//!< Sample scaling value at the discretion of the implementation
 	int vPrecision;			//!< Sampling precision in bits
     uint16_t vRange;        //!< ADC range of the sensor, contains max value for conversion factor
 	MAGSENSOR_RAWDATA vData;//!< Current sensor data updated with UpdateData()
+	SENSOR_CALIB vCalib;			//!< Calibration correction
+	float vCnvGain[3][3];			//!< Calibration gain merged with raw data conversion factor
+	uint16_t vCnvScale;				//!< Scale used to compute vCnvGain
+	uint16_t vCnvRange;				//!< Range used to compute vCnvGain
 private:
 
 };
@@ -97,6 +97,58 @@ typedef enum __Sensor_State {
 									//!< the sensor would always be in sampling state.
 } SENSOR_STATE;
 
+/// @brief	3 axis linear calibration.
+///
+/// Calibrated = Gain * Data + Offset, where Data is the converted 3 axis sensor data
+/// (G for accel, degree/sec for gyro, ...)
+typedef struct __Sensor_Calibration {
+	float Gain[3][3];				//!< Correction matrix, row major
+	float Offset[3];				//!< Offset vector in converted data unit
+} SENSOR_CALIB;
+
+/**
+ * @brief	Reset calibration to identity.
+ *
+ * @param	pCalib : Calibration data to reset
+ */
+static inline void SensorCalibIdentity(SENSOR_CALIB * const pCalib) {
+	memset(pCalib, 0, sizeof(SENSOR_CALIB));
+	pCalib->Gain[0][0] = pCalib->Gain[1][1] = pCalib->Gain[2][2] = 1.0;
+}
+
+/**
+ * @brief	Merge calibration gain with raw data conversion factor.
+ *
+ * The resulting matrix converts raw ADC data directly to calibrated data so that
+ * calibration does not add any per sample cost.  Only needs to be recomputed when
+ * the calibration, scale or range changes.
+ *
+ * @param	pCnv	: Resulting conversion matrix
+ * @param	pCalib	: Calibration data
+ * @param	Scale	: Raw data scale
+ * @param	Range	: Raw data ADC range
+ */
+static inline void SensorCalibMerge(float pCnv[3][3], const SENSOR_CALIB * const pCalib, uint16_t Scale, uint16_t Range) {
+	float f = Range != 0 ? (float)Scale / (float)Range : 0.0;
+	for (int i = 0; i < 9; i++)
+		pCnv[i / 3][i % 3] = pCalib->Gain[i / 3][i % 3] * f;
+}
+
+/**
+ * @brief	Convert raw 3 axis data to calibrated data.
+ *
+ * @param	pOut	: Resulting converted data
+ * @param	pCnv	: Conversion matrix from SensorCalibMerge
+ * @param	pOffset	: Calibration offset
+ * @param	pRaw	: Raw 3 axis data
+ */
+static inline void SensorCalibConvert(float pOut[3], float pCnv[3][3], const float pOffset[3], const int16_t pRaw[3]) {
+	float x = pRaw[0], y = pRaw[1], z = pRaw[2];
+	pOut[0] = pCnv[0][0] * x + pCnv[0][1] * y + pCnv[0][2] * z + pOffset[0];
+	pOut[1] = pCnv[1][0] * x + pCnv[1][1] * y + pCnv[1][2] * z + pOffset[1];
+	pOut[2] = pCnv[2][0] * x + pCnv[2][1] * y + pCnv[2][2] * z + pOffset[2];
+}
+
 #ifdef __cplusplus
 
 /// @brief	Sensor generic base class.
@@ -0,0 +1,278 @@
+/**-------------------------------------------------------------------------
+@file	sensor_calib.h
+
+@brief	On device calibration engine for accelerometer, gyroscope and magnetometer
+
+Samples are accumulated incrementally into fixed size sums, the full data set
+is never buffered.  Once enough samples are collected, Fit computes a
+SENSOR_CALIB correction to pass to the sensor SetCalibration.  The correction
+is merged with the sensor raw data conversion, therefore calibrated data does
+not cost more to read.
+
+- Accelerometer : six position calibration.  The device is placed still with each
+  axis pointing up then down.  Fits full 3x3 gain (scale, misalignment) and bias.
+- Gyroscope : bias with linear temperature coefficient from still samples.  The
+  sensor applies the temperature term with its last Temperature.
+- Magnetometer : ellipsoid fit for hard iron offset and soft iron matrix while the
+  device is rotated in all directions.
+
+Samples must be taken from the sensor without calibration applied (ClearCalibration).
+
+Memory usage : AccelCalib ~170 bytes, GyroCalib ~100 bytes, MagCalib ~460 bytes.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __SENSOR_CALIB_H__
+#define __SENSOR_CALIB_H__
+
+#include <stdint.h>
+
+#include "sensors/accel_sensor.h"
+#include "sensors/gyro_sensor.h"
+#include "sensors/mag_sensor.h"
+
+/** @addtogroup Sensors
+  * @{
+  */
+
+#define ACCELCALIB_POS_XP			(1<<0)	//!< X axis pointing up
+#define ACCELCALIB_POS_XN			(1<<1)	//!< X axis pointing down
+#define ACCELCALIB_POS_YP			(1<<2)	//!< Y axis pointing up
+#define ACCELCALIB_POS_YN			(1<<3)	//!< Y axis pointing down
+#define ACCELCALIB_POS_ZP			(1<<4)	//!< Z axis pointing up
+#define ACCELCALIB_POS_ZN			(1<<5)	//!< Z axis pointing down
+#define ACCELCALIB_POS_ALL			0x3F
+
+#define ACCELCALIB_STILL_TOL		0.1		//!< Max deviation from 1G of a still sample
+#define ACCELCALIB_AXIS_TOL			0.9		//!< Min fraction of norm on dominant axis
+
+#define GYROCALIB_STILL_RATE_MAX	20.0	//!< Max rate in degree/sec of a still sample
+
+#define MAGCALIB_SAMPLE_MIN			32		//!< Min number of samples to fit ellipsoid
+
+#ifdef __cplusplus
+
+/// @brief	Accelerometer six position calibration.
+///
+/// Model : Data = A * g + b, where g is the gravity unit vector.  Column i of A is
+/// half the difference between the means of axis i pointing up and down.  The
+/// correction is Gain = inv(A), Offset = -inv(A) * b.
+class AccelCalib {
+public:
+	/**
+	 * @param	MinSamples : Number of still samples required per position
+	 */
+	AccelCalib(int MinSamples = 64) : vMinSamples(MinSamples) { Reset(); }
+
+	/**
+	 * @brief	Discard all collected samples
+	 */
+	void Reset();
+
+	/**
+	 * @brief	Add a sample.
+	 *
+	 * Sample is assigned to its position automatically.  Moving samples and samples not
+	 * aligned with an axis are rejected.
+	 *
+	 * @param	Data : Uncalibrated accel data in G
+	 *
+	 * @return	Bit mask of positions completed ACCELCALIB_POS_xxx
+	 */
+	uint32_t AddSample(const ACCELSENSOR_DATA &Data);
+
+	/**
+	 * @brief	Get completed positions
+	 *
+	 * @return	Bit mask of positions completed ACCELCALIB_POS_xxx
+	 */
+	uint32_t Progress();
+
+	/**
+	 * @brief	Compute calibration
+	 *
+	 * @param	Calib : Resulting calibration
+	 *
+	 * @return	true - Success, all positions are completed
+	 */
+	bool Fit(SENSOR_CALIB &Calib);
+
+private:
+	int vMinSamples;
+	uint32_t vCount[6];			//!< Sample count per position
+	double vSum[6][3];			//!< Sample sum per position
+};
+
+/// @brief	Gyroscope bias calibration with temperature compensation.
+///
+/// Fits Bias(T) = Bias0 + Coef * (T - Tref) per axis with least square regression on
+/// still samples.  If the temperature did not change during collection, only
+/// the bias is estimated.
+class GyroCalib {
+public:
+	GyroCalib() { Reset(); }
+
+	/**
+	 * @brief	Discard all collected samples
+	 */
+	void Reset();
+
+	/**
+	 * @brief	Add a still sample
+	 *
+	 * @param	Data	: Uncalibrated gyro data in degree/sec
+	 * @param	Temp	: Sensor temperature in degree C
+	 *
+	 * @return	true - Sample accepted
+	 */
+	bool AddSample(const GYROSENSOR_DATA &Data, float Temp);
+
+	/**
+	 * @brief	Compute bias and temperature coefficient
+	 *
+	 * @return	true - Success
+	 */
+	bool Fit();
+
+	/**
+	 * @brief	Apply fitted bias and temperature coefficient to a sensor
+	 *
+	 * The sensor compensates the bias on each read using its last temperature,
+	 * see GyroSensor::Temperature.
+	 *
+	 * @param	Sensor : Gyro sensor to calibrate
+	 */
+	void Apply(GyroSensor &Sensor);
+
+	/**
+	 * @brief	Get calibration for a temperature
+	 *
+	 * Fixed offset for sensors without temperature, use Apply otherwise.
+	 *
+	 * @param	Temp	: Current sensor temperature in degree C
+	 * @param	Calib	: Resulting calibration
+	 */
+	void Calibration(float Temp, SENSOR_CALIB &Calib);
+
+	/**
+	 * @brief	Get fitted temperature coefficient
+	 *
+	 * @return	Pointer to coefficients X, Y, Z in degree/sec per degree C
+	 */
+	const float *TempCoef() { return vTempCoef; }
+
+	/**
+	 * @brief	Get reference temperature of the fitted bias in degree C
+	 */
+	float TempRef() { return vTempRef; }
+
+	/**
+	 * @brief	Get number of samples accepted
+	 */
+	uint32_t SampleCount() { return vCount; }
+
+private:
+	uint32_t vCount;
+	double vTempRef;			//!< Temperature of first sample, improves sum precision
+	double vSumT;
+	double vSumT2;
+	double vSumW[3];
+	double vSumTW[3];
+	float vBias[3];				//!< Fitted bias at vTempRef
+	float vTempCoef[3];			//!< Fitted temperature coefficient
+};
+
+/// @brief	Magnetometer ellipsoid fit calibration.
+///
+/// Fits the general quadric a x^2 + b y^2 + c z^2 + 2d xy + 2e xz + 2f yz + 2g x + 2h y + 2i z = 1
+/// with least square.  Only the normal equations are accumulated.  Hard iron offset is the
+/// ellipsoid center, soft iron matrix is the square root of the normalized ellipsoid
+/// matrix scaled to keep the mean field strength.
+class MagCalib {
+public:
+	MagCalib() { Reset(); }
+
+	/**
+	 * @brief	Discard all collected samples
+	 */
+	void Reset();
+
+	/**
+	 * @brief	Add a sample
+	 *
+	 * @param	Data : Uncalibrated mag data
+	 */
+	void AddSample(const MAGSENSOR_DATA &Data);
+
+	/**
+	 * @brief	Get number of samples collected
+	 */
+	uint32_t SampleCount() { return vCount; }
+
+	/**
+	 * @brief	Compute hard and soft iron calibration
+	 *
+	 * @param	Calib : Resulting calibration
+	 *
+	 * @return	true - Success, false - not enough data or samples do not
+	 * 			cover enough directions
+	 */
+	bool Fit(SENSOR_CALIB &Calib);
+
+	/**
+	 * @brief	Get RMS residual of last fit
+	 *
+	 * @return	RMS algebraic residual normalized to field strength. 0 is a perfect fit
+	 */
+	float Residual() { return vResidual; }
+
+	/**
+	 * @brief	Get field strength of last fit in data unit
+	 */
+	float FieldStrength() { return vField; }
+
+private:
+	uint32_t vCount;
+	float vNorm;				//!< Data normalization factor, magnitude of first sample
+	double vDtD[45];			//!< Upper triangle of D'D normal matrix
+	double vDt1[9];				//!< D'1 right hand side
+	float vResidual;
+	float vField;
+};
+
+extern "C" {
+#endif	// __cplusplus
+
+#ifdef __cplusplus
+}
+
+#endif	// __cplusplus
+
+/** @} End of group Sensors */
+
+#endif	// __SENSOR_CALIB_H__
@@ -0,0 +1,354 @@
+/**-------------------------------------------------------------------------
+@file	sensor_stream.h
+
+@brief	Sensor data stream recorder and replay sensor
+
+The recorder logs raw sensor samples, time stamps and configuration changes
+of any sensor or IMU into a compact binary stream.  The stream is written out
+via a user callback so it can be sent to a file, flash memory, UART, etc...
+
+The ReplaySensor is a virtual sensor implementing accel, gyro, mag, TPH and gas
+sensor interfaces.  It plays back a recorded stream at original speed or
+accelerated speed.  Raw data is stored unmodified, therefore replayed data
+is bit exact with what the real sensor produced.
+
+Stream format :
+
+	SENSSTRM_HDR, followed by records of SENSSTRM_RECHDR + payload
+
+Record time stamps are stored as signed delta in usec from the previous record.
+A SENSSTRM_REC_TIME record containing absolute 64 bits time stamp is inserted
+at start of stream and each time the delta does not fit in 32 bits.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __SENSOR_STREAM_H__
+#define __SENSOR_STREAM_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+
+#include "sensors/accel_sensor.h"
+#include "sensors/gyro_sensor.h"
+#include "sensors/mag_sensor.h"
+#include "sensors/temp_sensor.h"
+#include "sensors/humi_sensor.h"
+#include "sensors/press_sensor.h"
+#include "sensors/tph_sensor.h"
+#include "sensors/gas_sensor.h"
+#include "imu/imu.h"
+
+/** @addtogroup Sensors
+  * @{
+  */
+
+#define SENSSTRM_MAGIC				0x4D525453	//!< 'STRM'
+#define SENSSTRM_VERSION			1
+
+#define SENSSTRM_REC_PAYLOAD_MAX	64			//!< Max payload size of a record
+
+/// Stream record types
+typedef enum __Sensor_Stream_Record_Type {
+	SENSSTRM_REC_TIME,			//!< Absolute 64 bits time stamp in usec
+	SENSSTRM_REC_CFG,			//!< Sensor configuration change
+	SENSSTRM_REC_ACCEL,			//!< Accelerometer raw X, Y, Z
+	SENSSTRM_REC_GYRO,			//!< Gyroscope raw X, Y, Z
+	SENSSTRM_REC_MAG,			//!< Magnetometer raw X, Y, Z
+	SENSSTRM_REC_TEMP,			//!< Temperature
+	SENSSTRM_REC_HUMI,			//!< Humidity
+	SENSSTRM_REC_PRESS,			//!< Pressure
+	SENSSTRM_REC_TPH,			//!< Combined temperature, pressure, humidity
+	SENSSTRM_REC_GAS,			//!< Gas sensor
+	SENSSTRM_REC_QUAT,			//!< IMU quaternion
+	SENSSTRM_REC_TYPE_MAX
+} SENSSTRM_REC_TYPE;
+
+#pragma pack(push, 1)
+
+/// Stream header, written once at start of stream
+typedef struct __Sensor_Stream_Header {
+	uint32_t Magic;				//!< SENSSTRM_MAGIC
+	uint16_t Version;			//!< SENSSTRM_VERSION
+	uint16_t Flags;				//!< Reserved, set to 0
+} SENSSTRM_HDR;
+
+/// Record header, followed by Len bytes of payload
+typedef struct __Sensor_Stream_Record_Header {
+	uint8_t Type;				//!< Record type SENSSTRM_REC_TYPE
+	uint8_t Len;				//!< Payload length in bytes
+	int32_t dTime;				//!< Time stamp delta in usec from previous record
+} SENSSTRM_RECHDR;
+
+/// Configuration record payload
+typedef struct __Sensor_Stream_Config {
+	uint8_t  RecType;			//!< Record type to which this configuration applies
+	uint16_t Scale;				//!< Data scale
+	uint16_t Range;				//!< ADC range
+	uint32_t Freq;				//!< Sampling frequency in mHz
+} SENSSTRM_CFG;
+
+#pragma pack(pop)
+
+/**
+ * @brief	Stream write callback.
+ *
+ * @param	pCtx	: User context pointer
+ * @param	pData	: Data to write
+ * @param	Len		: Data length in bytes
+ *
+ * @return	Number of bytes written
+ */
+typedef int (*SENSSTRM_WRITECB)(void * const pCtx, uint8_t * const pData, int Len);
+
+/**
+ * @brief	Stream read callback.
+ *
+ * @param	pCtx	: User context pointer
+ * @param	pBuff	: Buffer to receive data
+ * @param	Len		: Number of bytes to read
+ *
+ * @return	Number of bytes read. Less than Len on end of stream
+ */
+typedef int (*SENSSTRM_READCB)(void * const pCtx, uint8_t * const pBuff, int Len);
+
+#pragma pack(push, 4)
+
+/// Recorder configuration
+typedef struct __Sensor_Recorder_Config {
+	SENSSTRM_WRITECB WriteCB;	//!< Stream write callback
+	void *pCtx;					//!< User context passed to callback
+	uint8_t *pBuff;				//!< Optional memory to batch records before writing. NULL - write each record
+	int BuffLen;				//!< Batch memory size in bytes
+} SENSREC_CFG;
+
+/// Replay sensor configuration
+typedef struct __Sensor_Replay_Config {
+	SENSSTRM_READCB ReadCB;		//!< Stream read callback
+	void *pCtx;					//!< User context passed to callback
+	uint32_t Speed;				//!< Playback speed factor. 1 - original speed, n - n times faster
+								//!< 0 - one sample frame per UpdateData call regardless of time
+} SENSREPLAY_CFG;
+
+#pragma pack(pop)
+
+#ifdef __cplusplus
+
+/// @brief	Sensor stream recorder.
+///
+/// Each Record call logs the current sensor data if it has changed since the last call.
+/// A configuration record is emitted automatically when scale, range or sampling frequency
+/// of the sensor changes.
+class SensorRecorder {
+public:
+	SensorRecorder();
+
+	/**
+	 * @brief	Initialize recorder and write stream header
+	 *
+	 * @param	Cfg : Recorder configuration
+	 *
+	 * @return	true - Success
+	 */
+	bool Init(const SENSREC_CFG &Cfg);
+
+	bool Record(AccelSensor &Sensor);
+	bool Record(GyroSensor &Sensor);
+	bool Record(MagSensor &Sensor);
+	bool Record(TempSensor &Sensor);
+	bool Record(HumiSensor &Sensor);
+	bool Record(PressSensor &Sensor);
+	bool Record(TphSensor &Sensor);
+	bool Record(GasSensor &Sensor);
+
+	/**
+	 * @brief	Record all IMU data.
+	 *
+	 * Records accel, gyro, mag raw data and quaternion.  The IMU must have been initialized
+	 * with valid accel, gyro and mag sensor objects
+	 *
+	 * @param	Dev : IMU object
+	 *
+	 * @return	true - At least one new record was written
+	 */
+	bool Record(Imu &Dev);
+
+	/**
+	 * @brief	Write a record.
+	 *
+	 * Low level function to write any record type.  This allows custom sensors
+	 * to be logged in the same stream.
+	 *
+	 * @param	Type		: Record type
+	 * @param	Timestamp	: Time stamp in usec
+	 * @param	pData		: Record payload
+	 * @param	Len			: Payload length, max SENSSTRM_REC_PAYLOAD_MAX
+	 *
+	 * @return	true - Success
+	 */
+	bool Record(SENSSTRM_REC_TYPE Type, uint64_t Timestamp, void * const pData, int Len);
+
+	/**
+	 * @brief	Write out batched records.
+	 */
+	void Flush();
+
+	/**
+	 * @brief	Get total number of records written.
+	 *
+	 * @return	Record count
+	 */
+	uint32_t RecordCount() { return vRecCnt; }
+
+private:
+	bool UpdateConfig(SENSSTRM_REC_TYPE Type, uint64_t Timestamp, uint16_t Scale, uint16_t Range, uint32_t Freq);
+	bool Write(uint8_t * const pData, int Len);
+
+	SENSSTRM_WRITECB vWriteCB;
+	void *vpCtx;
+	uint8_t *vpBuff;
+	int vBuffLen;
+	int vBuffIdx;
+	bool vbTimeValid;			//!< Absolute time record was written
+	uint64_t vLastTime;			//!< Time stamp of last record
+	uint32_t vRecCnt;
+	uint64_t vChanTime[SENSSTRM_REC_TYPE_MAX];	//!< Last recorded time stamp per record type
+	SENSSTRM_CFG vChanCfg[SENSSTRM_REC_TYPE_MAX];	//!< Last recorded configuration per record type
+};
+
+/// @brief	Virtual sensor replaying a recorded stream.
+///
+/// Replayed data is available through the standard accel, gyro, mag, TPH and gas sensor
+/// interfaces.  UpdateData advances the stream.  With a timer and a non zero speed, all records
+/// up to the current playback time are applied.  Otherwise each UpdateData call applies one
+/// sample frame (all consecutive records with the same time stamp).
+class ReplaySensor : public AccelSensor, public GyroSensor, public MagSensor, public TphSensor, public GasSensor {
+public:
+	ReplaySensor();
+
+	/**
+	 * @brief	Initialize replay sensor and read stream header
+	 *
+	 * The playback clock is built from the timer usec count, which wraps every
+	 * 71 minutes.  UpdateData must be called at least once in that period.
+	 *
+	 * @param	Cfg		: Replay configuration
+	 * @param	pTimer	: Timer to pace playback. NULL to replay one frame per UpdateData
+	 *
+	 * @return	true - Success, valid stream
+	 */
+	bool Init(const SENSREPLAY_CFG &Cfg, Timer * const pTimer = NULL);
+
+	// Replay sensor does not have hardware, these only keep the config
+	virtual bool Init(const ACCELSENSOR_CFG &Cfg, DeviceIntrf * const pIntrf, Timer * const pTimer = NULL);
+	virtual bool Init(const GYROSENSOR_CFG &Cfg, DeviceIntrf * const pIntrf, Timer * const pTimer = NULL);
+	virtual bool Init(const MAGSENSOR_CFG &Cfg, DeviceIntrf * const pIntrf, Timer * const pTimer = NULL);
+	virtual bool Init(const TPHSENSOR_CFG &Cfg, DeviceIntrf * const pIntrf = NULL, Timer * const pTimer = NULL);
+	virtual bool Init(const GASSENSOR_CFG &Cfg, DeviceIntrf * const pIntrf = NULL, Timer * const pTimer = NULL);
+
+	virtual bool Enable();
+	virtual void Disable();
+
+	/**
+	 * @brief	Restart playback clock.
+	 *
+	 * Stream position is not changed, the next pending record becomes the new time reference.
+	 */
+	virtual void Reset();
+
+	virtual bool Mode(SENSOR_OPMODE OpMode, uint32_t Freq);
+	virtual bool StartSampling();
+
+	/**
+	 * @brief	Apply the next records from the stream
+	 *
+	 * @return	true - New data is updated
+	 */
+	virtual bool UpdateData();
+
+	virtual bool Read(ACCELSENSOR_RAWDATA &Data) { return AccelSensor::Read(Data); }
+	virtual bool Read(ACCELSENSOR_DATA &Data) { return AccelSensor::Read(Data); }
+	virtual bool Read(GYROSENSOR_RAWDATA &Data) { return GyroSensor::Read(Data); }
+	virtual bool Read(GYROSENSOR_DATA &Data) { return GyroSensor::Read(Data); }
+	virtual bool Read(MAGSENSOR_RAWDATA &Data) { return MagSensor::Read(Data); }
+	virtual bool Read(MAGSENSOR_DATA &Data) { return MagSensor::Read(Data); }
+	virtual bool Read(TPHSENSOR_DATA &Data) { Data = vTphData; return true; }
+	virtual bool Read(TEMPSENSOR_DATA &Data) { Data = vTempData; return true; }
+	virtual bool Read(GASSENSOR_DATA &Data) { Data = vGasData; return true; }
+	virtual bool Read(IMU_QUAT &Data) { Data = vQuat; return true; }
+
+	virtual float ReadTemperature() { return (float)vTempData.Temperature / 100.0; }
+	virtual float ReadPressure() { return (float)vTphData.Pressure; }
+	virtual float ReadHumidity() { return (float)vTphData.Humidity / 100.0; }
+
+	virtual bool SetHeatingProfile(int Count, const GASSENSOR_HEAT * const pProfile) {
+		(void)Count; (void)pProfile;
+		return true;
+	}
+
+	/**
+	 * @brief	Check end of stream
+	 *
+	 * @return	true - All records have been replayed
+	 */
+	bool EndOfStream() { return vbEos; }
+
+private:
+	bool ReadRecord();
+	SENSSTRM_REC_TYPE ApplyRecord();
+
+	SENSSTRM_READCB vReadCB;
+	void *vpCtx;
+	uint32_t vSpeed;
+	bool vbEos;					//!< End of stream reached
+	bool vbPending;				//!< A record is read and waiting to be applied
+	bool vbStarted;				//!< Playback clock started
+	uint64_t vStreamTime;		//!< Time stamp of the pending record
+	uint64_t vStreamStart;		//!< Stream time at start of playback
+	uint32_t vPlayLast;			//!< Timer usec count at last playback clock update
+	uint64_t vPlayTime;			//!< Playback time elapsed in usec
+	SENSSTRM_RECHDR vRecHdr;	//!< Pending record header
+	uint8_t vRecData[SENSSTRM_REC_PAYLOAD_MAX];	//!< Pending record payload
+	IMU_QUAT vQuat;				//!< Last replayed quaternion
+	TEMPSENSOR_DATA vTempData;	//!< Last replayed temperature, full width of TEMP records
+};
+
+extern "C" {
+#endif	// __cplusplus
+
+#ifdef __cplusplus
+}
+
+#endif	// __cplusplus
+
+/** @} End of group Sensors */
+
+#endif	// __SENSOR_STREAM_H__
@@ -0,0 +1,183 @@
+/**-------------------------------------------------------------------------
+@file	sensor_timestamp.h
+
+@brief	Sample time stamp estimator for batched sensor data
+
+Sensors with a hardware FIFO are read in batches.  Reading time is not the
+sampling time and the sensor's own oscillator drifts from the host Timer,
+typically by 1-3%.  This estimator recovers the sampling time of each sample
+on the host time base.
+
+At each FIFO read, the driver reports the read time and the number of new
+samples.  The estimator keeps a window of recent observations (absolute sample
+index of the newest sample, read time).  The actual sample period is the least
+square slope of read time vs. sample index.  As a sample is always produced
+before it is read, the time offset follows the lower envelope of the
+observations, so the random delay between sampling and reading is removed.
+
+Usage :
+
+	SensorTimeEst tsest;
+
+	tsest.Init(SamplingPeriod());
+	...
+	// On FIFO read of Cnt samples
+	uint32_t idx = tsest.SampleCount();
+	tsest.Update(vpTimer, Cnt);
+	for (int i = 0; i < Cnt; i++)
+		Data[i].Timestamp = tsest.SampleTime(idx + i);
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#ifndef __SENSOR_TIMESTAMP_H__
+#define __SENSOR_TIMESTAMP_H__
+
+#include <stdint.h>
+
+#include "coredev/timer.h"
+
+/** @addtogroup Sensors
+  * @{
+  */
+
+#define SENSTS_WIN_MAX				32		//!< Max number of observations kept
+#define SENSTS_MAX_DRIFT_DEF		50000	//!< Default max sensor clock deviation in ppm (5%)
+#define SENSTS_PERIOD_FILTER		0.25	//!< Low pass gain applied to period estimate
+
+#ifdef __cplusplus
+
+/// @brief	Sample time stamp estimator.
+///
+/// Tracks the sensor's actual sample period against the host timer and assigns a time
+/// stamp in usec to each sample index.  Sample indexes count samples since last Reset.
+class SensorTimeEst {
+public:
+	SensorTimeEst();
+
+	/**
+	 * @brief	Initialize estimator
+	 *
+	 * @param	nsPeriod	: Nominal sample period in nsec
+	 * @param	MaxDrift	: Max deviation of the sensor clock from nominal in ppm.
+	 * 						  Period estimates outside this range are clipped
+	 * @param	WinSize		: Number of observations used for the fit, max SENSTS_WIN_MAX
+	 *
+	 * @return	true - Success
+	 */
+	bool Init(uint64_t nsPeriod, uint32_t MaxDrift = SENSTS_MAX_DRIFT_DEF, int WinSize = SENSTS_WIN_MAX);
+
+	/**
+	 * @brief	Restart estimation.
+	 *
+	 * Must be called when sample sequence is broken, ex. FIFO reset or overflow.  The
+	 * estimated period is kept.
+	 */
+	void Reset();
+
+	/**
+	 * @brief	Add an observation
+	 *
+	 * @param	ReadTime	: Monotonic time in usec, taken right after reading the FIFO count.
+	 * 						  Not the 32 bits Timer::uSecond which wraps after 71 minutes
+	 * @param	NbNew		: Number of new samples since last update, including the
+	 * 						  ones still left in the FIFO
+	 */
+	void Update(uint64_t ReadTime, int NbNew);
+
+	/**
+	 * @brief	Add an observation at current time
+	 *
+	 * @param	pTimer		: Timer giving the read time, read right after the FIFO count
+	 * @param	NbNew		: Number of new samples since last update, including the
+	 * 						  ones still left in the FIFO
+	 */
+	void Update(Timer * const pTimer, int NbNew);
+
+	/**
+	 * @brief	Get time stamp of a sample
+	 *
+	 * Time stamps are monotonic when requested in increasing sample index order.
+	 *
+	 * @param	Idx	: Sample index
+	 *
+	 * @return	Estimated sampling time in usec
+	 */
+	uint64_t SampleTime(uint32_t Idx);
+
+	/**
+	 * @brief	Get number of samples since last reset
+	 *
+	 * @return	Sample count, also the index of the next sample
+	 */
+	uint32_t SampleCount() { return vCount; }
+
+	/**
+	 * @brief	Get estimated sample period
+	 *
+	 * @return	Period in usec
+	 */
+	float Period() { return vPeriod; }
+
+	/**
+	 * @brief	Get sensor clock deviation from nominal
+	 *
+	 * @return	Deviation in ppm, positive when sensor is slower than nominal
+	 */
+	int32_t Drift() { return (int32_t)((vPeriod - vNomPeriod) * 1000000.0 / vNomPeriod); }
+
+private:
+	void Fit();
+
+	float vNomPeriod;			//!< Nominal period in usec
+	float vPeriod;				//!< Estimated period in usec
+	float vMaxDrift;			//!< Max relative deviation of period
+	int vWinSize;				//!< Fit window size
+	int vNbObs;					//!< Number of observations in window
+	int vObsIdx;				//!< Index of next observation in window
+	uint32_t vObsSmpl[SENSTS_WIN_MAX];	//!< Index of newest sample at observation
+	uint64_t vObsTime[SENSTS_WIN_MAX];	//!< Observation read time in usec
+	uint32_t vCount;			//!< Sample count
+	uint32_t vRefIdx;			//!< Reference sample index of time model
+	uint64_t vRefTime;			//!< Reference sample time in usec
+	uint32_t vLastIdx;			//!< Last sample index returned by SampleTime
+	uint64_t vLastTime;			//!< Last time stamp returned by SampleTime
+	bool vbLastValid;			//!< vLastIdx/vLastTime are valid
+};
+
+extern "C" {
+#endif	// __cplusplus
+
+#ifdef __cplusplus
+}
+
+#endif	// __cplusplus
+
+/** @} End of group Sensors */
+
+#endif	// __SENSOR_TIMESTAMP_H__
+
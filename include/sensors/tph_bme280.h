@@ -118,6 +118,10 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define BME280_REG_RESET_VAL			0xB6
 
+// Control registers kept in register shadow, BME280_REG_CTRL_HUM to BME280_REG_CONFIG
+#define BME280_REG_SHADOW_START			BME280_REG_CTRL_HUM
+#define BME280_REG_SHADOW_NBREG			4
+
 #pragma pack(push, 1)
 typedef struct {
 	uint16_t dig_T1;
@@ -293,7 +297,7 @@ private:
 
 	int32_t vCalibTFine;	// For internal calibration use only
 	BME280_CALIB_DATA vCalibData;
-	uint8_t vCtrlReg;
+	uint8_t vRegShadow[DEVREGSHADOW_MEMSIZE(BME280_REG_SHADOW_NBREG)];
 //	bool vbSpi;
 	bool vbInitialized;
 };
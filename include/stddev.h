@@ -38,7 +38,9 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdint.h>
 #include <unistd.h>
 
-#define STDDEV_MAX				6		//!< Max number of standard device
+#ifndef STDDEV_MAX
+#define STDDEV_MAX				6		//!< Max number of standard device, 16 max
+#endif
 #define STDDEV_NAME_MAX			8
 
 #define STDFS_FILENO			3		//!< Default File system
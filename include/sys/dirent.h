@@ -52,9 +52,13 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define DA_HIDDEN		2
 #define DA_SYSTEM		4
 
-#define NAME_MAX	64
+#ifndef NAME_MAX
+#define NAME_MAX	255			// Long file names are up to 255 characters
+#endif
 #define PATH_MAX	255
+#ifndef OPEN_MAX
 #define OPEN_MAX	3
+#endif
 
 
 struct dirent {
@@ -44,6 +44,10 @@ Device::Device()
 	vpIntrf = NULL;
 	vbValid = false;
 	vDevId = -1;
+	vpRegShadowCfg = NULL;
+	vpRegShadow = NULL;
+	vpRegValid = NULL;
+	vpRegDirty = NULL;
 }
 
 /**
@@ -95,5 +99,262 @@ int Device::Write(uint8_t *pCmdAddr, int CmdAddrLen, uint8_t *pData, int DataLen
 		*pCmdAddr &= 0x7F;
 	}
 
-	return vpIntrf->Write(vDevAddr, pCmdAddr, CmdAddrLen, pData, DataLen);
+	int cnt = vpIntrf->Write(vDevAddr, pCmdAddr, CmdAddrLen, pData, DataLen);
+
+	if (cnt > 0 && vpRegShadowCfg != NULL)
+	{
+		RegShadowStore(pCmdAddr, CmdAddrLen, pData, cnt);
+	}
+
+	return cnt;
+}
+
+#define REGMAP_TST(pMap, Idx)		((pMap)[(Idx) >> 3] & (1 << ((Idx) & 7)))
+#define REGMAP_SET(pMap, Idx)		((pMap)[(Idx) >> 3] |= (1 << ((Idx) & 7)))
+#define REGMAP_CLR(pMap, Idx)		((pMap)[(Idx) >> 3] &= ~(1 << ((Idx) & 7)))
+
+bool Device::RegShadowInit(const DEVREGSHADOW_CFG * const pCfg, uint8_t * const pMem)
+{
+	if (pCfg == NULL || pMem == NULL || pCfg->NbReg == 0)
+	{
+		vpRegShadowCfg = NULL;
+
+		return false;
+	}
+
+	int mapsize = (pCfg->NbReg + 7) >> 3;
+
+	vpRegShadow = pMem;
+	vpRegValid = pMem + pCfg->NbReg;
+	vpRegDirty = vpRegValid + mapsize;
+	vpRegShadowCfg = pCfg;
+
+	RegShadowInvalidate();
+
+	return true;
+}
+
+void Device::RegShadowInvalidate()
+{
+	if (vpRegShadowCfg == NULL)
+	{
+		return;
+	}
+
+	int mapsize = (vpRegShadowCfg->NbReg + 7) >> 3;
+
+	memset(vpRegValid, 0, mapsize);
+	memset(vpRegDirty, 0, mapsize);
+}
+
+bool Device::RegShadowSync()
+{
+	if (vpRegShadowCfg == NULL)
+	{
+		return false;
+	}
+
+	const uint8_t *volmap = vpRegShadowCfg->pVolMap;
+	bool retval = true;
+	int idx = 0;
+
+	RegShadowInvalidate();
+
+	while (idx < vpRegShadowCfg->NbReg)
+	{
+		if (volmap && REGMAP_TST(volmap, idx))
+		{
+			idx++;
+			continue;
+		}
+
+		// Burst read run of non volatile registers
+		int cnt = 1;
+
+		while (idx + cnt < vpRegShadowCfg->NbReg && (volmap == NULL || REGMAP_TST(volmap, idx + cnt) == 0))
+		{
+			cnt++;
+		}
+
+		uint8_t regaddr = vpRegShadowCfg->StartAddr + idx;
+
+		if (Read(&regaddr, 1, &vpRegShadow[idx], cnt) == cnt)
+		{
+			for (int i = idx; i < idx + cnt; i++)
+			{
+				REGMAP_SET(vpRegValid, i);
+			}
+		}
+		else
+		{
+			retval = false;
+		}
+
+		idx += cnt;
+	}
+
+	return retval;
+}
+
+bool Device::RegShadowFlush()
+{
+	if (vpRegShadowCfg == NULL)
+	{
+		return true;
+	}
+
+	bool retval = true;
+	int idx = 0;
+
+	while (idx < vpRegShadowCfg->NbReg)
+	{
+		if (REGMAP_TST(vpRegDirty, idx) == 0)
+		{
+			idx++;
+			continue;
+		}
+
+		int cnt = 1;
+
+		if (vpRegShadowCfg->bBurstWrite)
+		{
+			// Merge consecutive dirty registers into one transfer
+			while (idx + cnt < vpRegShadowCfg->NbReg && REGMAP_TST(vpRegDirty, idx + cnt))
+			{
+				cnt++;
+			}
+		}
+
+		uint8_t regaddr = vpRegShadowCfg->StartAddr + idx;
+
+		if (Write(&regaddr, 1, &vpRegShadow[idx], cnt) != cnt)
+		{
+			retval = false;
+		}
+
+		for (int i = idx; i < idx + cnt; i++)
+		{
+			REGMAP_CLR(vpRegDirty, i);
+		}
+
+		idx += cnt;
+	}
+
+	return retval;
+}
+
+void Device::RegShadowMarkDirty(uint8_t *pRegAddr, int RegAddrLen)
+{
+	int idx = RegShadowIdx(pRegAddr, RegAddrLen);
+
+	// An invalid register is always written on next access
+	if (idx >= 0 && REGMAP_TST(vpRegValid, idx))
+	{
+		REGMAP_SET(vpRegDirty, idx);
+	}
+}
+
+void Device::RegShadowStore(uint8_t *pRegAddr, int RegAddrLen, uint8_t *pData, int Len)
+{
+	if (RegAddrLen != 1)
+		return;
+
+	const uint8_t *volmap = vpRegShadowCfg->pVolMap;
+	int idx = (int)(InterfaceType() == DEVINTRF_TYPE_SPI ? *pRegAddr & 0x7F : *pRegAddr) - vpRegShadowCfg->StartAddr;
+
+	for (int i = 0; i < Len; i++, idx++)
+	{
+		if (idx < 0 || idx >= vpRegShadowCfg->NbReg)
+			continue;
+
+		if (volmap == NULL || REGMAP_TST(volmap, idx) == 0)
+		{
+			vpRegShadow[idx] = pData[i];
+			REGMAP_SET(vpRegValid, idx);
+		}
+		REGMAP_CLR(vpRegDirty, idx);
+	}
+}
+
+uint8_t Device::ShadowRead8(int Idx, uint8_t *pRegAddr, int RegAddrLen)
+{
+	const uint8_t *volmap = vpRegShadowCfg->pVolMap;
+	bool vol = volmap != NULL && REGMAP_TST(volmap, Idx);
+
+	if (vol == false && REGMAP_TST(vpRegValid, Idx))
+	{
+		return vpRegShadow[Idx];
+	}
+
+	uint8_t val = 0;
+
+	if (Read(pRegAddr, RegAddrLen, &val, 1) == 1 && vol == false)
+	{
+		vpRegShadow[Idx] = val;
+		REGMAP_SET(vpRegValid, Idx);
+	}
+
+	return val;
+}
+
+bool Device::ShadowWrite8(int Idx, uint8_t *pRegAddr, int RegAddrLen, uint8_t Data)
+{
+	const uint8_t *wrmap = vpRegShadowCfg->pWrMap;
+	const uint8_t *volmap = vpRegShadowCfg->pVolMap;
+	bool vol = volmap != NULL && REGMAP_TST(volmap, Idx);
+
+	if (wrmap != NULL && REGMAP_TST(wrmap, Idx) == 0)
+	{
+		// Read only register
+		return false;
+	}
+
+	if (vol == false && REGMAP_TST(vpRegValid, Idx) && REGMAP_TST(vpRegDirty, Idx) == 0 &&
+		vpRegShadow[Idx] == Data)
+	{
+		// Register already holds this value
+		return true;
+	}
+
+	if (Write(pRegAddr, RegAddrLen, &Data, 1) <= 0)
+	{
+		return false;
+	}
+
+	REGMAP_CLR(vpRegDirty, Idx);
+
+	if (vol == false)
+	{
+		vpRegShadow[Idx] = Data;
+		REGMAP_SET(vpRegValid, Idx);
+	}
+
+	return true;
+}
+
+bool Device::Update8(uint8_t *pRegAddr, int RegAddrLen, uint8_t Mask, uint8_t Data, bool bDeferred)
+{
+	uint8_t regaddr[4];
+
+	// Read8 may alter the address (SPI read bit), keep the caller's intact
+	memcpy(regaddr, pRegAddr, RegAddrLen);
+	uint8_t d = Read8(regaddr, RegAddrLen);
+
+	d = (d & ~Mask) | (Data & Mask);
+
+	int idx = RegShadowIdx(pRegAddr, RegAddrLen);
+
+	if (bDeferred && idx >= 0 && REGMAP_TST(vpRegValid, idx))
+	{
+		// Register is valid therefore not volatile
+		if (vpRegShadow[idx] != d)
+		{
+			vpRegShadow[idx] = d;
+			REGMAP_SET(vpRegDirty, idx);
+		}
+
+		return true;
+	}
+
+	return Write8(pRegAddr, RegAddrLen, d);
 }
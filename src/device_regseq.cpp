@@ -0,0 +1,309 @@
+/**-------------------------------------------------------------------------
+@file	device_regseq.cpp
+
+@brief	Device register sequence executor
+
+See device_regseq.h for the sequence format.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "idelay.h"
+#include "device_regseq.h"
+
+DevRegSeq::DevRegSeq()
+{
+	memset(&vCfg, 0, sizeof(vCfg));
+	vpDev = NULL;
+	vpSeq = NULL;
+	vpRdBuff = NULL;
+	vIdx = 0;
+	vPollTime = 0;
+	vpTimer = NULL;
+	vDoneCB = NULL;
+	vpDoneCtx = NULL;
+}
+
+bool DevRegSeq::Init(const DEVREGSEQ_CFG &Cfg, Device * const pDev)
+{
+	if (pDev == NULL || Cfg.AddrLen < 1 || Cfg.AddrLen > 2)
+		return false;
+
+	vCfg = Cfg;
+	vpDev = pDev;
+
+	if (vCfg.PollInterval == 0)
+	{
+		vCfg.PollInterval = DEVREGSEQ_POLL_INTERVAL;
+	}
+
+	if (vCfg.WrMode == DEVREGSEQ_WRMODE_PAIR && pDev->RegShadowEnabled())
+	{
+		// Pair transfers can't be tracked by the shadow.  Single writes
+		// still benefit from it by skipping unchanged registers.
+		vCfg.WrMode = DEVREGSEQ_WRMODE_SINGLE;
+	}
+
+	vpSeq = NULL;
+
+	return true;
+}
+
+/**
+ * @brief	Write a run of adjacent write operations in one transfer
+ *
+ * @param	pOp	: First write operation
+ *
+ * @return	Number of operations consumed, 0 - transfer failed
+ */
+int DevRegSeq::WriteMerged(const DEVREGSEQ *pOp)
+{
+	uint8_t addr[2];
+	uint8_t d[DEVREGSEQ_XFER_MAX];
+	int n = 1;
+	int len = 1;
+
+	d[0] = pOp->Val;
+
+	if (vCfg.WrMode == DEVREGSEQ_WRMODE_BURST)
+	{
+		while (len < DEVREGSEQ_XFER_MAX && pOp[n].Op == DEVREGSEQ_OP_WRITE &&
+			   pOp[n].Reg == pOp->Reg + n && (pOp->Reg & 0xFF) + n <= 0xFF)
+		{
+			d[len++] = pOp[n++].Val;
+		}
+	}
+	else if (vCfg.WrMode == DEVREGSEQ_WRMODE_PAIR)
+	{
+		uint16_t hmask = ~vCfg.PairAddrMask;
+
+		while (len + 2 <= DEVREGSEQ_XFER_MAX && pOp[n].Op == DEVREGSEQ_OP_WRITE &&
+			   ((pOp[n].Reg ^ pOp->Reg) & hmask) == 0)
+		{
+			d[len++] = pOp[n].Reg & vCfg.PairAddrMask;
+			d[len++] = pOp[n++].Val;
+		}
+	}
+
+	SetAddr(addr, pOp->Reg);
+
+	if (n == 1)
+	{
+		// Single write goes through the shadow if any
+		return vpDev->Write8(addr, vCfg.AddrLen, pOp->Val) ? 1 : 0;
+	}
+
+	return vpDev->Write(addr, vCfg.AddrLen, d, len) == len ? n : 0;
+}
+
+/**
+ * @brief	Execute operations from current index
+ *
+ * @return	0 - end of sequence
+ * 			> 0 - time to wait in usec before resuming
+ * 			< 0 - failed
+ */
+int32_t DevRegSeq::Step()
+{
+	uint8_t addr[2];
+
+	while (true)
+	{
+		const DEVREGSEQ *p = &vpSeq[vIdx];
+
+		switch (p->Op)
+		{
+			case DEVREGSEQ_OP_END:
+				return 0;
+
+			case DEVREGSEQ_OP_WRITE:
+				{
+					int n = WriteMerged(p);
+					if (n <= 0)
+					{
+						return -1;
+					}
+					vIdx += n;
+				}
+				break;
+
+			case DEVREGSEQ_OP_UPDATE:
+				SetAddr(addr, p->Reg);
+				if (vpDev->Update8(addr, vCfg.AddrLen, p->Mask, p->Val) == false)
+				{
+					return -1;
+				}
+				vIdx++;
+				break;
+
+			case DEVREGSEQ_OP_READ:
+				SetAddr(addr, p->Reg);
+				if (vpRdBuff == NULL || vpDev->Read(addr, vCfg.AddrLen, &vpRdBuff[p->Param], p->Mask) != p->Mask)
+				{
+					return -1;
+				}
+				vIdx++;
+				break;
+
+			case DEVREGSEQ_OP_POLL:
+				{
+					uint8_t d = 0;
+
+					// Read directly, polled register must not come from the shadow.
+					// A device busy resetting may not respond, it only counts as not ready
+					SetAddr(addr, p->Reg);
+					if (vpDev->Read(addr, vCfg.AddrLen, &d, 1) == 1 && (d & p->Mask) == p->Val)
+					{
+						vPollTime = 0;
+						vIdx++;
+						break;
+					}
+
+					if (vPollTime >= p->Param)
+					{
+						// Timeout
+						vPollTime = 0;
+						return -1;
+					}
+
+					vPollTime += vCfg.PollInterval;
+
+					return vCfg.PollInterval;
+				}
+
+			case DEVREGSEQ_OP_DELAY:
+				vIdx++;
+				if (p->Param > 0)
+				{
+					return p->Param;
+				}
+				break;
+
+			default:
+				return -1;
+		}
+	}
+}
+
+bool DevRegSeq::Run(const DEVREGSEQ *pSeq, uint8_t *pRdBuff)
+{
+	if (vpDev == NULL || pSeq == NULL || vpSeq != NULL)
+		return false;
+
+	vpSeq = pSeq;
+	vpRdBuff = pRdBuff;
+	vIdx = 0;
+	vPollTime = 0;
+	vpTimer = NULL;
+
+	int32_t t;
+
+	while ((t = Step()) > 0)
+	{
+		usDelay(t);
+	}
+
+	vpSeq = NULL;
+
+	return t == 0;
+}
+
+bool DevRegSeq::Start(const DEVREGSEQ *pSeq, uint8_t *pRdBuff, Timer * const pTimer,
+					  DEVREGSEQ_DONECB DoneCB, void * const pCtx)
+{
+	if (vpDev == NULL || pSeq == NULL || pTimer == NULL || vpSeq != NULL)
+		return false;
+
+	vpSeq = pSeq;
+	vpRdBuff = pRdBuff;
+	vIdx = 0;
+	vPollTime = 0;
+	vpTimer = pTimer;
+	vDoneCB = DoneCB;
+	vpDoneCtx = pCtx;
+
+	Resume();
+
+	return true;
+}
+
+void DevRegSeq::Resume()
+{
+	if (vpSeq == NULL || vpTimer == NULL)
+		return;
+
+	vpTimer->DisableTimerTrigger(vCfg.TimerTrigNo);
+
+	int32_t t = Step();
+
+	if (t > 0)
+	{
+		if (vpTimer->EnableTimerTrigger(vCfg.TimerTrigNo, (uint64_t)t * 1000, TIMER_TRIG_TYPE_SINGLE,
+										TimerHandler, this) != 0)
+		{
+			return;
+		}
+
+		// Trigger not available
+		t = -1;
+	}
+
+	Done(t == 0);
+}
+
+void DevRegSeq::Abort()
+{
+	if (vpSeq == NULL)
+		return;
+
+	if (vpTimer != NULL)
+	{
+		vpTimer->DisableTimerTrigger(vCfg.TimerTrigNo);
+	}
+
+	vpSeq = NULL;
+}
+
+void DevRegSeq::Done(bool bSuccess)
+{
+	vpSeq = NULL;
+
+	if (vDoneCB)
+	{
+		vDoneCB(this, bSuccess, vpDoneCtx);
+	}
+}
+
+void DevRegSeq::TimerHandler(Timer * const pTimer, int TrigNo, void * const pCtx)
+{
+	DevRegSeq *seq = (DevRegSeq*)pCtx;
+
+	(void)pTimer; (void)TrigNo;
+	seq->Resume();
+}
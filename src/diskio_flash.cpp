@@ -32,6 +32,7 @@ Modified by          Date              Description
 
 ----------------------------------------------------------------------------*/
 #include <stdio.h>
+#include <string.h>
 
 #include "diskio_flash.h"
 #include "idelay.h"
@@ -40,6 +41,23 @@ FlashDiskIO::FlashDiskIO() : DiskIO()
 {
 	vpWaitCB = NULL;
 	vpInterf = NULL;
+	vSectSize = DISKIO_SECT_SIZE;
+	vReadCmd = FLASH_CMD_READ;
+	vReadDummy = 0;
+	vEraseCmd = FLASH_CMD_BLOCK_ERASE;
+	vEraseTime = 0;
+	vChipEraseTime = 0;
+	vProgTime = 0;
+	vReadAddrLines = 1;
+	vReadDataLines = 1;
+	vProgCmd = FLASH_CMD_WRITE;
+	vProgLines = 1;
+	vbEraseBusy = false;
+	vbSuspended = false;
+	vEraseAddr = 0;
+	vAccess = 0;
+	vbSfdp = false;
+	vpSetLinesCB = NULL;
 }
 
 bool FlashDiskIO::Init(FLASHDISKIO_CFG &Cfg, DeviceIntrf * const pInterf,
@@ -58,14 +76,122 @@ bool FlashDiskIO::Init(FLASHDISKIO_CFG &Cfg, DeviceIntrf * const pInterf,
     	vpWaitCB = Cfg.pWaitCB;
 
     vDevNo          = Cfg.DevNo;
+    vpInterf        = pInterf;
+    vTotalSize      = Cfg.TotalSize;
     vEraseSize      = Cfg.EraseSize;
-    if (Cfg.WriteSize == 0)
+    vWriteSize      = Cfg.WriteSize;
+    vAddrSize       = Cfg.AddrSize;
+    vReadCmd        = FLASH_CMD_READ;
+    vReadDummy      = 0;
+    vEraseCmd       = 0;
+    vEraseTime      = 0;
+    vChipEraseTime  = 0;
+    vProgTime       = 0;
+    vReadAddrLines  = 1;
+    vReadDataLines  = 1;
+    vProgCmd        = FLASH_CMD_WRITE;
+    vProgLines      = 1;
+    vbEraseBusy     = false;
+    vbSuspended     = false;
+    vpSetLinesCB    = NULL;
+
+    vbSfdp = ReadSfdp(vSfdp);
+    if (vbSfdp)
+    {
+        if (vTotalSize == 0)
+            vTotalSize = vSfdp.TotalSize;
+        if (vWriteSize == 0)
+            vWriteSize = vSfdp.PageSize;
+
+        // Smallest erase type unless a size is imposed
+        for (int i = 0; i < FLASH_ERASE_TYPE_MAX; i++)
+        {
+            FLASH_ERASETYPE *e = &vSfdp.Erase[i];
+
+            if (e->Size == 0)
+                continue;
+            if ((Cfg.EraseSize == 0 && (vEraseCmd == 0 || e->Size < vEraseSize)) ||
+                (Cfg.EraseSize != 0 && e->Size == Cfg.EraseSize))
+            {
+                vEraseSize = e->Size;
+                vEraseCmd = e->Cmd;
+                vEraseTime = e->TypTime;
+            }
+        }
+
+        vChipEraseTime = vSfdp.ChipEraseTime;
+        vProgTime = vSfdp.ProgTime;
+
+        // Widest read mode the interface is wired for.  Fast read is mandatory
+        // on SFDP devices.  Dummy clocks must fill whole bytes.
+        static const FLASH_READMODE s_ReadPref[] = {
+            FLASH_READMODE_1_4_4, FLASH_READMODE_1_1_4,
+            FLASH_READMODE_1_2_2, FLASH_READMODE_1_1_2, FLASH_READMODE_1_1_1
+        };
+        static const uint8_t s_ReadLines[FLASH_READMODE_MAX][2] = {
+            { 1, 1 }, { 1, 2 }, { 2, 2 }, { 1, 4 }, { 4, 4 }
+        };
+
+        for (int i = 0; i < (int)(sizeof(s_ReadPref) / sizeof(FLASH_READMODE)); i++)
+        {
+            FLASH_READMODE m = s_ReadPref[i];
+            int bits = vSfdp.Read[m].DummyClk * s_ReadLines[m][0];
+
+            if (m != FLASH_READMODE_1_1_1 &&
+                (Cfg.pSetLinesCB == NULL || s_ReadLines[m][1] > Cfg.NbDataLines ||
+                 vSfdp.Read[m].Cmd == 0 || (bits & 7) || bits > 64))
+                continue;
+
+            vReadCmd = vSfdp.Read[m].Cmd;
+            vReadDummy = bits >> 3;
+            vReadAddrLines = s_ReadLines[m][0];
+            vReadDataLines = s_ReadLines[m][1];
+            break;
+        }
+
+        if (vAddrSize == 0)
+        {
+            vAddrSize = vSfdp.AddrSize;
+            if (vAddrSize > 3 && Enter4ByteAddr() == false)
+            {
+                // Only lower 16MB accessible
+                vAddrSize = 3;
+                vTotalSize = 0x1000000;
+            }
+        }
+    }
+
+    if (vWriteSize == 0)
         vWriteSize = DISKIO_SECT_SIZE;
+    if (vAddrSize == 0)
+        vAddrSize = 3;
+    if (Cfg.SectSize == 0)
+        vSectSize = DISKIO_SECT_SIZE;
     else
-        vWriteSize = Cfg.WriteSize;
-    vTotalSize      = Cfg.TotalSize;
-    vAddrSize       = Cfg.AddrSize;
-    vpInterf        = pInterf;
+        vSectSize = Cfg.SectSize;
+
+    if (vEraseCmd == 0)
+    {
+        if (vEraseSize <= 0x1000)
+            vEraseCmd = FLASH_CMD_SECTOR_ERASE;
+        else if (vEraseSize <= 0x8000)
+            vEraseCmd = FLASH_CMD_BLOCK_ERASE_32;
+        else
+            vEraseCmd = FLASH_CMD_BLOCK_ERASE;
+    }
+
+    if (vTotalSize == 0 || vEraseSize == 0)
+        return false;
+
+    // Lines are switched only once SFDP has been read in single line mode
+    if (Cfg.NbDataLines > 1)
+        vpSetLinesCB = Cfg.pSetLinesCB;
+
+    if (Cfg.QuadProgCmd != 0 && Cfg.NbDataLines >= 4 && vpSetLinesCB)
+    {
+        vProgCmd = Cfg.QuadProgCmd;
+        vProgLines = 4;
+    }
 
     uint32_t d = ReadId();
 
@@ -77,6 +203,205 @@ bool FlashDiskIO::Init(FLASHDISKIO_CFG &Cfg, DeviceIntrf * const pInterf,
     return true;
 }
 
+/**
+ * Read SFDP header, locate Basic Flash Parameter Table and decode it
+ * as per JESD216
+ */
+bool FlashDiskIO::ReadSfdp(FLASH_SFDP &Sfdp)
+{
+    uint32_t dw[FLASH_SFDP_BFPT_MAXDW];
+    uint8_t hdr[8];
+    uint8_t d[5];
+    int len = 0;
+    int minor = -1;
+    uint32_t ptp = 0;
+
+    if (vpInterf == NULL)
+        return false;
+
+    memset(&Sfdp, 0, sizeof(FLASH_SFDP));
+
+    WaitReady(100000);
+
+    // SFDP is always read with 3 bytes address and 8 dummy clocks
+    d[0] = FLASH_CMD_READ_SFDP;
+    d[4] = 0;
+
+    for (int i = -1, n = 0; i <= n; i++)
+    {
+        uint32_t addr = i < 0 ? 0 : 8 + i * 8;
+
+        d[1] = (addr >> 16) & 0xFF;
+        d[2] = (addr >> 8) & 0xFF;
+        d[3] = addr & 0xFF;
+        vpInterf->StartRx(vDevNo);
+        vpInterf->TxData(d, 5);
+        int l = vpInterf->RxData(hdr, 8);
+        vpInterf->StopRx();
+        if (l != 8)
+            return false;
+
+        if (i < 0)
+        {
+            // SFDP header
+            if ((hdr[0] | (hdr[1] << 8) | (hdr[2] << 16) | ((uint32_t)hdr[3] << 24)) != FLASH_SFDP_SIGNATURE)
+                return false;
+            n = hdr[6];		// Number of parameter headers - 1
+        }
+        else if (((hdr[7] << 8) | hdr[0]) == FLASH_SFDP_BFPT_ID && hdr[2] == 1 && hdr[1] >= minor)
+        {
+            // Basic table, keep latest minor revision
+            minor = hdr[1];
+            len = hdr[3];
+            ptp = hdr[4] | (hdr[5] << 8) | (hdr[6] << 16);
+        }
+    }
+
+    if (len < 9)
+        return false;
+
+    len = min(len, FLASH_SFDP_BFPT_MAXDW);
+    memset(dw, 0, sizeof(dw));
+
+    d[1] = (ptp >> 16) & 0xFF;
+    d[2] = (ptp >> 8) & 0xFF;
+    d[3] = ptp & 0xFF;
+    vpInterf->StartRx(vDevNo);
+    vpInterf->TxData(d, 5);
+    int l = vpInterf->RxData((uint8_t*)dw, len * 4);
+    vpInterf->StopRx();
+    if (l != len * 4)
+        return false;
+
+    // DWORD 2 : density in bits
+    if (dw[1] & 0x80000000)
+        Sfdp.TotalSize = (1ULL << (dw[1] & 0x7FFFFFFF)) >> 3;
+    else
+        Sfdp.TotalSize = ((uint64_t)dw[1] + 1) >> 3;
+
+    // DWORD 1 : address bytes and fast read modes
+    switch ((dw[0] >> 17) & 3)
+    {
+        case 0:
+            Sfdp.AddrSize = 3;
+            break;
+        case 1:
+            Sfdp.AddrSize = Sfdp.TotalSize > 0x1000000 ? 4 : 3;
+            break;
+        default:
+            Sfdp.AddrSize = 4;
+    }
+
+    Sfdp.Read[FLASH_READMODE_1_1_1].Cmd = FLASH_CMD_FAST_READ;
+    Sfdp.Read[FLASH_READMODE_1_1_1].DummyClk = 8;
+    if (dw[0] & (1 << 16))
+    {
+        Sfdp.Read[FLASH_READMODE_1_1_2].Cmd = dw[3] >> 8;
+        Sfdp.Read[FLASH_READMODE_1_1_2].DummyClk = (dw[3] & 0x1F) + ((dw[3] >> 5) & 7);
+    }
+    if (dw[0] & (1 << 20))
+    {
+        Sfdp.Read[FLASH_READMODE_1_2_2].Cmd = dw[3] >> 24;
+        Sfdp.Read[FLASH_READMODE_1_2_2].DummyClk = ((dw[3] >> 16) & 0x1F) + ((dw[3] >> 21) & 7);
+    }
+    if (dw[0] & (1 << 21))
+    {
+        Sfdp.Read[FLASH_READMODE_1_4_4].Cmd = dw[2] >> 8;
+        Sfdp.Read[FLASH_READMODE_1_4_4].DummyClk = (dw[2] & 0x1F) + ((dw[2] >> 5) & 7);
+    }
+    if (dw[0] & (1 << 22))
+    {
+        Sfdp.Read[FLASH_READMODE_1_1_4].Cmd = dw[2] >> 24;
+        Sfdp.Read[FLASH_READMODE_1_1_4].DummyClk = ((dw[2] >> 16) & 0x1F) + ((dw[2] >> 21) & 7);
+    }
+
+    // DWORD 8, 9 : erase types, size as power of 2
+    for (int i = 0; i < FLASH_ERASE_TYPE_MAX; i++)
+    {
+        uint32_t v = (dw[7 + (i >> 1)] >> ((i & 1) << 4)) & 0xFFFF;
+
+        if ((v & 0xFF) != 0)
+        {
+            Sfdp.Erase[i].Size = 1UL << (v & 0xFF);
+            Sfdp.Erase[i].Cmd = v >> 8;
+        }
+    }
+
+    // 4KB erase of DWORD 1 when erase types are not filled
+    if (Sfdp.Erase[0].Size == 0 && (dw[0] & 3) == 1)
+    {
+        Sfdp.Erase[0].Size = 0x1000;
+        Sfdp.Erase[0].Cmd = (dw[0] >> 8) & 0xFF;
+    }
+
+    Sfdp.PageSize = 256;
+
+    if (len >= 11)
+    {
+        // DWORD 10 : typical erase times
+        static const uint32_t s_EraseUnit[] = { 1000, 16000, 128000, 1000000 };
+
+        for (int i = 0; i < FLASH_ERASE_TYPE_MAX; i++)
+        {
+            uint32_t v = (dw[9] >> (4 + i * 7)) & 0x7F;
+
+            if (Sfdp.Erase[i].Size)
+                Sfdp.Erase[i].TypTime = ((v & 0x1F) + 1) * s_EraseUnit[v >> 5];
+        }
+
+        // DWORD 11 : page size, program and chip erase times
+        static const uint32_t s_ChipUnit[] = { 16, 256, 4000, 64000 };
+
+        Sfdp.PageSize = 1UL << ((dw[10] >> 4) & 0xF);
+        Sfdp.ProgTime = (((dw[10] >> 8) & 0x1F) + 1) * (dw[10] & (1 << 13) ? 64 : 8);
+        Sfdp.ChipEraseTime = (((dw[10] >> 24) & 0x1F) + 1) * s_ChipUnit[(dw[10] >> 29) & 3];
+    }
+
+    if (len >= 13 && (dw[11] & 0x80000000) == 0)
+    {
+        // DWORD 12, 13 : erase suspend/resume, max suspend latency in 128ns,
+        // 1us, 8us or 64us units
+        static const uint32_t s_SuspUnit[] = { 128, 1000, 8000, 64000 };
+
+        Sfdp.EraseSuspend = dw[12] >> 24;
+        Sfdp.EraseResume = (dw[12] >> 16) & 0xFF;
+        Sfdp.SuspendTime = ((((dw[11] >> 24) & 0x1F) + 1) * s_SuspUnit[(dw[11] >> 29) & 3] + 999) / 1000;
+    }
+
+    if (len >= 16)
+    {
+        Sfdp.Enter4B = dw[15] >> 24;
+    }
+
+    return Sfdp.TotalSize > 0;
+}
+
+bool FlashDiskIO::Enter4ByteAddr()
+{
+    uint8_t d = FLASH_CMD_EN4B;
+
+    if (vSfdp.Enter4B & (1 << 6))
+    {
+        // Always in 4 bytes mode
+        return true;
+    }
+
+    if (vSfdp.Enter4B & (1 << 1))
+    {
+        WriteEnable();
+    }
+    else if (vSfdp.Enter4B != 0 && (vSfdp.Enter4B & 1) == 0)
+    {
+        // Bank register or dedicated instruction set, not supported
+        return false;
+    }
+
+    WaitReady();
+    vpInterf->Tx(vDevNo, &d, 1);
+
+    return true;
+}
+
 uint32_t FlashDiskIO::ReadId()
 {
 	uint32_t id = -1;
@@ -118,7 +443,12 @@ bool FlashDiskIO::WaitReady(uint32_t Timeout, uint32_t usRtyDelay)
         vpInterf->RxData(&d, 1);
         vpInterf->StopRx();
         if (!(d & FLASH_STATUS_WIP))
+        {
+            if (vbSuspended == false)
+                vbEraseBusy = false;
+
             return true;
+        }
 
         if (usRtyDelay > 0)
         {
@@ -155,6 +485,8 @@ void FlashDiskIO::Erase()
 {
     uint8_t d;
 
+    vAccess++;
+
     WriteEnable();
     WaitReady();
 
@@ -162,9 +494,12 @@ void FlashDiskIO::Erase()
 
     vpInterf->Tx(vDevNo, &d, 1);
 
-    // This is a long wait polling at every second only
-    WaitReady(-1, 1000000);
+    // This is a long wait polling at every second only, or 1/16 of typical
+    // time when known
+    WaitReady(-1, vChipEraseTime > 0 ? min(vChipEraseTime * 1000 / 16, 1000000) : 1000000);
     WriteDisable();
+
+    vAccess--;
 }
 
 /**
@@ -173,108 +508,343 @@ void FlashDiskIO::Erase()
  * @param   BlkNo   : Starting block number to erase.
  *          NbBlk   : Number of consecutive blocks to erase
  */
-void FlashDiskIO::EraseBlock(uint32_t BlkNo, int NbBlk)
+bool FlashDiskIO::EraseBlock(uint32_t BlkNo, int NbBlk)
 {
-    uint8_t d[8];
+    uint32_t addr = BlkNo * vEraseSize;
+    bool res = true;
 
-    BlkNo *= vEraseSize;
-    uint8_t *p = (uint8_t*)&BlkNo;
+    vAccess++;
 
-    d[0] = FLASH_CMD_BLOCK_ERASE;
+    // Pending program or erase
+    if (WaitReady(EraseTimeout(), PollDelay()) == false)
+        res = false;
 
-    for (int k = 0; k < NbBlk; k++)
+    for (int k = 0; k < NbBlk && res; k++)
     {
-        for (int i = 1; i <= vAddrSize; i++)
-            d[i] = p[vAddrSize - i];
-        WaitReady(-1, 100);
+        SendErase(addr);
+        res = WaitReady(EraseTimeout(), PollDelay());
+        addr += vEraseSize;
+    }
 
-        // Need to re-enable write here, because some flash
-        // devices may reset write enable after a write
-        // complete
-        WriteEnable();
+    vAccess--;
+
+    return res;
+}
 
-        vpInterf->Tx(vDevNo, d, vAddrSize + 1);
-        BlkNo += vEraseSize;
+/**
+ * Start block erase, write enable is needed before each erase as the device
+ * clears it at completion
+ */
+void FlashDiskIO::SendErase(uint32_t Addr)
+{
+    uint8_t d[5];
+    uint8_t *p = (uint8_t*)&Addr;
+
+    d[0] = FLASH_CMD_WRENABLE;
+    vpInterf->Tx(vDevNo, d, 1);
+
+    d[0] = vEraseCmd;
+    for (int i = 1; i <= vAddrSize; i++)
+        d[i] = p[vAddrSize - i];
+
+    vpInterf->Tx(vDevNo, d, vAddrSize + 1);
+
+    vbEraseBusy = true;
+    vEraseAddr = Addr;
+}
+
+bool FlashDiskIO::EraseStart(uint32_t BlkNo)
+{
+    bool res = false;
+
+    vAccess++;
+
+    if (IsBusy() == false)
+    {
+        SendErase(BlkNo * vEraseSize);
+        res = true;
     }
-    WriteDisable();
+
+    vAccess--;
+
+    return res;
+}
+
+bool FlashDiskIO::IsBusy()
+{
+    if (vbSuspended)
+        return true;
+
+    vAccess++;
+
+    bool busy = ReadStatus() & FLASH_STATUS_WIP;
+
+    if (busy == false)
+        vbEraseBusy = false;
+
+    vAccess--;
+
+    return busy;
 }
 
 /**
- * Read one sector from physical device
+ * Status poll interval, a fraction of the typical time of the pending
+ * operation.  0 polls continuously when the time is unknown
  */
-bool FlashDiskIO::SectRead(uint32_t SectNo, uint8_t *pBuff)
+uint32_t FlashDiskIO::PollDelay()
+{
+    if (vbEraseBusy && vbSuspended == false)
+        return vEraseTime > 1600 ? vEraseTime / 16 : 100;
+
+    return vProgTime >> 4;
+}
+
+/**
+ * Number of status polls at PollDelay interval before a block erase times out
+ */
+uint32_t FlashDiskIO::EraseTimeout()
+{
+    uint32_t t = vEraseTime > 0 ? vEraseTime * FLASH_ERASE_TIMEOUT_MULT : FLASH_ERASE_TIMEOUT_DEF;
+    uint32_t d = PollDelay();
+
+    return d > 0 ? t / d + 1 : t;
+}
+
+bool FlashDiskIO::Suspend()
 {
-    uint8_t d[9];
-    uint32_t addr = SectNo * DISKIO_SECT_SIZE;
-    uint8_t *p = (uint8_t*)&addr;
-    int cnt = DISKIO_SECT_SIZE;
+    if (vbEraseBusy == false || vbSuspended || vbSfdp == false || vSfdp.EraseSuspend == 0)
+        return false;
+
+    uint8_t d = vSfdp.EraseSuspend;
+
+    vpInterf->Tx(vDevNo, &d, 1);
+    vbSuspended = true;
+
+    // Ready once suspended or if the erase completed meanwhile
+    if (WaitReady(100000, vSfdp.SuspendTime >> 2) == false)
+    {
+        // Not suspended, the access waits for the erase
+        Resume();
+
+        return false;
+    }
+
+    return true;
+}
+
+void FlashDiskIO::Resume()
+{
+    if (vbSuspended == false)
+        return;
+
+    uint8_t d = vSfdp.EraseResume;
+
+    vpInterf->Tx(vDevNo, &d, 1);
+    vbSuspended = false;
+}
+
+bool FlashDiskIO::SuspendFor(uint32_t Addr, uint32_t Len)
+{
+    if (vbEraseBusy == false || vbSfdp == false || vSfdp.EraseSuspend == 0 ||
+        (Addr + Len > vEraseAddr && Addr < vEraseAddr + vEraseSize))
+        return false;
+
+    return IsBusy() && Suspend();
+}
+
+void FlashDiskIO::SetLines(int NbLines)
+{
+    if (vpSetLinesCB)
+        vpSetLinesCB(vDevNo, vpInterf, NbLines);
+}
+
+/**
+ * Read data from any address, the flash address auto increments so a single
+ * read command covers the whole length
+ */
+int FlashDiskIO::ReadData(uint32_t Addr, uint8_t *pBuff, uint32_t Len)
+{
+    uint8_t d[16];
+    uint8_t *p = (uint8_t*)&Addr;
+    int cnt = Len;
+
+    vAccess++;
+
+    // A read outside of the block being erased suspends the erase instead of
+    // waiting for it
+    bool resume = SuspendFor(Addr, Len);
 
     // Makesure there is no write access pending
-    WaitReady(100000);
+    if (resume == false && WaitReady(vbEraseBusy ? EraseTimeout() : 100000, PollDelay()) == false)
+    {
+        vAccess--;
 
-    d[0] = FLASH_CMD_READ;
+        return 0;
+    }
+
+    d[0] = vReadCmd;
 
     while (cnt > 0)
     {
         for (int i = 1; i <= vAddrSize; i++)
             d[i] = p[vAddrSize - i];
+        for (int i = 0; i < vReadDummy; i++)
+            d[vAddrSize + 1 + i] = 0;
 
         vpInterf->StartRx(vDevNo);
-        vpInterf->TxData((uint8_t*)d, vAddrSize + 1);
-        int l = vpInterf->RxData(pBuff, DISKIO_SECT_SIZE);
+        if (vpSetLinesCB)
+        {
+            // Opcode on single line, address and dummy then data on more lines
+            vpInterf->TxData(d, 1);
+            SetLines(vReadAddrLines);
+            vpInterf->TxData(&d[1], vAddrSize + vReadDummy);
+            SetLines(vReadDataLines);
+        }
+        else
+        {
+            vpInterf->TxData((uint8_t*)d, vAddrSize + 1 + vReadDummy);
+        }
+        int l = vpInterf->RxData(pBuff, cnt);
         vpInterf->StopRx();
+        SetLines(1);
         if (l <= 0)
-            return false;
+            break;
         cnt -= l;
-        addr += l;
+        Addr += l;
         pBuff += l;
     }
-    //printf("RSect : %d 0x%02x 0x%02x 0x%02x 0x%02x\r\n", SectNo, pBuff[0], pBuff[1], pBuff[2], pBuff[3]);
-    return true;
+
+    if (resume)
+        Resume();
+
+    vAccess--;
+
+    return Len - cnt;
 }
 
 /**
- * Write one sector to physical device
+ * Program data at any address, one program command per write page. Page
+ * program wraps around within the page so data is split at page boundaries.
+ * Returns once the last page program is started
  */
-bool FlashDiskIO::SectWrite(uint32_t SectNo, uint8_t *pData)
+int FlashDiskIO::ProgramData(uint32_t Addr, uint8_t *pData, uint32_t Len)
 {
-    uint8_t d[9];
-    uint32_t addr = SectNo * DISKIO_SECT_SIZE;
-    uint8_t *p = (uint8_t*)&addr;
+    int cnt = Len;
 
-    int cnt = 0;
+    vAccess++;
 
-   // printf("Sect : %d 0x%02x 0x%02x 0x%02x 0x%02x\r\n", SectNo, pData[0], pData[1], pData[2], pData[3]);
-    d[0] = FLASH_CMD_WRITE;
+    // Pages outside of the block being erased are programmed with the erase
+    // suspended.  The last page must complete before resuming.
+    bool resume = SuspendFor(Addr, Len);
+    int l = 0;
 
-    cnt = DISKIO_SECT_SIZE;
     while (cnt > 0)
     {
-        for (int i = 1; i <= vAddrSize; i++)
-            d[i] = p[vAddrSize - i];
+        l = min(cnt, vWriteSize - (Addr % vWriteSize));
 
-        int l = min(cnt, vWriteSize);
-
-        WaitReady();
-
-        // Some Flash will reset write enable bit at completion
-        // when page size is less than 512 bytes.
-        // We need to set it again
-        WriteEnable();
+        if (WaitReady(vbEraseBusy && resume == false ? EraseTimeout() : 100000, PollDelay()) == false)
+        {
+            l = 0;
+            break;
+        }
 
-        vpInterf->StartTx(vDevNo);
-        vpInterf->TxData((uint8_t*)d, vAddrSize + 1);
-        l = vpInterf->TxData(pData, l);
-        vpInterf->StopTx();
+        l = Program(Addr, pData, l);
         if (l <= 0)
-            return false;
+            break;
         cnt -= l;
         pData += l;
-        addr += l;
+        Addr += l;
     }
-    WriteDisable();
 
-    return true;
+    if (resume)
+    {
+        // Last page not confirmed if the device stays busy
+        if (WaitReady(100000, PollDelay()) == false && l > 0)
+            cnt += l;
+        Resume();
+    }
+
+    vAccess--;
+
+    return Len - cnt;
 }
 
+int FlashDiskIO::ProgramStart(uint32_t Addr, uint8_t *pData, uint32_t Len)
+{
+    int l = 0;
+
+    vAccess++;
+
+    if (Len > 0 && IsBusy() == false)
+        l = Program(Addr, pData, min(Len, vWriteSize - (Addr % vWriteSize)));
+
+    vAccess--;
 
+    return l;
+}
+
+/**
+ * Send one page program, the device must be ready.  Write enable is needed
+ * before each program as the device clears it at completion
+ */
+int FlashDiskIO::Program(uint32_t Addr, uint8_t *pData, uint32_t Len)
+{
+    uint8_t d[5];
+    uint8_t *p = (uint8_t*)&Addr;
+
+    d[0] = FLASH_CMD_WRENABLE;
+    vpInterf->Tx(vDevNo, d, 1);
+
+    d[0] = vProgCmd;
+    for (int i = 1; i <= vAddrSize; i++)
+        d[i] = p[vAddrSize - i];
+
+    vpInterf->StartTx(vDevNo);
+    vpInterf->TxData(d, vAddrSize + 1);
+    if (vProgLines > 1)
+        SetLines(vProgLines);
+    int l = vpInterf->TxData(pData, Len);
+    vpInterf->StopTx();
+    if (vProgLines > 1)
+        SetLines(1);
+
+    return l;
+}
+
+/**
+ * Read one sector from physical device
+ */
+bool FlashDiskIO::SectRead(uint32_t SectNo, uint8_t *pBuff)
+{
+    return ReadData(SectNo * vSectSize, pBuff, vSectSize) == (int)vSectSize;
+}
+
+/**
+ * Write one sector to physical device
+ */
+bool FlashDiskIO::SectWrite(uint32_t SectNo, uint8_t *pData)
+{
+    return ProgramData(SectNo * vSectSize, pData, vSectSize) == (int)vSectSize;
+}
+
+/**
+ * Read consecutive sectors from physical device with a single read command
+ */
+int FlashDiskIO::SectReadMulti(uint32_t SectNo, uint8_t *pBuff, int NbSect)
+{
+    if (NbSect <= 0)
+        return 0;
+
+    return ReadData(SectNo * vSectSize, pBuff, NbSect * vSectSize) / vSectSize;
+}
+
+/**
+ * Write consecutive sectors to physical device, one program command per page
+ */
+int FlashDiskIO::SectWriteMulti(uint32_t SectNo, uint8_t *pData, int NbSect)
+{
+    if (NbSect <= 0)
+        return 0;
+
+    return ProgramData(SectNo * vSectSize, pData, NbSect * vSectSize) / vSectSize;
+}
@@ -0,0 +1,613 @@
+/**-------------------------------------------------------------------------
+@file	diskio_ftl.cpp
+
+@brief	Flash translation layer for NOR flash disk
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+
+#include "istddef.h"
+#include "crc.h"
+#include "diskio_ftl.h"
+
+#define FLASHFTL_TAG_CHUNK		16		// Tags read at once
+#define FLASHFTL_COPY_CHUNK		256		// Bytes copied at once by garbage collection
+
+FlashFtl::FlashFtl() : DiskIO()
+{
+	vpFlash = NULL;
+	vSectSize = DISKIO_SECT_SIZE;
+	vNbLSect = 0;
+	vNbBlk = 0;
+	vpMap = NULL;
+	vpBlk = NULL;
+	vActBlk = -1;
+	vbInGC = false;
+	vHostWrCnt = 0;
+	vPageWrCnt = 0;
+	vBlkEraseCnt = 0;
+}
+
+bool FlashFtl::Init(const FLASHFTL_CFG &Cfg, FlashDiskIO * const pFlash,
+					DISKIO_CACHE_DESC * const pCacheBlk, int NbCacheBlk)
+{
+	if (pFlash == NULL || Cfg.pMem == NULL)
+		return false;
+
+	vpFlash = pFlash;
+	vSectSize = pFlash->GetSectSize();
+	vEraseSize = pFlash->GetMinEraseSize();
+
+	if (vEraseSize < vSectSize * 2 || (vEraseSize % vSectSize) != 0)
+		return false;
+
+	uint32_t totblk = pFlash->GetSize() / vEraseSize;
+
+	vStartBlk = Cfg.StartBlk;
+	vNbBlk = Cfg.NbBlk > 0 ? Cfg.NbBlk : totblk - Cfg.StartBlk;
+
+	uint32_t nbspare = max(Cfg.NbSpareBlk, FLASHFTL_SPARE_BLK_MIN);
+
+	if (vStartBlk + vNbBlk > totblk || nbspare >= vNbBlk)
+		return false;
+
+	// Header and tags take the first pages of each block
+	uint32_t nbpg = vEraseSize / vSectSize;
+
+	vNbHdrPg = 1;
+	while (sizeof(FLASHFTL_BLKHDR) + (nbpg - vNbHdrPg) * sizeof(FLASHFTL_TAG) > vNbHdrPg * vSectSize)
+	{
+		vNbHdrPg++;
+	}
+	vNbPgPerBlk = nbpg - vNbHdrPg;
+	vNbLSect = (vNbBlk - nbspare) * vNbPgPerBlk;
+
+	if (vNbBlk * sizeof(FLASHFTL_BLKINFO) + vNbLSect * sizeof(uint32_t) > Cfg.MemSize)
+		return false;
+
+	vpBlk = (FLASHFTL_BLKINFO*)Cfg.pMem;
+	vpMap = (uint32_t*)&vpBlk[vNbBlk];
+	vWearThreshold = Cfg.WearThreshold > 0 ? Cfg.WearThreshold : FLASHFTL_WEAR_THRESHOLD_DEF;
+
+	if (Mount() == false)
+		return false;
+
+	if (pCacheBlk && NbCacheBlk > 0)
+	{
+		SetCache(pCacheBlk, NbCacheBlk);
+	}
+
+	return true;
+}
+
+/**
+ * Rebuild mapping from block headers and tags, newest copy of a sector wins.
+ */
+bool FlashFtl::Mount()
+{
+	FLASHFTL_BLKHDR hdr;
+	FLASHFTL_TAG tag[FLASHFTL_TAG_CHUNK];
+	uint32_t cntsum = 0;
+	uint32_t cntnb = 0;
+
+	vSeq = 0;
+	vActBlk = -1;
+	vNbFree = 0;
+	vMaxEraseCnt = 0;
+	vHostWrCnt = 0;
+	vPageWrCnt = 0;
+	vBlkEraseCnt = 0;
+
+	memset(vpMap, 0xff, vNbLSect * sizeof(uint32_t));
+
+	for (uint32_t blk = 0; blk < vNbBlk; blk++)
+	{
+		FLASHFTL_BLKINFO *b = &vpBlk[blk];
+		uint32_t addr = (vStartBlk + blk) * vEraseSize;
+
+		b->NbValid = 0;
+		b->EraseCnt = 0;
+
+		if (vpFlash->ReadData(addr, (uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr))
+			return false;
+
+		if (hdr.Magic != FLASHFTL_MAGIC || hdr.Crc != crc32((uint8_t*)&hdr, 8))
+		{
+			// Blank, foreign or interrupted erase
+			b->NbUsed = FLASHFTL_BLK_DIRTY;
+			vNbFree++;
+			continue;
+		}
+
+		b->EraseCnt = hdr.EraseCnt;
+		cntsum += hdr.EraseCnt;
+		cntnb++;
+		if (hdr.EraseCnt > vMaxEraseCnt)
+			vMaxEraseCnt = hdr.EraseCnt;
+
+		if (hdr.State == 0xFFFFFFFF)
+		{
+			b->NbUsed = 0;
+			vNbFree++;
+			continue;
+		}
+
+		int last = -1;
+
+		for (uint32_t i = 0; i < vNbPgPerBlk; i += FLASHFTL_TAG_CHUNK)
+		{
+			uint32_t pg = blk * vNbPgPerBlk + i;
+			int n = min(FLASHFTL_TAG_CHUNK, vNbPgPerBlk - i);
+
+			if (vpFlash->ReadData(TagAddr(pg), (uint8_t*)tag, n * sizeof(FLASHFTL_TAG)) != (int)(n * sizeof(FLASHFTL_TAG)))
+				return false;
+
+			for (int j = 0; j < n; j++)
+			{
+				if (tag[j].LSect != 0xFFFFFFFF || tag[j].Seq != 0xFFFFFFFF || tag[j].Crc != 0xFFFFFFFF)
+					last = i + j;
+
+				if (tag[j].LSect >= vNbLSect || tag[j].Crc != crc32((uint8_t*)&tag[j], 8))
+					continue;
+
+				uint32_t old = vpMap[tag[j].LSect];
+				if (old != FLASHFTL_SECT_UNMAPPED)
+				{
+					FLASHFTL_TAG otag;
+
+					vpFlash->ReadData(TagAddr(old), (uint8_t*)&otag, sizeof(otag));
+					if ((int32_t)(tag[j].Seq - otag.Seq) < 0)
+						continue;	// Stale copy
+				}
+				Map(tag[j].LSect, pg + j);
+
+				if ((int32_t)(tag[j].Seq - vSeq) >= 0)
+					vSeq = tag[j].Seq + 1;
+			}
+		}
+
+		// Pages past the last tag may hold data of an interrupted write,
+		// writing resumes after the last one that is not blank
+		b->NbUsed = last + 1;
+		for (uint32_t i = last + 1; i < vNbPgPerBlk; i++)
+		{
+			if (IsBlank(PageAddr(blk * vNbPgPerBlk + i), vSectSize) == false)
+				b->NbUsed = i + 1;
+		}
+
+		if (b->NbUsed == 0)
+		{
+			vNbFree++;
+		}
+		else if (b->NbUsed < vNbPgPerBlk && vActBlk < 0)
+		{
+			vActBlk = blk;
+		}
+	}
+
+	// Erase count of unknown blocks is assumed to be average
+	uint32_t avg = cntnb > 0 ? cntsum / cntnb : 0;
+
+	for (uint32_t blk = 0; blk < vNbBlk; blk++)
+	{
+		if (vpBlk[blk].NbUsed == FLASHFTL_BLK_DIRTY)
+			vpBlk[blk].EraseCnt = avg;
+	}
+
+	return true;
+}
+
+void FlashFtl::Map(uint32_t LSect, uint32_t PgNo)
+{
+	uint32_t old = vpMap[LSect];
+
+	if (old != FLASHFTL_SECT_UNMAPPED)
+		vpBlk[old / vNbPgPerBlk].NbValid--;
+
+	vpMap[LSect] = PgNo;
+	vpBlk[PgNo / vNbPgPerBlk].NbValid++;
+}
+
+bool FlashFtl::IsBlank(uint32_t Addr, uint32_t Len)
+{
+	uint8_t buff[FLASHFTL_COPY_CHUNK];
+
+	while (Len > 0)
+	{
+		int l = min(FLASHFTL_COPY_CHUNK, Len);
+
+		if (vpFlash->ReadData(Addr, buff, l) != l)
+			return false;
+
+		for (int i = 0; i < l; i++)
+		{
+			if (buff[i] != 0xff)
+				return false;
+		}
+		Addr += l;
+		Len -= l;
+	}
+
+	return true;
+}
+
+/**
+ * Program tags of NbPg consecutive pages holding consecutive logical sectors
+ */
+bool FlashFtl::ProgramTags(uint32_t PgNo, uint32_t LSect, int NbPg)
+{
+	FLASHFTL_TAG tag[FLASHFTL_TAG_CHUNK];
+
+	while (NbPg > 0)
+	{
+		int n = min(NbPg, FLASHFTL_TAG_CHUNK);
+
+		for (int i = 0; i < n; i++)
+		{
+			tag[i].LSect = LSect + i;
+			tag[i].Seq = vSeq++;
+			tag[i].Crc = crc32((uint8_t*)&tag[i], 8);
+		}
+		if (vpFlash->ProgramData(TagAddr(PgNo), (uint8_t*)tag, n * sizeof(FLASHFTL_TAG)) != (int)(n * sizeof(FLASHFTL_TAG)))
+			return false;
+
+		PgNo += n;
+		LSect += n;
+		NbPg -= n;
+	}
+
+	return true;
+}
+
+/**
+ * Erase block and write its header, block becomes free
+ */
+bool FlashFtl::EraseBlk(uint32_t BlkNo)
+{
+	FLASHFTL_BLKHDR hdr;
+
+	if (vpFlash->EraseBlock(vStartBlk + BlkNo, 1) == false)
+		return false;
+	vBlkEraseCnt++;
+
+	hdr.Magic = FLASHFTL_MAGIC;
+	hdr.EraseCnt = vpBlk[BlkNo].EraseCnt + 1;
+	hdr.Crc = crc32((uint8_t*)&hdr, 8);
+
+	vpBlk[BlkNo].EraseCnt = hdr.EraseCnt;
+	vpBlk[BlkNo].NbValid = 0;
+	vpBlk[BlkNo].NbUsed = 0;
+
+	if (hdr.EraseCnt > vMaxEraseCnt)
+		vMaxEraseCnt = hdr.EraseCnt;
+
+	// State is left erased until block is opened
+	int l = offsetof(FLASHFTL_BLKHDR, State);
+
+	return vpFlash->ProgramData((vStartBlk + BlkNo) * vEraseSize, (uint8_t*)&hdr, l) == l;
+}
+
+/**
+ * Take the least worn free block for writing
+ */
+int FlashFtl::OpenBlock()
+{
+	int blk = -1;
+
+	for (uint32_t i = 0; i < vNbBlk; i++)
+	{
+		if ((vpBlk[i].NbUsed == 0 || vpBlk[i].NbUsed == FLASHFTL_BLK_DIRTY) &&
+			(blk < 0 || vpBlk[i].EraseCnt < vpBlk[blk].EraseCnt))
+		{
+			blk = i;
+		}
+	}
+
+	if (blk < 0)
+		return -1;
+
+	if (vpBlk[blk].NbUsed == FLASHFTL_BLK_DIRTY && EraseBlk(blk) == false)
+		return -1;
+
+	// Mark block in use so that it is closed at next mount
+	uint32_t state = FLASHFTL_BLK_OPEN;
+
+	vpFlash->ProgramData((vStartBlk + blk) * vEraseSize + offsetof(FLASHFTL_BLKHDR, State), (uint8_t*)&state, 4);
+	vNbFree--;
+
+	return blk;
+}
+
+/**
+ * Get next free page of the active block, open a new block when full.
+ * Garbage collection is run before as needed to keep spare blocks free.
+ */
+int FlashFtl::AllocPage(bool bGC)
+{
+	if (bGC == false)
+	{
+		while (vNbFree < FLASHFTL_SPARE_BLK_MIN && Reclaim(false));
+	}
+
+	if (vActBlk < 0 || vpBlk[vActBlk].NbUsed >= vNbPgPerBlk)
+	{
+		if (bGC == false && vNbFree >= FLASHFTL_SPARE_BLK_MIN)
+		{
+			// Opportunity to move cold data out of least worn block
+			Reclaim(true);
+		}
+
+		if (vActBlk < 0 || vpBlk[vActBlk].NbUsed >= vNbPgPerBlk)
+		{
+			vActBlk = OpenBlock();
+			if (vActBlk < 0)
+				return -1;
+		}
+	}
+
+	return vActBlk * vNbPgPerBlk + vpBlk[vActBlk].NbUsed++;
+}
+
+/**
+ * Copy valid pages of a block to the active block
+ *
+ * @return	Number of pages copied, -1 on failure
+ */
+int FlashFtl::Relocate(uint32_t BlkNo)
+{
+	FLASHFTL_TAG tag[FLASHFTL_TAG_CHUNK];
+	uint8_t buff[FLASHFTL_COPY_CHUNK];
+	int cnt = 0;
+
+	for (uint32_t i = 0; i < vNbPgPerBlk && vpBlk[BlkNo].NbValid > 0; i += FLASHFTL_TAG_CHUNK)
+	{
+		uint32_t pg = BlkNo * vNbPgPerBlk + i;
+		int n = min(FLASHFTL_TAG_CHUNK, vNbPgPerBlk - i);
+
+		if (vpFlash->ReadData(TagAddr(pg), (uint8_t*)tag, n * sizeof(FLASHFTL_TAG)) != (int)(n * sizeof(FLASHFTL_TAG)))
+			return -1;
+
+		for (int j = 0; j < n; j++)
+		{
+			if (tag[j].LSect >= vNbLSect || vpMap[tag[j].LSect] != pg + j)
+				continue;
+
+			int newpg = AllocPage(true);
+			if (newpg < 0)
+				return -1;
+
+			uint32_t src = PageAddr(pg + j);
+			uint32_t dst = PageAddr(newpg);
+
+			for (uint32_t k = 0; k < vSectSize; k += FLASHFTL_COPY_CHUNK)
+			{
+				int l = min(FLASHFTL_COPY_CHUNK, vSectSize - k);
+
+				if (vpFlash->ReadData(src + k, buff, l) != l ||
+					vpFlash->ProgramData(dst + k, buff, l) != l)
+					return -1;
+			}
+			if (ProgramTags(newpg, tag[j].LSect, 1) == false)
+				return -1;
+
+			Map(tag[j].LSect, newpg);
+			vPageWrCnt++;
+			cnt++;
+		}
+	}
+
+	return cnt;
+}
+
+/**
+ * Garbage collect one block.
+ *
+ * @param	bStatic	: false - pick block with least valid pages
+ * 					  true - pick least worn block if it lags behind by more than
+ * 					  the wear threshold, to put its static data in circulation
+ */
+bool FlashFtl::Reclaim(bool bStatic)
+{
+	int victim = -1;
+
+	for (uint32_t i = 0; i < vNbBlk; i++)
+	{
+		if (vpBlk[i].NbUsed == 0 || vpBlk[i].NbUsed == FLASHFTL_BLK_DIRTY ||
+			((int)i == vActBlk && vpBlk[i].NbUsed < vNbPgPerBlk))
+			continue;
+
+		if (victim < 0)
+		{
+			victim = i;
+		}
+		else if (bStatic)
+		{
+			if (vpBlk[i].EraseCnt < vpBlk[victim].EraseCnt)
+				victim = i;
+		}
+		else if (vpBlk[i].NbValid < vpBlk[victim].NbValid ||
+				 (vpBlk[i].NbValid == vpBlk[victim].NbValid && vpBlk[i].EraseCnt < vpBlk[victim].EraseCnt))
+		{
+			victim = i;
+		}
+	}
+
+	if (victim < 0)
+		return false;
+
+	if (bStatic)
+	{
+		if (vMaxEraseCnt - vpBlk[victim].EraseCnt <= vWearThreshold)
+			return false;
+	}
+	else if (vpBlk[victim].NbValid >= vNbPgPerBlk)
+	{
+		// Nothing to gain
+		return false;
+	}
+
+	// Valid pages must fit, a collection that cannot complete makes no progress
+	uint32_t room = vNbFree * vNbPgPerBlk;
+
+	if (vActBlk >= 0)
+		room += vNbPgPerBlk - vpBlk[vActBlk].NbUsed;
+
+	if (vpBlk[victim].NbValid > room)
+		return false;
+
+	bool gc = vbInGC;
+
+	vbInGC = true;
+	int res = Relocate(victim);
+	vbInGC = gc;
+
+	if (res < 0 || EraseBlk(victim) == false)
+		return false;
+
+	vNbFree++;
+
+	return true;
+}
+
+bool FlashFtl::Collect()
+{
+	if (vpFlash == NULL || vbInGC || vNbFree < 1)
+		return false;
+
+	return Reclaim(false);
+}
+
+void FlashFtl::Erase()
+{
+	if (vpFlash == NULL)
+		return;
+
+	for (uint32_t i = 0; i < vNbBlk; i++)
+	{
+		EraseBlk(i);
+	}
+
+	memset(vpMap, 0xff, vNbLSect * sizeof(uint32_t));
+	vNbFree = vNbBlk;
+	vActBlk = -1;
+
+	// Cached sectors are gone too
+	Reset();
+}
+
+bool FlashFtl::SectRead(uint32_t SectNo, uint8_t *pBuff)
+{
+	return SectReadMulti(SectNo, pBuff, 1) == 1;
+}
+
+bool FlashFtl::SectWrite(uint32_t SectNo, uint8_t *pData)
+{
+	return SectWriteMulti(SectNo, pData, 1) == 1;
+}
+
+int FlashFtl::SectReadMulti(uint32_t SectNo, uint8_t *pBuff, int NbSect)
+{
+	int cnt = 0;
+
+	if (vpFlash == NULL)
+		return 0;
+
+	while (cnt < NbSect && SectNo < vNbLSect)
+	{
+		uint32_t pg = vpMap[SectNo];
+		int n = 1;
+
+		if (pg == FLASHFTL_SECT_UNMAPPED)
+		{
+			// Never written, reads as erased flash
+			memset(pBuff, 0xff, vSectSize);
+		}
+		else
+		{
+			// Extend to following sectors stored in consecutive pages
+			uint32_t addr = PageAddr(pg);
+
+			while (cnt + n < NbSect && SectNo + n < vNbLSect && vpMap[SectNo + n] != FLASHFTL_SECT_UNMAPPED &&
+				   PageAddr(vpMap[SectNo + n]) == addr + n * vSectSize)
+			{
+				n++;
+			}
+
+			if (vpFlash->ReadData(addr, pBuff, n * vSectSize) != (int)(n * vSectSize))
+				break;
+		}
+
+		cnt += n;
+		SectNo += n;
+		pBuff += n * vSectSize;
+	}
+
+	return cnt;
+}
+
+int FlashFtl::SectWriteMulti(uint32_t SectNo, uint8_t *pData, int NbSect)
+{
+	int cnt = 0;
+
+	if (vpFlash == NULL)
+		return 0;
+
+	while (cnt < NbSect && SectNo < vNbLSect)
+	{
+		int pg = AllocPage(false);
+		if (pg < 0)
+			break;
+
+		// Take as many following pages of the active block as possible
+		int n = min(min(NbSect - cnt, vNbLSect - SectNo), vNbPgPerBlk - vpBlk[vActBlk].NbUsed + 1);
+
+		vpBlk[vActBlk].NbUsed += n - 1;
+
+		// Data first, tags commit it
+		if (vpFlash->ProgramData(PageAddr(pg), pData, n * vSectSize) != (int)(n * vSectSize))
+			break;
+
+		if (ProgramTags(pg, SectNo, n) == false)
+			break;
+
+		for (int i = 0; i < n; i++)
+		{
+			Map(SectNo + i, pg + i);
+		}
+
+		vHostWrCnt += n;
+		vPageWrCnt += n;
+		cnt += n;
+		SectNo += n;
+		pData += n * vSectSize;
+	}
+
+	return cnt;
+}
@@ -42,81 +42,392 @@ Modified by          Date              Description
 
 using namespace std;
 
-DiskIO::DiskIO() : vLastIdx(1), vNbCache(0), vpCacheSect(NULL)
+DiskIO::DiskIO() : vNbCache(0), vNbWays(0), vNbSets(0), vCacheStamp(0), vpCacheSect(NULL),
+		vpStrmBuff(NULL), vStrmSize(0), vStrmCnt(0), vStrmSect(0), vLastMiss(-1), vSeqCnt(0)
 {
 }
 
-void DiskIO::SetCache(DISKIO_CACHE_DESC * const pCacheBlk, int NbCacheBlk)
+void DiskIO::SetCache(DISKIO_CACHE_DESC * const pCacheBlk, int NbCacheBlk, int NbWays)
 {
 	if (pCacheBlk == NULL || NbCacheBlk <= 0)
 		return;
 
+	if (NbWays <= 0 || NbWays > NbCacheBlk)
+	{
+		// Fully associative
+		NbWays = NbCacheBlk;
+	}
+
 	vNbCache = NbCacheBlk;
+	vNbWays = NbWays;
+	vNbSets = (NbCacheBlk + NbWays - 1) / NbWays;
 
 	vpCacheSect = pCacheBlk;
 
+	Reset();
+}
+
+void DiskIO::SetStreamBuffer(uint8_t * const pBuff, int NbSect)
+{
+	vpStrmBuff = NbSect > 0 ? pBuff : NULL;
+	vStrmSize = vpStrmBuff ? NbSect : 0;
+	vStrmCnt = 0;
+}
+
+void DiskIO::Reset()
+{
+	vCacheStamp = 0;
+	vStrmCnt = 0;
+	vLastMiss = -1;
+	vSeqCnt = 0;
+
 	for (int i = 0; i < vNbCache; i++)
 	{
 		vpCacheSect[i].UseCnt = 0;
 		vpCacheSect[i].SectNo = -1;
+		vpCacheSect[i].LastUse = 0;
+		vpCacheSect[i].Flags = 0;
 	}
 }
 
-void DiskIO::Reset()
+int DiskIO::FindCacheSect(uint32_t SectNo)
 {
-	for (int i = 0; i < vNbCache; i++)
+	if (vNbCache <= 0)
+		return -1;
+
+	int i = (SectNo % vNbSets) * vNbWays;
+	int end = min(i + vNbWays, vNbCache);
+
+	for (; i < end; i++)
 	{
-		vpCacheSect[i].UseCnt = 0;
-		vpCacheSect[i].SectNo = -1;
+		if (vpCacheSect[i].SectNo == SectNo)
+		{
+			return i;
+		}
 	}
+
+	return -1;
 }
 
-int	DiskIO::GetCacheSect(uint32_t SectNo, bool bLock)
+int	DiskIO::GetCacheSect(uint32_t SectNo, bool bLock, bool bFill)
 {
-    // Try to find sector in cache
-	for (int i = 0; i < vNbCache; i++)
+	if (vNbCache <= 0)
+		return -1;
+
+	// Sector can only be in its own set
+	int first = (SectNo % vNbSets) * vNbWays;
+	int end = min(first + vNbWays, vNbCache);
+
+	vCacheStamp++;
+
+	for (int i = first; i < end; i++)
 	{
 		// Grab first cache
 		vpCacheSect[i].UseCnt++;
 		if (vpCacheSect[i].SectNo == SectNo)
 		{
+			vpCacheSect[i].LastUse = vCacheStamp;
 			return i;
 		}
 		// Not requested sector release it
 		vpCacheSect[i].UseCnt--;
 	}
 
-	// Not in cache, try to pick unused cache
-	int i = vNbCache;
+	// Not in cache, pick empty or least recently used sector of the set
+	int idx = -1;
+	uint32_t age = 0;
 
-	while (i > 0)
+	for (int i = first; i < end; i++)
 	{
-		vLastIdx++;
+		if (vpCacheSect[i].UseCnt != 0 || (vpCacheSect[i].Flags & DISKIO_CACHE_FLAG_PINNED))
+			continue;
+
+		if (vpCacheSect[i].SectNo == (uint32_t)-1)
+		{
+			idx = i;
+			break;
+		}
 
-		if (vLastIdx >= vNbCache)
-			vLastIdx = 0;
+		uint32_t a = vCacheStamp - vpCacheSect[i].LastUse;
 
-		if ((vpCacheSect[vLastIdx].UseCnt & ~DISKIO_CACHE_DIRTY_BIT) == 0)
+		if (idx < 0 || a > age)
 		{
-			// Got unused cache
+			idx = i;
+			age = a;
+		}
+	}
+
+	if (idx < 0)
+	{
+		// No Cache avail
+		return -1;
+	}
 
-		    // Flush cache is dirty
-		    if (vpCacheSect[vLastIdx].UseCnt & DISKIO_CACHE_DIRTY_BIT)
-		        SectWrite(vpCacheSect[vLastIdx].SectNo, vpCacheSect[vLastIdx].pSectData);
+	DISKIO_CACHE_DESC *p = &vpCacheSect[idx];
 
-	        vpCacheSect[vLastIdx].UseCnt = 1;
+	p->UseCnt = 1;
 
-	        // Fill cache
-			SectRead(SectNo, vpCacheSect[vLastIdx].pSectData);
+	// Flush cache if dirty
+	if (p->Flags & DISKIO_CACHE_FLAG_DIRTY)
+	{
+		if (WriteBack(idx) == false)
+		{
+			p->UseCnt = 0;
 
-			vpCacheSect[vLastIdx].SectNo = SectNo;
-			return vLastIdx;
+			return -1;
 		}
-		i--;
 	}
 
-	// No Cache avail
-	return -1;
+	// Fill cache
+	p->SectNo = -1;
+
+	if (bFill && FillCacheSect(p, SectNo, bLock) == false)
+	{
+		p->UseCnt = 0;
+
+		return -1;
+	}
+
+	p->SectNo = SectNo;
+	p->LastUse = vCacheStamp;
+
+	return idx;
+}
+
+bool DiskIO::FillCacheSect(DISKIO_CACHE_DESC * const pCache, uint32_t SectNo, bool bWrite)
+{
+	uint32_t sectsz = GetSectSize();
+
+	if (bWrite == false)
+	{
+		// Detect sequential read
+		if (SectNo == vLastMiss + 1)
+		{
+			vSeqCnt++;
+		}
+		else
+		{
+			vSeqCnt = 0;
+		}
+		vLastMiss = SectNo;
+	}
+
+	if (vpStrmBuff)
+	{
+		uint32_t k = SectNo - vStrmSect;
+
+		if (k >= (uint32_t)vStrmCnt && vSeqCnt >= DISKIO_SEQ_DETECT_CNT && bWrite == false)
+		{
+			// Sequential stream, read ahead
+			uint32_t nbsect = GetNbSect();
+			int n = SectNo < nbsect ? min((uint32_t)vStrmSize, nbsect - SectNo) : 0;
+
+			vStrmSect = SectNo;
+			vStrmCnt = max(SectReadMulti(SectNo, vpStrmBuff, n), 0);
+			k = 0;
+		}
+
+		if (k < (uint32_t)vStrmCnt)
+		{
+			memcpy(pCache->pSectData, vpStrmBuff + k * sectsz, sectsz);
+
+			return true;
+		}
+	}
+
+	return SectRead(SectNo, pCache->pSectData);
+}
+
+bool DiskIO::WriteBack(int Idx)
+{
+	uint32_t sectsz = GetSectSize();
+
+	DISKIO_CACHE_DESC *p = &vpCacheSect[Idx];
+
+	if (vpStrmBuff == NULL || vStrmSize < 2)
+	{
+		if (SectWrite(p->SectNo, p->pSectData) == false)
+		{
+			return false;
+		}
+
+		p->Flags &= ~DISKIO_CACHE_FLAG_DIRTY;
+		StreamInvalidate(p->SectNo, 1);
+
+		return true;
+	}
+
+	// Gather dirty cache sectors contiguous on disk
+	uint32_t first = p->SectNo;
+	int n = 1;
+	int i;
+
+	while (n < vStrmSize && first > 0)
+	{
+		i = FindCacheSect(first - 1);
+		if (i < 0 || (vpCacheSect[i].Flags & DISKIO_CACHE_FLAG_DIRTY) == 0)
+			break;
+		first--;
+		n++;
+	}
+
+	while (n < vStrmSize)
+	{
+		i = FindCacheSect(first + n);
+		if (i < 0 || (vpCacheSect[i].Flags & DISKIO_CACHE_FLAG_DIRTY) == 0)
+			break;
+		n++;
+	}
+
+	// Stream buffer reused, read ahead data is lost
+	vStrmCnt = 0;
+
+	for (int k = 0; k < n; k++)
+	{
+		i = FindCacheSect(first + k);
+		memcpy(vpStrmBuff + k * sectsz, vpCacheSect[i].pSectData, sectsz);
+	}
+
+	int cnt = SectWriteMulti(first, vpStrmBuff, n);
+
+	for (int k = 0; k < cnt; k++)
+	{
+		i = FindCacheSect(first + k);
+		vpCacheSect[i].Flags &= ~DISKIO_CACHE_FLAG_DIRTY;
+	}
+
+	return (p->Flags & DISKIO_CACHE_FLAG_DIRTY) == 0;
+}
+
+void DiskIO::StreamInvalidate(uint32_t SectNo, int NbSect)
+{
+	if (vStrmCnt > 0 && SectNo < vStrmSect + vStrmCnt && SectNo + NbSect > vStrmSect)
+	{
+		vStrmCnt = 0;
+	}
+}
+
+bool DiskIO::PinCacheSect(uint32_t SectNo, bool bPin)
+{
+	if (bPin == false)
+	{
+		int idx = FindCacheSect(SectNo);
+
+		if (idx >= 0)
+		{
+			vpCacheSect[idx].Flags &= ~DISKIO_CACHE_FLAG_PINNED;
+		}
+
+		return true;
+	}
+
+	int idx = GetCacheSect(SectNo);
+
+	if (idx < 0)
+	{
+		return false;
+	}
+
+	// Keep at least one sector of the set for replacement
+	int first = (SectNo % vNbSets) * vNbWays;
+	int end = min(first + vNbWays, vNbCache);
+	int cnt = 1;
+
+	for (int i = first; i < end; i++)
+	{
+		if (i != idx && (vpCacheSect[i].Flags & DISKIO_CACHE_FLAG_PINNED))
+		{
+			cnt++;
+		}
+	}
+
+	bool res = cnt < end - first;
+
+	if (res)
+	{
+		vpCacheSect[idx].Flags |= DISKIO_CACHE_FLAG_PINNED;
+	}
+
+	vpCacheSect[idx].UseCnt--;
+
+	return res;
+}
+
+int DiskIO::SectReadMulti(uint32_t SectNo, uint8_t *pBuff, int NbSect)
+{
+	uint32_t sectsz = GetSectSize();
+
+	int cnt = 0;
+
+	while (cnt < NbSect)
+	{
+		if (SectRead(SectNo + cnt, pBuff) == false)
+			break;
+		pBuff += sectsz;
+		cnt++;
+	}
+
+	return cnt;
+}
+
+int DiskIO::SectWriteMulti(uint32_t SectNo, uint8_t *pData, int NbSect)
+{
+	uint32_t sectsz = GetSectSize();
+
+	int cnt = 0;
+
+	while (cnt < NbSect)
+	{
+		if (SectWrite(SectNo + cnt, pData) == false)
+			break;
+		pData += sectsz;
+		cnt++;
+	}
+
+	return cnt;
+}
+
+int DiskIO::ReadDirect(uint32_t SectNo, uint8_t *pBuff, int NbSect)
+{
+	uint32_t sectsz = GetSectSize();
+
+	int cnt = SectReadMulti(SectNo, pBuff, NbSect);
+
+	// Dirty cache sectors are newer than the device
+	for (int i = 0; i < vNbCache; i++)
+	{
+		uint32_t k = vpCacheSect[i].SectNo - SectNo;
+
+		if (k < (uint32_t)cnt && (vpCacheSect[i].Flags & DISKIO_CACHE_FLAG_DIRTY))
+		{
+			memcpy(pBuff + k * sectsz, vpCacheSect[i].pSectData, sectsz);
+		}
+	}
+
+	return cnt;
+}
+
+int DiskIO::WriteDirect(uint32_t SectNo, uint8_t *pData, int NbSect)
+{
+	uint32_t sectsz = GetSectSize();
+
+	int cnt = SectWriteMulti(SectNo, pData, NbSect);
+
+	StreamInvalidate(SectNo, cnt);
+
+	// Update cached copies of written sectors
+	for (int i = 0; i < vNbCache; i++)
+	{
+		uint32_t k = vpCacheSect[i].SectNo - SectNo;
+
+		if (k < (uint32_t)cnt)
+		{
+			memcpy(vpCacheSect[i].pSectData, pData + k * sectsz, sectsz);
+			vpCacheSect[i].Flags &= ~DISKIO_CACHE_FLAG_DIRTY;
+		}
+	}
+
+	return cnt;
 }
 
 int DiskIO::Read(uint32_t SectNo, uint32_t SectOffset, uint8_t *pBuff, uint32_t Len)
@@ -124,15 +435,30 @@ int DiskIO::Read(uint32_t SectNo, uint32_t SectOffset, uint8_t *pBuff, uint32_t
 	if (pBuff == NULL)
 		return -1;
 
-	int l = min(Len, DISKIO_SECT_SIZE - SectOffset);
+	uint32_t sectsz = GetSectSize();
+	int l = min(Len, sectsz - SectOffset);
 
 	int idx = GetCacheSect(SectNo);
 	if (idx < 0)
 	{
 	    // No cache, do physical read
-	    uint8_t d[DISKIO_SECT_SIZE];
-	    SectRead(SectNo, d);
-	    memcpy(pBuff, d + SectOffset, l);
+	    if (l == (int)sectsz)
+	    {
+	    	// Whole sector, read directly to caller buffer
+	    	if (SectRead(SectNo, pBuff) == false)
+	    		return -1;
+	    }
+	    else if (sectsz <= DISKIO_SECT_SIZE)
+	    {
+	    	uint8_t d[DISKIO_SECT_SIZE];
+	    	SectRead(SectNo, d);
+	    	memcpy(pBuff, d + SectOffset, l);
+	    }
+	    else
+	    {
+	    	// Sector larger than local buffer, a cache is required
+	    	return -1;
+	    }
 	}
 	else
 	{
@@ -148,25 +474,34 @@ int DiskIO::Read(uint32_t SectNo, uint32_t SectOffset, uint8_t *pBuff, uint32_t
 
 int DiskIO::Read(uint64_t Offset, uint8_t *pBuff, uint32_t Len)
 {
-	uint64_t sectno = Offset / DISKIO_SECT_SIZE;
-	uint32_t sectoff = Offset % DISKIO_SECT_SIZE;
+	uint32_t sectsz = GetSectSize();
+
+	uint64_t sectno = Offset / sectsz;
+	uint32_t sectoff = Offset % sectsz;
 
 	uint32_t retval = 0;
 
 	while (Len > 0)
 	{
-		int l = Read(sectno, sectoff, pBuff, Len);
+		int l;
+
+		if (sectoff == 0 && Len >= DISKIO_CACHE_BYPASS_MIN * sectsz)
+		{
+			// Aligned run of sectors, transfer directly
+			l = ReadDirect(sectno, pBuff, Len / sectsz) * sectsz;
+		}
+		else
+		{
+			l = Read(sectno, sectoff, pBuff, Len);
+		}
 		if (l <= 0)
 			break;
 		pBuff += l;
 		Len -= l;
 		retval += l;
 		sectoff += l;
-		if (sectoff >= DISKIO_SECT_SIZE)
-		{
-			sectno++;
-			sectoff = 0;
-		}
+		sectno += sectoff / sectsz;
+		sectoff %= sectsz;
 	}
 
 	return retval;
@@ -177,16 +512,34 @@ int DiskIO::Write(uint32_t SectNo, uint32_t SectOffset, uint8_t *pData, uint32_t
 	if (pData == NULL)
 		return -1;
 
-	uint32_t l = min(Len, DISKIO_SECT_SIZE - SectOffset);
+	uint32_t sectsz = GetSectSize();
+	uint32_t l = min(Len, sectsz - SectOffset);
 
-	int idx = GetCacheSect(SectNo, true);
+	// Whole sector overwritten, no need to read it first
+	int idx = GetCacheSect(SectNo, true, l < sectsz);
 	if (idx < 0)
 	{
 	    // No cache, do physical write
-	    uint8_t d[DISKIO_SECT_SIZE];
-	    SectRead(SectNo, d);
-	    memcpy(d + SectOffset, pData, l);
-	    SectWrite(SectNo, d);
+	    StreamInvalidate(SectNo, 1);
+
+	    if (l == sectsz)
+	    {
+	    	// Whole sector, no need to read it first
+	    	if (SectWrite(SectNo, pData) == false)
+	    		return -1;
+	    }
+	    else if (sectsz <= DISKIO_SECT_SIZE)
+	    {
+	    	uint8_t d[DISKIO_SECT_SIZE];
+	    	SectRead(SectNo, d);
+	    	memcpy(d + SectOffset, pData, l);
+	    	SectWrite(SectNo, d);
+	    }
+	    else
+	    {
+	    	// Sector larger than local buffer, a cache is required
+	    	return -1;
+	    }
 	}
 	else
 	{
@@ -194,7 +547,7 @@ int DiskIO::Write(uint32_t SectNo, uint32_t SectOffset, uint8_t *pData, uint32_t
         memcpy(vpCacheSect[idx].pSectData + SectOffset, pData, l);
 
         // Done with cache sector, release it
-        vpCacheSect[idx].UseCnt |= DISKIO_CACHE_DIRTY_BIT;
+        vpCacheSect[idx].Flags |= DISKIO_CACHE_FLAG_DIRTY;
         vpCacheSect[idx].UseCnt--;
 	}
 
@@ -203,25 +556,34 @@ int DiskIO::Write(uint32_t SectNo, uint32_t SectOffset, uint8_t *pData, uint32_t
 
 int DiskIO::Write(uint64_t Offset, uint8_t *pData, uint32_t Len)
 {
-	uint64_t sectno = Offset / DISKIO_SECT_SIZE;
-	uint32_t sectoff = Offset % DISKIO_SECT_SIZE;
+	uint32_t sectsz = GetSectSize();
+
+	uint64_t sectno = Offset / sectsz;
+	uint32_t sectoff = Offset % sectsz;
 
 	uint32_t retval = 0;
 
 	while (Len > 0)
 	{
-		int l = Write(sectno, sectoff, pData, Len);
-		if (l < 0)
+		int l;
+
+		if (sectoff == 0 && Len >= DISKIO_CACHE_BYPASS_MIN * sectsz)
+		{
+			// Aligned run of sectors, transfer directly
+			l = WriteDirect(sectno, pData, Len / sectsz) * sectsz;
+		}
+		else
+		{
+			l = Write(sectno, sectoff, pData, Len);
+		}
+		if (l <= 0)
 			break;
 		pData += l;
 		Len -= l;
 		retval += l;
 		sectoff += l;
-		if (sectoff >= DISKIO_SECT_SIZE)
-		{
-			sectno++;
-			sectoff = 0;
-		}
+		sectno += sectoff / sectsz;
+		sectoff %= sectsz;
 	}
 
 	return retval;
@@ -229,12 +591,33 @@ int DiskIO::Write(uint64_t Offset, uint8_t *pData, uint32_t Len)
 
 void DiskIO::Flush()
 {
-    for (int i = 0; i < vNbCache; i++)
-    {
-        if (vpCacheSect[i].UseCnt & DISKIO_CACHE_DIRTY_BIT)
-        {
-            SectWrite(vpCacheSect[i].SectNo, vpCacheSect[i].pSectData);
-            vpCacheSect[i].UseCnt &= ~DISKIO_CACHE_DIRTY_BIT;
-        }
-    }
+	uint32_t last = 0;
+	bool bFirst = true;
+
+	// Write back in increasing sector order
+	while (true)
+	{
+		int idx = -1;
+
+		for (int i = 0; i < vNbCache; i++)
+		{
+			if ((vpCacheSect[i].Flags & DISKIO_CACHE_FLAG_DIRTY) &&
+				(bFirst || vpCacheSect[i].SectNo > last) &&
+				(idx < 0 || vpCacheSect[i].SectNo < vpCacheSect[idx].SectNo))
+			{
+				idx = i;
+			}
+		}
+
+		if (idx < 0)
+		{
+			break;
+		}
+
+		last = vpCacheSect[idx].SectNo;
+		bFirst = false;
+
+		// Sector stays dirty on failure
+		WriteBack(idx);
+	}
 }
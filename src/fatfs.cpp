@@ -34,8 +34,10 @@ Modified by          Date              Description
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/unistd.h>
@@ -46,13 +48,16 @@ Modified by          Date              Description
 #include <memory>
 #include <wchar.h>
 
+#include "istddef.h"
 #include "stddev.h"
 #include "sdcard.h"
 #include "fatfs.h"
 
 
-//#define FATFS_FDBASE_ID		0x5A00L
-#define FATFS_FDIDX_MASK	0xFFL
+#define FATFS_LFN_CHARS		13		// Characters per long name entry
+#define FATFS_NTRES_LOWBASE	0x08	// NTRes : short name base in lower case
+#define FATFS_NTRES_LOWEXT	0x10	// NTRes : short name extension in lower case
+#define FATFS_SNAME_TAIL_MAX	999		// Max numeric tail after the hash in short names
 
 FatFS g_FatFS;
 
@@ -66,522 +71,2347 @@ const STDDEV g_FatFSBlkDev = {
 	FATFSSeek
 };
 
+static bool s_bFatFSBlkDevInstalled = false;
 
-bool FatFS::Init(DiskIO *pDiskIO)
+// Byte offsets of the 13 characters of a long name entry
+static const uint8_t s_LfnOff[FATFS_LFN_CHARS] = {
+	1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30
+};
+
+FatFS::FatFS()
+{
+	vDiskIO = NULL;
+	vTimeCB = NULL;
+	vpFreeMap = NULL;
+	vpDirCache = vDirCacheDef;
+	vDirCacheSize = FATFS_DIRCACHE_SIZE;
+	memset(vDirCacheDef, 0, sizeof(vDirCacheDef));
+	vFreeCnt = FATFS_FSINFO_UNKNOWN;
+	vpFdTbl = vFdDef;
+	vFdTblSize = MAX_FILE;
+	vFreeFd = -1;
+	memset(vFdDef, 0, sizeof(vFdDef));
+}
+
+static bool IsBootSect(FATFS_BSBPB *pBs)
+{
+	if ((pBs->JmpBoot[0] != 0xEB || pBs->JmpBoot[2] != 0x90) && pBs->JmpBoot[0] != 0xE9)
+		return false;
+
+	if ((pBs->BytsPerSec != 512 && pBs->BytsPerSec != 1024 && pBs->BytsPerSec != 2048 &&
+		 pBs->BytsPerSec != 4096) || pBs->SecPerClus == 0 || (pBs->SecPerClus & (pBs->SecPerClus - 1)))
+		return false;
+
+	return pBs->NumFATs > 0 && pBs->RsvdSecCnt > 0;
+}
+
+bool FatFS::Init(DiskIO *pDiskIO, uint32_t * const pFreeMap, int FreeMapSize,
+				 FATFS_DIRCACHE * const pDirCache, int DirCacheSize)
+{
+	FATFS_CFG cfg;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.pFreeMap = pFreeMap;
+	cfg.FreeMapSize = FreeMapSize;
+	cfg.pDirCache = pDirCache;
+	cfg.DirCacheSize = DirCacheSize;
+
+	return Init(pDiskIO, cfg);
+}
+
+bool FatFS::Init(DiskIO *pDiskIO, const FATFS_CFG &Cfg)
 {
 	if (pDiskIO == NULL)
 		return false;
 
-	uint8_t sect[512];
+	uint8_t sect[512];
+	int freemapsize = Cfg.FreeMapSize;
+
+	//vDiskIO = std::shared_ptr<DiskIO>(pDiskIO);
+	vDiskIO = pDiskIO;
+	vPartStartSect = 0;
+
+	if (vDiskIO->Read((uint64_t)0, sect, 512) != 512)
+		return false;
+
+	FATFS_BSBPB *fatbs = (FATFS_BSBPB*)sect;
+
+	if (IsBootSect(fatbs) == false)
+	{
+		// Partitioned disk, use first partition
+		MBR *pmbr = (MBR*)sect;
+
+		memcpy(&vPartData, &pmbr->Part[0], sizeof(DISKPART));
+		uint64_t off = (uint64_t)vPartData.LBAStart * vDiskIO->GetSectSize();
+
+		if (pmbr->Sig != 0xAA55 || off == 0 || vDiskIO->Read(off, sect, 512) != 512 ||
+			IsBootSect(fatbs) == false)
+			return false;
+
+		vPartStartSect = off / fatbs->BytsPerSec;
+	}
+
+	vSectSize = fatbs->BytsPerSec;
+	vClusterSize = fatbs->SecPerClus;
+	vClusBytes = vSectSize * vClusterSize;
+	vFATStartSect = vPartStartSect + fatbs->RsvdSecCnt;
+	vFatSize = fatbs->FATSz16 != 0 ? fatbs->FATSz16 : fatbs->BPB.Bpb32.FATSz32;
+	vTotalSect = fatbs->TotSec16 != 0 ? fatbs->TotSec16 : fatbs->TotSec32;
+	vRootEntCnt = fatbs->RootEntCnt;
+	vRootDirSect = vFATStartSect + fatbs->NumFATs * vFatSize;
+	vDataStartSect = vRootDirSect + (vRootEntCnt * sizeof(FATFS_DIR) + vSectSize - 1) / vSectSize;
+	vNbFat = fatbs->NumFATs;
+	vActFat = -1;
+
+	if (vTotalSect + vPartStartSect <= vDataStartSect)
+		return false;
+
+	// FAT type is determined by the cluster count only
+	vNbClus = (vTotalSect + vPartStartSect - vDataStartSect) / vClusterSize;
+	vFSInfoSect = 0;
+
+	if (vNbClus < 4085)
+	{
+		// FAT12 not supported
+		return false;
+	}
+	else if (vNbClus < 65525)
+	{
+		vType = FATFS_TYPE_FAT16;
+		vRootClus = 0;
+		vEoc = FATFS_FAT16_EOC;
+	}
+	else
+	{
+		vType = FATFS_TYPE_FAT32;
+		vRootClus = fatbs->BPB.Bpb32.RootClus;
+		vEoc = FATFS_FAT32_EOC;
+		if (fatbs->BPB.Bpb32.FSInfo != 0)
+			vFSInfoSect = vPartStartSect + fatbs->BPB.Bpb32.FSInfo;
+		if (fatbs->BPB.Bpb32.ExtFlags & 0x80)
+		{
+			// Mirroring disabled, only the active FAT is used
+			vActFat = fatbs->BPB.Bpb32.ExtFlags & 0xF;
+		}
+	}
+
+	if ((uint64_t)vFatSize * vSectSize < (uint64_t)(vNbClus + 2) * (vType == FATFS_TYPE_FAT32 ? 4 : 2))
+		return false;
+
+	// Free cluster map, one bit per group of 2^vFreeGrpShift clusters
+	if (Cfg.pFreeMap != NULL && freemapsize > 0)
+	{
+		vpFreeMap = Cfg.pFreeMap;
+	}
+	else
+	{
+		vpFreeMap = vFreeMapDef;
+		freemapsize = FATFS_FREEMAP_SIZE;
+	}
+
+	vFreeGrpShift = 0;
+	while (((vNbClus + 2 + (1UL << vFreeGrpShift) - 1) >> vFreeGrpShift) > (uint32_t)freemapsize * 32)
+		vFreeGrpShift++;
+	vFreeMapBits = (vNbClus + 2 + (1UL << vFreeGrpShift) - 1) >> vFreeGrpShift;
+
+	if (Cfg.pDirCache != NULL && Cfg.DirCacheSize > 0)
+	{
+		vpDirCache = Cfg.pDirCache;
+		vDirCacheSize = Cfg.DirCacheSize;
+	}
+	else
+	{
+		vpDirCache = vDirCacheDef;
+		vDirCacheSize = FATFS_DIRCACHE_SIZE;
+	}
+	memset(vpDirCache, 0, vDirCacheSize * sizeof(FATFS_DIRCACHE));
+
+	if (Cfg.pFdTbl != NULL && Cfg.FdTblSize > 0)
+	{
+		vpFdTbl = Cfg.pFdTbl;
+		vFdTblSize = min(Cfg.FdTblSize, FATFS_FD_MAX);
+	}
+	else
+	{
+		vpFdTbl = vFdDef;
+		vFdTblSize = MAX_FILE;
+	}
+
+	// All handles free, each one with an equal share of the sector buffers
+	uint32_t nbuff = 0;
+
+	if (Cfg.pFdBuff != NULL && (uint32_t)vDiskIO->GetSectSize() == vSectSize)
+		nbuff = Cfg.FdBuffSize / vFdTblSize / vSectSize;
+
+	memset(vpFdTbl, 0, vFdTblSize * sizeof(FATFS_FD));
+	for (int i = 0; i < vFdTblSize; i++)
+	{
+		vpFdTbl[i].NextFree = i + 1 < vFdTblSize ? i + 1 : -1;
+		if (nbuff > 0)
+		{
+			vpFdTbl[i].pBuff = Cfg.pFdBuff + i * nbuff * vSectSize;
+			vpFdTbl[i].BuffSize = nbuff;
+		}
+	}
+	vFreeFd = 0;
+
+	vFreeCnt = FATFS_FSINFO_UNKNOWN;
+	vNextFree = 2;
+	vbInfoDirty = false;
+
+	if (vFSInfoSect != 0)
+	{
+		FATFS_FSINFO *fsi = (FATFS_FSINFO*)sect;
+
+		if (vDiskIO->Read((uint64_t)vFSInfoSect * vSectSize, sect, 512) == 512 &&
+			fsi->LeadSig == FATFS_FSINFO_LEADSIG && fsi->StrucSig == FATFS_FSINFO_STRUCSIG)
+		{
+			if (fsi->Free_Count <= vNbClus)
+				vFreeCnt = fsi->Free_Count;
+			if (fsi->Nxt_Free >= 2 && fsi->Nxt_Free < vNbClus + 2)
+				vNextFree = fsi->Nxt_Free;
+		}
+	}
+
+	if (vFreeCnt == FATFS_FSINFO_UNKNOWN)
+	{
+		// Count free clusters, map becomes exact
+		ScanFat();
+	}
+	else
+	{
+		// All groups may have free clusters until scanned
+		memset(vpFreeMap, 0, ((vFreeMapBits + 31) >> 5) * sizeof(uint32_t));
+		for (uint32_t i = 0; i < vFreeMapBits; i++)
+			vpFreeMap[i >> 5] |= 1UL << (i & 31);
+	}
+
+	// Keep first FAT and root directory sectors cached, ignored if cache too small
+	vDiskIO->PinCacheSect(vFATStartSect, true);
+	vDiskIO->PinCacheSect(vRootClus != 0 ? ClusToSect(vRootClus) : vRootDirSect, true);
+
+	// stdio file system is the global instance, installed on its first Init
+	if (this == &g_FatFS && s_bFatFSBlkDevInstalled == false)
+		s_bFatFSBlkDevInstalled = InstallBlkDev((STDDEV*)&g_FatFSBlkDev, STDFS_FILENO) >= 0;
+
+	return true;
+}
+
+uint32_t FatFS::ReadFat(uint32_t ClusNo)
+{
+	uint64_t off = (uint64_t)(vFATStartSect + (vActFat < 0 ? 0 : vActFat) * vFatSize) * vSectSize;
+
+	if (vType == FATFS_TYPE_FAT32)
+	{
+		uint32_t d = 0;
+
+		vDiskIO->Read(off + ClusNo * 4, (uint8_t*)&d, 4);
+
+		return d & FATFS_FAT32_ENTRY_MASK;
+	}
+
+	uint16_t d = 0;
+
+	vDiskIO->Read(off + ClusNo * 2, (uint8_t*)&d, 2);
+
+	return d;
+}
+
+/**
+ * Write FAT entry in all FAT copies.  Reserved bits of FAT32 entries are
+ * preserved.
+ */
+bool FatFS::WriteFat(uint32_t ClusNo, uint32_t Val)
+{
+	int esize = vType == FATFS_TYPE_FAT32 ? 4 : 2;
+	uint32_t d = Val;
+
+	if (vType == FATFS_TYPE_FAT32)
+	{
+		uint64_t off = (uint64_t)(vFATStartSect + (vActFat < 0 ? 0 : vActFat) * vFatSize) * vSectSize;
+		uint32_t old = 0;
+
+		vDiskIO->Read(off + ClusNo * 4, (uint8_t*)&old, 4);
+		d = (old & ~FATFS_FAT32_ENTRY_MASK) | (Val & FATFS_FAT32_ENTRY_MASK);
+	}
+
+	for (int i = 0; i < vNbFat; i++)
+	{
+		if (vActFat >= 0 && i != vActFat)
+			continue;
+
+		uint64_t off = (uint64_t)(vFATStartSect + i * vFatSize) * vSectSize + ClusNo * esize;
+
+		if (vDiskIO->Write(off, (uint8_t*)&d, esize) != esize)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Count free clusters and set map bits of groups having some
+ */
+void FatFS::ScanFat()
+{
+	uint32_t d[64];
+	int esize = vType == FATFS_TYPE_FAT32 ? 4 : 2;
+	int nbent = sizeof(d) / esize;
+	uint64_t off = (uint64_t)(vFATStartSect + (vActFat < 0 ? 0 : vActFat) * vFatSize) * vSectSize;
+
+	memset(vpFreeMap, 0, ((vFreeMapBits + 31) >> 5) * sizeof(uint32_t));
+	vFreeCnt = 0;
+
+	for (uint32_t c = 0; c < vNbClus + 2; c += nbent)
+	{
+		int n = min(nbent, vNbClus + 2 - c);
+
+		if (vDiskIO->Read(off + c * esize, (uint8_t*)d, n * esize) != n * esize)
+		{
+			vFreeCnt = FATFS_FSINFO_UNKNOWN;
+			return;
+		}
+
+		for (int i = 0; i < n; i++)
+		{
+			uint32_t v = esize == 4 ? d[i] & FATFS_FAT32_ENTRY_MASK : ((uint16_t*)d)[i];
+
+			if (v == FATFS_FATENTRY_FREE && c + i >= 2)
+			{
+				uint32_t g = (c + i) >> vFreeGrpShift;
+
+				vpFreeMap[g >> 5] |= 1UL << (g & 31);
+				vFreeCnt++;
+			}
+		}
+	}
+}
+
+/**
+ * Look for a free cluster in a group, from Start if in the group
+ *
+ * @return	Cluster number, 0 if none
+ */
+uint32_t FatFS::ScanFreeGroup(uint32_t Grp, uint32_t Start)
+{
+	uint32_t d[64];
+	int esize = vType == FATFS_TYPE_FAT32 ? 4 : 2;
+	int nbent = sizeof(d) / esize;
+	uint64_t off = (uint64_t)(vFATStartSect + (vActFat < 0 ? 0 : vActFat) * vFatSize) * vSectSize;
+	uint32_t c = max(Grp << vFreeGrpShift, 2);
+	uint32_t end = min((Grp + 1) << vFreeGrpShift, vNbClus + 2);
+
+	if (Start > c)
+		c = Start;
+
+	while (c < end)
+	{
+		int n = min(nbent, end - c);
+
+		if (vDiskIO->Read(off + c * esize, (uint8_t*)d, n * esize) != n * esize)
+			return 0;
+
+		for (int i = 0; i < n; i++)
+		{
+			uint32_t v = esize == 4 ? d[i] & FATFS_FAT32_ENTRY_MASK : ((uint16_t*)d)[i];
+
+			if (v == FATFS_FATENTRY_FREE)
+				return c + i;
+		}
+		c += n;
+	}
+
+	return 0;
+}
+
+/**
+ * Groups with clear bit are skipped 32 at a time.  A group fully scanned
+ * without free cluster gets its bit cleared.
+ */
+uint32_t FatFS::FindFreeCluster(uint32_t Start)
+{
+	if (vFreeCnt == 0)
+		return 0;
+
+	if (Start < 2 || Start >= vNbClus + 2)
+		Start = 2;
+
+	uint32_t g = Start >> vFreeGrpShift;
+
+	for (uint32_t n = 0; n <= vFreeMapBits + 32; n++, g++)
+	{
+		if (g >= vFreeMapBits)
+			g = 0;
+
+		uint32_t w = vpFreeMap[g >> 5];
+
+		if (w == 0)
+		{
+			// Skip whole word
+			n += 31 - (g & 31);
+			g |= 31;
+			continue;
+		}
+		if ((w & (1UL << (g & 31))) == 0)
+			continue;
+
+		bool partial = n == 0 && Start > (g << vFreeGrpShift) && Start > 2;
+		uint32_t c = ScanFreeGroup(g, n == 0 ? Start : 0);
+
+		if (c != 0)
+			return c;
+
+		if (partial == false)
+			vpFreeMap[g >> 5] &= ~(1UL << (g & 31));
+	}
+
+	return 0;
+}
+
+/**
+ * Count free clusters following each other from ClusNo, up to Max
+ */
+uint32_t FatFS::FreeRun(uint32_t ClusNo, uint32_t Max)
+{
+	uint32_t d[64];
+	int esize = vType == FATFS_TYPE_FAT32 ? 4 : 2;
+	int nbent = sizeof(d) / esize;
+	uint64_t off = (uint64_t)(vFATStartSect + (vActFat < 0 ? 0 : vActFat) * vFatSize) * vSectSize;
+	uint32_t n = 0;
+
+	if (ClusNo < 2)
+		return 0;
+
+	while (n < Max && ClusNo + n < vNbClus + 2)
+	{
+		uint32_t c = ClusNo + n;
+		int cnt = min(nbent, vNbClus + 2 - c);
+
+		if (vDiskIO->Read(off + c * esize, (uint8_t*)d, cnt * esize) != cnt * esize)
+			break;
+
+		for (int i = 0; i < cnt && n < Max; i++, n++)
+		{
+			uint32_t v = esize == 4 ? d[i] & FATFS_FAT32_ENTRY_MASK : ((uint16_t*)d)[i];
+
+			if (v != FATFS_FATENTRY_FREE)
+				return n;
+		}
+	}
+
+	return n;
+}
+
+/**
+ * Free clusters are located with the free cluster map, runs shorter than
+ * NbClus are skipped.  The whole volume is searched once, wrapping around.
+ */
+uint32_t FatFS::FindFreeRun(uint32_t Start, uint32_t NbClus)
+{
+	if (NbClus == 0 || NbClus > vNbClus || (vFreeCnt != FATFS_FSINFO_UNKNOWN && vFreeCnt < NbClus))
+		return 0;
+
+	if (Start < 2 || Start >= vNbClus + 2)
+		Start = 2;
+
+	uint32_t pos = Start;
+	uint32_t done = 0;		// Clusters looked at
+
+	while (done < vNbClus)
+	{
+		uint32_t c = FindFreeCluster(pos);
+
+		if (c == 0)
+			break;
+
+		done += c >= pos ? c - pos : c + vNbClus - pos;
+		if (done >= vNbClus)
+			break;
+
+		uint32_t n = FreeRun(c, NbClus);
+
+		if (n >= NbClus)
+			return c;
+
+		// Run too short, continue past the cluster in use ending it
+		done += n + 1;
+		pos = c + n + 1;
+		if (pos >= vNbClus + 2)
+			pos = 2;
+	}
+
+	return 0;
+}
+
+/**
+ * Chain NbClus consecutive clusters from ClusNo, last one marked end of chain.
+ * FAT entries are written by chunks in all FAT copies.
+ */
+bool FatFS::LinkRun(uint32_t ClusNo, uint32_t NbClus)
+{
+	uint32_t d[64];
+	int esize = vType == FATFS_TYPE_FAT32 ? 4 : 2;
+	int nbent = sizeof(d) / esize;
+	uint32_t end = ClusNo + NbClus;
+
+	for (uint32_t c = ClusNo; c < end; c += nbent)
+	{
+		int cnt = min(nbent, end - c);
+
+		for (int i = 0; i < vNbFat; i++)
+		{
+			if (vActFat >= 0 && i != vActFat)
+				continue;
+
+			uint64_t off = (uint64_t)(vFATStartSect + i * vFatSize) * vSectSize + c * esize;
+
+			if (esize == 4)
+			{
+				// Reserved bits preserved
+				if (vDiskIO->Read(off, (uint8_t*)d, cnt * 4) != cnt * 4)
+					return false;
+
+				for (int k = 0; k < cnt; k++)
+				{
+					uint32_t v = c + k + 1 < end ? c + k + 1 : FATFS_FAT32_ENTRY_MASK;
+
+					d[k] = (d[k] & ~FATFS_FAT32_ENTRY_MASK) | v;
+				}
+			}
+			else
+			{
+				for (int k = 0; k < cnt; k++)
+				{
+					((uint16_t*)d)[k] = c + k + 1 < end ? c + k + 1 : 0xFFFF;
+				}
+			}
+
+			if (vDiskIO->Write(off, (uint8_t*)d, cnt * esize) != cnt * esize)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+uint32_t FatFS::AllocCluster(uint32_t Prev)
+{
+	uint32_t c = FindFreeCluster(Prev >= 2 ? Prev + 1 : vNextFree);
+
+	if (c == 0)
+	{
+		vFreeCnt = 0;
+		return 0;
+	}
+
+	// End of chain written first, then linked
+	if (WriteFat(c, FATFS_FAT32_ENTRY_MASK) == false)
+		return 0;
+
+	if (Prev >= 2 && WriteFat(Prev, c) == false)
+		return 0;
+
+	if (vFreeCnt != FATFS_FSINFO_UNKNOWN)
+		vFreeCnt--;
+
+	vNextFree = c + 1 < vNbClus + 2 ? c + 1 : 2;
+	vbInfoDirty = true;
+
+	return c;
+}
+
+void FatFS::FreeChain(uint32_t ClusNo)
+{
+	for (uint32_t n = 0; ClusNo >= 2 && ClusNo < vNbClus + 2 && n < vNbClus; n++)
+	{
+		uint32_t next = ReadFat(ClusNo);
+
+		if (next == FATFS_FATENTRY_FREE)
+			break;
+
+		WriteFat(ClusNo, FATFS_FATENTRY_FREE);
+
+		uint32_t g = ClusNo >> vFreeGrpShift;
+
+		vpFreeMap[g >> 5] |= 1UL << (g & 31);
+
+		if (vFreeCnt != FATFS_FSINFO_UNKNOWN)
+			vFreeCnt++;
+
+		vbInfoDirty = true;
+
+		if (IsEoc(next))
+			break;
+
+		ClusNo = next;
+	}
+}
+
+bool FatFS::ZeroCluster(uint32_t ClusNo)
+{
+	uint8_t d[512];
+	uint64_t off = (uint64_t)ClusToSect(ClusNo) * vSectSize;
+
+	memset(d, 0, sizeof(d));
+
+	for (uint32_t i = 0; i < vClusBytes; i += sizeof(d))
+	{
+		if (vDiskIO->Write(off + i, d, sizeof(d)) != sizeof(d))
+			return false;
+	}
+
+	return true;
+}
+
+void FatFS::UpdateFSInfo()
+{
+	if (vbInfoDirty == false)
+		return;
+
+	if (vFSInfoSect != 0)
+	{
+		uint32_t d[2] = { vFreeCnt, vNextFree };
+
+		vDiskIO->Write((uint64_t)vFSInfoSect * vSectSize + offsetof(FATFS_FSINFO, Free_Count),
+					   (uint8_t*)d, sizeof(d));
+	}
+
+	vbInfoDirty = false;
+}
+
+uint64_t FatFS::DirOffset(const FATFS_DIRPOS &Pos)
+{
+	uint32_t sectno = Pos.Clus == 0 ? vRootDirSect : ClusToSect(Pos.Clus);
+
+	return (uint64_t)sectno * vSectSize + Pos.Idx * sizeof(FATFS_DIR);
+}
+
+/**
+ * Move to next directory entry, following the directory cluster chain.  With
+ * bExtend a zeroed cluster is added at end of the chain.
+ */
+bool FatFS::DirNext(FATFS_DIRPOS &Pos, bool bExtend)
+{
+	Pos.Idx++;
+
+	if (Pos.Clus == 0)
+		return Pos.Idx < vRootEntCnt;
+
+	if (Pos.Idx < vClusBytes / sizeof(FATFS_DIR))
+		return true;
+
+	uint32_t next = ReadFat(Pos.Clus);
+
+	if (IsEoc(next))
+	{
+		if (bExtend == false)
+			return false;
+
+		next = AllocCluster(Pos.Clus);
+		if (next == 0 || ZeroCluster(next) == false)
+			return false;
+	}
+	else if (next < 2 || next >= vNbClus + 2)
+	{
+		return false;
+	}
+
+	Pos.Clus = next;
+	Pos.Idx = 0;
+
+	return true;
+}
+
+static uint8_t ShortNameChksum(const uint8_t *pName)
+{
+	uint8_t sum = 0;
+
+	for (int i = 0; i < 11; i++)
+	{
+		sum = ((sum & 1) << 7) + (sum >> 1) + pName[i];
+	}
+
+	return sum;
+}
+
+/**
+ * Extract the 13 characters of a long name entry.  Characters outside of
+ * ASCII are replaced with '_'.
+ *
+ * @return	Number of characters before the name terminator
+ */
+static int ExtractLongName(FATFS_DIR *pDirEnt, char *pBuff)
+{
+	uint8_t *p = (uint8_t*)pDirEnt;
+
+	for (int i = 0; i < FATFS_LFN_CHARS; i++)
+	{
+		uint16_t c = p[s_LfnOff[i]] | (p[s_LfnOff[i] + 1] << 8);
+
+		if (c == 0)
+		{
+			pBuff[i] = 0;
+			return i;
+		}
+		pBuff[i] = c < 0x80 ? c : '_';
+	}
+
+	return FATFS_LFN_CHARS;
+}
+
+static void FormatShortName(FATFS_SHORTNAME *pEnt, char *pName)
+{
+	char *p = pName;
+
+	for (int i = 0; i < 8 && pEnt->Name[i] != ' '; i++)
+	{
+		*p++ = (pEnt->NTRes & FATFS_NTRES_LOWBASE) ? tolower(pEnt->Name[i]) : pEnt->Name[i];
+	}
+	if (pEnt->Name[8] != ' ')
+	{
+		*p++ = '.';
+		for (int i = 8; i < 11 && pEnt->Name[i] != ' '; i++)
+		{
+			*p++ = (pEnt->NTRes & FATFS_NTRES_LOWEXT) ? tolower(pEnt->Name[i]) : pEnt->Name[i];
+		}
+	}
+	*p = 0;
+
+	// 0x05 stands for 0xE5 as first character
+	if ((uint8_t)pName[0] == 0x05)
+		pName[0] = 0xE5;
+}
+
+static bool IsShortChar(char c)
+{
+	return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || strchr("$%'-_@~`!(){}^#&", c) != NULL;
+}
+
+/**
+ * Build short name.  Names valid as 8.3 in one case per part are stored as
+ * short name only, case kept in NTRes.  Other names get a basis name to be
+ * completed by a numeric tail.
+ *
+ * @return	true - Name fits in short name
+ */
+static bool MakeShortName(const char *pName, int Len, uint8_t *pShort, uint8_t &NTRes)
+{
+	const char *dot = NULL;
+	bool fits = true;
+	int lower[2] = { 0, 0 }, upper[2] = { 0, 0 };
+
+	memset(pShort, ' ', 11);
+	NTRes = 0;
+
+	for (int i = Len - 1; i > 0; i--)
+	{
+		if (pName[i] == '.')
+		{
+			dot = &pName[i];
+			break;
+		}
+	}
+
+	int baselen = dot ? dot - pName : Len;
+	int extlen = dot ? Len - baselen - 1 : 0;
+
+	if (baselen < 1 || baselen > 8 || extlen > 3 || (dot && extlen == 0))
+		fits = false;
+
+	// Basis : upper case, invalid characters replaced, spaces and dots removed
+	for (int i = 0, n = 0, part = 0; i < Len; i++)
+	{
+		const char *p = &pName[i];
+		char c = *p;
+
+		if (p == dot)
+		{
+			part = 1;
+			n = 8;
+			continue;
+		}
+		if (c == ' ' || c == '.')
+		{
+			fits = false;
+			continue;
+		}
+		if (islower((uint8_t)c))
+			lower[part]++;
+		else if (isupper((uint8_t)c))
+			upper[part]++;
+
+		c = toupper((uint8_t)c);
+		if (IsShortChar(c) == false)
+		{
+			c = '_';
+			fits = false;
+		}
+		if ((part == 0 && n < 8) || (part == 1 && n < 11))
+			pShort[n++] = c;
+	}
+
+	if (pShort[0] == ' ')
+		pShort[0] = '_';
+	if (pShort[0] == 0xE5)
+		pShort[0] = 0x05;
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (lower[i] > 0 && upper[i] > 0)
+			fits = false;
+	}
+	if (lower[0] > 0)
+		NTRes |= FATFS_NTRES_LOWBASE;
+	if (lower[1] > 0)
+		NTRes |= FATFS_NTRES_LOWEXT;
+
+	return fits;
+}
+
+/**
+ * Replace end of short name basis with numeric tail ~N.  From the 5th try, 4
+ * hex digits from a hash of the long name are inserted to limit the number of
+ * tries in large directories.
+ */
+static void SetShortNameTail(uint8_t *pShort, const uint8_t *pBasis, int N, uint32_t Hash)
+{
+	char tail[12];
+	int baselen = 8;
+
+	memcpy(pShort, pBasis, 11);
+
+	while (baselen > 0 && pBasis[baselen - 1] == ' ')
+		baselen--;
+
+	if (N <= 4)
+	{
+		tail[0] = '~';
+		tail[1] = '0' + N;
+		tail[2] = 0;
+	}
+	else
+	{
+		snprintf(tail, sizeof(tail), "%04X~%d", (unsigned)(Hash & 0xFFFF), N - 4);
+		baselen = min(baselen, 2);
+	}
+
+	int l = strlen(tail);
+	int pos = min(baselen, 8 - l);
+
+	memcpy(pShort + pos, tail, l);
+	for (int i = pos + l; i < 8; i++)
+		pShort[i] = ' ';
+}
+
+/**
+ * Get directory entry at Pos.  Entries are read FATFS_DIRBUF_CNT at a time
+ * into Buf, refilled when Pos is outside of it.
+ *
+ * @return	Pointer to entry in Buf, NULL on read error
+ */
+FATFS_DIR *FatFS::DirGet(const FATFS_DIRPOS &Pos, FATFS_DIRBUF &Buf)
+{
+	if (Buf.Cnt > 0 && Pos.Clus == Buf.Start.Clus && Pos.Idx >= Buf.Start.Idx &&
+		Pos.Idx < Buf.Start.Idx + Buf.Cnt)
+	{
+		return &Buf.Ent[Pos.Idx - Buf.Start.Idx];
+	}
+
+	uint32_t end = Pos.Clus == 0 ? vRootEntCnt : vClusBytes / sizeof(FATFS_DIR);
+
+	Buf.Start.Clus = Pos.Clus;
+	Buf.Start.Idx = Pos.Idx & ~(FATFS_DIRBUF_CNT - 1);
+	Buf.Cnt = min(FATFS_DIRBUF_CNT, end - Buf.Start.Idx);
+
+	int l = Buf.Cnt * sizeof(FATFS_DIR);
+
+	if (vDiskIO->Read(DirOffset(Buf.Start), (uint8_t*)Buf.Ent, l) != l)
+	{
+		Buf.Cnt = 0;
+		return NULL;
+	}
+
+	return &Buf.Ent[Pos.Idx - Buf.Start.Idx];
+}
+
+// FNV-1a of name folded to lower case, names compare case insensitive
+static uint32_t NameHash(const char *pName, int Len)
+{
+	uint32_t h = 2166136261UL;
+
+	for (int i = 0; i < Len; i++)
+	{
+		h = (h ^ (uint8_t)tolower((uint8_t)pName[i])) * 16777619UL;
+	}
+
+	return h;
+}
+
+/**
+ * Cache set for a name in directory DirClus, most recently used entry first
+ */
+FATFS_DIRCACHE *FatFS::DirCacheSet(uint32_t DirClus, uint32_t Hash, int &NbWays)
+{
+	NbWays = min(FATFS_DIRCACHE_WAYS, vDirCacheSize);
+
+	uint32_t nset = vDirCacheSize / NbWays;
+
+	return &vpDirCache[((Hash ^ (DirClus * 0x9E3779B1UL)) % nset) * NbWays];
+}
+
+void FatFS::DirCacheAdd(uint32_t DirClus, const char *pName, int Len, const FATFS_DIRPOS &LfnPos,
+						const FATFS_DIRPOS &Pos)
+{
+	uint32_t hash = NameHash(pName, Len);
+	int nways;
+	FATFS_DIRCACHE *set = DirCacheSet(DirClus, hash, nways);
+	int i = 0;
+
+	// Replace same name if there, else least recently used
+	while (i < nways - 1 && (set[i].NbEnt == 0 || set[i].DirClus != DirClus || set[i].Hash != hash))
+		i++;
+
+	memmove(&set[1], &set[0], i * sizeof(FATFS_DIRCACHE));
+
+	set[0].DirClus = DirClus;
+	set[0].Hash = hash;
+	set[0].Pos = LfnPos;
+	if (LfnPos.Clus == Pos.Clus)
+		set[0].NbEnt = Pos.Idx - LfnPos.Idx + 1;
+	else
+		set[0].NbEnt = vClusBytes / sizeof(FATFS_DIR) - LfnPos.Idx + Pos.Idx + 1;
+}
+
+/**
+ * Drop cache entries located at pPos, or all entries of directory DirClus if
+ * pPos is NULL
+ */
+void FatFS::DirCacheRemove(uint32_t DirClus, const FATFS_DIRPOS *pPos)
+{
+	for (int i = 0; i < vDirCacheSize; i++)
+	{
+		FATFS_DIRCACHE *c = &vpDirCache[i];
+
+		if (pPos == NULL ? c->DirClus == DirClus :
+			c->Pos.Clus == pPos->Clus && c->Pos.Idx == pPos->Idx)
+		{
+			c->NbEnt = 0;
+		}
+	}
+}
+
+bool FatFS::ShortNameExists(uint32_t DirClus, const uint8_t *pName)
+{
+	FATFS_DIRPOS pos = { DirClus, 0 };
+	FATFS_DIRBUF buf;
+	FATFS_DIR *d;
+
+	buf.Cnt = 0;
+
+	do {
+		if ((d = DirGet(pos, buf)) == NULL)
+			return true;
+		if (d->ShortName.Name[0] == 0)
+			return false;
+		if (d->ShortName.Name[0] != FATFS_DIRENT_DELETED && d->ShortName.Attr != FATFS_DIRATTR_LONG_NAME &&
+			memcmp(d->ShortName.Name, pName, 11) == 0)
+			return true;
+	} while (DirNext(pos, false));
+
+	return false;
+}
+
+/**
+ * Look up a name in NbEnt directory entries from Start.  Long name entries
+ * preceding a short entry are assembled and checked against its checksum.
+ * The short name is compared as well.
+ */
+bool FatFS::DirScan(uint32_t DirClus, FATFS_DIRPOS Start, uint32_t NbEnt, const char *pName, int Len,
+					DIR *pDir, FATFS_DIRPOS &Pos, FATFS_DIRPOS &LfnPos)
+{
+	char lfn[FATFS_LFN_CHARS * 20 + 1];
+	char sname[14];
+	FATFS_DIRPOS pos = Start;
+	FATFS_DIRPOS lfnpos = pos;
+	FATFS_DIRBUF buf;
+	FATFS_DIR *d;
+	uint32_t n = 0;
+	int lfnord = 0;			// Next long name entry order expected, 0 - none
+	uint8_t chksum = 0;
+	bool lfnok = false;
+
+	buf.Cnt = 0;
+
+	do {
+		if ((d = DirGet(pos, buf)) == NULL)
+			return false;
+
+		if (d->LongName.Ord == 0)
+			return false;
+
+		if (d->LongName.Ord == FATFS_DIRENT_DELETED)
+		{
+			lfnok = false;
+			continue;
+		}
+
+		if ((d->ShortName.Attr & 0x3F) == FATFS_DIRATTR_LONG_NAME)
+		{
+			int ord = d->LongName.Ord & 0x3F;
+
+			if (d->LongName.Ord & FATFS_DIRENT_LASTLONG)
+			{
+				lfnok = ord > 0 && ord <= 20;
+				lfnpos = pos;
+				chksum = d->LongName.Chksum;
+				if (lfnok)
+					lfn[ord * FATFS_LFN_CHARS] = 0;
+			}
+			else if (ord != lfnord || d->LongName.Chksum != chksum)
+			{
+				lfnok = false;
+			}
+			if (lfnok)
+			{
+				ExtractLongName(d, &lfn[(ord - 1) * FATFS_LFN_CHARS]);
+				lfnord = ord - 1;
+			}
+			continue;
+		}
+
+		if (d->ShortName.Attr & FATFS_DIRATTR_VOLUME_ID)
+		{
+			lfnok = false;
+			continue;
+		}
+
+		bool haslfn = lfnok && lfnord == 0 && ShortNameChksum(d->ShortName.Name) == chksum;
+		lfnok = false;
+
+		FormatShortName(&d->ShortName, sname);
+
+		const char *name = NULL;
+
+		if (haslfn && strncasecmp(lfn, pName, Len) == 0 && lfn[Len] == 0)
+			name = lfn;
+		else if (strncasecmp(sname, pName, Len) == 0 && sname[Len] == 0)
+			name = haslfn ? lfn : sname;
+
+		if (name == NULL)
+			continue;
+
+		// Found a matching entry
+		uint64_t off = DirOffset(pos);
+		uint32_t clus = (d->ShortName.FstClusHI << 16L) | d->ShortName.FstClusLO;
+
+		if ((d->ShortName.Attr & FATFS_DIRATTR_DIRECTORY) && clus == 0)
+		{
+			// '..' of a first level directory
+			clus = vRootClus;
+		}
+
+		pDir->DirClus = DirClus;
+		pDir->d_dirent.d_type = (d->ShortName.Attr & FATFS_DIRATTR_DIRECTORY) ? DT_DIR : DT_REG;
+		pDir->d_dirent.d_att = 0;
+		if (d->ShortName.Attr & FATFS_DIRATTR_HIDDEN)
+			pDir->d_dirent.d_att |= DA_HIDDEN;
+		if (d->ShortName.Attr & FATFS_DIRATTR_SYSTEM)
+			pDir->d_dirent.d_att |= DA_SYSTEM;
+		if (d->ShortName.Attr & FATFS_DIRATTR_READ_ONLY)
+			pDir->d_dirent.d_att |= DA_READONLY;
+		pDir->d_dirent.FirstClus = clus;
+		pDir->d_dirent.EntrySect = off / vSectSize;
+		pDir->d_dirent.EntryIdx = (off % vSectSize) / sizeof(FATFS_DIR);
+		pDir->d_dirent.d_size = d->ShortName.FileSize;
+		pDir->d_dirent.d_offset = 0;
+		strncpy(pDir->d_dirent.d_name, name, NAME_MAX);
+		pDir->d_dirent.d_name[NAME_MAX] = 0;
+		pDir->d_dirent.d_namelen = strlen(pDir->d_dirent.d_name);
+		pDir->d_dirname = pDir->d_dirent.d_name;
+
+		Pos = pos;
+		LfnPos = haslfn ? lfnpos : pos;
+
+		return true;
+	} while (++n < NbEnt && DirNext(pos, false));
+
+	return false;
+}
+
+/**
+ * Look up a name in a directory, cached location checked first
+ */
+bool FatFS::DirFind(uint32_t DirClus, const char *pName, int Len, DIR *pDir,
+					FATFS_DIRPOS &Pos, FATFS_DIRPOS &LfnPos)
+{
+	uint32_t hash = NameHash(pName, Len);
+	int nways;
+	FATFS_DIRCACHE *set = DirCacheSet(DirClus, hash, nways);
+
+	for (int i = 0; i < nways; i++)
+	{
+		if (set[i].NbEnt > 0 && set[i].DirClus == DirClus && set[i].Hash == hash)
+		{
+			FATFS_DIRCACHE c = set[i];
+
+			// Move to front
+			memmove(&set[1], &set[0], i * sizeof(FATFS_DIRCACHE));
+			set[0] = c;
+
+			if (DirScan(DirClus, c.Pos, c.NbEnt, pName, Len, pDir, Pos, LfnPos))
+				return true;
+
+			// Stale
+			set[0].NbEnt = 0;
+			break;
+		}
+	}
+
+	FATFS_DIRPOS start = { DirClus, 0 };
+
+	if (DirScan(DirClus, start, FATFS_DIRENT_MAX, pName, Len, pDir, Pos, LfnPos) == false)
+		return false;
+
+	DirCacheAdd(DirClus, pName, Len, LfnPos, Pos);
+
+	return true;
+}
+
+/**
+ * Walk path components from root directory.  Path is not modified.
+ */
+bool FatFS::LookUp(const char *pPath, int Len, DIR *pDir, FATFS_DIRPOS *pPos, FATFS_DIRPOS *pLfnPos)
+{
+	const char *end = pPath + Len;
+	FATFS_DIRPOS pos, lfnpos;
+
+	memset(pDir, 0, sizeof(DIR));
+	pDir->d_dirent.d_name[0] = '/';
+	pDir->d_dirent.d_namelen = 1;
+	pDir->d_dirent.d_type = DT_DIR;
+	pDir->d_dirent.FirstClus = vRootClus;
+	pDir->d_dirent.EntrySect = vRootClus != 0 ? ClusToSect(vRootClus) : vRootDirSect;
+	pDir->d_dirname = pDir->d_dirent.d_name;
+	pDir->DirClus = vRootClus;
+
+	while (pPath < end)
+	{
+		while (pPath < end && *pPath == '/')
+			pPath++;
+		if (pPath >= end)
+			break;
+
+		const char *p = pPath;
+
+		while (p < end && *p != '/')
+			p++;
+
+		if (pDir->d_dirent.d_type != DT_DIR ||
+			DirFind(pDir->d_dirent.FirstClus, pPath, p - pPath, pDir, pos, lfnpos) == false)
+			return false;
+
+		if (pPos)
+			*pPos = pos;
+		if (pLfnPos)
+			*pLfnPos = lfnpos;
+
+		pPath = p;
+	}
+
+	return true;
+}
+
+bool FatFS::Find(const char * const pPathName, DIR *pDir)
+{
+	if (vDiskIO == NULL || pPathName == NULL || pDir == NULL)
+		return false;
+
+	return LookUp(pPathName, strlen(pPathName), pDir, NULL, NULL);
+}
+
+bool FatFS::FindFreeDirEntry(uint32_t DirClus, int NbEnt, FATFS_DIRPOS &Pos)
+{
+	FATFS_DIRPOS pos = { DirClus, 0 };
+	FATFS_DIRBUF buf;
+	FATFS_DIR *d;
+	int cnt = 0;
+
+	buf.Cnt = 0;
+
+	for (uint32_t i = 0; i < FATFS_DIRENT_MAX; i++)
+	{
+		if ((d = DirGet(pos, buf)) == NULL)
+			return false;
+
+		if (d->LongName.Ord == 0 || d->LongName.Ord == FATFS_DIRENT_DELETED)
+		{
+			if (cnt == 0)
+				Pos = pos;
+			if (++cnt >= NbEnt)
+				return true;
+		}
+		else
+		{
+			cnt = 0;
+		}
+
+		if (DirNext(pos, true) == false)
+			return false;
+	}
+
+	return false;
+}
+
+bool FatFS::Create(const char * const pPathName, uint8_t Attr, uint32_t FirstClus, DIR *pDir)
+{
+	int len = strlen(pPathName);
+
+	// Remove trailing separators, split parent path and name
+	while (len > 0 && pPathName[len - 1] == '/')
+		len--;
+
+	int nlen = 0;
+
+	while (nlen < len && pPathName[len - nlen - 1] != '/')
+		nlen++;
+
+	const char *name = &pPathName[len - nlen];
+
+	if (nlen == 0 || nlen > FATFS_LFN_MAX || (nlen <= 2 && strncmp(name, "..", nlen) == 0))
+		return false;
+
+	for (int i = 0; i < nlen; i++)
+	{
+		if ((uint8_t)name[i] < 0x20 || strchr("\"*:<>?\\|", name[i]) != NULL)
+			return false;
+	}
+
+	if (LookUp(pPathName, len - nlen, pDir, NULL, NULL) == false || pDir->d_dirent.d_type != DT_DIR)
+		return false;
+
+	uint32_t dirclus = pDir->d_dirent.FirstClus;
+	uint8_t sname[11];
+	uint8_t ntres;
+	int nlfn = 0;
+
+	if (MakeShortName(name, nlen, sname, ntres) == false)
+	{
+		uint8_t basis[11];
+		uint32_t hash = 0;
+
+		memcpy(basis, sname, 11);
+		for (int i = 0; i < nlen; i++)
+			hash = hash * 31 + name[i];
+
+		for (int n = 1; ; n++)
+		{
+			// Hashed tail XXXX~N fills the 8 characters at N = 999
+			if (n > FATFS_SNAME_TAIL_MAX + 4)
+				return false;
+
+			SetShortNameTail(sname, basis, n, hash);
+			if (ShortNameExists(dirclus, sname) == false)
+				break;
+		}
+
+		ntres = 0;
+		nlfn = (nlen + FATFS_LFN_CHARS - 1) / FATFS_LFN_CHARS;
+	}
+	else if (ShortNameExists(dirclus, sname))
+	{
+		return false;
+	}
+
+	FATFS_DIRPOS pos;
+
+	if (FindFreeDirEntry(dirclus, nlfn + 1, pos) == false)
+		return false;
+
+	FATFS_DIRPOS lfnpos = pos;
+	FATFS_DIR d;
+	uint8_t chksum = ShortNameChksum(sname);
+
+	// Long name entries in reverse order, then short entry
+	for (int ord = nlfn; ord > 0; ord--)
+	{
+		uint8_t *p = (uint8_t*)&d;
+		int off = (ord - 1) * FATFS_LFN_CHARS;
+
+		memset(&d, 0, sizeof(d));
+		d.LongName.Ord = ord | (ord == nlfn ? FATFS_DIRENT_LASTLONG : 0);
+		d.LongName.Attr = FATFS_DIRATTR_LONG_NAME;
+		d.LongName.Chksum = chksum;
+		for (int i = 0; i < FATFS_LFN_CHARS; i++)
+		{
+			uint16_t c = off + i < nlen ? (uint8_t)name[off + i] : off + i == nlen ? 0 : 0xFFFF;
+
+			p[s_LfnOff[i]] = c & 0xFF;
+			p[s_LfnOff[i] + 1] = c >> 8;
+		}
+		if (vDiskIO->Write(DirOffset(pos), (uint8_t*)&d, sizeof(d)) != sizeof(d) ||
+			DirNext(pos, false) == false)
+			return false;
+	}
+
+	uint32_t t = GetTime();
+
+	memset(&d, 0, sizeof(d));
+	memcpy(d.ShortName.Name, sname, 11);
+	d.ShortName.Attr = Attr;
+	d.ShortName.NTRes = ntres;
+	d.ShortName.CrtTime = t & 0xFFFF;
+	d.ShortName.CrtDate = t >> 16;
+	d.ShortName.WrtTime = t & 0xFFFF;
+	d.ShortName.WrtDate = t >> 16;
+	d.ShortName.lstAccDate = t >> 16;
+	d.ShortName.FstClusHI = FirstClus >> 16;
+	d.ShortName.FstClusLO = FirstClus & 0xFFFF;
+
+	uint64_t off = DirOffset(pos);
+
+	if (vDiskIO->Write(off, (uint8_t*)&d, sizeof(d)) != sizeof(d))
+		return false;
+
+	DirCacheAdd(dirclus, name, nlen, lfnpos, pos);
+
+	pDir->DirClus = dirclus;
+	pDir->d_dirent.d_type = (Attr & FATFS_DIRATTR_DIRECTORY) ? DT_DIR : DT_REG;
+	pDir->d_dirent.d_att = 0;
+	pDir->d_dirent.FirstClus = FirstClus;
+	pDir->d_dirent.EntrySect = off / vSectSize;
+	pDir->d_dirent.EntryIdx = (off % vSectSize) / sizeof(FATFS_DIR);
+	pDir->d_dirent.d_size = 0;
+	pDir->d_dirent.d_offset = 0;
+	nlen = min(nlen, NAME_MAX);
+	memcpy(pDir->d_dirent.d_name, name, nlen);
+	pDir->d_dirent.d_name[nlen] = 0;
+	pDir->d_dirent.d_namelen = nlen;
+	pDir->d_dirname = pDir->d_dirent.d_name;
+
+	return true;
+}
+
+FATFS_FD *FatFS::GetFd(int Fd)
+{
+	if (Fd < 0 || (Fd & FATFS_FDIDX_MASK) >= vFdTblSize)
+		return NULL;
+
+	FATFS_FD *fatfd = &vpFdTbl[Fd & FATFS_FDIDX_MASK];
+
+	return fatfd->pFs == this && fatfd->Gen == ((Fd >> FATFS_FDIDX_BITS) & 0xFF) ? fatfd : NULL;
+}
+
+int FatFS::Open(const char * const pPathName, int Flags, int Mode)
+{
+	DIR dir;
+
+	(void)Mode;
+
+	if (vDiskIO == NULL || pPathName == NULL)
+		return -1;
+
+	if (vFreeFd < 0)
+	{
+		// No more file handle available
+		return -1;
+	}
+
+	bool writable = (Flags & O_ACCMODE) != O_RDONLY;
+
+	if (Find(pPathName, &dir))
+	{
+		// File found
+		if ((Flags & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL))
+			return -1;
+
+		if (dir.d_dirent.d_type == DT_DIR)
+			return -1;
+
+		if (writable && (dir.d_dirent.d_att & DA_READONLY))
+			return -1;
+	}
+	else
+	{
+		// File does not exist
+		if ((Flags & O_CREAT) == 0 || writable == false)
+			return -1;
+
+		if (Create(pPathName, FATFS_DIRATTR_ARCHIVE, 0, &dir) == false)
+			return -1;
+	}
+
+	// Take first free handle, buffer and generation kept
+	int idx = vFreeFd;
+	FATFS_FD *fatfd = &vpFdTbl[idx];
+	uint8_t *pbuff = fatfd->pBuff;
+	uint32_t buffsize = fatfd->BuffSize;
+	uint8_t gen = fatfd->Gen;
+
+	vFreeFd = fatfd->NextFree;
+	memset(fatfd, 0, sizeof(FATFS_FD));
+	fatfd->pBuff = pbuff;
+	fatfd->BuffSize = buffsize;
+	fatfd->Gen = gen;
+	fatfd->NextFree = -1;
+	fatfd->Ent.d_size = dir.d_dirent.d_size;
+	fatfd->Ent.EntrySect = dir.d_dirent.EntrySect;
+	fatfd->Ent.EntryIdx = dir.d_dirent.EntryIdx;
+	fatfd->Ent.FirstClus = dir.d_dirent.FirstClus;
+	fatfd->Ent.d_att = dir.d_dirent.d_att;
+
+	int fd = idx | (gen << FATFS_FDIDX_BITS);
+
+	// Buffered data of another handle on the same file must reach the disk
+	for (int i = 0; i < vFdTblSize; i++)
+	{
+		FATFS_FD *f = &vpFdTbl[i];
+
+		if (f->pFs == this && f->Ent.EntrySect == fatfd->Ent.EntrySect &&
+			f->Ent.EntryIdx == fatfd->Ent.EntryIdx)
+		{
+			FlushBuff(f, true);
+			f->bShared = true;
+			fatfd->bShared = true;
+
+			// Size and chain start not yet written in the directory entry
+			fatfd->Ent.d_size = f->Ent.d_size;
+			fatfd->Ent.FirstClus = f->Ent.FirstClus;
+		}
+	}
+
+	fatfd->pFs = (void*)this;
+	fatfd->Flags = Flags;
+	fatfd->bWritable = writable;
+
+	if ((Flags & O_TRUNC) && writable && fatfd->Ent.d_size > 0)
+	{
+		Truncate(fd, 0);
+	}
+
+	return fd;
+}
+
+/**
+ * Write size, first cluster and date in directory entry
+ */
+bool FatFS::UpdateDirEnt(FATFS_FD * const pFd)
+{
+	FATFS_SHORTNAME ent;
+	uint64_t off = (uint64_t)pFd->Ent.EntrySect * vSectSize +
+				   pFd->Ent.EntryIdx * sizeof(FATFS_DIR);
+
+	if (vDiskIO->Read(off, (uint8_t*)&ent, sizeof(ent)) != sizeof(ent))
+		return false;
+
+	uint32_t t = GetTime();
+
+	ent.FileSize = pFd->Ent.d_size;
+	ent.FstClusLO = pFd->Ent.FirstClus & 0xFFFF;
+	ent.FstClusHI = (pFd->Ent.FirstClus >> 16L) & 0xFFFF;
+	ent.WrtTime = t & 0xFFFF;
+	ent.WrtDate = t >> 16;
+	ent.lstAccDate = t >> 16;
+	ent.Attr |= FATFS_DIRATTR_ARCHIVE;
+
+	if (vDiskIO->Write(off, (uint8_t*)&ent, sizeof(ent)) != sizeof(ent))
+		return false;
+
+	pFd->bDirty = false;
+
+	return true;
+}
+
+int FatFS::Sync(int Fd)
+{
+	FATFS_FD *fatfd = GetFd(Fd);
+
+	if (fatfd == NULL)
+		return -1;
+
+	bool res = FlushBuff(fatfd, false);
+
+	if (fatfd->bDirty && UpdateDirEnt(fatfd) == false)
+		res = false;
+
+	UpdateFSInfo();
+	vDiskIO->Flush();
+
+	return res ? 0 : -1;
+}
+
+int FatFS::Close(int Fd)
+{
+	FATFS_FD *fatfd = GetFd(Fd);
+
+	if (fatfd == NULL)
+		return -1;
+
+	int res = Sync(Fd);
+
+	// Close handle, back to free list with a new generation
+	fatfd->pFs = NULL;
+
+	if (fatfd->bShared)
+	{
+		// Buffering resumes when a single handle is left on the file
+		FATFS_FD *other = NULL;
+		int n = 0;
+
+		for (int i = 0; i < vFdTblSize; i++)
+		{
+			FATFS_FD *f = &vpFdTbl[i];
+
+			if (f->pFs == this && f->Ent.EntrySect == fatfd->Ent.EntrySect &&
+				f->Ent.EntryIdx == fatfd->Ent.EntryIdx)
+			{
+				other = f;
+				n++;
+			}
+		}
+
+		if (n == 1)
+			other->bShared = false;
+	}
+
+	fatfd->BuffCnt = 0;
+	fatfd->Gen++;
+	fatfd->NextFree = vFreeFd;
+	vFreeFd = fatfd - vpFdTbl;
+
+	return res;
+}
+
+/**
+ * Count clusters linked consecutively from ClusNo, FAT entries read by chunks
+ *
+ * @param	ClusNo	: First cluster
+ * @param	Max		: Max number of clusters to count
+ * @param	Next	: FAT entry of the last cluster counted
+ *
+ * @return	Number of consecutive clusters, ClusNo included
+ */
+uint32_t FatFS::ChainRun(uint32_t ClusNo, uint32_t Max, uint32_t &Next)
+{
+	uint32_t d[32];
+	int esize = vType == FATFS_TYPE_FAT32 ? 4 : 2;
+	int nbent = sizeof(d) / esize;
+	uint64_t off = (uint64_t)(vFATStartSect + (vActFat < 0 ? 0 : vActFat) * vFatSize) * vSectSize;
+	uint32_t n = 0;
+
+	Next = 0;
+
+	while (ClusNo + n < vNbClus + 2)
+	{
+		uint32_t c = ClusNo + n;
+		int cnt = min(nbent, vNbClus + 2 - c);
+
+		if (vDiskIO->Read(off + c * esize, (uint8_t*)d, cnt * esize) != cnt * esize)
+			break;
+
+		for (int i = 0; i < cnt; i++)
+		{
+			uint32_t v = esize == 4 ? d[i] & FATFS_FAT32_ENTRY_MASK : ((uint16_t*)d)[i];
+
+			n++;
+			if (v != c + i + 1 || n >= Max)
+			{
+				Next = v;
+				return n;
+			}
+		}
+	}
+
+	return max(n, 1);
+}
+
+/**
+ * Start a new extent at end of the walked chain.  The previous last extent is
+ * kept once every ExtStride, otherwise replaced.  When the table is full,
+ * every other extent is dropped and the stride doubled, so that seek walks
+ * stay bounded for files with many fragments.
+ */
+FATFS_EXTENT *FatFS::AddExtent(FATFS_FD * const pFd, uint32_t Idx, uint32_t ClusNo)
+{
+	if (pFd->NbExt > 1 && ++pFd->ExtSkip < pFd->ExtStride)
+	{
+		pFd->NbExt--;
+	}
+	else
+	{
+		pFd->ExtSkip = 0;
+
+		if (pFd->NbExt >= FATFS_EXTENT_MAX)
+		{
+			int n = 0;
+
+			for (int i = 0; i < pFd->NbExt - 1; i += 2)
+				pFd->Ext[n++] = pFd->Ext[i];
+			pFd->Ext[n++] = pFd->Ext[pFd->NbExt - 1];
+			pFd->NbExt = n;
+			pFd->ExtStride <<= 1;
+		}
+	}
+
+	FATFS_EXTENT *e = &pFd->Ext[pFd->NbExt++];
+
+	e->Idx = Idx;
+	e->Clus = ClusNo;
+	e->Len = 1;
+
+	return e;
+}
+
+/**
+ * Cluster chain changed, drop extents of all handles on the same file.  Only
+ * shared files need a table scan
+ */
+void FatFS::InvalidateExtents(FATFS_FD * const pFd)
+{
+	int n = pFd->bShared ? vFdTblSize : 1;
+
+	for (int i = 0; i < n; i++)
+	{
+		FATFS_FD *fd = pFd->bShared ? &vpFdTbl[i] : pFd;
+
+		if (fd == pFd || (fd->pFs == this && fd->Ent.EntrySect == pFd->Ent.EntrySect &&
+			fd->Ent.EntryIdx == pFd->Ent.EntryIdx))
+		{
+			fd->NbExt = 0;
+			fd->ExtStride = 1;
+			fd->ExtSkip = 0;
+			fd->CurClus = 0;
+			fd->ClusIdx = 0;
+			fd->Ent.FirstClus = pFd->Ent.FirstClus;
+		}
+	}
+}
+
+/**
+ * File size changed, copy it to all handles on the same file, so that none
+ * writes back a stale size in the directory entry
+ */
+void FatFS::ShareSize(FATFS_FD * const pFd)
+{
+	if (pFd->bShared == false)
+		return;
+
+	for (int i = 0; i < vFdTblSize; i++)
+	{
+		FATFS_FD *fd = &vpFdTbl[i];
+
+		if (fd->pFs == this && fd->Ent.EntrySect == pFd->Ent.EntrySect &&
+			fd->Ent.EntryIdx == pFd->Ent.EntryIdx)
+		{
+			fd->Ent.d_size = pFd->Ent.d_size;
+		}
+	}
+}
+
+/**
+ * Get cluster at index Idx of the file chain.  The extent table is searched
+ * first.  Past it, the chain is walked from the end of the last extent,
+ * extending the table, or from the last cluster accessed when closer in a
+ * gap between seek points.  With bAlloc, clusters are added at end of chain.
+ *
+ * @param	pRun	: Number of consecutive clusters known from Idx (optional)
+ *
+ * @return	Cluster number, 0 if past end of chain or disk full
+ */
+uint32_t FatFS::GetCluster(FATFS_FD * const pFd, uint32_t Idx, bool bAlloc, uint32_t *pRun)
+{
+	FATFS_FDENT *de = &pFd->Ent;
+
+	if (de->FirstClus == 0)
+	{
+		uint32_t c;
+
+		if (bAlloc == false || (c = AllocCluster(0)) == 0)
+			return 0;
+
+		de->FirstClus = c;
+		pFd->bDirty = true;
+		InvalidateExtents(pFd);
+	}
+
+	if (pFd->NbExt == 0)
+	{
+		pFd->ExtStride = 1;
+		pFd->ExtSkip = 0;
+		AddExtent(pFd, 0, de->FirstClus);
+	}
+
+	// Last extent starting at or before Idx
+	int lo = 0, hi = pFd->NbExt - 1;
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi + 1) >> 1;
+
+		if (pFd->Ext[mid].Idx <= Idx)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	FATFS_EXTENT *e = &pFd->Ext[lo];
+	uint32_t i = e->Idx + e->Len - 1;
+	uint32_t clus = e->Clus + e->Len - 1;
+	uint32_t run;
+	bool brec = lo == pFd->NbExt - 1;
+
+	if (Idx <= i)
+	{
+		clus = e->Clus + Idx - e->Idx;
+		run = e->Len - (Idx - e->Idx);
+		i = Idx;
+	}
+	else
+	{
+		if (brec == false && pFd->CurClus != 0 && pFd->ClusIdx > i && pFd->ClusIdx <= Idx)
+		{
+			i = pFd->ClusIdx;
+			clus = pFd->CurClus;
+		}
+
+		// Walk no further than file size, unless growing it
+		uint32_t limit = max(de->d_size / vClusBytes + 1, Idx + 1);
+
+		while (true)
+		{
+			uint32_t next;
+
+			run = ChainRun(clus, limit > i ? limit - i : 1, next);
+
+			if (brec)
+				e->Len = i - e->Idx + run;
+
+			if (Idx < i + run)
+			{
+				clus += Idx - i;
+				run -= Idx - i;
+				i = Idx;
+				break;
+			}
+
+			clus += run - 1;
+			i += run - 1;
+
+			if (IsEoc(next) || next < 2 || next >= vNbClus + 2)
+			{
+				if (bAlloc == false || (next = AllocCluster(clus)) == 0)
+					return 0;
+			}
+
+			i++;
+			if (brec)
+			{
+				if (next == clus + 1)
+					e->Len++;
+				else
+					e = AddExtent(pFd, i, next);
+			}
+			clus = next;
+		}
+	}
+
+	pFd->CurClus = clus;
+	pFd->ClusIdx = i;
 
-	//vDiskIO = std::shared_ptr<DiskIO>(pDiskIO);
-	vDiskIO = pDiskIO;
-	int res = vDiskIO->Read(0, sect, 512);
-	if (!res)
-		return false;
+	if (pRun)
+		*pRun = min(run, 0x7FFFFFFFUL / vClusBytes);
+
+	return clus;
+}
 
-	uint32_t *p = (uint32_t*)sect;
-	if (*p == 0)
+/**
+ * Write back modified buffer sectors
+ *
+ * @param	bDrop	: Empty the buffer as well
+ */
+bool FatFS::FlushBuff(FATFS_FD * const pFd, bool bDrop)
+{
+	if (pFd->DirtyEnd > pFd->DirtyStart)
 	{
-		MBR *pmbr = (MBR*)sect;
+		int n = pFd->DirtyEnd - pFd->DirtyStart;
 
-		vPartStartSect = pmbr->Part[0].LBAStart;
-		res = vDiskIO->Read(pmbr->Part[0].LBAStart * 512, sect, 512);
-		if (!res)
+		if (vDiskIO->WriteDirect(pFd->BuffSect + pFd->DirtyStart,
+								 pFd->pBuff + pFd->DirtyStart * vSectSize, n) != n)
 			return false;
+
+		pFd->DirtyStart = pFd->DirtyEnd = 0;
 	}
 
-	FATFS_BSBPB *fatbs = (FATFS_BSBPB*)sect;
+	if (bDrop)
+		pFd->BuffCnt = 0;
 
-	vFATStartSect = vPartStartSect + fatbs->RsvdSecCnt;
-	vClusterSize = fatbs->SecPerClus;
-	if (fatbs->TotSec32 && fatbs->FATSz16 == 0)
-	{
-		// FAT32
-		vFatSize = fatbs->BPB.Bpb32.FATSz32;
-		vTotalSect = fatbs->TotSec32;
-		vDataStartSect = vFATStartSect + fatbs->NumFATs * fatbs->BPB.Bpb32.FATSz32;
-		vRootDirSect = vDataStartSect + (fatbs->BPB.Bpb32.RootClus - 2) * fatbs->SecPerClus;
-	}
-	else
+	return true;
+}
+
+/**
+ * Transfer at the file position through the handle buffer.  The buffer holds
+ * consecutive file sectors aligned on its size, within one run of clusters.
+ * On a miss modified sectors are written back, then only sectors holding file
+ * data are read, the others start zeroed.
+ *
+ * @return	Number of bytes transferred
+ */
+int FatFS::BuffXfer(FATFS_FD * const pFd, uint8_t *pBuff, uint32_t Len, bool bWrite)
+{
+	FATFS_FDENT *de = &pFd->Ent;
+	int cnt = 0;
+
+	while (Len > 0)
 	{
-		// FAT12 or FAT16
-		vFatSize = fatbs->FATSz16;
-		vTotalSect = fatbs->TotSec16;
-		vRootDirSect = vFATStartSect + fatbs->NumFATs * fatbs->FATSz16;
-		vDataStartSect = /*vFATStartSect + fatbs->NumFATs * fatbs->FATSz16 +*/
-						vRootDirSect + fatbs->RootEntCnt * 32 / 512;
-	}
+		uint32_t idx = de->d_offset / vSectSize;
+		uint32_t k = idx - pFd->BuffIdx;
+
+		if (pFd->BuffCnt == 0 || k >= pFd->BuffCnt)
+		{
+			uint32_t run;
+			uint32_t cidx = de->d_offset / vClusBytes;
+
+			if (FlushBuff(pFd, true) == false)
+				break;
+
+			uint32_t clus = GetCluster(pFd, cidx, bWrite, &run);
+
+			if (clus == 0)
+				break;
+
+			uint32_t first = cidx * vClusterSize;
+			uint32_t start = idx - idx % pFd->BuffSize;
+			uint32_t end;
+
+			if (start < first)
+				start = first;
+			end = min(start + pFd->BuffSize, first + run * vClusterSize);
 
-	//res = vDiskIO->SectRead(vDataStartSect, sect);
-/*
-	res = vDiskIO->SectRead(vRootDirSect, sect);
-	FATFS_DIR *dir = (FATFS_DIR *)sect;
+			uint32_t sect = ClusToSect(clus) + start - first;
+			uint32_t nrd = 0;
 
-		for (int j = 0; j < 16; j++)
+			if (de->d_size > start * vSectSize)
+				nrd = min(end - start, (de->d_size - start * vSectSize + vSectSize - 1) / vSectSize);
+
+			if (nrd > 0 && vDiskIO->ReadDirect(sect, pFd->pBuff, nrd) != (int)nrd)
+				break;
+
+			memset(pFd->pBuff + nrd * vSectSize, 0, (end - start - nrd) * vSectSize);
+			pFd->BuffIdx = start;
+			pFd->BuffSect = sect;
+			pFd->BuffCnt = end - start;
+			k = idx - start;
+		}
+
+		uint32_t off = k * vSectSize + de->d_offset % vSectSize;
+		uint32_t l = min(Len, pFd->BuffCnt * vSectSize - off);
+
+		if (bWrite)
 		{
-			if (dir->ShortName.Name[0] != 0)
+			uint32_t e = (off + l + vSectSize - 1) / vSectSize;
+
+			memcpy(pFd->pBuff + off, pBuff, l);
+
+			if (pFd->DirtyEnd == 0)
 			{
-			//	break;
+				pFd->DirtyStart = k;
+				pFd->DirtyEnd = e;
 			}
-			dir++;
-		}*/
-	InstallBlkDev((STDDEV*)&g_FatFSBlkDev, STDFS_FILENO);
+			else
+			{
+				pFd->DirtyStart = min(pFd->DirtyStart, k);
+				pFd->DirtyEnd = max(pFd->DirtyEnd, e);
+			}
+		}
+		else
+		{
+			memcpy(pBuff, pFd->pBuff + off, l);
+		}
 
-	return true;
+		Len -= l;
+		cnt += l;
+		pBuff += l;
+		de->d_offset += l;
+		if (de->d_offset > de->d_size)
+			de->d_size = de->d_offset;
+	}
+
+	return cnt;
 }
-/*
-extern "C" size_t wcstombs(char *p, const wchar_t *pw, size_t Cnt)
+
+/**
+ * Transfer file data between device and caller buffer.  Whole sectors go
+ * directly to the device, partial head and tail sectors through the cache.
+ *
+ * @return	Number of bytes transferred
+ */
+int FatFS::DataXfer(uint64_t Offset, uint8_t *pBuff, uint32_t Len, bool bWrite)
 {
-	size_t retval = 0;
-	uint8_t *s = (uint8_t*)pw;
+	uint32_t sectsz = vDiskIO->GetSectSize();
+	uint32_t head = Offset % sectsz;
+	int cnt = 0;
 
-	while (Cnt-- > 0 && *s != 0)
+	if (head > 0)
 	{
-		*p = *s;
-		p++;
-		s+=2;
-		retval++;
+		head = sectsz - head;
+		if (head > Len)
+			head = Len;
+
+		cnt = bWrite ? vDiskIO->Write(Offset, pBuff, head) : vDiskIO->Read(Offset, pBuff, head);
+		if (cnt < (int)head)
+			return cnt;
 	}
 
-	return retval;
-}
-*/
-int ExtractLongName(FATFS_DIR *pDirEnt, char *pBuff)
-{
-	char *p = (char *)pDirEnt->LongName.Name1;
-	int n = 5;
-	int len = 0;
+	int n = (Len - cnt) / sectsz;
 
-	while (n > 0 && *p != -1)
+	if (n > 0)
 	{
-		*pBuff++ = *p;
-		p+=2;
-		n--;
-		len++;
+		uint32_t sectno = (Offset + cnt) / sectsz;
+		int k = bWrite ? vDiskIO->WriteDirect(sectno, pBuff + cnt, n) :
+						 vDiskIO->ReadDirect(sectno, pBuff + cnt, n);
+
+		if (k > 0)
+			cnt += k * sectsz;
+		if (k < n)
+			return cnt;
 	}
-	if (n == 0)
+
+	if ((uint32_t)cnt < Len)
 	{
-		p = (char *)pDirEnt->LongName.Name2;
-		n = 6;
-		while (n > 0 && *p != -1)
-		{
-			*pBuff++ = *p;
-			p+=2;
-			n--;
-			len++;
-		}
-		if (n == 0)
-		{
-			p = (char *)pDirEnt->LongName.Name3;
-			n = 2;
-			while (n > 0 && *p != -1)
-			{
-				*pBuff++ = *p;
-				p+=2;
-				n--;
-				len++;
-			}
-		}
+		int c = bWrite ? vDiskIO->Write(Offset + cnt, pBuff + cnt, Len - cnt) :
+						 vDiskIO->Read(Offset + cnt, pBuff + cnt, Len - cnt);
+
+		if (c > 0)
+			cnt += c;
 	}
-	if (n > 0)
-		*pBuff = 0;
 
-	return len;
+	return cnt;
 }
 
-bool FatFS::Find(char *const pPathName, DIR *pDir)
+int FatFS::Read(int Fd, uint8_t *pBuff, size_t Len)
 {
-	char *pname;
-	char tok[] = {"/"};
-	//uint8_t sect[512];
-	int diridx = 0;
-	int nsect = vClusterSize;
-	int sectno = vRootDirSect;
-	bool found = false;
-	char name[64];
-	uint32_t clus = 0;
-	char path[256];
+	FATFS_FD *fatfd = GetFd(Fd);
 
-	pDir->d_dirent.d_name[0] = '/';
-	pDir->d_dirent.d_name[1] = 0;
-	pDir->d_dirent.FirstClus = 2;
-	pDir->d_dirname = pDir->d_dirent.d_name;
-	//pDir->d_dirent.EntrySect = vRootDirSect;
-	pDir->d_dirent.EntrySect = vRootDirSect;
-	pDir->d_dirent.EntryIdx = 0;
-	pDir->d_dirent.d_type = DT_DIR;
+	if (fatfd == NULL || pBuff == NULL || (fatfd->Flags & O_ACCMODE) == O_WRONLY)
+		return -1;
 
-	path[0] = 0;
+	FATFS_FDENT *de = &fatfd->Ent;
+	int retval = 0;
 
-	pname = strtok((char *)pPathName, tok);
+	// Large requests bypass the cache, small ones keep read ahead
+	bool bdirect = Len >= DISKIO_CACHE_BYPASS_MIN * (size_t)vDiskIO->GetSectSize();
 
-	while (pname)
+	if (fatfd->pBuff != NULL && fatfd->bShared == false && bdirect == false)
 	{
-		//FATFS_DIR dir[16];
-		FATFS_DIR dir;// = (FATFS_DIR*)vSectData;
-		while (nsect > 0)
-		{
-			uint64_t off = sectno * 512;
-			//vDiskIO->SectRead(sectno, vSectData);
-			for (int i = 0; i < 16; i++)
-			{
-				vDiskIO->Read(off, (uint8_t*)&dir, sizeof(FATFS_DIR));
-				if (dir.LongName.Ord == FATFS_DIRENT_DELETED || dir.LongName.Ord == 0)
-				{
-					off += sizeof(FATFS_DIR);
-					continue;
-				}
-				if (dir.ShortName.Attr == 0xf && dir.LongName.Type == 0)// &&
-				//	(dir[i].LongName.Ord & FATFS_DIRENT_LASTLONG) == FATFS_DIRENT_LASTLONG)
-				{
-					// Long file name
-					int n = dir.LongName.Ord & 0x3f;
-					while (n > 0)
-					{
-						char *p = name + (13 * (n-1));
-						ExtractLongName(&dir, p);
-						i++;
-						if (i > 15)
-						{
-							i = 0;
-							sectno++;
-							nsect--;
-							off = sectno * 512;
-						}
-						else
-							off += sizeof(FATFS_DIR);
-						n--;
-						vDiskIO->Read(off, (uint8_t*)&dir, sizeof(FATFS_DIR));
-					}
-				}
-				else
-				{
-					// Short file name
-					int n = 8;
-					char *p = name;
-					char *ps = (char *)dir.ShortName.Name;
-					while (n > 0 &&  *ps != ' ')
-					{
-						*p++ = *ps++;
-						n--;
-					}
-					ps = (char *)&dir.ShortName.Name[8];
-					if (*ps != ' ')
-					{
-						*p++ = '.';
-						n = 3;
-						while (n > 0 && *ps != ' ')
-						{
-							*p++ = *ps++;
-							n--;
-						}
-					}
-					*p = 0;
-				}
-//				printf("Name : %s\r\n", name);
-				if (strcasecmp((const char*)pname, (const char*)name) == 0)
-				{
-					// Found a matching entry
-					//printf("Match filename\r\n");
-					found = true;
-					diridx = i;
-					// Previous matched is the parent directory
-					strcat(path, pDir->d_dirent.d_name);
-					strcat(path, "/");
-					pDir->DirClus = pDir->d_dirent.FirstClus;
-							//(dir[diridx].ShortName.FstClusHI << 16L) | dir[diridx].ShortName.FstClusLO;
-					if (dir.ShortName.Attr & FATFS_DIRATTR_DIRECTORY)
-					{
-						pDir->d_dirent.d_type = DT_DIR;
-
-					}
-					else
-					{
-						pDir->d_dirent.d_type = DT_REG;
-					}
-					pDir->d_dirent.FirstClus = (dir.ShortName.FstClusHI << 16L) | dir.ShortName.FstClusLO;
-					pDir->d_dirent.EntrySect = sectno;
-					pDir->d_dirent.EntryIdx = diridx;
-					if (dir.ShortName.Attr & FATFS_DIRATTR_HIDDEN)
-						pDir->d_dirent.d_att |= DA_HIDDEN;
-					if (dir.ShortName.Attr & FATFS_DIRATTR_SYSTEM)
-						pDir->d_dirent.d_att |= DA_SYSTEM;
-					if (dir.ShortName.Attr & FATFS_DIRATTR_READ_ONLY)
-						pDir->d_dirent.d_att |= DA_READONLY;
-
-
-					strcpy(pDir->d_dirent.d_name, name);
-					pDir->d_dirent.d_namelen = strlen(name);
-					pDir->d_dirent.d_size = dir.ShortName.FileSize;
-					pDir->d_dirent.d_offset = 0;
-					break;
-				}
-				off += sizeof(FATFS_DIR);
-	//				diridx++;
-			}
-			if (!found)
-			{
-				sectno++;
-				nsect--;
-			}
-			else
-			{
-				pname = strtok(NULL, tok);
-				if (pname == NULL)
-				{
-					//pDir->d_dirnamelen = strlen(path);
-				    pDir->d_dirent.d_namelen = strlen(path);
-					//pDir->d_dirname = new char[pDir->d_dirnamelen + 1];//(char *)malloc(pDir->d_dirnamelen + 1);
-					strcpy(pDir->d_dirent.d_name, path);
-					break;
-				}
-				sectno = ClusToSect(clus);
-				nsect = vClusterSize;
-				found = false;
-				clus = 0;
-			}
-		}
-		if (pname && nsect <= 0)
-			return false;
+		if (de->d_offset >= de->d_size)
+			return 0;
+
+		return BuffXfer(fatfd, pBuff, min(Len, de->d_size - de->d_offset), false);
 	}
-//printf("Found = %x\r\n", found);
-	return found;
-}
 
-bool FatFS::FindFreeCluster()
-{
-    bool retval = false;
+	if (FlushBuff(fatfd, true) == false)
+		return -1;
+
+	while (Len > 0 && de->d_offset < de->d_size)
+	{
+		uint32_t run;
+		uint32_t clus = GetCluster(fatfd, de->d_offset / vClusBytes, false, &run);
+
+		if (clus == 0)
+			break;
+
+		// Consecutive clusters read in one request
+		uint32_t off = de->d_offset % vClusBytes;
+		uint32_t l = min(Len, run * vClusBytes - off);
+
+		if (l > de->d_size - de->d_offset)
+			l = de->d_size - de->d_offset;
+
+		uint64_t pos = (uint64_t)ClusToSect(clus) * vSectSize + off;
+		int c = bdirect ? DataXfer(pos, pBuff, l, false) : vDiskIO->Read(pos, pBuff, l);
+
+		if (c <= 0)
+			break;
 
-    return retval;
+		Len -= c;
+		retval += c;
+		pBuff += c;
+		de->d_offset += c;
+	}
+
+	return retval;
 }
 
-bool FatFS::FindFreeDirEntry()
+int FatFS::Write(int Fd, uint8_t *pBuff, size_t Len)
 {
-	int nsect = vClusterSize;
-	int sectno = vRootDirSect;
-	bool found = false;
-	bool retval = false;
+	FATFS_FD *fatfd = GetFd(Fd);
 
-	FATFS_DIR dir;
+	if (fatfd == NULL || pBuff == NULL || fatfd->bWritable == false)
+		return -1;
 
-	while (nsect > 0)
-	{
-		uint64_t off = sectno * 512;
-		//vDiskIO->SectRead(sectno, vSectData);
-		for (int i = 0; i < 16; i++)
-		{
-			vDiskIO->Read(off, (uint8_t*)&dir, sizeof(FATFS_DIR));
-			if (dir.LongName.Ord == FATFS_DIRENT_DELETED || dir.LongName.Ord == 0)
-			{
-				off += sizeof(FATFS_DIR);
-				found = true;
-				break;
-			}
+	FATFS_FDENT *de = &fatfd->Ent;
+	int retval = 0;
 
-			off += sizeof(FATFS_DIR);
-		}
+	if (fatfd->Flags & O_APPEND)
+		de->d_offset = de->d_size;
+
+	// FAT file size limited to 4GB - 1
+	if (Len > 0xFFFFFFFFUL - de->d_offset)
+		Len = 0xFFFFFFFFUL - de->d_offset;
+
+	if (Len == 0)
+		return 0;
+
+	// Allocate the whole chain first so that the request is written in runs
+	// of consecutive clusters instead of one cluster at a time.  On disk full
+	// the clusters obtained are still filled below.
+	bool bdirect = Len >= DISKIO_CACHE_BYPASS_MIN * (size_t)vDiskIO->GetSectSize();
+	uint32_t lastidx = (de->d_offset + Len - 1) / vClusBytes;
+	bool bgrow = GetCluster(fatfd, lastidx, false) == 0;
+
+	if (bgrow)
+		GetCluster(fatfd, lastidx, true);
 
-		retval = found;
+	// Small writes go to the handle buffer when it has one
+	bool bbuff = fatfd->pBuff != NULL && fatfd->bShared == false && bdirect == false;
+
+	if (bbuff)
+	{
+		retval = BuffXfer(fatfd, pBuff, Len, true);
+		Len -= retval;
+	}
+	else if (FlushBuff(fatfd, true) == false)
+	{
+		return -1;
+	}
+
+	while (Len > 0 && bbuff == false)
+	{
+		uint32_t run;
+		uint32_t clus = GetCluster(fatfd, de->d_offset / vClusBytes, true, &run);
 
-		if (found)
+		if (clus == 0)
 		{
-		    retval = FindFreeCluster();
-		    if (retval)
-		    {
-		        // Free cluster found
-		    }
+			// Disk full
 			break;
 		}
-		sectno++;
-		nsect--;
+
+		uint32_t off = de->d_offset % vClusBytes;
+		uint32_t l = min(Len, run * vClusBytes - off);
+		uint64_t pos = (uint64_t)ClusToSect(clus) * vSectSize + off;
+		int c = bdirect ? DataXfer(pos, pBuff, l, true) : vDiskIO->Write(pos, pBuff, l);
+
+		if (c <= 0)
+			break;
+
+		Len -= c;
+		retval += c;
+		pBuff += c;
+		de->d_offset += c;
+		if (de->d_offset > de->d_size)
+			de->d_size = de->d_offset;
+	}
+
+	ShareSize(fatfd);
+
+	if (Len > 0 && bgrow)
+	{
+		// Stopped early, release clusters allocated past the data written
+		fatfd->bDirty = true;
+		Truncate(Fd, de->d_size);
+	}
+
+	if (retval > 0)
+	{
+		fatfd->bDirty = true;
+
+		if (fatfd->Flags & O_SYNC)
+			Sync(Fd);
 	}
 
 	return retval;
 }
 
-int FatFS::Create(FATFS_FD * const pFd)
+int FatFS::Seek(int Fd, uint32_t Offset)
 {
-	int retval = -1;
+	FATFS_FD *fatfd = GetFd(Fd);
 
-	FindFreeDirEntry();
+	if (fatfd == NULL)
+		return -1;
 
-	return retval;
+	// Sizes up to 4GB, int min() not usable
+	if (Offset > fatfd->Ent.d_size)
+		Offset = fatfd->Ent.d_size;
+
+	fatfd->Ent.d_offset = Offset;
+
+	return fatfd->Ent.d_offset;
 }
 
-int FatFS::Open(char * const pPathName, int Flags, int Mode)
+int FatFS::Truncate(int Fd, uint32_t Size)
 {
-	//DIR dirinfo;
-	FATFS_FD *fatfd = NULL;
-	int fd = 0;//FATFS_FDBASE_ID;
+	FATFS_FD *fatfd = GetFd(Fd);
+
+	if (fatfd == NULL || fatfd->bWritable == false)
+		return -1;
+
+	FATFS_FDENT *de = &fatfd->Ent;
 
-	// Find empty slot
-	for (int i = 0; i < MAX_FILE; i++)
+	if (Size > de->d_size || FlushBuff(fatfd, true) == false)
+		return -1;
+
+	uint32_t nclus = (Size + vClusBytes - 1) / vClusBytes;
+
+	if (nclus == 0)
+	{
+		FreeChain(de->FirstClus);
+		de->FirstClus = 0;
+	}
+	else
 	{
-		if (vOpenFiles[i].pFs == NULL)
+		uint32_t last = GetCluster(fatfd, nclus - 1, false);
+
+		if (last == 0)
+			return -1;
+
+		uint32_t next = ReadFat(last);
+
+		if (IsEoc(next) == false)
 		{
-			fatfd = &vOpenFiles[i];
-			fd |= i;
-			break;
+			WriteFat(last, FATFS_FAT32_ENTRY_MASK);
+			FreeChain(next);
 		}
 	}
 
-	if (fatfd == NULL)
-	{
-		//printf("NO FD available to Open File\n\r");
-		// No more file handle available
+	de->d_size = Size;
+	if (de->d_offset > Size)
+		de->d_offset = Size;
+	fatfd->bDirty = true;
+	InvalidateExtents(fatfd);
+	ShareSize(fatfd);
+
+	return Sync(Fd);
+}
+
+int FatFS::Allocate(int Fd, uint32_t Size)
+{
+	FATFS_FD *fatfd = GetFd(Fd);
+
+	if (fatfd == NULL || fatfd->bWritable == false)
 		return -1;
-	}
 
-	memset(fatfd, 0, sizeof(FATFS_FD));
+	FATFS_FDENT *de = &fatfd->Ent;
+	uint32_t need = ((uint64_t)Size + vClusBytes - 1) / vClusBytes;
+	uint32_t have = 0;
+	uint32_t last = 0;
 
-	switch (Flags)
+	// Chain length, may be past file size from a previous Allocate
+	for (uint32_t c = de->FirstClus; c >= 2 && c < vNbClus + 2 && have < vNbClus; )
 	{
-		case O_RDONLY:
-			break;
-		case O_WRONLY:
-			break;
-		case O_APPEND:
-			break;
-		case O_CREAT:
-			break;
-		case O_SYNC:
+		uint32_t next;
+		uint32_t run = ChainRun(c, vNbClus, next);
+
+		have += run;
+		last = c + run - 1;
+
+		if (IsEoc(next))
 			break;
+		c = next;
 	}
 
-	if (Find(pPathName, &fatfd->DirEntry))
-	{
-		// File found
-		if (Flags & O_CREAT)
-		{
-			return -1;
-		}
+	if (have >= need)
+		return 0;
 
-		if (fatfd->DirEntry.d_dirent.d_type == DT_DIR)
-			return -1;
+	uint32_t n = need - have;
+	uint32_t c = 0;
+
+	if (last != 0 && FreeRun(last + 1, n) >= n)
+		c = last + 1;
+	else
+		c = FindFreeRun(last != 0 ? last + 1 : vNextFree, n);
 
-		fatfd->pFs = (void*)this;
-		fatfd->CurClus = fatfd->DirEntry.d_dirent.FirstClus;
-		fatfd->SectIdx = 0;
-		fatfd->SectOff = 0;
-		//uint32_t sectno = ClusToSect(fatfd->CurClus) + fatfd->SectIdx;
-		//vDiskIO->SectRead(sectno, fatfd->SectData);
-		fatfd->DirEntry.d_dirent.d_offset = 0;
+	// Run linked first, then attached to the file
+	if (c == 0 || LinkRun(c, n) == false)
+		return -1;
 
-		return fd;
+	if (last != 0)
+	{
+		if (WriteFat(last, c) == false)
+			return -1;
 	}
 	else
 	{
-		//printf("File not found\r\n");
-		// File does not exist
-		if ((Flags & O_CREAT) == 0)
-		{
-			return -1;
-		}
-
-		if (Create(fatfd))
-		{
-	        fatfd->pFs = (void*)this;
-	        fatfd->CurClus = fatfd->DirEntry.d_dirent.FirstClus;
-	        fatfd->SectIdx = 0;
-	        fatfd->SectOff = 0;
-	        //uint32_t sectno = ClusToSect(fatfd->CurClus) + fatfd->SectIdx;
-	        //vDiskIO->SectRead(sectno, fatfd->SectData);
-	        fatfd->DirEntry.d_dirent.d_offset = 0;
-		}
+		de->FirstClus = c;
+		fatfd->bDirty = true;
 	}
 
-	return -1;
+	if (vFreeCnt != FATFS_FSINFO_UNKNOWN)
+		vFreeCnt -= n;
+
+	vNextFree = c + n < vNbClus + 2 ? c + n : 2;
+	vbInfoDirty = true;
+	InvalidateExtents(fatfd);
+
+	return Sync(Fd);
 }
 
-int FatFS::Close(int Fd)
+uint32_t FatFS::Map(int Fd, uint32_t Offset, uint64_t &DiskOffset)
+{
+	FATFS_FD *fatfd = GetFd(Fd);
+
+	// Data is about to be accessed directly
+	if (fatfd == NULL || FlushBuff(fatfd, true) == false)
+		return 0;
+
+	uint32_t clus = GetCluster(fatfd, Offset / vClusBytes, false);
+
+	if (clus == 0)
+		return 0;
+
+	// Run length from the FAT, the extents only cover the chain up to file size
+	uint32_t next;
+	uint32_t run = ChainRun(clus, 0x7FFFFFFFUL / vClusBytes, next);
+	uint32_t off = Offset % vClusBytes;
+
+	DiskOffset = (uint64_t)ClusToSect(clus) * vSectSize + off;
+
+	return run * vClusBytes - off;
+}
+
+int FatFS::SetSize(int Fd, uint32_t Size)
 {
-//	uint8_t sect[512];
-	FATFS_FD *fatfd = &vOpenFiles[Fd & FATFS_FDIDX_MASK];
-	//FATFS_DIR *fatdir = (FATFS_DIR*)vSectData;
-	int idx = fatfd->DirEntry.d_dirent.EntryIdx;
+	FATFS_FD *fatfd = GetFd(Fd);
 
-	if (fatfd->pFs == NULL || fatfd->pFs != this)
+	if (fatfd == NULL || fatfd->bWritable == false)
 		return -1;
 
-	FATFS_DIR fatdir;
-	uint32_t sectno = ClusToSect(fatfd->DirEntry.DirClus);
-	uint64_t off = (uint64_t)sectno + idx * sizeof(FATFS_DIR);
-	//vDiskIO->SectRead(fatfd->DirEntry.d_dirent.EntrySect, vSectData);
-	//vDiskIO->Read(off, (uint8_t*)&fatdir, sizeof(FATFS_DIR));
-	fatdir.ShortName.FileSize = fatfd->DirEntry.d_dirent.d_size;
-	fatdir.ShortName.FstClusLO = fatfd->DirEntry.d_dirent.FirstClus & 0xFFFF;
-	fatdir.ShortName.FstClusHI = (fatfd->DirEntry.d_dirent.FirstClus >> 16L) & 0xFFFF;
-	//delete fatfd->DirEntry.d_dirname;
-	//fatfd->DirEntry.d_dirname = NULL;
-	//vDiskIO->SectWrite(fatfd->DirEntry.d_dirent.EntrySect, sect);
-	vDiskIO->Write(off, (uint8_t *)&fatdir, sizeof(FATFS_DIR));
-	fatfd->pFs = NULL;	// Close handle
+	FATFS_FDENT *de = &fatfd->Ent;
 
-	return 0;
+	if (FlushBuff(fatfd, true) == false ||
+		(Size > 0 && GetCluster(fatfd, (Size - 1) / vClusBytes, false) == 0))
+		return -1;
+
+	de->d_size = Size;
+	if (de->d_offset > Size)
+		de->d_offset = Size;
+	fatfd->bDirty = true;
+	ShareSize(fatfd);
+
+	return Sync(Fd);
 }
 
-int FatFS::Read(int Fd, uint8_t *pBuff, size_t Len)
+bool FatFS::Remove(const char * const pPathName)
 {
-	FATFS_FD *fatfd = &vOpenFiles[Fd & FATFS_FDIDX_MASK];
-	DIR *pdir = &fatfd->DirEntry;
-	int retval = 0;
-	int sectno;
+	DIR dir;
+	FATFS_DIRPOS pos, lfnpos;
+
+	if (vDiskIO == NULL || pPathName == NULL ||
+		LookUp(pPathName, strlen(pPathName), &dir, &pos, &lfnpos) == false)
+		return false;
+
+	// Root directory
+	if (dir.d_dirent.FirstClus == vRootClus && dir.d_dirent.d_type == DT_DIR)
+		return false;
 
-	if (fatfd->pFs == this)
+	for (int i = 0; i < vFdTblSize; i++)
 	{
-		sectno = ClusToSect(fatfd->CurClus) + fatfd->SectIdx;
-//printf("sectno %d %d\r\n", sectno, fatfd->CurClus);
-		while (Len > 0)
-		{
-			uint32_t c = std::min(FATFS_SECTOR_SIZE - fatfd->SectOff, (uint32_t)Len);
-			c = std::min(c, pdir->d_dirent.d_size - pdir->d_dirent.d_offset);
-//printf("read len %d, %d\r\n", Len, c);
-			if (c > 0)
-			{
-				uint64_t off = (uint64_t)sectno * FATFS_SECTOR_SIZE + fatfd->SectOff;
-				vDiskIO->Read(off, pBuff, c);
-				Len -= c;
-				retval += c;
-				fatfd->SectOff += c;
-				pdir->d_dirent.d_offset += c;
-				pBuff += c;
-			}
-			if (fatfd->SectOff >= FATFS_SECTOR_SIZE)// && pdir->d_dirent.d_offset < pdir->d_dirent.d_size)
-			{
-				sectno++;
-				fatfd->SectIdx++;
-				if (fatfd->SectIdx >= vClusterSize)
-				{
-					fatfd->SectIdx = 0;
-					uint64_t off = vFATStartSect * 512 + fatfd->CurClus * sizeof(uint32_t);
-					uint32_t x = 0;
-					vDiskIO->Read(off, (uint8_t*)&x, sizeof(uint32_t));
-					if (x > 0 && x != FATFS_FATENTRY_ALLOCATED)
-						fatfd->CurClus = x;
-					sectno = ClusToSect(fatfd->CurClus) + fatfd->SectIdx;
-				}
-				fatfd->SectOff = 0;
-			}
-			//else
-			//	break;
-			if (pdir->d_dirent.d_offset >= pdir->d_dirent.d_size)
+		if (vpFdTbl[i].pFs == this &&
+			vpFdTbl[i].Ent.EntrySect == dir.d_dirent.EntrySect &&
+			vpFdTbl[i].Ent.EntryIdx == dir.d_dirent.EntryIdx)
+			return false;
+	}
+
+	if (dir.d_dirent.d_type == DT_DIR)
+	{
+		// Only '.' and '..' allowed
+		FATFS_DIRPOS p = { dir.d_dirent.FirstClus, 0 };
+		FATFS_DIRBUF buf;
+		FATFS_DIR *d;
+
+		buf.Cnt = 0;
+
+		do {
+			if ((d = DirGet(p, buf)) == NULL)
+				return false;
+			if (d->ShortName.Name[0] == 0)
 				break;
-		}
+			if (d->ShortName.Name[0] != FATFS_DIRENT_DELETED && d->ShortName.Name[0] != '.')
+				return false;
+		} while (DirNext(p, false));
 	}
-	return retval;
+
+	DirCacheRemove(dir.DirClus, &lfnpos);
+	if (dir.d_dirent.d_type == DT_DIR)
+		DirCacheRemove(dir.d_dirent.FirstClus, NULL);
+
+	// Mark long name and short entries deleted
+	uint8_t del = FATFS_DIRENT_DELETED;
+
+	while (true)
+	{
+		vDiskIO->Write(DirOffset(lfnpos), &del, 1);
+
+		if (lfnpos.Clus == pos.Clus && lfnpos.Idx == pos.Idx)
+			break;
+		if (DirNext(lfnpos, false) == false)
+			return false;
+	}
+
+	FreeChain(dir.d_dirent.FirstClus);
+	UpdateFSInfo();
+	vDiskIO->Flush();
+
+	return true;
 }
 
-int FatFS::Write(int Fd, uint8_t *pBuff, size_t Len)
+bool FatFS::MkDir(const char * const pPathName)
 {
-	FATFS_FD *fatfd = &vOpenFiles[Fd & FATFS_FDIDX_MASK];
-	DIR *pdir = &fatfd->DirEntry;
+	DIR dir;
+
+	if (vDiskIO == NULL || pPathName == NULL || Find(pPathName, &dir))
+		return false;
 
-	if (fatfd->pFs == this)
+	uint32_t clus = AllocCluster(0);
+
+	if (clus == 0)
+		return false;
+
+	if (ZeroCluster(clus) == false ||
+		Create(pPathName, FATFS_DIRATTR_DIRECTORY, clus, &dir) == false)
 	{
+		FreeChain(clus);
+		return false;
+	}
 
+	// '.' and '..' entries, '..' of first level directory points to cluster 0
+	FATFS_DIR d[2];
+	uint32_t parent = dir.DirClus == vRootClus ? 0 : dir.DirClus;
+	uint32_t t = GetTime();
+
+	memset(d, 0, sizeof(d));
+	memset(d[0].ShortName.Name, ' ', 11);
+	memset(d[1].ShortName.Name, ' ', 11);
+	d[0].ShortName.Name[0] = '.';
+	d[1].ShortName.Name[0] = '.';
+	d[1].ShortName.Name[1] = '.';
+	for (int i = 0; i < 2; i++)
+	{
+		uint32_t c = i == 0 ? clus : parent;
+
+		d[i].ShortName.Attr = FATFS_DIRATTR_DIRECTORY;
+		d[i].ShortName.CrtTime = t & 0xFFFF;
+		d[i].ShortName.CrtDate = t >> 16;
+		d[i].ShortName.WrtTime = t & 0xFFFF;
+		d[i].ShortName.WrtDate = t >> 16;
+		d[i].ShortName.FstClusHI = c >> 16;
+		d[i].ShortName.FstClusLO = c & 0xFFFF;
 	}
-	return 0;
+
+	bool res = vDiskIO->Write((uint64_t)ClusToSect(clus) * vSectSize, (uint8_t*)d, sizeof(d)) == sizeof(d);
+
+	UpdateFSInfo();
+	vDiskIO->Flush();
+
+	return res;
 }
 
 uint32_t FatFS::ClusToSect(uint32_t ClusNo)
@@ -596,29 +2426,27 @@ bool FATFSInit(void *pDiskIO)
 
 int FATFSOpen(void *pDevObj, const char *pPathName, int Flags, int Mode)
 {
-	int retval = g_FatFS.Open((char*)pPathName, Flags, Mode);
+	int retval = ((FatFS*)pDevObj)->Open(pPathName, Flags, Mode);
 
 	return retval;
 }
 
 int FATFSClose(void *pDevObj, int Fd)
 {
-	return g_FatFS.Close(Fd);
+	return ((FatFS*)pDevObj)->Close(Fd);
 }
 
 int FATFSSeek(void *pDevObj, int Fd, int Offset)
 {
-	return -1;
+	return ((FatFS*)pDevObj)->Seek(Fd, Offset);
 }
 
 int FATFSRead(void *pDevObj, int Fd, uint8_t *pBuff, size_t Len)
 {
-	return g_FatFS.Read(Fd, pBuff, Len);
+	return ((FatFS*)pDevObj)->Read(Fd, pBuff, Len);
 }
 
 int FATFSWrite(void *pDevObj, int Fd, uint8_t *pBuff, size_t Len)
 {
-	return g_FatFS.Write(Fd, pBuff, Len);
+	return ((FatFS*)pDevObj)->Write(Fd, pBuff, Len);
 }
-
-
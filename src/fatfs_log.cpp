@@ -0,0 +1,408 @@
+/**-------------------------------------------------------------------------
+@file	fatfs_log.cpp
+
+@brief	Streaming record logger on a preallocated FatFS file
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+
+#include "istddef.h"
+#include "crc.h"
+#include "fatfs_log.h"
+
+FatFSLog::FatFSLog()
+{
+	vpFs = NULL;
+	vpDisk = NULL;
+	vFd = -1;
+	vSectSize = 0;
+	vMaxRecLen = 0;
+	vSession = 0;
+	vpBuff = NULL;
+	vNbBuff = 0;
+	vCur = 0;
+	vOff = 0;
+	vBuffIdx = 0;
+	vCommitIdx = 0;
+	vCommitIval = 0;
+	vRunIdx = 0;
+	vRunSect = 0;
+	vRunLen = 0;
+}
+
+bool FatFSLog::Init(const FATFSLOG_CFG &Cfg, FatFS * const pFs)
+{
+	if (pFs == NULL || pFs->GetDiskIO() == NULL || Cfg.pPathName == NULL || Cfg.pMem == NULL)
+		return false;
+
+	vpFs = pFs;
+	vpDisk = pFs->GetDiskIO();
+	vSectSize = vpDisk->GetSectSize();
+	vpBuff = (uint8_t*)Cfg.pMem;
+	vNbBuff = Cfg.MemSize / vSectSize;
+	vCommitIval = Cfg.CommitInterval;
+	vMaxRecLen = vSectSize - sizeof(FATFSLOG_SECTHDR) - sizeof(uint16_t);
+
+	if (vNbBuff < 1 || vSectSize > 0xFFFF || vMaxRecLen < 1 || pFs->GetClusterSize() % vSectSize != 0)
+		return false;
+
+	vFd = pFs->Open(Cfg.pPathName, O_RDWR | O_CREAT, 0);
+
+	if (vFd < 0)
+		return false;
+
+	if (Mount(Cfg.MaxSize) == false)
+	{
+		pFs->Close(vFd);
+		vFd = -1;
+
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Reserve clusters, recover sectors written after the last file size update
+ * and start a new session.  The first sector of a session is written with
+ * the file size right away so that the last sector below the file size always
+ * belongs to the latest session.
+ */
+bool FatFSLog::Mount(uint32_t MaxSize)
+{
+	if (vpFs->Allocate(vFd, MaxSize) != 0)
+		return false;
+
+	vRunLen = 0;
+
+	uint32_t nsect = (uint32_t)vpFs->Seek(vFd, 0xFFFFFFFF) / vSectSize;
+	uint32_t sectno;
+
+	if (MapRun(nsect > 0 ? nsect - 1 : 0, sectno) <= 0 || vpDisk->ReadDirect(sectno, vpBuff, 1) != 1)
+		return false;
+
+	if (nsect == 0)
+	{
+		// New log, identifier from whatever the first sector held.  Stale
+		// sectors from an earlier file are unlikely to match it
+		vSession = crc32(vpBuff, vSectSize) ^ sectno;
+	}
+	else
+	{
+		vSession = ((FATFSLOG_SECTHDR*)vpBuff)->Session;
+
+		if (IsValid(vpBuff, nsect - 1) == false)
+			return false;
+
+		uint32_t n = Recover(nsect);
+
+		if (n > nsect && Commit(n) == false)
+			return false;
+
+		nsect = n;
+		vSession++;
+	}
+
+	vBuffIdx = nsect;
+	vCommitIdx = nsect;
+	vCur = 0;
+	StartSect();
+
+	// Log full, can still be read
+	if (MapRun(nsect, sectno) <= 0)
+		return true;
+
+	CloseSect();
+
+	if (WriteBuff(1) == false || Commit(vBuffIdx) == false)
+		return false;
+
+	StartSect();
+
+	return true;
+}
+
+/**
+ * Disk sector of a file sector.  The run of consecutive sectors is looked up
+ * once
+ *
+ * @return	Number of consecutive sectors from Idx, 0 if past the file clusters
+ */
+int FatFSLog::MapRun(uint32_t Idx, uint32_t &SectNo)
+{
+	if (Idx < vRunIdx || Idx - vRunIdx >= vRunLen)
+	{
+		uint64_t off = 0;
+		uint32_t l = vpFs->Map(vFd, Idx * vSectSize, off);
+
+		vRunIdx = Idx;
+		vRunSect = off / vSectSize;
+		vRunLen = l / vSectSize;
+
+		if (vRunLen == 0)
+			return 0;
+	}
+
+	SectNo = vRunSect + Idx - vRunIdx;
+
+	return vRunLen - (Idx - vRunIdx);
+}
+
+bool FatFSLog::IsValid(uint8_t *pSect, uint32_t Idx)
+{
+	FATFSLOG_SECTHDR *hdr = (FATFSLOG_SECTHDR*)pSect;
+
+	if (hdr->Magic != FATFSLOG_MAGIC || hdr->Session != vSession || hdr->Idx != Idx ||
+		hdr->Len < sizeof(FATFSLOG_SECTHDR) || hdr->Len > vSectSize)
+		return false;
+
+	uint16_t crc = hdr->Crc;
+
+	hdr->Crc = 0;
+
+	bool res = crc16_ccitt(pSect, hdr->Len, 0xFFFF) == crc;
+
+	hdr->Crc = crc;
+
+	return res;
+}
+
+/**
+ * Count valid sectors of the current session from Idx
+ *
+ * @return	Index of the first sector not valid
+ */
+uint32_t FatFSLog::Recover(uint32_t Idx)
+{
+	while (true)
+	{
+		uint32_t sectno;
+		int n = min(MapRun(Idx, sectno), vNbBuff);
+
+		if (n <= 0 || vpDisk->ReadDirect(sectno, vpBuff, n) != n)
+			return Idx;
+
+		for (int i = 0; i < n; i++, Idx++)
+		{
+			if (IsValid(vpBuff + i * vSectSize, Idx) == false)
+				return Idx;
+		}
+	}
+}
+
+void FatFSLog::StartSect()
+{
+	uint8_t *p = vpBuff + vCur * vSectSize;
+	FATFSLOG_SECTHDR *hdr = (FATFSLOG_SECTHDR*)p;
+
+	memset(p, 0, vSectSize);
+	hdr->Magic = FATFSLOG_MAGIC;
+	hdr->Session = vSession;
+	hdr->Idx = vBuffIdx + vCur;
+	vOff = sizeof(FATFSLOG_SECTHDR);
+}
+
+void FatFSLog::CloseSect()
+{
+	uint8_t *p = vpBuff + vCur * vSectSize;
+	FATFSLOG_SECTHDR *hdr = (FATFSLOG_SECTHDR*)p;
+
+	hdr->Len = vOff;
+	hdr->Crc = 0;
+	hdr->Crc = crc16_ccitt(p, vOff, 0xFFFF);
+}
+
+/**
+ * Write the first NbSect buffer sectors to disk, one request per disk run.
+ * On failure the buffer is kept as is and written again by the next try.
+ */
+bool FatFSLog::WriteBuff(int NbSect)
+{
+	uint8_t *p = vpBuff;
+	uint32_t idx = vBuffIdx;
+
+	while (NbSect > 0)
+	{
+		uint32_t sectno;
+		int n = min(MapRun(idx, sectno), NbSect);
+
+		if (n <= 0 || vpDisk->WriteDirect(sectno, p, n) != n)
+			return false;
+
+		p += n * vSectSize;
+		idx += n;
+		NbSect -= n;
+	}
+
+	vBuffIdx = idx;
+
+	return true;
+}
+
+bool FatFSLog::Commit(uint32_t NbSect)
+{
+	if (vpFs->SetSize(vFd, NbSect * vSectSize) != 0)
+		return false;
+
+	vCommitIdx = NbSect;
+
+	return true;
+}
+
+bool FatFSLog::Append(const void *pData, int Len)
+{
+	if (vFd < 0 || Len < 0 || Len > vMaxRecLen || (Len > 0 && pData == NULL))
+		return false;
+
+	if (vOff + sizeof(uint16_t) + Len > vSectSize)
+	{
+		// Record does not fit, continue in next buffer sector
+		CloseSect();
+
+		if (vCur + 1 < vNbBuff)
+		{
+			vCur++;
+		}
+		else
+		{
+			// Buffer full, written in one request
+			if (WriteBuff(vNbBuff) == false)
+				return false;
+
+			vCur = 0;
+		}
+
+		StartSect();
+
+		if (vCur == 0 && vCommitIval > 0 && vBuffIdx - vCommitIdx >= vCommitIval)
+		{
+			if (Commit(vBuffIdx) == false)
+				return false;
+		}
+	}
+
+	uint8_t *p = vpBuff + vCur * vSectSize + vOff;
+	uint16_t l = Len;
+
+	memcpy(p, &l, sizeof(l));
+	memcpy(p + sizeof(l), pData, Len);
+	vOff += sizeof(l) + Len;
+
+	return true;
+}
+
+bool FatFSLog::Sync()
+{
+	if (vFd < 0)
+		return false;
+
+	int n = vCur;
+
+	if (vOff > sizeof(FATFSLOG_SECTHDR))
+	{
+		CloseSect();
+		n++;
+	}
+
+	if (n > 0)
+	{
+		if (WriteBuff(n) == false)
+			return false;
+
+		vCur = 0;
+		StartSect();
+	}
+
+	return vBuffIdx == vCommitIdx || Commit(vBuffIdx);
+}
+
+bool FatFSLog::Close()
+{
+	if (vFd < 0)
+		return false;
+
+	bool res = Sync();
+
+	// Reservation released even if the last sectors could not be written
+	if (vpFs->Truncate(vFd, vCommitIdx * vSectSize) != 0)
+		res = false;
+
+	vpFs->Close(vFd);
+	vFd = -1;
+
+	return res;
+}
+
+int FatFSLog::Read(uint32_t &Pos, uint8_t *pBuff, int BuffLen)
+{
+	if (vFd < 0)
+		return -1;
+
+	uint32_t size = vCommitIdx * vSectSize;
+
+	while (Pos < size)
+	{
+		uint32_t sect = Pos - Pos % vSectSize;
+		FATFSLOG_SECTHDR hdr;
+		uint16_t l;
+
+		if (vpFs->Seek(vFd, sect) != (int)sect ||
+			vpFs->Read(vFd, (uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr))
+			return -1;
+
+		if (Pos < sect + sizeof(hdr))
+			Pos = sect + sizeof(hdr);
+
+		if (hdr.Magic == FATFSLOG_MAGIC && hdr.Idx == sect / vSectSize && hdr.Len <= vSectSize &&
+			Pos + sizeof(l) <= sect + hdr.Len)
+		{
+			if (vpFs->Seek(vFd, Pos) != (int)Pos || vpFs->Read(vFd, (uint8_t*)&l, sizeof(l)) != sizeof(l))
+				return -1;
+
+			if (Pos + sizeof(l) + l <= sect + hdr.Len)
+			{
+				int n = min(l, max(BuffLen, 0));
+
+				if (n > 0 && vpFs->Read(vFd, pBuff, n) != n)
+					return -1;
+
+				Pos += sizeof(l) + l;
+
+				return l;
+			}
+		}
+
+		// End of sector or bad header, continue in next sector
+		Pos = sect + vSectSize;
+	}
+
+	return -1;
+}
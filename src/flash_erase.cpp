@@ -0,0 +1,231 @@
+/**-------------------------------------------------------------------------
+@file	flash_erase.cpp
+
+@brief	Background erase manager for raw NOR flash
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "atomic.h"
+#include "flash_erase.h"
+
+FlashEraseMgr::FlashEraseMgr()
+{
+	vpFlash = NULL;
+	vStartBlk = 0;
+	vNbBlk = 0;
+	vPoolSize = 0;
+	vpState = NULL;
+	vErasing = -1;
+	vNbErased = 0;
+	vNbDirty = 0;
+	vDirtyCur = 0;
+	vErasedCur = 0;
+	vWaitCnt = 0;
+	vbLock = false;
+}
+
+bool FlashEraseMgr::Init(const FLASHERASE_CFG &Cfg, FlashDiskIO * const pFlash, Timer * const pTimer)
+{
+	if (pFlash == NULL || Cfg.pMem == NULL || Cfg.NbBlk == 0 || Cfg.MemSize < FLASHERASE_MEMSIZE(Cfg.NbBlk) ||
+		Cfg.StartBlk + Cfg.NbBlk > pFlash->GetSize() / pFlash->GetMinEraseSize())
+		return false;
+
+	vpFlash = pFlash;
+	vStartBlk = Cfg.StartBlk;
+	vNbBlk = Cfg.NbBlk;
+	vPoolSize = Cfg.PoolSize > 0 ? Cfg.PoolSize : Cfg.NbBlk;
+	vpState = (uint8_t*)Cfg.pMem;
+	vErasing = -1;
+	vNbErased = 0;
+	vNbDirty = 0;
+	vDirtyCur = 0;
+	vErasedCur = 0;
+	vWaitCnt = 0;
+	vbLock = false;
+
+	memset(vpState, FLASHERASE_BLK_USED, vNbBlk);
+
+	if (pTimer != NULL && Cfg.Period > 0)
+	{
+		if (pTimer->EnableTimerTrigger(Cfg.TimerTrigNo, Cfg.Period, TIMER_TRIG_TYPE_CONTINUOUS,
+									   TimerHandler, this) == 0)
+			return false;
+	}
+
+	return true;
+}
+
+void FlashEraseMgr::TimerHandler(Timer * const pTimer, int TrigNo, void * const pCtx)
+{
+	(void)pTimer; (void)TrigNo;
+
+	((FlashEraseMgr*)pCtx)->Run();
+}
+
+/**
+ * Round robin search so that released blocks are erased and reused in turn
+ */
+int FlashEraseMgr::Find(uint8_t State, uint32_t &Cursor)
+{
+	for (uint32_t i = 0; i < vNbBlk; i++)
+	{
+		uint32_t blk = (Cursor + i) % vNbBlk;
+
+		if (vpState[blk] == State)
+		{
+			Cursor = (blk + 1) % vNbBlk;
+
+			return blk;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Erase in progress is complete once the device is ready.  A suspended erase
+ * keeps the device busy.
+ */
+void FlashEraseMgr::Update()
+{
+	if (vErasing >= 0 && vpFlash->IsBusy() == false)
+	{
+		vpState[vErasing] = FLASHERASE_BLK_ERASED;
+		vNbErased++;
+		vErasing = -1;
+	}
+}
+
+void FlashEraseMgr::Release(uint32_t BlkNo, bool bErased)
+{
+	if (vpFlash == NULL || BlkNo < vStartBlk || BlkNo >= vStartBlk + vNbBlk)
+		return;
+
+	uint32_t blk = BlkNo - vStartBlk;
+
+	while (AtomicTestAndSet(&vbLock));
+
+	if (vpState[blk] == FLASHERASE_BLK_USED)
+	{
+		if (bErased)
+		{
+			vpState[blk] = FLASHERASE_BLK_ERASED;
+			vNbErased++;
+		}
+		else
+		{
+			vpState[blk] = FLASHERASE_BLK_DIRTY;
+			vNbDirty++;
+		}
+	}
+
+	AtomicClear(&vbLock);
+}
+
+int FlashEraseMgr::Acquire(bool bWait)
+{
+	if (vpFlash == NULL)
+		return -1;
+
+	while (AtomicTestAndSet(&vbLock));
+
+	Update();
+
+	int blk = Find(FLASHERASE_BLK_ERASED, vErasedCur);
+
+	if (blk < 0 && bWait)
+	{
+		if (vErasing >= 0)
+		{
+			uint8_t d;
+
+			// Reading the block being erased waits for the erase to complete
+			vWaitCnt++;
+			vpFlash->ReadData((vStartBlk + vErasing) * vpFlash->GetMinEraseSize(), &d, 1);
+			Update();
+			blk = Find(FLASHERASE_BLK_ERASED, vErasedCur);
+		}
+		else if (vNbDirty > 0)
+		{
+			int dirty = Find(FLASHERASE_BLK_DIRTY, vDirtyCur);
+
+			// Nothing being erased, erase one block and wait for it
+			vWaitCnt++;
+			if (vpFlash->EraseBlock(vStartBlk + dirty, 1))
+			{
+				vpState[dirty] = FLASHERASE_BLK_ERASED;
+				vNbDirty--;
+				vNbErased++;
+				blk = dirty;
+			}
+		}
+	}
+
+	if (blk >= 0)
+	{
+		vpState[blk] = FLASHERASE_BLK_USED;
+		vNbErased--;
+	}
+
+	AtomicClear(&vbLock);
+
+	return blk < 0 ? -1 : (int)(vStartBlk + blk);
+}
+
+/**
+ * Flash accesses are not reentrant, nothing is done while one is ongoing or
+ * while the block state is being updated
+ */
+void FlashEraseMgr::Run()
+{
+	if (vpFlash == NULL || vpFlash->InUse() || AtomicTestAndSet(&vbLock))
+		return;
+
+	Update();
+
+	if (vErasing < 0 && vNbDirty > 0 && vNbErased < (int)vPoolSize)
+	{
+		int blk = Find(FLASHERASE_BLK_DIRTY, vDirtyCur);
+
+		if (vpFlash->EraseStart(vStartBlk + blk))
+		{
+			vpState[blk] = FLASHERASE_BLK_ERASING;
+			vNbDirty--;
+			vErasing = blk;
+		}
+		else
+		{
+			// Device busy, try again next time
+			vDirtyCur = blk;
+		}
+	}
+
+	AtomicClear(&vbLock);
+}
@@ -0,0 +1,493 @@
+/**-------------------------------------------------------------------------
+@file	flash_log.cpp
+
+@brief	Append only record store on raw NOR flash
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+
+#include "istddef.h"
+#include "crc.h"
+#include "flash_log.h"
+
+#define FLASHLOG_CHUNK		32		// Bytes read at once when checking record past user buffer
+
+FlashLog::FlashLog()
+{
+	vpFlash = NULL;
+	vSegSize = 0;
+	vPageSize = 0;
+	vMaxRecLen = 0;
+	vNbSeg = 0;
+	vNbUsed = 0;
+	vHead = 0;
+	vHeadSeq = 0;
+	vWrOff = 0;
+	vbNextErased = false;
+	vpSeg = NULL;
+	vpPage = NULL;
+}
+
+bool FlashLog::Init(const FLASHLOG_CFG &Cfg, FlashDiskIO * const pFlash)
+{
+	if (pFlash == NULL || Cfg.pMem == NULL || Cfg.NbSeg < 2)
+		return false;
+
+	vpFlash = pFlash;
+	vSegSize = pFlash->GetMinEraseSize();
+	vPageSize = pFlash->GetMinWriteSize();
+	vStartBlk = Cfg.StartBlk;
+	vNbSeg = Cfg.NbSeg;
+
+	if (vSegSize < vPageSize || vSegSize < 2 * (sizeof(FLASHLOG_SEGHDR) + sizeof(FLASHLOG_RECHDR)) ||
+		vStartBlk + vNbSeg > pFlash->GetSize() / vSegSize)
+		return false;
+
+	if (vNbSeg * sizeof(FLASHLOG_SEGINFO) + vPageSize > Cfg.MemSize)
+		return false;
+
+	// Record fits in a segment, length 0xFFFF is erased flash
+	vMaxRecLen = min(vSegSize - sizeof(FLASHLOG_SEGHDR) - sizeof(FLASHLOG_RECHDR), FLASHLOG_REC_BLANK - 1);
+	vpSeg = (FLASHLOG_SEGINFO*)Cfg.pMem;
+	vpPage = (uint8_t*)&vpSeg[vNbSeg];
+
+	return Mount();
+}
+
+/**
+ * Find newest segment from headers, segments in use precede it with
+ * consecutive sequence numbers.  Only the newest segment is scanned for the
+ * end of the log.
+ */
+bool FlashLog::Mount()
+{
+	FLASHLOG_SEGHDR hdr;
+	FLASHLOG_RECHDR rec;
+
+	vHead = vNbSeg - 1;
+	vHeadSeq = 0;
+	vNbUsed = 0;
+	vWrOff = vSegSize;
+	vbNextErased = false;
+
+	for (uint32_t seg = 0; seg < vNbSeg; seg++)
+	{
+		if (vpFlash->ReadData(SegAddr(seg), (uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr))
+			return false;
+
+		vpSeg[seg].Seq = 0;
+		vpSeg[seg].Time = hdr.Time;
+
+		if (hdr.Magic == FLASHLOG_MAGIC && hdr.Seq != 0 &&
+			hdr.Crc == crc32((uint8_t*)&hdr, offsetof(FLASHLOG_SEGHDR, Crc)))
+		{
+			vpSeg[seg].Seq = hdr.Seq;
+			if (hdr.Seq > vHeadSeq)
+			{
+				vHead = seg;
+				vHeadSeq = hdr.Seq;
+			}
+		}
+	}
+
+	if (vHeadSeq == 0)
+	{
+		// Empty log
+		return true;
+	}
+
+	vNbUsed = 1;
+	while (vNbUsed < vNbSeg && vpSeg[SegNo(vHeadSeq - vNbUsed)].Seq == vHeadSeq - vNbUsed)
+	{
+		vNbUsed++;
+	}
+
+	// Left over segments from before are free
+	for (uint32_t i = vNbUsed; i < vNbSeg; i++)
+	{
+		vpSeg[(vHead + vNbSeg - i) % vNbSeg].Seq = 0;
+	}
+
+	uint32_t addr = SegAddr(vHead);
+	uint32_t off = sizeof(FLASHLOG_SEGHDR);
+
+	while (off + sizeof(rec) <= vSegSize)
+	{
+		if (vpFlash->ReadData(addr + off, (uint8_t*)&rec, sizeof(rec)) != sizeof(rec))
+			return false;
+
+		if (rec.Len == FLASHLOG_REC_BLANK)
+			break;
+
+		off += RecSize(rec.Len);
+	}
+
+	vWrOff = min(off, vSegSize);
+
+	// Anything but erased flash after the last record, ie. a record header
+	// cut while programming, resume in a new segment
+	for (off = vWrOff; off < vSegSize; )
+	{
+		int l = min(vSegSize - off, vPageSize);
+
+		if (vpFlash->ReadData(addr + off, vpPage, l) != l)
+			return false;
+
+		for (int i = 0; i < l; i++)
+		{
+			if (vpPage[i] != 0xFF)
+			{
+				vWrOff = vSegSize;
+				return true;
+			}
+		}
+		off += l;
+	}
+
+	return true;
+}
+
+/**
+ * Start a new segment after the newest one, the oldest is dropped when all
+ * segments are in use.  Segment header is written with the time of the
+ * record that opens it
+ */
+bool FlashLog::OpenSeg(uint32_t Time)
+{
+	uint32_t seg = (vHead + 1) % vNbSeg;
+	FLASHLOG_SEGHDR hdr;
+
+	if (vNbUsed >= vNbSeg)
+	{
+		vpSeg[seg].Seq = 0;
+		vNbUsed--;
+	}
+
+	if (vbNextErased == false && vpFlash->EraseBlock(vStartBlk + seg, 1) == false)
+		return false;
+	vbNextErased = false;
+
+	hdr.Magic = FLASHLOG_MAGIC;
+	hdr.Seq = vHeadSeq + 1;
+	hdr.Time = Time;
+	hdr.Crc = crc32((uint8_t*)&hdr, offsetof(FLASHLOG_SEGHDR, Crc));
+
+	if (vpFlash->ProgramData(SegAddr(seg), (uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr))
+		return false;
+
+	vHead = seg;
+	vHeadSeq = hdr.Seq;
+	vNbUsed++;
+	vpSeg[seg].Seq = hdr.Seq;
+	vpSeg[seg].Time = Time;
+	vWrOff = sizeof(hdr);
+
+	return true;
+}
+
+/**
+ * Clear segment header signature, no erase needed.  Segment is erased when
+ * reused
+ */
+void FlashLog::Discard(uint32_t Seg)
+{
+	uint32_t d = 0;
+
+	vpFlash->ProgramData(SegAddr(Seg), (uint8_t*)&d, sizeof(d));
+	vpSeg[Seg].Seq = 0;
+}
+
+bool FlashLog::Append(uint32_t Time, const void *pData, int Len)
+{
+	FLASHLOG_RECHDR hdr;
+
+	if (vpFlash == NULL || Len < 0 || Len > GetMaxRecLen() || (Len > 0 && pData == NULL))
+		return false;
+
+	hdr.Len = Len;
+	hdr.Time = Time;
+	hdr.Crc = crc16_ccitt((uint8_t*)&hdr.Len, sizeof(hdr.Len), 0xFFFF);
+	hdr.Crc = crc16_ccitt((uint8_t*)&hdr.Time, sizeof(hdr.Time), hdr.Crc);
+	hdr.Crc = crc16_ccitt((uint8_t*)pData, Len, hdr.Crc);
+
+	if (vNbUsed == 0 || vWrOff + sizeof(hdr) + Len > vSegSize)
+	{
+		if (OpenSeg(Time) == false)
+			return false;
+	}
+
+	uint32_t addr = SegAddr(vHead) + vWrOff;
+	uint8_t *p = (uint8_t*)pData;
+	int hoff = 0;
+	int cnt = sizeof(hdr) + Len;
+
+	// Past the current segment whatever happens, a failed record is skipped
+	vWrOff = min(vWrOff + RecSize(Len), vSegSize);
+
+	while (cnt > 0)
+	{
+		int l = min(cnt, vPageSize - (addr % vPageSize));
+		uint8_t *s = p;
+
+		if (hoff < (int)sizeof(hdr))
+		{
+			// Page holding the header is gathered, one program per page
+			int n = min(l, sizeof(hdr) - hoff);
+
+			memcpy(vpPage, (uint8_t*)&hdr + hoff, n);
+			memcpy(vpPage + n, p, l - n);
+			hoff += n;
+			p += l - n;
+			s = vpPage;
+		}
+		else
+		{
+			p += l;
+		}
+
+		if (vpFlash->ProgramData(addr, s, l) != l)
+			return false;
+
+		addr += l;
+		cnt -= l;
+	}
+
+	return true;
+}
+
+void FlashLog::Sync()
+{
+	uint8_t d;
+
+	// Flash read waits for the pending program
+	if (vpFlash)
+		vpFlash->ReadData(SegAddr(vHead), &d, 1);
+}
+
+/**
+ * Move position to the next record header within used segments.  The header
+ * is not validated, only its length
+ */
+bool FlashLog::Locate(FLASHLOG_POS &Pos, FLASHLOG_RECHDR &Hdr)
+{
+	if (vNbUsed == 0)
+	{
+		Pos.Seq = 0;
+		Pos.Off = 0;
+
+		return false;
+	}
+
+	if (Pos.Seq < vHeadSeq - vNbUsed + 1)
+	{
+		Pos.Seq = vHeadSeq - vNbUsed + 1;
+		Pos.Off = sizeof(FLASHLOG_SEGHDR);
+	}
+
+	while (Pos.Seq <= vHeadSeq)
+	{
+		uint32_t end = Pos.Seq == vHeadSeq ? vWrOff : vSegSize;
+
+		if (Pos.Off + sizeof(Hdr) <= end)
+		{
+			uint32_t addr = SegAddr(SegNo(Pos.Seq)) + Pos.Off;
+
+			if (vpFlash->ReadData(addr, (uint8_t*)&Hdr, sizeof(Hdr)) != sizeof(Hdr))
+				return false;
+
+			if (Hdr.Len != FLASHLOG_REC_BLANK && Pos.Off + sizeof(Hdr) + Hdr.Len <= end)
+				return true;
+		}
+
+		Pos.Seq++;
+		Pos.Off = sizeof(FLASHLOG_SEGHDR);
+	}
+
+	// Stay at end of log, records appended later are read from there
+	Pos.Seq = vHeadSeq;
+	Pos.Off = vWrOff;
+
+	return false;
+}
+
+bool FlashLog::First(FLASHLOG_POS &Pos)
+{
+	FLASHLOG_RECHDR hdr;
+
+	Pos.Seq = 0;
+	Pos.Off = 0;
+
+	return Locate(Pos, hdr);
+}
+
+bool FlashLog::Seek(FLASHLOG_POS &Pos, uint32_t Time)
+{
+	FLASHLOG_RECHDR hdr;
+
+	if (vNbUsed == 0)
+		return First(Pos);
+
+	// Last segment starting before Time, earlier records of Time may be at
+	// its end
+	uint32_t lo = vHeadSeq - vNbUsed + 1;
+	uint32_t hi = vHeadSeq;
+
+	while (lo < hi)
+	{
+		uint32_t mid = lo + (hi - lo + 1) / 2;
+
+		if (vpSeg[SegNo(mid)].Time < Time)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	Pos.Seq = lo;
+	Pos.Off = sizeof(FLASHLOG_SEGHDR);
+
+	while (Locate(Pos, hdr))
+	{
+		if (hdr.Time >= Time)
+			return true;
+
+		Pos.Off += RecSize(hdr.Len);
+	}
+
+	return false;
+}
+
+int FlashLog::Read(FLASHLOG_POS &Pos, uint32_t *pTime, uint8_t *pBuff, int BuffLen)
+{
+	FLASHLOG_RECHDR hdr;
+
+	while (Locate(Pos, hdr))
+	{
+		uint32_t addr = SegAddr(SegNo(Pos.Seq)) + Pos.Off + sizeof(hdr);
+		int l = min(hdr.Len, max(BuffLen, 0));
+		uint16_t crc;
+
+		crc = crc16_ccitt((uint8_t*)&hdr.Len, sizeof(hdr.Len), 0xFFFF);
+		crc = crc16_ccitt((uint8_t*)&hdr.Time, sizeof(hdr.Time), crc);
+
+		if (l > 0)
+		{
+			if (vpFlash->ReadData(addr, pBuff, l) != l)
+				return -1;
+			crc = crc16_ccitt(pBuff, l, crc);
+		}
+
+		// Part not fitting user buffer is still checked
+		for (int i = l; i < hdr.Len; )
+		{
+			uint8_t d[FLASHLOG_CHUNK];
+			int n = min(hdr.Len - i, FLASHLOG_CHUNK);
+
+			if (vpFlash->ReadData(addr + i, d, n) != n)
+				return -1;
+			crc = crc16_ccitt(d, n, crc);
+			i += n;
+		}
+
+		Pos.Off += RecSize(hdr.Len);
+
+		if (crc == hdr.Crc)
+		{
+			if (pTime)
+				*pTime = hdr.Time;
+
+			return hdr.Len;
+		}
+	}
+
+	return -1;
+}
+
+int FlashLog::Trim(uint32_t Time)
+{
+	int cnt = 0;
+
+	// Records of a segment are not after the first record of the next one
+	while (vNbUsed > 1)
+	{
+		uint32_t tail = (vHead + vNbSeg - vNbUsed + 1) % vNbSeg;
+
+		if (vpSeg[(tail + 1) % vNbSeg].Time >= Time)
+			break;
+
+		Discard(tail);
+		vNbUsed--;
+		cnt++;
+	}
+
+	return cnt;
+}
+
+bool FlashLog::Prepare()
+{
+	if (vpFlash == NULL)
+		return false;
+
+	if (vbNextErased)
+		return true;
+
+	uint32_t seg = (vHead + 1) % vNbSeg;
+
+	if (vNbUsed >= vNbSeg)
+	{
+		vpSeg[seg].Seq = 0;
+		vNbUsed--;
+	}
+
+	if (vpFlash->EraseBlock(vStartBlk + seg, 1) == false)
+		return false;
+
+	vbNextErased = true;
+
+	return true;
+}
+
+void FlashLog::Erase()
+{
+	if (vpFlash == NULL)
+		return;
+
+	vpFlash->EraseBlock(vStartBlk, vNbSeg);
+
+	for (uint32_t i = 0; i < vNbSeg; i++)
+	{
+		vpSeg[i].Seq = 0;
+	}
+
+	vHead = vNbSeg - 1;
+	vHeadSeq = 0;
+	vNbUsed = 0;
+	vWrOff = vSegSize;
+	vbNextErased = true;
+}
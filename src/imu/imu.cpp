@@ -35,7 +35,12 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 ----------------------------------------------------------------------------*/
 
+#include <string.h>
+
+#include "idelay.h"
 #include "imu/imu.h"
+#include "sensors/sensor_calib.h"
+
 /*
 bool Imu::Init(const IMU_CFG &Cfg, uint32_t DevAddr, DeviceIntrf * const pIntrf, Timer * const pTimer)
 {
@@ -73,6 +78,67 @@ IMU_FEATURE Imu::Feature(IMU_FEATURE FeatureBit, bool bEnDis)
 	return vActiveFeature;
 }
 
+bool Imu::Calibrate()
+{
+	if (vpGyro == NULL)
+	{
+		return false;
+	}
+
+	// Keep current calibration to restore on failure
+	SENSOR_CALIB old = vpGyro->Calibration();
+	float coef[3];
+	float tref = vpGyro->TempRef();
+
+	memcpy(coef, vpGyro->TempCoef(), sizeof(coef));
 
+	// Samples must be uncalibrated
+	vpGyro->ClearCalibration();
 
+	// Poll at twice the sampling rate, a moving device times out
+	uint32_t period = vpGyro->SamplingPeriod() / 2000ULL;
+	uint64_t last = 0;
+	GyroCalib calib;
 
+	if (period == 0)
+	{
+		period = 1000;
+	}
+
+	for (int i = 0; i < IMU_CALIB_GYRO_SAMPLES * 8 && calib.SampleCount() < IMU_CALIB_GYRO_SAMPLES; i++)
+	{
+		GYROSENSOR_DATA d;
+
+		vpGyro->UpdateData();
+		if (vpGyro->Read(d) && d.Timestamp != last)
+		{
+			last = d.Timestamp;
+			calib.AddSample(d, vpGyro->Temperature());
+		}
+		usDelay(period);
+	}
+
+	if (calib.SampleCount() < IMU_CALIB_GYRO_SAMPLES || calib.Fit() == false)
+	{
+		vpGyro->SetCalibration(old, coef, tref);
+
+		return false;
+	}
+
+	const float *k = calib.TempCoef();
+
+	if (k[0] != 0 || k[1] != 0 || k[2] != 0)
+	{
+		calib.Apply(*vpGyro);
+	}
+	else
+	{
+		// Not enough temperature change to fit, keep previous coefficient
+		SENSOR_CALIB c;
+
+		calib.Calibration(calib.TempRef(), c);
+		vpGyro->SetCalibration(c, coef, calib.TempRef());
+	}
+
+	return true;
+}
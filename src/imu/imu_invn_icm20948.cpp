@@ -210,11 +210,6 @@ IMU_FEATURE ImuInvnIcm20948::Feature(IMU_FEATURE FeatureBit, bool bEnDis)
 	return Imu::Feature();
 }
 
-bool ImuInvnIcm20948::Calibrate()
-{
-	return true;
-}
-
 void ImuInvnIcm20948::SetAxisAlignmentMatrix(int8_t * const pMatrix)
 {
 }
@@ -497,6 +497,7 @@ bool ImuMpu9250::Init(const IMU_CFG &Cfg, AccelSensor * const pAccel, GyroSensor
 	}
 
 	vDmpFifoLen = 0;
+	vFifoIdx = 0;
 	vpMpu = (AgmMpu9250 *)pAccel;
 
     bool res = 	vpMpu->InitDMP(DMP_START_ADDR, (uint8_t*)s_DMPImage, DMP_CODE_SIZE);
@@ -541,9 +542,12 @@ bool ImuMpu9250::UpdateData()
 	//int fidx = 0;
 
 	int len = vpMpu->GetFifoLen();
-	if (len >= vDmpFifoLen)
+	if (len >= vDmpFifoLen && vDmpFifoLen > 0)
 	{
-		uint32_t t = ((Timer*)*vpMpu)->uSecond();
+		// Packets pending in FIFO, read time must follow the FIFO count
+		int pending = len / vDmpFifoLen;
+
+		vTsEst.Update((Timer*)*vpMpu, vFifoIdx + pending - vTsEst.SampleCount());
 
 		len = vpMpu->ReadFifo((uint8_t*)q, 16);
 		if (len > 0)
@@ -570,6 +574,8 @@ bool ImuMpu9250::UpdateData()
 				if (ValidateQuat(q) == false)
 				{
 					vpMpu->ResetFifo();
+					vTsEst.Reset();
+					vFifoIdx = 0;
 
 					return false;
 				}
@@ -578,9 +584,11 @@ bool ImuMpu9250::UpdateData()
 				vQuat.Q2 = (float)q[1] / (1<<30);
 				vQuat.Q3 = (float)q[2] / (1<<30);
 				vQuat.Q4 = (float)q[3] / (1<<30);
-				vQuat.Timestamp = t;
+				vQuat.Timestamp = vTsEst.SampleTime(vFifoIdx);
 			}
 
+			vFifoIdx++;
+
 			return true;
 		}
 	}
@@ -625,12 +633,10 @@ uint32_t ImuMpu9250::Rate(uint32_t DataRate)
 	Write(D_0_22, d, 2);
 	Write(CFG_6, (uint8_t*)cfg, sizeof(cfg));
 
-	return Imu::Rate(DataRate * 1000);
-}
+	// DMP packet period for time stamp estimation
+	vTsEst.Init(1000000000ULL * (div + 1) / DMP_SAMPLE_RATE);
 
-bool ImuMpu9250::Calibrate()
-{
-	return true;
+	return Imu::Rate(DataRate * 1000);
 }
 
 bool ImuMpu9250::Compass(bool bEn)
@@ -40,15 +40,32 @@ Modified by          Date              Description
 
 static inline int SDRx(SDDEV *pDev, uint8_t *pData, int DataLen)
 {
-	return SerialIntrfRx(pDev->pSerIntrf, 0, pData, DataLen);
+	return DeviceIntrfRx(pDev->pSerIntrf, 0, pData, DataLen);
 }
 
 static inline int SDTx(SDDEV *pDev, uint8_t *pData, int DataLen)
 {
-	return SerialIntrfTx(pDev->pSerIntrf, 0, pData, DataLen);
+	return DeviceIntrfTx(pDev->pSerIntrf, 0, pData, DataLen);
 }
 
-bool SDInit(SDDEV *pDev, SDCFG *pCfg)
+// Card holds data line low while busy.  A first byte is polled alone, busy
+// is then polled by windows.  Bytes clocked after end of busy are 0xff.
+static void SDWaitBusy(SDDEV *pDev)
+{
+	uint8_t d[SDCARD_TOKEN_WIN];
+	int t = 1000000 / SDCARD_TOKEN_WIN;
+	int n = 1;
+
+	SDRx(pDev, d, 1);
+
+	while (d[n - 1] == 0 && --t > 0)
+	{
+		n = SDCARD_TOKEN_WIN;
+		SDRx(pDev, d, n);
+	}
+}
+
+bool SDInit(SDDEV * const pDev, const SDCFG *pCfg)
 {
 	if (pDev == NULL || pCfg == NULL)
 		return false;
@@ -114,50 +131,28 @@ bool SDInit(SDDEV *pDev, SDCFG *pCfg)
 		do {
 			r = SDCmd(pDev, 1, 0);
 		} while (r != 0 && --i > 0);
-	}
 
-	if (r == 0)
-	{
-		// Read OCR
-		r = SDCmd(pDev, 58, 0x0000000);
-		i = SDGetResponse(pDev, data, 5);
-//		printf("CMD8 r = %02x, data = 0x%08x, len = %d\n\r", r, *(uint32_t*)data, i);
+		if (r != 0)
+		{
+			return false;
+		}
 	}
 
-	return true;
-}
-/*
-uint8_t SDCmdCrc(uint8_t *pData)
-{
-	uint8_t i, e, f, crc;
+	// Read OCR
+	r = SDCmd(pDev, 58, 0x0000000);
+	i = SDGetResponse(pDev, data, 5);
+//	printf("CMD8 r = %02x, data = 0x%08x, len = %d\n\r", r, *(uint32_t*)data, i);
 
-	crc = 0;
-	for (i = 0; i < 5; i++)
-	{
-		e = crc ^ pData[i];
-		f = e ^ (e >> 4) ^ (e >> 7);
-		crc = (f << 1) ^ (f << 4);
-	}
-	return crc;
-}
+	// Card checks CRC once enabled.  Disabled by default in SPI mode
+	pDev->bCrc = pCfg->bNoCrc == false;
+	SDCmd(pDev, 59, pDev->bCrc ? 1 : 0);
 
-uint16_t crc16(uint8_t *pData, int len)
-{
-	uint8_t  s, t;
-	uint16_t crc;
-	int i;
+	pDev->SectSize = 512;
+	pDev->TotalSect = SDGetSize(pDev) * 2;
 
-	crc = 0;
-	for (i = 0; i < len; i++)
-	{
-		s = pData[i] ^ (crc >> 8);
-		t = s ^ (s >> 4);
-		crc = (crc << 8) ^ t ^ (t << 5) ^ (t << 12);
-	}
-
-	return crc;
+	return true;
 }
-*/
+
 /*
 	Send command to SD card
 
@@ -167,12 +162,14 @@ uint16_t crc16(uint8_t *pData, int len)
 
 	@return int responses code R1
 */
-int SDCmd(SDDEV *pDev, uint8_t Cmd, uint32_t param)
+int SDCmd(SDDEV * const pDev, uint8_t Cmd, uint32_t param)
 {
 	int t;
 	uint8_t data[7];
 	uint8_t r;
 
+	SDWaitBusy(pDev);
+
 	memset(data, 0, sizeof(data));
 
 	// Fill cmd buffer
@@ -181,13 +178,17 @@ int SDCmd(SDDEV *pDev, uint8_t Cmd, uint32_t param)
 	data[2] = (param >> 16) & 0xff;
 	data[3] = (param >> 8) & 0xff;
 	data[4] = param & 0xff;
-	data[5] = crc8(data, 5) | 1; // SDCmdCrc(data) | 1;
+	data[5] = crc8_ccitt(data, 5, 0) | 1;
 	data[6] = 0xff;
 
 	// Send command
 	//LpcSSPTx(pDev->pSspDev, 0, data, 6);
 	SDTx(pDev, data, 6);
 
+	// CMD12 is sent while card is still sending data, skip the stuff byte
+	if (Cmd == 12)
+		SDRx(pDev, &r, 1);
+
 	// wait for response
 	t = 100000;
 	do {
@@ -208,7 +209,7 @@ int SDCmd(SDDEV *pDev, uint8_t Cmd, uint32_t param)
 
 	@return	total length (bytes) if succeeded
 */
-int SDGetResponse(SDDEV *pDev, uint8_t *pData, int Len)
+int SDGetResponse(SDDEV * const pDev, uint8_t *pData, int Len)
 {
 	if (pData == NULL)
 		return 0;
@@ -216,63 +217,65 @@ int SDGetResponse(SDDEV *pDev, uint8_t *pData, int Len)
 	return SDRx(pDev, pData, Len);
 }
 
-int SDReadData(SDDEV *pDev, uint8_t *pData, int Len)
+int SDReadData(SDDEV * const pDev, uint8_t *pData, int Len)
 {
-	int timeout, cnt, crc, calccrc;
-	uint8_t d;
+	uint8_t win[SDCARD_TOKEN_WIN];
+	uint8_t crc[2];
+	int i, n, cnt, ncrc;
 
 	if (pData == NULL || Len <= 0)
 		return 0;
 
-	timeout = 100000;
-
-	d = 0xff;
+	// Window never goes past the block CRC
+	int wlen = min(SDCARD_TOKEN_WIN, Len + 3);
+	int timeout = 100000 / wlen;
 
 	do {
-		cnt = SDRx(pDev, &d, 1);
-	} while (d != 0xfe && --timeout > 0 );
+		n = SDRx(pDev, win, wlen);
+		for (i = 0; i < n && win[i] == 0xff; i++);
+	} while (i >= n && --timeout > 0);
 
-	if (timeout <= 0)
+	if (i >= n)
 		return -1;
 
-	if (d != 0xfe)
+	if (win[i] != 0xfe)
 	{
-		pData[0] = d;
+		// Error token
+		pData[0] = win[i];
 		return -1;
 	}
 
-	cnt = 0;
-	d = 0xff;
+	// Bytes following the token are data then CRC
+	i++;
+	cnt = min(n - i, Len);
+	ncrc = n - i - cnt;
 
-	cnt = SDRx(pDev, pData, Len);
+	memcpy(pData, &win[i], cnt);
+	memcpy(crc, &win[i + cnt], ncrc);
 
-	calccrc = crc16(pData, cnt);
-	//printf("Calc CRC : %04x\n\r", calccrc);
+	if (cnt < Len)
+		cnt += SDRx(pDev, pData + cnt, Len - cnt);
 
-	if (cnt <= Len)
-	{
-		crc = 0;
-		SDRx(pDev, (uint8_t*)&crc, 1);
-		crc <<= 8;
-		SDRx(pDev, &d, 1);
-		crc |= d;
-	}
-	if (crc != calccrc)
+	if (ncrc < 2)
+		SDRx(pDev, &crc[ncrc], 2 - ncrc);
+
+	if (pDev->bCrc && crc16_ccitt(pData, cnt, 0) != (((uint16_t)crc[0] << 8) | crc[1]))
 		return -2;
 
 	return cnt;
 }
 
-int SDWriteData(SDDEV *pDev, uint8_t *pData, int Len)
+// Send data block with start token, then wait for data response and end of busy
+static int SDWriteToken(SDDEV *pDev, uint8_t *pData, int Len, uint8_t Token)
 {
 	int i;
 	uint16_t crc;
-	uint8_t d[2] = { 0xff, 0xfe };
+	uint8_t d[2] = { 0xff, Token };
 
 	if (pData == NULL)
 		return -1;
 
-	crc = crc16(pData, Len);
+	crc = pDev->bCrc ? crc16_ccitt(pData, Len, 0) : 0xffff;
 
 
 	SDTx(pDev, d, 2);
@@ -294,13 +297,7 @@ int SDWriteData(SDDEV *pDev, uint8_t *pData, int Len)
 
 	if ((d[0] & 0xe) == 0x4)
 	{
-		t = 100000;
-
-		do {
-			SDRx(pDev, d, 1);
-			if (d[0] != 0)
-				break;
-		} while (t-- > 0);
+		SDWaitBusy(pDev);
 
 		return i;
 	}
@@ -308,7 +305,12 @@ int SDWriteData(SDDEV *pDev, uint8_t *pData, int Len)
 	return 0;
 }
 
-uint32_t SDGetSize(SDDEV *pDev)
+int SDWriteData(SDDEV * const pDev, uint8_t *pData, int Len)
+{
+	return SDWriteToken(pDev, pData, Len, 0xfe);
+}
+
+uint32_t SDGetSize(SDDEV * const pDev)
 {
 	uint8_t data[20];
 	uint32_t size = 0;
@@ -335,15 +337,15 @@ uint32_t SDGetSize(SDDEV *pDev)
 	else
 	{
 		// Vers 2.0
-		// Bits 48-69
-		size = (uint64_t)(((data[7] & 0x3f) << 16u) | (data[8] << 8u) | data[9]) * 512;
+		// Bits 48-69, (C_SIZE + 1) * 512KB
+		size = ((uint64_t)(((data[7] & 0x3f) << 16u) | (data[8] << 8u) | data[9]) + 1) * 512;
 	}
 
 	return size;
 }
 
 
-int SDReadSingleBlock(SDDEV *pDev, uint32_t Addr, uint8_t *pData, int len)
+int SDReadSingleBlock(SDDEV * const pDev, uint32_t Addr, uint8_t *pData, int len)
 {
 	if (pData)
 	{
@@ -354,7 +356,7 @@ int SDReadSingleBlock(SDDEV *pDev, uint32_t Addr, uint8_t *pData, int len)
 	return 0;
 }
 
-int SDWriteSingleBlock(SDDEV *pDev, uint32_t Addr, uint8_t *pData, int Len)
+int SDWriteSingleBlock(SDDEV * const pDev, uint32_t Addr, uint8_t *pData, int Len)
 {
 	if (pData)
 	{
@@ -367,3 +369,60 @@ int SDWriteSingleBlock(SDDEV *pDev, uint32_t Addr, uint8_t *pData, int Len)
 	return 0;
 }
 
+int SDReadMultiBlock(SDDEV * const pDev, uint32_t Addr, uint8_t *pData, int NbBlk)
+{
+	int cnt = 0;
+
+	if (pData == NULL || NbBlk <= 0)
+		return 0;
+
+	if (SDCmd(pDev, 18, Addr) != 0)
+		return 0;
+
+	while (cnt < NbBlk)
+	{
+		if (SDReadData(pDev, pData, pDev->SectSize) != pDev->SectSize)
+			break;
+		pData += pDev->SectSize;
+		cnt++;
+	}
+
+	// Stop transmission, busy is handled by next command
+	SDCmd(pDev, 12, 0);
+
+	return cnt;
+}
+
+int SDWriteMultiBlock(SDDEV * const pDev, uint32_t Addr, uint8_t *pData, int NbBlk)
+{
+	int cnt = 0;
+	uint8_t d;
+
+	if (pData == NULL || NbBlk <= 0)
+		return 0;
+
+	// Let the card erase all blocks ahead of writing them (ACMD23
+	// SET_WR_BLK_ERASE_COUNT).  It is only a hint, failure is ignored
+	if (SDCmd(pDev, 55, 0) == 0)
+		SDCmd(pDev, 23, NbBlk);
+
+	if (SDCmd(pDev, 25, Addr) != 0)
+		return 0;
+
+	while (cnt < NbBlk)
+	{
+		// Multiple block write start token, returns once block is programmed
+		if (SDWriteToken(pDev, pData, pDev->SectSize, 0xfc) != pDev->SectSize)
+			break;
+		pData += pDev->SectSize;
+		cnt++;
+	}
+
+	// Stop transmission token, skip one byte then wait for busy
+	d = 0xfd;
+	SDTx(pDev, &d, 1);
+	SDRx(pDev, &d, 1);
+	SDWaitBusy(pDev);
+
+	return cnt;
+}
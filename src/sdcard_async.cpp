@@ -0,0 +1,291 @@
+/**-------------------------------------------------------------------------
+@file	sdcard_async.cpp
+
+@brief	Non-blocking SD card block request queue
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <stddef.h>
+
+#include "istddef.h"
+#include "sdcard_async.h"
+
+/// Protocol phases of the request in progress
+#define SDCARDASYNC_PH_IDLE		0	//!< Next request not started, card may be busy
+#define SDCARDASYNC_PH_TOKEN	1	//!< Waiting for read data token
+#define SDCARDASYNC_PH_DATA		2	//!< Ready to send write block
+#define SDCARDASYNC_PH_BUSY		3	//!< Waiting for block program
+
+SDCardAsync::SDCardAsync()
+{
+	vpCard = NULL;
+	vpQue = NULL;
+	vQueSize = 0;
+	vHead = 0;
+	vTail = 0;
+	vSectSize = 0;
+	vPhase = SDCARDASYNC_PH_IDLE;
+	vOp = SDCARDASYNC_OP_READ;
+	vbMulti = false;
+	vStreamLeft = 0;
+	vBlkIdx = 0;
+	vPollCnt = 0;
+}
+
+bool SDCardAsync::Init(const SDCARDASYNC_CFG &Cfg, SDCard * const pCard)
+{
+	if (pCard == NULL || Cfg.pReqMem == NULL || Cfg.NbReq <= 0)
+		return false;
+
+	vSectSize = pCard->GetSectSize();
+	if (vSectSize <= 0)
+		return false;
+
+	vpCard = pCard;
+	vpQue = Cfg.pReqMem;
+	vQueSize = Cfg.NbReq;
+	vHead = 0;
+	vTail = 0;
+	vPhase = SDCARDASYNC_PH_IDLE;
+	vPollCnt = 0;
+
+	return true;
+}
+
+bool SDCardAsync::Submit(const SDCARDASYNC_REQ &Req)
+{
+	if (vpQue == NULL || Req.pData == NULL || Req.NbBlk <= 0)
+		return false;
+
+	if (Req.Op != SDCARDASYNC_OP_READ && Req.Op != SDCARDASYNC_OP_WRITE)
+		return false;
+
+	uint32_t tail = vTail;
+
+	if ((int)(tail - vHead) >= vQueSize)
+		return false;
+
+	vpQue[tail % vQueSize] = Req;
+
+	// Entry is filled before it is seen by Process
+	__asm__ __volatile__("" ::: "memory");
+	vTail = tail + 1;
+
+	return true;
+}
+
+// Blocks of the contiguous requests of same direction from the head of queue
+uint32_t SDCardAsync::StreamLen()
+{
+	SDCARDASYNC_REQ *req = &vpQue[vHead % vQueSize];
+	uint32_t next = req->Addr + req->NbBlk;
+	uint32_t nblk = req->NbBlk;
+
+	for (uint32_t i = vHead + 1; i != vTail; i++)
+	{
+		req = &vpQue[i % vQueSize];
+		if (req->Op != vOp || req->Addr != next)
+			break;
+		next += req->NbBlk;
+		nblk += req->NbBlk;
+	}
+
+	return nblk;
+}
+
+void SDCardAsync::Start()
+{
+	SDCARDASYNC_REQ *req = &vpQue[vHead % vQueSize];
+	int r;
+
+	vOp = req->Op;
+	vBlkIdx = 0;
+
+	uint32_t nblk = StreamLen();
+
+	vbMulti = nblk > 1;
+	vStreamLeft = nblk;
+
+	if (vOp == SDCARDASYNC_OP_READ)
+	{
+		r = vpCard->Cmd(vbMulti ? 18 : 17, req->Addr);
+	}
+	else
+	{
+		// Pre-erase hint, failure is ignored
+		if (vbMulti && vpCard->Cmd(55, 0) == 0)
+			vpCard->Cmd(23, nblk);
+		r = vpCard->Cmd(vbMulti ? 25 : 24, req->Addr);
+	}
+
+	if (r != 0)
+	{
+		vbMulti = false;
+		Complete(0);
+		return;
+	}
+
+	vPhase = vOp == SDCARDASYNC_OP_READ ? SDCARDASYNC_PH_TOKEN : SDCARDASYNC_PH_DATA;
+}
+
+// Request in progress has one more block done
+void SDCardAsync::NextBlock()
+{
+	SDCARDASYNC_REQ *req = &vpQue[vHead % vQueSize];
+
+	vBlkIdx++;
+	vStreamLeft--;
+
+	if (vBlkIdx < req->NbBlk)
+	{
+		vPhase = vOp == SDCARDASYNC_OP_READ ? SDCARDASYNC_PH_TOKEN : SDCARDASYNC_PH_DATA;
+		return;
+	}
+
+	uint32_t next = req->Addr + req->NbBlk;
+
+	Complete(vBlkIdx);
+
+	// Read stream continues into the next request when it follows, including
+	// one submitted from the completion callback.  Write stream ends with its
+	// pre-erased blocks, a new stream is pre-erased for the requests queued
+	if (vbMulti && vHead != vTail && (vOp == SDCARDASYNC_OP_READ || vStreamLeft > 0))
+	{
+		req = &vpQue[vHead % vQueSize];
+		if (req->Op == vOp && req->Addr == next)
+		{
+			vBlkIdx = 0;
+			vPhase = vOp == SDCARDASYNC_OP_READ ? SDCARDASYNC_PH_TOKEN : SDCARDASYNC_PH_DATA;
+			return;
+		}
+	}
+
+	Stop();
+}
+
+// End current stream, busy after stop is handled when next request starts
+void SDCardAsync::Stop()
+{
+	if (vbMulti)
+	{
+		if (vOp == SDCARDASYNC_OP_READ)
+			vpCard->Cmd(12, 0);
+		else
+			vpCard->StopTran();
+	}
+	vbMulti = false;
+	vPhase = SDCARDASYNC_PH_IDLE;
+}
+
+// Remove request in progress from queue then notify.  The entry is released
+// first so that the callback can submit again
+void SDCardAsync::Complete(int Result)
+{
+	SDCARDASYNC_REQ req = vpQue[vHead % vQueSize];
+
+	vHead = vHead + 1;
+	vPhase = SDCARDASYNC_PH_IDLE;
+	vPollCnt = 0;
+
+	if (req.CompleteCB)
+		req.CompleteCB(&req, Result);
+}
+
+bool SDCardAsync::Process()
+{
+	if (vpCard == NULL)
+		return false;
+
+	SDCARDASYNC_REQ *req = &vpQue[vHead % vQueSize];
+	int res;
+
+	switch (vPhase)
+	{
+		case SDCARDASYNC_PH_IDLE:
+			if (vHead == vTail)
+				return false;
+
+			// Card may still be programming from previous stream
+			if (vpCard->IsBusy())
+			{
+				if (++vPollCnt < SDCARDASYNC_POLL_MAX)
+					return true;
+			}
+			vPollCnt = 0;
+			Start();
+			break;
+
+		case SDCARDASYNC_PH_TOKEN:
+			res = vpCard->PollData(req->pData + vBlkIdx * vSectSize, vSectSize);
+			if (res == 0 && ++vPollCnt < SDCARDASYNC_POLL_MAX)
+				return true;
+
+			vPollCnt = 0;
+			if (res == vSectSize)
+			{
+				NextBlock();
+			}
+			else
+			{
+				// Token timeout, error token or CRC error
+				Complete(vBlkIdx);
+				Stop();
+			}
+			break;
+
+		case SDCARDASYNC_PH_DATA:
+			res = vpCard->WriteData(req->pData + vBlkIdx * vSectSize, vSectSize,
+									vbMulti ? 0xfc : 0xfe);
+			if (res == vSectSize)
+			{
+				vPhase = SDCARDASYNC_PH_BUSY;
+			}
+			else
+			{
+				Complete(vBlkIdx);
+				Stop();
+			}
+			break;
+
+		case SDCARDASYNC_PH_BUSY:
+			if (vpCard->IsBusy())
+			{
+				if (++vPollCnt < SDCARDASYNC_POLL_MAX)
+					return true;
+
+				Complete(vBlkIdx);
+				Stop();
+				break;
+			}
+			vPollCnt = 0;
+			NextBlock();
+			break;
+	}
+
+	return vPhase != SDCARDASYNC_PH_IDLE || vHead != vTail;
+}
@@ -43,6 +43,7 @@ Modified by          Date              Description
 SDCard::SDCard()
 {
 	memset(vCacheDesc, 0, sizeof(vCacheDesc));
+	vbCrc = true;
 }
 
 SDCard::~SDCard()
@@ -81,7 +82,7 @@ bool SDCard::Init(DeviceIntrf * const pDevInterf, uint8_t *  const pCacheMem, in
 
 bool SDCard::Init(DeviceIntrf * const pDevInterf, DISKIO_CACHE_DESC * const pCacheBlk, int NbCacheBlk)
 {
-	uint8_t data[4];
+	uint8_t data[8];
 	uint16_t r = 0xffff;
 	//vpInterf = std::shared_ptr<SerialIntrf>(pSerInterf);
 	vpInterf = pDevInterf;
@@ -165,6 +166,8 @@ bool SDCard::Init(DeviceIntrf * const pDevInterf, DISKIO_CACHE_DESC * const pCac
 		i = GetResponse(data, 5);
 	}
 
+	Crc(true);
+
 	vDev.SectSize = 512;		// Default always
 	vDev.TotalSect = GetSize() * 1024LL / vDev.SectSize;
 
@@ -175,17 +178,40 @@ bool SDCard::Init(DeviceIntrf * const pDevInterf, DISKIO_CACHE_DESC * const pCac
 	return true;
 }
 
+// Card holds data line low while busy.  A first byte is polled alone, busy
+// is then polled by windows.  Bytes clocked after end of busy are 0xff.
+void SDCard::WaitBusy()
+{
+	uint8_t d[SDCARD_TOKEN_WIN];
+	int t = 1000000 / SDCARD_TOKEN_WIN;
+	int n = 1;
+
+	vpInterf->Rx(0, d, 1);
+
+	while (d[n - 1] == 0 && --t > 0)
+	{
+		n = SDCARD_TOKEN_WIN;
+		vpInterf->Rx(0, d, n);
+	}
+}
+
+bool SDCard::Crc(bool bEnable)
+{
+	if (Cmd(59, bEnable ? 1 : 0) != 0)
+		return false;
+
+	vbCrc = bEnable;
+
+	return true;
+}
+
 int SDCard::Cmd(uint8_t Cmd, uint32_t param)
 {
 	int t;
 	uint8_t data[8];
 	uint8_t r;
 
-	// wait for busy
-	t = 1000000;
-	do {
-		vpInterf->Rx(0, &r, 1);
-	} while (r == 0 && --t > 0);
+	WaitBusy();
 
 	memset(data, 0, sizeof(data));
 
@@ -201,6 +227,10 @@ int SDCard::Cmd(uint8_t Cmd, uint32_t param)
 	// Send command
 	vpInterf->Tx(0, data, 6);
 
+	// CMD12 is sent while card is still sending data, skip the stuff byte
+	if (Cmd == 12)
+		vpInterf->Rx(0, &r, 1);
+
 	// wait for response
 	t = 100000;
 	do {
@@ -219,63 +249,93 @@ int SDCard::GetResponse(uint8_t *pBuff, int BuffLen)
 	return cnt;
 }
 
-int SDCard::ReadData(uint8_t *pBuff, int BuffLen)
+bool SDCard::IsBusy()
 {
-	int timeout, cnt, crc, calccrc;
 	uint8_t d;
 
-	if (pBuff == NULL)
+	vpInterf->Rx(0, &d, 1);
+
+	return d == 0;
+}
+
+void SDCard::StopTran()
+{
+	uint8_t d = 0xfd;
+
+	vpInterf->Tx(0, &d, 1);
+
+	// Skip one byte, busy follows
+	vpInterf->Rx(0, &d, 1);
+}
+
+int SDCard::ReadData(uint8_t *pBuff, int BuffLen)
+{
+	if (pBuff == NULL || BuffLen <= 0)
 		return 0;
 
-	timeout = 1000000;
+	int timeout = 1000000 / min(SDCARD_TOKEN_WIN, BuffLen + 3);
+	int cnt;
 
 	do {
-		vpInterf->Rx(0, &d, 1);
-	} while (d != 0xfe && --timeout > 0 );
+		cnt = PollData(pBuff, BuffLen);
+	} while (cnt == 0 && --timeout > 0);
+
+	return cnt == 0 ? -1 : cnt;
+}
 
-	if (timeout <= 0)
+int SDCard::PollData(uint8_t *pBuff, int BuffLen)
+{
+	uint8_t win[SDCARD_TOKEN_WIN];
+	uint8_t crc[2];
+	int i, n;
+
+	if (pBuff == NULL || BuffLen <= 0)
 		return -1;
 
-	if (d != 0xfe)
+	// Window never goes past the block CRC
+	n = vpInterf->Rx(0, win, min(SDCARD_TOKEN_WIN, BuffLen + 3));
+	for (i = 0; i < n && win[i] == 0xff; i++);
+
+	if (i >= n)
+		return 0;
+
+	if (win[i] != 0xfe)
 	{
-		pBuff[0] = d;
+		// Error token
+		pBuff[0] = win[i];
 		return -1;
 	}
 
-	cnt = 0;
+	// Bytes following the token are data then CRC
+	i++;
+	int cnt = min(n - i, BuffLen);
+	int ncrc = n - i - cnt;
 
-	d = 0xff;
-	cnt = vpInterf->Rx(0, pBuff, BuffLen);
+	memcpy(pBuff, &win[i], cnt);
+	memcpy(crc, &win[i + cnt], ncrc);
 
-	calccrc = crc16_ccitt(pBuff, cnt, 0);
+	if (cnt < BuffLen)
+		cnt += vpInterf->Rx(0, pBuff + cnt, BuffLen - cnt);
 
-	if (cnt <= BuffLen)
-	{
-		crc = 0;
-		vpInterf->Rx(0, (uint8_t*)&crc, 2);
-		d = (crc >> 8) & 0xff;
-		crc <<= 8;
-		//vpInterf->Rx(0, &d, 1);
-
-		crc |= d;
-		crc &= 0xffff;
-	}
-	if (crc != calccrc)
+	if (ncrc < 2)
+		vpInterf->Rx(0, &crc[ncrc], 2 - ncrc);
+
+	if (vbCrc && crc16_ccitt(pBuff, cnt, 0) != (((uint16_t)crc[0] << 8) | crc[1]))
 		return -2;
 
 	return cnt;
 }
 
-int SDCard::WriteData(uint8_t *pData, int Len)
+int SDCard::WriteData(uint8_t *pData, int Len, uint8_t Token)
 {
 	int cnt;
 	uint16_t crc;
-	uint8_t d[2] = { 0xff, 0xfe };
+	uint8_t d[2] = { 0xff, Token };
 
 	if (pData == NULL)
 		return -1;
 
-	crc = crc16_ccitt(pData, Len, 0);
+	crc = vbCrc ? crc16_ccitt(pData, Len, 0) : 0xffff;
 
 	//vpInterf->Tx(0, d, 2);
 
@@ -345,8 +405,8 @@ uint64_t SDCard::GetSize(void)
 	else
 	{
 		// Vers 2.0
-		// Bits 48-69
-		size = (uint64_t)(((data[7] & 0x3f) << 16u) | (data[8] << 8u) | data[9]) * 512;
+		// Bits 48-69, (C_SIZE + 1) * 512KB
+		size = ((uint64_t)(((data[7] & 0x3f) << 16u) | (data[8] << 8u) | data[9]) + 1) * 512;
 	}
 
 	return size;
@@ -382,3 +442,68 @@ int SDCard::WriteSingleBlock(uint32_t Addr, uint8_t *pData, int Len)
 
 	return retval;
 }
+
+int SDCard::ReadMultiBlock(uint32_t Addr, uint8_t *pData, int NbBlk)
+{
+	int cnt = 0;
+
+	if (pData == NULL || NbBlk <= 0)
+		return 0;
+
+	if (NbBlk == 1)
+		return ReadSingleBlock(Addr, pData, vDev.SectSize) == vDev.SectSize ? 1 : 0;
+
+	int r = Cmd(18, Addr);
+	if (r != 0)
+		return 0;
+
+	while (cnt < NbBlk)
+	{
+		if (ReadData(pData, vDev.SectSize) != vDev.SectSize)
+			break;
+		pData += vDev.SectSize;
+		cnt++;
+	}
+
+	// Stop transmission, busy is handled by next command
+	Cmd(12, 0);
+
+	return cnt;
+}
+
+int SDCard::WriteMultiBlock(uint32_t Addr, uint8_t *pData, int NbBlk)
+{
+	int cnt = 0;
+
+	if (pData == NULL || NbBlk <= 0)
+		return 0;
+
+	if (NbBlk == 1)
+		return WriteSingleBlock(Addr, pData, vDev.SectSize) == vDev.SectSize ? 1 : 0;
+
+	// Let the card erase all blocks ahead of writing them (ACMD23
+	// SET_WR_BLK_ERASE_COUNT).  It is only a hint, failure is ignored
+	if (Cmd(55, 0) == 0)
+		Cmd(23, NbBlk);
+
+	int r = Cmd(25, Addr);
+	if (r != 0)
+		return 0;
+
+	while (cnt < NbBlk)
+	{
+		// Multiple block write start token
+		if (WriteData(pData, vDev.SectSize, 0xfc) != vDev.SectSize)
+			break;
+		pData += vDev.SectSize;
+		cnt++;
+
+		// Wait for card to program the block
+		WaitBusy();
+	}
+
+	StopTran();
+	WaitBusy();
+
+	return cnt;
+}
@@ -38,6 +38,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Devices/Drivers/Icm20948/Icm20948DataBaseControl.h"
 
 #include "idelay.h"
+#include "device_regseq.h"
 #include "coredev/i2c.h"
 #include "coredev/spi.h"
 #include "sensors/agm_icm20948.h"
@@ -48,6 +49,16 @@ static const uint8_t dmp3_image[] = {
 #include "imu/icm20948_img_dmp3a.h"
 };
 
+// Register sequence executor, bank number in high byte of register address.
+// Registers auto increment on write within a bank
+static const DEVREGSEQ_CFG s_Icm20948RegSeqCfg = {
+	2,							// Address length
+	DEVREGSEQ_WRMODE_BURST,		// Merge consecutive register writes
+	0xFF,						// Pair address mask, not used
+	1000,						// Poll interval usec
+	0,							// Timer trigger, not used
+};
+
 bool AgmIcm20948::Init(uint32_t DevAddr, DeviceIntrf * const pIntrf, Timer * const pTimer)
 {
 	//if (vbInitialized)
@@ -95,36 +106,26 @@ bool AgmIcm20948::Init(uint32_t DevAddr, DeviceIntrf * const pIntrf, Timer * con
 	Valid(true);
 
 
-	// NOTE : require delay for reset to stabilize
-	// the chip would not respond properly to motion detection
-	usDelay(500000);
-
 	//inv_icm20948_initialize_lower_driver(&icm_device, SERIAL_INTERFACE_SPI, NULL, 0);//, dmp3_image_size);
 
-	regaddr = ICM20948_USER_CTRL;
-	Write8((uint8_t*)&regaddr, 2, userctrl);
-
-	regaddr = ICM20948_PWR_MGMT_1;
-	Write8((uint8_t*)&regaddr, 2, 1);
-
-	regaddr = ICM20948_PWR_MGMT_2;
-	Write8((uint8_t*)&regaddr, 2, 0x7f);
-
-	// Init master I2C interface
-
-	regaddr = ICM20948_FIFO_EN_1;
-	Write8((uint8_t*)&regaddr, 2, ICM20948_FIFO_EN_1_SLV_0_FIFO_EN);
-
-	//regaddr = ICM20948_LP_CONFIG;
-	//Write8((uint8_t*)&regaddr, 2, lpconfig);
-
-
-	regaddr = ICM20948_I2C_MST_CTRL;
-	d = 0;
-	Write8((uint8_t*)&regaddr, 2, d);
-
-	regaddr = ICM20948_I2C_MST_ODR_CONFIG;
-	Write8((uint8_t*)&regaddr, 2, 0);
+	DEVREGSEQ cfgseq[] = {
+		// NOTE : require delay for reset to stabilize
+		// the chip would not respond properly to motion detection
+		DEVREGSEQ_DELAY(500000),
+		DEVREGSEQ_WRITE(ICM20948_USER_CTRL, userctrl),
+		DEVREGSEQ_WRITE(ICM20948_PWR_MGMT_1, 1),
+		DEVREGSEQ_WRITE(ICM20948_PWR_MGMT_2, 0x7f),
+		// Init master I2C interface
+		DEVREGSEQ_WRITE(ICM20948_FIFO_EN_1, ICM20948_FIFO_EN_1_SLV_0_FIFO_EN),
+		//DEVREGSEQ_WRITE(ICM20948_LP_CONFIG, lpconfig),
+		DEVREGSEQ_WRITE(ICM20948_I2C_MST_ODR_CONFIG, 0),
+		DEVREGSEQ_WRITE(ICM20948_I2C_MST_CTRL, 0),
+		DEVREGSEQ_END()
+	};
+	DevRegSeq seq;
+
+	seq.Init(s_Icm20948RegSeqCfg, this);
+	seq.Run(cfgseq);
 
 #if 0
 	regaddr = ICM20948_AK09916_WIA1;
@@ -169,11 +170,15 @@ bool AgmIcm20948::Init(const ACCELSENSOR_CFG &CfgData, DeviceIntrf * const pIntr
 		}
 	}
 
-	regaddr = ICM20948_ACCEL_SMPLRT_DIV_1;
-	Write8((uint8_t*)&regaddr, 2, div >> 8);
+	DEVREGSEQ divseq[] = {
+		DEVREGSEQ_WRITE(ICM20948_ACCEL_SMPLRT_DIV_1, div >> 8),
+		DEVREGSEQ_WRITE(ICM20948_ACCEL_SMPLRT_DIV_2, div & 0xFF),
+		DEVREGSEQ_END()
+	};
+	DevRegSeq seq;
 
-	regaddr = ICM20948_ACCEL_SMPLRT_DIV_2;
-	Write8((uint8_t*)&regaddr, 2, div & 0xFF);
+	seq.Init(s_Icm20948RegSeqCfg, this);
+	seq.Run(divseq);
 
 	Scale(CfgData.Scale);
 	//LowPassFreq(vSampFreq / 2000);
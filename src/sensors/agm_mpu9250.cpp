@@ -33,6 +33,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ----------------------------------------------------------------------------*/
 #include "convutil.h"
 #include "idelay.h"
+#include "device_regseq.h"
 #include "coredev/i2c.h"
 #include "coredev/spi.h"
 #include "sensors/agm_mpu9250.h"
@@ -42,6 +43,35 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MPU9250_GYRO_IDX		1
 #define MPU9250_MAG_IDX			2
 
+// Register shadow bit maps, bit 0 is MPU9250_AG_SMPLRT_DIV.
+// Volatile : I2C slave 0-4 control (used to access the mag), I2C_MST_STATUS, INT_STATUS,
+// sensor & external sensor data, I2C slave data out, SIGNAL_PATH_RESET
+static const uint8_t s_Mpu9250RegVolMap[] = {
+	0x00, 0xF0, 0xFF, 0x3F, 0xFE, 0xFF, 0xFF, 0xFF, 0xFF, 0xBF, 0x00
+};
+
+// Read only : I2C_SLV4_DI, I2C_MST_STATUS, INT_STATUS, sensor & external sensor data
+static const uint8_t s_Mpu9250RegWrMap[] = {
+	0xFF, 0xFF, 0xFF, 0xCF, 0x01, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x0F
+};
+
+static const DEVREGSHADOW_CFG s_Mpu9250RegShadowCfg = {
+	MPU9250_AG_SHADOW_START,
+	MPU9250_AG_SHADOW_NBREG,
+	true,
+	s_Mpu9250RegWrMap,
+	s_Mpu9250RegVolMap
+};
+
+// Register sequence executor, registers auto increment on write
+static const DEVREGSEQ_CFG s_Mpu9250RegSeqCfg = {
+	1,							// Address length
+	DEVREGSEQ_WRMODE_BURST,		// Merge consecutive register writes
+	0xFF,						// Pair address mask, not used
+	1000,						// Poll interval usec
+	0,							// Timer trigger, not used
+};
+
 bool AgmMpu9250::Init(uint32_t DevAddr, DeviceIntrf *pIntrf, Timer *pTimer)
 {
 	if (vbInitialized)
@@ -57,6 +87,7 @@ bool AgmMpu9250::Init(uint32_t DevAddr, DeviceIntrf *pIntrf, Timer *pTimer)
 
 	Interface(pIntrf);
 	DeviceAddess(DevAddr);
+	RegShadowInit(&s_Mpu9250RegShadowCfg, vRegShadow);
 	vbSensorEnabled[0] = vbSensorEnabled[1] = vbSensorEnabled[2] = false;
 
 	if (pTimer != NULL)
@@ -75,21 +106,26 @@ bool AgmMpu9250::Init(uint32_t DevAddr, DeviceIntrf *pIntrf, Timer *pTimer)
 
 	// The MPU-9250 has an issue that often unresponsive when rebooting while MAg is streaming
 	// A few reset/retry would require.  Have not found workaround yet.
-	do {
-		regaddr = MPU9250_AG_PWR_MGMT_1;
-		Write8(&regaddr, 1, MPU9250_AG_PWR_MGMT_1_H_RESET);
-
-		msDelay(100);
-
+	DevRegSeq seq;
+	DEVREGSEQ rstseq[] = {
+		// H_RESET self clears once reset completed
+		DEVREGSEQ_POLL(MPU9250_AG_PWR_MGMT_1, MPU9250_AG_PWR_MGMT_1_H_RESET, 0, 100000),
 		// Init master I2C interface
-		regaddr = MPU9250_AG_I2C_MST_CTRL;
-		Write8(&regaddr, 1, mst);
+		DEVREGSEQ_WRITE(MPU9250_AG_I2C_MST_CTRL, mst),
+		DEVREGSEQ_WRITE(MPU9250_AG_USER_CTRL, userctrl | MPU9250_AG_USER_CTRL_I2C_MST_RST),
+		DEVREGSEQ_DELAY(10000),
+		DEVREGSEQ_END()
+	};
 
-		regaddr = MPU9250_AG_USER_CTRL;
-		Write8(&regaddr, 1, userctrl | MPU9250_AG_USER_CTRL_I2C_MST_RST);
+	seq.Init(s_Mpu9250RegSeqCfg, this);
 
+	do {
+		regaddr = MPU9250_AG_PWR_MGMT_1;
+		Write8(&regaddr, 1, MPU9250_AG_PWR_MGMT_1_H_RESET);
+		RegShadowInvalidate();
 
-		msDelay(10);
+		// Failure is caught by the chip id check
+		seq.Run(rstseq);
 
 		regaddr = MPU9250_MAG_CTRL2;
 		d = MPU9250_MAG_CTRL2_SRST;
@@ -122,24 +158,23 @@ bool AgmMpu9250::Init(uint32_t DevAddr, DeviceIntrf *pIntrf, Timer *pTimer)
 
 	// NOTE : require delay for reset to stabilize
 	// the chip would not respond properly to motion detection
-	msDelay(100);
+	DEVREGSEQ cfgseq[] = {
+		DEVREGSEQ_DELAY(100000),
+		// Disable all interrupt
+		DEVREGSEQ_WRITE(MPU9250_AG_INT_ENABLE, 0),
+		// Init master I2C interface
+		DEVREGSEQ_WRITE(MPU9250_AG_USER_CTRL, userctrl),
+		DEVREGSEQ_WRITE(MPU9250_AG_I2C_MST_CTRL, mst),
+		DEVREGSEQ_END()
+	};
 
-	// Disable all interrupt
-	regaddr = MPU9250_AG_INT_ENABLE;
-	Write8(&regaddr, 1, 0);
+	seq.Run(cfgseq);
 
 	//regaddr = MPU9250_AG_CONFIG;
 	//Write8(&regaddr, 1, MPU9250_AG_CONFIG_FIFO_MODE_BLOCKING);
 
 	vbInitialized = true;
 
-	// Init master I2C interface
-	regaddr = MPU9250_AG_USER_CTRL;
-	Write8(&regaddr, 1, userctrl);
-
-	regaddr = MPU9250_AG_I2C_MST_CTRL;
-	Write8(&regaddr, 1, mst);
-
 	// Enable FIFO
 
     // Undocumented register
@@ -300,9 +335,7 @@ bool AgmMpu9250::Init(const GYROSENSOR_CFG &CfgData, DeviceIntrf *pIntrf, Timer
 
 	// Enable full power
 	regaddr = MPU9250_AG_PWR_MGMT_1;
-	d = Read8(&regaddr, 1);
-	d  &= ~MPU9250_AG_PWR_MGMT_1_CYCLE;
-	Write8(&regaddr, 1, d);
+	Update8(&regaddr, 1, MPU9250_AG_PWR_MGMT_1_CYCLE, 0);
 
 	msDelay(1);	// Min delays required for mode change to sync before config can be set
 
@@ -355,14 +388,17 @@ bool AgmMpu9250::Init(const GYROSENSOR_CFG &CfgData, DeviceIntrf *pIntrf, Timer
 		smplrt = 32000000 / GyroSensor::vSampFreq;
 	}
 
-	regaddr = MPU9250_AG_CONFIG;
-	Write8(&regaddr, 1, d);// | MPU9250_AG_CONFIG_FIFO_MODE_BLOCKING);
+	// Consecutive registers, written in one burst
+	DEVREGSEQ cfgseq[] = {
+		DEVREGSEQ_WRITE(MPU9250_AG_SMPLRT_DIV, smplrt - 1),
+		DEVREGSEQ_WRITE(MPU9250_AG_CONFIG, d),// | MPU9250_AG_CONFIG_FIFO_MODE_BLOCKING),
+		DEVREGSEQ_WRITE(MPU9250_AG_GYRO_CONFIG, fchoice),
+		DEVREGSEQ_END()
+	};
+	DevRegSeq seq;
 
-	regaddr = MPU9250_AG_GYRO_CONFIG;
-	Write8(&regaddr, 1, fchoice);
-
-	regaddr = MPU9250_AG_SMPLRT_DIV;
-	Write8(&regaddr, 1, smplrt - 1);
+	seq.Init(s_Mpu9250RegSeqCfg, this);
+	seq.Run(cfgseq);
 
 	Sensitivity(CfgData.Sensitivity);
 
@@ -403,9 +439,7 @@ bool AgmMpu9250::Init(const MAGSENSOR_CFG &CfgData, DeviceIntrf *pIntrf, Timer *
 
 	// Enable full power
 	regaddr = MPU9250_AG_PWR_MGMT_1;
-	d[0] = Read8(&regaddr, 1);
-	d[0]  &= ~MPU9250_AG_PWR_MGMT_1_CYCLE;
-	Write8(&regaddr, 1, d[0]);
+	Update8(&regaddr, 1, MPU9250_AG_PWR_MGMT_1_CYCLE, 0);
 
 	msDelay(10);	// Min delays required for mode change to sync before config can be set
 
@@ -529,10 +563,8 @@ bool AgmMpu9250::Enable()
 	uint8_t regaddr = MPU9250_AG_PWR_MGMT_1;
 	uint8_t d;
 
-	d = Read8(&regaddr, 1);
-	d &= ~(MPU9250_AG_PWR_MGMT_1_SLEEP | MPU9250_AG_PWR_MGMT_1_CLKSEL_MASK);
-
-	Write8(&regaddr, 1, d |	MPU9250_AG_PWR_MGMT_1_CLKSEL_AUTO);
+	Update8(&regaddr, 1, MPU9250_AG_PWR_MGMT_1_SLEEP | MPU9250_AG_PWR_MGMT_1_CLKSEL_MASK,
+			MPU9250_AG_PWR_MGMT_1_CLKSEL_AUTO);
 
 	regaddr = MPU9250_AG_PWR_MGMT_2;
 
@@ -594,9 +626,7 @@ void AgmMpu9250::Disable()
 		 MPU9250_AG_PWR_MGMT_2_DIS_ZA | MPU9250_AG_PWR_MGMT_2_DIS_YA | MPU9250_AG_PWR_MGMT_2_DIS_XA);
 
 	regaddr = MPU9250_AG_PWR_MGMT_1;
-	d = Read8(&regaddr, 1);
-	d |= MPU9250_AG_PWR_MGMT_1_SLEEP;
-	Write8(&regaddr, 1, d);//MPU9250_AG_PWR_MGMT_1_SLEEP | MPU9250_AG_PWR_MGMT_1_PD_PTAT |
+	Update8(&regaddr, 1, MPU9250_AG_PWR_MGMT_1_SLEEP, MPU9250_AG_PWR_MGMT_1_SLEEP);//MPU9250_AG_PWR_MGMT_1_SLEEP | MPU9250_AG_PWR_MGMT_1_PD_PTAT |
 //	Write8(&regaddr, 1, MPU9250_AG_PWR_MGMT_1_SLEEP | MPU9250_AG_PWR_MGMT_1_PD_PTAT |
 //						MPU9250_AG_PWR_MGMT_1_GYRO_STANDBY);
 
@@ -607,6 +637,9 @@ void AgmMpu9250::Reset()
 	uint8_t regaddr = MPU9250_AG_PWR_MGMT_1;
 
 	Write8(&regaddr, 1, MPU9250_AG_PWR_MGMT_1_H_RESET);
+
+	// All registers are back to default
+	RegShadowInvalidate();
 }
 
 bool AgmMpu9250::StartSampling()
@@ -723,7 +756,6 @@ uint32_t AgmMpu9250::LowPassFreq(uint32_t Freq)
 	Write8(&regaddr, 1, d);// | MPU9250_AG_ACCEL_CONFIG2_FIFO_SIZE_1024);
 
 	regaddr = MPU9250_AG_SMPLRT_DIV;
-	d = Read8(&regaddr, 0);
 	d = rate / Freq - 1;
 	Write8(&regaddr, 1, d);
 
@@ -764,7 +796,7 @@ uint16_t AgmMpu9250::Scale(uint16_t Value)
 uint32_t AgmMpu9250::Sensitivity(uint32_t Value)
 {
 	uint8_t regaddr = MPU9250_AG_GYRO_CONFIG;
-	uint8_t d = Read8(&regaddr, 1) & MPU9250_AG_GYRO_CONFIG_FCHOICE_MASK;
+	uint8_t d = 0;
 
 	if (Value < 500)
 	{
@@ -787,7 +819,7 @@ uint32_t AgmMpu9250::Sensitivity(uint32_t Value)
 		GyroSensor::Sensitivity(2000);
 	}
 
-	Write8(&regaddr, 1, d);
+	Update8(&regaddr, 1, ~MPU9250_AG_GYRO_CONFIG_FCHOICE_MASK, d);
 
 	return GyroSensor::Sensitivity();
 }
@@ -869,6 +901,8 @@ bool AgmMpu9250::UpdateData()
 			GyroSensor::vData.Timestamp = t;
 			GyroSensor::vSampleTime = t;
 			GyroSensor::vSampleCnt++;
+			// Die temperature for the gyro calibration, 333.87 LSB/C, 0 LSB at 21 C
+			GyroSensor::Temperature((float)(int16_t)(((uint16_t)d[6] << 8) | d[7]) / 333.87f + 21.0f);
 			idx += 6;
 		}
 	}
@@ -1029,12 +1063,10 @@ void AgmMpu9250::EnableFifo()
 	Write8(&regaddr, 1, 0);
 
 	regaddr = MPU9250_AG_USER_CTRL;
-	d = Read8(&regaddr, 1) | MPU9250_AG_USER_CTRL_FIFO_EN;
-	Write8(&regaddr, 1, d);
+	Update8(&regaddr, 1, MPU9250_AG_USER_CTRL_FIFO_EN, MPU9250_AG_USER_CTRL_FIFO_EN);
 
 	regaddr = MPU9250_AG_ACCEL_CONFIG2;
-	d = Read8(&regaddr, 1) | MPU9250_AG_ACCEL_CONFIG2_FIFO_SIZE_1024;
-	Write8(&regaddr, 1, d);
+	Update8(&regaddr, 1, MPU9250_AG_ACCEL_CONFIG2_FIFO_SIZE_1024, MPU9250_AG_ACCEL_CONFIG2_FIFO_SIZE_1024);
 
 	regaddr = MPU9250_AG_FIFO_EN;
 	d = Read8(&regaddr, 1);
@@ -0,0 +1,531 @@
+/**-------------------------------------------------------------------------
+@file	sensor_calib.cpp
+
+@brief	On device calibration engine for accelerometer, gyroscope and magnetometer
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <math.h>
+#include <string.h>
+
+#include "sensors/sensor_calib.h"
+
+/**
+ * @brief	Invert 3x3 matrix
+ *
+ * @param	pInv	: Result
+ * @param	pM		: Matrix to invert
+ *
+ * @return	false - Singular matrix
+ */
+static bool Matrix3Invert(double pInv[3][3], double pM[3][3])
+{
+	double c00 = pM[1][1] * pM[2][2] - pM[1][2] * pM[2][1];
+	double c01 = pM[1][2] * pM[2][0] - pM[1][0] * pM[2][2];
+	double c02 = pM[1][0] * pM[2][1] - pM[1][1] * pM[2][0];
+	double det = pM[0][0] * c00 + pM[0][1] * c01 + pM[0][2] * c02;
+
+	if (fabs(det) < 1e-30)
+	{
+		return false;
+	}
+
+	det = 1.0 / det;
+
+	pInv[0][0] = c00 * det;
+	pInv[0][1] = (pM[0][2] * pM[2][1] - pM[0][1] * pM[2][2]) * det;
+	pInv[0][2] = (pM[0][1] * pM[1][2] - pM[0][2] * pM[1][1]) * det;
+	pInv[1][0] = c01 * det;
+	pInv[1][1] = (pM[0][0] * pM[2][2] - pM[0][2] * pM[2][0]) * det;
+	pInv[1][2] = (pM[0][2] * pM[1][0] - pM[0][0] * pM[1][2]) * det;
+	pInv[2][0] = c02 * det;
+	pInv[2][1] = (pM[0][1] * pM[2][0] - pM[0][0] * pM[2][1]) * det;
+	pInv[2][2] = (pM[0][0] * pM[1][1] - pM[0][1] * pM[1][0]) * det;
+
+	return true;
+}
+
+/**
+ * @brief	Eigen decomposition of symmetric 3x3 matrix, cyclic Jacobi method
+ *
+ * @param	pM		: Symmetric matrix, destroyed on return
+ * @param	pVec	: Eigen vectors in columns
+ * @param	pVal	: Eigen values
+ */
+static void Matrix3SymEigen(double pM[3][3], double pVec[3][3], double pVal[3])
+{
+	memset(pVec, 0, sizeof(double) * 9);
+	pVec[0][0] = pVec[1][1] = pVec[2][2] = 1.0;
+
+	for (int sweep = 0; sweep < 16; sweep++)
+	{
+		double off = fabs(pM[0][1]) + fabs(pM[0][2]) + fabs(pM[1][2]);
+
+		if (off < 1e-15)
+		{
+			break;
+		}
+
+		for (int p = 0; p < 2; p++)
+		{
+			for (int q = p + 1; q < 3; q++)
+			{
+				if (pM[p][q] == 0.0)
+				{
+					continue;
+				}
+
+				double theta = (pM[q][q] - pM[p][p]) / (2.0 * pM[p][q]);
+				double t = (theta >= 0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+				double c = 1.0 / sqrt(t * t + 1.0);
+				double s = t * c;
+
+				for (int k = 0; k < 3; k++)
+				{
+					double mkp = pM[k][p];
+					double mkq = pM[k][q];
+					pM[k][p] = c * mkp - s * mkq;
+					pM[k][q] = s * mkp + c * mkq;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					double mpk = pM[p][k];
+					double mqk = pM[q][k];
+					pM[p][k] = c * mpk - s * mqk;
+					pM[q][k] = s * mpk + c * mqk;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					double vkp = pVec[k][p];
+					double vkq = pVec[k][q];
+					pVec[k][p] = c * vkp - s * vkq;
+					pVec[k][q] = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+
+	pVal[0] = pM[0][0];
+	pVal[1] = pM[1][1];
+	pVal[2] = pM[2][2];
+}
+
+void AccelCalib::Reset()
+{
+	memset(vCount, 0, sizeof(vCount));
+	memset(vSum, 0, sizeof(vSum));
+}
+
+uint32_t AccelCalib::Progress()
+{
+	uint32_t res = 0;
+
+	for (int i = 0; i < 6; i++)
+	{
+		if (vCount[i] >= (uint32_t)vMinSamples)
+		{
+			res |= 1 << i;
+		}
+	}
+
+	return res;
+}
+
+uint32_t AccelCalib::AddSample(const ACCELSENSOR_DATA &Data)
+{
+	float n = sqrtf(Data.X * Data.X + Data.Y * Data.Y + Data.Z * Data.Z);
+
+	if (fabsf(n - 1.0) > ACCELCALIB_STILL_TOL)
+	{
+		// Moving
+		return Progress();
+	}
+
+	int axis = 0;
+
+	for (int i = 1; i < 3; i++)
+	{
+		if (fabsf(Data.Val[i]) > fabsf(Data.Val[axis]))
+		{
+			axis = i;
+		}
+	}
+
+	if (fabsf(Data.Val[axis]) < ACCELCALIB_AXIS_TOL * n)
+	{
+		// Not aligned
+		return Progress();
+	}
+
+	int pos = axis * 2 + (Data.Val[axis] < 0 ? 1 : 0);
+
+	if (vCount[pos] < (uint32_t)vMinSamples)
+	{
+		vSum[pos][0] += Data.X;
+		vSum[pos][1] += Data.Y;
+		vSum[pos][2] += Data.Z;
+		vCount[pos]++;
+	}
+
+	return Progress();
+}
+
+bool AccelCalib::Fit(SENSOR_CALIB &Calib)
+{
+	if (Progress() != ACCELCALIB_POS_ALL)
+	{
+		return false;
+	}
+
+	double a[3][3];
+	double inv[3][3];
+	double b[3] = { 0, 0, 0 };
+
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			double up = vSum[i * 2][j] / vCount[i * 2];
+			double dn = vSum[i * 2 + 1][j] / vCount[i * 2 + 1];
+
+			// Column i is the response to gravity on axis i
+			a[j][i] = (up - dn) * 0.5;
+			b[j] += (up + dn) / 6.0;
+		}
+	}
+
+	if (Matrix3Invert(inv, a) == false)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		Calib.Offset[i] = 0;
+		for (int j = 0; j < 3; j++)
+		{
+			Calib.Gain[i][j] = inv[i][j];
+			Calib.Offset[i] -= inv[i][j] * b[j];
+		}
+	}
+
+	return true;
+}
+
+void GyroCalib::Reset()
+{
+	vCount = 0;
+	vTempRef = 0;
+	vSumT = 0;
+	vSumT2 = 0;
+	memset(vSumW, 0, sizeof(vSumW));
+	memset(vSumTW, 0, sizeof(vSumTW));
+	memset(vBias, 0, sizeof(vBias));
+	memset(vTempCoef, 0, sizeof(vTempCoef));
+}
+
+bool GyroCalib::AddSample(const GYROSENSOR_DATA &Data, float Temp)
+{
+	if (fabsf(Data.X) > GYROCALIB_STILL_RATE_MAX || fabsf(Data.Y) > GYROCALIB_STILL_RATE_MAX ||
+		fabsf(Data.Z) > GYROCALIB_STILL_RATE_MAX)
+	{
+		return false;
+	}
+
+	if (vCount == 0)
+	{
+		vTempRef = Temp;
+	}
+
+	double t = Temp - vTempRef;
+
+	vSumT += t;
+	vSumT2 += t * t;
+
+	for (int i = 0; i < 3; i++)
+	{
+		vSumW[i] += Data.Val[i];
+		vSumTW[i] += t * Data.Val[i];
+	}
+
+	vCount++;
+
+	return true;
+}
+
+bool GyroCalib::Fit()
+{
+	if (vCount == 0)
+	{
+		return false;
+	}
+
+	double mt = vSumT / vCount;
+	double vart = vSumT2 / vCount - mt * mt;
+
+	for (int i = 0; i < 3; i++)
+	{
+		double mw = vSumW[i] / vCount;
+
+		if (vart > 0.01)
+		{
+			// Enough temperature variation (> 0.1 C std dev) for regression
+			double k = (vSumTW[i] / vCount - mt * mw) / vart;
+
+			vTempCoef[i] = k;
+			vBias[i] = mw - k * mt;
+		}
+		else
+		{
+			vTempCoef[i] = 0;
+			vBias[i] = mw;
+		}
+	}
+
+	return true;
+}
+
+void GyroCalib::Calibration(float Temp, SENSOR_CALIB &Calib)
+{
+	float t = Temp - vTempRef;
+
+	SensorCalibIdentity(&Calib);
+
+	for (int i = 0; i < 3; i++)
+	{
+		Calib.Offset[i] = -(vBias[i] + vTempCoef[i] * t);
+	}
+}
+
+void GyroCalib::Apply(GyroSensor &Sensor)
+{
+	SENSOR_CALIB calib;
+
+	Calibration(vTempRef, calib);
+	Sensor.SetCalibration(calib, vTempCoef, vTempRef);
+}
+
+void MagCalib::Reset()
+{
+	vCount = 0;
+	vNorm = 0;
+	vResidual = 0;
+	vField = 0;
+	memset(vDtD, 0, sizeof(vDtD));
+	memset(vDt1, 0, sizeof(vDt1));
+}
+
+void MagCalib::AddSample(const MAGSENSOR_DATA &Data)
+{
+	if (vNorm <= 0)
+	{
+		vNorm = sqrtf(Data.X * Data.X + Data.Y * Data.Y + Data.Z * Data.Z);
+		if (vNorm <= 0)
+		{
+			return;
+		}
+	}
+
+	double x = Data.X / vNorm;
+	double y = Data.Y / vNorm;
+	double z = Data.Z / vNorm;
+	double d[9] = { x * x, y * y, z * z, 2 * x * y, 2 * x * z, 2 * y * z, 2 * x, 2 * y, 2 * z };
+	int k = 0;
+
+	for (int i = 0; i < 9; i++)
+	{
+		vDt1[i] += d[i];
+		for (int j = i; j < 9; j++)
+		{
+			vDtD[k++] += d[i] * d[j];
+		}
+	}
+
+	vCount++;
+}
+
+bool MagCalib::Fit(SENSOR_CALIB &Calib)
+{
+	if (vCount < MAGCALIB_SAMPLE_MIN)
+	{
+		return false;
+	}
+
+	// Solve D'D p = D'1 with Gauss elimination, partial pivoting
+	double m[9][10];
+	int k = 0;
+
+	for (int i = 0; i < 9; i++)
+	{
+		for (int j = i; j < 9; j++, k++)
+		{
+			m[i][j] = m[j][i] = vDtD[k];
+		}
+		m[i][9] = vDt1[i];
+	}
+
+	for (int c = 0; c < 9; c++)
+	{
+		int piv = c;
+
+		for (int r = c + 1; r < 9; r++)
+		{
+			if (fabs(m[r][c]) > fabs(m[piv][c]))
+			{
+				piv = r;
+			}
+		}
+		if (fabs(m[piv][c]) < 1e-12)
+		{
+			// Not enough orientation coverage
+			return false;
+		}
+		if (piv != c)
+		{
+			for (int j = c; j < 10; j++)
+			{
+				double t = m[c][j];
+				m[c][j] = m[piv][j];
+				m[piv][j] = t;
+			}
+		}
+		for (int r = c + 1; r < 9; r++)
+		{
+			double f = m[r][c] / m[c][c];
+			for (int j = c; j < 10; j++)
+			{
+				m[r][j] -= f * m[c][j];
+			}
+		}
+	}
+
+	double p[9];
+
+	for (int i = 8; i >= 0; i--)
+	{
+		double s = m[i][9];
+		for (int j = i + 1; j < 9; j++)
+		{
+			s -= m[i][j] * p[j];
+		}
+		p[i] = s / m[i][i];
+	}
+
+	// Residual from normal equations : p'D'Dp - 2p'D'1 + n
+	double r = vCount;
+
+	k = 0;
+	for (int i = 0; i < 9; i++)
+	{
+		r -= 2 * p[i] * vDt1[i];
+		for (int j = i; j < 9; j++, k++)
+		{
+			r += (i == j ? 1 : 2) * p[i] * p[j] * vDtD[k];
+		}
+	}
+	vResidual = r > 0 ? sqrt(r / vCount) : 0;
+
+	// Ellipsoid (x - c)' A (x - c) = 1 + c' A c
+	double a[3][3] = {
+		{ p[0], p[3], p[4] },
+		{ p[3], p[1], p[5] },
+		{ p[4], p[5], p[2] }
+	};
+	double inv[3][3];
+	double c[3];
+
+	if (Matrix3Invert(inv, a) == false)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		c[i] = -(inv[i][0] * p[6] + inv[i][1] * p[7] + inv[i][2] * p[8]);
+	}
+
+	double g = 1.0;
+
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			g += c[i] * a[i][j] * c[j];
+		}
+	}
+
+	if (g <= 0)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			a[i][j] /= g;
+		}
+	}
+
+	// Soft iron correction W = R * sqrt(A), R is the radius of the sphere with the same volume
+	double vec[3][3];
+	double val[3];
+
+	Matrix3SymEigen(a, vec, val);
+
+	if (val[0] <= 0 || val[1] <= 0 || val[2] <= 0)
+	{
+		// Not an ellipsoid
+		return false;
+	}
+
+	double rad = pow(val[0] * val[1] * val[2], -1.0 / 6.0);
+
+	for (int i = 0; i < 3; i++)
+	{
+		val[i] = sqrt(val[i]) * rad;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			Calib.Gain[i][j] = vec[i][0] * val[0] * vec[j][0] + vec[i][1] * val[1] * vec[j][1] +
+							   vec[i][2] * val[2] * vec[j][2];
+		}
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		Calib.Offset[i] = -(Calib.Gain[i][0] * c[0] + Calib.Gain[i][1] * c[1] + Calib.Gain[i][2] * c[2]) * vNorm;
+	}
+
+	vField = rad * vNorm;
+
+	return true;
+}
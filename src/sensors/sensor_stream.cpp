@@ -0,0 +1,748 @@
+/**-------------------------------------------------------------------------
+@file	sensor_stream.cpp
+
+@brief	Sensor data stream recorder and replay sensor
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "sensors/sensor_stream.h"
+
+#pragma pack(push, 1)
+
+// Record payloads.  Time stamps are carried by the record header
+typedef struct {
+	int16_t Val[3];
+} SENSSTRM_XYZ;
+
+typedef struct {
+	uint32_t Pressure;
+	int16_t  Temperature;
+	uint16_t Humidity;
+} SENSSTRM_TPH;
+
+typedef struct {
+	uint32_t GasRes[GASSENSOR_MEASUREMENT_POINT_MAX];
+	int32_t	 MeasIdx;
+	float	 AirQualIdx;
+} SENSSTRM_GAS;
+
+#pragma pack(pop)
+
+SensorRecorder::SensorRecorder()
+{
+	vWriteCB = NULL;
+	vpCtx = NULL;
+	vpBuff = NULL;
+	vBuffLen = 0;
+	vBuffIdx = 0;
+	vbTimeValid = false;
+	vLastTime = 0;
+	vRecCnt = 0;
+}
+
+bool SensorRecorder::Init(const SENSREC_CFG &Cfg)
+{
+	if (Cfg.WriteCB == NULL)
+	{
+		return false;
+	}
+
+	vWriteCB = Cfg.WriteCB;
+	vpCtx = Cfg.pCtx;
+	vpBuff = Cfg.pBuff;
+	vBuffLen = Cfg.pBuff != NULL ? Cfg.BuffLen : 0;
+	vBuffIdx = 0;
+	vbTimeValid = false;
+	vLastTime = 0;
+	vRecCnt = 0;
+
+	memset(vChanTime, 0, sizeof(vChanTime));
+	memset(vChanCfg, 0, sizeof(vChanCfg));
+
+	SENSSTRM_HDR hdr = { SENSSTRM_MAGIC, SENSSTRM_VERSION, 0 };
+
+	return Write((uint8_t*)&hdr, sizeof(hdr));
+}
+
+bool SensorRecorder::Write(uint8_t * const pData, int Len)
+{
+	if (vBuffLen <= 0)
+	{
+		return vWriteCB(vpCtx, pData, Len) == Len;
+	}
+
+	if (vBuffIdx + Len > vBuffLen)
+	{
+		Flush();
+		if (Len > vBuffLen)
+		{
+			return vWriteCB(vpCtx, pData, Len) == Len;
+		}
+	}
+
+	memcpy(&vpBuff[vBuffIdx], pData, Len);
+	vBuffIdx += Len;
+
+	return true;
+}
+
+void SensorRecorder::Flush()
+{
+	if (vBuffIdx > 0)
+	{
+		vWriteCB(vpCtx, vpBuff, vBuffIdx);
+		vBuffIdx = 0;
+	}
+}
+
+bool SensorRecorder::Record(SENSSTRM_REC_TYPE Type, uint64_t Timestamp, void * const pData, int Len)
+{
+	if (vWriteCB == NULL || Len > SENSSTRM_REC_PAYLOAD_MAX)
+	{
+		return false;
+	}
+
+	uint8_t rec[sizeof(SENSSTRM_RECHDR) + SENSSTRM_REC_PAYLOAD_MAX];
+	SENSSTRM_RECHDR *hdr = (SENSSTRM_RECHDR*)rec;
+	int64_t dt = (int64_t)(Timestamp - vLastTime);
+
+	if (vbTimeValid == false || dt > INT32_MAX || dt < INT32_MIN)
+	{
+		// Resync absolute time
+		hdr->Type = SENSSTRM_REC_TIME;
+		hdr->Len = sizeof(uint64_t);
+		hdr->dTime = 0;
+		memcpy(&rec[sizeof(SENSSTRM_RECHDR)], &Timestamp, sizeof(uint64_t));
+		if (Write(rec, sizeof(SENSSTRM_RECHDR) + sizeof(uint64_t)) == false)
+		{
+			return false;
+		}
+		vbTimeValid = true;
+		dt = 0;
+	}
+
+	hdr->Type = Type;
+	hdr->Len = Len;
+	hdr->dTime = (int32_t)dt;
+	memcpy(&rec[sizeof(SENSSTRM_RECHDR)], pData, Len);
+
+	if (Write(rec, sizeof(SENSSTRM_RECHDR) + Len) == false)
+	{
+		return false;
+	}
+
+	vLastTime = Timestamp;
+	vRecCnt++;
+
+	return true;
+}
+
+bool SensorRecorder::UpdateConfig(SENSSTRM_REC_TYPE Type, uint64_t Timestamp, uint16_t Scale, uint16_t Range, uint32_t Freq)
+{
+	SENSSTRM_CFG *cfg = &vChanCfg[Type];
+
+	if (cfg->RecType == Type && cfg->Scale == Scale && cfg->Range == Range && cfg->Freq == Freq)
+	{
+		return true;
+	}
+
+	cfg->RecType = Type;
+	cfg->Scale = Scale;
+	cfg->Range = Range;
+	cfg->Freq = Freq;
+
+	return Record(SENSSTRM_REC_CFG, Timestamp, cfg, sizeof(SENSSTRM_CFG));
+}
+
+bool SensorRecorder::Record(AccelSensor &Sensor)
+{
+	ACCELSENSOR_RAWDATA data;
+
+	Sensor.Read(data);
+
+	if (data.Timestamp != 0 && data.Timestamp == vChanTime[SENSSTRM_REC_ACCEL])
+	{
+		return false;
+	}
+
+	vChanTime[SENSSTRM_REC_ACCEL] = data.Timestamp;
+
+	UpdateConfig(SENSSTRM_REC_ACCEL, data.Timestamp, data.Scale, data.Range, Sensor.SamplingFrequency());
+
+	return Record(SENSSTRM_REC_ACCEL, data.Timestamp, data.Val, sizeof(SENSSTRM_XYZ));
+}
+
+bool SensorRecorder::Record(GyroSensor &Sensor)
+{
+	GYROSENSOR_RAWDATA data;
+
+	Sensor.Read(data);
+
+	if (data.Timestamp != 0 && data.Timestamp == vChanTime[SENSSTRM_REC_GYRO])
+	{
+		return false;
+	}
+
+	vChanTime[SENSSTRM_REC_GYRO] = data.Timestamp;
+
+	UpdateConfig(SENSSTRM_REC_GYRO, data.Timestamp, data.Scale, data.Range, Sensor.SamplingFrequency());
+
+	return Record(SENSSTRM_REC_GYRO, data.Timestamp, data.Val, sizeof(SENSSTRM_XYZ));
+}
+
+bool SensorRecorder::Record(MagSensor &Sensor)
+{
+	MAGSENSOR_RAWDATA data;
+
+	Sensor.Read(data);
+
+	if (data.Timestamp != 0 && data.Timestamp == vChanTime[SENSSTRM_REC_MAG])
+	{
+		return false;
+	}
+
+	vChanTime[SENSSTRM_REC_MAG] = data.Timestamp;
+
+	UpdateConfig(SENSSTRM_REC_MAG, data.Timestamp, data.Scale, data.Range, Sensor.SamplingFrequency());
+
+	return Record(SENSSTRM_REC_MAG, data.Timestamp, data.Val, sizeof(SENSSTRM_XYZ));
+}
+
+bool SensorRecorder::Record(TempSensor &Sensor)
+{
+	TEMPSENSOR_DATA data;
+
+	Sensor.Read(data);
+
+	if (data.Timestamp != 0 && data.Timestamp == vChanTime[SENSSTRM_REC_TEMP])
+	{
+		return false;
+	}
+
+	vChanTime[SENSSTRM_REC_TEMP] = data.Timestamp;
+
+	UpdateConfig(SENSSTRM_REC_TEMP, data.Timestamp, 0, 0, Sensor.SamplingFrequency());
+
+	return Record(SENSSTRM_REC_TEMP, data.Timestamp, &data.Temperature, sizeof(data.Temperature));
+}
+
+bool SensorRecorder::Record(HumiSensor &Sensor)
+{
+	HUMISENSOR_DATA data;
+
+	Sensor.Read(data);
+
+	if (data.Timestamp != 0 && data.Timestamp == vChanTime[SENSSTRM_REC_HUMI])
+	{
+		return false;
+	}
+
+	vChanTime[SENSSTRM_REC_HUMI] = data.Timestamp;
+
+	UpdateConfig(SENSSTRM_REC_HUMI, data.Timestamp, 0, 0, Sensor.SamplingFrequency());
+
+	return Record(SENSSTRM_REC_HUMI, data.Timestamp, &data.Humidity, sizeof(data.Humidity));
+}
+
+bool SensorRecorder::Record(PressSensor &Sensor)
+{
+	PRESSSENSOR_DATA data;
+
+	Sensor.Read(data);
+
+	if (data.Timestamp != 0 && data.Timestamp == vChanTime[SENSSTRM_REC_PRESS])
+	{
+		return false;
+	}
+
+	vChanTime[SENSSTRM_REC_PRESS] = data.Timestamp;
+
+	UpdateConfig(SENSSTRM_REC_PRESS, data.Timestamp, 0, 0, Sensor.SamplingFrequency());
+
+	return Record(SENSSTRM_REC_PRESS, data.Timestamp, &data.Pressure, sizeof(data.Pressure));
+}
+
+bool SensorRecorder::Record(TphSensor &Sensor)
+{
+	TPHSENSOR_DATA data;
+	SENSSTRM_TPH tph;
+
+	Sensor.Read(data);
+
+	if (data.Timestamp != 0 && data.Timestamp == vChanTime[SENSSTRM_REC_TPH])
+	{
+		return false;
+	}
+
+	vChanTime[SENSSTRM_REC_TPH] = data.Timestamp;
+
+	UpdateConfig(SENSSTRM_REC_TPH, data.Timestamp, 0, 0, Sensor.SamplingFrequency());
+
+	tph.Pressure = data.Pressure;
+	tph.Temperature = data.Temperature;
+	tph.Humidity = data.Humidity;
+
+	return Record(SENSSTRM_REC_TPH, data.Timestamp, &tph, sizeof(SENSSTRM_TPH));
+}
+
+bool SensorRecorder::Record(GasSensor &Sensor)
+{
+	GASSENSOR_DATA data;
+	SENSSTRM_GAS gas;
+
+	Sensor.Read(data);
+
+	if (data.Timestamp != 0 && data.Timestamp == vChanTime[SENSSTRM_REC_GAS])
+	{
+		return false;
+	}
+
+	vChanTime[SENSSTRM_REC_GAS] = data.Timestamp;
+
+	UpdateConfig(SENSSTRM_REC_GAS, data.Timestamp, 0, 0, Sensor.SamplingFrequency());
+
+	memcpy(gas.GasRes, data.GasRes, sizeof(gas.GasRes));
+	gas.MeasIdx = data.MeasIdx;
+	gas.AirQualIdx = data.AirQualIdx;
+
+	return Record(SENSSTRM_REC_GAS, data.Timestamp, &gas, sizeof(SENSSTRM_GAS));
+}
+
+bool SensorRecorder::Record(Imu &Dev)
+{
+	ACCELSENSOR_RAWDATA accel;
+	GYROSENSOR_RAWDATA gyro;
+	MAGSENSOR_RAWDATA mag;
+	IMU_QUAT quat;
+	bool res = false;
+
+	if (Dev.Read(accel) && (accel.Timestamp == 0 || accel.Timestamp != vChanTime[SENSSTRM_REC_ACCEL]))
+	{
+		vChanTime[SENSSTRM_REC_ACCEL] = accel.Timestamp;
+		UpdateConfig(SENSSTRM_REC_ACCEL, accel.Timestamp, accel.Scale, accel.Range, Dev.Rate());
+		res |= Record(SENSSTRM_REC_ACCEL, accel.Timestamp, accel.Val, sizeof(SENSSTRM_XYZ));
+	}
+
+	if (Dev.Read(gyro) && (gyro.Timestamp == 0 || gyro.Timestamp != vChanTime[SENSSTRM_REC_GYRO]))
+	{
+		vChanTime[SENSSTRM_REC_GYRO] = gyro.Timestamp;
+		UpdateConfig(SENSSTRM_REC_GYRO, gyro.Timestamp, gyro.Scale, gyro.Range, Dev.Rate());
+		res |= Record(SENSSTRM_REC_GYRO, gyro.Timestamp, gyro.Val, sizeof(SENSSTRM_XYZ));
+	}
+
+	if (Dev.Read(mag) && (mag.Timestamp == 0 || mag.Timestamp != vChanTime[SENSSTRM_REC_MAG]))
+	{
+		vChanTime[SENSSTRM_REC_MAG] = mag.Timestamp;
+		UpdateConfig(SENSSTRM_REC_MAG, mag.Timestamp, mag.Scale, mag.Range, Dev.Rate());
+		res |= Record(SENSSTRM_REC_MAG, mag.Timestamp, mag.Val, sizeof(SENSSTRM_XYZ));
+	}
+
+	if ((Dev.Feature() & IMU_FEATURE_QUATERNION) && Dev.Read(quat) &&
+		(quat.Timestamp == 0 || quat.Timestamp != vChanTime[SENSSTRM_REC_QUAT]))
+	{
+		vChanTime[SENSSTRM_REC_QUAT] = quat.Timestamp;
+		res |= Record(SENSSTRM_REC_QUAT, quat.Timestamp, quat.Q, sizeof(quat.Q));
+	}
+
+	return res;
+}
+
+ReplaySensor::ReplaySensor()
+{
+	vReadCB = NULL;
+	vpCtx = NULL;
+	vSpeed = 0;
+	vbEos = true;
+	vbPending = false;
+	vbStarted = false;
+	vStreamTime = 0;
+	vStreamStart = 0;
+	vPlayLast = 0;
+	vPlayTime = 0;
+	memset(&vQuat, 0, sizeof(vQuat));
+	memset(&vTempData, 0, sizeof(vTempData));
+	vDataRdyHandler = NULL;
+	vEvtHandler = NULL;
+}
+
+bool ReplaySensor::Init(const SENSREPLAY_CFG &Cfg, Timer * const pTimer)
+{
+	SENSSTRM_HDR hdr;
+
+	if (Cfg.ReadCB == NULL)
+	{
+		return false;
+	}
+
+	vReadCB = Cfg.ReadCB;
+	vpCtx = Cfg.pCtx;
+	vSpeed = Cfg.Speed;
+	vpTimer = pTimer;
+	vbPending = false;
+	vbStarted = false;
+	vStreamTime = 0;
+
+	memset(&(AccelSensor::vData), 0, sizeof(ACCELSENSOR_RAWDATA));
+	memset(&(GyroSensor::vData), 0, sizeof(GYROSENSOR_RAWDATA));
+	memset(&(MagSensor::vData), 0, sizeof(MAGSENSOR_RAWDATA));
+	memset(&vTphData, 0, sizeof(TPHSENSOR_DATA));
+	memset(&vGasData, 0, sizeof(GASSENSOR_DATA));
+	memset(&vQuat, 0, sizeof(IMU_QUAT));
+	memset(&vTempData, 0, sizeof(TEMPSENSOR_DATA));
+
+	AccelSensor::Type(SENSOR_TYPE_ACCEL);
+	GyroSensor::Type(SENSOR_TYPE_GYRO);
+	MagSensor::Type(SENSOR_TYPE_MAG);
+	TphSensor::Type(SENSOR_TYPE_TEMP);
+
+	if (vReadCB(vpCtx, (uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr) ||
+		hdr.Magic != SENSSTRM_MAGIC || hdr.Version != SENSSTRM_VERSION)
+	{
+		vbEos = true;
+		Valid(false);
+
+		return false;
+	}
+
+	vbEos = false;
+	Valid(true);
+
+	return true;
+}
+
+bool ReplaySensor::Init(const ACCELSENSOR_CFG &Cfg, DeviceIntrf * const pIntrf, Timer * const pTimer)
+{
+	(void)pIntrf;
+	(void)pTimer;
+
+	AccelSensor::vOpMode = Cfg.OpMode;
+	AccelSensor::SamplingFrequency(Cfg.Freq);
+
+	return Valid();
+}
+
+bool ReplaySensor::Init(const GYROSENSOR_CFG &Cfg, DeviceIntrf * const pIntrf, Timer * const pTimer)
+{
+	(void)pIntrf;
+	(void)pTimer;
+
+	GyroSensor::vOpMode = Cfg.OpMode;
+	GyroSensor::SamplingFrequency(Cfg.Freq);
+
+	return Valid();
+}
+
+bool ReplaySensor::Init(const MAGSENSOR_CFG &Cfg, DeviceIntrf * const pIntrf, Timer * const pTimer)
+{
+	(void)pIntrf;
+	(void)pTimer;
+
+	MagSensor::vOpMode = Cfg.OpMode;
+	MagSensor::SamplingFrequency(Cfg.Freq);
+
+	return Valid();
+}
+
+bool ReplaySensor::Init(const TPHSENSOR_CFG &Cfg, DeviceIntrf * const pIntrf, Timer * const pTimer)
+{
+	(void)pIntrf;
+	(void)pTimer;
+
+	TphSensor::vOpMode = Cfg.OpMode;
+	TphSensor::SamplingFrequency(Cfg.Freq);
+	vDataRdyHandler = Cfg.DataRdyCB;
+
+	return Valid();
+}
+
+bool ReplaySensor::Init(const GASSENSOR_CFG &Cfg, DeviceIntrf * const pIntrf, Timer * const pTimer)
+{
+	(void)pIntrf;
+	(void)pTimer;
+
+	GasSensor::vOpMode = Cfg.OpMode;
+	GasSensor::SamplingFrequency(Cfg.Freq);
+
+	return Valid();
+}
+
+bool ReplaySensor::Enable()
+{
+	Reset();
+
+	return Valid();
+}
+
+void ReplaySensor::Disable()
+{
+	AccelSensor::State(SENSOR_STATE_SLEEP);
+}
+
+void ReplaySensor::Reset()
+{
+	vbStarted = false;
+}
+
+bool ReplaySensor::Mode(SENSOR_OPMODE OpMode, uint32_t Freq)
+{
+	// Only one timer trigger is needed to pace all replayed sensors
+	GyroSensor::vOpMode = OpMode;
+	MagSensor::vOpMode = OpMode;
+	TphSensor::vOpMode = OpMode;
+	GasSensor::vOpMode = OpMode;
+
+	return AccelSensor::Mode(OpMode, Freq);
+}
+
+bool ReplaySensor::StartSampling()
+{
+	return vbEos == false;
+}
+
+/**
+ * @brief	Read next record from stream into pending record
+ *
+ * @return	true - Success
+ * 			false - End of stream
+ */
+bool ReplaySensor::ReadRecord()
+{
+	while (vbEos == false)
+	{
+		if (vReadCB(vpCtx, (uint8_t*)&vRecHdr, sizeof(SENSSTRM_RECHDR)) != sizeof(SENSSTRM_RECHDR) ||
+			vRecHdr.Len > SENSSTRM_REC_PAYLOAD_MAX ||
+			vReadCB(vpCtx, vRecData, vRecHdr.Len) != vRecHdr.Len)
+		{
+			vbEos = true;
+			break;
+		}
+
+		if (vRecHdr.Type == SENSSTRM_REC_TIME)
+		{
+			memcpy(&vStreamTime, vRecData, sizeof(uint64_t));
+			continue;
+		}
+
+		vStreamTime += vRecHdr.dTime;
+		vbPending = true;
+
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief	Apply pending record to sensor data
+ *
+ * @return	Type of the record applied
+ */
+SENSSTRM_REC_TYPE ReplaySensor::ApplyRecord()
+{
+	SENSSTRM_XYZ *xyz = (SENSSTRM_XYZ*)vRecData;
+
+	vbPending = false;
+
+	switch (vRecHdr.Type)
+	{
+		case SENSSTRM_REC_CFG:
+			{
+				SENSSTRM_CFG *cfg = (SENSSTRM_CFG*)vRecData;
+
+				switch (cfg->RecType)
+				{
+					case SENSSTRM_REC_ACCEL:
+						AccelSensor::vData.Scale = cfg->Scale;
+						AccelSensor::vData.Range = cfg->Range;
+						AccelSensor::Scale(cfg->Scale);
+						AccelSensor::Range(cfg->Range);
+						AccelSensor::SamplingFrequency(cfg->Freq);
+						break;
+					case SENSSTRM_REC_GYRO:
+						GyroSensor::vData.Scale = cfg->Scale;
+						GyroSensor::vData.Range = cfg->Range;
+						GyroSensor::SamplingFrequency(cfg->Freq);
+						break;
+					case SENSSTRM_REC_MAG:
+						MagSensor::vData.Scale = cfg->Scale;
+						MagSensor::vData.Range = cfg->Range;
+						MagSensor::SamplingFrequency(cfg->Freq);
+						break;
+					case SENSSTRM_REC_GAS:
+						GasSensor::SamplingFrequency(cfg->Freq);
+						break;
+					case SENSSTRM_REC_TEMP:
+					case SENSSTRM_REC_HUMI:
+					case SENSSTRM_REC_PRESS:
+					case SENSSTRM_REC_TPH:
+						TphSensor::SamplingFrequency(cfg->Freq);
+						break;
+				}
+			}
+			break;
+		case SENSSTRM_REC_ACCEL:
+			memcpy(AccelSensor::vData.Val, xyz->Val, sizeof(SENSSTRM_XYZ));
+			AccelSensor::vData.Timestamp = vStreamTime;
+			AccelSensor::vSampleTime = vStreamTime;
+			AccelSensor::vSampleCnt++;
+			break;
+		case SENSSTRM_REC_GYRO:
+			memcpy(GyroSensor::vData.Val, xyz->Val, sizeof(SENSSTRM_XYZ));
+			GyroSensor::vData.Timestamp = vStreamTime;
+			GyroSensor::vSampleTime = vStreamTime;
+			GyroSensor::vSampleCnt++;
+			break;
+		case SENSSTRM_REC_MAG:
+			memcpy(MagSensor::vData.Val, xyz->Val, sizeof(SENSSTRM_XYZ));
+			MagSensor::vData.Timestamp = vStreamTime;
+			MagSensor::vSampleTime = vStreamTime;
+			MagSensor::vSampleCnt++;
+			break;
+		case SENSSTRM_REC_TEMP:
+			// Recorded from TEMPSENSOR_DATA, restored at the same width.  The
+			// TPH view only holds 16 bits
+			memcpy(&vTempData.Temperature, vRecData, sizeof(vTempData.Temperature));
+			vTempData.Timestamp = vStreamTime;
+			vTphData.Temperature = (int16_t)vTempData.Temperature;
+			vTphData.Timestamp = vStreamTime;
+			TphSensor::vSampleTime = vStreamTime;
+			TphSensor::vSampleCnt++;
+			break;
+		case SENSSTRM_REC_HUMI:
+			memcpy(&vTphData.Humidity, vRecData, sizeof(uint16_t));
+			vTphData.Timestamp = vStreamTime;
+			break;
+		case SENSSTRM_REC_PRESS:
+			memcpy(&vTphData.Pressure, vRecData, sizeof(uint32_t));
+			vTphData.Timestamp = vStreamTime;
+			break;
+		case SENSSTRM_REC_TPH:
+			{
+				SENSSTRM_TPH *tph = (SENSSTRM_TPH*)vRecData;
+
+				vTphData.Pressure = tph->Pressure;
+				vTphData.Temperature = tph->Temperature;
+				vTphData.Humidity = tph->Humidity;
+				vTphData.Timestamp = vStreamTime;
+				vTempData.Temperature = tph->Temperature;
+				vTempData.Timestamp = vStreamTime;
+				TphSensor::vSampleTime = vStreamTime;
+				TphSensor::vSampleCnt++;
+			}
+			break;
+		case SENSSTRM_REC_GAS:
+			{
+				SENSSTRM_GAS *gas = (SENSSTRM_GAS*)vRecData;
+
+				memcpy(vGasData.GasRes, gas->GasRes, sizeof(vGasData.GasRes));
+				vGasData.MeasIdx = gas->MeasIdx;
+				vGasData.AirQualIdx = gas->AirQualIdx;
+				vGasData.Timestamp = vStreamTime;
+				GasSensor::vSampleTime = vStreamTime;
+				GasSensor::vSampleCnt++;
+			}
+			break;
+		case SENSSTRM_REC_QUAT:
+			memcpy(vQuat.Q, vRecData, sizeof(vQuat.Q));
+			vQuat.Timestamp = vStreamTime;
+			break;
+		default:
+			// Unknown record, skip
+			break;
+	}
+
+	return (SENSSTRM_REC_TYPE)vRecHdr.Type;
+}
+
+static inline bool IsTphRecord(SENSSTRM_REC_TYPE Type)
+{
+	return Type == SENSSTRM_REC_TEMP || Type == SENSSTRM_REC_HUMI ||
+		   Type == SENSSTRM_REC_PRESS || Type == SENSSTRM_REC_TPH;
+}
+
+bool ReplaySensor::UpdateData()
+{
+	bool retval = false;
+	bool tph = false;
+
+	if (vbPending == false && ReadRecord() == false)
+	{
+		return false;
+	}
+
+	if (vSpeed == 0 || vpTimer == NULL)
+	{
+		// Replay one sample frame
+		uint64_t t = vStreamTime;
+
+		do {
+			tph |= IsTphRecord(ApplyRecord());
+			retval = true;
+		} while (ReadRecord() && vStreamTime == t);
+	}
+	else
+	{
+		uint32_t now = vpTimer->uSecond();
+
+		if (vbStarted == false)
+		{
+			vPlayLast = now;
+			vPlayTime = 0;
+			vStreamStart = vStreamTime;
+			vbStarted = true;
+		}
+
+		// Usec count wraps every 71 minutes, elapsed time is accumulated
+		vPlayTime += (uint32_t)(now - vPlayLast);
+		vPlayLast = now;
+
+		uint64_t t = vStreamStart + vPlayTime * vSpeed;
+
+		while (vbPending && (int64_t)(vStreamTime - t) <= 0)
+		{
+			tph |= IsTphRecord(ApplyRecord());
+			retval = true;
+			ReadRecord();
+		}
+	}
+
+	if (tph && vDataRdyHandler)
+	{
+		TPHSENSOR_DATA tph = vTphData;
+		vDataRdyHandler(this, &tph);
+	}
+
+	if (retval && vEvtHandler)
+	{
+		vEvtHandler((AccelSensor*)this, DEV_EVT_DATA_RDY);
+	}
+
+	return retval;
+}
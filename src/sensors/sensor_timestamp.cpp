@@ -0,0 +1,197 @@
+/**-------------------------------------------------------------------------
+@file	sensor_timestamp.cpp
+
+@brief	Sample time stamp estimator for batched sensor data
+
+See sensor_timestamp.h for the estimation method.
+
+@date	Oct. 19, 2026
+
+@license
+
+Copyright (c) 2026, I-SYST inc., all rights reserved
+
+Permission to use, copy, modify, and distribute this software for any purpose
+with or without fee is hereby granted, provided that the above copyright
+notice and this permission notice appear in all copies, and none of the
+names : I-SYST or its contributors may be used to endorse or
+promote products derived from this software without specific prior written
+permission.
+
+For info or contributing contact : hnhoan at i-syst dot com
+
+THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------------*/
+#include "sensors/sensor_timestamp.h"
+
+SensorTimeEst::SensorTimeEst()
+{
+	Init(1000000000ULL);
+}
+
+bool SensorTimeEst::Init(uint64_t nsPeriod, uint32_t MaxDrift, int WinSize)
+{
+	if (nsPeriod == 0 || WinSize < 2 || WinSize > SENSTS_WIN_MAX)
+	{
+		return false;
+	}
+
+	vNomPeriod = (float)nsPeriod / 1000.0;
+	vPeriod = vNomPeriod;
+	vMaxDrift = (float)MaxDrift / 1000000.0;
+	vWinSize = WinSize;
+
+	Reset();
+
+	return true;
+}
+
+void SensorTimeEst::Reset()
+{
+	vNbObs = 0;
+	vObsIdx = 0;
+	vCount = 0;
+	vRefIdx = 0;
+	vRefTime = 0;
+	vbLastValid = false;
+}
+
+void SensorTimeEst::Update(uint64_t ReadTime, int NbNew)
+{
+	if (NbNew <= 0)
+	{
+		// Nothing new, observation carries no information
+		return;
+	}
+
+	vCount += NbNew;
+
+	vObsSmpl[vObsIdx] = vCount - 1;
+	vObsTime[vObsIdx] = ReadTime;
+	vObsIdx = vObsIdx + 1 < vWinSize ? vObsIdx + 1 : 0;
+
+	if (vNbObs < vWinSize)
+	{
+		vNbObs++;
+	}
+
+	Fit();
+}
+
+void SensorTimeEst::Update(Timer * const pTimer, int NbNew)
+{
+	// 64 bits usec from tick count, split to not overflow the multiplication
+	uint64_t tick = pTimer->TickCount();
+	uint32_t freq = pTimer->Frequency();
+
+	Update(tick / freq * 1000000ULL + tick % freq * 1000000ULL / freq, NbNew);
+}
+
+// Fit time model T(Idx) = vRefTime + vPeriod * (Idx - vRefIdx) on observations.
+// Values are relative to the oldest observation to keep float precision.
+void SensorTimeEst::Fit()
+{
+	int first = vObsIdx - vNbObs;
+	int last = vObsIdx > 0 ? vObsIdx - 1 : vWinSize - 1;
+
+	if (first < 0)
+	{
+		first += vWinSize;
+	}
+
+	uint32_t idx0 = vObsSmpl[first];
+	uint64_t t0 = vObsTime[first];
+
+	if (vNbObs > 1)
+	{
+		float mx = 0.0, my = 0.0;
+
+		for (int i = 0, k = first; i < vNbObs; i++, k = k + 1 < vWinSize ? k + 1 : 0)
+		{
+			mx += (float)(vObsSmpl[k] - idx0);
+			my += (float)(int64_t)(vObsTime[k] - t0);
+		}
+
+		mx /= vNbObs;
+		my /= vNbObs;
+
+		float sxx = 0.0, sxy = 0.0;
+
+		for (int i = 0, k = first; i < vNbObs; i++, k = k + 1 < vWinSize ? k + 1 : 0)
+		{
+			float dx = (float)(vObsSmpl[k] - idx0) - mx;
+			float dy = (float)(int64_t)(vObsTime[k] - t0) - my;
+
+			sxx += dx * dx;
+			sxy += dx * dy;
+		}
+
+		if (sxx > 0.0)
+		{
+			float p = sxy / sxx;
+			float pmin = vNomPeriod * (1.0 - vMaxDrift);
+			float pmax = vNomPeriod * (1.0 + vMaxDrift);
+
+			p = p < pmin ? pmin : (p > pmax ? pmax : p);
+
+			// Smooth slope noise from read jitter
+			vPeriod += (p - vPeriod) * SENSTS_PERIOD_FILTER;
+		}
+	}
+
+	// Samples are produced before being read, offset is the lowest one
+	float c = 0.0;
+
+	for (int i = 0, k = first; i < vNbObs; i++, k = k + 1 < vWinSize ? k + 1 : 0)
+	{
+		float r = (float)(int64_t)(vObsTime[k] - t0) - vPeriod * (float)(vObsSmpl[k] - idx0);
+
+		if (r < c)
+		{
+			c = r;
+		}
+	}
+
+	// Reference on newest sample
+	vRefIdx = vObsSmpl[last];
+	vRefTime = t0 + (int64_t)(c + vPeriod * (float)(vRefIdx - idx0));
+}
+
+uint64_t SensorTimeEst::SampleTime(uint32_t Idx)
+{
+	int32_t d = (int32_t)(Idx - vRefIdx);
+	int64_t t = (int64_t)vRefTime + (int64_t)(vPeriod * (float)d);
+
+	if (t < 0)
+	{
+		t = 0;
+	}
+
+	if (vbLastValid && (int32_t)(Idx - vLastIdx) <= 0)
+	{
+		// Older sample requested, no monotonic constraint
+		return (uint64_t)t;
+	}
+
+	if (vbLastValid && (uint64_t)t <= vLastTime)
+	{
+		// Model was corrected backward, keep time stamps increasing
+		t = vLastTime + 1;
+	}
+
+	vLastIdx = Idx;
+	vLastTime = t;
+	vbLastValid = true;
+
+	return (uint64_t)t;
+}
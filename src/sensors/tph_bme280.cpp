@@ -46,6 +46,19 @@ Modified by          Date              Description
 
 //static BME280_CALIB_DATA s_Bme280CalibData;
 
+// Register shadow : CTRL_HUM, STATUS, CTRL_MEAS, CONFIG
+// Status is volatile.  CTRL_MEAS mode bits are stable as forced mode is not used by this driver
+static const uint8_t s_Bme280RegVolMap[] = { 1 << (BME280_REG_STATUS - BME280_REG_SHADOW_START) };
+static const uint8_t s_Bme280RegWrMap[] = { (uint8_t)~(1 << (BME280_REG_STATUS - BME280_REG_SHADOW_START)) };
+
+static const DEVREGSHADOW_CFG s_Bme280RegShadowCfg = {
+	BME280_REG_SHADOW_START,
+	BME280_REG_SHADOW_NBREG,
+	false,				// I2C writes require address/data pairs, no auto increment
+	s_Bme280RegWrMap,
+	s_Bme280RegVolMap
+};
+
 // Returns temperature in DegC, resolution is 0.01 DegC. Output value of “5123” equals 51.23 DegC.
 // t_fine carries fine temperature as global value
 int32_t TphBme280::CompenTemp(int32_t adc_T)
@@ -119,6 +132,7 @@ bool TphBme280::Init(uint32_t DevAddr, DeviceIntrf *pIntrf, Timer *pTimer)
 
 	Interface(pIntrf);
 	DeviceAddess(DevAddr);
+	RegShadowInit(&s_Bme280RegShadowCfg, vRegShadow);
 
 	if (pTimer != NULL)
 	{
@@ -166,9 +180,6 @@ bool TphBme280::Init(uint32_t DevAddr, DeviceIntrf *pIntrf, Timer *pTimer)
 	vCalibData.dig_H5 = ((int16_t)cd[5] << 4) | (cd[4] >> 4);
 	vCalibData.dig_H6 = cd[6];
 
-	regaddr = BME280_REG_CTRL_MEAS;
-	Read(&regaddr, 1, &vCtrlReg, 1);
-
 	return true;
 }
 
@@ -196,7 +207,12 @@ bool TphBme280::Init(const HUMISENSOR_CFG &CfgData, DeviceIntrf *pIntrf, Timer *
 		}
 
 		regaddr = BME280_REG_CTRL_HUM;
-		Write((uint8_t*)&regaddr, 1, &d, 1);
+		Write8(&regaddr, 1, d);
+
+		// CTRL_HUM only takes effect after a write to CTRL_MEAS.  Make sure the
+		// next CTRL_MEAS write is not skipped even if its value is unchanged
+		regaddr = BME280_REG_CTRL_MEAS;
+		RegShadowMarkDirty(&regaddr, 1);
 
 		//State(SENSOR_STATE_SLEEP);
 
@@ -207,31 +223,21 @@ bool TphBme280::Init(const HUMISENSOR_CFG &CfgData, DeviceIntrf *pIntrf, Timer *
 
 bool TphBme280::Init(const PRESSSENSOR_CFG &CfgData, DeviceIntrf *pIntrf, Timer *pTimer)
 {
-	vCtrlReg &= ~BME280_REG_CTRL_MEAS_OSRS_P_MASK;
-	vCtrlReg |= (CfgData.PresOvrs << BME280_REG_CTRL_MEAS_OSRS_P_BITPOS) & BME280_REG_CTRL_MEAS_OSRS_P_MASK;
-
 	uint8_t regaddr = BME280_REG_CTRL_MEAS;
-	Write((uint8_t*)&regaddr, 1, &vCtrlReg, 1);
+
+	Update8(&regaddr, 1, BME280_REG_CTRL_MEAS_OSRS_P_MASK, CfgData.PresOvrs << BME280_REG_CTRL_MEAS_OSRS_P_BITPOS);
 
 	return true;
 }
 
 bool TphBme280::Init(const TEMPSENSOR_CFG &CfgData, DeviceIntrf *pIntrf, Timer *pTimer)
 {
-	uint8_t d;
 	uint8_t regaddr = BME280_REG_CONFIG;
 
-	Read((uint8_t*)&regaddr, 1, &d, 1);
-
-	d &= ~BME280_REG_CONFIG_FILTER_MASK;
-	d |= (CfgData.FilterCoeff << BME280_REG_CONFIG_FILTER_BITPOS) & BME280_REG_CONFIG_FILTER_MASK;
-	Write((uint8_t*)&regaddr, 1, &d, 1);
-
-	vCtrlReg &= ~BME280_REG_CTRL_MEAS_OSRS_T_MASK;
-	vCtrlReg |= (CfgData.TempOvrs << BME280_REG_CTRL_MEAS_OSRS_T_BITPOS) & BME280_REG_CTRL_MEAS_OSRS_T_MASK;
+	Update8(&regaddr, 1, BME280_REG_CONFIG_FILTER_MASK, CfgData.FilterCoeff << BME280_REG_CONFIG_FILTER_BITPOS);
 
 	regaddr = BME280_REG_CTRL_MEAS;
-	Write((uint8_t*)&regaddr, 1, &vCtrlReg, 1);
+	Update8(&regaddr, 1, BME280_REG_CTRL_MEAS_OSRS_T_MASK, CfgData.TempOvrs << BME280_REG_CTRL_MEAS_OSRS_T_BITPOS);
 
 	Mode(CfgData.OpMode, CfgData.Freq);
 
@@ -254,8 +260,7 @@ SENSOR_STATE TphBme280::State(SENSOR_STATE State) {
 	if (State == SENSOR_STATE_SLEEP)
 	{
 		uint8_t regaddr = BME280_REG_CTRL_MEAS;
-		vCtrlReg &= ~BME280_REG_CTRL_MEAS_MODE_MASK;
-		Write(&regaddr, 1, &vCtrlReg, 1);
+		Update8(&regaddr, 1, BME280_REG_CTRL_MEAS_MODE_MASK, BME280_REG_CTRL_MEAS_MODE_SLEEP);
 	}
 
 	return TempSensor::State(State);
@@ -280,12 +285,6 @@ bool TphBme280::Mode(SENSOR_OPMODE OpMode, uint32_t Freq)
 
 	TempSensor::SamplingFrequency(Freq);
 
-	// read current ctrl_meas register
-	regaddr = BME280_REG_CTRL_MEAS;
-	Read(&regaddr, 1, &vCtrlReg, 1);
-
-	vCtrlReg &= ~BME280_REG_CTRL_MEAS_MODE_MASK;
-
 	if (TempSensor::vOpMode == SENSOR_OPMODE_CONTINUOUS)
 	{
 		uint32_t period = 1000 / Freq;
@@ -323,7 +322,7 @@ bool TphBme280::Mode(SENSOR_OPMODE OpMode, uint32_t Freq)
 		}
 
 		regaddr = BME280_REG_CONFIG;
-		Write(&regaddr, 1, &d, 1);
+		Write8(&regaddr, 1, d);
 	}
 
 	//StartSampling();
@@ -354,9 +353,7 @@ bool TphBme280::StartSampling()
 		return false;
 
 	regaddr = BME280_REG_CTRL_MEAS;
-	d = vCtrlReg | BME280_REG_CTRL_MEAS_MODE_NORMAL;
-
-	Write(&regaddr, 1, &d, 1);
+	Update8(&regaddr, 1, BME280_REG_CTRL_MEAS_MODE_MASK, BME280_REG_CTRL_MEAS_MODE_NORMAL);
 
 	TempSensor::vbSampling = true;
 
@@ -390,6 +387,9 @@ void TphBme280::Reset()
 	uint8_t d = BME280_REG_RESET_VAL;
 
 	Write(&addr, 1, &d, 1);
+
+	// All control registers are back to default
+	RegShadowInvalidate();
 }
 
 bool TphBme280::UpdateData()
@@ -86,6 +86,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "idelay.h"
 #include "device_intrf.h"
+#include "device_regseq.h"
 #include "coredev/iopincfg.h"
 #include "sensors/tphg_bme680.h"
 #include "bsec_interface.h"
@@ -248,6 +249,26 @@ uint8_t TphgBme680::CalcHeaterResistance(uint16_t Temp)
 	return hres;
 }
 
+// Register sequence executor.  Registers do not auto increment on write,
+// writes are merged as register/data pairs
+static const DEVREGSEQ_CFG s_Bme680I2cRegSeqCfg = {
+	1,							// Address length
+	DEVREGSEQ_WRMODE_PAIR,		// Merge writes in register/data pairs
+	0xFF,						// Full register address in pairs
+	1000,						// Poll interval usec
+	0,							// Timer trigger, not used
+};
+
+// In SPI mode, bit 7 of the register address selects the memory page
+// and is replaced by the R/W bit.  Only registers of the same page are merged
+static const DEVREGSEQ_CFG s_Bme680SpiRegSeqCfg = {
+	1,							// Address length
+	DEVREGSEQ_WRMODE_PAIR,		// Merge writes in register/data pairs
+	0x7F,						// Page bit is not sent
+	1000,						// Poll interval usec
+	0,							// Timer trigger, not used
+};
+
 // TPH sensor init
 bool TphgBme680::Init(const TPHSENSOR_CFG &CfgData, DeviceIntrf *pIntrf, Timer *pTimer)
 {
@@ -297,36 +318,34 @@ bool TphgBme680::Init(const TPHSENSOR_CFG &CfgData, DeviceIntrf *pIntrf, Timer *
 
 	Reset();
 
-	usDelay(30000);
-
 	// Load calibration data
+	// RES_HEAT_VAL, RES_HEAT_RANGE & RANGE_SW_ERR are read as one block
+	uint8_t cd[24 + 16 + 5];
+	DEVREGSEQ calseq[] = {
+		DEVREGSEQ_DELAY(30000),
+		DEVREGSEQ_READ(BME680_REG_CALIB_00_23_START, 24, 0),
+		DEVREGSEQ_READ(BME680_REG_CALIB_24_40_START, 16, 24),
+		DEVREGSEQ_READ(BME680_REG_RES_HEAT_VAL, 5, 40),
+		DEVREGSEQ_END()
+	};
+	DevRegSeq seq;
+
+	memset(cd, 0xFF, sizeof(cd));
+	seq.Init(vbSpi ? s_Bme680SpiRegSeqCfg : s_Bme680I2cRegSeqCfg, this);
+	seq.Run(calseq, cd);
 
 	memset(&vCalibData, 0xFF, sizeof(vCalibData));
-	regaddr = BME680_REG_CALIB_00_23_START;
-	Read(&regaddr, 1, (uint8_t*)&vCalibData, 24);
+	memcpy(&vCalibData, cd, 24);
 
 	uint8_t *p =  (uint8_t*)&vCalibData;
 
-	uint8_t cd[16];
+	vCalibData.par_H1 = ((int16_t)cd[26] << 4) | (cd[25] & 0xF);
+	vCalibData.par_H2 = ((int16_t)cd[24] << 4) | (cd[25] >> 4);
+	memcpy(&p[27], &cd[27], 13);
 
-	regaddr = BME680_REG_CALIB_24_40_START;
-	Read(&regaddr, 1, cd, 16);
-
-	vCalibData.par_H1 = ((int16_t)cd[2] << 4) | (cd[1] & 0xF);
-	vCalibData.par_H2 = ((int16_t)cd[0] << 4) | (cd[1] >> 4);
-	memcpy(&p[27], &cd[3], 13);
-
-	regaddr = BME680_REG_RES_HEAT_RANGE;
-	Read(&regaddr, 1, &d, 1);
-	vCalibData.res_heat_range = (d & BME680_REG_RES_HEAT_RANGE_MASK) >> 4;
-
-	regaddr = BME680_REG_RES_HEAT_VAL;
-	Read(&regaddr, 1, &d, 1);
-	vCalibData.res_heat_val = d;
-
-	regaddr = BME680_REG_RANGE_SW_ERR;
-	Read(&regaddr, 1, &d, 1);
-	vCalibData.range_sw_err = (d & BME680_REG_RANGE_SW_ERR_MASK) >> 4;
+	vCalibData.res_heat_range = (cd[40 + BME680_REG_RES_HEAT_RANGE] & BME680_REG_RES_HEAT_RANGE_MASK) >> 4;
+	vCalibData.res_heat_val = cd[40 + BME680_REG_RES_HEAT_VAL];
+	vCalibData.range_sw_err = (cd[40 + BME680_REG_RANGE_SW_ERR] & BME680_REG_RANGE_SW_ERR_MASK) >> 4;
 
 	// Setup oversampling.  Datasheet recommend write humidity oversampling first
 	// follow by temperature & pressure in single write operation
@@ -336,9 +355,6 @@ bool TphgBme680::Init(const TPHSENSOR_CFG &CfgData, DeviceIntrf *pIntrf, Timer *
 		d = (CfgData.HumOvrs & 3);
 	}
 
-	regaddr = BME680_REG_CTRL_HUM;
-	Write((uint8_t*)&regaddr, 1, &d, 1);
-
 	// Need to keep temperature & pressure oversampling
 	// because of shared register with operating mode settings
 
@@ -354,15 +370,16 @@ bool TphgBme680::Init(const TPHSENSOR_CFG &CfgData, DeviceIntrf *pIntrf, Timer *
 		vCtrlReg |= (CfgData.PresOvrs & 3) << BME680_REG_CTRL_MEAS_OSRS_P_BITPOS;
 	}
 
-	regaddr = BME680_REG_CTRL_MEAS;
-	Write((uint8_t*)&regaddr, 1, &vCtrlReg, 1);
+	// Both control registers are sent in the same register/data pair transfer
+	DEVREGSEQ cfgseq[] = {
+		DEVREGSEQ_WRITE(BME680_REG_CTRL_HUM, d),
+		DEVREGSEQ_WRITE(BME680_REG_CTRL_MEAS, vCtrlReg),
+		DEVREGSEQ_UPDATE(BME680_REG_CONFIG, BME680_REG_CONFIG_FILTER_MASK,
+						 CfgData.FilterCoeff << BME680_REG_CONFIG_FILTER_BITPOS),
+		DEVREGSEQ_END()
+	};
 
-
-	regaddr = BME680_REG_CONFIG;
-	Read((uint8_t*)&regaddr, 1, &d, 1);
-
-	d |= (CfgData.FilterCoeff << BME680_REG_CONFIG_FILTER_BITPOS) & BME680_REG_CONFIG_FILTER_MASK;
-	Write((uint8_t*)&regaddr, 1, &d, 1);
+	seq.Run(cfgseq);
 
 	State(SENSOR_STATE_SLEEP);
 
@@ -446,8 +463,15 @@ bool TphgBme680::SetHeatingProfile(int Count, const GASSENSOR_HEAT *pProfile)
 	if (Count == 0 || pProfile == NULL)
 		return false;
 
-	uint8_t regt = BME680_REG_RES_HEAT_X_START;
-	uint8_t regd = BME680_REG_GAS_WAIT_X_START;
+	if (Count > BME680_GAS_HEAT_PROFILE_MAX)
+	{
+		Count = BME680_GAS_HEAT_PROFILE_MAX;
+	}
+
+	// All heater settings are written as register/data pairs in as few
+	// transfers as possible
+	DEVREGSEQ seq[BME680_GAS_HEAT_PROFILE_MAX * 2 + 1];
+	DevRegSeq exec;
 
 	for (int i = 0; i < Count; i++)
 	{
@@ -475,14 +499,18 @@ bool TphgBme680::SetHeatingProfile(int Count, const GASSENSOR_HEAT *pProfile)
 			dur |= (mul << 6);
 		}
 
-		Write(&regt, 1, &ht, 1);
-		Write(&regd, 1, (uint8_t*)&dur, 1);
+		DEVREGSEQ heat = DEVREGSEQ_WRITE(BME680_REG_RES_HEAT_X_START + i, ht);
+		DEVREGSEQ wait = DEVREGSEQ_WRITE(BME680_REG_GAS_WAIT_X_START + i, dur);
 
-		regt++;
-		regd++;
+		seq[i] = heat;
+		seq[Count + i] = wait;
 	}
 
-	return true;
+	memset(&seq[Count << 1], 0, sizeof(DEVREGSEQ));	// DEVREGSEQ_OP_END
+
+	exec.Init(vbSpi ? s_Bme680SpiRegSeqCfg : s_Bme680I2cRegSeqCfg, this);
+
+	return exec.Run(seq);
 }
 
 /**
@@ -96,10 +96,14 @@ int _open(const char * const pPathName, int Flags, int Mode)
 
 	if (p == NULL || strncmp(pPathName, "FAT:", 4) == 0)
 	{
+		if (g_DevTable[STDFS_FILENO] == NULL)
+			return -1;
+
 		retval = g_DevTable[STDFS_FILENO]->Open(g_DevTable[STDFS_FILENO]->pDevObj, pPathName, Flags, Mode);
 		if (retval != -1)
 		{
-			retval = (retval << 4) | STDFS_FILENO;
+			// Device handle in upper bits, table index in lower bits
+			retval = (retval << STDDEV_FDIDX_NBITS) | STDFS_FILENO;
 		}
 	}
 	else
@@ -107,14 +111,15 @@ int _open(const char * const pPathName, int Flags, int Mode)
 		// check for named device
 		for (int i = STDFS_FILENO; i < STDDEV_MAX; i++)
 		{
-			if (strncmp(g_DevTable[i]->Name, pPathName, 4) == 0)
+			if (g_DevTable[i] && strncmp(g_DevTable[i]->Name, pPathName, 4) == 0)
 			{
 				retval = g_DevTable[i]->Open(g_DevTable[i]->pDevObj, pPathName, Flags, Mode);
 
 				if (retval != -1)
 				{
-					retval = (retval << 4) | i;
+					retval = (retval << STDDEV_FDIDX_NBITS) | i;
 				}
+				break;
 			}
 		}
 	}